@@ -9,8 +9,12 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 #include <libsoup/soup.h>
+#include <json-glib/json-glib.h>
 #ifdef HAVE_GIO_UNIX
 #include <gio/gunixfdlist.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include <fcntl.h>
@@ -52,6 +56,9 @@ typedef struct {
 	GDBusProxy			*proxy;
 	SoupSession			*soup_session;
 	gchar				*user_agent;
+	FwupdFeatureFlags		 feature_flags;
+	gboolean			 device_cache_enabled;
+	GPtrArray			*device_cache;	/* (nullable): of FwupdDevice */
 } FwupdClientPrivate;
 
 enum {
@@ -241,6 +248,102 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 	}
 }
 
+static GPtrArray *
+fwupd_client_device_cache_copy (FwupdClient *client)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GPtrArray *devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < priv->device_cache->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (priv->device_cache, i);
+		g_ptr_array_add (devices, g_object_ref (dev));
+	}
+	return devices;
+}
+
+static void
+fwupd_client_device_cache_remove (FwupdClient *client, FwupdDevice *dev)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	if (priv->device_cache == NULL)
+		return;
+	for (guint i = 0; i < priv->device_cache->len; i++) {
+		FwupdDevice *dev_tmp = g_ptr_array_index (priv->device_cache, i);
+		if (g_strcmp0 (fwupd_device_get_id (dev_tmp),
+			       fwupd_device_get_id (dev)) == 0) {
+			g_ptr_array_remove_index (priv->device_cache, i);
+			return;
+		}
+	}
+}
+
+static void
+fwupd_client_device_cache_add (FwupdClient *client, FwupdDevice *dev)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	if (priv->device_cache == NULL)
+		return;
+	fwupd_client_device_cache_remove (client, dev);
+	g_ptr_array_add (priv->device_cache, g_object_ref (dev));
+}
+
+static FwupdDevice *
+fwupd_client_device_cache_find_by_id (FwupdClient *client, const gchar *device_id)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	if (priv->device_cache == NULL || device_id == NULL)
+		return NULL;
+	for (guint i = 0; i < priv->device_cache->len; i++) {
+		FwupdDevice *dev_tmp = g_ptr_array_index (priv->device_cache, i);
+		if (g_strcmp0 (fwupd_device_get_id (dev_tmp), device_id) == 0)
+			return dev_tmp;
+	}
+	return NULL;
+}
+
+/* apply the modified and removed keys on top of the cached device */
+static FwupdDevice *
+fwupd_client_device_apply_partial (FwupdDevice *dev_old, GVariant *parameters)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariant *value_tmp;
+	const gchar *key;
+	g_autofree const gchar **removed = NULL;
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) val_old = NULL;
+
+	g_variant_get (parameters, "(@a{sv}^a&s)", &changed, &removed);
+	val_old = g_variant_ref_sink (fwupd_device_to_variant (dev_old));
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, val_old);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value_tmp)) {
+		g_autoptr(GVariant) value = value_tmp;
+		g_autoptr(GVariant) value_new = g_variant_lookup_value (changed, key, NULL);
+		if (value_new != NULL)
+			continue;
+		if (removed != NULL && g_strv_contains ((const gchar * const *) removed, key))
+			continue;
+		g_variant_builder_add (&builder, "{sv}", key, value);
+	}
+	g_variant_iter_init (&iter, changed);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value_tmp)) {
+		g_autoptr(GVariant) value = value_tmp;
+		g_variant_builder_add (&builder, "{sv}", key, value);
+	}
+	return fwupd_device_from_variant (g_variant_builder_end (&builder));
+}
+
+static void
+fwupd_client_name_owner_notify_cb (GDBusProxy *proxy,
+				   GParamSpec *pspec,
+				   FwupdClient *client)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+
+	/* the daemon restarted so any cached devices are no longer valid */
+	g_clear_pointer (&priv->device_cache, g_ptr_array_unref);
+}
+
 static void
 fwupd_client_signal_cb (GDBusProxy *proxy,
 			const gchar *sender_name,
@@ -248,6 +351,7 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 			GVariant *parameters,
 			FwupdClient *client)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
 	g_autoptr(FwupdDevice) dev = NULL;
 	if (g_strcmp0 (signal_name, "Changed") == 0) {
 		g_debug ("Emitting ::changed()");
@@ -256,6 +360,7 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceAdded") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		fwupd_client_device_cache_add (client, dev);
 		g_debug ("Emitting ::device-added(%s)",
 			 fwupd_device_get_id (dev));
 		g_signal_emit (client, signals[SIGNAL_DEVICE_ADDED], 0, dev);
@@ -263,6 +368,7 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceRemoved") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		fwupd_client_device_cache_remove (client, dev);
 		g_signal_emit (client, signals[SIGNAL_DEVICE_REMOVED], 0, dev);
 		g_debug ("Emitting ::device-removed(%s)",
 			 fwupd_device_get_id (dev));
@@ -270,6 +376,29 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+
+		/* the DeviceChangedPartial signal will follow */
+		if ((priv->feature_flags & FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL) > 0 &&
+		    fwupd_client_device_cache_find_by_id (client, fwupd_device_get_id (dev)) != NULL)
+			return;
+		fwupd_client_device_cache_add (client, dev);
+		g_signal_emit (client, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
+		g_debug ("Emitting ::device-changed(%s)",
+			 fwupd_device_get_id (dev));
+		return;
+	}
+	if (g_strcmp0 (signal_name, "DeviceChangedPartial") == 0) {
+		FwupdDevice *dev_old;
+		const gchar *device_id = NULL;
+		g_autoptr(GVariant) changed = g_variant_get_child_value (parameters, 0);
+		g_variant_lookup (changed, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id);
+		dev_old = fwupd_client_device_cache_find_by_id (client, device_id);
+		if (dev_old == NULL) {
+			g_debug ("ignoring partial change for uncached %s", device_id);
+			return;
+		}
+		dev = fwupd_client_device_apply_partial (dev_old, parameters);
+		fwupd_client_device_cache_add (client, dev);
 		g_signal_emit (client, signals[SIGNAL_DEVICE_CHANGED], 0, dev);
 		g_debug ("Emitting ::device-changed(%s)",
 			 fwupd_device_get_id (dev));
@@ -396,6 +525,8 @@ fwupd_client_connect (FwupdClient *client, GCancellable *cancellable, GError **e
 			  G_CALLBACK (fwupd_client_properties_changed_cb), client);
 	g_signal_connect (priv->proxy, "g-signal",
 			  G_CALLBACK (fwupd_client_signal_cb), client);
+	g_signal_connect (priv->proxy, "notify::g-name-owner",
+			  G_CALLBACK (fwupd_client_name_owner_notify_cb), client);
 	val = g_dbus_proxy_get_cached_property (priv->proxy, "DaemonVersion");
 	if (val != NULL)
 		fwupd_client_set_daemon_version (client, g_variant_get_string (val, NULL));
@@ -451,6 +582,81 @@ fwupd_client_fixup_dbus_error (GError *error)
 	g_dbus_error_strip_remote_error (error);
 }
 
+typedef enum {
+	FWUPD_CLIENT_ARRAY_KIND_DEVICES,
+	FWUPD_CLIENT_ARRAY_KIND_RELEASES,
+	FWUPD_CLIENT_ARRAY_KIND_REMOTES,
+} FwupdClientArrayKind;
+
+static void
+fwupd_client_call_array_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClientArrayKind kind = GPOINTER_TO_UINT (g_task_get_task_data (task));
+	GError *error = NULL;
+	GPtrArray *array = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, error);
+		return;
+	}
+	if (kind == FWUPD_CLIENT_ARRAY_KIND_DEVICES)
+		array = fwupd_device_array_from_variant (val);
+	else if (kind == FWUPD_CLIENT_ARRAY_KIND_RELEASES)
+		array = fwupd_release_array_from_variant (val);
+	else if (kind == FWUPD_CLIENT_ARRAY_KIND_REMOTES)
+		array = fwupd_remote_array_from_variant (val);
+	g_task_return_pointer (task, array, (GDestroyNotify) g_ptr_array_unref);
+}
+
+/* calls a daemon method returning an array without blocking, so that several
+ * requests can be in flight on the same connection at once */
+static void
+fwupd_client_call_array_async (FwupdClient *client,
+			       const gchar *method_name,
+			       GVariant *parameters,
+			       FwupdClientArrayKind kind,
+			       GCancellable *cancellable,
+			       GAsyncReadyCallback callback,
+			       gpointer callback_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GError *error = NULL;
+	g_autoptr(GTask) task = g_task_new (client, cancellable, callback, callback_data);
+
+	g_task_set_task_data (task, GUINT_TO_POINTER (kind), NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, &error)) {
+		if (parameters != NULL)
+			g_variant_unref (g_variant_ref_sink (parameters));
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* call into daemon */
+	g_dbus_proxy_call (priv->proxy,
+			   method_name,
+			   parameters,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1,
+			   cancellable,
+			   fwupd_client_call_array_cb,
+			   g_steal_pointer (&task));
+}
+
+static GPtrArray *
+fwupd_client_call_array_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
 /**
  * fwupd_client_get_host_security_attrs:
  * @client: A #FwupdClient
@@ -493,46 +699,31 @@ fwupd_client_get_host_security_attrs (FwupdClient *client, GCancellable *cancell
 	return fwupd_security_attr_array_from_variant (val);
 }
 
-static GHashTable *
-fwupd_report_metadata_hash_from_variant (GVariant *value)
-{
-	GHashTable *hash;
-	gsize sz;
-	g_autoptr(GVariant) untuple = NULL;
-
-	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-	untuple = g_variant_get_child_value (value, 0);
-	sz = g_variant_n_children (untuple);
-	for (guint i = 0; i < sz; i++) {
-		g_autoptr(GVariant) data = NULL;
-		const gchar *key = NULL;
-		const gchar *val = NULL;
-		data = g_variant_get_child_value (untuple, i);
-		g_variant_get (data, "{&s&s}", &key, &val);
-		g_hash_table_insert (hash, g_strdup (key), g_strdup (val));
-	}
-	return hash;
-}
-
 /**
- * fwupd_client_get_report_metadata:
+ * fwupd_client_get_traces:
  * @client: A #FwupdClient
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
- * Gets all the report metadata from the daemon.
+ * Gets the most recent timing spans recorded by the daemon, for instance
+ * for each plugin vfunc and device write. The spans are exported in the
+ * Chrome trace event format, which can be loaded into `about:tracing` or
+ * https://ui.perfetto.dev/ for analysis.
  *
- * Returns: (transfer container): attributes
+ * Returns: a JSON string, or %NULL for error
  *
  * Since: 1.5.0
  **/
-GHashTable *
-fwupd_client_get_report_metadata (FwupdClient *client,
-				  GCancellable *cancellable,
-				  GError **error)
+gchar *
+fwupd_client_get_traces (FwupdClient *client, GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	gchar *data;
+	g_autoptr(GVariant) untuple = NULL;
 	g_autoptr(GVariant) val = NULL;
+	g_autoptr(JsonBuilder) builder = NULL;
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
@@ -544,7 +735,7 @@ fwupd_client_get_report_metadata (FwupdClient *client,
 
 	/* call into daemon */
 	val = g_dbus_proxy_call_sync (priv->proxy,
-				      "GetReportMetadata",
+				      "GetTraces",
 				      NULL,
 				      G_DBUS_CALL_FLAGS_NONE,
 				      -1,
@@ -555,25 +746,77 @@ fwupd_client_get_report_metadata (FwupdClient *client,
 			fwupd_client_fixup_dbus_error (*error);
 		return NULL;
 	}
-	return fwupd_report_metadata_hash_from_variant (val);
+
+	/* each span is a "complete" event, all in the daemon process */
+	builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "traceEvents");
+	json_builder_begin_array (builder);
+	untuple = g_variant_get_child_value (val, 0);
+	for (gsize i = 0; i < g_variant_n_children (untuple); i++) {
+		const gchar *category = NULL;
+		const gchar *name = NULL;
+		gint64 start = 0;
+		gint64 duration = 0;
+		guint32 thread_id = 0;
+		g_variant_get_child (untuple, i, "(&s&sxxu)",
+				     &category, &name, &start, &duration, &thread_id);
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "name");
+		json_builder_add_string_value (builder, name);
+		json_builder_set_member_name (builder, "cat");
+		json_builder_add_string_value (builder, category);
+		json_builder_set_member_name (builder, "ph");
+		json_builder_add_string_value (builder, "X");
+		json_builder_set_member_name (builder, "ts");
+		json_builder_add_int_value (builder, start);
+		json_builder_set_member_name (builder, "dur");
+		json_builder_add_int_value (builder, duration);
+		json_builder_set_member_name (builder, "pid");
+		json_builder_add_int_value (builder, 1);
+		json_builder_set_member_name (builder, "tid");
+		json_builder_add_int_value (builder, thread_id);
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_set_member_name (builder, "displayTimeUnit");
+	json_builder_add_string_value (builder, "ms");
+	json_builder_end_object (builder);
+
+	/* export as a string */
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	if (data == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "Failed to convert to JSON string");
+		return NULL;
+	}
+	return data;
 }
 
 /**
- * fwupd_client_get_devices:
+ * fwupd_client_get_metrics:
  * @client: A #FwupdClient
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
- * Gets all the devices registered with the daemon.
+ * Gets the daemon counters and latency histograms in the OpenMetrics text
+ * format, which can be scraped by Prometheus.
  *
- * Returns: (element-type FwupdDevice) (transfer container): results
+ * Returns: a string, or %NULL for error
  *
- * Since: 0.9.2
+ * Since: 1.5.0
  **/
-GPtrArray *
-fwupd_client_get_devices (FwupdClient *client, GCancellable *cancellable, GError **error)
+gchar *
+fwupd_client_get_metrics (FwupdClient *client, GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	gchar *metrics = NULL;
 	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
@@ -586,7 +829,7 @@ fwupd_client_get_devices (FwupdClient *client, GCancellable *cancellable, GError
 
 	/* call into daemon */
 	val = g_dbus_proxy_call_sync (priv->proxy,
-				      "GetDevices",
+				      "GetMetrics",
 				      NULL,
 				      G_DBUS_CALL_FLAGS_NONE,
 				      -1,
@@ -597,25 +840,34 @@ fwupd_client_get_devices (FwupdClient *client, GCancellable *cancellable, GError
 			fwupd_client_fixup_dbus_error (*error);
 		return NULL;
 	}
-	return fwupd_device_array_from_variant (val);
+	g_variant_get (val, "(s)", &metrics);
+	return metrics;
 }
 
 /**
- * fwupd_client_get_history:
+ * fwupd_client_get_plugin_stats:
  * @client: A #FwupdClient
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
- * Gets all the history.
+ * Gets the resources used by each daemon plugin, for instance the wall and
+ * thread CPU time spent in the plugin vfuncs and the number of devices it
+ * created.
  *
- * Returns: (element-type FwupdDevice) (transfer container): results
+ * Each entry is a dictionary with the keys `Name`, `Enabled`, `Calls`,
+ * `WallTime`, `CpuTime`, `Devices` and `Events`, where the times are in
+ * microseconds.
  *
- * Since: 1.0.4
+ * Returns: (element-type GVariant) (transfer container): results
+ *
+ * Since: 1.5.0
  **/
 GPtrArray *
-fwupd_client_get_history (FwupdClient *client, GCancellable *cancellable, GError **error)
+fwupd_client_get_plugin_stats (FwupdClient *client, GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GPtrArray *array;
+	g_autoptr(GVariant) untuple = NULL;
 	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
@@ -628,7 +880,7 @@ fwupd_client_get_history (FwupdClient *client, GCancellable *cancellable, GError
 
 	/* call into daemon */
 	val = g_dbus_proxy_call_sync (priv->proxy,
-				      "GetHistory",
+				      "GetPluginStats",
 				      NULL,
 				      G_DBUS_CALL_FLAGS_NONE,
 				      -1,
@@ -639,123 +891,844 @@ fwupd_client_get_history (FwupdClient *client, GCancellable *cancellable, GError
 			fwupd_client_fixup_dbus_error (*error);
 		return NULL;
 	}
-	return fwupd_device_array_from_variant (val);
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+	untuple = g_variant_get_child_value (val, 0);
+	for (gsize i = 0; i < g_variant_n_children (untuple); i++)
+		g_ptr_array_add (array, g_variant_get_child_value (untuple, i));
+	return array;
+}
+
+static GHashTable *
+fwupd_report_metadata_hash_from_variant (GVariant *value)
+{
+	GHashTable *hash;
+	gsize sz;
+	g_autoptr(GVariant) untuple = NULL;
+
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	untuple = g_variant_get_child_value (value, 0);
+	sz = g_variant_n_children (untuple);
+	for (guint i = 0; i < sz; i++) {
+		g_autoptr(GVariant) data = NULL;
+		const gchar *key = NULL;
+		const gchar *val = NULL;
+		data = g_variant_get_child_value (untuple, i);
+		g_variant_get (data, "{&s&s}", &key, &val);
+		g_hash_table_insert (hash, g_strdup (key), g_strdup (val));
+	}
+	return hash;
+}
+
+static gboolean
+fwupd_client_daemon_version_at_least (FwupdClient *client,
+				      guint64 major_req,
+				      guint64 minor_req)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	guint64 major;
+	guint64 minor;
+	g_auto(GStrv) split = NULL;
+
+	if (priv->daemon_version == NULL)
+		return FALSE;
+	split = g_strsplit (priv->daemon_version, ".", -1);
+	if (g_strv_length (split) < 2)
+		return FALSE;
+	major = g_ascii_strtoull (split[0], NULL, 10);
+	minor = g_ascii_strtoull (split[1], NULL, 10);
+	return major > major_req || (major == major_req && minor >= minor_req);
+}
+
+/* GetDevicesCompact was added in 1.5.0 */
+static const gchar *
+fwupd_client_get_devices_method (FwupdClient *client)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	if ((priv->feature_flags & FWUPD_FEATURE_FLAG_COMPACT_VARIANT) == 0)
+		return "GetDevices";
+	if (!fwupd_client_daemon_version_at_least (client, 1, 5))
+		return "GetDevices";
+	return "GetDevicesCompact";
+}
+
+/* the Fd variants of the large methods were added in 1.5.0 */
+static gboolean
+fwupd_client_use_fd_reply (FwupdClient *client)
+{
+#ifdef HAVE_GIO_UNIX
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	if ((priv->feature_flags & FWUPD_FEATURE_FLAG_FD_REPLY) == 0)
+		return FALSE;
+	return fwupd_client_daemon_version_at_least (client, 1, 5);
+#else
+	return FALSE;
+#endif
+}
+
+#ifdef HAVE_GIO_UNIX
+/* maps the sealed memfd sent by the daemon and uses it as the reply without
+ * copying it; an unsealed fd could be truncated while mapped */
+static GVariant *
+fwupd_client_variant_from_fd_reply (GVariant *val,
+				    GUnixFDList *fd_list,
+				    const GVariantType *reply_type,
+				    GError **error)
+{
+	gint fd;
+	gint32 handle = 0;
+	gint seals;
+	gint seals_required = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	if (fd_list == NULL || !g_variant_is_of_type (val, G_VARIANT_TYPE ("(h)"))) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "invalid handle");
+		return NULL;
+	}
+	g_variant_get (val, "(h)", &handle);
+	fd = g_unix_fd_list_get (fd_list, handle, error);
+	if (fd < 0)
+		return NULL;
+	seals = fcntl (fd, F_GET_SEALS);
+	if (seals < 0 || (seals & seals_required) != seals_required) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "reply memfd was not sealed");
+		close (fd);
+		return NULL;
+	}
+	mapped_file = g_mapped_file_new_from_fd (fd, FALSE, error);
+	close (fd);
+	if (mapped_file == NULL)
+		return NULL;
+	blob = g_mapped_file_get_bytes (mapped_file);
+	return g_variant_ref_sink (g_variant_new_from_bytes (reply_type, blob, FALSE));
+}
+#endif
+
+/* calls a daemon method with no arguments, asking for the reply to be sent
+ * in a memfd if the client has opted in and the daemon supports it */
+static GVariant *
+fwupd_client_call_sync (FwupdClient *client,
+			const gchar *method_name,
+			const GVariantType *reply_type,
+			GCancellable *cancellable,
+			GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+#ifdef HAVE_GIO_UNIX
+	if (fwupd_client_use_fd_reply (client)) {
+		g_autofree gchar *method_name_fd = g_strdup_printf ("%sFd", method_name);
+		g_autoptr(GUnixFDList) fd_list = NULL;
+		g_autoptr(GVariant) val = NULL;
+		val = g_dbus_proxy_call_with_unix_fd_list_sync (priv->proxy,
+								method_name_fd,
+								NULL,
+								G_DBUS_CALL_FLAGS_NONE,
+								-1,
+								NULL,
+								&fd_list,
+								cancellable,
+								error);
+		if (val == NULL)
+			return NULL;
+		return fwupd_client_variant_from_fd_reply (val, fd_list, reply_type, error);
+	}
+#endif
+	return g_dbus_proxy_call_sync (priv->proxy,
+				       method_name,
+				       NULL,
+				       G_DBUS_CALL_FLAGS_NONE,
+				       -1,
+				       cancellable,
+				       error);
 }
 
 /**
- * fwupd_client_get_device_by_id:
+ * fwupd_client_get_report_metadata:
  * @client: A #FwupdClient
- * @device_id: the device ID, e.g. `usb:00:01:03:03`
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
- * Gets a device by it's device ID.
+ * Gets all the report metadata from the daemon.
  *
- * Returns: (transfer full): a #FwupdDevice or %NULL
+ * Returns: (transfer container): attributes
  *
- * Since: 0.9.3
+ * Since: 1.5.0
  **/
-FwupdDevice *
-fwupd_client_get_device_by_id (FwupdClient *client,
-			       const gchar *device_id,
-			       GCancellable *cancellable,
-			       GError **error)
+GHashTable *
+fwupd_client_get_report_metadata (FwupdClient *client,
+				  GCancellable *cancellable,
+				  GError **error)
 {
-	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
-	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* get all the devices */
-	devices = fwupd_client_get_devices (client, cancellable, error);
-	if (devices == NULL)
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
 		return NULL;
 
-	/* find the device by ID (client side) */
-	for (guint i = 0; i < devices->len; i++) {
-		FwupdDevice *dev = g_ptr_array_index (devices, i);
-		if (g_strcmp0 (fwupd_device_get_id (dev), device_id) == 0)
-			return g_object_ref (dev);
+	/* call into daemon */
+	val = fwupd_client_call_sync (client,
+				      "GetReportMetadata",
+				      G_VARIANT_TYPE ("(a{ss})"),
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
 	}
-	g_set_error (error,
-		     FWUPD_ERROR,
-		     FWUPD_ERROR_NOT_FOUND,
-		     "failed to find %s", device_id);
+	return fwupd_report_metadata_hash_from_variant (val);
+}
+
+/**
+ * fwupd_client_set_device_cache:
+ * @client: A #FwupdClient
+ * @enabled: %TRUE to cache devices
+ *
+ * Keeps a copy of the devices returned by fwupd_client_get_devices(), which
+ * is then kept up to date using the device signals from the daemon. This
+ * avoids fetching the entire device list for each call.
+ *
+ * The devices are shared with the cache and should not be modified.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_set_device_cache (FwupdClient *client, gboolean enabled)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	priv->device_cache_enabled = enabled;
+	if (!enabled)
+		g_clear_pointer (&priv->device_cache, g_ptr_array_unref);
+}
+
+/**
+ * fwupd_client_get_devices:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the devices registered with the daemon.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 0.9.2
+ **/
+GPtrArray *
+fwupd_client_get_devices (FwupdClient *client, GCancellable *cancellable, GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	const gchar *method_name;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* already kept up to date by the device signals */
+	if (priv->device_cache != NULL)
+		return fwupd_client_device_cache_copy (client);
+
+	/* call into daemon */
+	method_name = fwupd_client_get_devices_method (client);
+	val = fwupd_client_call_sync (client,
+				      method_name,
+				      g_strcmp0 (method_name, "GetDevicesCompact") == 0 ?
+					      G_VARIANT_TYPE ("(aa{qv})") :
+					      G_VARIANT_TYPE ("(aa{sv})"),
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	if (priv->device_cache_enabled) {
+		priv->device_cache = fwupd_device_array_from_variant (val);
+		return fwupd_client_device_cache_copy (client);
+	}
+	return fwupd_device_array_from_variant (val);
+}
+
+/**
+ * fwupd_client_get_devices_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the devices registered with the daemon without blocking.
+ *
+ * Several requests can be in flight at the same time and may complete
+ * in any order.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_devices_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer callback_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* already kept up to date by the device signals */
+	if (priv->device_cache != NULL) {
+		g_autoptr(GTask) task = g_task_new (client, cancellable, callback, callback_data);
+		g_task_return_pointer (task,
+				       fwupd_client_device_cache_copy (client),
+				       (GDestroyNotify) g_ptr_array_unref);
+		return;
+	}
+	fwupd_client_call_array_async (client,
+				       fwupd_client_get_devices_method (client),
+				       NULL,
+				       FWUPD_CLIENT_ARRAY_KIND_DEVICES,
+				       cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_devices_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_devices_async().
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_devices_finish (FwupdClient *client,
+				 GAsyncResult *res,
+				 GError **error)
+{
+	return fwupd_client_call_array_finish (client, res, error);
+}
+
+static gboolean
+fwupd_client_device_matches_filter (FwupdDevice *dev,
+				    FwupdDeviceFlags include_flags,
+				    FwupdDeviceFlags exclude_flags,
+				    const gchar *plugin,
+				    const gchar *guid)
+{
+	guint64 flags = fwupd_device_get_flags (dev);
+	if ((flags & include_flags) != include_flags)
+		return FALSE;
+	if ((flags & exclude_flags) != 0)
+		return FALSE;
+	if (plugin != NULL && g_strcmp0 (fwupd_device_get_plugin (dev), plugin) != 0)
+		return FALSE;
+	if (guid != NULL && !fwupd_device_has_guid (dev, guid))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * fwupd_client_get_devices_filtered:
+ * @client: A #FwupdClient
+ * @include_flags: #FwupdDeviceFlags that must all be set, or 0
+ * @exclude_flags: #FwupdDeviceFlags that must all be unset, or 0
+ * @plugin: (nullable): a plugin name, e.g. `colorhug`
+ * @guid: (nullable): a device GUID
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets the devices registered with the daemon that match all of the
+ * criteria. The filtering is done by the daemon when supported, so only the
+ * matching devices are sent to the client.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_devices_filtered (FwupdClient *client,
+				   FwupdDeviceFlags include_flags,
+				   FwupdDeviceFlags exclude_flags,
+				   const gchar *plugin,
+				   const gchar *guid,
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* filter the cached devices, or do it client side for old daemons */
+	if (priv->device_cache != NULL ||
+	    !fwupd_client_daemon_version_at_least (client, 1, 5)) {
+		g_autoptr(GPtrArray) devices = NULL;
+		g_autoptr(GPtrArray) devices_tmp = NULL;
+		devices_tmp = fwupd_client_get_devices (client, cancellable, error);
+		if (devices_tmp == NULL)
+			return NULL;
+		devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		for (guint i = 0; i < devices_tmp->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (devices_tmp, i);
+			if (fwupd_client_device_matches_filter (dev,
+								include_flags,
+								exclude_flags,
+								plugin,
+								guid))
+				g_ptr_array_add (devices, g_object_ref (dev));
+		}
+		if (devices->len == 0) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOTHING_TO_DO,
+					     "No matching devices");
+			return NULL;
+		}
+		return g_steal_pointer (&devices);
+	}
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetDevicesFiltered",
+				      g_variant_new ("(ttss)",
+						     (guint64) include_flags,
+						     (guint64) exclude_flags,
+						     plugin != NULL ? plugin : "",
+						     guid != NULL ? guid : ""),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	return fwupd_device_array_from_variant (val);
+}
+
+/**
+ * fwupd_client_get_history:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the history.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.0.4
+ **/
+GPtrArray *
+fwupd_client_get_history (FwupdClient *client, GCancellable *cancellable, GError **error)
+{
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* call into daemon */
+	val = fwupd_client_call_sync (client,
+				      "GetHistory",
+				      G_VARIANT_TYPE ("(aa{sv})"),
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	return fwupd_device_array_from_variant (val);
+}
+
+/**
+ * fwupd_client_get_history_range:
+ * @client: A #FwupdClient
+ * @limit: maximum number of devices to return, or 0 for no limit
+ * @offset: number of the most recently modified devices to skip
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets a page of the history, so that clients showing the most recent updates
+ * do not need to fetch everything. The devices are sorted oldest first.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_history_range (FwupdClient *client,
+				guint limit,
+				guint offset,
+				GCancellable *cancellable,
+				GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetHistoryRange",
+				      g_variant_new ("(uu)", limit, offset),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	return fwupd_device_array_from_variant (val);
+}
+
+/**
+ * fwupd_client_get_history_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the history without blocking.
+ *
+ * Several requests can be in flight at the same time and may complete
+ * in any order.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_history_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_array_async (client, "GetHistory", NULL,
+				       FWUPD_CLIENT_ARRAY_KIND_DEVICES,
+				       cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_history_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_history_async().
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_history_finish (FwupdClient *client,
+				 GAsyncResult *res,
+				 GError **error)
+{
+	return fwupd_client_call_array_finish (client, res, error);
+}
+
+/**
+ * fwupd_client_get_device_by_id:
+ * @client: A #FwupdClient
+ * @device_id: the device ID, e.g. `usb:00:01:03:03`
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets a device by it's device ID.
+ *
+ * Returns: (transfer full): a #FwupdDevice or %NULL
+ *
+ * Since: 0.9.3
+ **/
+FwupdDevice *
+fwupd_client_get_device_by_id (FwupdClient *client,
+			       const gchar *device_id,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	g_autoptr(GPtrArray) devices = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (device_id != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* get all the devices */
+	devices = fwupd_client_get_devices (client, cancellable, error);
+	if (devices == NULL)
+		return NULL;
+
+	/* find the device by ID (client side) */
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fwupd_device_get_id (dev), device_id) == 0)
+			return g_object_ref (dev);
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_NOT_FOUND,
+		     "failed to find %s", device_id);
 	return NULL;
 }
 
 /**
  * fwupd_client_get_devices_by_guid:
  * @client: A #FwupdClient
- * @guid: the GUID, e.g. `e22c4520-43dc-5bb3-8245-5787fead9b63`
+ * @guid: the GUID, e.g. `e22c4520-43dc-5bb3-8245-5787fead9b63`
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets any devices that provide a specific GUID. An error is returned if no
+ * devices contains this GUID.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): devices or %NULL
+ *
+ * Since: 1.4.1
+ **/
+GPtrArray *
+fwupd_client_get_devices_by_guid (FwupdClient *client,
+				  const gchar *guid,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (guid != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* get all the devices */
+	devices_tmp = fwupd_client_get_devices (client, cancellable, error);
+	if (devices_tmp == NULL)
+		return NULL;
+
+	/* find the devices by GUID (client side) */
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < devices_tmp->len; i++) {
+		FwupdDevice *dev_tmp = g_ptr_array_index (devices_tmp, i);
+		if (fwupd_device_has_guid (dev_tmp, guid))
+			g_ptr_array_add (devices, g_object_ref (dev_tmp));
+	}
+
+	/* nothing */
+	if (devices->len == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "failed to find any device providing %s", guid);
+		return NULL;
+	}
+
+	/* success */
+	return g_steal_pointer (&devices);
+}
+
+/**
+ * fwupd_client_get_releases:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the releases for a specific device
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 0.9.3
+ **/
+GPtrArray *
+fwupd_client_get_releases (FwupdClient *client, const gchar *device_id,
+			   GCancellable *cancellable, GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (device_id != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetReleases",
+				      g_variant_new ("(s)", device_id),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	return fwupd_release_array_from_variant (val);
+}
+
+/**
+ * fwupd_client_get_releases_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the releases for a specific device without blocking.
+ *
+ * Several requests can be in flight at the same time and may complete
+ * in any order.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_releases_async (FwupdClient *client,
+				 const gchar *device_id,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_array_async (client, "GetReleases",
+				       g_variant_new ("(s)", device_id),
+				       FWUPD_CLIENT_ARRAY_KIND_RELEASES,
+				       cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_releases_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_releases_async().
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_releases_finish (FwupdClient *client,
+				  GAsyncResult *res,
+				  GError **error)
+{
+	return fwupd_client_call_array_finish (client, res, error);
+}
+
+/**
+ * fwupd_client_get_releases_filtered:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @keys: (array zero-terminated=1): the property names to include, e.g. `Version`
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
- * Gets any devices that provide a specific GUID. An error is returned if no
- * devices contains this GUID.
+ * Gets all the releases for a specific device, with only the requested
+ * properties set on each. Older daemons may set all the properties.
  *
- * Returns: (element-type FwupdDevice) (transfer container): devices or %NULL
+ * Returns: (element-type FwupdRelease) (transfer container): results
  *
- * Since: 1.4.1
+ * Since: 1.5.0
  **/
 GPtrArray *
-fwupd_client_get_devices_by_guid (FwupdClient *client,
-				  const gchar *guid,
-				  GCancellable *cancellable,
-				  GError **error)
+fwupd_client_get_releases_filtered (FwupdClient *client,
+				    const gchar *device_id,
+				    const gchar **keys,
+				    GCancellable *cancellable,
+				    GError **error)
 {
-	g_autoptr(GPtrArray) devices = NULL;
-	g_autoptr(GPtrArray) devices_tmp = NULL;
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
-	g_return_val_if_fail (guid != NULL, NULL);
+	g_return_val_if_fail (device_id != NULL, NULL);
+	g_return_val_if_fail (keys != NULL, NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* get all the devices */
-	devices_tmp = fwupd_client_get_devices (client, cancellable, error);
-	if (devices_tmp == NULL)
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
 		return NULL;
 
-	/* find the devices by GUID (client side) */
-	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	for (guint i = 0; i < devices_tmp->len; i++) {
-		FwupdDevice *dev_tmp = g_ptr_array_index (devices_tmp, i);
-		if (fwupd_device_has_guid (dev_tmp, guid))
-			g_ptr_array_add (devices, g_object_ref (dev_tmp));
-	}
+	/* GetReleasesFiltered was added in 1.5.0 */
+	if (!fwupd_client_daemon_version_at_least (client, 1, 5))
+		return fwupd_client_get_releases (client, device_id, cancellable, error);
 
-	/* nothing */
-	if (devices->len == 0) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_FOUND,
-			     "failed to find any device providing %s", guid);
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetReleasesFiltered",
+				      g_variant_new ("(s^as)", device_id, keys),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
 		return NULL;
 	}
-
-	/* success */
-	return g_steal_pointer (&devices);
+	return fwupd_release_array_from_variant (val);
 }
 
 /**
- * fwupd_client_get_releases:
+ * fwupd_client_get_downgrades:
  * @client: A #FwupdClient
  * @device_id: the device ID
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
- * Gets all the releases for a specific device
+ * Gets all the downgrades for a specific device.
  *
  * Returns: (element-type FwupdRelease) (transfer container): results
  *
- * Since: 0.9.3
+ * Since: 0.9.8
  **/
 GPtrArray *
-fwupd_client_get_releases (FwupdClient *client, const gchar *device_id,
-			   GCancellable *cancellable, GError **error)
+fwupd_client_get_downgrades (FwupdClient *client, const gchar *device_id,
+			     GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
 	g_autoptr(GVariant) val = NULL;
@@ -771,7 +1744,7 @@ fwupd_client_get_releases (FwupdClient *client, const gchar *device_id,
 
 	/* call into daemon */
 	val = g_dbus_proxy_call_sync (priv->proxy,
-				      "GetReleases",
+				      "GetDowngrades",
 				      g_variant_new ("(s)", device_id),
 				      G_DBUS_CALL_FLAGS_NONE,
 				      -1,
@@ -786,21 +1759,72 @@ fwupd_client_get_releases (FwupdClient *client, const gchar *device_id,
 }
 
 /**
- * fwupd_client_get_downgrades:
+ * fwupd_client_get_downgrades_async:
  * @client: A #FwupdClient
  * @device_id: the device ID
  * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the downgrades for a specific device without blocking.
+ *
+ * Several requests can be in flight at the same time and may complete
+ * in any order.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_downgrades_async (FwupdClient *client,
+				   const gchar *device_id,
+				   GCancellable *cancellable,
+				   GAsyncReadyCallback callback,
+				   gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_array_async (client, "GetDowngrades",
+				       g_variant_new ("(s)", device_id),
+				       FWUPD_CLIENT_ARRAY_KIND_RELEASES,
+				       cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_downgrades_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
  * @error: the #GError, or %NULL
  *
- * Gets all the downgrades for a specific device.
+ * Gets the result of fwupd_client_get_downgrades_async().
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_downgrades_finish (FwupdClient *client,
+				    GAsyncResult *res,
+				    GError **error)
+{
+	return fwupd_client_call_array_finish (client, res, error);
+}
+
+/**
+ * fwupd_client_get_upgrades:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the upgrades for a specific device.
  *
  * Returns: (element-type FwupdRelease) (transfer container): results
  *
  * Since: 0.9.8
  **/
 GPtrArray *
-fwupd_client_get_downgrades (FwupdClient *client, const gchar *device_id,
-			     GCancellable *cancellable, GError **error)
+fwupd_client_get_upgrades (FwupdClient *client, const gchar *device_id,
+			   GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
 	g_autoptr(GVariant) val = NULL;
@@ -816,7 +1840,7 @@ fwupd_client_get_downgrades (FwupdClient *client, const gchar *device_id,
 
 	/* call into daemon */
 	val = g_dbus_proxy_call_sync (priv->proxy,
-				      "GetDowngrades",
+				      "GetUpgrades",
 				      g_variant_new ("(s)", device_id),
 				      G_DBUS_CALL_FLAGS_NONE,
 				      -1,
@@ -831,27 +1855,71 @@ fwupd_client_get_downgrades (FwupdClient *client, const gchar *device_id,
 }
 
 /**
- * fwupd_client_get_upgrades:
+ * fwupd_client_get_upgrades_async:
  * @client: A #FwupdClient
  * @device_id: the device ID
  * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the upgrades for a specific device without blocking.
+ *
+ * Several requests can be in flight at the same time and may complete
+ * in any order.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_upgrades_async (FwupdClient *client,
+				 const gchar *device_id,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_array_async (client, "GetUpgrades",
+				       g_variant_new ("(s)", device_id),
+				       FWUPD_CLIENT_ARRAY_KIND_RELEASES,
+				       cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_upgrades_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
  * @error: the #GError, or %NULL
  *
- * Gets all the upgrades for a specific device.
+ * Gets the result of fwupd_client_get_upgrades_async().
  *
  * Returns: (element-type FwupdRelease) (transfer container): results
  *
- * Since: 0.9.8
+ * Since: 1.5.0
  **/
 GPtrArray *
-fwupd_client_get_upgrades (FwupdClient *client, const gchar *device_id,
-			   GCancellable *cancellable, GError **error)
+fwupd_client_get_upgrades_finish (FwupdClient *client,
+				  GAsyncResult *res,
+				  GError **error)
+{
+	return fwupd_client_call_array_finish (client, res, error);
+}
+
+static GHashTable *
+fwupd_client_get_release_map (FwupdClient *client,
+			      const gchar *method_name,
+			      GCancellable *cancellable,
+			      GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *device_id;
+	g_autoptr(GHashTable) results = NULL;
 	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) untuple = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
-	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
@@ -861,8 +1929,8 @@ fwupd_client_get_upgrades (FwupdClient *client, const gchar *device_id,
 
 	/* call into daemon */
 	val = g_dbus_proxy_call_sync (priv->proxy,
-				      "GetUpgrades",
-				      g_variant_new ("(s)", device_id),
+				      method_name,
+				      NULL,
 				      G_DBUS_CALL_FLAGS_NONE,
 				      -1,
 				      cancellable,
@@ -872,7 +1940,67 @@ fwupd_client_get_upgrades (FwupdClient *client, const gchar *device_id,
 			fwupd_client_fixup_dbus_error (*error);
 		return NULL;
 	}
-	return fwupd_release_array_from_variant (val);
+
+	/* device ID to array of releases */
+	results = g_hash_table_new_full (g_str_hash, g_str_equal,
+					 g_free, (GDestroyNotify) g_ptr_array_unref);
+	untuple = g_variant_get_child_value (val, 0);
+	g_variant_iter_init (&iter, untuple);
+	while (g_variant_iter_next (&iter, "{&s@aa{sv}}", &device_id, &value)) {
+		GPtrArray *releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		gsize sz = g_variant_n_children (value);
+		for (guint i = 0; i < sz; i++) {
+			FwupdRelease *rel;
+			g_autoptr(GVariant) data = g_variant_get_child_value (value, i);
+			rel = fwupd_release_from_variant (data);
+			if (rel == NULL)
+				continue;
+			g_ptr_array_add (releases, rel);
+		}
+		g_hash_table_insert (results, g_strdup (device_id), releases);
+		g_variant_unref (value);
+	}
+	return g_steal_pointer (&results);
+}
+
+/**
+ * fwupd_client_get_upgrades_all:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets the upgrades for every device using a single request. Devices without
+ * any upgrades are not included.
+ *
+ * Returns: (transfer container) (element-type utf8 GPtrArray): device ID to
+ * array of #FwupdRelease
+ *
+ * Since: 1.5.0
+ **/
+GHashTable *
+fwupd_client_get_upgrades_all (FwupdClient *client, GCancellable *cancellable, GError **error)
+{
+	return fwupd_client_get_release_map (client, "GetUpgradesAll", cancellable, error);
+}
+
+/**
+ * fwupd_client_get_releases_all:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets the releases for every device using a single request. Devices without
+ * any releases are not included.
+ *
+ * Returns: (transfer container) (element-type utf8 GPtrArray): device ID to
+ * array of #FwupdRelease
+ *
+ * Since: 1.5.0
+ **/
+GHashTable *
+fwupd_client_get_releases_all (FwupdClient *client, GCancellable *cancellable, GError **error)
+{
+	return fwupd_client_get_release_map (client, "GetReleasesAll", cancellable, error);
 }
 
 static void
@@ -1402,29 +2530,278 @@ fwupd_client_install (FwupdClient *client,
 #ifdef HAVE_GIO_UNIX
 	g_autoptr(GUnixInputStream) istr = NULL;
 
-	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
-	g_return_val_if_fail (device_id != NULL, FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
-	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (device_id != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return FALSE;
+
+	istr = fwupd_unix_input_stream_from_fn (filename, error);
+	if (istr == NULL)
+		return FALSE;
+	return fwupd_client_install_fd (client, device_id, istr, filename,
+					install_flags, cancellable, error);
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as <glib-unix.h> is unavailable");
+	return FALSE;
+#endif
+}
+
+#ifdef HAVE_GIO_UNIX
+/* resume a truncated transfer this many times using a HTTP range request */
+#define FWUPD_CLIENT_DOWNLOAD_RETRIES		3
+
+typedef struct {
+	FwupdClient		*client;
+	GChecksum		*checksum;
+	gint			 fd;
+	goffset			 offset;	/* bytes written to fd */
+	goffset			 total;		/* expected size, or 0 */
+	GError			*error;
+} FwupdClientStreamHelper;
+
+static void
+fwupd_client_stream_got_headers_cb (SoupMessage *msg, gpointer user_data)
+{
+	FwupdClientStreamHelper *helper = (FwupdClientStreamHelper *) user_data;
+	goffset start = 0;
+	goffset end = 0;
+	goffset total = 0;
+
+	/* a full response restarts the file, e.g. if the range was ignored */
+	if (msg->status_code == SOUP_STATUS_OK) {
+		if (helper->offset > 0) {
+			g_debug ("server ignored range, restarting download");
+			g_checksum_reset (helper->checksum);
+			if (ftruncate (helper->fd, 0) < 0 ||
+			    lseek (helper->fd, 0, SEEK_SET) < 0) {
+				g_set_error (&helper->error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "failed to truncate: %s",
+					     g_strerror (errno));
+				soup_session_cancel_message (GET_PRIVATE (helper->client)->soup_session,
+							     msg, SOUP_STATUS_CANCELLED);
+				return;
+			}
+			helper->offset = 0;
+		}
+		helper->total = soup_message_headers_get_content_length (msg->response_headers);
+		return;
+	}
+
+	/* the range has to start exactly where we stopped */
+	if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+		if (!soup_message_headers_get_content_range (msg->response_headers,
+							     &start, &end, &total) ||
+		    start != helper->offset) {
+			g_set_error (&helper->error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "invalid content range, expected start %" G_GOFFSET_FORMAT,
+				     helper->offset);
+			soup_session_cancel_message (GET_PRIVATE (helper->client)->soup_session,
+						     msg, SOUP_STATUS_CANCELLED);
+			return;
+		}
+		helper->total = total > 0 ? total : 0;
+	}
+}
+
+static void
+fwupd_client_stream_got_chunk_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+{
+	FwupdClientStreamHelper *helper = (FwupdClientStreamHelper *) user_data;
+	const guint8 *data = (const guint8 *) chunk->data;
+	gsize len = chunk->length;
+
+	/* ignore redirects and error pages */
+	if (msg->status_code != SOUP_STATUS_OK &&
+	    msg->status_code != SOUP_STATUS_PARTIAL_CONTENT)
+		return;
+	if (helper->error != NULL)
+		return;
+
+	/* write all of the chunk, then update the checksum */
+	while (len > 0) {
+		gssize rc = write (helper->fd, data, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (&helper->error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "failed to write: %s", g_strerror (errno));
+			soup_session_cancel_message (GET_PRIVATE (helper->client)->soup_session,
+						     msg, SOUP_STATUS_CANCELLED);
+			return;
+		}
+		g_checksum_update (helper->checksum, data, rc);
+		helper->offset += rc;
+		data += rc;
+		len -= rc;
+	}
+
+	/* progress */
+	if (helper->total > 0 && helper->offset <= helper->total) {
+		guint percentage = (guint) ((100 * helper->offset) / helper->total);
+		fwupd_client_set_status (helper->client, FWUPD_STATUS_DOWNLOADING);
+		fwupd_client_set_percentage (helper->client, percentage);
+	}
+}
+
+/* downloads @url into a memfd without keeping a copy in memory, and returns
+ * the stream positioned at the start along with the checksum */
+static GUnixInputStream *
+fwupd_client_download_stream (FwupdClient *client,
+			      const gchar *url,
+			      GChecksumType checksum_type,
+			      gchar **checksum,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GChecksum) csum = g_checksum_new (checksum_type);
+	g_autoptr(GUnixInputStream) istr = NULL;
+	g_autoptr(SoupURI) uri = NULL;
+	FwupdClientStreamHelper helper = {
+		.client		= client,
+		.checksum	= csum,
+		.fd		= -1,
+	};
+
+	/* ensure networking set up */
+	if (!fwupd_client_ensure_networking (client, error))
+		return NULL;
+	uri = soup_uri_new (url);
+	if (uri == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Failed to parse URI %s", url);
+		return NULL;
+	}
+
+	/* the stream owns the fd from now on */
+	helper.fd = memfd_create ("fwupd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (helper.fd < 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "failed to create memfd");
+		return NULL;
+	}
+	istr = G_UNIX_INPUT_STREAM (g_unix_input_stream_new (helper.fd, TRUE));
+
+	g_debug ("downloading %s", url);
+	for (guint i = 0; ; i++) {
+		guint status_code;
+		g_autoptr(SoupMessage) msg = NULL;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return NULL;
+		msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
+		if (helper.offset > 0) {
+			g_debug ("resuming download at %" G_GOFFSET_FORMAT, helper.offset);
+			soup_message_headers_set_range (msg->request_headers,
+							helper.offset, -1);
+		}
+
+		/* do not accumulate the body, we write each chunk to the fd */
+		soup_message_body_set_accumulate (msg->response_body, FALSE);
+		g_signal_connect (msg, "got-headers",
+				  G_CALLBACK (fwupd_client_stream_got_headers_cb),
+				  &helper);
+		g_signal_connect (msg, "got-chunk",
+				  G_CALLBACK (fwupd_client_stream_got_chunk_cb),
+				  &helper);
+		status_code = soup_session_send_message (priv->soup_session, msg);
+		fwupd_client_set_status (client, FWUPD_STATUS_IDLE);
+		if (helper.error != NULL) {
+			g_propagate_error (error, helper.error);
+			return NULL;
+		}
+		if (status_code == SOUP_STATUS_OK ||
+		    status_code == SOUP_STATUS_PARTIAL_CONTENT)
+			break;
+
+		/* only network failures after some data arrived are resumable */
+		if (SOUP_STATUS_IS_TRANSPORT_ERROR (status_code) &&
+		    helper.offset > 0 &&
+		    i < FWUPD_CLIENT_DOWNLOAD_RETRIES &&
+		    soup_message_headers_header_equals (msg->response_headers,
+							"Accept-Ranges", "bytes"))
+			continue;
+		if (status_code == 429) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "Failed to download due to server limit");
+			return NULL;
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Failed to download %s: %s",
+			     url, soup_status_get_phrase (status_code));
+		return NULL;
+	}
+
+	/* rewind so the daemon reads from the start */
+	if (!fwupd_unix_fd_seal (helper.fd, error))
+		return NULL;
+	if (lseek (helper.fd, 0, SEEK_SET) < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to seek: %s", g_strerror (errno));
+		return NULL;
+	}
+	*checksum = g_strdup (g_checksum_get_string (csum));
+	return g_steal_pointer (&istr);
+}
 
-	/* connect */
-	if (!fwupd_client_connect (client, cancellable, error))
-		return FALSE;
+/* the peer cache is not trusted, so a payload that does not match the
+ * checksum from the signed metadata is ignored and the remote is used */
+static GUnixInputStream *
+fwupd_client_download_stream_peer_cache (FwupdClient *client,
+					 FwupdRemote *remote,
+					 const gchar *checksum_expected,
+					 GChecksumType checksum_type,
+					 GCancellable *cancellable)
+{
+	g_autofree gchar *checksum_actual = NULL;
+	g_autofree gchar *uri_str = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GUnixInputStream) istr = NULL;
 
-	istr = fwupd_unix_input_stream_from_fn (filename, error);
-	if (istr == NULL)
-		return FALSE;
-	return fwupd_client_install_fd (client, device_id, istr, filename,
-					install_flags, cancellable, error);
-#else
-	g_set_error_literal (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_SUPPORTED,
-			     "Not supported as <glib-unix.h> is unavailable");
-	return FALSE;
-#endif
+	uri_str = fwupd_remote_build_peer_cache_uri (remote, checksum_expected, &error_local);
+	if (uri_str == NULL) {
+		g_debug ("cannot use peer cache: %s", error_local->message);
+		return NULL;
+	}
+	istr = fwupd_client_download_stream (client, uri_str, checksum_type,
+					     &checksum_actual,
+					     cancellable, &error_local);
+	if (istr == NULL) {
+		g_debug ("failed to download from peer cache: %s", error_local->message);
+		return NULL;
+	}
+	if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
+		g_debug ("ignoring peer cache, expected %s got %s",
+			 checksum_expected, checksum_actual);
+		return NULL;
+	}
+	return g_steal_pointer (&istr);
 }
+#endif
 
 /**
  * fwupd_client_install_release:
@@ -1455,13 +2832,17 @@ fwupd_client_install_release (FwupdClient *client,
 	const gchar *uri_tmp;
 	g_autofree gchar *checksum_actual = NULL;
 	g_autofree gchar *uri_str = NULL;
+	g_autoptr(FwupdRemote) remote = NULL;
+#ifdef HAVE_GIO_UNIX
+	g_autoptr(GUnixInputStream) istr = NULL;
+#else
 	g_autoptr(GBytes) blob = NULL;
+#endif
 
 	/* work out what remote-specific URI fields this should use */
 	uri_tmp = fwupd_release_get_uri (release);
 	remote_id = fwupd_release_get_remote_id (release);
 	if (remote_id != NULL) {
-		g_autoptr(FwupdRemote) remote = NULL;
 		g_autofree gchar *fn = NULL;
 
 		/* if a remote-id was specified, the remote has to exist */
@@ -1493,17 +2874,41 @@ fwupd_client_install_release (FwupdClient *client,
 		uri_str = g_strdup (uri_tmp);
 	}
 
-	/* download file */
+	/* if the device specifies ONLY_OFFLINE automatically set this flag */
+	if (fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
+		install_flags |= FWUPD_INSTALL_FLAG_OFFLINE;
+
+	/* stream the file into a memfd, checksumming as it arrives */
+	checksum_expected = fwupd_checksum_get_best (fwupd_release_get_checksums (release));
+	checksum_type = fwupd_checksum_guess_kind (checksum_expected);
+#ifdef HAVE_GIO_UNIX
+	if (remote != NULL &&
+	    checksum_expected != NULL &&
+	    fwupd_remote_get_peer_cache_uri (remote) != NULL) {
+		istr = fwupd_client_download_stream_peer_cache (client, remote,
+								checksum_expected,
+								checksum_type,
+								cancellable);
+		if (istr != NULL)
+			checksum_actual = g_strdup (checksum_expected);
+	}
+	if (istr == NULL) {
+		istr = fwupd_client_download_stream (client, uri_str, checksum_type,
+						     &checksum_actual,
+						     cancellable, error);
+		if (istr == NULL)
+			return FALSE;
+	}
+#else
 	blob = fwupd_client_download_bytes (client, uri_str,
 					    FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
 					    cancellable, error);
 	if (blob == NULL)
 		return FALSE;
+	checksum_actual = g_compute_checksum_for_bytes (checksum_type, blob);
+#endif
 
 	/* verify checksum */
-	checksum_expected = fwupd_checksum_get_best (fwupd_release_get_checksums (release));
-	checksum_type = fwupd_checksum_guess_kind (checksum_expected);
-	checksum_actual = g_compute_checksum_for_bytes (checksum_type, blob);
 	if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -1512,13 +2917,14 @@ fwupd_client_install_release (FwupdClient *client,
 			     checksum_expected, checksum_actual);
 		return FALSE;
 	}
-
-	/* if the device specifies ONLY_OFFLINE automatically set this flag */
-	if (fwupd_device_has_flag (device, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
-		install_flags |= FWUPD_INSTALL_FLAG_OFFLINE;
+#ifdef HAVE_GIO_UNIX
+	return fwupd_client_install_fd (client, fwupd_device_get_id (device),
+					istr, NULL, install_flags, NULL, error);
+#else
 	return fwupd_client_install_bytes (client,
 					   fwupd_device_get_id (device), blob,
 					   install_flags, NULL, error);
+#endif
 }
 
 /**
@@ -1574,7 +2980,8 @@ fwupd_client_get_details (FwupdClient *client, const gchar *filename,
 	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
 						  FWUPD_DBUS_PATH,
 						  FWUPD_DBUS_INTERFACE,
-						  "GetDetails");
+						  fwupd_client_use_fd_reply (client) ?
+						  "GetDetailsFd" : "GetDetails");
 	g_dbus_message_set_unix_fd_list (request, fd_list);
 
 	/* g_unix_fd_list_append did a dup() already */
@@ -1601,6 +3008,16 @@ fwupd_client_get_details (FwupdClient *client, const gchar *filename,
 	}
 
 	/* return results */
+	if (fwupd_client_use_fd_reply (client)) {
+		g_autoptr(GVariant) val = NULL;
+		val = fwupd_client_variant_from_fd_reply (helper->val,
+							  g_dbus_message_get_unix_fd_list (helper->message),
+							  G_VARIANT_TYPE ("(aa{sv})"),
+							  error);
+		if (val == NULL)
+			return NULL;
+		return fwupd_device_array_from_variant (val);
+	}
 	return fwupd_device_array_from_variant (helper->val);
 #else
 	g_set_error_literal (error,
@@ -1981,6 +3398,354 @@ fwupd_client_refresh_remote (FwupdClient *client,
 						   cancellable, error);
 }
 
+typedef struct {
+	GMainLoop	*loop;
+	SoupSession	*session;
+	guint		 pending;
+} FwupdClientRefreshHelper;
+
+typedef struct {
+	FwupdClientRefreshHelper *helper;
+	FwupdRemote	*remote;
+	GBytes		*signature;
+	GBytes		*metadata;
+	gboolean	 unchanged;
+	GError		*error;
+} FwupdClientRefreshItem;
+
+static void
+fwupd_client_refresh_item_free (FwupdClientRefreshItem *item)
+{
+	g_object_unref (item->remote);
+	if (item->signature != NULL)
+		g_bytes_unref (item->signature);
+	if (item->metadata != NULL)
+		g_bytes_unref (item->metadata);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+static void
+fwupd_client_refresh_item_done (FwupdClientRefreshItem *item)
+{
+	if (--item->helper->pending == 0)
+		g_main_loop_quit (item->helper->loop);
+}
+
+static GBytes *
+fwupd_client_refresh_item_get_bytes (FwupdClientRefreshItem *item,
+				     SoupMessage *msg,
+				     const gchar *url)
+{
+	g_autoptr(SoupBuffer) buf = NULL;
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code)) {
+		g_set_error (&item->error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Failed to download %s: %s",
+			     url, soup_status_get_phrase (msg->status_code));
+		return NULL;
+	}
+	buf = soup_message_body_flatten (msg->response_body);
+	return soup_buffer_get_as_bytes (buf);
+}
+
+static void
+fwupd_client_refresh_metadata_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FwupdClientRefreshItem *item = (FwupdClientRefreshItem *) user_data;
+	item->metadata = fwupd_client_refresh_item_get_bytes (item, msg,
+							      fwupd_remote_get_metadata_uri (item->remote));
+	fwupd_client_refresh_item_done (item);
+}
+
+static void
+fwupd_client_refresh_signature_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FwupdClientRefreshItem *item = (FwupdClientRefreshItem *) user_data;
+	const gchar *checksum_old = fwupd_remote_get_checksum (item->remote);
+	g_autofree gchar *checksum = NULL;
+
+	/* server says the signature has not changed since the last refresh */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_debug ("%s not modified", fwupd_remote_get_id (item->remote));
+		item->unchanged = TRUE;
+		fwupd_client_refresh_item_done (item);
+		return;
+	}
+	item->signature = fwupd_client_refresh_item_get_bytes (item, msg,
+							       fwupd_remote_get_metadata_uri_sig (item->remote));
+	if (item->signature == NULL) {
+		fwupd_client_refresh_item_done (item);
+		return;
+	}
+
+	/* the daemon uses the hash of the signature it has as the remote
+	 * checksum, and the signature includes the metadata checksum */
+	checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, item->signature);
+	if (g_strcmp0 (checksum, checksum_old) == 0) {
+		g_debug ("%s signature unchanged", fwupd_remote_get_id (item->remote));
+		item->unchanged = TRUE;
+	}
+	fwupd_client_refresh_item_done (item);
+}
+
+static void
+fwupd_client_refresh_queue (FwupdClient *client,
+			    FwupdClientRefreshItem *item,
+			    const gchar *url,
+			    gboolean conditional,
+			    SoupSessionCallback callback)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	SoupMessage *msg = soup_message_new (SOUP_METHOD_GET, url);
+
+	if (msg == NULL) {
+		g_set_error (&item->error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Failed to parse URI %s", url);
+		return;
+	}
+
+	/* only ask for the file if newer than the metadata the daemon has */
+	if (conditional && fwupd_remote_get_checksum (item->remote) != NULL) {
+		guint64 age = fwupd_remote_get_age (item->remote);
+		guint64 now = (guint64) g_get_real_time () / G_USEC_PER_SEC;
+		if (age < now) {
+			g_autoptr(SoupDate) date = soup_date_new_from_time_t ((time_t) (now - age));
+			g_autofree gchar *date_str = soup_date_to_string (date, SOUP_DATE_HTTP);
+			soup_message_headers_append (msg->request_headers,
+						     "If-Modified-Since", date_str);
+		}
+	}
+	item->helper->pending++;
+	soup_session_queue_message (priv->soup_session, msg, callback, item);
+}
+
+static void
+fwupd_client_refresh_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	FwupdClientRefreshHelper *helper = (FwupdClientRefreshHelper *) user_data;
+	soup_session_abort (helper->session);
+}
+
+/* cancelled messages still call back, so the loop always finishes */
+static void
+fwupd_client_refresh_run (FwupdClientRefreshHelper *helper, GCancellable *cancellable)
+{
+	gulong cancellable_id = 0;
+	if (helper->pending == 0)
+		return;
+	if (cancellable != NULL) {
+		cancellable_id = g_cancellable_connect (cancellable,
+							G_CALLBACK (fwupd_client_refresh_cancelled_cb),
+							helper, NULL);
+	}
+	g_main_loop_run (helper->loop);
+	if (cancellable_id != 0)
+		g_cancellable_disconnect (cancellable, cancellable_id);
+}
+
+static gboolean
+fwupd_client_update_metadata_batch (FwupdClient *client,
+				    GPtrArray *items,
+				    GCancellable *cancellable,
+				    GError **error)
+{
+#ifdef HAVE_GIO_UNIX
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GVariantBuilder builder;
+	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GDBusMessage) request = NULL;
+	g_autoptr(GPtrArray) istrs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return FALSE;
+
+	/* each remote has the metadata and then the signature */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(shh)"));
+	for (guint i = 0; i < items->len; i++) {
+		FwupdClientRefreshItem *item = g_ptr_array_index (items, i);
+		GUnixInputStream *istr;
+		GUnixInputStream *istr_sig;
+		gint idx;
+		gint idx_sig;
+
+		istr = fwupd_unix_input_stream_from_bytes (item->metadata, error);
+		if (istr == NULL) {
+			g_variant_builder_clear (&builder);
+			return FALSE;
+		}
+		g_ptr_array_add (istrs, istr);
+		istr_sig = fwupd_unix_input_stream_from_bytes (item->signature, error);
+		if (istr_sig == NULL) {
+			g_variant_builder_clear (&builder);
+			return FALSE;
+		}
+		g_ptr_array_add (istrs, istr_sig);
+		idx = g_unix_fd_list_append (fd_list, g_unix_input_stream_get_fd (istr), error);
+		if (idx < 0) {
+			g_variant_builder_clear (&builder);
+			return FALSE;
+		}
+		idx_sig = g_unix_fd_list_append (fd_list, g_unix_input_stream_get_fd (istr_sig), error);
+		if (idx_sig < 0) {
+			g_variant_builder_clear (&builder);
+			return FALSE;
+		}
+		g_variant_builder_add (&builder, "(shh)",
+				       fwupd_remote_get_id (item->remote),
+				       idx, idx_sig);
+	}
+	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
+						  FWUPD_DBUS_PATH,
+						  FWUPD_DBUS_INTERFACE,
+						  "UpdateMetadataBatch");
+	g_dbus_message_set_unix_fd_list (request, fd_list);
+	g_dbus_message_set_body (request, g_variant_new ("(a(shh))", &builder));
+
+	/* call into daemon */
+	helper = fwupd_client_helper_new ();
+	g_dbus_connection_send_message_with_reply (priv->conn,
+						   request,
+						   G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+						   -1,
+						   NULL,
+						   cancellable,
+						   fwupd_client_send_message_cb,
+						   helper);
+	g_main_loop_run (helper->loop);
+	if (!helper->ret) {
+		g_propagate_error (error, helper->error);
+		helper->error = NULL;
+		return FALSE;
+	}
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as <glib-unix.h> is unavailable");
+	return FALSE;
+#endif
+}
+
+/**
+ * fwupd_client_refresh_remotes:
+ * @client: A #FwupdClient
+ * @remotes: (element-type FwupdRemote): remotes to refresh
+ * @flags: #FwupdClientDownloadFlags, e.g. %FWUPD_CLIENT_DOWNLOAD_FLAG_ONLY_IF_CHANGED
+ * @cancellable: A #GCancellable, or %NULL
+ * @error: A #GError, or %NULL
+ *
+ * Refreshes several remotes, downloading the signatures and then the
+ * metadata for all the remotes at the same time. The new metadata is sent
+ * to the daemon in one request so that it is only loaded once.
+ *
+ * If %FWUPD_CLIENT_DOWNLOAD_FLAG_ONLY_IF_CHANGED is set then remotes where
+ * the server reports the signature is not modified, or where the signature
+ * is identical to the one the daemon already has, are skipped.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fwupd_client_refresh_remotes (FwupdClient *client,
+			      GPtrArray *remotes,
+			      FwupdClientDownloadFlags flags,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	FwupdClientRefreshHelper helper = { 0 };
+	gboolean conditional = (flags & FWUPD_CLIENT_DOWNLOAD_FLAG_ONLY_IF_CHANGED) > 0;
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GPtrArray) items_changed = g_ptr_array_new ();
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (remotes != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* ensure networking set up */
+	if (!fwupd_client_ensure_networking (client, error))
+		return FALSE;
+
+	/* the soup callbacks are dispatched from our own context */
+	helper.loop = loop;
+	helper.session = GET_PRIVATE (client)->soup_session;
+	g_main_context_push_thread_default (context);
+
+	/* download all the signatures at the same time */
+	fwupd_client_set_status (client, FWUPD_STATUS_DOWNLOADING);
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_refresh_item_free);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		FwupdClientRefreshItem *item = g_new0 (FwupdClientRefreshItem, 1);
+		item->helper = &helper;
+		item->remote = g_object_ref (remote);
+		g_ptr_array_add (items, item);
+		fwupd_client_refresh_queue (client, item,
+					    fwupd_remote_get_metadata_uri_sig (remote),
+					    conditional,
+					    fwupd_client_refresh_signature_cb);
+	}
+	fwupd_client_refresh_run (&helper, cancellable);
+
+	/* then all the metadata that changed */
+	for (guint i = 0; i < items->len; i++) {
+		FwupdClientRefreshItem *item = g_ptr_array_index (items, i);
+		if (item->error != NULL || (conditional && item->unchanged))
+			continue;
+		if (!fwupd_remote_load_signature_bytes (item->remote, item->signature, &item->error))
+			continue;
+		fwupd_client_refresh_queue (client, item,
+					    fwupd_remote_get_metadata_uri (item->remote),
+					    FALSE,
+					    fwupd_client_refresh_metadata_cb);
+	}
+	fwupd_client_refresh_run (&helper, cancellable);
+	g_main_context_pop_thread_default (context);
+	fwupd_client_set_status (client, FWUPD_STATUS_IDLE);
+
+	/* any failure is fatal, as with fwupd_client_refresh_remote() */
+	for (guint i = 0; i < items->len; i++) {
+		FwupdClientRefreshItem *item = g_ptr_array_index (items, i);
+		if (item->error != NULL) {
+			g_propagate_prefixed_error (error, g_steal_pointer (&item->error),
+						    "%s: ", fwupd_remote_get_id (item->remote));
+			return FALSE;
+		}
+		if (item->metadata != NULL)
+			g_ptr_array_add (items_changed, item);
+	}
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return FALSE;
+	if (items_changed->len == 0)
+		return TRUE;
+
+	/* send all this to fwupd */
+	if (!fwupd_client_daemon_version_at_least (client, 1, 5)) {
+		for (guint i = 0; i < items_changed->len; i++) {
+			FwupdClientRefreshItem *item = g_ptr_array_index (items_changed, i);
+			if (!fwupd_client_update_metadata_bytes (client,
+								 fwupd_remote_get_id (item->remote),
+								 item->metadata,
+								 item->signature,
+								 cancellable, error))
+				return FALSE;
+		}
+		return TRUE;
+	}
+	return fwupd_client_update_metadata_batch (client, items_changed, cancellable, error);
+}
+
 /**
  * fwupd_client_get_remotes:
  * @client: A #FwupdClient
@@ -2023,6 +3788,53 @@ fwupd_client_get_remotes (FwupdClient *client, GCancellable *cancellable, GError
 	return fwupd_remote_array_from_variant (val);
 }
 
+/**
+ * fwupd_client_get_remotes_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets the list of configured remotes without blocking.
+ *
+ * Several requests can be in flight at the same time and may complete
+ * in any order.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_remotes_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer callback_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_array_async (client, "GetRemotes", NULL,
+				       FWUPD_CLIENT_ARRAY_KIND_REMOTES,
+				       cancellable, callback, callback_data);
+}
+
+/**
+ * fwupd_client_get_remotes_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_remotes_async().
+ *
+ * Returns: (element-type FwupdRemote) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_remotes_finish (FwupdClient *client,
+				 GAsyncResult *res,
+				 GError **error)
+{
+	return fwupd_client_call_array_finish (client, res, error);
+}
+
 /**
  * fwupd_client_get_approved_firmware:
  * @client: A #FwupdClient
@@ -2162,6 +3974,7 @@ fwupd_client_set_feature_flags (FwupdClient *client,
 			fwupd_client_fixup_dbus_error (*error);
 		return FALSE;
 	}
+	priv->feature_flags = feature_flags;
 	return TRUE;
 }
 
@@ -2934,6 +4747,8 @@ fwupd_client_finalize (GObject *object)
 		g_object_unref (priv->proxy);
 	if (priv->soup_session != NULL)
 		g_object_unref (priv->soup_session);
+	if (priv->device_cache != NULL)
+		g_ptr_array_unref (priv->device_cache);
 
 	G_OBJECT_CLASS (fwupd_client_parent_class)->finalize (object);
 }
@@ -43,11 +43,13 @@ struct _FwupdClientClass
 /**
  * FwupdClientDownloadFlags:
  * @FWUPD_CLIENT_DOWNLOAD_FLAG_NONE:		No flags set
+ * @FWUPD_CLIENT_DOWNLOAD_FLAG_ONLY_IF_CHANGED:	Only download if newer than the cached copy
  *
  * The options to use for downloading.
  **/
 typedef enum {
 	FWUPD_CLIENT_DOWNLOAD_FLAG_NONE			= 0,		/* Since: 1.4.5 */
+	FWUPD_CLIENT_DOWNLOAD_FLAG_ONLY_IF_CHANGED	= 1 << 0,	/* Since: 1.5.0 */
 	/*< private >*/
 	FWUPD_CLIENT_DOWNLOAD_FLAG_LAST
 } FwupdClientDownloadFlags;
@@ -70,24 +72,87 @@ FwupdClient	*fwupd_client_new			(void);
 gboolean	 fwupd_client_connect			(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fwupd_client_set_device_cache		(FwupdClient	*client,
+							 gboolean	 enabled);
 GPtrArray	*fwupd_client_get_devices		(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fwupd_client_get_devices_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_devices_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+GPtrArray	*fwupd_client_get_devices_filtered	(FwupdClient	*client,
+							 FwupdDeviceFlags include_flags,
+							 FwupdDeviceFlags exclude_flags,
+							 const gchar	*plugin,
+							 const gchar	*guid,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_history		(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GPtrArray	*fwupd_client_get_history_range		(FwupdClient	*client,
+							 guint		 limit,
+							 guint		 offset,
+							 GCancellable	*cancellable,
+							 GError		**error);
+void		 fwupd_client_get_history_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_history_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_releases		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fwupd_client_get_releases_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_releases_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+GPtrArray	*fwupd_client_get_releases_filtered	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 const gchar	**keys,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_downgrades		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fwupd_client_get_downgrades_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_downgrades_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_upgrades		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fwupd_client_get_upgrades_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_upgrades_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+GHashTable	*fwupd_client_get_upgrades_all		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GError		**error);
+GHashTable	*fwupd_client_get_releases_all		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_details		(FwupdClient	*client,
 							 const gchar	*filename,
 							 GCancellable	*cancellable,
@@ -124,6 +189,15 @@ FwupdDevice	*fwupd_client_get_results		(FwupdClient	*client,
 GPtrArray	*fwupd_client_get_host_security_attrs	(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+gchar		*fwupd_client_get_traces		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GError		**error);
+gchar		*fwupd_client_get_metrics		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GError		**error);
+GPtrArray	*fwupd_client_get_plugin_stats		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GError		**error);
 FwupdDevice	*fwupd_client_get_device_by_id		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
@@ -166,6 +240,11 @@ gboolean	 fwupd_client_refresh_remote		(FwupdClient	*client,
 							 FwupdRemote	*remote,
 							 GCancellable	*cancellable,
 							 GError		**error);
+gboolean	 fwupd_client_refresh_remotes		(FwupdClient	*client,
+							 GPtrArray	*remotes,
+							 FwupdClientDownloadFlags flags,
+							 GCancellable	*cancellable,
+							 GError		**error);
 gboolean	 fwupd_client_modify_remote		(FwupdClient	*client,
 							 const gchar	*remote_id,
 							 const gchar	*key,
@@ -193,6 +272,13 @@ const gchar	*fwupd_client_get_host_security_id	(FwupdClient	*client);
 GPtrArray	*fwupd_client_get_remotes		(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+void		 fwupd_client_get_remotes_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_remotes_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
 FwupdRemote	*fwupd_client_get_remote_by_id		(FwupdClient	*client,
 							 const gchar	*remote_id,
 							 GCancellable	*cancellable,
@@ -20,8 +20,16 @@ gchar		*fwupd_checksum_format_for_display	(const gchar	*checksum);
 GVariant	*fwupd_hash_kv_to_variant		(GHashTable	*hash);
 GHashTable	*fwupd_variant_to_hash_kv		(GVariant	*dict);
 gchar		*fwupd_build_user_agent_system		(void);
+guint16		 fwupd_result_key_to_compact		(const gchar	*key);
+const gchar	*fwupd_result_key_from_compact		(guint16	 idx);
+void		 fwupd_variant_builder_add_kv		(GVariantBuilder *builder,
+							 gboolean	 compact,
+							 const gchar	*key,
+							 GVariant	*value);
 
 #ifdef HAVE_GIO_UNIX
+gboolean	 fwupd_unix_fd_seal			(gint		 fd,
+							 GError		**error);
 GUnixInputStream *fwupd_unix_input_stream_from_bytes	(GBytes		*bytes,
 							 GError		**error);
 GUnixInputStream *fwupd_unix_input_stream_from_fn	(const gchar	*fn,
@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include "fwupd-common-private.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-device.h"
 #include "fwupd-error.h"
 #include "fwupd-release.h"
@@ -941,7 +942,134 @@ fwupd_variant_to_hash_kv (GVariant *dict)
 	return hash;
 }
 
+/* the position is the compact key, so only ever append to this list */
+static const gchar *fwupd_result_keys_compact[] = {
+	FWUPD_RESULT_KEY_APPSTREAM_ID,
+	FWUPD_RESULT_KEY_CHECKSUM,
+	FWUPD_RESULT_KEY_CREATED,
+	FWUPD_RESULT_KEY_DESCRIPTION,
+	FWUPD_RESULT_KEY_DETACH_CAPTION,
+	FWUPD_RESULT_KEY_DETACH_IMAGE,
+	FWUPD_RESULT_KEY_DEVICE_ID,
+	FWUPD_RESULT_KEY_PARENT_DEVICE_ID,
+	FWUPD_RESULT_KEY_FILENAME,
+	FWUPD_RESULT_KEY_PROTOCOL,
+	FWUPD_RESULT_KEY_CATEGORIES,
+	FWUPD_RESULT_KEY_ISSUES,
+	FWUPD_RESULT_KEY_FLAGS,
+	FWUPD_RESULT_KEY_FLASHES_LEFT,
+	FWUPD_RESULT_KEY_URGENCY,
+	FWUPD_RESULT_KEY_HSI_LEVEL,
+	FWUPD_RESULT_KEY_HSI_RESULT,
+	FWUPD_RESULT_KEY_INSTALL_DURATION,
+	FWUPD_RESULT_KEY_GUID,
+	FWUPD_RESULT_KEY_INSTANCE_IDS,
+	FWUPD_RESULT_KEY_HOMEPAGE,
+	FWUPD_RESULT_KEY_DETAILS_URL,
+	FWUPD_RESULT_KEY_SOURCE_URL,
+	FWUPD_RESULT_KEY_ICON,
+	FWUPD_RESULT_KEY_LICENSE,
+	FWUPD_RESULT_KEY_MODIFIED,
+	FWUPD_RESULT_KEY_METADATA,
+	FWUPD_RESULT_KEY_NAME,
+	FWUPD_RESULT_KEY_NAME_VARIANT_SUFFIX,
+	FWUPD_RESULT_KEY_PLUGIN,
+	FWUPD_RESULT_KEY_RELEASE,
+	FWUPD_RESULT_KEY_REMOTE_ID,
+	FWUPD_RESULT_KEY_SERIAL,
+	FWUPD_RESULT_KEY_SIZE,
+	FWUPD_RESULT_KEY_STATUS,
+	FWUPD_RESULT_KEY_SUMMARY,
+	FWUPD_RESULT_KEY_TRUST_FLAGS,
+	FWUPD_RESULT_KEY_UPDATE_MESSAGE,
+	FWUPD_RESULT_KEY_UPDATE_IMAGE,
+	FWUPD_RESULT_KEY_UPDATE_ERROR,
+	FWUPD_RESULT_KEY_UPDATE_STATE,
+	FWUPD_RESULT_KEY_URI,
+	FWUPD_RESULT_KEY_VENDOR_ID,
+	FWUPD_RESULT_KEY_VENDOR,
+	FWUPD_RESULT_KEY_VERSION_BOOTLOADER,
+	FWUPD_RESULT_KEY_VERSION_BOOTLOADER_RAW,
+	FWUPD_RESULT_KEY_VERSION_FORMAT,
+	FWUPD_RESULT_KEY_VERSION_RAW,
+	FWUPD_RESULT_KEY_VERSION_LOWEST,
+	FWUPD_RESULT_KEY_VERSION_LOWEST_RAW,
+	FWUPD_RESULT_KEY_VERSION,
+	NULL
+};
+
+/**
+ * fwupd_result_key_to_compact: (skip):
+ **/
+guint16
+fwupd_result_key_to_compact (const gchar *key)
+{
+	static gsize once = 0;
+	static GHashTable *hash = NULL;
+	if (g_once_init_enter (&once)) {
+		hash = g_hash_table_new (g_str_hash, g_str_equal);
+		for (guint i = 0; fwupd_result_keys_compact[i] != NULL; i++) {
+			g_hash_table_insert (hash,
+					     (gpointer) fwupd_result_keys_compact[i],
+					     GUINT_TO_POINTER (i + 1));
+		}
+		g_once_init_leave (&once, 1);
+	}
+	return GPOINTER_TO_UINT (g_hash_table_lookup (hash, key)) - 1;
+}
+
+/**
+ * fwupd_result_key_from_compact: (skip):
+ **/
+const gchar *
+fwupd_result_key_from_compact (guint16 idx)
+{
+	if (idx >= G_N_ELEMENTS (fwupd_result_keys_compact) - 1)
+		return NULL;
+	return fwupd_result_keys_compact[idx];
+}
+
+/**
+ * fwupd_variant_builder_add_kv: (skip):
+ **/
+void
+fwupd_variant_builder_add_kv (GVariantBuilder *builder,
+			      gboolean compact,
+			      const gchar *key,
+			      GVariant *value)
+{
+	if (compact) {
+		g_variant_builder_add (builder, "{qv}",
+				       fwupd_result_key_to_compact (key),
+				       value);
+		return;
+	}
+	g_variant_builder_add (builder, "{sv}", key, value);
+}
+
 #ifdef HAVE_GIO_UNIX
+/**
+ * fwupd_unix_fd_seal: (skip):
+ *
+ * Seals a memfd so that the daemon can map it rather than copying it, as
+ * the contents can no longer be changed after the checks have been done.
+ **/
+gboolean
+fwupd_unix_fd_seal (gint fd, GError **error)
+{
+#ifdef F_ADD_SEALS
+	if (fcntl (fd, F_ADD_SEALS,
+		   F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to seal: %s", g_strerror (errno));
+		return FALSE;
+	}
+#endif
+	return TRUE;
+}
+
 /**
  * fwupd_unix_input_stream_from_bytes: (skip):
  **/
@@ -951,7 +1079,7 @@ fwupd_unix_input_stream_from_bytes (GBytes *bytes, GError **error)
 	gint fd;
 	gssize rc;
 
-	fd = memfd_create ("fwupd", MFD_CLOEXEC);
+	fd = memfd_create ("fwupd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
 	if (fd < 0) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
@@ -965,6 +1093,11 @@ fwupd_unix_input_stream_from_bytes (GBytes *bytes, GError **error)
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "failed to write %" G_GSSIZE_FORMAT, rc);
+		close (fd);
+		return NULL;
+	}
+	if (!fwupd_unix_fd_seal (fd, error)) {
+		close (fd);
 		return NULL;
 	}
 	if (lseek (fd, 0, SEEK_SET) < 0) {
@@ -33,18 +33,18 @@ typedef struct {
 	guint64				 created;
 	guint64				 modified;
 	guint64				 flags;
-	GPtrArray			*guids;
+	GPtrArray			*guids;		/* interned */
 	GPtrArray			*instance_ids;
-	GPtrArray			*icons;
+	GPtrArray			*icons;		/* interned */
 	gchar				*name;
 	gchar				*serial;
 	gchar				*summary;
 	gchar				*description;
 	gchar				*vendor;
-	gchar				*vendor_id;
+	const gchar			*vendor_id;	/* interned */
 	gchar				*homepage;
-	gchar				*plugin;
-	gchar				*protocol;
+	const gchar			*plugin;	/* interned */
+	const gchar			*protocol;	/* interned */
 	gchar				*version;
 	gchar				*version_lowest;
 	gchar				*version_bootloader;
@@ -377,7 +377,7 @@ fwupd_device_add_guid (FwupdDevice *device, const gchar *guid)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	if (fwupd_device_has_guid (device, guid))
 		return;
-	g_ptr_array_add (priv->guids, g_strdup (guid));
+	g_ptr_array_add (priv->guids, (gpointer) g_intern_string (guid));
 }
 
 /**
@@ -512,7 +512,7 @@ fwupd_device_add_icon (FwupdDevice *device, const gchar *icon)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	if (fwupd_device_has_icon (device, icon))
 		return;
-	g_ptr_array_add (priv->icons, g_strdup (icon));
+	g_ptr_array_add (priv->icons, (gpointer) g_intern_string (icon));
 }
 
 /**
@@ -619,8 +619,7 @@ fwupd_device_set_vendor_id (FwupdDevice *device, const gchar *vendor_id)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->vendor_id);
-	priv->vendor_id = g_strdup (vendor_id);
+	priv->vendor_id = g_intern_string (vendor_id);
 }
 
 /**
@@ -939,8 +938,7 @@ fwupd_device_set_plugin (FwupdDevice *device, const gchar *plugin)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->plugin);
-	priv->plugin = g_strdup (plugin);
+	priv->plugin = g_intern_string (plugin);
 }
 
 /**
@@ -975,8 +973,7 @@ fwupd_device_set_protocol (FwupdDevice *device, const gchar *protocol)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->protocol);
-	priv->protocol = g_strdup (protocol);
+	priv->protocol = g_intern_string (protocol);
 }
 
 /**
@@ -1240,20 +1237,10 @@ fwupd_device_incorporate (FwupdDevice *self, FwupdDevice *donor)
 	}
 }
 
-/**
- * fwupd_device_to_variant_full:
- * @device: A #FwupdDevice
- * @flags: #FwupdDeviceFlags for the call
- *
- * Creates a GVariant from the device data.
- * Optionally provides additional data based upon flags
- *
- * Returns: the GVariant, or %NULL for error
- *
- * Since: 1.1.2
- **/
-GVariant *
-fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
+static GVariant *
+fwupd_device_to_variant_internal (FwupdDevice *device,
+				  FwupdDeviceFlags flags,
+				  gboolean compact)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	GVariantBuilder builder;
@@ -1261,69 +1248,69 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
 
 	/* create an array with all the metadata in */
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_init (&builder, compact ? G_VARIANT_TYPE ("a{qv}") : G_VARIANT_TYPE_VARDICT);
 	if (priv->id != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_DEVICE_ID,
-				       g_variant_new_string (priv->id));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_DEVICE_ID,
+					      g_variant_new_string (priv->id));
 	}
 	if (priv->parent_id != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_PARENT_DEVICE_ID,
-				       g_variant_new_string (priv->parent_id));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_PARENT_DEVICE_ID,
+					      g_variant_new_string (priv->parent_id));
 	}
 	if (priv->guids->len > 0) {
 		const gchar * const *tmp = (const gchar * const *) priv->guids->pdata;
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_GUID,
-				       g_variant_new_strv (tmp, priv->guids->len));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_GUID,
+					      g_variant_new_strv (tmp, priv->guids->len));
 	}
 	if (priv->icons->len > 0) {
 		const gchar * const *tmp = (const gchar * const *) priv->icons->pdata;
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_ICON,
-				       g_variant_new_strv (tmp, priv->icons->len));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_ICON,
+					      g_variant_new_strv (tmp, priv->icons->len));
 	}
 	if (priv->name != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_NAME,
-				       g_variant_new_string (priv->name));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_NAME,
+					      g_variant_new_string (priv->name));
 	}
 	if (priv->vendor != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VENDOR,
-				       g_variant_new_string (priv->vendor));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VENDOR,
+					      g_variant_new_string (priv->vendor));
 	}
 	if (priv->vendor_id != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VENDOR_ID,
-				       g_variant_new_string (priv->vendor_id));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VENDOR_ID,
+					      g_variant_new_string (priv->vendor_id));
 	}
 	if (priv->flags > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_FLAGS,
-				       g_variant_new_uint64 (priv->flags));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_FLAGS,
+					      g_variant_new_uint64 (priv->flags));
 	}
 	if (priv->created > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_CREATED,
-				       g_variant_new_uint64 (priv->created));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_CREATED,
+					      g_variant_new_uint64 (priv->created));
 	}
 	if (priv->modified > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_MODIFIED,
-				       g_variant_new_uint64 (priv->modified));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_MODIFIED,
+					      g_variant_new_uint64 (priv->modified));
 	}
 
 	if (priv->description != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_DESCRIPTION,
-				       g_variant_new_string (priv->description));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_DESCRIPTION,
+					      g_variant_new_string (priv->description));
 	}
 	if (priv->summary != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_SUMMARY,
-				       g_variant_new_string (priv->summary));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_SUMMARY,
+					      g_variant_new_string (priv->summary));
 	}
 	if (priv->checksums->len > 0) {
 		g_autoptr(GString) str = g_string_new ("");
@@ -1333,101 +1320,101 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 		}
 		if (str->len > 0)
 			g_string_truncate (str, str->len - 1);
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_CHECKSUM,
-				       g_variant_new_string (str->str));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_CHECKSUM,
+					      g_variant_new_string (str->str));
 	}
 	if (priv->plugin != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_PLUGIN,
-				       g_variant_new_string (priv->plugin));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_PLUGIN,
+					      g_variant_new_string (priv->plugin));
 	}
 	if (priv->protocol != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_PROTOCOL,
-				       g_variant_new_string (priv->protocol));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_PROTOCOL,
+					      g_variant_new_string (priv->protocol));
 	}
 	if (priv->version != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION,
-				       g_variant_new_string (priv->version));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION,
+					      g_variant_new_string (priv->version));
 	}
 	if (priv->version_lowest != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION_LOWEST,
-				       g_variant_new_string (priv->version_lowest));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION_LOWEST,
+					      g_variant_new_string (priv->version_lowest));
 	}
 	if (priv->version_bootloader != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION_BOOTLOADER,
-				       g_variant_new_string (priv->version_bootloader));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION_BOOTLOADER,
+					      g_variant_new_string (priv->version_bootloader));
 	}
 	if (priv->version_raw > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION_RAW,
-				       g_variant_new_uint64 (priv->version_raw));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION_RAW,
+					      g_variant_new_uint64 (priv->version_raw));
 	}
 	if (priv->version_lowest_raw > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION_LOWEST_RAW,
-				       g_variant_new_uint64 (priv->version_raw));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION_LOWEST_RAW,
+					      g_variant_new_uint64 (priv->version_raw));
 	}
 	if (priv->version_bootloader_raw > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION_BOOTLOADER_RAW,
-				       g_variant_new_uint64 (priv->version_raw));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION_BOOTLOADER_RAW,
+					      g_variant_new_uint64 (priv->version_raw));
 	}
 	if (priv->flashes_left > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_FLASHES_LEFT,
-				       g_variant_new_uint32 (priv->flashes_left));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_FLASHES_LEFT,
+					      g_variant_new_uint32 (priv->flashes_left));
 	}
 	if (priv->install_duration > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_INSTALL_DURATION,
-				       g_variant_new_uint32 (priv->install_duration));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_INSTALL_DURATION,
+					      g_variant_new_uint32 (priv->install_duration));
 	}
 	if (priv->update_error != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_UPDATE_ERROR,
-				       g_variant_new_string (priv->update_error));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_UPDATE_ERROR,
+					      g_variant_new_string (priv->update_error));
 	}
 	if (priv->update_message != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_UPDATE_MESSAGE,
-				       g_variant_new_string (priv->update_message));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_UPDATE_MESSAGE,
+					      g_variant_new_string (priv->update_message));
 	}
 	if (priv->update_image != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_UPDATE_IMAGE,
-				       g_variant_new_string (priv->update_image));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_UPDATE_IMAGE,
+					      g_variant_new_string (priv->update_image));
 	}
 	if (priv->update_state != FWUPD_UPDATE_STATE_UNKNOWN) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_UPDATE_STATE,
-				       g_variant_new_uint32 (priv->update_state));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_UPDATE_STATE,
+					      g_variant_new_uint32 (priv->update_state));
 	}
 	if (priv->status != FWUPD_STATUS_UNKNOWN) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_STATUS,
-				       g_variant_new_uint32 (priv->status));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_STATUS,
+					      g_variant_new_uint32 (priv->status));
 	}
 	if (priv->version_format != FWUPD_VERSION_FORMAT_UNKNOWN) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION_FORMAT,
-				       g_variant_new_uint32 (priv->version_format));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION_FORMAT,
+					      g_variant_new_uint32 (priv->version_format));
 	}
 	if (flags & FWUPD_DEVICE_FLAG_TRUSTED) {
 		if (priv->serial != NULL) {
-			g_variant_builder_add (&builder, "{sv}",
-					       FWUPD_RESULT_KEY_SERIAL,
-					       g_variant_new_string (priv->serial));
+			fwupd_variant_builder_add_kv (&builder, compact,
+						      FWUPD_RESULT_KEY_SERIAL,
+						      g_variant_new_string (priv->serial));
 		}
 		if (priv->instance_ids->len > 0) {
 			const gchar * const *tmp = (const gchar * const *) priv->instance_ids->pdata;
-			g_variant_builder_add (&builder, "{sv}",
-					       FWUPD_RESULT_KEY_INSTANCE_IDS,
-					       g_variant_new_strv (tmp, priv->instance_ids->len));
+			fwupd_variant_builder_add_kv (&builder, compact,
+						      FWUPD_RESULT_KEY_INSTANCE_IDS,
+						      g_variant_new_strv (tmp, priv->instance_ids->len));
 		}
 	}
 
@@ -1437,15 +1424,53 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 		children = g_new0 (GVariant *, priv->releases->len);
 		for (guint i = 0; i < priv->releases->len; i++) {
 			FwupdRelease *release = g_ptr_array_index (priv->releases, i);
-			children[i] = fwupd_release_to_variant (release);
+			children[i] = compact ? fwupd_release_to_variant_compact (release) :
+						fwupd_release_to_variant (release);
 		}
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_RELEASE,
-				       g_variant_new_array (G_VARIANT_TYPE ("a{sv}"),
-							    children,
-							    priv->releases->len));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_RELEASE,
+					      g_variant_new_array (compact ? G_VARIANT_TYPE ("a{qv}") :
+									     G_VARIANT_TYPE_VARDICT,
+								   children,
+								   priv->releases->len));
 	}
-	return g_variant_new ("a{sv}", &builder);
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * fwupd_device_to_variant_full:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ *
+ * Creates a GVariant from the device data.
+ * Optionally provides additional data based upon flags
+ *
+ * Returns: the GVariant, or %NULL for error
+ *
+ * Since: 1.1.2
+ **/
+GVariant *
+fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
+{
+	return fwupd_device_to_variant_internal (device, flags, FALSE);
+}
+
+/**
+ * fwupd_device_to_variant_compact:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ *
+ * Creates a GVariant from the device data like fwupd_device_to_variant_full(),
+ * but using integer keys rather than strings to make the data smaller.
+ *
+ * Returns: the GVariant, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fwupd_device_to_variant_compact (FwupdDevice *device, FwupdDeviceFlags flags)
+{
+	return fwupd_device_to_variant_internal (device, flags, TRUE);
 }
 
 /**
@@ -2322,9 +2347,9 @@ static void
 fwupd_device_init (FwupdDevice *device)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
-	priv->guids = g_ptr_array_new_with_free_func (g_free);
+	priv->guids = g_ptr_array_new ();
 	priv->instance_ids = g_ptr_array_new_with_free_func (g_free);
-	priv->icons = g_ptr_array_new_with_free_func (g_free);
+	priv->icons = g_ptr_array_new ();
 	priv->checksums = g_ptr_array_new_with_free_func (g_free);
 	priv->children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -2345,9 +2370,6 @@ fwupd_device_finalize (GObject *object)
 	g_free (priv->serial);
 	g_free (priv->summary);
 	g_free (priv->vendor);
-	g_free (priv->vendor_id);
-	g_free (priv->plugin);
-	g_free (priv->protocol);
 	g_free (priv->update_error);
 	g_free (priv->update_message);
 	g_free (priv->update_image);
@@ -2375,6 +2397,19 @@ fwupd_device_set_from_variant_iter (FwupdDevice *device, GVariantIter *iter)
 	}
 }
 
+static void
+fwupd_device_set_from_variant_iter_compact (FwupdDevice *device, GVariantIter *iter)
+{
+	GVariant *value;
+	guint16 idx;
+	while (g_variant_iter_next (iter, "{qv}", &idx, &value)) {
+		const gchar *key = fwupd_result_key_from_compact (idx);
+		if (key != NULL)
+			fwupd_device_from_key_value (device, key, value);
+		g_variant_unref (value);
+	}
+}
+
 /**
  * fwupd_device_from_variant:
  * @value: a #GVariant
@@ -2402,6 +2437,10 @@ fwupd_device_from_variant (GVariant *value)
 		dev = fwupd_device_new ();
 		g_variant_get (value, "a{sv}", &iter);
 		fwupd_device_set_from_variant_iter (dev, iter);
+	} else if (g_strcmp0 (type_string, "a{qv}") == 0) {
+		dev = fwupd_device_new ();
+		g_variant_get (value, "a{qv}", &iter);
+		fwupd_device_set_from_variant_iter_compact (dev, iter);
 	} else {
 		g_warning ("type %s not known", type_string);
 	}
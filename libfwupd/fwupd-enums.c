@@ -419,6 +419,12 @@ fwupd_feature_flag_to_string (FwupdFeatureFlags feature_flag)
 		return "detach-action";
 	if (feature_flag == FWUPD_FEATURE_FLAG_UPDATE_ACTION)
 		return "update-action";
+	if (feature_flag == FWUPD_FEATURE_FLAG_COMPACT_VARIANT)
+		return "compact-variant";
+	if (feature_flag == FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL)
+		return "device-changed-partial";
+	if (feature_flag == FWUPD_FEATURE_FLAG_FD_REPLY)
+		return "fd-reply";
 	return NULL;
 }
 
@@ -443,6 +449,12 @@ fwupd_feature_flag_from_string (const gchar *feature_flag)
 		return FWUPD_FEATURE_FLAG_DETACH_ACTION;
 	if (g_strcmp0 (feature_flag, "update-action") == 0)
 		return FWUPD_FEATURE_FLAG_UPDATE_ACTION;
+	if (g_strcmp0 (feature_flag, "compact-variant") == 0)
+		return FWUPD_FEATURE_FLAG_COMPACT_VARIANT;
+	if (g_strcmp0 (feature_flag, "device-changed-partial") == 0)
+		return FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL;
+	if (g_strcmp0 (feature_flag, "fd-reply") == 0)
+		return FWUPD_FEATURE_FLAG_FD_REPLY;
 	return FWUPD_FEATURE_FLAG_LAST;
 }
 
@@ -70,6 +70,9 @@ typedef enum {
  * @FWUPD_FEATURE_FLAG_CAN_REPORT:		Can upload a report of the update back to the server
  * @FWUPD_FEATURE_FLAG_DETACH_ACTION:		Can perform detach action, typically showing text
  * @FWUPD_FEATURE_FLAG_UPDATE_ACTION:		Can perform update action, typically showing text
+ * @FWUPD_FEATURE_FLAG_COMPACT_VARIANT:		Can parse devices that use integer keys
+ * @FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL:	Can apply device changes that only include the modified keys
+ * @FWUPD_FEATURE_FLAG_FD_REPLY:		Can receive large replies in a sealed memfd
  *
  * The flags to the feature capabilities of the front-end client.
  **/
@@ -78,6 +81,9 @@ typedef enum {
 	FWUPD_FEATURE_FLAG_CAN_REPORT		= 1 << 0,	/* Since: 1.4.5 */
 	FWUPD_FEATURE_FLAG_DETACH_ACTION	= 1 << 1,	/* Since: 1.4.5 */
 	FWUPD_FEATURE_FLAG_UPDATE_ACTION	= 1 << 2,	/* Since: 1.4.5 */
+	FWUPD_FEATURE_FLAG_COMPACT_VARIANT	= 1 << 3,	/* Since: 1.5.0 */
+	FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL = 1 << 4,	/* Since: 1.5.0 */
+	FWUPD_FEATURE_FLAG_FD_REPLY		= 1 << 5,	/* Since: 1.5.0 */
 	/*< private >*/
 	FWUPD_FEATURE_FLAG_LAST
 } FwupdFeatureFlags;
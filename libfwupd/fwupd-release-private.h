@@ -14,6 +14,7 @@
 G_BEGIN_DECLS
 
 GVariant	*fwupd_release_to_variant		(FwupdRelease	*release);
+GVariant	*fwupd_release_to_variant_compact	(FwupdRelease	*release);
 void		 fwupd_release_to_json			(FwupdRelease *release,
 							 JsonBuilder *builder);
 
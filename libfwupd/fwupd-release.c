@@ -1274,18 +1274,8 @@ fwupd_release_set_install_duration (FwupdRelease *release, guint32 duration)
 	priv->install_duration = duration;
 }
 
-/**
- * fwupd_release_to_variant:
- * @release: A #FwupdRelease
- *
- * Creates a GVariant from the release data.
- *
- * Returns: the GVariant, or %NULL for error
- *
- * Since: 1.0.0
- **/
-GVariant *
-fwupd_release_to_variant (FwupdRelease *release)
+static GVariant *
+fwupd_release_to_variant_internal (FwupdRelease *release, gboolean compact)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	GVariantBuilder builder;
@@ -1293,87 +1283,87 @@ fwupd_release_to_variant (FwupdRelease *release)
 	g_return_val_if_fail (FWUPD_IS_RELEASE (release), NULL);
 
 	/* create an array with all the metadata in */
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_init (&builder, compact ? G_VARIANT_TYPE ("a{qv}") : G_VARIANT_TYPE_VARDICT);
 	if (priv->remote_id != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_REMOTE_ID,
-				       g_variant_new_string (priv->remote_id));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_REMOTE_ID,
+					      g_variant_new_string (priv->remote_id));
 	}
 	if (priv->appstream_id != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_APPSTREAM_ID,
-				       g_variant_new_string (priv->appstream_id));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_APPSTREAM_ID,
+					      g_variant_new_string (priv->appstream_id));
 	}
 	if (priv->detach_caption != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_DETACH_CAPTION,
-				       g_variant_new_string (priv->detach_caption));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_DETACH_CAPTION,
+					      g_variant_new_string (priv->detach_caption));
 	}
 	if (priv->detach_image != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_DETACH_IMAGE,
-				       g_variant_new_string (priv->detach_image));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_DETACH_IMAGE,
+					      g_variant_new_string (priv->detach_image));
 	}
 	if (priv->filename != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_FILENAME,
-				       g_variant_new_string (priv->filename));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_FILENAME,
+					      g_variant_new_string (priv->filename));
 	}
 	if (priv->protocol != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_PROTOCOL,
-				       g_variant_new_string (priv->protocol));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_PROTOCOL,
+					      g_variant_new_string (priv->protocol));
 	}
 	if (priv->license != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_LICENSE,
-				       g_variant_new_string (priv->license));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_LICENSE,
+					      g_variant_new_string (priv->license));
 	}
 	if (priv->name != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_NAME,
-				       g_variant_new_string (priv->name));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_NAME,
+					      g_variant_new_string (priv->name));
 	}
 	if (priv->name_variant_suffix != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_NAME_VARIANT_SUFFIX,
-				       g_variant_new_string (priv->name_variant_suffix));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_NAME_VARIANT_SUFFIX,
+					      g_variant_new_string (priv->name_variant_suffix));
 	}
 	if (priv->size != 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_SIZE,
-				       g_variant_new_uint64 (priv->size));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_SIZE,
+					      g_variant_new_uint64 (priv->size));
 	}
 	if (priv->created != 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_CREATED,
-				       g_variant_new_uint64 (priv->created));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_CREATED,
+					      g_variant_new_uint64 (priv->created));
 	}
 	if (priv->summary != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_SUMMARY,
-				       g_variant_new_string (priv->summary));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_SUMMARY,
+					      g_variant_new_string (priv->summary));
 	}
 	if (priv->description != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_DESCRIPTION,
-				       g_variant_new_string (priv->description));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_DESCRIPTION,
+					      g_variant_new_string (priv->description));
 	}
 	if (priv->categories->len > 0) {
 		g_autofree const gchar **strv = g_new0 (const gchar *, priv->categories->len + 1);
 		for (guint i = 0; i < priv->categories->len; i++)
 			strv[i] = (const gchar *) g_ptr_array_index (priv->categories, i);
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_CATEGORIES,
-				       g_variant_new_strv (strv, -1));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_CATEGORIES,
+					      g_variant_new_strv (strv, -1));
 	}
 	if (priv->issues->len > 0) {
 		g_autofree const gchar **strv = g_new0 (const gchar *, priv->issues->len + 1);
 		for (guint i = 0; i < priv->issues->len; i++)
 			strv[i] = (const gchar *) g_ptr_array_index (priv->issues, i);
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_ISSUES,
-				       g_variant_new_strv (strv, -1));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_ISSUES,
+					      g_variant_new_strv (strv, -1));
 	}
 	if (priv->checksums->len > 0) {
 		g_autoptr(GString) str = g_string_new ("");
@@ -1383,61 +1373,94 @@ fwupd_release_to_variant (FwupdRelease *release)
 		}
 		if (str->len > 0)
 			g_string_truncate (str, str->len - 1);
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_CHECKSUM,
-				       g_variant_new_string (str->str));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_CHECKSUM,
+					      g_variant_new_string (str->str));
 	}
 	if (priv->uri != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_URI,
-				       g_variant_new_string (priv->uri));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_URI,
+					      g_variant_new_string (priv->uri));
 	}
 	if (priv->homepage != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_HOMEPAGE,
-				       g_variant_new_string (priv->homepage));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_HOMEPAGE,
+					      g_variant_new_string (priv->homepage));
 	}
 	if (priv->details_url != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_DETAILS_URL,
-				       g_variant_new_string (priv->details_url));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_DETAILS_URL,
+					      g_variant_new_string (priv->details_url));
 	}
 	if (priv->source_url != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_SOURCE_URL,
-				       g_variant_new_string (priv->source_url));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_SOURCE_URL,
+					      g_variant_new_string (priv->source_url));
 	}
 	if (priv->version != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VERSION,
-				       g_variant_new_string (priv->version));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VERSION,
+					      g_variant_new_string (priv->version));
 	}
 	if (priv->vendor != NULL) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_VENDOR,
-				       g_variant_new_string (priv->vendor));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_VENDOR,
+					      g_variant_new_string (priv->vendor));
 	}
 	if (priv->flags != 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_TRUST_FLAGS,
-				       g_variant_new_uint64 (priv->flags));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_TRUST_FLAGS,
+					      g_variant_new_uint64 (priv->flags));
 	}
 	if (priv->urgency != 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_URGENCY,
-				       g_variant_new_uint32 (priv->urgency));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_URGENCY,
+					      g_variant_new_uint32 (priv->urgency));
 	}
 	if (g_hash_table_size (priv->metadata) > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_METADATA,
-				       fwupd_hash_kv_to_variant (priv->metadata));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_METADATA,
+					      fwupd_hash_kv_to_variant (priv->metadata));
 	}
 	if (priv->install_duration > 0) {
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_INSTALL_DURATION,
-				       g_variant_new_uint32 (priv->install_duration));
+		fwupd_variant_builder_add_kv (&builder, compact,
+					      FWUPD_RESULT_KEY_INSTALL_DURATION,
+					      g_variant_new_uint32 (priv->install_duration));
 	}
-	return g_variant_new ("a{sv}", &builder);
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * fwupd_release_to_variant:
+ * @release: A #FwupdRelease
+ *
+ * Creates a GVariant from the release data.
+ *
+ * Returns: the GVariant, or %NULL for error
+ *
+ * Since: 1.0.0
+ **/
+GVariant *
+fwupd_release_to_variant (FwupdRelease *release)
+{
+	return fwupd_release_to_variant_internal (release, FALSE);
+}
+
+/**
+ * fwupd_release_to_variant_compact:
+ * @release: A #FwupdRelease
+ *
+ * Creates a GVariant from the release data using integer keys rather than
+ * strings to make the data smaller.
+ *
+ * Returns: the GVariant, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fwupd_release_to_variant_compact (FwupdRelease *release)
+{
+	return fwupd_release_to_variant_internal (release, TRUE);
 }
 
 static void
@@ -1872,6 +1895,19 @@ fwupd_release_set_from_variant_iter (FwupdRelease *release, GVariantIter *iter)
 	}
 }
 
+static void
+fwupd_release_set_from_variant_iter_compact (FwupdRelease *release, GVariantIter *iter)
+{
+	GVariant *value;
+	guint16 idx;
+	while (g_variant_iter_next (iter, "{qv}", &idx, &value)) {
+		const gchar *key = fwupd_result_key_from_compact (idx);
+		if (key != NULL)
+			fwupd_release_from_key_value (release, key, value);
+		g_variant_unref (value);
+	}
+}
+
 /**
  * fwupd_release_from_variant:
  * @value: a #GVariant
@@ -1899,6 +1935,10 @@ fwupd_release_from_variant (GVariant *value)
 		rel = fwupd_release_new ();
 		g_variant_get (value, "a{sv}", &iter);
 		fwupd_release_set_from_variant_iter (rel, iter);
+	} else if (g_strcmp0 (type_string, "a{qv}") == 0) {
+		rel = fwupd_release_new ();
+		g_variant_get (value, "a{qv}", &iter);
+		fwupd_release_set_from_variant_iter_compact (rel, iter);
 	} else {
 		g_warning ("type %s not known", type_string);
 	}
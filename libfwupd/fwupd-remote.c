@@ -33,6 +33,7 @@ typedef struct {
 	gchar			*firmware_base_uri;
 	gchar			*report_uri;
 	gchar			*security_report_uri;
+	gchar			*peer_cache_uri;
 	gchar			*metadata_uri;
 	gchar			*metadata_uri_sig;
 	gchar			*username;
@@ -262,6 +263,13 @@ fwupd_remote_set_security_report_uri (FwupdRemote *self, const gchar *security_r
 	priv->security_report_uri = g_strdup (security_report_uri);
 }
 
+static void
+fwupd_remote_set_peer_cache_uri (FwupdRemote *self, const gchar *peer_cache_uri)
+{
+	FwupdRemotePrivate *priv = GET_PRIVATE (self);
+	priv->peer_cache_uri = g_strdup (peer_cache_uri);
+}
+
 /**
  * fwupd_remote_kind_from_string:
  * @kind: a string, e.g. `download`
@@ -354,6 +362,7 @@ fwupd_remote_load_from_filename (FwupdRemote *self,
 	g_autofree gchar *order_before = NULL;
 	g_autofree gchar *report_uri = NULL;
 	g_autofree gchar *security_report_uri = NULL;
+	g_autofree gchar *peer_cache_uri = NULL;
 	g_autoptr(GKeyFile) kf = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_REMOTE (self), FALSE);
@@ -431,6 +440,11 @@ fwupd_remote_load_from_filename (FwupdRemote *self,
 	if (security_report_uri != NULL && security_report_uri[0] != '\0')
 		fwupd_remote_set_security_report_uri (self, security_report_uri);
 
+	/* a site cache that is tried before the remote for each firmware */
+	peer_cache_uri = g_key_file_get_string (kf, group, "PeerCacheURI", NULL);
+	if (peer_cache_uri != NULL && peer_cache_uri[0] != '\0')
+		fwupd_remote_set_peer_cache_uri (self, peer_cache_uri);
+
 	/* automatic report uploading */
 	priv->automatic_reports = g_key_file_get_boolean (kf, group, "AutomaticReports", NULL);
 	priv->automatic_security_reports = g_key_file_get_boolean (kf, group, "AutomaticSecurityReports", NULL);
@@ -469,10 +483,11 @@ fwupd_remote_load_from_filename (FwupdRemote *self,
 					     "Remotes directory not set");
 			return FALSE;
 		}
-		/* set cache to /var/lib... */
+		/* set cache to /var/lib..., keeping the compression type */
 		filename_cache = g_build_filename (priv->remotes_dir,
 						   priv->id,
-						   "metadata.xml.gz",
+						   g_str_has_suffix (metadata_uri, ".zst") ?
+						   "metadata.xml.zst" : "metadata.xml.gz",
 						   NULL);
 		fwupd_remote_set_filename_cache (self, filename_cache);
 	}
@@ -914,6 +929,76 @@ fwupd_remote_get_security_report_uri (FwupdRemote *self)
 	return priv->security_report_uri;
 }
 
+/**
+ * fwupd_remote_get_peer_cache_uri:
+ * @self: A #FwupdRemote
+ *
+ * Gets the base URI of a local cache that serves the firmware payloads of
+ * this remote by checksum.
+ *
+ * Returns: (transfer none): a URI, or %NULL for unset.
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fwupd_remote_get_peer_cache_uri (FwupdRemote *self)
+{
+	FwupdRemotePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), NULL);
+	return priv->peer_cache_uri;
+}
+
+/**
+ * fwupd_remote_build_peer_cache_uri:
+ * @self: A #FwupdRemote
+ * @checksum: the payload checksum from the metadata
+ * @error: the #GError, or %NULL
+ *
+ * Builds the URI of a firmware payload in the peer cache. The payload is
+ * addressed only by its checksum, so the result must be verified against it
+ * before use.
+ *
+ * Returns: (transfer full): a URI, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+gchar *
+fwupd_remote_build_peer_cache_uri (FwupdRemote *self,
+				   const gchar *checksum,
+				   GError **error)
+{
+	FwupdRemotePrivate *priv = GET_PRIVATE (self);
+	g_autofree gchar *url = NULL;
+	g_autoptr(SoupURI) uri = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_REMOTE (self), NULL);
+	g_return_val_if_fail (checksum != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	if (priv->peer_cache_uri == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "no PeerCacheURI set");
+		return NULL;
+	}
+	if (g_str_has_suffix (priv->peer_cache_uri, "/"))
+		url = g_strdup_printf ("%s%s", priv->peer_cache_uri, checksum);
+	else
+		url = g_strdup_printf ("%s/%s", priv->peer_cache_uri, checksum);
+
+	/* the remote credentials are not sent to the cache */
+	uri = soup_uri_new (url);
+	if (uri == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "Failed to parse URI '%s'", url);
+		return NULL;
+	}
+	return soup_uri_to_string (uri, FALSE);
+}
+
 /**
  * fwupd_remote_get_metadata_uri:
  * @self: A #FwupdRemote
@@ -1188,6 +1273,8 @@ fwupd_remote_set_from_variant_iter (FwupdRemote *self, GVariantIter *iter)
 			fwupd_remote_set_report_uri (self, g_variant_get_string (value, NULL));
 		if (g_strcmp0 (key, "SecurityReportUri") == 0)
 			fwupd_remote_set_security_report_uri (self, g_variant_get_string (value, NULL));
+		if (g_strcmp0 (key, "PeerCacheUri") == 0)
+			fwupd_remote_set_peer_cache_uri (self, g_variant_get_string (value, NULL));
 	}
 	while (g_variant_iter_loop (iter3, "{sv}", &key, &value)) {
 		if (g_strcmp0 (key, "Username") == 0) {
@@ -1274,6 +1361,10 @@ fwupd_remote_to_variant (FwupdRemote *self)
 		g_variant_builder_add (&builder, "{sv}", "SecurityReportUri",
 				       g_variant_new_string (priv->security_report_uri));
 	}
+	if (priv->peer_cache_uri != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "PeerCacheUri",
+				       g_variant_new_string (priv->peer_cache_uri));
+	}
 	if (priv->firmware_base_uri != NULL) {
 		g_variant_builder_add (&builder, "{sv}", "FirmwareBaseUri",
 				       g_variant_new_string (priv->firmware_base_uri));
@@ -1459,6 +1550,7 @@ fwupd_remote_finalize (GObject *obj)
 	g_free (priv->firmware_base_uri);
 	g_free (priv->report_uri);
 	g_free (priv->security_report_uri);
+	g_free (priv->peer_cache_uri);
 	g_free (priv->username);
 	g_free (priv->password);
 	g_free (priv->title);
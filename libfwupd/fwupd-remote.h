@@ -61,6 +61,7 @@ const gchar	*fwupd_remote_get_filename_source	(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_firmware_base_uri	(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_report_uri		(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_security_report_uri	(FwupdRemote	*self);
+const gchar	*fwupd_remote_get_peer_cache_uri	(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_metadata_uri		(FwupdRemote	*self);
 const gchar	*fwupd_remote_get_metadata_uri_sig	(FwupdRemote	*self);
 gboolean	 fwupd_remote_get_enabled		(FwupdRemote	*self);
@@ -74,6 +75,9 @@ FwupdKeyringKind fwupd_remote_get_keyring_kind		(FwupdRemote	*self);
 gchar		*fwupd_remote_build_firmware_uri	(FwupdRemote	*self,
 							 const gchar	*url,
 							 GError		**error);
+gchar		*fwupd_remote_build_peer_cache_uri	(FwupdRemote	*self,
+							 const gchar	*checksum,
+							 GError		**error);
 gboolean	 fwupd_remote_load_signature		(FwupdRemote	*self,
 							 const gchar	*filename,
 							 GError		**error);
@@ -187,6 +187,7 @@ fwupd_remote_download_func (void)
 	g_assert (fwupd_remote_get_metadata_uri_sig (remote) != NULL);
 	g_assert_cmpstr (fwupd_remote_get_title (remote), ==, "Linux Vendor Firmware Service");
 	g_assert_cmpstr (fwupd_remote_get_report_uri (remote), ==, "https://fwupd.org/lvfs/firmware/report");
+	g_assert_cmpstr (fwupd_remote_get_peer_cache_uri (remote), ==, NULL);
 	g_assert_cmpstr (fwupd_remote_get_filename_cache (remote), ==, expected_metadata);
 	g_assert_cmpstr (fwupd_remote_get_filename_cache_sig (remote), ==, expected_signature);
 }
@@ -304,6 +305,43 @@ fwupd_release_func (void)
 	g_assert_cmpstr (fwupd_release_get_metadata_item (release2, "baz"), ==, "bam");
 }
 
+static void
+fwupd_device_compact_func (void)
+{
+	g_autoptr(FwupdDevice) dev1 = fwupd_device_new ();
+	g_autoptr(FwupdDevice) dev2 = NULL;
+	g_autoptr(FwupdRelease) rel = fwupd_release_new ();
+	g_autoptr(GVariant) data = NULL;
+	g_autoptr(GVariant) data_full = NULL;
+	FwupdRelease *rel2;
+
+	fwupd_device_set_id (dev1, "USB:foo");
+	fwupd_device_set_name (dev1, "ColorHug2");
+	fwupd_device_add_guid (dev1, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	fwupd_device_set_flags (dev1, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fwupd_release_set_version (rel, "1.2.3");
+	fwupd_release_add_metadata_item (rel, "foo", "bar");
+	fwupd_device_add_release (dev1, rel);
+
+	/* smaller than the string keys */
+	data = g_variant_ref_sink (fwupd_device_to_variant_compact (dev1, FWUPD_DEVICE_FLAG_NONE));
+	data_full = g_variant_ref_sink (fwupd_device_to_variant_full (dev1, FWUPD_DEVICE_FLAG_NONE));
+	g_assert_cmpstr (g_variant_get_type_string (data), ==, "a{qv}");
+	g_assert_cmpint (g_variant_get_size (data), <, g_variant_get_size (data_full));
+
+	/* round trip */
+	dev2 = fwupd_device_from_variant (data);
+	g_assert_nonnull (dev2);
+	g_assert_cmpstr (fwupd_device_get_id (dev2), ==, "USB:foo");
+	g_assert_cmpstr (fwupd_device_get_name (dev2), ==, "ColorHug2");
+	g_assert_true (fwupd_device_has_guid (dev2, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	g_assert_true (fwupd_device_has_flag (dev2, FWUPD_DEVICE_FLAG_UPDATABLE));
+	rel2 = fwupd_device_get_release_default (dev2);
+	g_assert_nonnull (rel2);
+	g_assert_cmpstr (fwupd_release_get_version (rel2), ==, "1.2.3");
+	g_assert_cmpstr (fwupd_release_get_metadata_item (rel2, "foo"), ==, "bar");
+}
+
 static void
 fwupd_device_func (void)
 {
@@ -665,6 +703,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{guid}", fwupd_common_guid_func);
 	g_test_add_func ("/fwupd/release", fwupd_release_func);
 	g_test_add_func ("/fwupd/device", fwupd_device_func);
+	g_test_add_func ("/fwupd/device{compact}", fwupd_device_compact_func);
 	g_test_add_func ("/fwupd/remote{download}", fwupd_remote_download_func);
 	g_test_add_func ("/fwupd/remote{base-uri}", fwupd_remote_baseuri_func);
 	g_test_add_func ("/fwupd/remote{no-path}", fwupd_remote_nopath_func);
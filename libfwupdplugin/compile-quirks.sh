@@ -0,0 +1,11 @@
+#!/bin/sh
+if [ -z $MESON_INSTALL_PREFIX ]; then
+    echo 'This is meant to be ran from Meson only!'
+    exit 1
+fi
+
+COMPILER=$1
+PKGDATADIR=$2
+
+echo 'Compiling shipped quirks'
+${COMPILER} ${DESTDIR}${PKGDATADIR}
@@ -18,11 +18,23 @@
  * SECTION:fu-archive
  * @title: FuArchive
  * @short_description: an in-memory archive decompressor
+ *
+ * Only the entry headers are parsed when the archive is loaded; the data for
+ * each file is decompressed from the original blob the first time it is
+ * looked up, and is then kept for the lifetime of the object.
  */
 
+typedef struct {
+	guint			 idx;		/* position in the archive */
+	gint64			 size;
+	GBytes			*blob;		/* (nullable): not yet decompressed */
+} FuArchiveEntry;
+
 struct _FuArchive {
 	GObject			 parent_instance;
-	GHashTable		*entries;
+	GBytes			*blob;
+	GMutex			 mutex;		/* for entries */
+	GHashTable		*entries;	/* fn:FuArchiveEntry */
 };
 
 G_DEFINE_TYPE (FuArchive, fu_archive, G_TYPE_OBJECT)
@@ -32,7 +44,10 @@ fu_archive_finalize (GObject *obj)
 {
 	FuArchive *self = FU_ARCHIVE (obj);
 
+	if (self->blob != NULL)
+		g_bytes_unref (self->blob);
 	g_hash_table_unref (self->entries);
+	g_mutex_clear (&self->mutex);
 	G_OBJECT_CLASS (fu_archive_parent_class)->finalize (obj);
 }
 
@@ -43,11 +58,163 @@ fu_archive_class_init (FuArchiveClass *klass)
 	object_class->finalize = fu_archive_finalize;
 }
 
+static void
+fu_archive_entry_free (FuArchiveEntry *entry)
+{
+	if (entry->blob != NULL)
+		g_bytes_unref (entry->blob);
+	g_free (entry);
+}
+
 static void
 fu_archive_init (FuArchive *self)
 {
+	g_mutex_init (&self->mutex);
 	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
-					       g_free, (GDestroyNotify) g_bytes_unref);
+					       g_free, (GDestroyNotify) fu_archive_entry_free);
+}
+
+/* workaround the struct types of libarchive */
+typedef struct archive _archive_read_ctx;
+
+static void
+_archive_read_ctx_free (_archive_read_ctx *arch)
+{
+	archive_read_close (arch);
+	archive_read_free (arch);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(_archive_read_ctx, _archive_read_ctx_free)
+
+static _archive_read_ctx *
+fu_archive_open (GBytes *blob, GError **error)
+{
+	int r;
+	g_autoptr(_archive_read_ctx) arch = NULL;
+
+	arch = archive_read_new ();
+	if (arch == NULL) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_SUPPORTED,
+				     "libarchive startup failed");
+		return NULL;
+	}
+	archive_read_support_format_all (arch);
+	archive_read_support_filter_all (arch);
+	r = archive_read_open_memory (arch,
+				      (void *) g_bytes_get_data (blob, NULL),
+				      (size_t) g_bytes_get_size (blob));
+	if (r != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "cannot open: %s",
+			     archive_error_string (arch));
+		return NULL;
+	}
+	return g_steal_pointer (&arch);
+}
+
+static gboolean
+fu_archive_read_next_header (_archive_read_ctx *arch,
+			     struct archive_entry **entry,
+			     gboolean *done,
+			     GError **error)
+{
+	int r = archive_read_next_header (arch, entry);
+	if (r == ARCHIVE_EOF) {
+		*done = TRUE;
+		return TRUE;
+	}
+	if (r != ARCHIVE_OK) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot read header: %s",
+			     archive_error_string (arch));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static GBytes *
+fu_archive_read_data (_archive_read_ctx *arch, gint64 bufsz, GError **error)
+{
+	gssize rc;
+	g_autofree guint8 *buf = g_malloc (bufsz);
+
+	rc = archive_read_data (arch, buf, (gsize) bufsz);
+	if (rc < 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "cannot read data: %s",
+			     archive_error_string (arch));
+		return NULL;
+	}
+	if (rc != bufsz) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "read %" G_GSSIZE_FORMAT " of %" G_GINT64_FORMAT,
+			     rc, bufsz);
+		return NULL;
+	}
+	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+}
+
+/* libarchive can only stream forwards, so decompress everything still
+ * wanted in a single pass -- either just @only, or all entries if %NULL */
+static gboolean
+fu_archive_decompress (FuArchive *self, FuArchiveEntry *only, GError **error)
+{
+	GHashTableIter iter;
+	gpointer value;
+	guint idx_max = 0;
+	g_autoptr(GHashTable) wanted = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_autoptr(_archive_read_ctx) arch = NULL;
+
+	/* build the list of entries still compressed */
+	g_hash_table_iter_init (&iter, self->entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FuArchiveEntry *entry = (FuArchiveEntry *) value;
+		if (entry->blob != NULL)
+			continue;
+		if (only != NULL && only != entry)
+			continue;
+		g_hash_table_insert (wanted, GUINT_TO_POINTER (entry->idx), entry);
+		idx_max = MAX (idx_max, entry->idx);
+	}
+	if (g_hash_table_size (wanted) == 0)
+		return TRUE;
+
+	arch = fu_archive_open (self->blob, error);
+	if (arch == NULL)
+		return FALSE;
+	for (guint idx = 0; idx <= idx_max; idx++) {
+		FuArchiveEntry *entry;
+		gboolean done = FALSE;
+		struct archive_entry *archive_entry = NULL;
+
+		if (!fu_archive_read_next_header (arch, &archive_entry, &done, error))
+			return FALSE;
+		if (done) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "entry %u no longer exists",
+				     idx);
+			return FALSE;
+		}
+		entry = g_hash_table_lookup (wanted, GUINT_TO_POINTER (idx));
+		if (entry == NULL)
+			continue;
+		entry->blob = fu_archive_read_data (arch, entry->size, error);
+		if (entry->blob == NULL)
+			return FALSE;
+	}
+	return TRUE;
 }
 
 /**
@@ -65,20 +232,25 @@ fu_archive_init (FuArchive *self)
 GBytes *
 fu_archive_lookup_by_fn (FuArchive *self, const gchar *fn, GError **error)
 {
-	GBytes *fw;
+	FuArchiveEntry *entry;
+	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_ARCHIVE (self), NULL);
 	g_return_val_if_fail (fn != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	fw = g_hash_table_lookup (self->entries, fn);
-	if (fw == NULL) {
+	locker = g_mutex_locker_new (&self->mutex);
+	entry = g_hash_table_lookup (self->entries, fn);
+	if (entry == NULL) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_NOT_FOUND,
 			     "no blob for %s", fn);
+		return NULL;
 	}
-	return fw;
+	if (!fu_archive_decompress (self, entry, error))
+		return NULL;
+	return entry->blob;
 }
 
 /**
@@ -91,6 +263,8 @@ fu_archive_lookup_by_fn (FuArchive *self, const gchar *fn, GError **error)
  * Iterates over the archive contents, calling the given function for each
  * of the files found. If any @callback returns %FALSE scanning is aborted.
  *
+ * Any files not already looked up are decompressed before @callback is used.
+ *
  * Returns: True if no @callback returned FALSE
  *
  * Since: 1.3.4
@@ -107,79 +281,50 @@ fu_archive_iterate (FuArchive *self,
 	g_return_val_if_fail (FU_IS_ARCHIVE (self), FALSE);
 	g_return_val_if_fail (callback != NULL, FALSE);
 
+	g_mutex_lock (&self->mutex);
+	if (!fu_archive_decompress (self, NULL, error)) {
+		g_mutex_unlock (&self->mutex);
+		return FALSE;
+	}
+	g_mutex_unlock (&self->mutex);
+
+	/* the callback may use fu_archive_lookup_by_fn() */
 	g_hash_table_iter_init (&iter, self->entries);
 	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		if (!callback (self, (const gchar *)key, (GBytes *)value, user_data, error))
+		FuArchiveEntry *entry = (FuArchiveEntry *) value;
+		if (!callback (self, (const gchar *)key, entry->blob, user_data, error))
 			return FALSE;
 	}
 	return TRUE;
 }
 
-/* workaround the struct types of libarchive */
-typedef struct archive _archive_read_ctx;
-
-static void
-_archive_read_ctx_free (_archive_read_ctx *arch)
-{
-	archive_read_close (arch);
-	archive_read_free (arch);
-}
-
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(_archive_read_ctx, _archive_read_ctx_free)
-
 static gboolean
 fu_archive_load (FuArchive *self, GBytes *blob, FuArchiveFlags flags, GError **error)
 {
-	int r;
 	g_autoptr(_archive_read_ctx) arch = NULL;
 
-	/* decompress anything matching either glob */
-	arch = archive_read_new ();
-	if (arch == NULL) {
-		g_set_error_literal (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_NOT_SUPPORTED,
-				     "libarchive startup failed");
+	/* only the headers are read here; the next header skips the data */
+	arch = fu_archive_open (blob, error);
+	if (arch == NULL)
 		return FALSE;
-	}
-	archive_read_support_format_all (arch);
-	archive_read_support_filter_all (arch);
-	r = archive_read_open_memory (arch,
-				      (void *) g_bytes_get_data (blob, NULL),
-				      (size_t) g_bytes_get_size (blob));
-	if (r != 0) {
-		g_set_error (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_NOT_SUPPORTED,
-			     "cannot open: %s",
-			     archive_error_string (arch));
-		return FALSE;
-	}
-	while (TRUE) {
+	for (guint idx = 0;; idx++) {
 		const gchar *fn;
+		gboolean done = FALSE;
 		gint64 bufsz;
-		gssize rc;
-		struct archive_entry *entry;
+		struct archive_entry *archive_entry = NULL;
+		FuArchiveEntry *entry;
 		g_autofree gchar *fn_key = NULL;
-		g_autofree guint8 *buf = NULL;
 
-		r = archive_read_next_header (arch, &entry);
-		if (r == ARCHIVE_EOF)
-			break;
-		if (r != ARCHIVE_OK) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "cannot read header: %s",
-				     archive_error_string (arch));
+		if (!fu_archive_read_next_header (arch, &archive_entry, &done, error))
 			return FALSE;
-		}
+		if (done)
+			break;
 
 		/* only extract if valid */
-		fn = archive_entry_pathname (entry);
+		fn = archive_entry_pathname (archive_entry);
 		if (fn == NULL)
 			continue;
-		bufsz = archive_entry_size (entry);
+		bufsz = archive_entry_size (archive_entry);
 		if (bufsz > 1024 * 1024 * 1024) {
 			g_set_error_literal (error,
 					     G_IO_ERROR,
@@ -187,36 +332,20 @@ fu_archive_load (FuArchive *self, GBytes *blob, FuArchiveFlags flags, GError **e
 					     "cannot read huge files");
 			return FALSE;
 		}
-		buf = g_malloc (bufsz);
-		rc = archive_read_data (arch, buf, (gsize) bufsz);
-		if (rc < 0) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "cannot read data: %s",
-				     archive_error_string (arch));
-			return FALSE;
-		}
-		if (rc != bufsz) {
-			g_set_error (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_FAILED,
-				     "read %" G_GSSIZE_FORMAT " of %" G_GINT64_FORMAT,
-				     rc, bufsz);
-			return FALSE;
-		}
 		if (flags & FU_ARCHIVE_FLAG_IGNORE_PATH) {
 			fn_key = g_path_get_basename (fn);
 		} else {
 			fn_key = g_strdup (fn);
 		}
 		g_debug ("adding %s [%" G_GINT64_FORMAT "]", fn_key, bufsz);
-		g_hash_table_insert (self->entries,
-				     g_steal_pointer (&fn_key),
-				     g_bytes_new_take (g_steal_pointer (&buf), bufsz));
+		entry = g_new0 (FuArchiveEntry, 1);
+		entry->idx = idx;
+		entry->size = bufsz;
+		g_hash_table_insert (self->entries, g_steal_pointer (&fn_key), entry);
 	}
 
 	/* success */
+	self->blob = g_bytes_ref (blob);
 	return TRUE;
 }
 
@@ -226,7 +355,8 @@ fu_archive_load (FuArchive *self, GBytes *blob, FuArchiveFlags flags, GError **e
  * @flags: A #FuArchiveFlags, e.g. %FU_ARCHIVE_FLAG_NONE
  * @error: A #GError, or %NULL
  *
- * Parses @data as an archive and decompresses all files to memory blobs.
+ * Parses @data as an archive. The files are decompressed to memory blobs
+ * when they are first looked up, and so @data is kept until @self is unref'd.
  *
  * Returns: a #FuArchive, or %NULL if the archive was invalid in any way.
  *
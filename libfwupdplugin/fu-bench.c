@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#include "config.h"
+
+#include <fwupd.h>
+#include <fwupdplugin.h>
+#include <libgcab.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fu-smbios-private.h"
+
+/* keep running each test until this much time has passed */
+#define FU_BENCH_DURATION_MIN		250000		/* µs */
+
+typedef gboolean (*FuBenchFunc)		(gpointer	 user_data,
+					 GError		**error);
+
+typedef struct {
+	gsize			 size_max;
+	GBytes			*blob;		/* raw payload */
+	GBytes			*blob_ihex;
+	GBytes			*blob_srec;
+	GBytes			*blob_dfu;
+	GBytes			*blob_fmap;
+	GBytes			*blob_cab;
+	FuFirmware		*firmware;	/* containing blob */
+	FuSmbios		*smbios;
+} FuBenchPrivate;
+
+static void
+fu_bench_private_clear (FuBenchPrivate *priv)
+{
+	g_clear_pointer (&priv->blob, g_bytes_unref);
+	g_clear_pointer (&priv->blob_ihex, g_bytes_unref);
+	g_clear_pointer (&priv->blob_srec, g_bytes_unref);
+	g_clear_pointer (&priv->blob_dfu, g_bytes_unref);
+	g_clear_pointer (&priv->blob_fmap, g_bytes_unref);
+	g_clear_pointer (&priv->blob_cab, g_bytes_unref);
+	g_clear_object (&priv->firmware);
+}
+
+/* one JSON object per line so that results can be compared with jq */
+static gboolean
+fu_bench_run (const gchar *name, gsize size, FuBenchFunc func,
+	      gpointer user_data, GError **error)
+{
+	gint64 elapsed = 0;
+	guint iterations = 0;
+
+	do {
+		gint64 start = g_get_monotonic_time ();
+		if (!func (user_data, error)) {
+			g_prefix_error (error, "%s failed: ", name);
+			return FALSE;
+		}
+		elapsed += g_get_monotonic_time () - start;
+		iterations++;
+	} while (elapsed < FU_BENCH_DURATION_MIN);
+
+	g_print ("{\"name\":\"%s\",\"size\":%" G_GSIZE_FORMAT ","
+		 "\"iterations\":%u,\"usec\":%" G_GINT64_FORMAT,
+		 name, size, iterations, elapsed / iterations);
+	if (size > 0 && elapsed > 0) {
+		g_print (",\"mbps\":%.1f",
+			 ((gdouble) size * iterations) / (gdouble) elapsed);
+	}
+	g_print ("}\n");
+	return TRUE;
+}
+
+static GBytes *
+fu_bench_build_payload (gsize size)
+{
+	guint32 seed = 0xdeadbeef;
+	guint8 *buf = g_malloc (size);
+
+	/* not compressible, but reproducible */
+	for (gsize i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 24;
+	}
+	return g_bytes_new_take (buf, size);
+}
+
+static void
+fu_bench_srec_append (GString *str, guint kind, guint32 addr,
+		      const guint8 *buf, gsize bufsz)
+{
+	guint addrsz = kind == 3 || kind == 7 ? 4 : 2;
+	guint8 count = addrsz + bufsz + 1;
+	guint8 csum = count;
+
+	g_string_append_printf (str, "S%u%02X", kind, count);
+	for (guint i = 0; i < addrsz; i++) {
+		guint8 tmp = addr >> ((addrsz - i - 1) * 8);
+		g_string_append_printf (str, "%02X", tmp);
+		csum += tmp;
+	}
+	for (gsize i = 0; i < bufsz; i++) {
+		g_string_append_printf (str, "%02X", buf[i]);
+		csum += buf[i];
+	}
+	g_string_append_printf (str, "%02X\n", (guint) (csum ^ 0xff));
+}
+
+/* there is no srec writer, so build the records manually */
+static GBytes *
+fu_bench_build_srec (GBytes *blob)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &bufsz);
+	GString *str = g_string_sized_new (bufsz * 3);
+
+	fu_bench_srec_append (str, 0, 0x0, (const guint8 *) "bench", 5);
+	for (gsize i = 0; i < bufsz; i += 32)
+		fu_bench_srec_append (str, 3, i, buf + i, MIN (32, bufsz - i));
+	fu_bench_srec_append (str, 7, 0x0, NULL, 0);
+	return g_string_free_to_bytes (str);
+}
+
+/* there is no fmap writer either, so put a header just after the start */
+static GBytes *
+fu_bench_build_fmap (GBytes *blob)
+{
+	gsize bufsz = g_bytes_get_size (blob);
+	guint8 *buf = g_memdup (g_bytes_get_data (blob, NULL), bufsz);
+	const gsize offset = 0x100;
+	FuFmap *fmap = (FuFmap *) (buf + offset);
+
+	memset (fmap, 0x0, sizeof (FuFmap) + 2 * sizeof (FuFmapArea));
+	memcpy (fmap->signature, "__FMAP__", 8);
+	fmap->ver_major = 1;
+	fmap->size = bufsz;
+	fmap->nareas = 2;
+	fmap->areas[0].offset = offset;
+	fmap->areas[0].size = 0x100;
+	memcpy (fmap->areas[0].name, "FMAP", 4);
+	fmap->areas[1].offset = 0x1000;
+	fmap->areas[1].size = bufsz - 0x1000;
+	memcpy (fmap->areas[1].name, "RW", 2);
+	return g_bytes_new_take (buf, bufsz);
+}
+
+static GBytes *
+fu_bench_build_cab (GBytes *blob, GError **error)
+{
+	const gchar *xml =
+		"<component type=\"firmware\">\n"
+		"  <id>com.acme.example.firmware</id>\n"
+		"  <releases>\n"
+		"    <release version=\"1.2.3\"/>\n"
+		"  </releases>\n"
+		"</component>";
+	g_autoptr(GBytes) blob_xml = g_bytes_new_static (xml, strlen (xml));
+	g_autoptr(GCabCabinet) cabinet = gcab_cabinet_new ();
+	g_autoptr(GCabFile) cabfile_fw = gcab_file_new_with_bytes ("firmware.bin", blob);
+	g_autoptr(GCabFile) cabfile_xml = gcab_file_new_with_bytes ("acme.metainfo.xml", blob_xml);
+	g_autoptr(GCabFolder) cabfolder = gcab_folder_new (GCAB_COMPRESSION_NONE);
+	g_autoptr(GOutputStream) op = g_memory_output_stream_new_resizable ();
+
+	if (!gcab_cabinet_add_folder (cabinet, cabfolder, error))
+		return NULL;
+	if (!gcab_folder_add_file (cabfolder, cabfile_xml, FALSE, NULL, error))
+		return NULL;
+	if (!gcab_folder_add_file (cabfolder, cabfile_fw, FALSE, NULL, error))
+		return NULL;
+	if (!gcab_cabinet_write_simple (cabinet, op, NULL, NULL, NULL, error))
+		return NULL;
+	if (!g_output_stream_close (op, NULL, error))
+		return NULL;
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (op));
+}
+
+static gboolean
+fu_bench_setup (FuBenchPrivate *priv, gsize size, GError **error)
+{
+	g_autoptr(FuFirmware) firmware_ihex = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmware) firmware_dfu = fu_dfu_firmware_new ();
+	g_autoptr(FuFirmwareImage) img = NULL;
+
+	fu_bench_private_clear (priv);
+	priv->blob = fu_bench_build_payload (size);
+	img = fu_firmware_image_new (priv->blob);
+	priv->firmware = fu_firmware_new ();
+	fu_firmware_add_image (priv->firmware, img);
+
+	/* use the real writers where they exist */
+	fu_firmware_add_image (firmware_ihex, img);
+	priv->blob_ihex = fu_firmware_write (firmware_ihex, error);
+	if (priv->blob_ihex == NULL)
+		return FALSE;
+	fu_firmware_add_image (firmware_dfu, img);
+	priv->blob_dfu = fu_firmware_write (firmware_dfu, error);
+	if (priv->blob_dfu == NULL)
+		return FALSE;
+	priv->blob_srec = fu_bench_build_srec (priv->blob);
+	priv->blob_fmap = fu_bench_build_fmap (priv->blob);
+	priv->blob_cab = fu_bench_build_cab (priv->blob, error);
+	return priv->blob_cab != NULL;
+}
+
+static gboolean
+fu_bench_parse_blob (GType gtype, GBytes *blob, GError **error)
+{
+	g_autoptr(FuFirmware) firmware = g_object_new (gtype, NULL);
+	return fu_firmware_parse (firmware, blob, FWUPD_INSTALL_FLAG_NONE, error);
+}
+
+static gboolean
+fu_bench_ihex_parse_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	return fu_bench_parse_blob (FU_TYPE_IHEX_FIRMWARE, priv->blob_ihex, error);
+}
+
+static gboolean
+fu_bench_srec_parse_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	return fu_bench_parse_blob (FU_TYPE_SREC_FIRMWARE, priv->blob_srec, error);
+}
+
+static gboolean
+fu_bench_dfu_parse_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	return fu_bench_parse_blob (FU_TYPE_DFU_FIRMWARE, priv->blob_dfu, error);
+}
+
+static gboolean
+fu_bench_fmap_parse_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	return fu_bench_parse_blob (FU_TYPE_FMAP_FIRMWARE, priv->blob_fmap, error);
+}
+
+static gboolean
+fu_bench_write_blob (GType gtype, FuFirmware *firmware_src, GError **error)
+{
+	g_autoptr(FuFirmware) firmware = g_object_new (gtype, NULL);
+	g_autoptr(FuFirmwareImage) img = NULL;
+	g_autoptr(GBytes) blob = NULL;
+
+	img = fu_firmware_get_image_default (firmware_src, error);
+	if (img == NULL)
+		return FALSE;
+	fu_firmware_add_image (firmware, img);
+	blob = fu_firmware_write (firmware, error);
+	return blob != NULL;
+}
+
+static gboolean
+fu_bench_ihex_write_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	return fu_bench_write_blob (FU_TYPE_IHEX_FIRMWARE, priv->firmware, error);
+}
+
+static gboolean
+fu_bench_dfu_write_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	return fu_bench_write_blob (FU_TYPE_DFU_FIRMWARE, priv->firmware, error);
+}
+
+static gboolean
+fu_bench_cabinet_parse_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+	fu_cabinet_set_size_max (cabinet, G_MAXUINT64);
+	return fu_cabinet_parse (cabinet, priv->blob_cab,
+				 FU_CABINET_PARSE_FLAG_NONE, error);
+}
+
+static gboolean
+fu_bench_chunk_array_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	g_autoptr(GPtrArray) chunks = NULL;
+	chunks = fu_chunk_array_new_from_bytes (priv->blob, 0x0, 0x0, 64);
+	return chunks->len > 0;
+}
+
+static gboolean
+fu_bench_chunk_iter_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	FuChunkIter iter;
+	FuChunk chk;
+	guint cnt = 0;
+	fu_chunk_iter_init_bytes (&iter, priv->blob, 0x0, 0x0, 64);
+	while (fu_chunk_iter_next (&iter, &chk))
+		cnt++;
+	return cnt > 0;
+}
+
+static gboolean
+fu_bench_quirks_load_cb (gpointer user_data, GError **error)
+{
+	g_autoptr(FuQuirks) quirks = fu_quirks_new ();
+	return fu_quirks_load (quirks, FU_QUIRKS_LOAD_FLAG_NONE, error);
+}
+
+static gboolean
+fu_bench_hwids_setup_cb (gpointer user_data, GError **error)
+{
+	FuBenchPrivate *priv = (FuBenchPrivate *) user_data;
+	g_autoptr(FuHwids) hwids = fu_hwids_new ();
+	return fu_hwids_setup (hwids, priv->smbios, error);
+}
+
+int
+main (int argc, char **argv)
+{
+	guint size_max_kb = 64 * 1024;
+	FuBenchPrivate priv = { 0 };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	const GOptionEntry options[] = {
+		{ "size-max", '\0', 0, G_OPTION_ARG_INT, &size_max_kb,
+			"Largest generated input in KiB", NULL },
+		{ NULL }
+	};
+	struct {
+		const gchar	*name;
+		FuBenchFunc	 func;
+	} sized[] = {
+		{ "ihex-parse",		fu_bench_ihex_parse_cb },
+		{ "ihex-write",		fu_bench_ihex_write_cb },
+		{ "srec-parse",		fu_bench_srec_parse_cb },
+		{ "dfu-parse",		fu_bench_dfu_parse_cb },
+		{ "dfu-write",		fu_bench_dfu_write_cb },
+		{ "fmap-parse",		fu_bench_fmap_parse_cb },
+		{ "cabinet-parse",	fu_bench_cabinet_parse_cb },
+		{ "chunk-array",	fu_bench_chunk_array_cb },
+		{ "chunk-iter",		fu_bench_chunk_iter_cb },
+		{ NULL, NULL }
+	};
+
+	/* use the same data as the self tests */
+	g_setenv ("FWUPD_DATADIR", TESTDATADIR_SRC, TRUE);
+	g_setenv ("FWUPD_SYSFSFWDIR", TESTDATADIR_SRC, TRUE);
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context, "Benchmark firmware parsers and helpers");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("Failed to parse arguments: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	priv.size_max = (gsize) size_max_kb * 1024;
+
+	/* independent of the input size */
+	priv.smbios = fu_smbios_new ();
+	if (!fu_smbios_setup (priv.smbios, &error)) {
+		g_printerr ("Failed to setup SMBIOS: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	if (!fu_bench_run ("quirks-load", 0, fu_bench_quirks_load_cb, &priv, &error) ||
+	    !fu_bench_run ("hwids-setup", 0, fu_bench_hwids_setup_cb, &priv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	/* 64KiB to 64MiB by default */
+	for (gsize size = 0x10000; size <= priv.size_max; size *= 4) {
+		if (!fu_bench_setup (&priv, size, &error)) {
+			g_printerr ("Failed to generate %" G_GSIZE_FORMAT " bytes: %s\n",
+				    size, error->message);
+			return EXIT_FAILURE;
+		}
+		for (guint i = 0; sized[i].name != NULL; i++) {
+			if (!fu_bench_run (sized[i].name, size, sized[i].func, &priv, &error)) {
+				g_printerr ("%s\n", error->message);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	fu_bench_private_clear (&priv);
+	g_object_unref (priv.smbios);
+	return EXIT_SUCCESS;
+}
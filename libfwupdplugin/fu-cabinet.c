@@ -9,10 +9,12 @@
 #include "config.h"
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <libgcab.h>
 
 #include "fu-cabinet.h"
 #include "fu-common.h"
+#include "fu-jcat-cache.h"
 
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
@@ -26,6 +28,8 @@ struct _FuCabinet {
 	XbSilo			*silo;
 	JcatContext		*jcat_context;
 	JcatFile		*jcat_file;
+	FuJcatCache		*jcat_cache;	/* (nullable) */
+	GHashTable		*payloads;	/* basename : GBytes */
 };
 
 G_DEFINE_TYPE (FuCabinet, fu_cabinet, G_TYPE_OBJECT)
@@ -42,6 +46,9 @@ fu_cabinet_finalize (GObject *obj)
 	g_object_unref (self->gcab_cabinet);
 	g_object_unref (self->jcat_context);
 	g_object_unref (self->jcat_file);
+	if (self->jcat_cache != NULL)
+		g_object_unref (self->jcat_cache);
+	g_hash_table_unref (self->payloads);
 	G_OBJECT_CLASS (fu_cabinet_parent_class)->finalize (obj);
 }
 
@@ -60,6 +67,8 @@ fu_cabinet_init (FuCabinet *self)
 	self->builder = xb_builder_new ();
 	self->jcat_file = jcat_file_new ();
 	self->jcat_context = jcat_context_new ();
+	self->payloads = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, (GDestroyNotify) g_bytes_unref);
 }
 
 /**
@@ -96,6 +105,49 @@ fu_cabinet_set_jcat_context (FuCabinet *self, JcatContext *jcat_context)
 	g_set_object (&self->jcat_context, jcat_context);
 }
 
+/**
+ * fu_cabinet_set_jcat_cache: (skip):
+ * @self: A #FuCabinet
+ * @jcat_cache: (nullable): A #FuJcatCache
+ *
+ * Sets the cache of previously verified signatures, which avoids verifying
+ * the same metadata and payloads again.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_cabinet_set_jcat_cache (FuCabinet *self, FuJcatCache *jcat_cache)
+{
+	g_return_if_fail (FU_IS_CABINET (self));
+	g_set_object (&self->jcat_cache, jcat_cache);
+}
+
+/* returns the results of jcat_context_verify_item(), unless already cached
+ * in which case an empty array is returned */
+static GPtrArray *
+fu_cabinet_verify_item (FuCabinet *self,
+			GBytes *blob,
+			JcatItem *item,
+			JcatVerifyFlags flags,
+			GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+
+	if (self->jcat_cache != NULL &&
+	    fu_jcat_cache_lookup (self->jcat_cache, blob, item, flags, NULL)) {
+		g_debug ("using cached verification for %s", jcat_item_get_id (item));
+		return g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	}
+	results = jcat_context_verify_item (self->jcat_context, blob, item, flags, error);
+	if (results == NULL)
+		return NULL;
+	if (self->jcat_cache != NULL &&
+	    !fu_jcat_cache_add (self->jcat_cache, blob, item, flags, results, &error_local))
+		g_debug ("failed to cache verification: %s", error_local->message);
+	return g_steal_pointer (&results);
+}
+
 /**
  * fu_cabinet_get_silo: (skip):
  * @self: A #FuCabinet
@@ -129,6 +181,17 @@ fu_cabinet_get_file_by_name (FuCabinet *self, const gchar *basename)
 	return NULL;
 }
 
+/* payloads extracted to disk are used in preference to the GCabFile data */
+static GBytes *
+fu_cabinet_get_file_bytes (FuCabinet *self, GCabFile *cabfile)
+{
+	GBytes *blob;
+	blob = g_hash_table_lookup (self->payloads, gcab_file_get_extract_name (cabfile));
+	if (blob != NULL)
+		return blob;
+	return gcab_file_get_bytes (cabfile);
+}
+
 /* sets the firmware and signature blobs on XbNode */
 static gboolean
 fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
@@ -170,7 +233,7 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 			     basename);
 		return FALSE;
 	}
-	blob = gcab_file_get_bytes (cabfile);
+	blob = fu_cabinet_get_file_bytes (self, cabfile);
 	if (blob == NULL) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
@@ -203,14 +266,15 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 
 	/* set if unspecified, but error out if specified and incorrect */
 	if (csum_tmp != NULL && xb_node_get_text (csum_tmp) != NULL) {
-		g_autofree gchar *checksum = NULL;
-		checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob);
-		if (g_strcmp0 (checksum, xb_node_get_text (csum_tmp)) != 0) {
+		const GChecksumType types[] = { G_CHECKSUM_SHA1 };
+		g_auto(GStrv) checksums = NULL;
+		checksums = fu_common_checksums_compute (blob, types, G_N_ELEMENTS (types));
+		if (g_strcmp0 (checksums[0], xb_node_get_text (csum_tmp)) != 0) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "contents checksum invalid, expected %s, got %s",
-				     checksum,
+				     checksums[0],
 				     xb_node_get_text (csum_tmp));
 			return FALSE;
 		}
@@ -221,11 +285,10 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 	if (item != NULL) {
 		g_autoptr(GError) error_local = NULL;
 		g_autoptr(GPtrArray) results = NULL;
-		results = jcat_context_verify_item (self->jcat_context,
-						    blob, item,
-						    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-						    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-						    &error_local);
+		results = fu_cabinet_verify_item (self, blob, item,
+						  JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+						  JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+						  &error_local);
 		if (results == NULL) {
 			g_debug ("failed to verify payload %s: %s",
 				 basename, error_local->message);
@@ -242,11 +305,12 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 		cabfile = fu_cabinet_get_file_by_name (self, basename_sig);
 		if (cabfile != NULL) {
 			GBytes *data_sig;
-			g_autoptr(JcatResult) jcat_result = NULL;
+			g_autoptr(GPtrArray) results = NULL;
 			g_autoptr(JcatBlob) jcat_blob = NULL;
+			g_autoptr(JcatItem) jcat_item = NULL;
 			g_autoptr(GError) error_local = NULL;
 
-			data_sig = gcab_file_get_bytes (cabfile);
+			data_sig = fu_cabinet_get_file_bytes (self, cabfile);
 			if (data_sig == NULL) {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -256,11 +320,12 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 				return FALSE;
 			}
 			jcat_blob = jcat_blob_new (JCAT_BLOB_KIND_GPG, data_sig);
-			jcat_result = jcat_context_verify_blob (self->jcat_context,
-								blob, jcat_blob,
-								JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-								&error_local);
-			if (jcat_result == NULL) {
+			jcat_item = jcat_item_new (basename);
+			jcat_item_add_blob (jcat_item, jcat_blob);
+			results = fu_cabinet_verify_item (self, blob, jcat_item,
+							  JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+							  &error_local);
+			if (results == NULL) {
 				g_debug ("failed to verify payload %s using detached: %s",
 					 basename, error_local->message);
 			} else {
@@ -410,12 +475,12 @@ fu_cabinet_build_silo_metainfo (FuCabinet *self, GCabFile *cabfile, GError **err
 	} else {
 		g_autoptr(GError) error_local = NULL;
 		g_autoptr(GPtrArray) results = NULL;
-		results = jcat_context_verify_item (self->jcat_context,
-						    gcab_file_get_bytes (cabfile),
-						    item,
-						    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-						    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-						    &error_local);
+		results = fu_cabinet_verify_item (self,
+						  gcab_file_get_bytes (cabfile),
+						  item,
+						  JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+						  JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+						  &error_local);
 		if (results == NULL) {
 			g_debug ("failed to verify %s: %s",
 				 fn, error_local->message);
@@ -533,12 +598,32 @@ fu_cabinet_build_silo (FuCabinet *self, GBytes *data, GError **error)
 	return TRUE;
 }
 
+typedef enum {
+	FU_CABINET_DECOMPRESS_KIND_ALL,
+	FU_CABINET_DECOMPRESS_KIND_METADATA,
+	FU_CABINET_DECOMPRESS_KIND_PAYLOAD,
+} FuCabinetDecompressKind;
+
 typedef struct {
-	FuCabinet	*self;
-	guint64		 size_total;
-	GError		*error;
+	FuCabinet		*self;
+	FuCabinetDecompressKind	 kind;
+	guint64			 size_total;
+	GPtrArray		*basenames;
+	GError			*error;
 } FuCabinetDecompressHelper;
 
+/* metadata and signatures are small and always decompressed to memory */
+static gboolean
+fu_cabinet_is_metadata_filename (const gchar *basename)
+{
+	const gchar *suffixes[] = { ".metainfo.xml", ".jcat", ".asc", NULL };
+	for (guint i = 0; suffixes[i] != NULL; i++) {
+		if (g_str_has_suffix (basename, suffixes[i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
 static gboolean
 fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 {
@@ -584,18 +669,101 @@ fu_cabinet_decompress_file_cb (GCabFile *file, gpointer user_data)
 	/* ignore the dirname completely */
 	basename = g_path_get_basename (name);
 	gcab_file_set_extract_name (file, basename);
+
+	/* only extract the files we want in this pass */
+	if (helper->kind == FU_CABINET_DECOMPRESS_KIND_METADATA)
+		return fu_cabinet_is_metadata_filename (basename);
+	if (helper->kind == FU_CABINET_DECOMPRESS_KIND_PAYLOAD) {
+		if (fu_cabinet_is_metadata_filename (basename))
+			return FALSE;
+		g_ptr_array_add (helper->basenames, g_steal_pointer (&basename));
+	}
 	return TRUE;
 }
 
 static gboolean
-fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
+fu_cabinet_extract (FuCabinet *self,
+		    FuCabinetDecompressKind kind,
+		    GFile *path,
+		    GPtrArray *basenames,
+		    GError **error)
 {
 	FuCabinetDecompressHelper helper = {
 		.self		= self,
+		.kind		= kind,
 		.size_total	= 0,
+		.basenames	= basenames,
 		.error		= NULL,
 	};
 	g_autoptr(GError) error_local = NULL;
+
+	if (!gcab_cabinet_extract_simple (self->gcab_cabinet, path,
+					  fu_cabinet_decompress_file_cb, &helper,
+					  NULL, &error_local)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     error_local->message);
+		if (helper.error != NULL)
+			g_error_free (helper.error);
+		return FALSE;
+	}
+
+	/* the file callback set an error */
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+
+	/* success */
+	return TRUE;
+}
+
+/* decompress each payload into a temporary file and map it, so the
+ * decompressed data is backed by the page cache rather than the heap */
+static gboolean
+fu_cabinet_extract_payloads (FuCabinet *self, GError **error)
+{
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(GFile) path = NULL;
+	g_autoptr(GPtrArray) basenames = g_ptr_array_new_with_free_func (g_free);
+	gboolean ret = TRUE;
+
+	tmpdir = g_dir_make_tmp ("fwupd-cab-XXXXXX", error);
+	if (tmpdir == NULL)
+		return FALSE;
+	path = g_file_new_for_path (tmpdir);
+	if (!fu_cabinet_extract (self, FU_CABINET_DECOMPRESS_KIND_PAYLOAD,
+				 path, basenames, error))
+		ret = FALSE;
+
+	/* the mapping stays valid after the file has been deleted */
+	for (guint i = 0; i < basenames->len; i++) {
+		const gchar *basename = g_ptr_array_index (basenames, i);
+		g_autofree gchar *fn = g_build_filename (tmpdir, basename, NULL);
+		if (ret) {
+			g_autoptr(GMappedFile) mapped_file = NULL;
+			mapped_file = g_mapped_file_new (fn, FALSE, error);
+			if (mapped_file == NULL) {
+				ret = FALSE;
+			} else {
+				g_hash_table_insert (self->payloads,
+						     g_strdup (basename),
+						     g_mapped_file_get_bytes (mapped_file));
+			}
+		}
+		g_unlink (fn);
+	}
+	g_rmdir (tmpdir);
+	return ret;
+}
+
+static gboolean
+fu_cabinet_decompress (FuCabinet *self,
+		       GBytes *data,
+		       FuCabinetParseFlags flags,
+		       GError **error)
+{
 	g_autoptr(GInputStream) istream = NULL;
 
 	/* load from a seekable stream */
@@ -615,25 +783,17 @@ fu_cabinet_decompress (FuCabinet *self, GBytes *data, GError **error)
 		return FALSE;
 	}
 
-	/* decompress the file to memory */
-	if (!gcab_cabinet_extract_simple (self->gcab_cabinet, NULL,
-					  fu_cabinet_decompress_file_cb, &helper,
-					  NULL, &error_local)) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     error_local->message);
-		return FALSE;
+	/* decompress everything to memory */
+	if ((flags & FU_CABINET_PARSE_FLAG_EXTRACT_PAYLOADS) == 0) {
+		return fu_cabinet_extract (self, FU_CABINET_DECOMPRESS_KIND_ALL,
+					   NULL, NULL, error);
 	}
 
-	/* the file callback set an error */
-	if (helper.error != NULL) {
-		g_propagate_error (error, helper.error);
+	/* decompress the metadata to memory, and the payloads to disk */
+	if (!fu_cabinet_extract (self, FU_CABINET_DECOMPRESS_KIND_METADATA,
+				 NULL, NULL, error))
 		return FALSE;
-	}
-
-	/* success */
-	return TRUE;
+	return fu_cabinet_extract_payloads (self, error);
 }
 
 /**
@@ -655,6 +815,8 @@ fu_cabinet_parse (FuCabinet *self,
 		  FuCabinetParseFlags flags,
 		  GError **error)
 {
+	const GChecksumType types[] = { G_CHECKSUM_SHA1 };
+	g_auto(GStrv) checksums = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbQuery) query = NULL;
@@ -665,11 +827,12 @@ fu_cabinet_parse (FuCabinet *self,
 	g_return_val_if_fail (self->silo == NULL, FALSE);
 
 	/* decompress */
-	if (!fu_cabinet_decompress (self, data, error))
+	if (!fu_cabinet_decompress (self, data, flags, error))
 		return FALSE;
 
 	/* build xmlb silo */
-	self->container_checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data);
+	checksums = fu_common_checksums_compute (data, types, G_N_ELEMENTS (types));
+	self->container_checksum = g_strdup (checksums[0]);
 	if (!fu_cabinet_build_silo (self, data, error))
 		return FALSE;
 
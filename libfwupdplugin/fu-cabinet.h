@@ -10,6 +10,8 @@
 #include <xmlb.h>
 #include <jcat.h>
 
+#include "fu-jcat-cache.h"
+
 #define FU_TYPE_CABINET (fu_cabinet_get_type ())
 
 G_DECLARE_FINAL_TYPE (FuCabinet, fu_cabinet, FU, CABINET, GObject)
@@ -17,11 +19,13 @@ G_DECLARE_FINAL_TYPE (FuCabinet, fu_cabinet, FU, CABINET, GObject)
 /**
  * FuCabinetParseFlags:
  * @FU_CABINET_PARSE_FLAG_NONE:		No flags set
+ * @FU_CABINET_PARSE_FLAG_EXTRACT_PAYLOADS:	Decompress payloads to disk and map them
  *
  * The flags to use when loading the cabinet.
  **/
 typedef enum {
 	FU_CABINET_PARSE_FLAG_NONE		= 0,
+	FU_CABINET_PARSE_FLAG_EXTRACT_PAYLOADS	= 1 << 0,	/* Since: 1.5.0 */
 	/*< private >*/
 	FU_CABINET_PARSE_FLAG_LAST
 } FuCabinetParseFlags;
@@ -31,6 +35,8 @@ void		 fu_cabinet_set_size_max	(FuCabinet		*self,
 						 guint64		 size_max);
 void		 fu_cabinet_set_jcat_context	(FuCabinet		*self,
 						 JcatContext		*jcat_context);
+void		 fu_cabinet_set_jcat_cache	(FuCabinet		*self,
+						 FuJcatCache		*jcat_cache);
 gboolean	 fu_cabinet_parse		(FuCabinet		*self,
 						 GBytes			*data,
 						 FuCabinetParseFlags	 flags,
@@ -103,6 +103,144 @@ fu_chunk_array_to_string (GPtrArray *chunks)
 	return g_string_free (str, FALSE);
 }
 
+/**
+ * fu_chunk_iter_init: (skip):
+ * @iter: an uninitialized #FuChunkIter
+ * @data: a linear blob of memory, or %NULL
+ * @data_sz: size of @data_sz
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that chunks a linear blob of memory into packets,
+ * ensuring each packet does not cross a page boundary and is less that a
+ * specific transfer size.
+ *
+ * Unlike fu_chunk_array_new() no memory is allocated, and the packet
+ * boundaries are only calculated when fu_chunk_iter_next() is called. The
+ * @data must remain valid for as long as the iterator is used.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_chunk_iter_init (FuChunkIter *iter,
+		    const guint8 *data,
+		    guint32 data_sz,
+		    guint32 addr_start,
+		    guint32 page_sz,
+		    guint32 packet_sz)
+{
+	g_return_if_fail (iter != NULL);
+	iter->data = data;
+	iter->data_sz = data_sz;
+	iter->addr_start = addr_start;
+	iter->page_sz = page_sz;
+	iter->packet_sz = packet_sz;
+	iter->offset = 0;
+	iter->idx = 0;
+}
+
+/**
+ * fu_chunk_iter_init_bytes: (skip):
+ * @iter: an uninitialized #FuChunkIter
+ * @blob: a #GBytes
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that chunks a #GBytes into packets. The caller must
+ * keep a reference to @blob for as long as the iterator is used.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_chunk_iter_init_bytes (FuChunkIter *iter,
+			  GBytes *blob,
+			  guint32 addr_start,
+			  guint32 page_sz,
+			  guint32 packet_sz)
+{
+	gsize sz;
+	const guint8 *data = g_bytes_get_data (blob, &sz);
+	fu_chunk_iter_init (iter, data, (guint32) sz, addr_start, page_sz, packet_sz);
+}
+
+/**
+ * fu_chunk_iter_next: (skip):
+ * @iter: a #FuChunkIter
+ * @chk: (out caller-allocates): a #FuChunk, typically on the stack
+ *
+ * Gets the next packet of chunked data. The @chk data points into the buffer
+ * used to initialize the iterator, and no memory is allocated.
+ *
+ * Returns: %TRUE if @chk was set, or %FALSE if there are no more packets
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_chunk_iter_next (FuChunkIter *iter, FuChunk *chk)
+{
+	guint32 address;
+	guint32 chunk_sz;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (chk != NULL, FALSE);
+
+	if (iter->offset >= iter->data_sz)
+		return FALSE;
+
+	/* do not cross the page boundary or the transfer size */
+	address = iter->addr_start + iter->offset;
+	chunk_sz = iter->data_sz - iter->offset;
+	if (iter->page_sz > 0)
+		chunk_sz = MIN (chunk_sz, iter->page_sz - (address % iter->page_sz));
+	if (iter->packet_sz > 0)
+		chunk_sz = MIN (chunk_sz, iter->packet_sz);
+
+	chk->idx = iter->idx++;
+	chk->page = iter->page_sz > 0 ? address / iter->page_sz : 0;
+	chk->address = iter->page_sz > 0 ? address % iter->page_sz : address;
+	chk->data = iter->data != NULL ? iter->data + iter->offset : NULL;
+	chk->data_sz = chunk_sz;
+	iter->offset += chunk_sz;
+	return TRUE;
+}
+
+/**
+ * fu_chunk_iter_get_count: (skip):
+ * @iter: a #FuChunkIter
+ *
+ * Gets the total number of packets the iterator will return, which is
+ * typically used for progress reporting.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_chunk_iter_get_count (FuChunkIter *iter)
+{
+	FuChunk chk;
+	FuChunkIter iter_tmp;
+	guint32 cnt = 0;
+
+	g_return_val_if_fail (iter != NULL, 0);
+
+	/* no page boundaries to worry about */
+	if (iter->page_sz == 0) {
+		if (iter->packet_sz == 0)
+			return iter->data_sz > 0 ? 1 : 0;
+		return (iter->data_sz + iter->packet_sz - 1) / iter->packet_sz;
+	}
+
+	/* only the boundaries are calculated, so this is cheap */
+	fu_chunk_iter_init (&iter_tmp, NULL, iter->data_sz, iter->addr_start,
+			    iter->page_sz, iter->packet_sz);
+	while (fu_chunk_iter_next (&iter_tmp, &chk))
+		cnt++;
+	return cnt;
+}
+
 /**
  * fu_chunk_array_new: (skip):
  * @data: a linear blob of memory, or %NULL
@@ -114,6 +252,9 @@ fu_chunk_array_to_string (GPtrArray *chunks)
  * Chunks a linear blob of memory into packets, ensuring each packet does not
  * cross a package boundary and is less that a specific transfer size.
  *
+ * For large blobs consider using fu_chunk_iter_init() instead, which does not
+ * allocate each packet up front.
+ *
  * Return value: (transfer container) (element-type FuChunk): array of packets
  *
  * Since: 1.1.2
@@ -125,64 +266,21 @@ fu_chunk_array_new (const guint8 *data,
 		    guint32 page_sz,
 		    guint32 packet_sz)
 {
+	FuChunk chk;
+	FuChunkIter iter;
 	GPtrArray *segments = NULL;
-	guint32 page_old = G_MAXUINT32;
-	guint32 idx;
-	guint32 last_flush = 0;
 
 	g_return_val_if_fail (data_sz > 0, NULL);
 
 	segments = g_ptr_array_new_with_free_func (g_free);
-	for (idx = 1; idx < data_sz; idx++) {
-		guint32 page = 0;
-		if (page_sz > 0)
-			page = (addr_start + idx) / page_sz;
-		if (page_old == G_MAXUINT32) {
-			page_old = page;
-		} else if (page != page_old) {
-			const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-			guint32 address_offset = addr_start + last_flush;
-			if (page_sz > 0)
-				address_offset %= page_sz;
-			g_ptr_array_add (segments,
-					 fu_chunk_new (segments->len,
-						       page_old,
-						       address_offset,
-						       data_offset,
-						       idx - last_flush));
-			last_flush = idx;
-			page_old = page;
-			continue;
-		}
-		if (packet_sz > 0 && idx - last_flush >= packet_sz) {
-			const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-			guint32 address_offset = addr_start + last_flush;
-			if (page_sz > 0)
-				address_offset %= page_sz;
-			g_ptr_array_add (segments,
-					 fu_chunk_new (segments->len,
-						       page,
-						       address_offset,
-						       data_offset,
-						       idx - last_flush));
-			last_flush = idx;
-			continue;
-		}
-	}
-	if (last_flush != idx) {
-		const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-		guint32 address_offset = addr_start + last_flush;
-		guint32 page = 0;
-		if (page_sz > 0) {
-			address_offset %= page_sz;
-			page = (addr_start + (idx - 1)) / page_sz;
-		}
+	fu_chunk_iter_init (&iter, data, data_sz, addr_start, page_sz, packet_sz);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_ptr_array_add (segments,
-				 fu_chunk_new (segments->len,
-					       page,
-					       address_offset,
-					       data_offset,
-					       data_sz - last_flush));
+				 fu_chunk_new (chk.idx,
+					       chk.page,
+					       chk.address,
+					       chk.data,
+					       chk.data_sz));
 	}
 	return segments;
 }
@@ -212,3 +310,54 @@ fu_chunk_array_new_from_bytes (GBytes *blob,
 	return fu_chunk_array_new (data, (guint32) sz,
 				   addr_start, page_sz, packet_sz);
 }
+
+/**
+ * fu_chunk_array_new_diff: (skip):
+ * @blob_old: the current contents, typically read back from the device
+ * @blob_new: the new contents
+ * @addr_start: the hardware address offset, or 0
+ * @sector_sz: the size of the smallest erasable sector
+ *
+ * Splits @blob_new into sectors and returns only the ones where the contents
+ * differ from @blob_old, so that unchanged sectors can be neither erased nor
+ * written. Sectors beyond the end of @blob_old are always included.
+ *
+ * The chunk address is the absolute hardware address of the start of the
+ * sector, and the chunk index is the sector number in @blob_new. The chunk
+ * data points into @blob_new which must outlive the returned array.
+ *
+ * Return value: (transfer container) (element-type FuChunk): array of sectors
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_chunk_array_new_diff (GBytes *blob_old,
+			 GBytes *blob_new,
+			 guint32 addr_start,
+			 guint32 sector_sz)
+{
+	FuChunk chk;
+	FuChunkIter iter;
+	gsize data_old_sz = 0;
+	const guint8 *data_old = g_bytes_get_data (blob_old, &data_old_sz);
+	GPtrArray *segments = NULL;
+
+	g_return_val_if_fail (blob_old != NULL, NULL);
+	g_return_val_if_fail (blob_new != NULL, NULL);
+	g_return_val_if_fail (sector_sz > 0, NULL);
+
+	segments = g_ptr_array_new_with_free_func (g_free);
+	fu_chunk_iter_init_bytes (&iter, blob_new, 0x0, 0x0, sector_sz);
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		if (chk.address + chk.data_sz <= data_old_sz &&
+		    memcmp (data_old + chk.address, chk.data, chk.data_sz) == 0)
+			continue;
+		g_ptr_array_add (segments,
+				 fu_chunk_new (chk.idx,
+					       0x0,
+					       addr_start + chk.address,
+					       chk.data,
+					       chk.data_sz));
+	}
+	return segments;
+}
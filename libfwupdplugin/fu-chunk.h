@@ -17,6 +17,23 @@ typedef struct {
 	guint32		 data_sz;
 } FuChunk;
 
+/**
+ * FuChunkIter:
+ *
+ * An opaque structure used to iterate over packets of chunked data without
+ * allocating memory for each packet.
+ **/
+typedef struct {
+	/*< private >*/
+	const guint8	*data;
+	guint32		 data_sz;
+	guint32		 addr_start;
+	guint32		 page_sz;
+	guint32		 packet_sz;
+	guint32		 offset;
+	guint32		 idx;
+} FuChunkIter;
+
 FuChunk		*fu_chunk_new				(guint32	 idx,
 							 guint32	 page,
 							 guint32	 address,
@@ -34,3 +51,21 @@ GPtrArray	*fu_chunk_array_new_from_bytes		(GBytes		*blob,
 							 guint32	 addr_start,
 							 guint32	 page_sz,
 							 guint32	 packet_sz);
+GPtrArray	*fu_chunk_array_new_diff		(GBytes		*blob_old,
+							 GBytes		*blob_new,
+							 guint32	 addr_start,
+							 guint32	 sector_sz);
+void		 fu_chunk_iter_init			(FuChunkIter	*iter,
+							 const guint8	*data,
+							 guint32	 data_sz,
+							 guint32	 addr_start,
+							 guint32	 page_sz,
+							 guint32	 packet_sz);
+void		 fu_chunk_iter_init_bytes		(FuChunkIter	*iter,
+							 GBytes		*blob,
+							 guint32	 addr_start,
+							 guint32	 page_sz,
+							 guint32	 packet_sz);
+gboolean	 fu_chunk_iter_next			(FuChunkIter	*iter,
+							 FuChunk	*chk);
+guint32		 fu_chunk_iter_get_count		(FuChunkIter	*iter);
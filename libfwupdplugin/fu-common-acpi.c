@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuCommon"
+
+#include <config.h>
+
+#include <string.h>
+
+#include "fwupd-error.h"
+
+#include "fu-common.h"
+#include "fu-common-acpi.h"
+
+/* sizeof(EFI_ACPI_DESCRIPTION_HEADER) */
+#define FU_COMMON_ACPI_HEADER_SIZE		0x24
+
+/* the tables cannot change until the next boot */
+static GHashTable *acpi_table_cache = NULL;	/* filename:GBytes */
+static GMutex acpi_table_cache_mutex;
+
+static GBytes *
+fu_common_acpi_table_load (const gchar *fn, const gchar *signature, GError **error)
+{
+	const guint8 *buf;
+	gsize bufsz = 0;
+	guint8 csum = 0;
+	guint32 length = 0;
+	g_autoptr(GBytes) blob = NULL;
+
+	blob = fu_common_get_contents_bytes (fn, error);
+	if (blob == NULL)
+		return NULL;
+	buf = g_bytes_get_data (blob, &bufsz);
+	if (bufsz < FU_COMMON_ACPI_HEADER_SIZE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "ACPI table %s too small: 0x%x",
+			     signature, (guint) bufsz);
+		return NULL;
+	}
+	if (memcmp (buf, signature, 4) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "ACPI table %s has invalid signature",
+			     signature);
+		return NULL;
+	}
+	length = fu_common_read_uint32 (buf + 0x4, G_LITTLE_ENDIAN);
+	if (length < FU_COMMON_ACPI_HEADER_SIZE || length > bufsz) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "ACPI table %s length 0x%x invalid for size 0x%x",
+			     signature, length, (guint) bufsz);
+		return NULL;
+	}
+
+	/* the kernel only warns about this, so do the same */
+	for (guint32 i = 0; i < length; i++)
+		csum += buf[i];
+	if (csum != 0x0)
+		g_debug ("ACPI table %s has invalid checksum", signature);
+	if (length == bufsz)
+		return g_steal_pointer (&blob);
+	return g_bytes_new_from_bytes (blob, 0, length);
+}
+
+/**
+ * fu_common_get_acpi_table:
+ * @signature: four character table signature, e.g. `DMAR`
+ * @error: A #GError or %NULL
+ *
+ * Loads an ACPI table from the firmware. The table header is validated and
+ * the result is cached so that each table is only read once per boot.
+ *
+ * Returns: (transfer full): the table data including the header, or %NULL
+ *
+ * Since: 1.5.0
+ **/
+GBytes *
+fu_common_get_acpi_table (const gchar *signature, GError **error)
+{
+	GBytes *blob;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *path = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (signature != NULL, NULL);
+	g_return_val_if_fail (strlen (signature) == 4, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* the filename is the key so that the tables can be changed in tests */
+	path = fu_common_get_path (FU_PATH_KIND_ACPI_TABLES);
+	fn = g_build_filename (path, signature, NULL);
+	locker = g_mutex_locker_new (&acpi_table_cache_mutex);
+	if (acpi_table_cache == NULL) {
+		acpi_table_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+							  g_free,
+							  (GDestroyNotify) g_bytes_unref);
+	}
+	blob = g_hash_table_lookup (acpi_table_cache, fn);
+	if (blob != NULL)
+		return g_bytes_ref (blob);
+	blob = fu_common_acpi_table_load (fn, signature, error);
+	if (blob == NULL)
+		return NULL;
+	g_hash_table_insert (acpi_table_cache, g_steal_pointer (&fn), g_bytes_ref (blob));
+	return blob;
+}
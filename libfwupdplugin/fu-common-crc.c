@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuCommon"
+
+#include <config.h>
+
+#include "fu-common-crc.h"
+
+typedef struct {
+	guint		 width;
+	guint32		 poly;
+	guint32		 init;
+	gboolean	 reflected;
+	guint32		 xorout;
+} FuCommonCrcParams;
+
+static const FuCommonCrcParams crc_params[FU_COMMON_CRC_KIND_LAST] = {
+	[FU_COMMON_CRC_KIND_B8_STANDARD]	= { 8, 0x07, 0x00, FALSE, 0x00 },
+	[FU_COMMON_CRC_KIND_B16_USB]		= { 16, 0x8005, 0xffff, TRUE, 0xffff },
+	[FU_COMMON_CRC_KIND_B32_STANDARD]	= { 32, 0x04c11db7, 0xffffffff, TRUE, 0xffffffff },
+	[FU_COMMON_CRC_KIND_B32_MPEG2]		= { 32, 0x04c11db7, 0xffffffff, FALSE, 0x00 },
+};
+
+/* tables 1-7 are only used for slicing-by-8 on 32 bit CRCs */
+static guint32 crc_tables[FU_COMMON_CRC_KIND_LAST][8][256];
+static gsize crc_tables_once[FU_COMMON_CRC_KIND_LAST];
+
+static guint32
+fu_common_crc_reflect (guint32 val, guint width)
+{
+	guint32 tmp = 0;
+	for (guint i = 0; i < width; i++) {
+		if (val & (1u << i))
+			tmp |= 1u << (width - 1 - i);
+	}
+	return tmp;
+}
+
+static guint32
+fu_common_crc_mask (guint width)
+{
+	return width == 32 ? 0xffffffff : (1u << width) - 1;
+}
+
+static void
+fu_common_crc_build_tables (FuCommonCrcKind kind)
+{
+	const FuCommonCrcParams *params = &crc_params[kind];
+	guint32 mask = fu_common_crc_mask (params->width);
+	guint32 (*tables)[256] = crc_tables[kind];
+
+	/* byte-at-a-time table */
+	for (guint i = 0; i < 256; i++) {
+		guint32 crc;
+		if (params->reflected) {
+			guint32 poly = fu_common_crc_reflect (params->poly, params->width);
+			crc = i;
+			for (guint j = 0; j < 8; j++)
+				crc = (crc & 0x1) ? (crc >> 1) ^ poly : crc >> 1;
+		} else {
+			guint32 topbit = 1u << (params->width - 1);
+			crc = (guint32) i << (params->width - 8);
+			for (guint j = 0; j < 8; j++)
+				crc = (crc & topbit) ? (crc << 1) ^ params->poly : crc << 1;
+		}
+		tables[0][i] = crc & mask;
+	}
+
+	/* each extra table advances the CRC by another zero byte */
+	if (params->width != 32)
+		return;
+	for (guint k = 1; k < 8; k++) {
+		for (guint i = 0; i < 256; i++) {
+			guint32 crc = tables[k - 1][i];
+			if (params->reflected)
+				tables[k][i] = (crc >> 8) ^ tables[0][crc & 0xff];
+			else
+				tables[k][i] = (crc << 8) ^ tables[0][crc >> 24];
+		}
+	}
+}
+
+static void
+fu_common_crc_ensure_tables (FuCommonCrcKind kind)
+{
+	if (g_once_init_enter (&crc_tables_once[kind])) {
+		fu_common_crc_build_tables (kind);
+		g_once_init_leave (&crc_tables_once[kind], 1);
+	}
+}
+
+static guint32
+fu_common_crc_step (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz, guint32 crc)
+{
+	const FuCommonCrcParams *params = &crc_params[kind];
+	guint32 mask = fu_common_crc_mask (params->width);
+	guint32 (*tables)[256] = crc_tables[kind];
+
+	fu_common_crc_ensure_tables (kind);
+
+	/* slicing-by-8 */
+	if (params->width == 32 && params->reflected) {
+		for (; bufsz >= 8; bufsz -= 8, buf += 8) {
+			guint32 tmp = crc ^ ((guint32) buf[0] |
+					     (guint32) buf[1] << 8 |
+					     (guint32) buf[2] << 16 |
+					     (guint32) buf[3] << 24);
+			crc = tables[7][tmp & 0xff] ^
+			      tables[6][(tmp >> 8) & 0xff] ^
+			      tables[5][(tmp >> 16) & 0xff] ^
+			      tables[4][tmp >> 24] ^
+			      tables[3][buf[4]] ^
+			      tables[2][buf[5]] ^
+			      tables[1][buf[6]] ^
+			      tables[0][buf[7]];
+		}
+	} else if (params->width == 32) {
+		for (; bufsz >= 8; bufsz -= 8, buf += 8) {
+			guint32 tmp = crc ^ ((guint32) buf[0] << 24 |
+					     (guint32) buf[1] << 16 |
+					     (guint32) buf[2] << 8 |
+					     (guint32) buf[3]);
+			crc = tables[7][tmp >> 24] ^
+			      tables[6][(tmp >> 16) & 0xff] ^
+			      tables[5][(tmp >> 8) & 0xff] ^
+			      tables[4][tmp & 0xff] ^
+			      tables[3][buf[4]] ^
+			      tables[2][buf[5]] ^
+			      tables[1][buf[6]] ^
+			      tables[0][buf[7]];
+		}
+	}
+
+	/* remaining bytes */
+	for (gsize i = 0; i < bufsz; i++) {
+		if (params->reflected) {
+			crc = (crc >> 8) ^ tables[0][(crc ^ buf[i]) & 0xff];
+		} else {
+			guint32 idx = ((crc >> (params->width - 8)) ^ buf[i]) & 0xff;
+			crc = ((crc << 8) ^ tables[0][idx]) & mask;
+		}
+	}
+	return crc;
+}
+
+static gboolean
+fu_common_crc_kind_is_width (FuCommonCrcKind kind, guint width)
+{
+	if (kind <= FU_COMMON_CRC_KIND_UNKNOWN || kind >= FU_COMMON_CRC_KIND_LAST)
+		return FALSE;
+	return crc_params[kind].width == width;
+}
+
+/**
+ * fu_common_crc8_step:
+ * @kind: A #FuCommonCrcKind, e.g. %FU_COMMON_CRC_KIND_B8_STANDARD
+ * @buf: memory buffer
+ * @bufsz: sizeof buf
+ * @crc: initial CRC value
+ *
+ * Computes the cumulative CRC-8 value for @buf. No final XOR is applied.
+ *
+ * Returns: CRC value
+ *
+ * Since: 1.5.0
+ **/
+guint8
+fu_common_crc8_step (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz, guint8 crc)
+{
+	g_return_val_if_fail (fu_common_crc_kind_is_width (kind, 8), 0x0);
+	return (guint8) fu_common_crc_step (kind, buf, bufsz, crc);
+}
+
+/**
+ * fu_common_crc8:
+ * @kind: A #FuCommonCrcKind, e.g. %FU_COMMON_CRC_KIND_B8_STANDARD
+ * @buf: memory buffer
+ * @bufsz: sizeof buf
+ *
+ * Computes the CRC-8 value for @buf.
+ *
+ * Returns: CRC value
+ *
+ * Since: 1.5.0
+ **/
+guint8
+fu_common_crc8 (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz)
+{
+	g_return_val_if_fail (fu_common_crc_kind_is_width (kind, 8), 0x0);
+	return (guint8) (fu_common_crc_step (kind, buf, bufsz, crc_params[kind].init) ^
+			 crc_params[kind].xorout);
+}
+
+/**
+ * fu_common_crc16_step:
+ * @kind: A #FuCommonCrcKind, e.g. %FU_COMMON_CRC_KIND_B16_USB
+ * @buf: memory buffer
+ * @bufsz: sizeof buf
+ * @crc: initial CRC value
+ *
+ * Computes the cumulative CRC-16 value for @buf. No final XOR is applied.
+ *
+ * Returns: CRC value
+ *
+ * Since: 1.5.0
+ **/
+guint16
+fu_common_crc16_step (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz, guint16 crc)
+{
+	g_return_val_if_fail (fu_common_crc_kind_is_width (kind, 16), 0x0);
+	return (guint16) fu_common_crc_step (kind, buf, bufsz, crc);
+}
+
+/**
+ * fu_common_crc16:
+ * @kind: A #FuCommonCrcKind, e.g. %FU_COMMON_CRC_KIND_B16_USB
+ * @buf: memory buffer
+ * @bufsz: sizeof buf
+ *
+ * Computes the CRC-16 value for @buf.
+ *
+ * Returns: CRC value
+ *
+ * Since: 1.5.0
+ **/
+guint16
+fu_common_crc16 (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz)
+{
+	g_return_val_if_fail (fu_common_crc_kind_is_width (kind, 16), 0x0);
+	return (guint16) (fu_common_crc_step (kind, buf, bufsz, crc_params[kind].init) ^
+			  crc_params[kind].xorout);
+}
+
+/**
+ * fu_common_crc32_step:
+ * @kind: A #FuCommonCrcKind, e.g. %FU_COMMON_CRC_KIND_B32_STANDARD
+ * @buf: memory buffer
+ * @bufsz: sizeof buf
+ * @crc: initial CRC value
+ *
+ * Computes the cumulative CRC-32 value for @buf. No final XOR is applied.
+ *
+ * Returns: CRC value
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_common_crc32_step (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz, guint32 crc)
+{
+	g_return_val_if_fail (fu_common_crc_kind_is_width (kind, 32), 0x0);
+	return fu_common_crc_step (kind, buf, bufsz, crc);
+}
+
+/**
+ * fu_common_crc32:
+ * @kind: A #FuCommonCrcKind, e.g. %FU_COMMON_CRC_KIND_B32_STANDARD
+ * @buf: memory buffer
+ * @bufsz: sizeof buf
+ *
+ * Computes the CRC-32 value for @buf.
+ *
+ * Returns: CRC value
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_common_crc32 (FuCommonCrcKind kind, const guint8 *buf, gsize bufsz)
+{
+	g_return_val_if_fail (fu_common_crc_kind_is_width (kind, 32), 0x0);
+	return fu_common_crc_step (kind, buf, bufsz, crc_params[kind].init) ^
+	       crc_params[kind].xorout;
+}
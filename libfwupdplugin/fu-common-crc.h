@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+/**
+ * FuCommonCrcKind:
+ * @FU_COMMON_CRC_KIND_UNKNOWN:		Unknown kind
+ * @FU_COMMON_CRC_KIND_B8_STANDARD:	CRC-8, polynomial 0x07, init 0x00
+ * @FU_COMMON_CRC_KIND_B16_USB:		CRC-16/USB, reflected polynomial 0x8005, init 0xffff, inverted
+ * @FU_COMMON_CRC_KIND_B32_STANDARD:	CRC-32 as used by zlib, reflected polynomial 0x04c11db7, init 0xffffffff, inverted
+ * @FU_COMMON_CRC_KIND_B32_MPEG2:	CRC-32/MPEG-2 as used by STM32, polynomial 0x04c11db7, init 0xffffffff
+ *
+ * The CRC algorithm, including the width, polynomial and initial value.
+ **/
+typedef enum {
+	FU_COMMON_CRC_KIND_UNKNOWN,
+	FU_COMMON_CRC_KIND_B8_STANDARD,
+	FU_COMMON_CRC_KIND_B16_USB,
+	FU_COMMON_CRC_KIND_B32_STANDARD,
+	FU_COMMON_CRC_KIND_B32_MPEG2,
+	/*< private >*/
+	FU_COMMON_CRC_KIND_LAST
+} FuCommonCrcKind;
+
+guint8		 fu_common_crc8			(FuCommonCrcKind kind,
+						 const guint8	*buf,
+						 gsize		 bufsz);
+guint8		 fu_common_crc8_step		(FuCommonCrcKind kind,
+						 const guint8	*buf,
+						 gsize		 bufsz,
+						 guint8		 crc);
+guint16		 fu_common_crc16		(FuCommonCrcKind kind,
+						 const guint8	*buf,
+						 gsize		 bufsz);
+guint16		 fu_common_crc16_step		(FuCommonCrcKind kind,
+						 const guint8	*buf,
+						 gsize		 bufsz,
+						 guint16	 crc);
+guint32		 fu_common_crc32		(FuCommonCrcKind kind,
+						 const guint8	*buf,
+						 gsize		 bufsz);
+guint32		 fu_common_crc32_step		(FuCommonCrcKind kind,
+						 const guint8	*buf,
+						 gsize		 bufsz,
+						 guint32	 crc);
@@ -464,6 +464,152 @@ fu_common_version_verify_format (const gchar *version,
 	return TRUE;
 }
 
+struct _FuCommonVersion {
+	gchar			*str;
+	gchar			**split;
+	gint64			*nums;		/* numeric part of each section */
+	const gchar		**suffixes;	/* (nullable): points into split */
+	guint			 len;
+};
+
+/**
+ * fu_common_version_new:
+ * @version: the release version, e.g. 1.2.3
+ *
+ * Parses a version string so that it can be compared many times without
+ * splitting the string again, for instance when sorting releases.
+ *
+ * Returns: (transfer full): a #FuCommonVersion, or %NULL if @version is %NULL
+ *
+ * Since: 1.5.0
+ **/
+FuCommonVersion *
+fu_common_version_new (const gchar *version)
+{
+	FuCommonVersion *self;
+
+	if (version == NULL)
+		return NULL;
+	self = g_new0 (FuCommonVersion, 1);
+	self->str = g_strdup (version);
+	self->split = g_strsplit (version, ".", -1);
+	self->len = g_strv_length (self->split);
+	self->nums = g_new0 (gint64, self->len);
+	self->suffixes = g_new0 (const gchar *, self->len);
+	for (guint i = 0; i < self->len; i++) {
+		gchar *endptr = NULL;
+		self->nums[i] = g_ascii_strtoll (self->split[i], &endptr, 10);
+		if (endptr != NULL && endptr[0] != '\0')
+			self->suffixes[i] = endptr;
+	}
+	return self;
+}
+
+/**
+ * fu_common_version_free:
+ * @self: (nullable): a #FuCommonVersion
+ *
+ * Frees a parsed version.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_common_version_free (FuCommonVersion *self)
+{
+	if (self == NULL)
+		return;
+	g_free (self->str);
+	g_strfreev (self->split);
+	g_free (self->nums);
+	g_free (self->suffixes);
+	g_free (self);
+}
+
+/**
+ * fu_common_version_get_str:
+ * @self: a #FuCommonVersion
+ *
+ * Gets the version string that was parsed.
+ *
+ * Returns: the version, e.g. 1.2.3
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_common_version_get_str (FuCommonVersion *self)
+{
+	g_return_val_if_fail (self != NULL, NULL);
+	return self->str;
+}
+
+/**
+ * fu_common_version_compare:
+ * @version_a: (nullable): a #FuCommonVersion
+ * @version_b: (nullable): a #FuCommonVersion
+ * @fmt: a #FwupdVersionFormat, e.g. %FWUPD_VERSION_FORMAT_PLAIN
+ *
+ * Compares parsed version numbers for sorting, with the same rules as
+ * fu_common_vercmp_full().
+ *
+ * Returns: -1 if a < b, +1 if a > b, 0 if they are equal, and %G_MAXINT on error
+ *
+ * Since: 1.5.0
+ **/
+gint
+fu_common_version_compare (FuCommonVersion *version_a,
+			   FuCommonVersion *version_b,
+			   FwupdVersionFormat fmt)
+{
+	guint longest_split;
+
+	if (fmt == FWUPD_VERSION_FORMAT_PLAIN) {
+		return g_strcmp0 (version_a != NULL ? version_a->str : NULL,
+				  version_b != NULL ? version_b->str : NULL);
+	}
+
+	/* sanity check */
+	if (version_a == NULL || version_b == NULL)
+		return G_MAXINT;
+
+	/* optimisation */
+	if (g_strcmp0 (version_a->str, version_b->str) == 0)
+		return 0;
+
+	/* compare each section */
+	longest_split = MAX (version_a->len, version_b->len);
+	for (guint i = 0; i < longest_split; i++) {
+		const gchar *suffix_a;
+		const gchar *suffix_b;
+
+		/* we lost or gained a dot */
+		if (i >= version_a->len)
+			return -1;
+		if (i >= version_b->len)
+			return 1;
+
+		/* compare integers */
+		if (version_a->nums[i] < version_b->nums[i])
+			return -1;
+		if (version_a->nums[i] > version_b->nums[i])
+			return 1;
+
+		/* compare strings */
+		suffix_a = version_a->suffixes[i];
+		suffix_b = version_b->suffixes[i];
+		if (suffix_a != NULL || suffix_b != NULL) {
+			gint rc = fu_common_vercmp_chunk (suffix_a != NULL ? suffix_a : "",
+							  suffix_b != NULL ? suffix_b : "");
+			if (rc < 0)
+				return -1;
+			if (rc > 0)
+				return 1;
+		}
+	}
+
+	/* we really shouldn't get here */
+	return 0;
+}
+
 /**
  * fu_common_vercmp_full:
  * @version_a: the semver release version, e.g. 1.2.3
@@ -501,9 +647,8 @@ fu_common_vercmp_full (const gchar *version_a,
 gint
 fu_common_vercmp (const gchar *version_a, const gchar *version_b)
 {
-	guint longest_split;
-	g_auto(GStrv) split_a = NULL;
-	g_auto(GStrv) split_b = NULL;
+	g_autoptr(FuCommonVersion) ver_a = NULL;
+	g_autoptr(FuCommonVersion) ver_b = NULL;
 
 	/* sanity check */
 	if (version_a == NULL || version_b == NULL)
@@ -513,41 +658,7 @@ fu_common_vercmp (const gchar *version_a, const gchar *version_b)
 	if (g_strcmp0 (version_a, version_b) == 0)
 		return 0;
 
-	/* split into sections, and try to parse */
-	split_a = g_strsplit (version_a, ".", -1);
-	split_b = g_strsplit (version_b, ".", -1);
-	longest_split = MAX (g_strv_length (split_a), g_strv_length (split_b));
-	for (guint i = 0; i < longest_split; i++) {
-		gchar *endptr_a = NULL;
-		gchar *endptr_b = NULL;
-		gint64 ver_a;
-		gint64 ver_b;
-
-		/* we lost or gained a dot */
-		if (split_a[i] == NULL)
-			return -1;
-		if (split_b[i] == NULL)
-			return 1;
-
-		/* compare integers */
-		ver_a = g_ascii_strtoll (split_a[i], &endptr_a, 10);
-		ver_b = g_ascii_strtoll (split_b[i], &endptr_b, 10);
-		if (ver_a < ver_b)
-			return -1;
-		if (ver_a > ver_b)
-			return 1;
-
-		/* compare strings */
-		if ((endptr_a != NULL && endptr_a[0] != '\0') ||
-		    (endptr_b != NULL && endptr_b[0] != '\0')) {
-			gint rc = fu_common_vercmp_chunk (endptr_a, endptr_b);
-			if (rc < 0)
-				return -1;
-			if (rc > 0)
-				return 1;
-		}
-	}
-
-	/* we really shouldn't get here */
-	return 0;
+	ver_a = fu_common_version_new (version_a);
+	ver_b = fu_common_version_new (version_b);
+	return fu_common_version_compare (ver_a, ver_b, FWUPD_VERSION_FORMAT_UNKNOWN);
 }
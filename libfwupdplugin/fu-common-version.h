@@ -9,6 +9,13 @@
 #include <gio/gio.h>
 #include <fwupd.h>
 
+/**
+ * FuCommonVersion:
+ *
+ * A parsed version string that can be compared cheaply.
+ **/
+typedef struct _FuCommonVersion FuCommonVersion;
+
 gint		 fu_common_vercmp		(const gchar	*version_a,
 						 const gchar	*version_b)
 G_DEPRECATED_FOR(fu_common_vercmp_full);
@@ -30,3 +37,12 @@ FwupdVersionFormat	 fu_common_version_guess_format	(const gchar	*version);
 gboolean	 fu_common_version_verify_format	(const gchar	*version,
 							 FwupdVersionFormat fmt,
 							 GError		**error);
+
+FuCommonVersion	*fu_common_version_new		(const gchar	*version);
+void		 fu_common_version_free		(FuCommonVersion *self);
+const gchar	*fu_common_version_get_str	(FuCommonVersion *self);
+gint		 fu_common_version_compare	(FuCommonVersion *version_a,
+						 FuCommonVersion *version_b,
+						 FwupdVersionFormat fmt);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuCommonVersion, fu_common_version_free)
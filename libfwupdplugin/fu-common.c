@@ -22,10 +22,17 @@
 #ifdef HAVE_CPUID_H
 #include <cpuid.h>
 #endif
+#ifdef HAVE_LINUX_IF_ALG_H
+#include <linux/if_alg.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include <archive_entry.h>
 #include <archive.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <limits.h>
 #include <string.h>
 #include <stdlib.h>
@@ -33,6 +40,10 @@
 #include "fwupd-error.h"
 
 #include "fu-common.h"
+#include "fu-firmware-builder.h"
+
+/* files smaller than this are just read into the heap */
+#define FU_COMMON_CONTENTS_MAPPED_SIZE_MIN	0x100000	/* bytes */
 
 /**
  * SECTION:fu-common
@@ -207,6 +218,9 @@ fu_common_set_contents_bytes (const gchar *filename, GBytes *bytes, GError **err
  *
  * Reads a blob of data from a file.
  *
+ * Large regular files are mapped into memory rather than copied, and so
+ * the file must not be modified while the returned #GBytes is in use.
+ *
  * Returns: a #GBytes, or %NULL for failure
  *
  * Since: 0.9.7
@@ -216,19 +230,62 @@ fu_common_get_contents_bytes (const gchar *filename, GError **error)
 {
 	gchar *data = NULL;
 	gsize len = 0;
+	GStatBuf st;
+
+	/* map large regular files rather than copying them to the heap */
+	if (g_stat (filename, &st) == 0 && S_ISREG (st.st_mode) &&
+	    st.st_size >= FU_COMMON_CONTENTS_MAPPED_SIZE_MIN) {
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GMappedFile) mapped_file = NULL;
+		mapped_file = g_mapped_file_new (filename, FALSE, &error_local);
+		if (mapped_file != NULL) {
+			g_debug ("mapping %s with %" G_GSIZE_FORMAT " bytes",
+				 filename, g_mapped_file_get_length (mapped_file));
+			return g_mapped_file_get_bytes (mapped_file);
+		}
+		g_debug ("failed to map %s, reading instead: %s",
+			 filename, error_local->message);
+	}
 	if (!g_file_get_contents (filename, &data, &len, error))
 		return NULL;
 	g_debug ("reading %s with %" G_GSIZE_FORMAT " bytes", filename, len);
 	return g_bytes_new_take (data, len);
 }
 
+#if defined(HAVE_GIO_UNIX) && defined(F_GET_SEALS)
+/* a memfd sealed against writes and resizes cannot change after it has been
+ * checked, so it is safe to use the mapping rather than taking a copy */
+static GBytes *
+fu_common_get_contents_fd_sealed (gint fd, gsize count)
+{
+	gint seals = fcntl (fd, F_GET_SEALS);
+	gint seals_required = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+	struct stat st;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	if (seals < 0 || (seals & seals_required) != seals_required)
+		return NULL;
+	if (fstat (fd, &st) < 0 || st.st_size == 0 || (gsize) st.st_size > count)
+		return NULL;
+	mapped_file = g_mapped_file_new_from_fd (fd, FALSE, &error_local);
+	if (mapped_file == NULL) {
+		g_debug ("failed to map sealed fd: %s", error_local->message);
+		return NULL;
+	}
+	return g_mapped_file_get_bytes (mapped_file);
+}
+#endif
+
 /**
  * fu_common_get_contents_fd:
  * @fd: A file descriptor
  * @count: The maximum number of bytes to read
  * @error: A #GError, or %NULL
  *
- * Reads a blob from a specific file descriptor.
+ * Reads a blob from a specific file descriptor. If @fd is a memfd that has
+ * been sealed against writing and resizing then the contents are mapped
+ * rather than copied.
  *
  * Note: this will close the fd when done
  *
@@ -256,6 +313,15 @@ fu_common_get_contents_fd (gint fd, gsize count, GError **error)
 		return NULL;
 	}
 
+#ifdef F_GET_SEALS
+	/* the mapping does not need the fd to stay open */
+	blob = fu_common_get_contents_fd_sealed (fd, count);
+	if (blob != NULL) {
+		g_close (fd, NULL);
+		return g_steal_pointer (&blob);
+	}
+#endif
+
 	/* read the entire fd to a data blob */
 	stream = g_unix_input_stream_new (fd, TRUE);
 	blob = g_input_stream_read_bytes (stream, count, NULL, &error_local);
@@ -368,25 +434,6 @@ out:
 	return ret;
 }
 
-static void
-fu_common_add_argv (GPtrArray *argv, const gchar *fmt, ...) G_GNUC_PRINTF (2, 3);
-
-static void
-fu_common_add_argv (GPtrArray *argv, const gchar *fmt, ...)
-{
-	va_list args;
-	g_autofree gchar *tmp = NULL;
-	g_auto(GStrv) split = NULL;
-
-	va_start (args, fmt);
-	tmp = g_strdup_vprintf (fmt, args);
-	va_end (args);
-
-	split = g_strsplit (tmp, " ", -1);
-	for (guint i = 0; split[i] != NULL; i++)
-		g_ptr_array_add (argv, g_strdup (split[i]));
-}
-
 /**
  * fu_common_find_program_in_path:
  * @basename: The program to search
@@ -413,32 +460,6 @@ fu_common_find_program_in_path (const gchar *basename, GError **error)
 	return fn;
 }
 
-static gboolean
-fu_common_test_namespace_support (GError **error)
-{
-	/* test if CONFIG_USER_NS is valid */
-	if (!g_file_test ("/proc/self/ns/user", G_FILE_TEST_IS_SYMLINK)) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_SUPPORTED,
-			     "missing CONFIG_USER_NS in kernel");
-		return FALSE;
-	}
-	if (g_file_test ("/proc/sys/kernel/unprivileged_userns_clone", G_FILE_TEST_EXISTS)) {
-		g_autofree gchar *clone = NULL;
-		if (!g_file_get_contents ("/proc/sys/kernel/unprivileged_userns_clone", &clone, NULL, error))
-			return FALSE;
-		if (g_ascii_strtoll (clone, NULL, 10) == 0) {
-			g_set_error (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_SUPPORTED,
-				     "unprivileged user namespace clones disabled by distro");
-			return FALSE;
-		}
-	}
-	return TRUE;
-}
-
 /**
  * fu_common_firmware_builder:
  * @bytes: The data to use
@@ -465,101 +486,8 @@ fu_common_firmware_builder (GBytes *bytes,
 			    const gchar *output_fn,
 			    GError **error)
 {
-	gint rc = 0;
-	g_autofree gchar *argv_str = NULL;
-	g_autofree gchar *bwrap_fn = NULL;
-	g_autofree gchar *localstatebuilderdir = NULL;
-	g_autofree gchar *localstatedir = NULL;
-	g_autofree gchar *output2_fn = NULL;
-	g_autofree gchar *standard_error = NULL;
-	g_autofree gchar *standard_output = NULL;
-	g_autofree gchar *tmpdir = NULL;
-	g_autoptr(GBytes) firmware_blob = NULL;
-	g_autoptr(GPtrArray) argv = g_ptr_array_new_with_free_func (g_free);
-
-	g_return_val_if_fail (bytes != NULL, NULL);
-	g_return_val_if_fail (script_fn != NULL, NULL);
-	g_return_val_if_fail (output_fn != NULL, NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
-	/* find bwrap in the path */
-	bwrap_fn = fu_common_find_program_in_path ("bwrap", error);
-	if (bwrap_fn == NULL)
-		return NULL;
-
-	/* test if CONFIG_USER_NS is valid */
-	if (!fu_common_test_namespace_support (error))
-		return NULL;
-
-	/* untar file to temp location */
-	tmpdir = g_dir_make_tmp ("fwupd-gen-XXXXXX", error);
-	if (tmpdir == NULL)
-		return NULL;
-	if (!fu_common_extract_archive (bytes, tmpdir, error))
-		return NULL;
-
-	/* this is shared with the plugins */
-	localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
-	localstatebuilderdir = g_build_filename (localstatedir, "builder", NULL);
-
-	/* launch bubblewrap and generate firmware */
-	g_ptr_array_add (argv, g_steal_pointer (&bwrap_fn));
-	fu_common_add_argv (argv, "--die-with-parent");
-	fu_common_add_argv (argv, "--ro-bind /usr /usr");
-	fu_common_add_argv (argv, "--ro-bind /lib /lib");
-	fu_common_add_argv (argv, "--ro-bind /lib64 /lib64");
-	fu_common_add_argv (argv, "--ro-bind /bin /bin");
-	fu_common_add_argv (argv, "--ro-bind /sbin /sbin");
-	fu_common_add_argv (argv, "--dir /tmp");
-	fu_common_add_argv (argv, "--dir /var");
-	fu_common_add_argv (argv, "--bind %s /tmp", tmpdir);
-	if (g_file_test (localstatebuilderdir, G_FILE_TEST_EXISTS))
-		fu_common_add_argv (argv, "--ro-bind %s /boot", localstatebuilderdir);
-	fu_common_add_argv (argv, "--dev /dev");
-	fu_common_add_argv (argv, "--chdir /tmp");
-	fu_common_add_argv (argv, "--unshare-all");
-	fu_common_add_argv (argv, "/tmp/%s", script_fn);
-	g_ptr_array_add (argv, NULL);
-	argv_str = g_strjoinv (" ", (gchar **) argv->pdata);
-	g_debug ("running '%s' in %s", argv_str, tmpdir);
-	if (!g_spawn_sync ("/tmp",
-			   (gchar **) argv->pdata,
-			   NULL,
-			   G_SPAWN_SEARCH_PATH,
-			   NULL, NULL, /* child_setup */
-			   &standard_output,
-			   &standard_error,
-			   &rc,
-			   error)) {
-		g_prefix_error (error, "failed to run '%s': ", argv_str);
-		return NULL;
-	}
-	if (standard_output != NULL && standard_output[0] != '\0')
-		g_debug ("console output was: %s", standard_output);
-	if (rc != 0) {
-		FwupdError code = FWUPD_ERROR_INTERNAL;
-		if (errno == ENOTTY)
-			code = FWUPD_ERROR_PERMISSION_DENIED;
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     code,
-			     "failed to build firmware: %s",
-			     standard_error);
-		return NULL;
-	}
-
-	/* get generated file */
-	output2_fn = g_build_filename (tmpdir, output_fn, NULL);
-	firmware_blob = fu_common_get_contents_bytes (output2_fn, error);
-	if (firmware_blob == NULL)
-		return NULL;
-
-	/* cleanup temp directory */
-	if (!fu_common_rmtree (tmpdir, error))
-		return NULL;
-
-	/* success */
-	return g_steal_pointer (&firmware_blob);
+	g_autoptr(FuFirmwareBuilder) builder = fu_firmware_builder_new ();
+	return fu_firmware_builder_build (builder, bytes, script_fn, output_fn, error);
 }
 
 typedef struct {
@@ -1356,6 +1284,57 @@ fu_common_string_append_kb (GString *str, guint idt, const gchar *key, gboolean
 	fu_common_string_append_kv (str, idt, key, value ? "true" : "false");
 }
 
+/* the verbose domains are checked for every message and dumped buffer, so
+ * only split the environment variable again when it is changed */
+static GMutex		 debug_domains_mutex;
+static gchar		*debug_domains_str = NULL;
+static gchar		**debug_domains = NULL;
+
+static gboolean
+fu_common_debug_domains_contains (const gchar *env, const gchar *log_domain)
+{
+	const gchar *domains = g_getenv (env);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	if (domains == NULL)
+		return FALSE;
+	if (g_strcmp0 (domains, "*") == 0 || g_strcmp0 (domains, "all") == 0)
+		return TRUE;
+	if (log_domain == NULL)
+		return FALSE;
+	locker = g_mutex_locker_new (&debug_domains_mutex);
+	if (g_strcmp0 (domains, debug_domains_str) != 0) {
+		g_free (debug_domains_str);
+		g_strfreev (debug_domains);
+		debug_domains_str = g_strdup (domains);
+		debug_domains = g_strsplit_set (domains, ", ", -1);
+	}
+	return g_strv_contains ((const gchar * const *) debug_domains, log_domain);
+}
+
+/**
+ * fu_common_debug_enabled:
+ * @log_domain: log domain, typically %G_LOG_DOMAIN or %NULL
+ *
+ * Checks if debug messages for @log_domain will be shown, using the same
+ * `FWUPD_VERBOSE` domains as set by `--verbose` and `--daemon-verbose`, or
+ * `G_MESSAGES_DEBUG` when running without the fwupd log handler.
+ *
+ * This should be used to avoid building expensive debugging strings that
+ * would be thrown away.
+ *
+ * Returns: %TRUE if debugging is enabled for the domain
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_common_debug_enabled (const gchar *log_domain)
+{
+	if (g_getenv ("FWUPD_VERBOSE") != NULL)
+		return fu_common_debug_domains_contains ("FWUPD_VERBOSE", log_domain);
+	return fu_common_debug_domains_contains ("G_MESSAGES_DEBUG", log_domain);
+}
+
 /**
  * fu_common_dump_full:
  * @log_domain: log domain, typically %G_LOG_DOMAIN or %NULL
@@ -1377,9 +1356,14 @@ fu_common_dump_full (const gchar *log_domain,
 		     guint columns,
 		     FuDumpFlags flags)
 {
-	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(GString) str = NULL;
+
+	/* nobody is going to see this */
+	if (!fu_common_debug_enabled (log_domain))
+		return;
 
 	/* optional */
+	str = g_string_new (NULL);
 	if (title != NULL)
 		g_string_append_printf (str, "%s:", title);
 
@@ -1515,16 +1499,96 @@ fu_common_bytes_align (GBytes *bytes, gsize blksz, gchar padval)
  *
  * Since: 1.2.6
  **/
+/* every byte equals the one after it, so the libc memcmp() can be used */
+static gboolean
+fu_common_buf_is_empty (const guint8 *buf, gsize bufsz)
+{
+	if (bufsz == 0)
+		return TRUE;
+	if (buf[0] != 0xff)
+		return FALSE;
+	return memcmp (buf, buf + 1, bufsz - 1) == 0;
+}
+
 gboolean
 fu_common_bytes_is_empty (GBytes *bytes)
 {
 	gsize sz = 0;
 	const guint8 *buf = g_bytes_get_data (bytes, &sz);
-	for (gsize i = 0; i < sz; i++) {
-		if (buf[i] != 0xff)
-			return FALSE;
+	return fu_common_buf_is_empty (buf, sz);
+}
+
+/**
+ * fu_common_bytes_find_not_empty_raw:
+ * @buf: a buffer
+ * @bufsz: sizeof @buf
+ * @block_sz: the block size, e.g. the flash sector size
+ * @offset: (inout): the offset to start searching from
+ *
+ * Finds the next block in @buf that contains something other than empty
+ * (0xff) bytes. @offset is set to the start of the block if found, and so
+ * calling this function again with @offset incremented by @block_sz will find
+ * the next block. The last block may be shorter than @block_sz.
+ *
+ * Return value: %TRUE if a non-empty block was found
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_common_bytes_find_not_empty_raw (const guint8 *buf,
+				    gsize bufsz,
+				    gsize block_sz,
+				    gsize *offset)
+{
+	g_return_val_if_fail (buf != NULL || bufsz == 0, FALSE);
+	g_return_val_if_fail (block_sz > 0, FALSE);
+	g_return_val_if_fail (offset != NULL, FALSE);
+
+	for (gsize i = *offset; i < bufsz; i += block_sz) {
+		if (!fu_common_buf_is_empty (buf + i, MIN (block_sz, bufsz - i))) {
+			*offset = i;
+			return TRUE;
+		}
 	}
-	return TRUE;
+	return FALSE;
+}
+
+/**
+ * fu_common_bytes_find_diff_raw:
+ * @buf1: a buffer
+ * @buf2: another buffer
+ * @bufsz: the size of both @buf1 and @buf2
+ * @block_sz: the block size, e.g. the flash sector size
+ * @offset: (inout): the offset to start searching from
+ *
+ * Finds the next block where @buf1 and @buf2 differ. @offset is set to the
+ * start of the block if found, and so calling this function again with @offset
+ * incremented by @block_sz will find the next block. The last block may be
+ * shorter than @block_sz.
+ *
+ * Return value: %TRUE if a differing block was found
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_common_bytes_find_diff_raw (const guint8 *buf1,
+			       const guint8 *buf2,
+			       gsize bufsz,
+			       gsize block_sz,
+			       gsize *offset)
+{
+	g_return_val_if_fail (buf1 != NULL || bufsz == 0, FALSE);
+	g_return_val_if_fail (buf2 != NULL || bufsz == 0, FALSE);
+	g_return_val_if_fail (block_sz > 0, FALSE);
+	g_return_val_if_fail (offset != NULL, FALSE);
+
+	for (gsize i = *offset; i < bufsz; i += block_sz) {
+		if (memcmp (buf1 + i, buf2 + i, MIN (block_sz, bufsz - i)) != 0) {
+			*offset = i;
+			return TRUE;
+		}
+	}
+	return FALSE;
 }
 
 /**
@@ -1560,14 +1624,16 @@ fu_common_bytes_compare_raw (const guint8 *buf1, gsize bufsz1,
 		return FALSE;
 	}
 
-	/* check matches */
-	for (guint i = 0x0; i < bufsz1; i++) {
+	/* check matches, only looking for the offset on failure */
+	if (memcmp (buf1, buf2, bufsz1) == 0)
+		return TRUE;
+	for (gsize i = 0x0; i < bufsz1; i++) {
 		if (buf1[i] != buf2[i]) {
 			g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_INVALID_DATA,
 			     "got 0x%02x, expected 0x%02x @ 0x%04x",
-			     buf1[i], buf2[i], i);
+			     buf1[i], buf2[i], (guint) i);
 			return FALSE;
 		}
 	}
@@ -1637,6 +1703,261 @@ fu_common_bytes_pad (GBytes *bytes, gsize sz)
 	return g_bytes_ref (bytes);
 }
 
+/**
+ * fu_common_bytes_new_offset:
+ * @bytes: a #GBytes
+ * @offset: where subsection starts at
+ * @length: length of subsection
+ * @error: A #GError or %NULL
+ *
+ * Creates a #GBytes which is a subsection of another #GBytes, without copying
+ * the data. The parent #GBytes is kept alive for as long as the subsection.
+ *
+ * Return value: (transfer full): a #GBytes, or #NULL if range is invalid
+ *
+ * Since: 1.5.0
+ **/
+GBytes *
+fu_common_bytes_new_offset (GBytes *bytes,
+			    gsize offset,
+			    gsize length,
+			    GError **error)
+{
+	g_return_val_if_fail (bytes != NULL, NULL);
+
+	/* sanity check */
+	if (offset > g_bytes_get_size (bytes) ||
+	    length > g_bytes_get_size (bytes) - offset) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "cannot create bytes @0x%02x for 0x%02x "
+			     "as buffer only 0x%04x bytes in size",
+			     (guint) offset,
+			     (guint) length,
+			     (guint) g_bytes_get_size (bytes));
+		return NULL;
+	}
+	return g_bytes_new_from_bytes (bytes, offset, length);
+}
+
+#ifdef HAVE_LINUX_IF_ALG_H
+/* only worth the syscall overhead for larger images */
+#define FU_COMMON_CHECKSUMS_ALG_SIZE_MIN	0x100000
+
+static const gchar *
+fu_common_checksum_type_to_alg (GChecksumType type)
+{
+	if (type == G_CHECKSUM_MD5)
+		return "md5";
+	if (type == G_CHECKSUM_SHA1)
+		return "sha1";
+	if (type == G_CHECKSUM_SHA256)
+		return "sha256";
+	if (type == G_CHECKSUM_SHA512)
+		return "sha512";
+	return NULL;
+}
+
+static gint
+fu_common_checksum_alg_open (GChecksumType type)
+{
+	const gchar *name = fu_common_checksum_type_to_alg (type);
+	gint fd_opfd;
+	gint fd_tfm;
+	struct sockaddr_alg sa = {
+		.salg_family = AF_ALG,
+		.salg_type = "hash",
+	};
+
+	if (name == NULL)
+		return -1;
+	g_strlcpy ((gchar *) sa.salg_name, name, sizeof(sa.salg_name));
+	fd_tfm = socket (AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd_tfm < 0)
+		return -1;
+	if (bind (fd_tfm, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+		close (fd_tfm);
+		return -1;
+	}
+	fd_opfd = accept (fd_tfm, NULL, 0);
+	close (fd_tfm);
+	return fd_opfd;
+}
+
+static gboolean
+fu_common_checksum_alg_send (gint fd, const guint8 *buf, gsize bufsz, gboolean more)
+{
+	do {
+		gssize wrote = send (fd, buf, bufsz, more ? MSG_MORE : 0);
+		if (wrote < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		buf += wrote;
+		bufsz -= wrote;
+	} while (bufsz > 0);
+	return TRUE;
+}
+
+/* uses the kernel crypto API, which may use SHA-NI, ARMv8-CE or an
+ * offload engine; returns %NULL if any algorithm is not available */
+static GStrv
+fu_common_checksums_compute_alg (GBytes *blob, const GChecksumType *types, guint types_sz)
+{
+	const guint8 *buf;
+	gboolean ret = TRUE;
+	gsize blocksz = 0x10000;
+	gsize bufsz = 0;
+	g_autofree gint *fds = g_new (gint, types_sz);
+	g_auto(GStrv) checksums = g_new0 (gchar *, types_sz + 1);
+
+	for (guint i = 0; i < types_sz; i++)
+		fds[i] = -1;
+	for (guint i = 0; i < types_sz; i++) {
+		fds[i] = fu_common_checksum_alg_open (types[i]);
+		if (fds[i] < 0) {
+			ret = FALSE;
+			break;
+		}
+	}
+
+	/* interleave the blocks so that the data is only read once */
+	buf = g_bytes_get_data (blob, &bufsz);
+	for (gsize offset = 0; ret && offset < bufsz; offset += blocksz) {
+		gsize chunksz = MIN (blocksz, bufsz - offset);
+		gboolean more = offset + chunksz < bufsz;
+		for (guint i = 0; i < types_sz; i++) {
+			if (!fu_common_checksum_alg_send (fds[i], buf + offset, chunksz, more)) {
+				ret = FALSE;
+				break;
+			}
+		}
+	}
+	for (guint i = 0; ret && i < types_sz; i++) {
+		guint8 digest[64] = { 0x0 };
+		gssize digestsz = g_checksum_type_get_length (types[i]);
+		GString *str;
+		if (digestsz <= 0 || digestsz > (gssize) sizeof(digest) ||
+		    read (fds[i], digest, digestsz) != digestsz) {
+			ret = FALSE;
+			break;
+		}
+		str = g_string_new (NULL);
+		for (gssize j = 0; j < digestsz; j++)
+			g_string_append_printf (str, "%02x", digest[j]);
+		checksums[i] = g_string_free (str, FALSE);
+	}
+	for (guint i = 0; i < types_sz; i++) {
+		if (fds[i] >= 0)
+			close (fds[i]);
+	}
+	if (!ret)
+		return NULL;
+	return g_steal_pointer (&checksums);
+}
+
+/* the kernel may only have the generic C implementation, so only use the
+ * crypto API if it is actually faster than GChecksum on this machine */
+static gboolean
+fu_common_checksums_use_alg (void)
+{
+	static gsize use_alg = 0;
+	if (g_once_init_enter (&use_alg)) {
+		const GChecksumType types[] = { G_CHECKSUM_SHA256 };
+		gint64 elapsed_alg;
+		gint64 elapsed_glib;
+		gint64 start;
+		g_autofree guint8 *buf = g_malloc0 (FU_COMMON_CHECKSUMS_ALG_SIZE_MIN);
+		g_autoptr(GBytes) blob = NULL;
+		g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA256);
+		g_auto(GStrv) checksums = NULL;
+
+		blob = g_bytes_new_static (buf, FU_COMMON_CHECKSUMS_ALG_SIZE_MIN);
+		start = g_get_monotonic_time ();
+		checksums = fu_common_checksums_compute_alg (blob, types, G_N_ELEMENTS (types));
+		elapsed_alg = g_get_monotonic_time () - start;
+		start = g_get_monotonic_time ();
+		g_checksum_update (csum, buf, FU_COMMON_CHECKSUMS_ALG_SIZE_MIN);
+		elapsed_glib = g_get_monotonic_time () - start;
+		if (checksums == NULL ||
+		    g_strcmp0 (checksums[0], g_checksum_get_string (csum)) != 0) {
+			g_debug ("kernel crypto API not available for checksums");
+			g_once_init_leave (&use_alg, 1);
+		} else {
+			g_debug ("kernel crypto API took %" G_GINT64_FORMAT "us, "
+				 "GChecksum took %" G_GINT64_FORMAT "us",
+				 elapsed_alg, elapsed_glib);
+			g_once_init_leave (&use_alg, elapsed_alg < elapsed_glib ? 2 : 1);
+		}
+	}
+	return use_alg == 2;
+}
+#endif
+
+/**
+ * fu_common_checksums_compute:
+ * @blob: a #GBytes
+ * @types: an array of #GChecksumType, e.g. %G_CHECKSUM_SHA1
+ * @types_sz: number of elements in @types
+ *
+ * Computes several checksums of @blob in a single pass over the data, which
+ * is faster than calling g_compute_checksum_for_bytes() for each type when
+ * the image is larger than the CPU cache.
+ *
+ * On Linux, large images are hashed using the kernel crypto API if that is
+ * faster than the portable implementation on this machine.
+ *
+ * Return value: (transfer full): checksums in the same order as @types
+ *
+ * Since: 1.5.0
+ **/
+GStrv
+fu_common_checksums_compute (GBytes *blob, const GChecksumType *types, guint types_sz)
+{
+	const guint8 *buf;
+	gsize bufsz = 0;
+	gsize blocksz = 0x10000;
+	gchar **checksums;
+	g_autoptr(GPtrArray) csums = NULL;
+
+	g_return_val_if_fail (blob != NULL, NULL);
+	g_return_val_if_fail (types != NULL || types_sz == 0, NULL);
+
+#ifdef HAVE_LINUX_IF_ALG_H
+	if (types_sz > 0 &&
+	    g_bytes_get_size (blob) >= FU_COMMON_CHECKSUMS_ALG_SIZE_MIN &&
+	    fu_common_checksums_use_alg ()) {
+		checksums = fu_common_checksums_compute_alg (blob, types, types_sz);
+		if (checksums != NULL)
+			return checksums;
+		g_debug ("falling back to GChecksum");
+	}
+#endif
+
+	csums = g_ptr_array_new_with_free_func ((GDestroyNotify) g_checksum_free);
+	for (guint i = 0; i < types_sz; i++)
+		g_ptr_array_add (csums, g_checksum_new (types[i]));
+
+	/* each block is hashed by every algorithm while still in the cache */
+	buf = g_bytes_get_data (blob, &bufsz);
+	for (gsize offset = 0; offset < bufsz; offset += blocksz) {
+		gsize chunksz = MIN (blocksz, bufsz - offset);
+		for (guint i = 0; i < csums->len; i++) {
+			GChecksum *csum = g_ptr_array_index (csums, i);
+			g_checksum_update (csum, buf + offset, chunksz);
+		}
+	}
+
+	checksums = g_new0 (gchar *, csums->len + 1);
+	for (guint i = 0; i < csums->len; i++) {
+		GChecksum *csum = g_ptr_array_index (csums, i);
+		checksums[i] = g_strdup (g_checksum_get_string (csum));
+	}
+	return checksums;
+}
+
 /**
  * fu_common_realpath:
  * @filename: a filename
@@ -2040,6 +2361,83 @@ fu_common_kernel_locked_down (void)
 #endif
 }
 
+typedef struct {
+	gboolean	 supported;
+	guint32		 eax;
+	guint32		 ebx;
+	guint32		 ecx;
+	guint32		 edx;
+} FuCommonCpuidItem;
+
+static GMutex		 cpuid_cache_mutex;
+static GHashTable	*cpuid_cache = NULL;	/* leaf : FuCommonCpuidItem */
+
+/**
+ * fu_common_cpuid:
+ * @leaf: The CPUID leaf, e.g. 0x01
+ * @eax: (out) (nullable): EAX register
+ * @ebx: (out) (nullable): EBX register
+ * @ecx: (out) (nullable): ECX register
+ * @edx: (out) (nullable): EDX register
+ * @error: A #GError or %NULL
+ *
+ * Calls CPUID for the first subleaf of @leaf. The results cannot change
+ * until the next boot, so each leaf is only queried once for all plugins.
+ *
+ * Returns: %TRUE if the leaf is supported by the CPU
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_common_cpuid (guint32 leaf,
+		 guint32 *eax,
+		 guint32 *ebx,
+		 guint32 *ecx,
+		 guint32 *edx,
+		 GError **error)
+{
+	FuCommonCpuidItem *item;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&cpuid_cache_mutex);
+
+	if (cpuid_cache == NULL)
+		cpuid_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	item = g_hash_table_lookup (cpuid_cache, GUINT_TO_POINTER (leaf));
+	if (item == NULL) {
+		item = g_new0 (FuCommonCpuidItem, 1);
+#ifdef HAVE_CPUID_H
+		{
+			guint eax_tmp = 0;
+			guint ebx_tmp = 0;
+			guint ecx_tmp = 0;
+			guint edx_tmp = 0;
+			item->supported = __get_cpuid (leaf, &eax_tmp, &ebx_tmp,
+						       &ecx_tmp, &edx_tmp) != 0;
+			item->eax = eax_tmp;
+			item->ebx = ebx_tmp;
+			item->ecx = ecx_tmp;
+			item->edx = edx_tmp;
+		}
+#endif
+		g_hash_table_insert (cpuid_cache, GUINT_TO_POINTER (leaf), item);
+	}
+	if (!item->supported) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "CPUID leaf 0x%x is not supported on this CPU", leaf);
+		return FALSE;
+	}
+	if (eax != NULL)
+		*eax = item->eax;
+	if (ebx != NULL)
+		*ebx = item->ebx;
+	if (ecx != NULL)
+		*ecx = item->ecx;
+	if (edx != NULL)
+		*edx = item->edx;
+	return TRUE;
+}
+
 /**
  * fu_common_is_cpu_intel:
  *
@@ -2053,14 +2451,13 @@ gboolean
 fu_common_is_cpu_intel (void)
 {
 #ifdef HAVE_CPUID_H
-	guint eax = 0;
-	guint ebx = 0;
-	guint ecx = 0;
-	guint edx = 0;
-	guint level = 0;
+	guint32 ebx = 0;
+	guint32 ecx = 0;
+	guint32 edx = 0;
 
 	/* get vendor */
-	__get_cpuid(level, &eax, &ebx, &ecx, &edx);
+	if (!fu_common_cpuid (0x0, NULL, &ebx, &ecx, &edx, NULL))
+		return FALSE;
 	if (ebx == signature_INTEL_ebx &&
 	    edx == signature_INTEL_edx &&
 	    ecx == signature_INTEL_ecx) {
@@ -128,6 +128,7 @@ guint64		 fu_common_strtoull		(const gchar	*str);
 gchar		*fu_common_find_program_in_path	(const gchar	*basename,
 						 GError		**error);
 gchar		*fu_common_strstrip		(const gchar	*str);
+gboolean	 fu_common_debug_enabled	(const gchar	*log_domain);
 void		 fu_common_dump_raw		(const gchar	*log_domain,
 						 const gchar	*title,
 						 const guint8	*data,
@@ -153,8 +154,24 @@ gboolean	 fu_common_bytes_compare_raw	(const guint8	*buf1,
 						 const guint8	*buf2,
 						 gsize		 bufsz2,
 						 GError		**error);
+gboolean	 fu_common_bytes_find_not_empty_raw (const guint8 *buf,
+						 gsize		 bufsz,
+						 gsize		 block_sz,
+						 gsize		*offset);
+gboolean	 fu_common_bytes_find_diff_raw	(const guint8	*buf1,
+						 const guint8	*buf2,
+						 gsize		 bufsz,
+						 gsize		 block_sz,
+						 gsize		*offset);
 GBytes		*fu_common_bytes_pad		(GBytes		*bytes,
 						 gsize		 sz);
+GBytes		*fu_common_bytes_new_offset	(GBytes		*bytes,
+						 gsize		 offset,
+						 gsize		 length,
+						 GError		**error);
+GStrv		 fu_common_checksums_compute	(GBytes		*blob,
+						 const GChecksumType *types,
+						 guint		 types_sz);
 gsize		 fu_common_strwidth		(const gchar	*text);
 gboolean	 fu_memcpy_safe			(guint8		*dst,
 						 gsize		 dst_sz,
@@ -227,3 +244,9 @@ gchar		**fu_common_strnsplit		(const gchar	*str,
 						 gint		 max_tokens);
 gboolean	 fu_common_kernel_locked_down	(void);
 gboolean	 fu_common_is_cpu_intel		(void);
+gboolean	 fu_common_cpuid		(guint32	 leaf,
+						 guint32	*eax,
+						 guint32	*ebx,
+						 guint32	*ecx,
+						 guint32	*edx,
+						 GError		**error);
@@ -29,3 +29,14 @@ void		 fu_device_incorporate_from_component	(FuDevice	*device,
 void		 fu_device_convert_instance_ids		(FuDevice	*self);
 gchar		*fu_device_get_guids_as_str		(FuDevice	*self);
 GPtrArray	*fu_device_get_possible_plugins		(FuDevice	*self);
+gboolean	 fu_device_cache_firmware		(FuDevice	*self,
+							 GBytes		*fw,
+							 FwupdInstallFlags flags,
+							 GError		**error);
+void		 fu_device_incorporate_firmware_cache	(FuDevice	*self,
+							 FuDevice	*donor);
+gboolean	 fu_device_snapshot_load		(const gchar	*filename,
+							 GError		**error);
+gboolean	 fu_device_snapshot_save		(const gchar	*filename,
+							 GPtrArray	*devices,
+							 GError		**error);
@@ -15,7 +15,9 @@
 #include "fu-common.h"
 #include "fu-common-version.h"
 #include "fu-device-private.h"
+#include "fu-metrics.h"
 #include "fu-mutex.h"
+#include "fu-trace.h"
 
 #include "fwupd-common.h"
 #include "fwupd-device-private.h"
@@ -34,6 +36,7 @@ static void fu_device_finalize			 (GObject *object);
 typedef struct {
 	gchar				*alternate_id;
 	gchar				*equivalent_id;
+	gchar				*install_group;
 	gchar				*physical_id;
 	gchar				*logical_id;
 	gchar				*proxy_guid;
@@ -42,15 +45,22 @@ typedef struct {
 	FuDevice			*proxy;		/* noref */
 	FuQuirks			*quirks;
 	GHashTable			*metadata;	/* (nullable) */
+	gboolean			 metadata_shared;	/* copy before writing */
 	GRWLock				 metadata_mutex;
-	GPtrArray			*parent_guids;
+	GPtrArray			*parent_guids;	/* interned */
+	gboolean			 parent_guids_shared;	/* copy before writing */
 	GRWLock				 parent_guids_mutex;
 	GPtrArray			*children;
 	guint				 remove_delay;	/* ms */
 	guint				 progress;
+	GPtrArray			*progress_phases;	/* (nullable): of FuDeviceProgressPhase */
+	guint				 progress_phase_idx;
+	gint64				 progress_phase_start;	/* monotonic, in us */
+	GHashTable			*progress_phase_durations;	/* (nullable): id : gdouble* seconds */
 	guint				 order;
 	guint				 priority;
-	guint				 poll_id;
+	guint				 poll_interval;	/* ms */
+	gint64				 poll_deadline;	/* monotonic, in us */
 	gboolean			 done_probe;
 	gboolean			 done_setup;
 	gboolean			 device_id_valid;
@@ -58,9 +68,20 @@ typedef struct {
 	guint64				 size_max;
 	gint				 open_refcount;	/* atomic */
 	GType				 specialized_gtype;
-	GPtrArray			*possible_plugins;
-	GPtrArray			*retry_recs;	/* of FuDeviceRetryRecovery */
+	GPtrArray			*possible_plugins;	/* interned */
+	GPtrArray			*retry_recs;	/* (nullable): of FuDeviceRetryRecovery */
 	guint				 retry_delay;
+	guint				 retry_multiplier;
+	guint				 retry_delay_max;
+	guint				 retry_jitter;	/* percent */
+	guint				 retry_cnt;
+	GByteArray			*packet_buf;	/* (nullable) */
+	FuFirmware			*firmware_cache;	/* (nullable) */
+	GBytes				*firmware_cache_blob;	/* (nullable) */
+	FwupdInstallFlags		 firmware_cache_flags;
+	gboolean			 skip_setup_unchanged;
+	gchar				*snapshot_key;	/* (nullable) */
+	FuIoRecording			*io_recording;	/* (nullable) */
 } FuDevicePrivate;
 
 typedef struct {
@@ -69,6 +90,11 @@ typedef struct {
 	FuDeviceRetryFunc		 recovery_func;
 } FuDeviceRetryRecovery;
 
+typedef struct {
+	gchar				*id;
+	guint				 weight;
+} FuDeviceProgressPhase;
+
 enum {
 	PROP_0,
 	PROP_PROGRESS,
@@ -83,6 +109,276 @@ enum {
 G_DEFINE_TYPE_WITH_PRIVATE (FuDevice, fu_device, FWUPD_TYPE_DEVICE)
 #define GET_PRIVATE(o) (fu_device_get_instance_private (o))
 
+/* the same instance IDs are hashed again on every replug and quirk match, so
+ * remember the results for the lifetime of the process; entries are never
+ * removed so the returned strings can be used without copying */
+static GMutex		 guid_hash_mutex;
+static GHashTable	*guid_hash_cache = NULL;	/* instance-id : guid */
+
+static const gchar *
+fu_device_guid_hash_string (const gchar *instance_id)
+{
+	gchar *guid;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&guid_hash_mutex);
+
+	if (guid_hash_cache == NULL)
+		guid_hash_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	guid = g_hash_table_lookup (guid_hash_cache, instance_id);
+	if (guid != NULL)
+		return guid;
+	guid = fwupd_guid_hash_string (instance_id);
+	if (guid == NULL)
+		return NULL;
+	g_hash_table_insert (guid_hash_cache, g_strdup (instance_id), guid);
+	return guid;
+}
+
+/* loaded by the engine before coldplug, and only read after that */
+static GMutex		 snapshot_mutex;
+static GHashTable	*snapshot_cache = NULL;		/* key : GVariant */
+
+/* the same device type at the same place, with the same version and IDs */
+static gchar *
+fu_device_snapshot_build_key (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GPtrArray *instance_ids = fwupd_device_get_instance_ids (FWUPD_DEVICE (self));
+	g_autoptr(GString) str = g_string_new (G_OBJECT_TYPE_NAME (self));
+
+	if (priv->physical_id == NULL || fu_device_get_version (self) == NULL)
+		return NULL;
+	g_string_append_printf (str, "|%s|%s|%s",
+				priv->physical_id,
+				priv->logical_id != NULL ? priv->logical_id : "",
+				fu_device_get_version (self));
+	for (guint i = 0; i < instance_ids->len; i++)
+		g_string_append_printf (str, "|%s", (const gchar *) g_ptr_array_index (instance_ids, i));
+	return g_compute_checksum_for_string (G_CHECKSUM_SHA1, str->str, -1);
+}
+
+static gboolean
+fu_device_snapshot_restore (FuDevice *self, const gchar *key)
+{
+	FwupdDevice *device = FWUPD_DEVICE (self);
+	GPtrArray *guids;
+	GPtrArray *icons;
+	GVariant *val;
+	guint64 flags_static = FWUPD_DEVICE_FLAG_INTERNAL |
+			       FWUPD_DEVICE_FLAG_UPDATABLE |
+			       FWUPD_DEVICE_FLAG_ONLY_OFFLINE |
+			       FWUPD_DEVICE_FLAG_REQUIRE_AC |
+			       FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER |
+			       FWUPD_DEVICE_FLAG_IS_BOOTLOADER |
+			       FWUPD_DEVICE_FLAG_DUAL_IMAGE |
+			       FWUPD_DEVICE_FLAG_SELF_RECOVERY |
+			       FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE |
+			       FWUPD_DEVICE_FLAG_CAN_VERIFY |
+			       FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE;
+	g_autoptr(FwupdDevice) donor = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&snapshot_mutex);
+
+	if (snapshot_cache == NULL)
+		return FALSE;
+	val = g_hash_table_lookup (snapshot_cache, key);
+	if (val == NULL)
+		return FALSE;
+	donor = fwupd_device_from_variant (val);
+	if (donor == NULL)
+		return FALSE;
+	g_debug ("using snapshot for %s", fu_device_get_physical_id (self));
+
+	/* only the values a ->setup() would have read from the device */
+	if (fwupd_device_get_name (device) == NULL)
+		fu_device_set_name (self, fwupd_device_get_name (donor));
+	if (fwupd_device_get_vendor (device) == NULL)
+		fu_device_set_vendor (self, fwupd_device_get_vendor (donor));
+	if (fwupd_device_get_vendor_id (device) == NULL)
+		fu_device_set_vendor_id (self, fwupd_device_get_vendor_id (donor));
+	if (fwupd_device_get_serial (device) == NULL)
+		fu_device_set_serial (self, fwupd_device_get_serial (donor));
+	if (fwupd_device_get_summary (device) == NULL)
+		fu_device_set_summary (self, fwupd_device_get_summary (donor));
+	if (fwupd_device_get_protocol (device) == NULL)
+		fu_device_set_protocol (self, fwupd_device_get_protocol (donor));
+	if (fwupd_device_get_version_format (device) == FWUPD_VERSION_FORMAT_UNKNOWN)
+		fu_device_set_version_format (self, fwupd_device_get_version_format (donor));
+	if (fwupd_device_get_version_lowest (device) == NULL)
+		fu_device_set_version_lowest (self, fwupd_device_get_version_lowest (donor));
+	if (fwupd_device_get_version_bootloader (device) == NULL)
+		fu_device_set_version_bootloader (self, fwupd_device_get_version_bootloader (donor));
+	if (fwupd_device_get_version_raw (device) == 0)
+		fu_device_set_version_raw (self, fwupd_device_get_version_raw (donor));
+	if (fwupd_device_get_flashes_left (device) == 0)
+		fu_device_set_flashes_left (self, fwupd_device_get_flashes_left (donor));
+	if (fwupd_device_get_install_duration (device) == 0)
+		fu_device_set_install_duration (self, fwupd_device_get_install_duration (donor));
+	fu_device_add_flag (self, fwupd_device_get_flags (donor) & flags_static);
+	guids = fwupd_device_get_guids (donor);
+	for (guint i = 0; i < guids->len; i++)
+		fu_device_add_guid (self, g_ptr_array_index (guids, i));
+	icons = fwupd_device_get_icons (donor);
+	for (guint i = 0; i < icons->len; i++)
+		fu_device_add_icon (self, g_ptr_array_index (icons, i));
+	return TRUE;
+}
+
+/**
+ * fu_device_snapshot_load:
+ * @filename: A filename, typically in the package state directory
+ * @error: A #GError, or %NULL
+ *
+ * Loads the devices saved using fu_device_snapshot_save() so that devices
+ * using fu_device_set_skip_setup_unchanged() can be set up without querying
+ * the hardware.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_snapshot_load (const gchar *filename, GError **error)
+{
+	GVariantIter iter;
+	GVariant *device_val;
+	const gchar *key;
+	gchar *buf = NULL;
+	gsize bufsz = 0;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!g_file_get_contents (filename, &buf, &bufsz, error))
+		return FALSE;
+	blob = g_bytes_new_take (buf, bufsz);
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("a{sa{sv}}"),
+							    blob, FALSE));
+	if (!g_variant_is_normal_form (val)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid device snapshot %s",
+			     filename);
+		return FALSE;
+	}
+
+	locker = g_mutex_locker_new (&snapshot_mutex);
+	if (snapshot_cache == NULL) {
+		snapshot_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, (GDestroyNotify) g_variant_unref);
+	}
+	g_hash_table_remove_all (snapshot_cache);
+	g_variant_iter_init (&iter, val);
+	while (g_variant_iter_next (&iter, "{&s@a{sv}}", &key, &device_val))
+		g_hash_table_insert (snapshot_cache, g_strdup (key), device_val);
+	return TRUE;
+}
+
+/**
+ * fu_device_snapshot_save:
+ * @filename: A filename, typically in the package state directory
+ * @devices: (element-type FuDevice): devices
+ * @error: A #GError, or %NULL
+ *
+ * Saves any of the @devices that were set up using
+ * fu_device_set_skip_setup_unchanged().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_snapshot_save (const gchar *filename, GPtrArray *devices, GError **error)
+{
+	GVariantBuilder builder;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (devices != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		FuDevicePrivate *priv = GET_PRIVATE (device);
+		if (priv->snapshot_key == NULL)
+			continue;
+		g_variant_builder_add (&builder, "{s@a{sv}}",
+				       priv->snapshot_key,
+				       fwupd_device_to_variant_full (FWUPD_DEVICE (device),
+								     FWUPD_DEVICE_FLAG_TRUSTED));
+	}
+	val = g_variant_ref_sink (g_variant_builder_end (&builder));
+	blob = g_variant_get_data_as_bytes (val);
+	if (!fu_common_mkdir_parent (filename, error))
+		return FALSE;
+	return fu_common_set_contents_bytes (filename, blob, error);
+}
+
+/**
+ * fu_device_set_skip_setup_unchanged:
+ * @self: A #FuDevice
+ * @skip_setup_unchanged: %TRUE to skip the ->setup() vfunc
+ *
+ * Allows fu_device_setup() to restore the device from the last snapshot rather
+ * than querying the hardware, if the device type, physical ID, logical ID,
+ * version and instance IDs are all unchanged since the snapshot was saved.
+ *
+ * This should only be used when ->setup() just reads properties, and when the
+ * version known after ->probe() changes with every firmware update.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_set_skip_setup_unchanged (FuDevice *self, gboolean skip_setup_unchanged)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	priv->skip_setup_unchanged = skip_setup_unchanged;
+}
+
+/**
+ * fu_device_set_io_recording:
+ * @self: A #FuDevice
+ * @io_recording: (nullable): A #FuIoRecording
+ *
+ * Records all the I/O made by the device, or if @io_recording has been loaded
+ * then answers the I/O from the recording rather than using the hardware.
+ * Child devices use the recording of the parent unless they have their own.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_set_io_recording (FuDevice *self, FuIoRecording *io_recording)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_set_object (&priv->io_recording, io_recording);
+}
+
+/**
+ * fu_device_get_io_recording:
+ * @self: A #FuDevice
+ *
+ * Gets the recording set with fu_device_set_io_recording().
+ *
+ * Returns: (transfer none) (nullable): a #FuIoRecording, or %NULL if unset
+ *
+ * Since: 1.5.0
+ **/
+FuIoRecording *
+fu_device_get_io_recording (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), NULL);
+	if (priv->io_recording == NULL && priv->parent != NULL)
+		return fu_device_get_io_recording (priv->parent);
+	return priv->io_recording;
+}
+
 static void
 fu_device_get_property (GObject *object, guint prop_id,
 			GValue *value, GParamSpec *pspec)
@@ -175,7 +471,7 @@ static void
 fu_device_add_possible_plugin (FuDevice *self, const gchar *plugin)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
-	g_ptr_array_add (priv->possible_plugins, g_strdup (plugin));
+	g_ptr_array_add (priv->possible_plugins, (gpointer) g_intern_string (plugin));
 }
 
 /**
@@ -209,6 +505,8 @@ fu_device_retry_add_recovery (FuDevice *self,
 	rec->domain = domain;
 	rec->code = code;
 	rec->recovery_func = func;
+	if (priv->retry_recs == NULL)
+		priv->retry_recs = g_ptr_array_new_with_free_func (g_free);
 	g_ptr_array_add (priv->retry_recs, rec);
 }
 
@@ -229,6 +527,93 @@ fu_device_retry_set_delay (FuDevice *self, guint delay)
 	priv->retry_delay = delay;
 }
 
+/**
+ * fu_device_retry_set_backoff:
+ * @self: A #FuDevice
+ * @multiplier: factor to multiply the delay by after each failure, or 1
+ * @delay_max: maximum delay in ms, or 0 for no limit
+ *
+ * Sets how the delay set by fu_device_retry_set_delay() grows between failed
+ * retries. Quick transient failures can use a short initial delay without
+ * hammering slow devices that need longer to recover.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_retry_set_backoff (FuDevice *self, guint multiplier, guint delay_max)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (multiplier >= 1);
+	priv->retry_multiplier = multiplier;
+	priv->retry_delay_max = delay_max;
+}
+
+/**
+ * fu_device_retry_set_jitter:
+ * @self: A #FuDevice
+ * @jitter: percentage of the delay to randomly add or remove, e.g. 20
+ *
+ * Sets a random variation in the delay between failed retries, which avoids
+ * several devices on the same bus retrying in lock-step.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_retry_set_jitter (FuDevice *self, guint jitter)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (jitter <= 100);
+	priv->retry_jitter = jitter;
+}
+
+/**
+ * fu_device_get_retry_count:
+ * @self: A #FuDevice
+ *
+ * Gets the total number of times fu_device_retry() has had to try again
+ * for this device.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_device_get_retry_count (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
+	return priv->retry_cnt;
+}
+
+static guint
+fu_device_retry_get_delay (FuDevice *self, guint retry)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	guint64 delay = priv->retry_delay;
+
+	/* exponential backoff */
+	for (guint i = 1; i < retry && priv->retry_multiplier > 1; i++) {
+		delay *= priv->retry_multiplier;
+		if (priv->retry_delay_max > 0 && delay >= priv->retry_delay_max)
+			break;
+		if (delay > G_MAXUINT)
+			break;
+	}
+	if (priv->retry_delay_max > 0)
+		delay = MIN (delay, priv->retry_delay_max);
+	delay = MIN (delay, G_MAXUINT);
+
+	/* jitter */
+	if (priv->retry_jitter > 0 && delay > 0) {
+		gint64 range = delay * priv->retry_jitter / 100;
+		if (range > 0)
+			delay += g_random_int_range (-range, range + 1);
+	}
+	return (guint) delay;
+}
+
 /**
  * fu_device_retry:
  * @self: A #FuDevice
@@ -246,6 +631,10 @@ fu_device_retry_set_delay (FuDevice *self, guint delay)
  * If the reset function returns %FALSE, then the function returns straight away
  * without processing any pending retries.
  *
+ * Each retry is recorded as a trace span in the `retry` category and counted
+ * in the `fwupd_device_retries` metric. The delay between tries can be
+ * changed using fu_device_retry_set_backoff() and fu_device_retry_set_jitter().
+ *
  * Since: 1.4.0
  **/
 gboolean
@@ -263,11 +652,23 @@ fu_device_retry (FuDevice *self,
 	g_return_val_if_fail (error != NULL, FALSE);
 
 	for (guint i = 0; ; i++) {
+		g_autoptr(FuTraceSpan) span = NULL;
 		g_autoptr(GError) error_local =	NULL;
 
 		/* delay */
-		if (i > 0 && priv->retry_delay > 0)
-			g_usleep (priv->retry_delay * 1000);
+		if (i > 0) {
+			const gchar *plugin = fu_device_get_plugin (self);
+			guint delay = fu_device_retry_get_delay (self, i);
+			g_autofree gchar *labels = NULL;
+			span = fu_trace_span_new ("retry", "%s",
+						  plugin != NULL ? plugin : "unknown");
+			labels = g_strdup_printf ("plugin=\"%s\"",
+						  plugin != NULL ? plugin : "unknown");
+			fu_metrics_counter_add ("fwupd_device_retries", labels, 1);
+			priv->retry_cnt++;
+			if (delay > 0)
+				g_usleep (delay * 1000);
+		}
 
 		/* run function, if success return success */
 		if (func (self, user_data, &error_local))
@@ -292,7 +693,7 @@ fu_device_retry (FuDevice *self,
 		}
 
 		/* show recoverable error on the console */
-		if (priv->retry_recs->len == 0) {
+		if (priv->retry_recs == NULL) {
 			g_debug ("failed on try %u of %u: %s",
 				 i + 1, count, error_local->message);
 			continue;
@@ -320,6 +721,108 @@ fu_device_retry (FuDevice *self,
 	return TRUE;
 }
 
+/**
+ * fu_device_retry_with_backoff:
+ * @self: A #FuDevice
+ * @func: (scope async): A function that returns %TRUE when the device is ready
+ * @delay: initial delay between tries in ms
+ * @timeout: maximum total time to wait in ms
+ * @user_data: (nullable): a helper to pass to @user_data
+ * @error: A #GError
+ *
+ * Calls a specific function until it succeeds or @timeout is reached. This is
+ * designed to replace a fixed worst-case sleep with polling the hardware for
+ * readiness, so that fast devices can continue as soon as possible.
+ *
+ * The function is called straight away, and then again after @delay, and the
+ * delay doubles on each failure up to a tenth of @timeout.
+ *
+ * Returns: %TRUE if @func succeeded before the timeout
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_retry_with_backoff (FuDevice *self,
+			      FuDeviceRetryFunc func,
+			      guint delay,
+			      guint timeout,
+			      gpointer user_data,
+			      GError **error)
+{
+	guint delay_max = MAX (delay, timeout / 10);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (error != NULL, FALSE);
+
+	for (guint i = 0; ; i++) {
+		guint elapsed;
+		g_autoptr(GError) error_local = NULL;
+
+		/* run function, if success return success */
+		if (func (self, user_data, &error_local)) {
+			g_debug ("ready after %.0fms of %ums budget, %u tries",
+				 g_timer_elapsed (timer, NULL) * 1000.f,
+				 timeout, i + 1);
+			break;
+		}
+
+		/* sanity check */
+		if (error_local == NULL) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "exec failed but no error set!");
+			return FALSE;
+		}
+
+		/* out of time */
+		elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+		if (elapsed >= timeout) {
+			g_propagate_prefixed_error (error,
+						    g_steal_pointer (&error_local),
+						    "failed after %ums: ",
+						    elapsed);
+			return FALSE;
+		}
+
+		/* wait a little longer each time, but never past the deadline */
+		if (i > 0)
+			delay = MIN (delay * 2, delay_max);
+		g_usleep (MIN (delay, timeout - elapsed) * 1000);
+	}
+
+	/* success */
+	return TRUE;
+}
+
+/**
+ * fu_device_get_packet_buffer:
+ * @self: A #FuDevice
+ * @bufsz: required size in bytes
+ *
+ * Gets a scratch buffer owned by the device that can be used to build
+ * packets when writing firmware. The buffer is reused between calls so
+ * that write loops do not allocate for every packet.
+ *
+ * The contents are undefined and only valid until the next call.
+ *
+ * Returns: (transfer none): memory buffer of at least @bufsz bytes
+ *
+ * Since: 1.5.0
+ **/
+guint8 *
+fu_device_get_packet_buffer (FuDevice *self, gsize bufsz)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), NULL);
+	if (priv->packet_buf == NULL)
+		priv->packet_buf = g_byte_array_sized_new (bufsz);
+	g_byte_array_set_size (priv->packet_buf, bufsz);
+	return priv->packet_buf->data;
+}
+
 /**
  * fu_device_poll:
  * @self: A #FuDevice
@@ -347,18 +850,81 @@ fu_device_poll (FuDevice *self, GError **error)
 	return TRUE;
 }
 
+/* all the polled devices share one timer that is scheduled for the earliest
+ * deadline; devices due within a tenth of their interval are polled in the
+ * same wakeup rather than waking up again a few milliseconds later */
+static GPtrArray	*poll_devices = NULL;	/* of FuDevice, no ref */
+static guint		 poll_timer_id = 0;
+
+static void fu_device_poll_schedule (void);
+
+static void
+fu_device_poll_stop (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	if (priv->poll_interval == 0)
+		return;
+	priv->poll_interval = 0;
+	g_ptr_array_remove (poll_devices, self);
+	fu_device_poll_schedule ();
+}
+
 static gboolean
 fu_device_poll_cb (gpointer user_data)
 {
-	FuDevice *self = FU_DEVICE (user_data);
-	FuDevicePrivate *priv = GET_PRIVATE (self);
-	g_autoptr(GError) error_local = NULL;
-	if (!fu_device_poll (self, &error_local)) {
-		g_warning ("disabling polling: %s", error_local->message);
-		priv->poll_id = 0;
-		return G_SOURCE_REMOVE;
+	gint64 now = g_get_monotonic_time ();
+	g_autoptr(GPtrArray) devices_due = NULL;
+
+	/* take a ref as polling may add or remove devices */
+	poll_timer_id = 0;
+	devices_due = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < poll_devices->len; i++) {
+		FuDevice *self = g_ptr_array_index (poll_devices, i);
+		FuDevicePrivate *priv = GET_PRIVATE (self);
+		gint64 slack = (gint64) priv->poll_interval * 100;
+		if (priv->poll_deadline - slack > now)
+			continue;
+		priv->poll_deadline = now + (gint64) priv->poll_interval * 1000;
+		g_ptr_array_add (devices_due, g_object_ref (self));
 	}
-	return G_SOURCE_CONTINUE;
+	for (guint i = 0; i < devices_due->len; i++) {
+		FuDevice *self = g_ptr_array_index (devices_due, i);
+		FuDevicePrivate *priv = GET_PRIVATE (self);
+		g_autoptr(GError) error_local = NULL;
+
+		/* disabled by an earlier poll */
+		if (priv->poll_interval == 0)
+			continue;
+		if (!fu_device_poll (self, &error_local)) {
+			g_warning ("disabling polling: %s", error_local->message);
+			fu_device_poll_stop (self);
+		}
+	}
+	g_clear_pointer (&devices_due, g_ptr_array_unref);
+	fu_device_poll_schedule ();
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_device_poll_schedule (void)
+{
+	gint64 deadline = G_MAXINT64;
+	gint64 now;
+
+	if (poll_timer_id != 0) {
+		g_source_remove (poll_timer_id);
+		poll_timer_id = 0;
+	}
+	if (poll_devices == NULL || poll_devices->len == 0)
+		return;
+	for (guint i = 0; i < poll_devices->len; i++) {
+		FuDevice *self = g_ptr_array_index (poll_devices, i);
+		FuDevicePrivate *priv = GET_PRIVATE (self);
+		deadline = MIN (deadline, priv->poll_deadline);
+	}
+	now = g_get_monotonic_time ();
+	poll_timer_id = g_timeout_add (deadline > now ? (guint) ((deadline - now) / 1000) : 0,
+				       fu_device_poll_cb, NULL);
 }
 
 /**
@@ -379,19 +945,17 @@ fu_device_set_poll_interval (FuDevice *self, guint interval)
 
 	g_return_if_fail (FU_IS_DEVICE (self));
 
-	if (priv->poll_id != 0) {
-		g_source_remove (priv->poll_id);
-		priv->poll_id = 0;
-	}
-	if (interval == 0)
+	if (interval == 0) {
+		fu_device_poll_stop (self);
 		return;
-	if (interval % 1000 == 0) {
-		priv->poll_id = g_timeout_add_seconds (interval / 1000,
-						       fu_device_poll_cb,
-						       self);
-	} else {
-		priv->poll_id = g_timeout_add (interval, fu_device_poll_cb, self);
 	}
+	if (poll_devices == NULL)
+		poll_devices = g_ptr_array_new ();
+	if (priv->poll_interval == 0)
+		g_ptr_array_add (poll_devices, self);
+	priv->poll_interval = interval;
+	priv->poll_deadline = g_get_monotonic_time () + (gint64) interval * 1000;
+	fu_device_poll_schedule ();
 }
 
 /**
@@ -502,6 +1066,49 @@ fu_device_set_equivalent_id (FuDevice *self, const gchar *equivalent_id)
 	priv->equivalent_id = g_strdup (equivalent_id);
 }
 
+/**
+ * fu_device_get_install_group:
+ * @self: A #FuDevice
+ *
+ * Gets the install group for a device. Devices in different install groups
+ * do not share a bus and so can be updated at the same time.
+ *
+ * Returns: (transfer none): a #gchar or NULL
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_device_get_install_group (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), NULL);
+	return priv->install_group;
+}
+
+/**
+ * fu_device_set_install_group:
+ * @self: A #FuDevice
+ * @install_group: A string, or %NULL
+ *
+ * Sets the install group for a device. If unset, all the devices with the
+ * same root device are assumed to share a bus and are updated in order.
+ *
+ * Child devices on a different bus from the root device should set this
+ * to a value that is unique to that bus, e.g. the bus sysfs path. Devices
+ * from the same plugin with the same install group are updated in order,
+ * even if they have different root devices.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_set_install_group (FuDevice *self, const gchar *install_group)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_free (priv->install_group);
+	priv->install_group = g_strdup (install_group);
+}
+
 /**
  * fu_device_get_alternate_id:
  * @self: A #FuDevice
@@ -860,6 +1467,23 @@ fu_device_has_parent_guid (FuDevice *self, const gchar *guid)
 	return FALSE;
 }
 
+/* called with the writer lock held */
+static void
+fu_device_ensure_parent_guids_writable (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GPtrArray *parent_guids;
+
+	if (!priv->parent_guids_shared)
+		return;
+	parent_guids = g_ptr_array_sized_new (priv->parent_guids->len + 1);
+	for (guint i = 0; i < priv->parent_guids->len; i++)
+		g_ptr_array_add (parent_guids, g_ptr_array_index (priv->parent_guids, i));
+	g_ptr_array_unref (priv->parent_guids);
+	priv->parent_guids = parent_guids;
+	priv->parent_guids_shared = FALSE;
+}
+
 /**
  * fu_device_add_parent_guid:
  * @self: A #FuDevice
@@ -887,11 +1511,14 @@ fu_device_add_parent_guid (FuDevice *self, const gchar *guid)
 
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
+		const gchar *tmp = fu_device_guid_hash_string (guid);
 		if (fu_device_has_parent_guid (self, tmp))
 			return;
 		g_debug ("using %s for %s", tmp, guid);
-		g_ptr_array_add (priv->parent_guids, g_steal_pointer (&tmp));
+		locker = g_rw_lock_writer_locker_new (&priv->parent_guids_mutex);
+		g_return_if_fail (locker != NULL);
+		fu_device_ensure_parent_guids_writable (self);
+		g_ptr_array_add (priv->parent_guids, (gpointer) g_intern_string (tmp));
 		return;
 	}
 
@@ -900,7 +1527,8 @@ fu_device_add_parent_guid (FuDevice *self, const gchar *guid)
 		return;
 	locker = g_rw_lock_writer_locker_new (&priv->parent_guids_mutex);
 	g_return_if_fail (locker != NULL);
-	g_ptr_array_add (priv->parent_guids, g_strdup (guid));
+	fu_device_ensure_parent_guids_writable (self);
+	g_ptr_array_add (priv->parent_guids, (gpointer) g_intern_string (guid));
 }
 
 static gboolean
@@ -1252,7 +1880,7 @@ fu_device_has_guid (FuDevice *self, const gchar *guid)
 
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
+		const gchar *tmp = fu_device_guid_hash_string (guid);
 		return fwupd_device_has_guid (FWUPD_DEVICE (self), tmp);
 	}
 
@@ -1276,7 +1904,7 @@ fu_device_add_instance_id_full (FuDevice *self,
 				const gchar *instance_id,
 				FuDeviceInstanceFlags flags)
 {
-	g_autofree gchar *guid = NULL;
+	const gchar *guid;
 	if (fwupd_guid_is_valid (instance_id)) {
 		g_warning ("use fu_device_add_guid(\"%s\") instead!", instance_id);
 		fu_device_add_guid_safe (self, instance_id);
@@ -1287,7 +1915,7 @@ fu_device_add_instance_id_full (FuDevice *self,
 	 * calling fu_device_add_guid_safe() -- but we want the quirks to match
 	 * so the plugin is set, but not the LVFS metadata to match firmware
 	 * until we're sure the device isn't using _NO_AUTO_INSTANCE_IDS */
-	guid = fwupd_guid_hash_string (instance_id);
+	guid = fu_device_guid_hash_string (instance_id);
 	fu_device_add_guid_quirks (self, guid);
 	if ((flags & FU_DEVICE_INSTANCE_FLAG_ONLY_QUIRKS) == 0)
 		fwupd_device_add_instance_id (FWUPD_DEVICE (self), instance_id);
@@ -1355,7 +1983,7 @@ fu_device_add_counterpart_guid (FuDevice *self, const gchar *guid)
 
 	/* make valid */
 	if (!fwupd_guid_is_valid (guid)) {
-		g_autofree gchar *tmp = fwupd_guid_hash_string (guid);
+		const gchar *tmp = fu_device_guid_hash_string (guid);
 		fwupd_device_add_guid (FWUPD_DEVICE (self), tmp);
 		return;
 	}
@@ -1481,6 +2109,31 @@ fu_device_get_metadata_integer (FuDevice *self, const gchar *key)
 	return (guint) val;
 }
 
+/* called with the writer lock held */
+static void
+fu_device_ensure_metadata_writable (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GHashTable *metadata;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (priv->metadata == NULL) {
+		priv->metadata = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, g_free);
+		return;
+	}
+	if (!priv->metadata_shared)
+		return;
+	metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_hash_table_iter_init (&iter, priv->metadata);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_hash_table_insert (metadata, g_strdup (key), g_strdup (value));
+	g_hash_table_unref (priv->metadata);
+	priv->metadata = metadata;
+	priv->metadata_shared = FALSE;
+}
+
 /**
  * fu_device_remove_metadata:
  * @self: A #FuDevice
@@ -1500,6 +2153,7 @@ fu_device_remove_metadata (FuDevice *self, const gchar *key)
 	g_return_if_fail (locker != NULL);
 	if (priv->metadata == NULL)
 		return;
+	fu_device_ensure_metadata_writable (self);
 	g_hash_table_remove (priv->metadata, key);
 }
 
@@ -1522,10 +2176,7 @@ fu_device_set_metadata (FuDevice *self, const gchar *key, const gchar *value)
 	g_return_if_fail (key != NULL);
 	g_return_if_fail (value != NULL);
 	g_return_if_fail (locker != NULL);
-	if (priv->metadata == NULL) {
-		priv->metadata = g_hash_table_new_full (g_str_hash, g_str_equal,
-							g_free, g_free);
-	}
+	fu_device_ensure_metadata_writable (self);
 	g_hash_table_insert (priv->metadata, g_strdup (key), g_strdup (value));
 }
 
@@ -2130,78 +2781,254 @@ fu_device_has_custom_flag (FuDevice *self, const gchar *hint)
 	return g_strv_contains ((const gchar * const *) hints, hint);
 }
 
-/**
- * fu_device_get_remove_delay:
- * @self: A #FuDevice
- *
- * Returns the maximum delay expected when replugging the device going into
- * bootloader mode.
- *
- * Returns: time in milliseconds
- *
- * Since: 1.0.2
- **/
-guint
-fu_device_get_remove_delay (FuDevice *self)
+/**
+ * fu_device_get_remove_delay:
+ * @self: A #FuDevice
+ *
+ * Returns the maximum delay expected when replugging the device going into
+ * bootloader mode.
+ *
+ * Returns: time in milliseconds
+ *
+ * Since: 1.0.2
+ **/
+guint
+fu_device_get_remove_delay (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
+	return priv->remove_delay;
+}
+
+/**
+ * fu_device_set_remove_delay:
+ * @self: A #FuDevice
+ * @remove_delay: the remove_delay value
+ *
+ * Sets the amount of time a device is allowed to return in bootloader mode.
+ *
+ * NOTE: this should be less than 3000ms for devices that just have to reset
+ * and automatically re-enumerate, but significantly longer if it involves a
+ * user removing a cable, pressing several buttons and removing a cable.
+ * A suggested value for this would be 10,000ms.
+ *
+ * Since: 1.0.2
+ **/
+void
+fu_device_set_remove_delay (FuDevice *self, guint remove_delay)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	priv->remove_delay = remove_delay;
+}
+
+/**
+ * fu_device_get_status:
+ * @self: A #FuDevice
+ *
+ * Returns what the device is currently doing.
+ *
+ * Returns: the status value, e.g. %FWUPD_STATUS_DEVICE_WRITE
+ *
+ * Since: 1.0.3
+ **/
+FwupdStatus
+fu_device_get_status (FuDevice *self)
+{
+	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
+	return fwupd_device_get_status (FWUPD_DEVICE (self));
+}
+
+/**
+ * fu_device_set_status:
+ * @self: A #FuDevice
+ * @status: the status value, e.g. %FWUPD_STATUS_DEVICE_WRITE
+ *
+ * Sets what the device is currently doing.
+ *
+ * Since: 1.0.3
+ **/
+void
+fu_device_set_status (FuDevice *self, FwupdStatus status)
+{
+	g_return_if_fail (FU_IS_DEVICE (self));
+	fwupd_device_set_status (FWUPD_DEVICE (self), status);
+}
+
+static void
+fu_device_progress_phase_free (FuDeviceProgressPhase *phase)
+{
+	g_free (phase->id);
+	g_free (phase);
+}
+
+/* use the measured durations from the last time, but only when every phase
+ * has been seen as otherwise the declared and measured weights are mixed */
+static gdouble
+fu_device_progress_phase_get_weight (FuDevice *self, guint idx)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDeviceProgressPhase *phase = g_ptr_array_index (priv->progress_phases, idx);
+	if (priv->progress_phase_durations != NULL) {
+		gboolean measured = TRUE;
+		for (guint i = 0; i < priv->progress_phases->len; i++) {
+			FuDeviceProgressPhase *phase_tmp = g_ptr_array_index (priv->progress_phases, i);
+			if (!g_hash_table_contains (priv->progress_phase_durations, phase_tmp->id)) {
+				measured = FALSE;
+				break;
+			}
+		}
+		if (measured) {
+			gdouble *duration = g_hash_table_lookup (priv->progress_phase_durations,
+								 phase->id);
+			return *duration;
+		}
+	}
+	return (gdouble) phase->weight;
+}
+
+static void
+fu_device_progress_phase_get_range (FuDevice *self, guint idx, gdouble *start, gdouble *span)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
-	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
-	return priv->remove_delay;
+	gdouble total = 0.f;
+	gdouble before = 0.f;
+
+	for (guint i = 0; i < priv->progress_phases->len; i++) {
+		gdouble weight = fu_device_progress_phase_get_weight (self, i);
+		if (i < idx)
+			before += weight;
+		total += weight;
+	}
+	if (total <= 0.f) {
+		*start = 0.f;
+		*span = 100.f;
+		return;
+	}
+	*start = (100.f * before) / total;
+	*span = (100.f * fu_device_progress_phase_get_weight (self, idx)) / total;
+}
+
+/* save how long the current phase took so the next install is more accurate */
+static void
+fu_device_progress_phase_record (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDeviceProgressPhase *phase;
+	gdouble *duration;
+
+	if (priv->progress_phases == NULL ||
+	    priv->progress_phase_idx >= priv->progress_phases->len)
+		return;
+	if (priv->progress_phase_durations == NULL) {
+		priv->progress_phase_durations = g_hash_table_new_full (g_str_hash,
+									g_str_equal,
+									g_free,
+									g_free);
+	}
+	phase = g_ptr_array_index (priv->progress_phases, priv->progress_phase_idx);
+	duration = g_new0 (gdouble, 1);
+	*duration = MAX ((gdouble) (g_get_monotonic_time () - priv->progress_phase_start) /
+			 G_USEC_PER_SEC, 0.001);
+	g_hash_table_insert (priv->progress_phase_durations,
+			     g_strdup (phase->id),
+			     duration);
 }
 
 /**
- * fu_device_set_remove_delay:
+ * fu_device_add_progress_phase:
  * @self: A #FuDevice
- * @remove_delay: the remove_delay value
+ * @id: a phase ID, e.g. `erase`
+ * @weight: the expected relative duration of the phase
  *
- * Sets the amount of time a device is allowed to return in bootloader mode.
+ * Adds a phase to the device progress, so that fu_device_set_progress() and
+ * fu_device_set_progress_full() report the completion of just this phase when
+ * it is made current using fu_device_set_progress_phase().
  *
- * NOTE: this should be less than 3000ms for devices that just have to reset
- * and automatically re-enumerate, but significantly longer if it involves a
- * user removing a cable, pressing several buttons and removing a cable.
- * A suggested value for this would be 10,000ms.
+ * The weights are only a hint; once each phase has completed on this device
+ * the measured durations are used instead.
  *
- * Since: 1.0.2
+ * Since: 1.5.0
  **/
 void
-fu_device_set_remove_delay (FuDevice *self, guint remove_delay)
+fu_device_add_progress_phase (FuDevice *self, const gchar *id, guint weight)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDeviceProgressPhase *phase;
+
 	g_return_if_fail (FU_IS_DEVICE (self));
-	priv->remove_delay = remove_delay;
+	g_return_if_fail (id != NULL);
+
+	if (priv->progress_phases == NULL) {
+		priv->progress_phases = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_progress_phase_free);
+		priv->progress_phase_idx = G_MAXUINT;
+	}
+	for (guint i = 0; i < priv->progress_phases->len; i++) {
+		phase = g_ptr_array_index (priv->progress_phases, i);
+		if (g_strcmp0 (phase->id, id) == 0) {
+			phase->weight = weight;
+			return;
+		}
+	}
+	phase = g_new0 (FuDeviceProgressPhase, 1);
+	phase->id = g_strdup (id);
+	phase->weight = weight;
+	g_ptr_array_add (priv->progress_phases, phase);
 }
 
 /**
- * fu_device_get_status:
+ * fu_device_set_progress_phase:
  * @self: A #FuDevice
+ * @id: a phase ID added with fu_device_add_progress_phase()
  *
- * Returns what the device is currently doing.
- *
- * Returns: the status value, e.g. %FWUPD_STATUS_DEVICE_WRITE
+ * Makes a phase current and sets the progress to the start of the phase.
  *
- * Since: 1.0.3
+ * Since: 1.5.0
  **/
-FwupdStatus
-fu_device_get_status (FuDevice *self)
+void
+fu_device_set_progress_phase (FuDevice *self, const gchar *id)
 {
-	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
-	return fwupd_device_get_status (FWUPD_DEVICE (self));
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (id != NULL);
+
+	if (priv->progress_phases == NULL) {
+		g_warning ("no progress phases added for %s", id);
+		return;
+	}
+	for (guint i = 0; i < priv->progress_phases->len; i++) {
+		FuDeviceProgressPhase *phase = g_ptr_array_index (priv->progress_phases, i);
+		if (g_strcmp0 (phase->id, id) != 0)
+			continue;
+		if (priv->progress_phase_idx == i)
+			return;
+		fu_device_progress_phase_record (self);
+		priv->progress_phase_idx = i;
+		priv->progress_phase_start = g_get_monotonic_time ();
+		fu_device_set_progress (self, 0);
+		return;
+	}
+	g_warning ("no progress phase %s", id);
 }
 
 /**
- * fu_device_set_status:
+ * fu_device_clear_progress_phases:
  * @self: A #FuDevice
- * @status: the status value, e.g. %FWUPD_STATUS_DEVICE_WRITE
  *
- * Sets what the device is currently doing.
+ * Removes all the progress phases, recording the duration of the current
+ * phase if one was set.
  *
- * Since: 1.0.3
+ * Since: 1.5.0
  **/
 void
-fu_device_set_status (FuDevice *self, FwupdStatus status)
+fu_device_clear_progress_phases (FuDevice *self)
 {
+	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FU_IS_DEVICE (self));
-	fwupd_device_set_status (FWUPD_DEVICE (self), status);
+	fu_device_progress_phase_record (self);
+	g_clear_pointer (&priv->progress_phases, g_ptr_array_unref);
+	priv->progress_phase_idx = G_MAXUINT;
 }
 
 /**
@@ -2236,6 +3063,17 @@ fu_device_set_progress (FuDevice *self, guint progress)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FU_IS_DEVICE (self));
+
+	/* scale into the current phase */
+	if (priv->progress_phases != NULL &&
+	    priv->progress_phase_idx < priv->progress_phases->len) {
+		gdouble start = 0.f;
+		gdouble span = 0.f;
+		fu_device_progress_phase_get_range (self, priv->progress_phase_idx, &start, &span);
+		progress = (guint) (start + (span * MIN (progress, 100)) / 100.f);
+	}
+
+	/* inner write loops call this far more often than the value changes */
 	if (priv->progress == progress)
 		return;
 	priv->progress = progress;
@@ -2283,6 +3121,8 @@ fu_device_add_string (FuDevice *self, guint idt, GString *str)
 		fu_common_string_append_kv (str, idt + 1, "AlternateId", priv->alternate_id);
 	if (priv->equivalent_id != NULL)
 		fu_common_string_append_kv (str, idt + 1, "EquivalentId", priv->equivalent_id);
+	if (priv->install_group != NULL)
+		fu_common_string_append_kv (str, idt + 1, "InstallGroup", priv->install_group);
 	if (priv->physical_id != NULL)
 		fu_common_string_append_kv (str, idt + 1, "PhysicalId", priv->physical_id);
 	if (priv->logical_id != NULL)
@@ -2303,6 +3143,8 @@ fu_device_add_string (FuDevice *self, guint idt, GString *str)
 		fu_common_string_append_ku (str, idt + 1, "Order", priv->order);
 	if (priv->priority > 0)
 		fu_common_string_append_ku (str, idt + 1, "Priority", priv->priority);
+	if (priv->retry_cnt > 0)
+		fu_common_string_append_ku (str, idt + 1, "RetryCount", priv->retry_cnt);
 	if (priv->metadata != NULL) {
 		g_autoptr(GList) keys = g_hash_table_get_keys (priv->metadata);
 		for (GList *l = keys; l != NULL; l = l->next) {
@@ -2405,6 +3247,63 @@ fu_device_get_release_default (FuDevice *self)
 	return rel;
 }
 
+static gboolean
+fu_device_check_firmware_size (FuDevice *self, guint64 fw_sz, GError **error)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	if (priv->size_max > 0 && fw_sz > priv->size_max) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "firmware is %04x bytes larger than the allowed "
+			     "maximum size of %04x bytes",
+			     (guint) (fw_sz - priv->size_max),
+			     (guint) priv->size_max);
+		return FALSE;
+	}
+	if (priv->size_min > 0 && fw_sz < priv->size_min) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "firmware is %04x bytes smaller than the allowed "
+			     "minimum size of %04x bytes",
+			     (guint) (priv->size_min - fw_sz),
+			     (guint) priv->size_min);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* the payload is handed over as a stream so the plugin only ever holds one
+ * block of it; the FuFirmware cache and prepare_firmware are not used */
+static gboolean
+fu_device_write_firmware_stream (FuDevice *self,
+				 GBytes *fw,
+				 FwupdInstallFlags flags,
+				 GError **error)
+{
+	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+
+	if (!fu_device_check_firmware_size (self, g_bytes_get_size (fw), error))
+		return FALSE;
+	stream = g_memory_input_stream_new_from_bytes (fw);
+	g_debug ("streaming 0x%x bytes onto %s",
+		 (guint) g_bytes_get_size (fw), fu_device_get_id (self));
+
+	/* call vfunc */
+	span = fu_trace_span_new ("device", "%s:write_firmware_stream", fu_device_get_id (self));
+	fu_device_clear_progress_phases (self);
+	ret = klass->write_firmware_stream (self, stream, g_bytes_get_size (fw), flags, error);
+	if (!ret)
+		priv->progress_phase_idx = G_MAXUINT;
+	fu_device_clear_progress_phases (self);
+	return ret;
+}
+
 /**
  * fu_device_write_firmware:
  * @self: A #FuDevice
@@ -2414,6 +3313,9 @@ fu_device_get_release_default (FuDevice *self)
  *
  * Writes firmware to the device by calling a plugin-specific vfunc.
  *
+ * If the device implements the write_firmware_stream vfunc then the payload
+ * is passed as a #GInputStream and the prepare_firmware vfunc is not used.
+ *
  * Returns: %TRUE on success
  *
  * Since: 1.0.8
@@ -2425,12 +3327,27 @@ fu_device_write_firmware (FuDevice *self,
 			  GError **error)
 {
 	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
 	g_autoptr(FuFirmware) firmware = NULL;
+	g_autoptr(GBytes) firmware_cache_blob = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
 	g_autofree gchar *str = NULL;
 
 	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	/* the version may not change, so always set up again next time */
+	g_clear_pointer (&priv->snapshot_key, g_free);
+
+	/* the cached firmware is only ever used once */
+	firmware = g_steal_pointer (&priv->firmware_cache);
+	firmware_cache_blob = g_steal_pointer (&priv->firmware_cache_blob);
+
+	/* consumed sequentially without being parsed into a FuFirmware */
+	if (klass->write_firmware_stream != NULL)
+		return fu_device_write_firmware_stream (self, fw, flags, error);
+
 	/* no plugin-specific method */
 	if (klass->write_firmware == NULL) {
 		g_set_error_literal (error,
@@ -2440,15 +3357,115 @@ fu_device_write_firmware (FuDevice *self,
 		return FALSE;
 	}
 
-	/* prepare (e.g. decompress) firmware */
-	firmware = fu_device_prepare_firmware (self, fw, flags, error);
-	if (firmware == NULL)
-		return FALSE;
+	/* prepare (e.g. decompress) firmware, unless done before detach */
+	if (firmware != NULL &&
+	    (priv->firmware_cache_flags != flags ||
+	     (firmware_cache_blob != fw &&
+	      !g_bytes_equal (firmware_cache_blob, fw))))
+		g_clear_object (&firmware);
+	if (firmware == NULL) {
+		firmware = fu_device_prepare_firmware (self, fw, flags, error);
+		if (firmware == NULL)
+			return FALSE;
+	} else {
+		g_debug ("using firmware prepared before detach");
+	}
 	str = fu_firmware_to_string (firmware);
 	g_debug ("installing onto %s:\n%s", fu_device_get_id (self), str);
 
 	/* call vfunc */
-	return klass->write_firmware (self, firmware, flags, error);
+	span = fu_trace_span_new ("device", "%s:write_firmware", fu_device_get_id (self));
+	fu_device_clear_progress_phases (self);
+	ret = klass->write_firmware (self, firmware, flags, error);
+
+	/* a partial phase duration would skew the next install */
+	if (!ret)
+		priv->progress_phase_idx = G_MAXUINT;
+	fu_device_clear_progress_phases (self);
+	return ret;
+}
+
+/**
+ * fu_device_cache_firmware:
+ * @self: A #FuDevice
+ * @fw: A #GBytes
+ * @flags: #FwupdInstallFlags, e.g. %FWUPD_INSTALL_FLAG_FORCE
+ * @error: A #GError
+ *
+ * Prepares the firmware ahead of the update, typically before the device is
+ * detached into bootloader mode. If fu_device_write_firmware() is then called
+ * on the same object with the same data and flags then the firmware is not
+ * parsed again. The cached firmware is only used once.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_cache_firmware (FuDevice *self,
+			  GBytes *fw,
+			  FwupdInstallFlags flags,
+			  GError **error)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_autoptr(FuFirmware) firmware = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (fw != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	g_clear_object (&priv->firmware_cache);
+	g_clear_pointer (&priv->firmware_cache_blob, g_bytes_unref);
+
+	/* nothing to prepare when streamed */
+	if (FU_DEVICE_GET_CLASS (self)->write_firmware_stream != NULL)
+		return fu_device_check_firmware_size (self, g_bytes_get_size (fw), error);
+
+	firmware = fu_device_prepare_firmware (self, fw, flags, error);
+	if (firmware == NULL)
+		return FALSE;
+	priv->firmware_cache = g_steal_pointer (&firmware);
+	priv->firmware_cache_blob = g_bytes_ref (fw);
+	priv->firmware_cache_flags = flags;
+	return TRUE;
+}
+
+/**
+ * fu_device_incorporate_firmware_cache:
+ * @self: A #FuDevice
+ * @donor: Another #FuDevice
+ *
+ * Moves the firmware prepared using fu_device_cache_firmware() from @donor,
+ * typically the runtime device that was replaced when detaching. This is
+ * only done when both devices are the same type, as otherwise the
+ * prepare_firmware vfunc may not return the same result.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_incorporate_firmware_cache (FuDevice *self, FuDevice *donor)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDevicePrivate *priv_donor = GET_PRIVATE (donor);
+
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (FU_IS_DEVICE (donor));
+
+	if (priv_donor->firmware_cache == NULL || self == donor)
+		return;
+	if (G_OBJECT_TYPE (self) != G_OBJECT_TYPE (donor)) {
+		g_debug ("not using prepared firmware from %s as %s",
+			 G_OBJECT_TYPE_NAME (donor),
+			 G_OBJECT_TYPE_NAME (self));
+		g_clear_object (&priv_donor->firmware_cache);
+		g_clear_pointer (&priv_donor->firmware_cache_blob, g_bytes_unref);
+		return;
+	}
+	g_clear_object (&priv->firmware_cache);
+	g_clear_pointer (&priv->firmware_cache_blob, g_bytes_unref);
+	priv->firmware_cache = g_steal_pointer (&priv_donor->firmware_cache);
+	priv->firmware_cache_blob = g_steal_pointer (&priv_donor->firmware_cache_blob);
+	priv->firmware_cache_flags = priv_donor->firmware_cache_flags;
 }
 
 /**
@@ -2477,7 +3494,6 @@ fu_device_prepare_firmware (FuDevice *self,
 			    GError **error)
 {
 	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
-	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_autoptr(FuFirmware) firmware = NULL;
 	g_autoptr(GBytes) fw_def = NULL;
 
@@ -2497,27 +3513,8 @@ fu_device_prepare_firmware (FuDevice *self,
 	/* check size */
 	fw_def = fu_firmware_get_image_default_bytes (firmware, NULL);
 	if (fw_def != NULL) {
-		guint64 fw_sz = (guint64) g_bytes_get_size (fw_def);
-		if (priv->size_max > 0 && fw_sz > priv->size_max) {
-			g_set_error (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "firmware is %04x bytes larger than the allowed "
-				     "maximum size of %04x bytes",
-				     (guint) (fw_sz - priv->size_max),
-				     (guint) priv->size_max);
-			return NULL;
-		}
-		if (priv->size_min > 0 && fw_sz < priv->size_min) {
-			g_set_error (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "firmware is %04x bytes smaller than the allowed "
-				     "minimum size of %04x bytes",
-				     (guint) (priv->size_min - fw_sz),
-				     (guint) priv->size_max);
+		if (!fu_device_check_firmware_size (self, g_bytes_get_size (fw_def), error))
 			return NULL;
-		}
 	}
 
 	/* success */
@@ -2558,6 +3555,157 @@ fu_device_read_firmware (FuDevice *self, GError **error)
 	return klass->read_firmware (self, error);
 }
 
+/**
+ * fu_device_read_firmware_chunked:
+ * @self: A #FuDevice
+ * @func: (scope call): A #FuDeviceReadChunkFunc called for each chunk
+ * @user_data: user data for @func
+ * @error: A #GError
+ *
+ * Reads firmware from the device, calling @func as each chunk arrives so that
+ * the whole image does not have to be kept in memory. If @func fails then
+ * the read is aborted.
+ *
+ * If the device does not implement the `read_firmware_chunked` vfunc then the
+ * firmware is read using fu_device_read_firmware() and @func is called once.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_read_firmware_chunked (FuDevice *self,
+				 FuDeviceReadChunkFunc func,
+				 gpointer user_data,
+				 GError **error)
+{
+	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
+	const guint8 *buf;
+	gsize bufsz = 0;
+	g_autoptr(FuFirmware) firmware = NULL;
+	g_autoptr(GBytes) fw = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* plugin-specific method */
+	if (fu_device_has_flag (self, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE) &&
+	    klass->read_firmware_chunked != NULL)
+		return klass->read_firmware_chunked (self, func, user_data, error);
+
+	/* read the whole image */
+	firmware = fu_device_read_firmware (self, error);
+	if (firmware == NULL)
+		return FALSE;
+	fw = fu_firmware_write (firmware, error);
+	if (fw == NULL) {
+		g_prefix_error (error, "failed to write firmware: ");
+		return FALSE;
+	}
+	buf = g_bytes_get_data (fw, &bufsz);
+	return func (self, buf, bufsz, user_data, error);
+}
+
+typedef struct {
+	GChecksum		*csum_sha1;
+	GChecksum		*csum_sha256;
+	GBytes			*fw_expected;	/* nullable */
+	gsize			 offset;
+} FuDeviceReadChecksumsHelper;
+
+static gboolean
+fu_device_read_firmware_checksums_cb (FuDevice *self,
+				      const guint8 *buf,
+				      gsize bufsz,
+				      gpointer user_data,
+				      GError **error)
+{
+	FuDeviceReadChecksumsHelper *helper = (FuDeviceReadChecksumsHelper *) user_data;
+
+	/* abort on the first difference rather than reading everything */
+	if (helper->fw_expected != NULL) {
+		gsize expected_sz = 0;
+		const guint8 *expected = g_bytes_get_data (helper->fw_expected, &expected_sz);
+		if (helper->offset + bufsz > expected_sz) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "got more than %" G_GSIZE_FORMAT " bytes",
+				     expected_sz);
+			return FALSE;
+		}
+		if (memcmp (buf, expected + helper->offset, bufsz) != 0) {
+			for (gsize i = 0; i < bufsz; i++) {
+				if (buf[i] == expected[helper->offset + i])
+					continue;
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "got 0x%02x, expected 0x%02x @ 0x%04x",
+					     buf[i], expected[helper->offset + i],
+					     (guint) (helper->offset + i));
+				return FALSE;
+			}
+		}
+	}
+	g_checksum_update (helper->csum_sha1, buf, bufsz);
+	g_checksum_update (helper->csum_sha256, buf, bufsz);
+	helper->offset += bufsz;
+	return TRUE;
+}
+
+/**
+ * fu_device_read_firmware_checksums:
+ * @self: A #FuDevice
+ * @fw_expected: (nullable): The expected firmware contents
+ * @error: A #GError
+ *
+ * Reads firmware from the device and adds the SHA1 and SHA256 checksums of
+ * the contents to the device. Each chunk is hashed as it arrives.
+ *
+ * If @fw_expected is provided then each chunk is also compared, and the read
+ * is aborted on the first difference.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_read_firmware_checksums (FuDevice *self, GBytes *fw_expected, GError **error)
+{
+	FuDeviceReadChecksumsHelper helper = {
+		.csum_sha1 = g_checksum_new (G_CHECKSUM_SHA1),
+		.csum_sha256 = g_checksum_new (G_CHECKSUM_SHA256),
+		.fw_expected = fw_expected,
+		.offset = 0,
+	};
+	gboolean ret;
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	ret = fu_device_read_firmware_chunked (self,
+					       fu_device_read_firmware_checksums_cb,
+					       &helper, error);
+	if (ret && fw_expected != NULL &&
+	    helper.offset != g_bytes_get_size (fw_expected)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "got %" G_GSIZE_FORMAT " bytes, expected %" G_GSIZE_FORMAT,
+			     helper.offset, g_bytes_get_size (fw_expected));
+		ret = FALSE;
+	}
+	if (ret) {
+		fu_device_add_checksum (self, g_checksum_get_string (helper.csum_sha1));
+		fu_device_add_checksum (self, g_checksum_get_string (helper.csum_sha256));
+	}
+	g_checksum_free (helper.csum_sha1);
+	g_checksum_free (helper.csum_sha256);
+	return ret;
+}
+
 /**
  * fu_device_detach:
  * @self: A #FuDevice
@@ -2899,7 +4047,7 @@ fu_device_convert_instance_ids (FuDevice *self)
 		return;
 	for (guint i = 0; i < instance_ids->len; i++) {
 		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
-		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
+		const gchar *guid = fu_device_guid_hash_string (instance_id);
 		fwupd_device_add_guid (FWUPD_DEVICE (self), guid);
 	}
 
@@ -2936,6 +4084,18 @@ fu_device_setup (FuDevice *self, GError **error)
 	if (priv->done_setup)
 		return TRUE;
 
+	/* seen before with the same version */
+	if (priv->skip_setup_unchanged) {
+		g_free (priv->snapshot_key);
+		priv->snapshot_key = fu_device_snapshot_build_key (self);
+		if (priv->snapshot_key != NULL &&
+		    fu_device_snapshot_restore (self, priv->snapshot_key)) {
+			fu_device_convert_instance_ids (self);
+			priv->done_setup = TRUE;
+			return TRUE;
+		}
+	}
+
 	/* subclassed */
 	if (klass->setup != NULL) {
 		if (!klass->setup (self, error))
@@ -3073,6 +4233,7 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 	FuDevicePrivate *priv_donor = GET_PRIVATE (donor);
 	GPtrArray *instance_ids = fu_device_get_instance_ids (donor);
 	GPtrArray *parent_guids = fu_device_get_parent_guids (donor);
+	g_autoptr(GPtrArray) instance_ids_new = g_ptr_array_new ();
 
 	g_return_if_fail (FU_IS_DEVICE (self));
 	g_return_if_fail (FU_IS_DEVICE (donor));
@@ -3082,6 +4243,8 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 		fu_device_set_alternate_id (self, fu_device_get_alternate_id (donor));
 	if (priv->equivalent_id == NULL)
 		fu_device_set_equivalent_id (self, fu_device_get_equivalent_id (donor));
+	if (priv->install_group == NULL)
+		fu_device_set_install_group (self, fu_device_get_install_group (donor));
 	if (priv->physical_id == NULL && priv_donor->physical_id != NULL)
 		fu_device_set_physical_id (self, priv_donor->physical_id);
 	if (priv->logical_id == NULL && priv_donor->logical_id != NULL)
@@ -3092,22 +4255,51 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 		fu_device_set_proxy_guid (self, priv_donor->proxy_guid);
 	if (priv->quirks == NULL)
 		fu_device_set_quirks (self, fu_device_get_quirks (donor));
-	g_rw_lock_reader_lock (&priv_donor->parent_guids_mutex);
-	for (guint i = 0; i < parent_guids->len; i++)
-		fu_device_add_parent_guid (self, g_ptr_array_index (parent_guids, i));
-	g_rw_lock_reader_unlock (&priv_donor->parent_guids_mutex);
-	g_rw_lock_reader_lock (&priv_donor->metadata_mutex);
-	if (priv->metadata != NULL) {
-		g_autoptr(GList) keys = g_hash_table_get_keys (priv_donor->metadata);
-		for (GList *l = keys; l != NULL; l = l->next) {
-			const gchar *key = l->data;
-			if (g_hash_table_lookup (priv->metadata, key) == NULL) {
-				const gchar *value = g_hash_table_lookup (priv_donor->metadata, key);
-				fu_device_set_metadata (self, key, value);
+
+	/* share the donor arrays until either device changes them */
+	g_rw_lock_writer_lock (&priv_donor->parent_guids_mutex);
+	if (priv->parent_guids->len == 0 && parent_guids->len > 0) {
+		g_rw_lock_writer_lock (&priv->parent_guids_mutex);
+		g_ptr_array_unref (priv->parent_guids);
+		priv->parent_guids = g_ptr_array_ref (parent_guids);
+		priv->parent_guids_shared = TRUE;
+		priv_donor->parent_guids_shared = TRUE;
+		g_rw_lock_writer_unlock (&priv->parent_guids_mutex);
+	} else {
+		for (guint i = 0; i < parent_guids->len; i++)
+			fu_device_add_parent_guid (self, g_ptr_array_index (parent_guids, i));
+	}
+	g_rw_lock_writer_unlock (&priv_donor->parent_guids_mutex);
+	g_rw_lock_writer_lock (&priv_donor->metadata_mutex);
+	if (priv_donor->metadata != NULL) {
+		g_rw_lock_writer_lock (&priv->metadata_mutex);
+		if (priv->metadata == NULL) {
+			priv->metadata = g_hash_table_ref (priv_donor->metadata);
+			priv->metadata_shared = TRUE;
+			priv_donor->metadata_shared = TRUE;
+		} else {
+			GHashTableIter iter;
+			gpointer key, value;
+			g_hash_table_iter_init (&iter, priv_donor->metadata);
+			while (g_hash_table_iter_next (&iter, &key, &value)) {
+				if (g_hash_table_lookup (priv->metadata, key) != NULL)
+					continue;
+				fu_device_ensure_metadata_writable (self);
+				g_hash_table_insert (priv->metadata,
+						     g_strdup (key),
+						     g_strdup (value));
 			}
 		}
+		g_rw_lock_writer_unlock (&priv->metadata_mutex);
+	}
+	g_rw_lock_writer_unlock (&priv_donor->metadata_mutex);
+
+	/* quirks have already been applied for the instance IDs we have */
+	for (guint i = 0; i < instance_ids->len; i++) {
+		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
+		if (!fwupd_device_has_instance_id (FWUPD_DEVICE (self), instance_id))
+			g_ptr_array_add (instance_ids_new, (gpointer) instance_id);
 	}
-	g_rw_lock_reader_unlock (&priv_donor->metadata_mutex);
 
 	/* now the base class, where all the interesting bits are */
 	fwupd_device_incorporate (FWUPD_DEVICE (self), FWUPD_DEVICE (donor));
@@ -3121,9 +4313,9 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 		klass->incorporate (self, donor);
 
 	/* call the set_quirk_kv() vfunc for the superclassed object */
-	for (guint i = 0; i < instance_ids->len; i++) {
-		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
-		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
+	for (guint i = 0; i < instance_ids_new->len; i++) {
+		const gchar *instance_id = g_ptr_array_index (instance_ids_new, i);
+		const gchar *guid = fu_device_guid_hash_string (instance_id);
 		fu_device_add_guid_quirks (self, guid);
 	}
 }
@@ -3224,9 +4416,10 @@ fu_device_init (FuDevice *self)
 {
 	FuDevicePrivate *priv = GET_PRIVATE (self);
 	priv->children = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	priv->parent_guids = g_ptr_array_new_with_free_func (g_free);
-	priv->possible_plugins = g_ptr_array_new_with_free_func (g_free);
-	priv->retry_recs = g_ptr_array_new_with_free_func (g_free);
+	priv->parent_guids = g_ptr_array_new ();
+	priv->possible_plugins = g_ptr_array_new ();
+	priv->retry_multiplier = 1;
+	priv->progress_phase_idx = G_MAXUINT;
 	g_rw_lock_init (&priv->parent_guids_mutex);
 	g_rw_lock_init (&priv->metadata_mutex);
 }
@@ -3248,16 +4441,30 @@ fu_device_finalize (GObject *object)
 		g_object_remove_weak_pointer (G_OBJECT (priv->proxy), (gpointer *) &priv->proxy);
 	if (priv->quirks != NULL)
 		g_object_unref (priv->quirks);
-	if (priv->poll_id != 0)
-		g_source_remove (priv->poll_id);
+	fu_device_poll_stop (self);
 	if (priv->metadata != NULL)
 		g_hash_table_unref (priv->metadata);
+	if (priv->packet_buf != NULL)
+		g_byte_array_unref (priv->packet_buf);
+	if (priv->firmware_cache != NULL)
+		g_object_unref (priv->firmware_cache);
+	if (priv->firmware_cache_blob != NULL)
+		g_bytes_unref (priv->firmware_cache_blob);
 	g_ptr_array_unref (priv->children);
 	g_ptr_array_unref (priv->parent_guids);
 	g_ptr_array_unref (priv->possible_plugins);
-	g_ptr_array_unref (priv->retry_recs);
+	if (priv->retry_recs != NULL)
+		g_ptr_array_unref (priv->retry_recs);
+	if (priv->progress_phases != NULL)
+		g_ptr_array_unref (priv->progress_phases);
+	if (priv->progress_phase_durations != NULL)
+		g_hash_table_unref (priv->progress_phase_durations);
 	g_free (priv->alternate_id);
 	g_free (priv->equivalent_id);
+	g_free (priv->install_group);
+	g_free (priv->snapshot_key);
+	if (priv->io_recording != NULL)
+		g_object_unref (priv->io_recording);
 	g_free (priv->physical_id);
 	g_free (priv->logical_id);
 	g_free (priv->proxy_guid);
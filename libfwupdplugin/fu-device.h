@@ -10,12 +10,19 @@
 #include <fwupd.h>
 
 #include "fu-firmware.h"
+#include "fu-io-recording.h"
 #include "fu-quirks.h"
 #include "fu-common-version.h"
 
 #define FU_TYPE_DEVICE (fu_device_get_type ())
 G_DECLARE_DERIVABLE_TYPE (FuDevice, fu_device, FU, DEVICE, FwupdDevice)
 
+typedef gboolean (*FuDeviceReadChunkFunc)	(FuDevice	*self,
+						 const guint8	*buf,
+						 gsize		 bufsz,
+						 gpointer	 user_data,
+						 GError		**error);
+
 struct _FuDeviceClass
 {
 	FwupdDeviceClass	 parent_class;
@@ -68,8 +75,17 @@ struct _FuDeviceClass
 							 GHashTable	*metadata);
 	void			 (*report_metadata_post)(FuDevice	*self,
 							 GHashTable	*metadata);
+	gboolean		 (*read_firmware_chunked)(FuDevice	*self,
+							 FuDeviceReadChunkFunc func,
+							 gpointer	 user_data,
+							 GError		**error);
+	gboolean		 (*write_firmware_stream)(FuDevice	*self,
+							 GInputStream	*stream,
+							 gsize		 streamsz,
+							 FwupdInstallFlags flags,
+							 GError		**error);
 	/*< private >*/
-	gpointer	padding[14];
+	gpointer	padding[12];
 };
 
 /**
@@ -170,6 +186,9 @@ void		 fu_device_set_alternate_id		(FuDevice	*self,
 const gchar	*fu_device_get_equivalent_id		(FuDevice	*self);
 void		 fu_device_set_equivalent_id		(FuDevice	*self,
 							 const gchar	*equivalent_id);
+const gchar	*fu_device_get_install_group		(FuDevice	*self);
+void		 fu_device_set_install_group		(FuDevice	*self,
+							 const gchar	*install_group);
 void		 fu_device_add_guid			(FuDevice	*self,
 							 const gchar	*guid);
 gboolean	 fu_device_has_guid			(FuDevice	*self,
@@ -263,6 +282,12 @@ void		 fu_device_set_progress			(FuDevice	*self,
 void		 fu_device_set_progress_full		(FuDevice	*self,
 							 gsize		 progress_done,
 							 gsize		 progress_total);
+void		 fu_device_add_progress_phase		(FuDevice	*self,
+							 const gchar	*id,
+							 guint		 weight);
+void		 fu_device_set_progress_phase		(FuDevice	*self,
+							 const gchar	*id);
+void		 fu_device_clear_progress_phases	(FuDevice	*self);
 void		 fu_device_set_quirks			(FuDevice	*self,
 							 FuQuirks	*quirks);
 FuQuirks	*fu_device_get_quirks			(FuDevice	*self);
@@ -277,6 +302,13 @@ FuFirmware	*fu_device_prepare_firmware		(FuDevice	*self,
 							 GError		**error);
 FuFirmware	*fu_device_read_firmware		(FuDevice	*self,
 							 GError		**error);
+gboolean	 fu_device_read_firmware_chunked	(FuDevice	*self,
+							 FuDeviceReadChunkFunc func,
+							 gpointer	 user_data,
+							 GError		**error);
+gboolean	 fu_device_read_firmware_checksums	(FuDevice	*self,
+							 GBytes		*fw_expected,
+							 GError		**error);
 gboolean	 fu_device_attach			(FuDevice	*self,
 							 GError		**error);
 gboolean	 fu_device_detach			(FuDevice	*self,
@@ -313,6 +345,17 @@ void		 fu_device_set_poll_interval		(FuDevice	*self,
 							 guint		 interval);
 void		 fu_device_retry_set_delay		(FuDevice	*self,
 							 guint		 delay);
+void		 fu_device_retry_set_backoff		(FuDevice	*self,
+							 guint		 multiplier,
+							 guint		 delay_max);
+void		 fu_device_retry_set_jitter		(FuDevice	*self,
+							 guint		 jitter);
+guint		 fu_device_get_retry_count		(FuDevice	*self);
+void		 fu_device_set_skip_setup_unchanged	(FuDevice	*self,
+							 gboolean	 skip_setup_unchanged);
+void		 fu_device_set_io_recording		(FuDevice	*self,
+							 FuIoRecording	*io_recording);
+FuIoRecording	*fu_device_get_io_recording		(FuDevice	*self);
 void		 fu_device_retry_add_recovery		(FuDevice	*self,
 							 GQuark		 domain,
 							 gint		 code,
@@ -322,5 +365,13 @@ gboolean	 fu_device_retry			(FuDevice	*self,
 							 guint		 count,
 							 gpointer	 user_data,
 							 GError		**error);
+gboolean	 fu_device_retry_with_backoff		(FuDevice	*self,
+							 FuDeviceRetryFunc func,
+							 guint		 delay,
+							 guint		 timeout,
+							 gpointer	 user_data,
+							 GError		**error);
+guint8		*fu_device_get_packet_buffer		(FuDevice	*self,
+							 gsize		 bufsz);
 GHashTable	*fu_device_report_metadata_pre		(FuDevice	*self);
 GHashTable	*fu_device_report_metadata_post		(FuDevice	*self);
@@ -22,6 +22,120 @@
 
 #include "fwupd-error.h"
 
+/* efivarfs reads can trap into SMM, so keep recently read variables; the TTL
+ * bounds how long a change made by something other than this process is hidden */
+#define FU_EFIVAR_CACHE_TTL		(60 * G_USEC_PER_SEC)
+
+typedef struct {
+	guint32		 attr;
+	GBytes		*data;
+	gint64		 created;
+} FuEfivarCacheItem;
+
+static GMutex		 efivar_cache_mutex;
+static GHashTable	*efivar_cache = NULL;	/* filename : FuEfivarCacheItem */
+static guint		 efivar_cache_hits = 0;
+static guint		 efivar_cache_misses = 0;
+
+static void
+fu_efivar_cache_item_free (FuEfivarCacheItem *item)
+{
+	g_bytes_unref (item->data);
+	g_free (item);
+}
+
+#ifndef _WIN32
+/* returns a new reference, or %NULL if not cached or too old */
+static GBytes *
+fu_efivar_cache_lookup (const gchar *fn, guint32 *attr)
+{
+	FuEfivarCacheItem *item;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&efivar_cache_mutex);
+
+	if (efivar_cache == NULL) {
+		efivar_cache_misses++;
+		return NULL;
+	}
+	item = g_hash_table_lookup (efivar_cache, fn);
+	if (item == NULL) {
+		efivar_cache_misses++;
+		return NULL;
+	}
+	if (g_get_monotonic_time () - item->created > FU_EFIVAR_CACHE_TTL) {
+		g_hash_table_remove (efivar_cache, fn);
+		efivar_cache_misses++;
+		return NULL;
+	}
+	efivar_cache_hits++;
+	if (attr != NULL)
+		*attr = item->attr;
+	return g_bytes_ref (item->data);
+}
+#endif
+
+static gboolean
+fu_efivar_cache_contains (const gchar *fn)
+{
+	FuEfivarCacheItem *item;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&efivar_cache_mutex);
+	if (efivar_cache == NULL)
+		return FALSE;
+	item = g_hash_table_lookup (efivar_cache, fn);
+	if (item == NULL)
+		return FALSE;
+	return g_get_monotonic_time () - item->created <= FU_EFIVAR_CACHE_TTL;
+}
+
+#ifndef _WIN32
+static void
+fu_efivar_cache_insert (const gchar *fn, guint32 attr, GBytes *data)
+{
+	FuEfivarCacheItem *item = g_new0 (FuEfivarCacheItem, 1);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&efivar_cache_mutex);
+	if (efivar_cache == NULL) {
+		efivar_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						      (GDestroyNotify) fu_efivar_cache_item_free);
+	}
+	item->attr = attr;
+	item->data = g_bytes_ref (data);
+	item->created = g_get_monotonic_time ();
+	g_hash_table_insert (efivar_cache, g_strdup (fn), item);
+}
+#endif
+
+/* invalidate one variable, or everything if @fn is %NULL */
+static void
+fu_efivar_cache_invalidate (const gchar *fn)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&efivar_cache_mutex);
+	if (efivar_cache == NULL)
+		return;
+	if (fn == NULL) {
+		g_hash_table_remove_all (efivar_cache);
+		return;
+	}
+	g_hash_table_remove (efivar_cache, fn);
+}
+
+/**
+ * fu_efivar_get_cache_stats:
+ * @hits: (out) (optional): number of reads served from the cache
+ * @misses: (out) (optional): number of reads that had to use efivarfs
+ *
+ * Gets the statistics of the in-process EFI variable cache.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_efivar_get_cache_stats (guint *hits, guint *misses)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&efivar_cache_mutex);
+	if (hits != NULL)
+		*hits = efivar_cache_hits;
+	if (misses != NULL)
+		*misses = efivar_cache_misses;
+}
+
 static gchar *
 fu_efivar_get_path (void)
 {
@@ -181,6 +295,7 @@ fu_efivar_delete (const gchar *guid, const gchar *name, GError **error)
 {
 	g_autofree gchar *fn = fu_efivar_get_filename (guid, name);
 	g_autoptr(GFile) file = g_file_new_for_path (fn);
+	fu_efivar_cache_invalidate (fn);
 	if (!g_file_query_exists (file, NULL))
 		return TRUE;
 	if (!fu_efivar_set_immutable (fn, FALSE, NULL, error)) {
@@ -209,6 +324,7 @@ fu_efivar_delete_with_glob (const gchar *guid, const gchar *name_glob, GError **
 	g_autofree gchar *nameguid_glob = NULL;
 	g_autofree gchar *efivardir = fu_efivar_get_path ();
 	g_autoptr(GDir) dir = g_dir_open (efivardir, 0, error);
+	fu_efivar_cache_invalidate (NULL);
 	if (dir == NULL)
 		return FALSE;
 	nameguid_glob = g_strdup_printf ("%s-%s", name_glob, guid);
@@ -242,6 +358,8 @@ gboolean
 fu_efivar_exists (const gchar *guid, const gchar *name)
 {
 	g_autofree gchar *fn = fu_efivar_get_filename (guid, name);
+	if (fu_efivar_cache_contains (fn))
+		return TRUE;
 	return g_file_test (fn, G_FILE_TEST_EXISTS);
 }
 
@@ -266,15 +384,31 @@ fu_efivar_get_data (const gchar *guid, const gchar *name, guint8 **data,
 {
 #ifndef _WIN32
 	gssize attr_sz;
-	gssize data_sz_tmp;
+	gsize data_sz_tmp;
 	guint32 attr_tmp;
 	guint64 sz;
 	g_autofree gchar *fn = fu_efivar_get_filename (guid, name);
-	g_autoptr(GFile) file = g_file_new_for_path (fn);
+	g_autofree guint8 *data_tmp = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GFile) file = NULL;
 	g_autoptr(GFileInfo) info = NULL;
 	g_autoptr(GInputStream) istr = NULL;
 
+	/* already read recently */
+	blob = fu_efivar_cache_lookup (fn, &attr_tmp);
+	if (blob != NULL) {
+		if (attr != NULL)
+			*attr = attr_tmp;
+		if (data_sz != NULL)
+			*data_sz = g_bytes_get_size (blob);
+		if (data != NULL)
+			*data = g_memdup (g_bytes_get_data (blob, NULL),
+					  g_bytes_get_size (blob));
+		return TRUE;
+	}
+
 	/* open file as stream */
+	file = g_file_new_for_path (fn);
 	istr = G_INPUT_STREAM (g_file_read (file, NULL, error));
 	if (istr == NULL)
 		return FALSE;
@@ -302,22 +436,25 @@ fu_efivar_get_data (const gchar *guid, const gchar *name, guint8 **data,
 		g_prefix_error (error, "failed to read attr: ");
 		return FALSE;
 	}
-	if (attr != NULL)
-		*attr = attr_tmp;
 
-	/* read out the data */
+	/* read out the data, always so it can be cached */
 	data_sz_tmp = sz - sizeof(attr_tmp);
+	data_tmp = g_malloc0 (data_sz_tmp);
+	if (!g_input_stream_read_all (istr, data_tmp, data_sz_tmp,
+				      NULL, NULL, error)) {
+		g_prefix_error (error, "failed to read data: ");
+		return FALSE;
+	}
+	blob = g_bytes_new (data_tmp, data_sz_tmp);
+	fu_efivar_cache_insert (fn, attr_tmp, blob);
+
+	/* success */
+	if (attr != NULL)
+		*attr = attr_tmp;
 	if (data_sz != NULL)
 		*data_sz = data_sz_tmp;
-	if (data != NULL) {
-		g_autofree guint8 *data_tmp = g_malloc0 (data_sz_tmp);
-		if (!g_input_stream_read_all (istr, data_tmp, data_sz_tmp,
-					      NULL, NULL, error)) {
-			g_prefix_error (error, "failed to read data: ");
-			return FALSE;
-		}
+	if (data != NULL)
 		*data = g_steal_pointer (&data_tmp);
-	}
 	return TRUE;
 #else
 	g_set_error_literal (error,
@@ -355,6 +492,9 @@ fu_efivar_set_data (const gchar *guid, const gchar *name, const guint8 *data,
 	g_autoptr(GFile) file = g_file_new_for_path (fn);
 	g_autoptr(GOutputStream) ostr = NULL;
 
+	/* the contents are about to change */
+	fu_efivar_cache_invalidate (fn);
+
 	/* create empty file so we can clear the immutable bit before writing */
 	if (!g_file_query_exists (file, NULL)) {
 		g_autoptr(GFileOutputStream) ostr_tmp = NULL;
@@ -43,3 +43,5 @@ gboolean	 fu_efivar_delete_with_glob	(const gchar	*guid,
 						 const gchar	*name_glob,
 						 GError		**error);
 gboolean	 fu_efivar_secure_boot_enabled (void);
+void		 fu_efivar_get_cache_stats	(guint		*hits,
+						 guint		*misses);
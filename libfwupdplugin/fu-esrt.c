@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuEsrt"
+
+#include "config.h"
+
+#include "fu-common.h"
+#include "fu-esrt.h"
+
+/**
+ * SECTION:fu-esrt
+ * @short_description: the EFI System Resource Table
+ *
+ * The kernel exports the ESRT into sysfs as one directory per entry with
+ * one file per attribute. The table is created by the firmware at boot and
+ * does not change until the next boot, so it is parsed once and shared by
+ * all the plugins that need it.
+ *
+ * See also: #FuPlugin
+ */
+
+struct _FuEsrtEntry {
+	gchar			*path;
+	gchar			*fw_class;
+	guint32			 fw_type;
+	guint32			 fw_version;
+	guint32			 fw_version_lowest;
+	guint32			 capsule_flags;
+	guint32			 last_attempt_version;
+	guint32			 last_attempt_status;
+};
+
+struct _FuEsrt {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* for loaded, error and entries */
+	gboolean		 loaded;
+	GError			*error;		/* from the first load */
+	GPtrArray		*entries;	/* (element-type FuEsrtEntry) */
+};
+
+G_DEFINE_TYPE (FuEsrt, fu_esrt, G_TYPE_OBJECT)
+
+static void
+fu_esrt_entry_free (FuEsrtEntry *entry)
+{
+	g_free (entry->path);
+	g_free (entry->fw_class);
+	g_free (entry);
+}
+
+static guint32
+fu_esrt_entry_read_uint32 (const gchar *path, const gchar *attr_name)
+{
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *fn = g_build_filename (path, attr_name, NULL);
+	if (!g_file_get_contents (fn, &buf, NULL, NULL))
+		return 0x0;
+	return (guint32) fu_common_strtoull (buf);
+}
+
+static FuEsrtEntry *
+fu_esrt_entry_new_from_path (const gchar *path)
+{
+	FuEsrtEntry *entry = g_new0 (FuEsrtEntry, 1);
+	g_autofree gchar *fw_class_fn = g_build_filename (path, "fw_class", NULL);
+
+	entry->path = g_strdup (path);
+	if (g_file_get_contents (fw_class_fn, &entry->fw_class, NULL, NULL))
+		g_strdelimit (entry->fw_class, "\n", '\0');
+	entry->fw_type = fu_esrt_entry_read_uint32 (path, "fw_type");
+	entry->fw_version = fu_esrt_entry_read_uint32 (path, "fw_version");
+	entry->fw_version_lowest = fu_esrt_entry_read_uint32 (path, "lowest_supported_fw_version");
+	entry->capsule_flags = fu_esrt_entry_read_uint32 (path, "capsule_flags");
+	entry->last_attempt_version = fu_esrt_entry_read_uint32 (path, "last_attempt_version");
+	entry->last_attempt_status = fu_esrt_entry_read_uint32 (path, "last_attempt_status");
+	return entry;
+}
+
+static gint
+fu_esrt_entry_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuEsrtEntry *entry1 = *((FuEsrtEntry **) a);
+	FuEsrtEntry *entry2 = *((FuEsrtEntry **) b);
+	return g_strcmp0 (entry1->path, entry2->path);
+}
+
+static gboolean
+fu_esrt_load_entries (FuEsrt *self, GError **error)
+{
+	const gchar *fn;
+	g_autofree gchar *sysfsfwdir = NULL;
+	g_autofree gchar *path = NULL;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
+	path = g_build_filename (sysfsfwdir, "efi", "esrt", "entries", NULL);
+	dir = g_dir_open (path, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *entry_path = g_build_filename (path, fn, NULL);
+		g_ptr_array_add (self->entries, fu_esrt_entry_new_from_path (entry_path));
+	}
+	g_ptr_array_sort (self->entries, fu_esrt_entry_sort_cb);
+	g_debug ("loaded %u ESRT entries in %.1fms",
+		 self->entries->len, g_timer_elapsed (timer, NULL) * 1000.f);
+	return TRUE;
+}
+
+/**
+ * fu_esrt_load:
+ * @self: A #FuEsrt
+ * @error: A #GError, or %NULL
+ *
+ * Loads the ESRT from sysfs. Only the first call reads the table, and later
+ * calls return the same result.
+ *
+ * Returns: %TRUE if the ESRT exists and was loaded
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_esrt_load (FuEsrt *self, GError **error)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_ESRT (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	if (!self->loaded) {
+		self->loaded = TRUE;
+		if (!fu_esrt_load_entries (self, &self->error))
+			g_ptr_array_set_size (self->entries, 0);
+	}
+	if (self->error != NULL) {
+		if (error != NULL)
+			*error = g_error_copy (self->error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_esrt_get_entries:
+ * @self: A #FuEsrt
+ *
+ * Gets all the ESRT entries, sorted by the sysfs entry name. The table must
+ * have been loaded with fu_esrt_load().
+ *
+ * Returns: (transfer none) (element-type FuEsrtEntry): entries
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_esrt_get_entries (FuEsrt *self)
+{
+	g_return_val_if_fail (FU_IS_ESRT (self), NULL);
+	return self->entries;
+}
+
+/**
+ * fu_esrt_get_entry_by_fw_class:
+ * @self: A #FuEsrt
+ * @fw_class: a GUID, e.g. `ddc0ee61-e7f0-4e7d-acc5-c070a398838e`
+ *
+ * Finds the ESRT entry for a firmware class.
+ *
+ * Returns: (transfer none): an entry, or %NULL if not found
+ *
+ * Since: 1.5.0
+ **/
+FuEsrtEntry *
+fu_esrt_get_entry_by_fw_class (FuEsrt *self, const gchar *fw_class)
+{
+	g_return_val_if_fail (FU_IS_ESRT (self), NULL);
+	g_return_val_if_fail (fw_class != NULL, NULL);
+	for (guint i = 0; i < self->entries->len; i++) {
+		FuEsrtEntry *entry = g_ptr_array_index (self->entries, i);
+		if (g_strcmp0 (entry->fw_class, fw_class) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+/**
+ * fu_esrt_entry_get_path:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the sysfs directory the entry was loaded from.
+ *
+ * Returns: a path
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_esrt_entry_get_path (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, NULL);
+	return entry->path;
+}
+
+/**
+ * fu_esrt_entry_get_fw_class:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the firmware class GUID.
+ *
+ * Returns: a GUID string, or %NULL if unset
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_esrt_entry_get_fw_class (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, NULL);
+	return entry->fw_class;
+}
+
+/**
+ * fu_esrt_entry_get_fw_type:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the firmware type, e.g. 1 for system firmware.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_esrt_entry_get_fw_type (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, 0);
+	return entry->fw_type;
+}
+
+/**
+ * fu_esrt_entry_get_fw_version:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the current firmware version.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_esrt_entry_get_fw_version (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, 0);
+	return entry->fw_version;
+}
+
+/**
+ * fu_esrt_entry_get_fw_version_lowest:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the lowest firmware version that can be installed.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_esrt_entry_get_fw_version_lowest (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, 0);
+	return entry->fw_version_lowest;
+}
+
+/**
+ * fu_esrt_entry_get_capsule_flags:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the capsule flags.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_esrt_entry_get_capsule_flags (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, 0);
+	return entry->capsule_flags;
+}
+
+/**
+ * fu_esrt_entry_get_last_attempt_version:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the version of the last attempted update.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_esrt_entry_get_last_attempt_version (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, 0);
+	return entry->last_attempt_version;
+}
+
+/**
+ * fu_esrt_entry_get_last_attempt_status:
+ * @entry: A #FuEsrtEntry
+ *
+ * Gets the status of the last attempted update.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_esrt_entry_get_last_attempt_status (FuEsrtEntry *entry)
+{
+	g_return_val_if_fail (entry != NULL, 0);
+	return entry->last_attempt_status;
+}
+
+static void
+fu_esrt_init (FuEsrt *self)
+{
+	g_mutex_init (&self->mutex);
+	self->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_esrt_entry_free);
+}
+
+static void
+fu_esrt_finalize (GObject *obj)
+{
+	FuEsrt *self = FU_ESRT (obj);
+	if (self->error != NULL)
+		g_error_free (self->error);
+	g_ptr_array_unref (self->entries);
+	g_mutex_clear (&self->mutex);
+	G_OBJECT_CLASS (fu_esrt_parent_class)->finalize (obj);
+}
+
+static void
+fu_esrt_class_init (FuEsrtClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_esrt_finalize;
+}
+
+/**
+ * fu_esrt_new:
+ *
+ * Creates a new ESRT object, which is not loaded until fu_esrt_load().
+ *
+ * Returns: a #FuEsrt
+ *
+ * Since: 1.5.0
+ **/
+FuEsrt *
+fu_esrt_new (void)
+{
+	return FU_ESRT (g_object_new (FU_TYPE_ESRT, NULL));
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_ESRT (fu_esrt_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuEsrt, fu_esrt, FU, ESRT, GObject)
+
+typedef struct _FuEsrtEntry FuEsrtEntry;
+
+FuEsrt		*fu_esrt_new				(void);
+gboolean	 fu_esrt_load				(FuEsrt		*self,
+							 GError		**error);
+GPtrArray	*fu_esrt_get_entries			(FuEsrt		*self);
+FuEsrtEntry	*fu_esrt_get_entry_by_fw_class		(FuEsrt		*self,
+							 const gchar	*fw_class);
+
+const gchar	*fu_esrt_entry_get_path			(FuEsrtEntry	*entry);
+const gchar	*fu_esrt_entry_get_fw_class		(FuEsrtEntry	*entry);
+guint32		 fu_esrt_entry_get_fw_type		(FuEsrtEntry	*entry);
+guint32		 fu_esrt_entry_get_fw_version		(FuEsrtEntry	*entry);
+guint32		 fu_esrt_entry_get_fw_version_lowest	(FuEsrtEntry	*entry);
+guint32		 fu_esrt_entry_get_capsule_flags	(FuEsrtEntry	*entry);
+guint32		 fu_esrt_entry_get_last_attempt_version	(FuEsrtEntry	*entry);
+guint32		 fu_esrt_entry_get_last_attempt_status	(FuEsrtEntry	*entry);
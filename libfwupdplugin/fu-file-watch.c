@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuFileWatch"
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "fu-file-watch.h"
+#include "fu-metrics.h"
+
+/**
+ * SECTION:fu-file-watch
+ * @short_description: a shared service for watching files
+ *
+ * Several plugins and the daemon itself watch files such as the daemon
+ * config, the remotes and the kernel state in procfs and sysfs. This object
+ * shares one #GFileMonitor between all the subscribers of each path, and
+ * GLib multiplexes all of those onto a single inotify instance.
+ *
+ * Change events are debounced so that subscribers are called once for a
+ * burst of writes, and file contents are cached until the file changes so
+ * that subscribers do not re-read the same file. Files on pseudo filesystems
+ * do not reliably emit inotify events, and so their contents are only cached
+ * for a short time.
+ */
+
+#define FU_FILE_WATCH_DEBOUNCE_DEFAULT		100	/* ms */
+#define FU_FILE_WATCH_PSEUDO_FS_MAX_AGE		1	/* s */
+
+struct _FuFileWatch {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* for entries and contents */
+	GHashTable		*entries;	/* path : FuFileWatchEntry */
+	GHashTable		*contents;	/* filename : FuFileWatchContents */
+	guint			 debounce;	/* ms */
+	guint			 id_next;
+};
+
+typedef struct {
+	guint			 id;
+	FuFileWatchFunc		 func;
+	gpointer		 user_data;
+} FuFileWatchSubscriber;
+
+typedef struct {
+	FuFileWatch		*self;		/* no-ref */
+	gint			 refcount;
+	gboolean		 removed;
+	gboolean		 pseudo_fs;
+	gchar			*path;
+	GFileMonitor		*monitor;
+	GPtrArray		*subscribers;	/* (element-type FuFileWatchSubscriber) */
+	GHashTable		*changed;	/* filename */
+	guint			 debounce_id;
+} FuFileWatchEntry;
+
+typedef struct {
+	GBytes			*blob;
+	gint64			 created;	/* monotonic, us */
+	gboolean		 pseudo_fs;
+} FuFileWatchContents;
+
+G_DEFINE_TYPE (FuFileWatch, fu_file_watch, G_TYPE_OBJECT)
+
+static void
+fu_file_watch_contents_free (FuFileWatchContents *contents)
+{
+	g_bytes_unref (contents->blob);
+	g_free (contents);
+}
+
+static FuFileWatchEntry *
+fu_file_watch_entry_ref (FuFileWatchEntry *entry)
+{
+	entry->refcount++;
+	return entry;
+}
+
+static void
+fu_file_watch_entry_unref (FuFileWatchEntry *entry)
+{
+	if (--entry->refcount > 0)
+		return;
+	if (entry->debounce_id != 0)
+		g_source_remove (entry->debounce_id);
+	g_file_monitor_cancel (entry->monitor);
+	g_object_unref (entry->monitor);
+	g_ptr_array_unref (entry->subscribers);
+	g_hash_table_unref (entry->changed);
+	g_free (entry->path);
+	g_free (entry);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuFileWatchEntry, fu_file_watch_entry_unref)
+
+/* called when removed from the hash table, perhaps while dispatching */
+static void
+fu_file_watch_entry_remove (FuFileWatchEntry *entry)
+{
+	entry->removed = TRUE;
+	g_signal_handlers_disconnect_by_data (entry->monitor, entry);
+	fu_file_watch_entry_unref (entry);
+}
+
+static gboolean
+fu_file_watch_is_pseudo_fs (GFile *file)
+{
+	const gchar *fs_type;
+	const gchar *pseudo_fs[] = { "proc", "sysfs", "securityfs", "debugfs", NULL };
+	g_autoptr(GFileInfo) info = NULL;
+
+	info = g_file_query_filesystem_info (file, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE,
+					     NULL, NULL);
+	if (info == NULL)
+		return FALSE;
+	fs_type = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE);
+	return fs_type != NULL && g_strv_contains (pseudo_fs, fs_type);
+}
+
+static FuFileWatchSubscriber *
+fu_file_watch_entry_get_subscriber (FuFileWatchEntry *entry, guint id)
+{
+	for (guint i = 0; i < entry->subscribers->len; i++) {
+		FuFileWatchSubscriber *sub = g_ptr_array_index (entry->subscribers, i);
+		if (sub->id == id)
+			return sub;
+	}
+	return NULL;
+}
+
+static gboolean
+fu_file_watch_debounce_cb (gpointer user_data)
+{
+	FuFileWatchEntry *entry = (FuFileWatchEntry *) user_data;
+	FuFileWatch *self = entry->self;
+	GHashTableIter iter;
+	gpointer key;
+	g_autoptr(FuFileWatchEntry) entry_ref = fu_file_watch_entry_ref (entry);
+	g_autoptr(GArray) ids = g_array_new (FALSE, FALSE, sizeof(guint));
+	g_autoptr(GHashTable) changed = NULL;
+
+	/* subscribers may add or remove watches, including this one */
+	entry->debounce_id = 0;
+	changed = g_steal_pointer (&entry->changed);
+	entry->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (guint i = 0; i < entry->subscribers->len; i++) {
+		FuFileWatchSubscriber *sub = g_ptr_array_index (entry->subscribers, i);
+		g_array_append_val (ids, sub->id);
+	}
+	g_hash_table_iter_init (&iter, changed);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *filename = (const gchar *) key;
+		for (guint i = 0; i < ids->len; i++) {
+			FuFileWatchSubscriber *sub;
+			if (entry->removed)
+				return G_SOURCE_REMOVE;
+			sub = fu_file_watch_entry_get_subscriber (entry, g_array_index (ids, guint, i));
+			if (sub == NULL)
+				continue;
+			sub->func (self, filename, sub->user_data);
+		}
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_file_watch_invalidate (FuFileWatch *self, GFile *file)
+{
+	g_autofree gchar *filename = g_file_get_path (file);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->mutex);
+	g_hash_table_remove (self->contents, filename);
+}
+
+static void
+fu_file_watch_monitor_changed_cb (GFileMonitor *monitor,
+				  GFile *file,
+				  GFile *other_file,
+				  GFileMonitorEvent event_type,
+				  gpointer user_data)
+{
+	FuFileWatchEntry *entry = (FuFileWatchEntry *) user_data;
+	FuFileWatch *self = entry->self;
+
+	fu_file_watch_invalidate (self, file);
+	if (other_file != NULL)
+		fu_file_watch_invalidate (self, other_file);
+	g_hash_table_add (entry->changed, g_file_get_path (file));
+
+	/* coalesce everything that happens within the window */
+	if (entry->debounce_id == 0) {
+		entry->debounce_id = g_timeout_add (self->debounce,
+						    fu_file_watch_debounce_cb,
+						    entry);
+	}
+}
+
+/**
+ * fu_file_watch_set_debounce:
+ * @self: A #FuFileWatch
+ * @debounce: time in ms
+ *
+ * Sets how long to wait after the first change before calling the
+ * subscribers of a path.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_file_watch_set_debounce (FuFileWatch *self, guint debounce)
+{
+	g_return_if_fail (FU_IS_FILE_WATCH (self));
+	self->debounce = debounce;
+}
+
+/**
+ * fu_file_watch_add:
+ * @self: A #FuFileWatch
+ * @path: a file or directory
+ * @func: (scope notified): the function to call when @path changes
+ * @user_data: (nullable): user data for @func
+ * @error: A #GError, or %NULL
+ *
+ * Subscribes to changes of a file, or of any file inside a directory. All
+ * subscribers of the same path share one monitor.
+ *
+ * Returns: an ID for fu_file_watch_remove(), or 0 on error
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_file_watch_add (FuFileWatch *self,
+		   const gchar *path,
+		   FuFileWatchFunc func,
+		   gpointer user_data,
+		   GError **error)
+{
+	FuFileWatchEntry *entry;
+	FuFileWatchSubscriber *sub;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_FILE_WATCH (self), 0);
+	g_return_val_if_fail (path != NULL, 0);
+	g_return_val_if_fail (func != NULL, 0);
+	g_return_val_if_fail (error == NULL || *error == NULL, 0);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	entry = g_hash_table_lookup (self->entries, path);
+	if (entry == NULL) {
+		g_autoptr(GFile) file = g_file_new_for_path (path);
+		g_autoptr(GFileMonitor) monitor = NULL;
+
+		monitor = g_file_monitor (file, G_FILE_MONITOR_NONE, NULL, error);
+		if (monitor == NULL)
+			return 0;
+		entry = g_new0 (FuFileWatchEntry, 1);
+		entry->self = self;
+		entry->refcount = 1;
+		entry->path = g_strdup (path);
+		entry->pseudo_fs = fu_file_watch_is_pseudo_fs (file);
+		entry->monitor = g_steal_pointer (&monitor);
+		entry->subscribers = g_ptr_array_new_with_free_func (g_free);
+		entry->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_signal_connect (entry->monitor, "changed",
+				  G_CALLBACK (fu_file_watch_monitor_changed_cb), entry);
+		g_hash_table_insert (self->entries, entry->path, entry);
+	}
+
+	sub = g_new0 (FuFileWatchSubscriber, 1);
+	sub->id = ++self->id_next;
+	sub->func = func;
+	sub->user_data = user_data;
+	g_ptr_array_add (entry->subscribers, sub);
+	return sub->id;
+}
+
+/**
+ * fu_file_watch_remove:
+ * @self: A #FuFileWatch
+ * @id: an ID from fu_file_watch_add()
+ *
+ * Unsubscribes from changes. The monitor is destroyed when the last
+ * subscriber of the path is removed.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_file_watch_remove (FuFileWatch *self, guint id)
+{
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_FILE_WATCH (self));
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_hash_table_iter_init (&iter, self->entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FuFileWatchEntry *entry = (FuFileWatchEntry *) value;
+		FuFileWatchSubscriber *sub = fu_file_watch_entry_get_subscriber (entry, id);
+		if (sub == NULL)
+			continue;
+		g_ptr_array_remove (entry->subscribers, sub);
+		if (entry->subscribers->len == 0)
+			g_hash_table_iter_remove (&iter);
+		return;
+	}
+}
+
+/* the entry watching @filename, either directly or as the parent directory */
+static FuFileWatchEntry *
+fu_file_watch_get_entry_for_filename (FuFileWatch *self, const gchar *filename)
+{
+	FuFileWatchEntry *entry = g_hash_table_lookup (self->entries, filename);
+	if (entry == NULL) {
+		g_autofree gchar *dirname = g_path_get_dirname (filename);
+		entry = g_hash_table_lookup (self->entries, dirname);
+	}
+	return entry;
+}
+
+/**
+ * fu_file_watch_get_contents:
+ * @self: A #FuFileWatch
+ * @filename: a file
+ * @error: A #GError, or %NULL
+ *
+ * Gets the contents of a file. If the file or its directory is being watched
+ * then the contents are cached until the file changes.
+ *
+ * Returns: (transfer full): the file contents, or %NULL on error
+ *
+ * Since: 1.5.0
+ **/
+GBytes *
+fu_file_watch_get_contents (FuFileWatch *self, const gchar *filename, GError **error)
+{
+	FuFileWatchContents *contents;
+	FuFileWatchEntry *entry;
+	gchar *buf = NULL;
+	gsize bufsz = 0;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_FILE_WATCH (self), NULL);
+	g_return_val_if_fail (filename != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* not watched, so we would never know when to invalidate */
+	locker = g_mutex_locker_new (&self->mutex);
+	entry = fu_file_watch_get_entry_for_filename (self, filename);
+	if (entry == NULL) {
+		if (!g_file_get_contents (filename, &buf, &bufsz, error))
+			return NULL;
+		return g_bytes_new_take (buf, bufsz);
+	}
+
+	/* still valid */
+	contents = g_hash_table_lookup (self->contents, filename);
+	if (contents != NULL && contents->pseudo_fs &&
+	    g_get_monotonic_time () - contents->created >
+	    FU_FILE_WATCH_PSEUDO_FS_MAX_AGE * G_USEC_PER_SEC) {
+		g_hash_table_remove (self->contents, filename);
+		contents = NULL;
+	}
+	fu_metrics_cache_lookup ("file-watch", contents != NULL);
+	if (contents != NULL)
+		return g_bytes_ref (contents->blob);
+
+	/* read and save for next time */
+	if (!g_file_get_contents (filename, &buf, &bufsz, error))
+		return NULL;
+	contents = g_new0 (FuFileWatchContents, 1);
+	contents->blob = g_bytes_new_take (buf, bufsz);
+	contents->created = g_get_monotonic_time ();
+	contents->pseudo_fs = entry->pseudo_fs;
+	g_hash_table_insert (self->contents, g_strdup (filename), contents);
+	return g_bytes_ref (contents->blob);
+}
+
+static void
+fu_file_watch_init (FuFileWatch *self)
+{
+	g_mutex_init (&self->mutex);
+	self->debounce = FU_FILE_WATCH_DEBOUNCE_DEFAULT;
+	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+					       (GDestroyNotify) fu_file_watch_entry_remove);
+	self->contents = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						(GDestroyNotify) fu_file_watch_contents_free);
+}
+
+static void
+fu_file_watch_finalize (GObject *obj)
+{
+	FuFileWatch *self = FU_FILE_WATCH (obj);
+	g_hash_table_unref (self->entries);
+	g_hash_table_unref (self->contents);
+	g_mutex_clear (&self->mutex);
+	G_OBJECT_CLASS (fu_file_watch_parent_class)->finalize (obj);
+}
+
+static void
+fu_file_watch_class_init (FuFileWatchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_file_watch_finalize;
+}
+
+/**
+ * fu_file_watch_new:
+ *
+ * Creates a new file watch service.
+ *
+ * Returns: a #FuFileWatch
+ *
+ * Since: 1.5.0
+ **/
+FuFileWatch *
+fu_file_watch_new (void)
+{
+	return FU_FILE_WATCH (g_object_new (FU_TYPE_FILE_WATCH, NULL));
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_FILE_WATCH (fu_file_watch_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuFileWatch, fu_file_watch, FU, FILE_WATCH, GObject)
+
+/**
+ * FuFileWatchFunc:
+ * @self: A #FuFileWatch
+ * @filename: the file that changed, which may be inside a watched directory
+ * @user_data: user data
+ *
+ * Called once for each file that changed during the debounce interval.
+ **/
+typedef void	(*FuFileWatchFunc)			(FuFileWatch	*self,
+							 const gchar	*filename,
+							 gpointer	 user_data);
+
+FuFileWatch	*fu_file_watch_new			(void);
+void		 fu_file_watch_set_debounce		(FuFileWatch	*self,
+							 guint		 debounce);
+guint		 fu_file_watch_add			(FuFileWatch	*self,
+							 const gchar	*path,
+							 FuFileWatchFunc func,
+							 gpointer	 user_data,
+							 GError		**error);
+void		 fu_file_watch_remove			(FuFileWatch	*self,
+							 guint		 id);
+GBytes		*fu_file_watch_get_contents		(FuFileWatch	*self,
+							 const gchar	*filename,
+							 GError		**error);
@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuFirmwareBuilder"
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "fwupd-error.h"
+
+#include "fu-common.h"
+#include "fu-firmware-builder.h"
+#include "fu-metrics.h"
+
+/**
+ * SECTION:fu-firmware-builder
+ * @short_description: build firmware using a bubblewrap helper script
+ *
+ * Some firmware is generated on the host by running a script from the
+ * archive in a bubblewrap jail. Building is expensive, and when several
+ * identical devices are updated the same archive is built several times.
+ *
+ * This object remembers the results of previous builds, keyed by the
+ * archive checksum, the script, the output filename and the sandbox
+ * arguments. It can also keep the extracted archive around so that
+ * back-to-back builds of the same archive within one transaction do not
+ * extract it again.
+ */
+
+#define FU_FIRMWARE_BUILDER_MAX_RESULTS		8
+
+struct _FuFirmwareBuilder {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* for results and sandboxes */
+	gboolean		 keep_sandbox;
+	gchar			*bwrap_fn;	/* (nullable) */
+	GPtrArray		*results;	/* (element-type FuFirmwareBuilderResult) */
+	GHashTable		*sandboxes;	/* archive checksum : tmpdir */
+};
+
+typedef struct {
+	gchar			*key;
+	GBytes			*blob;
+} FuFirmwareBuilderResult;
+
+G_DEFINE_TYPE (FuFirmwareBuilder, fu_firmware_builder, G_TYPE_OBJECT)
+
+static void
+fu_firmware_builder_result_free (FuFirmwareBuilderResult *result)
+{
+	g_free (result->key);
+	g_bytes_unref (result->blob);
+	g_free (result);
+}
+
+static void
+fu_firmware_builder_add_argv (GPtrArray *argv, const gchar *fmt, ...) G_GNUC_PRINTF (2, 3);
+
+static void
+fu_firmware_builder_add_argv (GPtrArray *argv, const gchar *fmt, ...)
+{
+	va_list args;
+	g_autofree gchar *tmp = NULL;
+	g_auto(GStrv) split = NULL;
+
+	va_start (args, fmt);
+	tmp = g_strdup_vprintf (fmt, args);
+	va_end (args);
+
+	split = g_strsplit (tmp, " ", -1);
+	for (guint i = 0; split[i] != NULL; i++)
+		g_ptr_array_add (argv, g_strdup (split[i]));
+}
+
+static gboolean
+fu_firmware_builder_test_namespace_support (GError **error)
+{
+	/* test if CONFIG_USER_NS is valid */
+	if (!g_file_test ("/proc/self/ns/user", G_FILE_TEST_IS_SYMLINK)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "missing CONFIG_USER_NS in kernel");
+		return FALSE;
+	}
+	if (g_file_test ("/proc/sys/kernel/unprivileged_userns_clone", G_FILE_TEST_EXISTS)) {
+		g_autofree gchar *clone = NULL;
+		if (!g_file_get_contents ("/proc/sys/kernel/unprivileged_userns_clone", &clone, NULL, error))
+			return FALSE;
+		if (g_ascii_strtoll (clone, NULL, 10) == 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "unprivileged user namespace clones disabled by distro");
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gchar *
+fu_firmware_builder_get_localstatebuilderdir (void)
+{
+	/* this is shared with the plugins */
+	g_autofree gchar *localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	return g_build_filename (localstatedir, "builder", NULL);
+}
+
+static GPtrArray *
+fu_firmware_builder_get_argv (FuFirmwareBuilder *self,
+			      const gchar *tmpdir,
+			      const gchar *script_fn)
+{
+	g_autofree gchar *localstatebuilderdir = fu_firmware_builder_get_localstatebuilderdir ();
+	GPtrArray *argv = g_ptr_array_new_with_free_func (g_free);
+
+	g_ptr_array_add (argv, g_strdup (self->bwrap_fn));
+	fu_firmware_builder_add_argv (argv, "--die-with-parent");
+	fu_firmware_builder_add_argv (argv, "--ro-bind /usr /usr");
+	fu_firmware_builder_add_argv (argv, "--ro-bind /lib /lib");
+	fu_firmware_builder_add_argv (argv, "--ro-bind /lib64 /lib64");
+	fu_firmware_builder_add_argv (argv, "--ro-bind /bin /bin");
+	fu_firmware_builder_add_argv (argv, "--ro-bind /sbin /sbin");
+	fu_firmware_builder_add_argv (argv, "--dir /tmp");
+	fu_firmware_builder_add_argv (argv, "--dir /var");
+	fu_firmware_builder_add_argv (argv, "--bind %s /tmp", tmpdir);
+	if (g_file_test (localstatebuilderdir, G_FILE_TEST_EXISTS))
+		fu_firmware_builder_add_argv (argv, "--ro-bind %s /boot", localstatebuilderdir);
+	fu_firmware_builder_add_argv (argv, "--dev /dev");
+	fu_firmware_builder_add_argv (argv, "--chdir /tmp");
+	fu_firmware_builder_add_argv (argv, "--unshare-all");
+	fu_firmware_builder_add_argv (argv, "/tmp/%s", script_fn);
+	g_ptr_array_add (argv, NULL);
+	return argv;
+}
+
+static gint
+fu_firmware_builder_strcmp_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* the scripts can read the files the plugins share in /boot, so any change
+ * there has to invalidate the previous results */
+static void
+fu_firmware_builder_checksum_localstatebuilderdir (GChecksum *csum)
+{
+	g_autofree gchar *localstatebuilderdir = fu_firmware_builder_get_localstatebuilderdir ();
+	g_autoptr(GPtrArray) files = NULL;
+
+	if (!g_file_test (localstatebuilderdir, G_FILE_TEST_IS_DIR))
+		return;
+	files = fu_common_get_files_recursive (localstatebuilderdir, NULL);
+	if (files == NULL)
+		return;
+	g_ptr_array_sort (files, fu_firmware_builder_strcmp_cb);
+	for (guint i = 0; i < files->len; i++) {
+		const gchar *fn = g_ptr_array_index (files, i);
+		GStatBuf st = { 0x0 };
+		g_autofree gchar *str = NULL;
+		if (g_stat (fn, &st) != 0)
+			continue;
+		str = g_strdup_printf ("%s:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ";",
+				       fn, (gint64) st.st_size, (gint64) st.st_mtime);
+		g_checksum_update (csum, (const guchar *) str, -1);
+	}
+}
+
+static gchar *
+fu_firmware_builder_get_key (FuFirmwareBuilder *self,
+			     const gchar *archive_csum,
+			     const gchar *script_fn,
+			     const gchar *output_fn)
+{
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_autoptr(GPtrArray) argv = NULL;
+
+	/* the temporary directory is different each time */
+	argv = fu_firmware_builder_get_argv (self, "@TMPDIR@", script_fn);
+	for (guint i = 0; i < argv->len - 1; i++) {
+		const gchar *arg = g_ptr_array_index (argv, i);
+		g_checksum_update (csum, (const guchar *) arg, strlen (arg) + 1);
+	}
+	g_checksum_update (csum, (const guchar *) archive_csum, -1);
+	g_checksum_update (csum, (const guchar *) output_fn, strlen (output_fn) + 1);
+	fu_firmware_builder_checksum_localstatebuilderdir (csum);
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static GBytes *
+fu_firmware_builder_lookup (FuFirmwareBuilder *self, const gchar *key)
+{
+	for (guint i = 0; i < self->results->len; i++) {
+		FuFirmwareBuilderResult *result = g_ptr_array_index (self->results, i);
+		if (g_strcmp0 (result->key, key) == 0)
+			return g_bytes_ref (result->blob);
+	}
+	return NULL;
+}
+
+static void
+fu_firmware_builder_add_result (FuFirmwareBuilder *self, const gchar *key, GBytes *blob)
+{
+	FuFirmwareBuilderResult *result = g_new0 (FuFirmwareBuilderResult, 1);
+
+	/* drop the oldest result */
+	if (self->results->len >= FU_FIRMWARE_BUILDER_MAX_RESULTS)
+		g_ptr_array_remove_index (self->results, 0);
+	result->key = g_strdup (key);
+	result->blob = g_bytes_ref (blob);
+	g_ptr_array_add (self->results, result);
+}
+
+static gchar *
+fu_firmware_builder_ensure_sandbox (FuFirmwareBuilder *self,
+				    GBytes *bytes,
+				    const gchar *archive_csum,
+				    GError **error)
+{
+	const gchar *tmpdir_old;
+	g_autofree gchar *tmpdir = NULL;
+
+	/* already extracted in this transaction */
+	tmpdir_old = g_hash_table_lookup (self->sandboxes, archive_csum);
+	if (tmpdir_old != NULL) {
+		if (g_file_test (tmpdir_old, G_FILE_TEST_IS_DIR)) {
+			fu_metrics_cache_lookup ("builder-sandbox", TRUE);
+			return g_strdup (tmpdir_old);
+		}
+		g_hash_table_remove (self->sandboxes, archive_csum);
+	}
+	fu_metrics_cache_lookup ("builder-sandbox", FALSE);
+
+	/* untar file to temp location */
+	tmpdir = g_dir_make_tmp ("fwupd-gen-XXXXXX", error);
+	if (tmpdir == NULL)
+		return NULL;
+	if (!fu_common_extract_archive (bytes, tmpdir, error)) {
+		fu_common_rmtree (tmpdir, NULL);
+		return NULL;
+	}
+	if (self->keep_sandbox) {
+		g_hash_table_insert (self->sandboxes,
+				     g_strdup (archive_csum),
+				     g_strdup (tmpdir));
+	}
+	return g_steal_pointer (&tmpdir);
+}
+
+static GBytes *
+fu_firmware_builder_run (FuFirmwareBuilder *self,
+			 const gchar *tmpdir,
+			 const gchar *script_fn,
+			 const gchar *output_fn,
+			 GError **error)
+{
+	gint rc = 0;
+	g_autofree gchar *argv_str = NULL;
+	g_autofree gchar *output2_fn = NULL;
+	g_autofree gchar *standard_error = NULL;
+	g_autofree gchar *standard_output = NULL;
+	g_autoptr(GPtrArray) argv = NULL;
+
+	/* do not pick up the output of a previous build in a warm sandbox */
+	output2_fn = g_build_filename (tmpdir, output_fn, NULL);
+	if (g_file_test (output2_fn, G_FILE_TEST_EXISTS) && g_unlink (output2_fn) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "Failed to delete: %s", output2_fn);
+		return NULL;
+	}
+
+	/* launch bubblewrap and generate firmware */
+	argv = fu_firmware_builder_get_argv (self, tmpdir, script_fn);
+	argv_str = g_strjoinv (" ", (gchar **) argv->pdata);
+	g_debug ("running '%s' in %s", argv_str, tmpdir);
+	if (!g_spawn_sync ("/tmp",
+			   (gchar **) argv->pdata,
+			   NULL,
+			   G_SPAWN_SEARCH_PATH,
+			   NULL, NULL, /* child_setup */
+			   &standard_output,
+			   &standard_error,
+			   &rc,
+			   error)) {
+		g_prefix_error (error, "failed to run '%s': ", argv_str);
+		return NULL;
+	}
+	if (standard_output != NULL && standard_output[0] != '\0')
+		g_debug ("console output was: %s", standard_output);
+	if (rc != 0) {
+		FwupdError code = FWUPD_ERROR_INTERNAL;
+		if (errno == ENOTTY)
+			code = FWUPD_ERROR_PERMISSION_DENIED;
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     code,
+			     "failed to build firmware: %s",
+			     standard_error);
+		return NULL;
+	}
+
+	/* get generated file */
+	return fu_common_get_contents_bytes (output2_fn, error);
+}
+
+/**
+ * fu_firmware_builder_set_keep_sandbox:
+ * @self: A #FuFirmwareBuilder
+ * @keep_sandbox: %TRUE to keep the extracted archives
+ *
+ * Keeps the extracted archive after each build so that another build of the
+ * same archive can reuse it. The sandboxes are deleted by
+ * fu_firmware_builder_cleanup(), typically at the end of the transaction.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_firmware_builder_set_keep_sandbox (FuFirmwareBuilder *self, gboolean keep_sandbox)
+{
+	g_return_if_fail (FU_IS_FIRMWARE_BUILDER (self));
+	self->keep_sandbox = keep_sandbox;
+}
+
+/**
+ * fu_firmware_builder_build:
+ * @self: A #FuFirmwareBuilder
+ * @bytes: The data to use
+ * @script_fn: Name of the script to run in the tarball, e.g. `startup.sh`
+ * @output_fn: Name of the generated firmware, e.g. `firmware.bin`
+ * @error: A #GError, or %NULL
+ *
+ * Builds a firmware file using tools from the host session in a bubblewrap
+ * jail, returning the previous result if the same archive was already built
+ * using the same script and arguments.
+ *
+ * Returns: a new #GBytes, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GBytes *
+fu_firmware_builder_build (FuFirmwareBuilder *self,
+			   GBytes *bytes,
+			   const gchar *script_fn,
+			   const gchar *output_fn,
+			   GError **error)
+{
+	g_autofree gchar *archive_csum = NULL;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(GBytes) firmware_blob = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_FIRMWARE_BUILDER (self), NULL);
+	g_return_val_if_fail (bytes != NULL, NULL);
+	g_return_val_if_fail (script_fn != NULL, NULL);
+	g_return_val_if_fail (output_fn != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+
+	/* find bwrap in the path */
+	if (self->bwrap_fn == NULL) {
+		self->bwrap_fn = fu_common_find_program_in_path ("bwrap", error);
+		if (self->bwrap_fn == NULL)
+			return NULL;
+	}
+
+	/* test if CONFIG_USER_NS is valid */
+	if (!fu_firmware_builder_test_namespace_support (error))
+		return NULL;
+
+	/* built before */
+	archive_csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+	key = fu_firmware_builder_get_key (self, archive_csum, script_fn, output_fn);
+	firmware_blob = fu_firmware_builder_lookup (self, key);
+	fu_metrics_cache_lookup ("builder", firmware_blob != NULL);
+	if (firmware_blob != NULL) {
+		g_debug ("using previous result of %s for %s", script_fn, archive_csum);
+		return g_steal_pointer (&firmware_blob);
+	}
+
+	/* build in a new or warm sandbox */
+	tmpdir = fu_firmware_builder_ensure_sandbox (self, bytes, archive_csum, error);
+	if (tmpdir == NULL)
+		return NULL;
+	firmware_blob = fu_firmware_builder_run (self, tmpdir, script_fn, output_fn, error);
+
+	/* cleanup temp directory */
+	if (!self->keep_sandbox) {
+		if (!fu_common_rmtree (tmpdir, firmware_blob != NULL ? error : NULL))
+			return NULL;
+	}
+	if (firmware_blob == NULL)
+		return NULL;
+
+	/* success */
+	fu_firmware_builder_add_result (self, key, firmware_blob);
+	return g_steal_pointer (&firmware_blob);
+}
+
+/**
+ * fu_firmware_builder_cleanup:
+ * @self: A #FuFirmwareBuilder
+ * @error: A #GError, or %NULL
+ *
+ * Deletes any sandboxes kept since fu_firmware_builder_set_keep_sandbox()
+ * was used. The results of the previous builds are not forgotten.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_firmware_builder_cleanup (FuFirmwareBuilder *self, GError **error)
+{
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_FIRMWARE_BUILDER (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_hash_table_iter_init (&iter, self->sandboxes);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		const gchar *tmpdir = (const gchar *) value;
+		if (g_file_test (tmpdir, G_FILE_TEST_IS_DIR) &&
+		    !fu_common_rmtree (tmpdir, error))
+			return FALSE;
+		g_hash_table_iter_remove (&iter);
+	}
+	return TRUE;
+}
+
+static void
+fu_firmware_builder_finalize (GObject *obj)
+{
+	FuFirmwareBuilder *self = FU_FIRMWARE_BUILDER (obj);
+	g_autoptr(GError) error_local = NULL;
+
+	if (!fu_firmware_builder_cleanup (self, &error_local))
+		g_warning ("failed to delete sandbox: %s", error_local->message);
+	g_hash_table_unref (self->sandboxes);
+	g_ptr_array_unref (self->results);
+	g_free (self->bwrap_fn);
+	g_mutex_clear (&self->mutex);
+	G_OBJECT_CLASS (fu_firmware_builder_parent_class)->finalize (obj);
+}
+
+static void
+fu_firmware_builder_class_init (FuFirmwareBuilderClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_firmware_builder_finalize;
+}
+
+static void
+fu_firmware_builder_init (FuFirmwareBuilder *self)
+{
+	g_mutex_init (&self->mutex);
+	self->results = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_firmware_builder_result_free);
+	self->sandboxes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+/**
+ * fu_firmware_builder_new:
+ *
+ * Creates a new #FuFirmwareBuilder.
+ *
+ * Returns: (transfer full): a #FuFirmwareBuilder
+ *
+ * Since: 1.5.0
+ **/
+FuFirmwareBuilder *
+fu_firmware_builder_new (void)
+{
+	return g_object_new (FU_TYPE_FIRMWARE_BUILDER, NULL);
+}
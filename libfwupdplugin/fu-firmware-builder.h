@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_FIRMWARE_BUILDER (fu_firmware_builder_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuFirmwareBuilder, fu_firmware_builder, FU, FIRMWARE_BUILDER, GObject)
+
+FuFirmwareBuilder *fu_firmware_builder_new		(void);
+void		 fu_firmware_builder_set_keep_sandbox	(FuFirmwareBuilder	*self,
+							 gboolean		 keep_sandbox);
+GBytes		*fu_firmware_builder_build		(FuFirmwareBuilder	*self,
+							 GBytes			*bytes,
+							 const gchar		*script_fn,
+							 const gchar		*output_fn,
+							 GError			**error);
+gboolean	 fu_firmware_builder_cleanup		(FuFirmwareBuilder	*self,
+							 GError			**error);
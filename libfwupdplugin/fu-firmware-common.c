@@ -8,10 +8,31 @@
 
 #include <config.h>
 
-#include <string.h>
-
 #include "fu-firmware-common.h"
 
+/* zero for anything that is not a base 16 digit, so check for '0' too */
+static const guint8 fu_firmware_hex_table[256] = {
+	['0'] = 0x0, ['1'] = 0x1, ['2'] = 0x2, ['3'] = 0x3, ['4'] = 0x4,
+	['5'] = 0x5, ['6'] = 0x6, ['7'] = 0x7, ['8'] = 0x8, ['9'] = 0x9,
+	['A'] = 0xa, ['B'] = 0xb, ['C'] = 0xc, ['D'] = 0xd, ['E'] = 0xe, ['F'] = 0xf,
+	['a'] = 0xa, ['b'] = 0xb, ['c'] = 0xc, ['d'] = 0xd, ['e'] = 0xe, ['f'] = 0xf,
+};
+
+/* like g_ascii_strtoull() this stops at the first invalid character, but
+ * without needing a NUL-terminated copy of the string */
+static guint32
+fu_firmware_strparse_uintn (const gchar *data, guint len)
+{
+	guint32 val = 0;
+	for (guint i = 0; i < len; i++) {
+		guint8 tmp = fu_firmware_hex_table[(guint8) data[i]];
+		if (tmp == 0 && data[i] != '0')
+			break;
+		val = (val << 4) | tmp;
+	}
+	return val;
+}
+
 /**
  * fu_firmware_strparse_uint4:
  * @data: a string
@@ -28,10 +49,7 @@
 guint8
 fu_firmware_strparse_uint4 (const gchar *data)
 {
-	gchar buffer[2];
-	memcpy (buffer, data, 1);
-	buffer[1] = '\0';
-	return (guint8) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint8) fu_firmware_strparse_uintn (data, 1);
 }
 
 /**
@@ -50,10 +68,7 @@ fu_firmware_strparse_uint4 (const gchar *data)
 guint8
 fu_firmware_strparse_uint8 (const gchar *data)
 {
-	gchar buffer[3];
-	memcpy (buffer, data, 2);
-	buffer[2] = '\0';
-	return (guint8) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint8) fu_firmware_strparse_uintn (data, 2);
 }
 
 /**
@@ -72,10 +87,7 @@ fu_firmware_strparse_uint8 (const gchar *data)
 guint16
 fu_firmware_strparse_uint16 (const gchar *data)
 {
-	gchar buffer[5];
-	memcpy (buffer, data, 4);
-	buffer[4] = '\0';
-	return (guint16) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint16) fu_firmware_strparse_uintn (data, 4);
 }
 
 /**
@@ -94,10 +106,7 @@ fu_firmware_strparse_uint16 (const gchar *data)
 guint32
 fu_firmware_strparse_uint24 (const gchar *data)
 {
-	gchar buffer[7];
-	memcpy (buffer, data, 6);
-	buffer[6] = '\0';
-	return (guint32) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint32) fu_firmware_strparse_uintn (data, 6);
 }
 
 /**
@@ -116,8 +125,5 @@ fu_firmware_strparse_uint24 (const gchar *data)
 guint32
 fu_firmware_strparse_uint32 (const gchar *data)
 {
-	gchar buffer[9];
-	memcpy (buffer, data, 8);
-	buffer[8] = '\0';
-	return (guint32) g_ascii_strtoull (buffer, NULL, 16);
+	return (guint32) fu_firmware_strparse_uintn (data, 8);
 }
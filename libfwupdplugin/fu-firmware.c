@@ -177,7 +177,16 @@ fu_firmware_parse_file (FuFirmware *self, GFile *file, FwupdInstallFlags flags,
 {
 	gchar *buf = NULL;
 	gsize bufsz = 0;
+	g_autofree gchar *fn = g_file_get_path (file);
 	g_autoptr(GBytes) fw = NULL;
+
+	/* local files can be mapped rather than copied */
+	if (fn != NULL) {
+		fw = fu_common_get_contents_bytes (fn, error);
+		if (fw == NULL)
+			return FALSE;
+		return fu_firmware_parse (self, fw, flags, error);
+	}
 	if (!g_file_load_contents (file, NULL, &buf, &bufsz, NULL, error))
 		return FALSE;
 	fw = g_bytes_new_take (buf, bufsz);
@@ -226,16 +235,56 @@ fu_firmware_write (FuFirmware *self, GError **error)
 gboolean
 fu_firmware_write_file (FuFirmware *self, GFile *file, GError **error)
 {
+	g_autoptr(GFileOutputStream) stream = NULL;
+
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+	if (!fu_firmware_write_stream (self, G_OUTPUT_STREAM (stream), error))
+		return FALSE;
+	return g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+/**
+ * fu_firmware_write_stream:
+ * @self: A #FuFirmware
+ * @stream: A #GOutputStream
+ * @error: A #GError, or %NULL
+ *
+ * Writes a firmware to a stream. Formats which implement the write_stream
+ * vfunc emit the data incrementally rather than building the entire blob in
+ * memory first.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_firmware_write_stream (FuFirmware *self, GOutputStream *stream, GError **error)
+{
+	FuFirmwareClass *klass = FU_FIRMWARE_GET_CLASS (self);
 	g_autoptr(GBytes) blob = NULL;
+
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* subclassed */
+	if (klass->write_stream != NULL)
+		return klass->write_stream (self, stream, error);
+
+	/* write the whole blob */
 	blob = fu_firmware_write (self, error);
 	if (blob == NULL)
 		return FALSE;
-	return g_file_replace_contents (file,
-					g_bytes_get_data (blob, NULL),
-					g_bytes_get_size (blob),
-					NULL, FALSE,
-					G_FILE_CREATE_NONE,
-					NULL, NULL, error);
+	return g_output_stream_write_all (stream,
+					  g_bytes_get_data (blob, NULL),
+					  g_bytes_get_size (blob),
+					  NULL, NULL, error);
 }
 
 /**
@@ -258,6 +307,23 @@ fu_firmware_add_image (FuFirmware *self, FuFirmwareImage *img)
 	g_ptr_array_add (priv->images, g_object_ref (img));
 }
 
+/**
+ * fu_firmware_remove_images:
+ * @self: a #FuFirmware
+ *
+ * Removes all the images from the firmware, typically so that the same
+ * object can be used to parse a different blob.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_firmware_remove_images (FuFirmware *self)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_FIRMWARE (self));
+	g_ptr_array_set_size (priv->images, 0);
+}
+
 /**
  * fu_firmware_get_images:
  * @self: a #FuFirmware
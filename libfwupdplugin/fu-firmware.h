@@ -32,8 +32,11 @@ struct _FuFirmwareClass
 							 GBytes		*fw,
 							 FwupdInstallFlags flags,
 							 GError		**error);
+	gboolean		 (*write_stream)	(FuFirmware	*self,
+							 GOutputStream	*stream,
+							 GError		**error);
 	/*< private >*/
-	gpointer		 padding[28];
+	gpointer		 padding[27];
 };
 
 FuFirmware	*fu_firmware_new			(void);
@@ -66,9 +69,13 @@ GBytes		*fu_firmware_write			(FuFirmware	*self,
 gboolean	 fu_firmware_write_file			(FuFirmware	*self,
 							 GFile		*file,
 							 GError		**error);
+gboolean	 fu_firmware_write_stream		(FuFirmware	*self,
+							 GOutputStream	*stream,
+							 GError		**error);
 
 void		 fu_firmware_add_image			(FuFirmware	*self,
 							 FuFirmwareImage *img);
+void		 fu_firmware_remove_images		(FuFirmware	*self);
 GPtrArray	*fu_firmware_get_images			(FuFirmware	*self);
 FuFirmwareImage *fu_firmware_get_image_by_id		(FuFirmware	*self,
 							 const gchar	*id,
@@ -9,9 +9,15 @@
 #include "fu-fmap-firmware.h"
 
 #define FMAP_SIGNATURE		"__FMAP__"
+#define FMAP_SIGNATURE_LEN	(sizeof(FMAP_SIGNATURE) - 1)
 #define FMAP_AREANAME		"FMAP"
 
-G_DEFINE_TYPE (FuFmapFirmware, fu_fmap_firmware, FU_TYPE_FIRMWARE)
+typedef struct {
+	gsize			 offset;
+} FuFmapFirmwarePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (FuFmapFirmware, fu_fmap_firmware, FU_TYPE_FIRMWARE)
+#define GET_PRIVATE(o) (fu_fmap_firmware_get_instance_private (o))
 
 /* returns size of fmap data structure if successful, <0 to indicate error */
 static gint
@@ -20,51 +26,65 @@ fmap_size (FuFmap *fmap)
 	if (fmap == NULL)
 		return -1;
 
-	return sizeof (*fmap) + (fmap->nareas * sizeof (FuFmap));
+	return sizeof (*fmap) + (fmap->nareas * sizeof (FuFmapArea));
 }
 
-/* brute force linear search */
 static gboolean
-fmap_lsearch (const guint8 *image, gsize len, gsize *offset, GError **error)
+fmap_signature_at (const guint8 *image, gsize len, gsize offset)
 {
-	gsize i;
-	gboolean fmap_found = FALSE;
+	if (offset > len || len - offset < FMAP_SIGNATURE_LEN)
+		return FALSE;
+	return memcmp (&image[offset], FMAP_SIGNATURE, FMAP_SIGNATURE_LEN) == 0;
+}
 
-	if (offset == NULL) {
+static gboolean
+fmap_check_size (const guint8 *image, gsize len, gsize offset, GError **error)
+{
+	if (len - offset < sizeof (FuFmap) ||
+	    offset + fmap_size ((FuFmap *)&image[offset]) > len) {
 		g_set_error_literal (error,
 				     G_IO_ERROR,
 				     G_IO_ERROR_INVALID_DATA,
-				     "offset return not valid");
+				     "malformed fmap too close to end of image");
 		return FALSE;
 	}
+	return TRUE;
+}
 
-	for (i = 0; i < len - strlen(FMAP_SIGNATURE); i++) {
-		if (!memcmp(&image[i],
-		            FMAP_SIGNATURE,
-		            strlen(FMAP_SIGNATURE))) {
-			fmap_found = TRUE;
-			break;
-		}
-	}
+/* linear search, only comparing where the first byte matches */
+static gboolean
+fmap_lsearch (const guint8 *image, gsize len, gsize *offset, GError **error)
+{
+	const guint8 *ptr = image;
+	const guint8 *end = image + len;
 
-	if (!fmap_found) {
+	if (offset == NULL) {
 		g_set_error_literal (error,
 				     G_IO_ERROR,
 				     G_IO_ERROR_INVALID_DATA,
-				     "fmap not found using linear search");
+				     "offset return not valid");
 		return FALSE;
 	}
 
-	if (i + fmap_size ((FuFmap *)&image[i]) > len) {
-		g_set_error_literal (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_INVALID_DATA,
-				     "malformed fmap too close to end of image");
-		return FALSE;
+	while ((gsize) (end - ptr) >= FMAP_SIGNATURE_LEN) {
+		ptr = memchr (ptr, FMAP_SIGNATURE[0], (end - ptr) - FMAP_SIGNATURE_LEN + 1);
+		if (ptr == NULL)
+			break;
+		if (memcmp (ptr, FMAP_SIGNATURE, FMAP_SIGNATURE_LEN) == 0) {
+			gsize i = ptr - image;
+			if (!fmap_check_size (image, len, i, error))
+				return FALSE;
+			*offset = i;
+			return TRUE;
+		}
+		ptr++;
 	}
 
-	*offset = i;
-	return TRUE;
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "fmap not found using linear search");
+	return FALSE;
 }
 
 /* if image length is a power of 2, use binary search */
@@ -88,16 +108,16 @@ fmap_bsearch (const guint8 *image, gsize len, gsize *offset, GError **error)
 	 * remainder when modding the offset with the previous stride. This
 	 * makes it so that each offset is only checked once.
 	 */
-	for (gint stride = len / 2; stride >= 1; stride /= 2) {
+	for (gsize stride = len / 2; stride >= 1; stride /= 2) {
 		if (fmap_found)
 			break;
 
-		for (i = 0; i < len - strlen(FMAP_SIGNATURE); i += stride) {
+		for (i = 0; i < len - FMAP_SIGNATURE_LEN; i += stride) {
 			if ((i % (stride * 2) == 0) && (i != 0))
 				continue;
 			if (!memcmp (&image[i],
 				     FMAP_SIGNATURE,
-				     strlen (FMAP_SIGNATURE))) {
+				     FMAP_SIGNATURE_LEN)) {
 				fmap_found = TRUE;
 				break;
 			}
@@ -112,13 +132,8 @@ fmap_bsearch (const guint8 *image, gsize len, gsize *offset, GError **error)
 		return FALSE;
 	}
 
-	if (i + fmap_size ((FuFmap *)&image[i]) > len) {
-		g_set_error_literal (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_INVALID_DATA,
-				     "malformed fmap too close to end of image");
+	if (!fmap_check_size (image, len, i, error))
 		return FALSE;
-	}
 
 	*offset = i;
 	return TRUE;
@@ -147,6 +162,10 @@ fmap_find (const guint8 *image, gsize image_len, gsize *offset, GError **error)
 		return FALSE;
 	}
 
+	/* the same offset as the last image, or as set by the caller */
+	if (fmap_signature_at (image, image_len, *offset))
+		return fmap_check_size (image, image_len, *offset, error);
+
 	if (popcnt (image_len) == 1) {
 		if (!fmap_bsearch (image, image_len, offset, error)) {
 			g_prefix_error (error, "failed fmap_find using bsearch: ");
@@ -170,10 +189,12 @@ fu_fmap_firmware_parse (FuFirmware *firmware,
 			FwupdInstallFlags flags,
 			GError **error)
 {
+	FuFmapFirmware *self = FU_FMAP_FIRMWARE (firmware);
+	FuFmapFirmwarePrivate *priv = GET_PRIVATE (self);
 	FuFmapFirmwareClass *klass_firmware = FU_FMAP_FIRMWARE_GET_CLASS (firmware);
 	gsize image_len;
 	guint8 *image = (guint8 *)g_bytes_get_data (fw, &image_len);
-	gsize offset;
+	gsize offset = priv->offset;
 	const FuFmap *fmap;
 
 	/* corrupt */
@@ -186,12 +207,10 @@ fu_fmap_firmware_parse (FuFirmware *firmware,
 	}
 
 	if (!fmap_find (image, image_len, &offset, error)) {
-		g_set_error_literal (error,
-				     G_IO_ERROR,
-				     G_IO_ERROR_INVALID_DATA,
-				     "cannot find fmap in image");
+		g_prefix_error (error, "cannot find fmap in image: ");
 		return FALSE;
 	}
+	priv->offset = offset;
 
 	fmap = (const FuFmap *)(image + offset);
 
@@ -247,6 +266,42 @@ fu_fmap_firmware_parse (FuFirmware *firmware,
 	return TRUE;
 }
 
+/**
+ * fu_fmap_firmware_set_offset:
+ * @self: A #FuFmapFirmware
+ * @offset: the offset of the FMAP in the image, e.g. from a previous image
+ *
+ * Sets the offset which is checked before searching the image for the FMAP
+ * signature. This is set automatically after each successful parse.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_fmap_firmware_set_offset (FuFmapFirmware *self, gsize offset)
+{
+	FuFmapFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_FMAP_FIRMWARE (self));
+	priv->offset = offset;
+}
+
+/**
+ * fu_fmap_firmware_get_offset:
+ * @self: A #FuFmapFirmware
+ *
+ * Gets the offset of the FMAP in the last parsed image.
+ *
+ * Returns: offset in bytes
+ *
+ * Since: 1.5.0
+ **/
+gsize
+fu_fmap_firmware_get_offset (FuFmapFirmware *self)
+{
+	FuFmapFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_FMAP_FIRMWARE (self), 0);
+	return priv->offset;
+}
+
 static void
 fu_fmap_firmware_init (FuFmapFirmware *self)
 {
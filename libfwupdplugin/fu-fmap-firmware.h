@@ -48,3 +48,6 @@ typedef struct __attribute__((packed)) {
 } FuFmap;
 
 FuFirmware			*fu_fmap_firmware_new			(void);
+void				 fu_fmap_firmware_set_offset		(FuFmapFirmware	*self,
+									 gsize		 offset);
+gsize				 fu_fmap_firmware_get_offset		(FuFmapFirmware	*self);
@@ -17,6 +17,8 @@
 #define FU_HID_REPORT_TYPE_OUTPUT			0x02
 #define FU_HID_REPORT_TYPE_FEATURE			0x03
 
+#define FU_HID_DEVICE_RETRIES				10
+
 /**
  * SECTION:fu-hid-device
  * @short_description: a HID device
@@ -30,9 +32,19 @@ typedef struct
 {
 	FuUsbDevice		*usb_device;
 	guint8			 interface;
+	guint8			 ep_addr_in;	/* only for _USE_INTERRUPT_TRANSFER */
+	guint8			 ep_addr_out;	/* only for _USE_INTERRUPT_TRANSFER */
 	gboolean		 interface_autodetect;
 } FuHidDevicePrivate;
 
+typedef struct {
+	guint8			 value;
+	guint8			*buf;
+	gsize			 bufsz;
+	guint			 timeout;
+	FuHidDeviceFlags	 flags;
+} FuHidDeviceRetryHelper;
+
 G_DEFINE_TYPE_WITH_PRIVATE (FuHidDevice, fu_hid_device, FU_TYPE_USB_DEVICE)
 
 enum {
@@ -74,6 +86,41 @@ fu_hid_device_set_property (GObject *object, guint prop_id,
 	}
 }
 
+/* not fatal, as the control endpoint is always available */
+static void
+fu_hid_device_ensure_endpoints (FuHidDevice *self)
+{
+	FuHidDevicePrivate *priv = GET_PRIVATE (self);
+	GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
+	g_autoptr(GPtrArray) ifaces = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	priv->ep_addr_in = 0x0;
+	priv->ep_addr_out = 0x0;
+	ifaces = g_usb_device_get_interfaces (usb_device, &error_local);
+	if (ifaces == NULL) {
+		g_debug ("failed to find interrupt endpoints: %s", error_local->message);
+		return;
+	}
+	for (guint i = 0; i < ifaces->len; i++) {
+		GUsbInterface *iface = g_ptr_array_index (ifaces, i);
+		g_autoptr(GPtrArray) eps = NULL;
+		if (g_usb_interface_get_number (iface) != priv->interface)
+			continue;
+		eps = g_usb_interface_get_endpoints (iface);
+		if (eps == NULL)
+			continue;
+		/* HID class interfaces only have interrupt endpoints */
+		for (guint j = 0; j < eps->len; j++) {
+			GUsbEndpoint *ep = g_ptr_array_index (eps, j);
+			if (g_usb_endpoint_get_direction (ep) == G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST)
+				priv->ep_addr_in = g_usb_endpoint_get_address (ep);
+			else
+				priv->ep_addr_out = g_usb_endpoint_get_address (ep);
+		}
+	}
+}
+
 static gboolean
 fu_hid_device_open (FuUsbDevice *device, GError **error)
 {
@@ -106,8 +153,12 @@ fu_hid_device_open (FuUsbDevice *device, GError **error)
 		g_debug ("autodetected HID interface of 0x%02x", priv->interface);
 	}
 
-	/* claim */
-	if (!g_usb_device_claim_interface (usb_device, priv->interface,
+	/* find the interrupt endpoints, if any */
+	fu_hid_device_ensure_endpoints (self);
+
+	/* claim, unless the transfers are answered from a recording */
+	if (!fu_io_recording_is_replay (fu_device_get_io_recording (FU_DEVICE (self))) &&
+	    !g_usb_device_claim_interface (usb_device, priv->interface,
 					   G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
 					   error)) {
 		g_prefix_error (error, "failed to claim HID interface: ");
@@ -139,7 +190,8 @@ fu_hid_device_close (FuUsbDevice *device, GError **error)
 	}
 
 	/* release */
-	if (!g_usb_device_release_interface (usb_device, priv->interface,
+	if (!fu_io_recording_is_replay (fu_device_get_io_recording (FU_DEVICE (self))) &&
+	    !g_usb_device_release_interface (usb_device, priv->interface,
 					     G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
 					     error)) {
 		g_prefix_error (error, "failed to release HID interface: ");
@@ -190,6 +242,64 @@ fu_hid_device_get_interface (FuHidDevice *self)
 	return priv->interface;
 }
 
+static gboolean
+fu_hid_device_set_report_internal (FuHidDevice *self,
+				   FuHidDeviceRetryHelper *helper,
+				   GError **error)
+{
+	FuHidDevicePrivate *priv = GET_PRIVATE (self);
+	gsize actual_len = 0;
+	guint16 wvalue = (FU_HID_REPORT_TYPE_OUTPUT << 8) | helper->value;
+
+	/* special case */
+	if (helper->flags & FU_HID_DEVICE_FLAG_IS_FEATURE)
+		wvalue = (FU_HID_REPORT_TYPE_FEATURE << 8) | helper->value;
+
+	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
+		fu_common_dump_raw (G_LOG_DOMAIN, "HID::SetReport", helper->buf, helper->bufsz);
+	if ((helper->flags & FU_HID_DEVICE_FLAG_USE_INTERRUPT_TRANSFER) > 0 &&
+	    priv->ep_addr_out != 0x0) {
+		if (!fu_usb_device_interrupt_transfer (FU_USB_DEVICE (self),
+						       priv->ep_addr_out,
+						       helper->buf, helper->bufsz,
+						       &actual_len,
+						       helper->timeout,
+						       error)) {
+			g_prefix_error (error, "failed to SetReport [interrupt-transfer]: ");
+			return FALSE;
+		}
+	} else {
+		if (!fu_usb_device_control_transfer (FU_USB_DEVICE (self),
+						     G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+						     G_USB_DEVICE_REQUEST_TYPE_CLASS,
+						     G_USB_DEVICE_RECIPIENT_INTERFACE,
+						     FU_HID_REPORT_SET,
+						     wvalue, priv->interface,
+						     helper->buf, helper->bufsz,
+						     &actual_len,
+						     helper->timeout,
+						     error)) {
+			g_prefix_error (error, "failed to SetReport: ");
+			return FALSE;
+		}
+	}
+	if ((helper->flags & FU_HID_DEVICE_FLAG_ALLOW_TRUNC) == 0 && actual_len != helper->bufsz) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "wrote %" G_GSIZE_FORMAT ", requested %" G_GSIZE_FORMAT " bytes",
+			     actual_len, helper->bufsz);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_hid_device_set_report_internal_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	FuHidDevice *self = FU_HID_DEVICE (device);
+	FuHidDeviceRetryHelper *helper = (FuHidDeviceRetryHelper *) user_data;
+	return fu_hid_device_set_report_internal (self, helper, error);
+}
+
 /**
  * fu_hid_device_set_report:
  * @self: A #FuHidDevice
@@ -202,6 +312,10 @@ fu_hid_device_get_interface (FuHidDevice *self)
  *
  * Calls SetReport on the hardware.
  *
+ * If %FU_HID_DEVICE_FLAG_USE_INTERRUPT_TRANSFER is set and the HID interface
+ * has an interrupt OUT endpoint then the report is sent on that instead of
+ * using a control transfer, in which case @value is not used.
+ *
  * Returns: %TRUE for success
  *
  * Since: 1.4.0
@@ -215,44 +329,88 @@ fu_hid_device_set_report (FuHidDevice *self,
 			  FuHidDeviceFlags flags,
 			  GError **error)
 {
-	FuHidDevicePrivate *priv = GET_PRIVATE (self);
-	GUsbDevice *usb_device;
-	gsize actual_len = 0;
-	guint16 wvalue = (FU_HID_REPORT_TYPE_OUTPUT << 8) | value;
-
-	/* special case */
-	if (flags & FU_HID_DEVICE_FLAG_IS_FEATURE)
-		wvalue = (FU_HID_REPORT_TYPE_FEATURE << 8) | value;
+	FuHidDeviceRetryHelper helper;
 
 	g_return_val_if_fail (FU_HID_DEVICE (self), FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
 	g_return_val_if_fail (bufsz != 0, FALSE);
 
-	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
-		fu_common_dump_raw (G_LOG_DOMAIN, "HID::SetReport", buf, bufsz);
-	usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
-	if (!g_usb_device_control_transfer (usb_device,
-					    G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
-					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
-					    G_USB_DEVICE_RECIPIENT_INTERFACE,
-					    FU_HID_REPORT_SET,
-					    wvalue, priv->interface,
-					    buf, bufsz,
-					    &actual_len,
-					    timeout,
-					    NULL, error)) {
-		g_prefix_error (error, "failed to SetReport: ");
-		return FALSE;
+	/* create helper */
+	helper.value = value;
+	helper.buf = buf;
+	helper.bufsz = bufsz;
+	helper.timeout = timeout;
+	helper.flags = flags;
+
+	/* special case */
+	if (flags & FU_HID_DEVICE_FLAG_RETRY_FAILURE) {
+		return fu_device_retry (FU_DEVICE (self),
+					fu_hid_device_set_report_internal_cb,
+					FU_HID_DEVICE_RETRIES,
+					&helper,
+					error);
+	}
+	return fu_hid_device_set_report_internal (self, &helper, error);
+}
+
+static gboolean
+fu_hid_device_get_report_internal (FuHidDevice *self,
+				   FuHidDeviceRetryHelper *helper,
+				   GError **error)
+{
+	FuHidDevicePrivate *priv = GET_PRIVATE (self);
+	gsize actual_len = 0;
+	guint16 wvalue = (FU_HID_REPORT_TYPE_INPUT << 8) | helper->value;
+
+	/* special case */
+	if (helper->flags & FU_HID_DEVICE_FLAG_IS_FEATURE)
+		wvalue = (FU_HID_REPORT_TYPE_FEATURE << 8) | helper->value;
+
+	if ((helper->flags & FU_HID_DEVICE_FLAG_USE_INTERRUPT_TRANSFER) > 0 &&
+	    priv->ep_addr_in != 0x0) {
+		if (!fu_usb_device_interrupt_transfer (FU_USB_DEVICE (self),
+						       priv->ep_addr_in,
+						       helper->buf, helper->bufsz,
+						       &actual_len,
+						       helper->timeout,
+						       error)) {
+			g_prefix_error (error, "failed to GetReport [interrupt-transfer]: ");
+			return FALSE;
+		}
+	} else {
+		if (!fu_usb_device_control_transfer (FU_USB_DEVICE (self),
+						     G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+						     G_USB_DEVICE_REQUEST_TYPE_CLASS,
+						     G_USB_DEVICE_RECIPIENT_INTERFACE,
+						     FU_HID_REPORT_GET,
+						     wvalue, priv->interface,
+						     helper->buf, helper->bufsz,
+						     &actual_len, /* actual length */
+						     helper->timeout,
+						     error)) {
+			g_prefix_error (error, "failed to GetReport: ");
+			return FALSE;
+		}
 	}
-	if ((flags & FU_HID_DEVICE_FLAG_ALLOW_TRUNC) == 0 && actual_len != bufsz) {
+	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
+		fu_common_dump_raw (G_LOG_DOMAIN, "HID::GetReport", helper->buf, actual_len);
+	if ((helper->flags & FU_HID_DEVICE_FLAG_ALLOW_TRUNC) == 0 && actual_len != helper->bufsz) {
 		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
-			     "wrote %" G_GSIZE_FORMAT ", requested %" G_GSIZE_FORMAT " bytes",
-			     actual_len, bufsz);
+			     "read %" G_GSIZE_FORMAT ", requested %" G_GSIZE_FORMAT " bytes",
+			     actual_len, helper->bufsz);
 		return FALSE;
 	}
 	return TRUE;
 }
 
+static gboolean
+fu_hid_device_get_report_internal_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	FuHidDevice *self = FU_HID_DEVICE (device);
+	FuHidDeviceRetryHelper *helper = (FuHidDeviceRetryHelper *) user_data;
+	return fu_hid_device_get_report_internal (self, helper, error);
+}
+
 /**
  * fu_hid_device_get_report:
  * @self: A #FuHidDevice
@@ -265,6 +423,10 @@ fu_hid_device_set_report (FuHidDevice *self,
  *
  * Calls GetReport on the hardware.
  *
+ * If %FU_HID_DEVICE_FLAG_USE_INTERRUPT_TRANSFER is set and the HID interface
+ * has an interrupt IN endpoint then the next input report is read from that
+ * instead of using a control transfer, in which case @value is not used.
+ *
  * Returns: %TRUE for success
  *
  * Since: 1.4.0
@@ -278,44 +440,28 @@ fu_hid_device_get_report (FuHidDevice *self,
 			  FuHidDeviceFlags flags,
 			  GError **error)
 {
-	FuHidDevicePrivate *priv = GET_PRIVATE (self);
-	GUsbDevice *usb_device;
-	gsize actual_len = 0;
-	guint16 wvalue = (FU_HID_REPORT_TYPE_INPUT << 8) | value;
+	FuHidDeviceRetryHelper helper;
 
 	g_return_val_if_fail (FU_HID_DEVICE (self), FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
 	g_return_val_if_fail (bufsz != 0, FALSE);
 
-	/* special case */
-	if (flags & FU_HID_DEVICE_FLAG_IS_FEATURE)
-		wvalue = (FU_HID_REPORT_TYPE_FEATURE << 8) | value;
+	/* create helper */
+	helper.value = value;
+	helper.buf = buf;
+	helper.bufsz = bufsz;
+	helper.timeout = timeout;
+	helper.flags = flags;
 
-	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
-		fu_common_dump_raw (G_LOG_DOMAIN, "HID::GetReport", buf, actual_len);
-	usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
-	if (!g_usb_device_control_transfer (usb_device,
-					    G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
-					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
-					    G_USB_DEVICE_RECIPIENT_INTERFACE,
-					    FU_HID_REPORT_GET,
-					    wvalue, priv->interface,
-					    buf, bufsz,
-					    &actual_len, /* actual length */
-					    timeout,
-					    NULL, error)) {
-		g_prefix_error (error, "failed to GetReport: ");
-		return FALSE;
-	}
-	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
-		fu_common_dump_raw (G_LOG_DOMAIN, "HID::GetReport", buf, actual_len);
-	if ((flags & FU_HID_DEVICE_FLAG_ALLOW_TRUNC) == 0 && actual_len != bufsz) {
-		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
-			     "read %" G_GSIZE_FORMAT ", requested %" G_GSIZE_FORMAT " bytes",
-			     actual_len, bufsz);
-		return FALSE;
+	/* special case */
+	if (flags & FU_HID_DEVICE_FLAG_RETRY_FAILURE) {
+		return fu_device_retry (FU_DEVICE (self),
+					fu_hid_device_get_report_internal_cb,
+					FU_HID_DEVICE_RETRIES,
+					&helper,
+					error);
 	}
-	return TRUE;
+	return fu_hid_device_get_report_internal (self, &helper, error);
 }
 
 static void
@@ -28,6 +28,8 @@ struct _FuHidDeviceClass
  * @FU_HID_DEVICE_FLAG_NONE:			No flags set
  * @FU_HID_DEVICE_FLAG_ALLOW_TRUNC:		Allow truncated reads and writes
  * @FU_HID_DEVICE_FLAG_IS_FEATURE:		Use %FU_HID_REPORT_TYPE_FEATURE for wValue
+ * @FU_HID_DEVICE_FLAG_USE_INTERRUPT_TRANSFER:	Use the interrupt endpoints rather than the control endpoint, if available
+ * @FU_HID_DEVICE_FLAG_RETRY_FAILURE:		Retry the transfer if it fails
  *
  * Flags used when calling fu_hid_device_get_report() and fu_hid_device_set_report().
  **/
@@ -35,6 +37,8 @@ typedef enum {
 	FU_HID_DEVICE_FLAG_NONE			= 0,
 	FU_HID_DEVICE_FLAG_ALLOW_TRUNC		= 1 << 0,
 	FU_HID_DEVICE_FLAG_IS_FEATURE		= 1 << 1,
+	FU_HID_DEVICE_FLAG_USE_INTERRUPT_TRANSFER = 1 << 2,
+	FU_HID_DEVICE_FLAG_RETRY_FAILURE	= 1 << 3,
 	FU_HID_DEVICE_FLAG_LAST
 } FuHidDeviceFlags;
 
@@ -14,6 +14,7 @@
 
 #include "fu-common.h"
 #include "fu-hwids.h"
+#include "fu-smbios-private.h"
 #include "fwupd-common.h"
 #include "fwupd-error.h"
 
@@ -319,6 +320,95 @@ fu_hwids_convert_integer_cb (FuSmbios *smbios,
 	return g_strdup_printf ("%x", data_raw[offset]);
 }
 
+/* the HWIDs only change when the SMBIOS table does, so the values and GUIDs
+ * are saved and reused on the next start; bump the version when the values
+ * or GUIDs are calculated differently */
+#define FU_HWIDS_CACHE_VERSION		1
+#define FU_HWIDS_CACHE_FORMAT		"(usa{ss}a{ss}as)"
+
+static gchar *
+fu_hwids_get_cache_filename (void)
+{
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	return g_build_filename (cachedir, "hwids.gvariant", NULL);
+}
+
+static gboolean
+fu_hwids_load_cache (FuHwids *self, const gchar *checksum)
+{
+	gchar *key;
+	gchar *value;
+	guint32 version = 0;
+	const gchar *checksum_tmp = NULL;
+	g_autofree gchar *fn = fu_hwids_get_cache_filename ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariantIter) iter_display = NULL;
+	g_autoptr(GVariantIter) iter_guids = NULL;
+	g_autoptr(GVariantIter) iter_hw = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	mapped_file = g_mapped_file_new (fn, FALSE, NULL);
+	if (mapped_file == NULL)
+		return FALSE;
+	blob = g_mapped_file_get_bytes (mapped_file);
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (FU_HWIDS_CACHE_FORMAT),
+							    blob, FALSE));
+	if (!g_variant_is_normal_form (val))
+		return FALSE;
+	g_variant_get (val, "(u&sa{ss}a{ss}as)",
+		       &version, &checksum_tmp,
+		       &iter_hw, &iter_display, &iter_guids);
+	if (version != FU_HWIDS_CACHE_VERSION || g_strcmp0 (checksum_tmp, checksum) != 0)
+		return FALSE;
+	while (g_variant_iter_next (iter_hw, "{ss}", &key, &value))
+		g_hash_table_insert (self->hash_dmi_hw, key, value);
+	while (g_variant_iter_next (iter_display, "{ss}", &key, &value))
+		g_hash_table_insert (self->hash_dmi_display, key, value);
+	while (g_variant_iter_next (iter_guids, "s", &value)) {
+		g_hash_table_insert (self->hash_guid, g_strdup (value), GUINT_TO_POINTER (1));
+		g_ptr_array_add (self->array_guids, value);
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_hwids_save_cache (FuHwids *self, const gchar *checksum, GError **error)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder_display;
+	GVariantBuilder builder_guids;
+	GVariantBuilder builder_hw;
+	gpointer key;
+	gpointer value;
+	g_autofree gchar *fn = fu_hwids_get_cache_filename ();
+	g_autoptr(GVariant) val = NULL;
+
+	g_variant_builder_init (&builder_hw, G_VARIANT_TYPE ("a{ss}"));
+	g_hash_table_iter_init (&iter, self->hash_dmi_hw);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder_hw, "{ss}", key, value);
+	g_variant_builder_init (&builder_display, G_VARIANT_TYPE ("a{ss}"));
+	g_hash_table_iter_init (&iter, self->hash_dmi_display);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder_display, "{ss}", key, value);
+	g_variant_builder_init (&builder_guids, G_VARIANT_TYPE_STRING_ARRAY);
+	for (guint i = 0; i < self->array_guids->len; i++)
+		g_variant_builder_add (&builder_guids, "s", g_ptr_array_index (self->array_guids, i));
+	val = g_variant_ref_sink (g_variant_new (FU_HWIDS_CACHE_FORMAT,
+						 (guint32) FU_HWIDS_CACHE_VERSION,
+						 checksum,
+						 &builder_hw,
+						 &builder_display,
+						 &builder_guids));
+	if (!fu_common_mkdir_parent (fn, error))
+		return FALSE;
+	return g_file_set_contents (fn,
+				    g_variant_get_data (val),
+				    (gssize) g_variant_get_size (val),
+				    error);
+}
+
 /**
  * fu_hwids_setup:
  * @self: A #FuHwids
@@ -364,10 +454,23 @@ fu_hwids_setup (FuHwids *self, FuSmbios *smbios, GError **error)
 							fu_hwids_convert_string_table_cb },
 		{ NULL, 0x00, 0x00, NULL }
 	};
+	g_autofree gchar *checksum = NULL;
+	g_autoptr(GError) error_cache = NULL;
 
 	g_return_val_if_fail (FU_IS_HWIDS (self), FALSE);
 	g_return_val_if_fail (FU_IS_SMBIOS (smbios), FALSE);
 
+	/* the same table as last time */
+	checksum = fu_smbios_get_checksum (smbios, G_CHECKSUM_SHA256);
+	if (checksum != NULL && fu_hwids_load_cache (self, checksum)) {
+		g_debug ("using cached HWIDs for %s", checksum);
+		return TRUE;
+	}
+	g_hash_table_remove_all (self->hash_dmi_hw);
+	g_hash_table_remove_all (self->hash_dmi_display);
+	g_hash_table_remove_all (self->hash_guid);
+	g_ptr_array_set_size (self->array_guids, 0);
+
 	/* get all DMI data */
 	for (guint i = 0; map[i].key != NULL; i++) {
 		const gchar *contents_hdr;
@@ -420,6 +523,9 @@ fu_hwids_setup (FuHwids *self, FuSmbios *smbios, GError **error)
 		g_ptr_array_add (self->array_guids, g_steal_pointer (&guid));
 	}
 
+	/* not fatal, just slower next time */
+	if (checksum != NULL && !fu_hwids_save_cache (self, checksum, &error_cache))
+		g_debug ("failed to save HWIDs: %s", error_cache->message);
 	return TRUE;
 }
 
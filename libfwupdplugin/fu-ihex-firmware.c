@@ -25,7 +25,8 @@
 
 struct _FuIhexFirmware {
 	FuFirmware		 parent_instance;
-	GPtrArray		*records;
+	GBytes			*fw;
+	GPtrArray		*records;	/* only built when required */
 };
 
 G_DEFINE_TYPE (FuIhexFirmware, fu_ihex_firmware, FU_TYPE_FIRMWARE)
@@ -38,6 +39,25 @@ G_DEFINE_TYPE (FuIhexFirmware, fu_ihex_firmware, FU_TYPE_FIRMWARE)
 #define	DFU_INHX32_RECORD_TYPE_START_LINEAR	0x05
 #define	DFU_INHX32_RECORD_TYPE_SIGNATURE	0xfd
 
+/* count, address, type, up to 255 bytes of data, checksum */
+#define	DFU_INHX32_RECORD_SIZE_MAX		(1 + 2 + 1 + 0xff + 1)
+
+static void
+fu_ihex_firmware_record_free (FuIhexFirmwareRecord *rcd)
+{
+	g_string_free (rcd->buf, TRUE);
+	g_free (rcd);
+}
+
+static FuIhexFirmwareRecord *
+fu_ihex_firmware_record_new (guint ln, const gchar *buf)
+{
+	FuIhexFirmwareRecord *rcd = g_new0 (FuIhexFirmwareRecord, 1);
+	rcd->ln = ln;
+	rcd->buf = g_string_new (buf);
+	return rcd;
+}
+
 /**
  * fu_ihex_firmware_get_records:
  * @self: A #FuIhexFirmware
@@ -55,25 +75,24 @@ GPtrArray *
 fu_ihex_firmware_get_records (FuIhexFirmware *self)
 {
 	g_return_val_if_fail (FU_IS_IHEX_FIRMWARE (self), NULL);
-	return self->records;
-}
 
-static void
-fu_ihex_firmware_record_free (FuIhexFirmwareRecord *rcd)
-{
-	g_string_free (rcd->buf, TRUE);
-	g_free (rcd);
-}
-
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuIhexFirmwareRecord, fu_ihex_firmware_record_free)
-
-static FuIhexFirmwareRecord *
-fu_ihex_firmware_record_new (guint ln, const gchar *buf)
-{
-	FuIhexFirmwareRecord *rcd = g_new0 (FuIhexFirmwareRecord, 1);
-	rcd->ln = ln;
-	rcd->buf = g_string_new (buf);
-	return rcd;
+	/* the parser does not need these, so build them on demand */
+	if (self->records == NULL) {
+		self->records = g_ptr_array_new_with_free_func ((GFreeFunc) fu_ihex_firmware_record_free);
+		if (self->fw != NULL) {
+			gsize sz = 0;
+			const gchar *data = g_bytes_get_data (self->fw, &sz);
+			g_auto(GStrv) lines = fu_common_strnsplit (data, sz, "\n", -1);
+			for (guint ln = 0; lines[ln] != NULL; ln++) {
+				g_strdelimit (lines[ln], "\r\x1a", '\0');
+				if (lines[ln][0] == '\0')
+					continue;
+				g_ptr_array_add (self->records,
+						 fu_ihex_firmware_record_new (ln + 1, lines[ln]));
+			}
+		}
+	}
+	return self->records;
 }
 
 static const gchar *
@@ -101,17 +120,25 @@ fu_ihex_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			   FwupdInstallFlags flags, GError **error)
 {
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
-	gsize sz = 0;
-	const gchar *data = g_bytes_get_data (fw, &sz);
-	g_auto(GStrv) lines = fu_common_strnsplit (data, sz, "\n", -1);
 
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
-		g_autoptr(FuIhexFirmwareRecord) rcd = NULL;
-		g_strdelimit (lines[ln], "\r\x1a", '\0');
-		if (lines[ln][0] == '\0')
-			continue;
-		rcd = fu_ihex_firmware_record_new (ln + 1, lines[ln]);
-		g_ptr_array_add (self->records, g_steal_pointer (&rcd));
+	/* the records are only split out if fu_ihex_firmware_get_records()
+	 * is used, as the parser works directly on the blob */
+	g_clear_pointer (&self->records, g_ptr_array_unref);
+	g_clear_pointer (&self->fw, g_bytes_unref);
+	self->fw = g_bytes_ref (fw);
+	return TRUE;
+}
+
+static gboolean
+fu_ihex_firmware_check_byte_cnt (guint8 byte_cnt, guint8 byte_cnt_min, guint ln, GError **error)
+{
+	if (byte_cnt < byte_cnt_min) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "line %u too short, expected %u bytes and got %u",
+			     ln, byte_cnt_min, byte_cnt);
+		return FALSE;
 	}
 	return TRUE;
 }
@@ -124,89 +151,105 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 			FwupdInstallFlags flags,
 			GError **error)
 {
-	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
 	gboolean got_eof = FALSE;
+	gsize sz = 0;
+	const gchar *data = g_bytes_get_data (fw, &sz);
 	guint32 abs_addr = 0x0;
 	guint32 addr_last = 0x0;
 	guint32 img_addr = G_MAXUINT32;
 	guint32 seg_addr = 0x0;
+	guint ln = 0;
 	g_autoptr(FuFirmwareImage) img = fu_firmware_image_new (NULL);
 	g_autoptr(GBytes) img_bytes = NULL;
-	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	g_autoptr(GByteArray) buf = g_byte_array_sized_new (sz / 2);
 	g_autoptr(GByteArray) buf_signature = g_byte_array_new ();
 
-	/* parse records */
-	for (guint k = 0; k < self->records->len; k++) {
-		FuIhexFirmwareRecord *rcd = g_ptr_array_index (self->records, k);
-		const gchar *line = rcd->buf->str;
+	/* parse each line in place */
+	for (gsize offset = 0; offset < sz; ) {
+		const gchar *line = data + offset;
+		const gchar *line_nl = memchr (line, '\n', sz - offset);
+		gsize linesz = line_nl != NULL ? (gsize) (line_nl - line) : sz - offset;
+		guint8 rec[DFU_INHX32_RECORD_SIZE_MAX];
 		guint32 addr;
 		guint8 byte_cnt;
 		guint8 record_type;
 		guint line_end;
 
-		/* ignore comments */
-		if (g_str_has_prefix (line, ";"))
-			continue;
+		/* same as the old line splitter, i.e. stop at CR or EOF */
+		offset += linesz + 1;
+		ln++;
+		for (gsize i = 0; i < linesz; i++) {
+			if (line[i] == '\r' || line[i] == '\x1a' || line[i] == '\0') {
+				linesz = i;
+				break;
+			}
+		}
 
-		/* ignore blank lines */
-		if (rcd->buf->len == 0)
+		/* ignore blank lines and comments */
+		if (linesz == 0 || line[0] == ';')
 			continue;
 
 		/* check starting token */
 		if (line[0] != ':') {
+			g_autofree gchar *tmp = g_strndup (line, linesz);
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid starting token on line %u: %s",
-				     rcd->ln, line);
+				     ln, tmp);
 			return FALSE;
 		}
 
 		/* check there's enough data for the smallest possible record */
-		if (rcd->buf->len < 11) {
+		if (linesz < 11) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "line %u is incomplete, length %u",
-				     rcd->ln, (guint) rcd->buf->len);
+				     ln, (guint) linesz);
 			return FALSE;
 		}
 
-		/* length, 16-bit address, type */
-		byte_cnt = fu_firmware_strparse_uint8 (line + 1);
-		addr = fu_firmware_strparse_uint16 (line + 3);
-		record_type = fu_firmware_strparse_uint8 (line + 7);
-		g_debug ("%s:", fu_ihex_firmware_record_type_to_string (record_type));
-		g_debug ("  addr_start:\t0x%04x", addr);
-		g_debug ("  length:\t0x%02x", byte_cnt);
-		addr += seg_addr;
-		addr += abs_addr;
-		g_debug ("  addr:\t0x%08x", addr);
-
 		/* position of checksum */
+		byte_cnt = fu_firmware_strparse_uint8 (line + 1);
 		line_end = 9 + byte_cnt * 2;
-		if (line_end > (guint) rcd->buf->len) {
+		if (line_end > linesz) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "line %u malformed, length: %u",
-				     rcd->ln, line_end);
+				     ln, line_end);
 			return FALSE;
 		}
 
+		/* decode the whole record once, including the checksum */
+		for (guint i = 0; i < 4 + (guint) byte_cnt; i++)
+			rec[i] = fu_firmware_strparse_uint8 (line + 1 + i * 2);
+		rec[4 + byte_cnt] = line_end + 2 <= linesz ?
+			fu_firmware_strparse_uint8 (line + line_end) : 0x0;
+
+		/* length, 16-bit address, type */
+		addr = ((guint32) rec[1] << 8) | rec[2];
+		record_type = rec[3];
+		addr += seg_addr;
+		addr += abs_addr;
+		if (record_type != DFU_INHX32_RECORD_TYPE_DATA) {
+			g_debug ("%s: addr 0x%08x, length 0x%02x on line %u",
+				 fu_ihex_firmware_record_type_to_string (record_type),
+				 addr, byte_cnt, ln);
+		}
+
 		/* verify checksum */
 		if ((flags & FWUPD_INSTALL_FLAG_FORCE) == 0) {
 			guint8 checksum = 0;
-			for (guint i = 1; i < line_end + 2; i += 2) {
-				guint8 data_tmp = fu_firmware_strparse_uint8 (line + i);
-				checksum += data_tmp;
-			}
+			for (guint i = 0; i < 5 + (guint) byte_cnt; i++)
+				checksum += rec[i];
 			if (checksum != 0)  {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "line %u has invalid checksum (0x%02x)",
-					     rcd->ln, checksum);
+					     ln, checksum);
 				return FALSE;
 			}
 		}
@@ -226,39 +269,39 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 					     "invalid address 0x%x, last was 0x%x on line %u",
 					     (guint) addr,
 					     (guint) addr_last,
-					     rcd->ln);
+					     ln);
 				return FALSE;
 			}
+			if (byte_cnt == 0)
+				break;
 
-			/* parse bytes from line */
-			g_debug ("writing data 0x%08x", (guint32) addr);
-			for (guint i = 9; i < line_end; i += 2) {
-				/* any holes in the hex record */
+			/* any holes in the hex record */
+			if (addr_last > 0x0) {
 				guint32 len_hole = addr - addr_last;
-				guint8 data_tmp;
-				if (addr_last > 0 && len_hole > 0x100000) {
+				if (len_hole > 0x100000) {
 					g_set_error (error,
 						     FWUPD_ERROR,
 						     FWUPD_ERROR_INVALID_FILE,
 						     "hole of 0x%x bytes too large to fill on line %u",
 						     (guint) len_hole,
-						     rcd->ln);
+						     ln);
 					return FALSE;
 				}
-				if (addr_last > 0x0 && len_hole > 1) {
+				if (len_hole > 1) {
+					guint len_old = buf->len;
 					g_debug ("filling address 0x%08x to 0x%08x on line %u",
-						 addr_last + 1, addr_last + len_hole - 1, rcd->ln);
-					for (guint j = 1; j < len_hole; j++) {
-						/* although 0xff might be clearer,
-						 * we can't write 0xffff to pic14 */
-						fu_byte_array_append_uint8 (buf, 0x00);
-					}
+						 addr_last + 1, addr_last + len_hole - 1, ln);
+
+					/* although 0xff might be clearer,
+					 * we can't write 0xffff to pic14 */
+					g_byte_array_set_size (buf, len_old + len_hole - 1);
+					memset (buf->data + len_old, 0x00, len_hole - 1);
 				}
-				/* write into buf */
-				data_tmp = fu_firmware_strparse_uint8 (line + i);
-				fu_byte_array_append_uint8 (buf, (gchar) data_tmp);
-				addr_last = addr++;
 			}
+
+			/* write into buf */
+			g_byte_array_append (buf, rec + 4, byte_cnt);
+			addr_last = addr + byte_cnt - 1;
 			break;
 		case DFU_INHX32_RECORD_TYPE_EOF:
 			if (got_eof) {
@@ -272,28 +315,33 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 			got_eof = TRUE;
 			break;
 		case DFU_INHX32_RECORD_TYPE_EXTENDED_LINEAR:
-			abs_addr = fu_firmware_strparse_uint16 (line + 9) << 16;
-			g_debug ("  abs_addr:\t0x%02x on line %u", abs_addr, rcd->ln);
+			if (!fu_ihex_firmware_check_byte_cnt (byte_cnt, 2, ln, error))
+				return FALSE;
+			abs_addr = fu_common_read_uint16 (rec + 4, G_BIG_ENDIAN) << 16;
+			g_debug ("  abs_addr:\t0x%02x on line %u", abs_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_START_LINEAR:
-			abs_addr = fu_firmware_strparse_uint32 (line + 9);
-			g_debug ("  abs_addr:\t0x%08x on line %u", abs_addr, rcd->ln);
+			if (!fu_ihex_firmware_check_byte_cnt (byte_cnt, 4, ln, error))
+				return FALSE;
+			abs_addr = fu_common_read_uint32 (rec + 4, G_BIG_ENDIAN);
+			g_debug ("  abs_addr:\t0x%08x on line %u", abs_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_EXTENDED_SEGMENT:
 			/* segment base address, so ~1Mb addressable */
-			seg_addr = fu_firmware_strparse_uint16 (line + 9) * 16;
-			g_debug ("  seg_addr:\t0x%08x on line %u", seg_addr, rcd->ln);
+			if (!fu_ihex_firmware_check_byte_cnt (byte_cnt, 2, ln, error))
+				return FALSE;
+			seg_addr = fu_common_read_uint16 (rec + 4, G_BIG_ENDIAN) * 16;
+			g_debug ("  seg_addr:\t0x%08x on line %u", seg_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_START_SEGMENT:
 			/* initial content of the CS:IP registers */
-			seg_addr = fu_firmware_strparse_uint32 (line + 9);
-			g_debug ("  seg_addr:\t0x%02x on line %u", seg_addr, rcd->ln);
+			if (!fu_ihex_firmware_check_byte_cnt (byte_cnt, 4, ln, error))
+				return FALSE;
+			seg_addr = fu_common_read_uint32 (rec + 4, G_BIG_ENDIAN);
+			g_debug ("  seg_addr:\t0x%02x on line %u", seg_addr, ln);
 			break;
 		case DFU_INHX32_RECORD_TYPE_SIGNATURE:
-			for (guint i = 9; i < line_end; i += 2) {
-				guint8 tmp_c = fu_firmware_strparse_uint8 (line + i);
-				fu_byte_array_append_uint8 (buf_signature, tmp_c);
-			}
+			g_byte_array_append (buf_signature, rec + 4, byte_cnt);
 			break;
 		default:
 			/* vendors sneak in nonstandard sections past the EOF */
@@ -303,7 +351,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid ihex record type %i on line %u",
-				     record_type, rcd->ln);
+				     record_type, ln);
 			return FALSE;
 		}
 	}
@@ -318,7 +366,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 	}
 
 	/* add single image */
-	img_bytes = g_bytes_new (buf->data, buf->len);
+	img_bytes = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
 	fu_firmware_image_set_bytes (img, img_bytes);
 	if (img_addr != G_MAXUINT32)
 		fu_firmware_image_set_addr (img, img_addr);
@@ -357,8 +405,26 @@ fu_ihex_firmware_emit_chunk (GString *str,
 	g_string_append_printf (str, "%02X\n", (guint) (((~checksum) + 0x01) & 0xff));
 }
 
+/* flush the pending records once this large, so that the output for a large
+ * image is never held in memory all at once */
+#define FU_IHEX_FIRMWARE_FLUSH_SIZE	0x1000
+
+static gboolean
+fu_ihex_firmware_flush (GOutputStream *stream, GString *str, GError **error)
+{
+	if (str->len == 0)
+		return TRUE;
+	if (!g_output_stream_write_all (stream, str->str, str->len, NULL, NULL, error))
+		return FALSE;
+	g_string_truncate (str, 0);
+	return TRUE;
+}
+
 static gboolean
-fu_ihex_firmware_image_to_string (FuFirmwareImage *img, GString *str, GError **error)
+fu_ihex_firmware_image_to_stream (FuFirmwareImage *img,
+				  GOutputStream *stream,
+				  GString *str,
+				  GError **error)
 {
 	const guint8 *data;
 	const guint chunk_size = 16;
@@ -396,42 +462,61 @@ fu_ihex_firmware_image_to_string (FuFirmwareImage *img, GString *str, GError **e
 		address_tmp &= 0xffff;
 		fu_ihex_firmware_emit_chunk (str, address_tmp,
 					     record_type, data + i, chunk_len);
+		if (str->len >= FU_IHEX_FIRMWARE_FLUSH_SIZE) {
+			if (!fu_ihex_firmware_flush (stream, str, error))
+				return FALSE;
+		}
 	}
 	return TRUE;
 }
 
-static GBytes *
-fu_ihex_firmware_write (FuFirmware *firmware, GError **error)
+static gboolean
+fu_ihex_firmware_write_stream (FuFirmware *firmware,
+			       GOutputStream *stream,
+			       GError **error)
 {
 	g_autoptr(GPtrArray) imgs = NULL;
 	g_autoptr(GString) str = NULL;
 
 	/* write all the element data */
-	str = g_string_new ("");
+	str = g_string_sized_new (FU_IHEX_FIRMWARE_FLUSH_SIZE + 0x100);
 	imgs = fu_firmware_get_images (firmware);
 	for (guint i = 0; i < imgs->len; i++) {
 		FuFirmwareImage *img = g_ptr_array_index (imgs, i);
-		if (!fu_ihex_firmware_image_to_string (img, str, error))
-			return NULL;
+		if (!fu_ihex_firmware_image_to_stream (img, stream, str, error))
+			return FALSE;
 	}
 
 	/* add EOF */
 	fu_ihex_firmware_emit_chunk (str, 0x0, DFU_INHX32_RECORD_TYPE_EOF, NULL, 0);
-	return g_bytes_new (str->str, str->len);
+	return fu_ihex_firmware_flush (stream, str, error);
+}
+
+static GBytes *
+fu_ihex_firmware_write (FuFirmware *firmware, GError **error)
+{
+	g_autoptr(GOutputStream) stream = g_memory_output_stream_new_resizable ();
+	if (!fu_ihex_firmware_write_stream (firmware, stream, error))
+		return NULL;
+	if (!g_output_stream_close (stream, NULL, error))
+		return NULL;
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (stream));
 }
 
 static void
 fu_ihex_firmware_finalize (GObject *object)
 {
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (object);
-	g_ptr_array_unref (self->records);
+	if (self->fw != NULL)
+		g_bytes_unref (self->fw);
+	if (self->records != NULL)
+		g_ptr_array_unref (self->records);
 	G_OBJECT_CLASS (fu_ihex_firmware_parent_class)->finalize (object);
 }
 
 static void
 fu_ihex_firmware_init (FuIhexFirmware *self)
 {
-	self->records = g_ptr_array_new_with_free_func ((GFreeFunc) fu_ihex_firmware_record_free);
 }
 
 static void
@@ -443,6 +528,7 @@ fu_ihex_firmware_class_init (FuIhexFirmwareClass *klass)
 	klass_firmware->parse = fu_ihex_firmware_parse;
 	klass_firmware->tokenize = fu_ihex_firmware_tokenize;
 	klass_firmware->write = fu_ihex_firmware_write;
+	klass_firmware->write_stream = fu_ihex_firmware_write_stream;
 }
 
 /**
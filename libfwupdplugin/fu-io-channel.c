@@ -21,12 +21,19 @@
 #include "fwupd-error.h"
 #include "fu-common.h"
 #include "fu-io-channel.h"
+#include "fu-io-recording.h"
 
 struct _FuIOChannel {
 	GObject			 parent_instance;
 	gint			 fd;
+	GByteArray		*rbuf;		/* read but not yet returned */
+	GByteArray		*wbuf;		/* queued with FU_IO_CHANNEL_FLAG_BUFFER_WRITE */
+	FuIoRecording		*io_recording;	/* nullable */
 };
 
+/* read as much as the kernel has, rather than one response at a time */
+#define FU_IO_CHANNEL_READ_BLOCK_SIZE		4096
+
 G_DEFINE_TYPE (FuIOChannel, fu_io_channel, G_TYPE_OBJECT)
 
 /**
@@ -61,6 +68,11 @@ gboolean
 fu_io_channel_shutdown (FuIOChannel *self, GError **error)
 {
 	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), FALSE);
+	if (self->wbuf->len > 0) {
+		g_debug ("discarding %u queued bytes", self->wbuf->len);
+		g_byte_array_set_size (self->wbuf, 0);
+	}
+	g_byte_array_set_size (self->rbuf, 0);
 	if (!g_close (self->fd, error))
 		return FALSE;
 	self->fd = -1;
@@ -74,6 +86,7 @@ fu_io_channel_flush_input (FuIOChannel *self, GError **error)
 		.fd = self->fd,
 		.events = G_IO_IN | G_IO_ERR,
 	};
+	g_byte_array_set_size (self->rbuf, 0);
 	while (g_poll (&poll, 1, 0) > 0) {
 		gchar c;
 		gint r = read (self->fd, &c, 1);
@@ -133,39 +146,16 @@ fu_io_channel_write_byte_array (FuIOChannel *self,
 	return fu_io_channel_write_raw (self, buf->data, buf->len, timeout_ms, flags, error);
 }
 
-/**
- * fu_io_channel_write_raw:
- * @self: a #FuIOChannel
- * @data: buffer to write
- * @datasz: size of @data
- * @timeout_ms: timeout in ms
- * @flags: some #FuIOChannelFlags, e.g. %FU_IO_CHANNEL_FLAG_SINGLE_SHOT
- * @error: a #GError, or %NULL
- *
- * Writes bytes to the TTY, that will fail if exceeding @timeout_ms.
- *
- * Returns: %TRUE if all the bytes was written
- *
- * Since: 1.2.2
- **/
-gboolean
-fu_io_channel_write_raw (FuIOChannel *self,
-			 const guint8 *data,
-			 gsize datasz,
-			 guint timeout_ms,
-			 FuIOChannelFlags flags,
-			 GError **error)
+static gboolean
+fu_io_channel_write_fd (FuIOChannel *self,
+			const guint8 *data,
+			gsize datasz,
+			guint timeout_ms,
+			FuIOChannelFlags flags,
+			GError **error)
 {
 	gsize idx = 0;
 
-	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), FALSE);
-
-	/* flush pending reads */
-	if (flags & FU_IO_CHANNEL_FLAG_FLUSH_INPUT) {
-		if (!fu_io_channel_flush_input (self, error))
-			return FALSE;
-	}
-
 	/* blocking IO */
 	if (flags & FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO) {
 		gssize wrote = write (self->fd, data, datasz);
@@ -229,66 +219,128 @@ fu_io_channel_write_raw (FuIOChannel *self,
 	return TRUE;
 }
 
+static gboolean
+fu_io_channel_write_internal (FuIOChannel *self,
+			      const guint8 *data,
+			      gsize datasz,
+			      guint timeout_ms,
+			      FuIOChannelFlags flags,
+			      GError **error)
+{
+	gint64 start_time = g_get_monotonic_time ();
+	g_autoptr(GError) error_local = NULL;
+
+	if (fu_io_recording_is_replay (self->io_recording)) {
+		g_autoptr(GBytes) blob = NULL;
+		blob = fu_io_recording_replay (self->io_recording, "tty-write",
+					       data, datasz, error);
+		return blob != NULL;
+	}
+	if (!fu_io_channel_write_fd (self, data, datasz, timeout_ms, flags, &error_local)) {
+		if (self->io_recording != NULL) {
+			fu_io_recording_add (self->io_recording, "tty-write",
+					     data, datasz, NULL, 0,
+					     error_local, start_time);
+		}
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	if (self->io_recording != NULL) {
+		fu_io_recording_add (self->io_recording, "tty-write",
+				     data, datasz, NULL, 0, NULL, start_time);
+	}
+	return TRUE;
+}
 
 /**
- * fu_io_channel_read_bytes:
+ * fu_io_channel_write_raw:
  * @self: a #FuIOChannel
- * @max_size: maximum size of the returned blob, or -1 for no limit
+ * @data: buffer to write
+ * @datasz: size of @data
  * @timeout_ms: timeout in ms
  * @flags: some #FuIOChannelFlags, e.g. %FU_IO_CHANNEL_FLAG_SINGLE_SHOT
  * @error: a #GError, or %NULL
  *
- * Reads bytes from the TTY, that will fail if exceeding @timeout_ms.
+ * Writes bytes to the TTY, that will fail if exceeding @timeout_ms.
  *
- * Returns: a #GBytes, or %NULL for error
+ * Returns: %TRUE if all the bytes was written
  *
  * Since: 1.2.2
  **/
-GBytes *
-fu_io_channel_read_bytes (FuIOChannel *self,
-			  gssize max_size,
-			  guint timeout_ms,
-			  FuIOChannelFlags flags,
-			  GError **error)
+gboolean
+fu_io_channel_write_raw (FuIOChannel *self,
+			 const guint8 *data,
+			 gsize datasz,
+			 guint timeout_ms,
+			 FuIOChannelFlags flags,
+			 GError **error)
 {
-	GByteArray *buf = fu_io_channel_read_byte_array (self,
-							 max_size,
-							 timeout_ms,
-							 flags,
-							 error);
-	if (buf == NULL)
-		return NULL;
-	return g_byte_array_free_to_bytes (buf);
+	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), FALSE);
+
+	/* flush pending reads */
+	if (flags & FU_IO_CHANNEL_FLAG_FLUSH_INPUT) {
+		if (!fu_io_channel_flush_input (self, error))
+			return FALSE;
+	}
+
+	/* send later in one write */
+	if (flags & FU_IO_CHANNEL_FLAG_BUFFER_WRITE) {
+		g_byte_array_append (self->wbuf, data, datasz);
+		return TRUE;
+	}
+	if (self->wbuf->len > 0) {
+		g_autoptr(GByteArray) wbuf = self->wbuf;
+		g_byte_array_append (wbuf, data, datasz);
+		self->wbuf = g_byte_array_new ();
+		return fu_io_channel_write_internal (self, wbuf->data, wbuf->len,
+						     timeout_ms, flags, error);
+	}
+	return fu_io_channel_write_internal (self, data, datasz, timeout_ms, flags, error);
 }
 
 /**
- * fu_io_channel_read_byte_array:
+ * fu_io_channel_flush:
  * @self: a #FuIOChannel
- * @max_size: maximum size of the returned blob, or -1 for no limit
  * @timeout_ms: timeout in ms
- * @flags: some #FuIOChannelFlags, e.g. %FU_IO_CHANNEL_FLAG_SINGLE_SHOT
  * @error: a #GError, or %NULL
  *
- * Reads bytes from the TTY, that will fail if exceeding @timeout_ms.
+ * Writes any data queued using %FU_IO_CHANNEL_FLAG_BUFFER_WRITE to the TTY.
+ * This is done automatically on the next unbuffered write or read.
  *
- * Returns: (transfer full): a #GByteArray, or %NULL for error
+ * Returns: %TRUE if all the queued bytes were written
  *
- * Since: 1.3.2
+ * Since: 1.5.0
  **/
-GByteArray *
-fu_io_channel_read_byte_array (FuIOChannel *self,
-			       gssize max_size,
-			       guint timeout_ms,
-			       FuIOChannelFlags flags,
-			       GError **error)
+gboolean
+fu_io_channel_flush (FuIOChannel *self, guint timeout_ms, GError **error)
+{
+	g_autoptr(GByteArray) wbuf = NULL;
+
+	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (self->wbuf->len == 0)
+		return TRUE;
+	wbuf = self->wbuf;
+	self->wbuf = g_byte_array_new ();
+	return fu_io_channel_write_internal (self, wbuf->data, wbuf->len,
+					     timeout_ms, FU_IO_CHANNEL_FLAG_NONE, error);
+}
+
+
+/* appends whatever can be read from the fd before the timeout to @buf2 */
+static gboolean
+fu_io_channel_read_fd (FuIOChannel *self,
+		       GByteArray *buf2,
+		       gssize max_size,
+		       guint timeout_ms,
+		       FuIOChannelFlags flags,
+		       GError **error)
 {
 	GPollFD fds = {
 		.fd = self->fd,
 		.events = G_IO_IN | G_IO_PRI | G_IO_ERR,
 	};
-	g_autoptr(GByteArray) buf2 = g_byte_array_new ();
-
-	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), NULL);
 
 	/* blocking IO */
 	if (flags & FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO) {
@@ -300,11 +352,11 @@ fu_io_channel_read_byte_array (FuIOChannel *self,
 				     FWUPD_ERROR_READ,
 				     "failed to read %i: %s", self->fd,
 				     strerror (errno));
-			return NULL;
+			return FALSE;
 		}
 		if (len > 0)
 			g_byte_array_append (buf2, buf, len);
-		return g_steal_pointer (&buf2);
+		return TRUE;
 	}
 
 	/* nonblocking IO */
@@ -316,7 +368,7 @@ fu_io_channel_read_byte_array (FuIOChannel *self,
 				     G_IO_ERROR,
 				     G_IO_ERROR_TIMED_OUT,
 				     "timeout");
-			return NULL;
+			return FALSE;
 		}
 		if (rc < 0) {
 			if (errno == EINTR)
@@ -325,7 +377,7 @@ fu_io_channel_read_byte_array (FuIOChannel *self,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_READ,
 				     "failed to poll %i", self->fd);
-			return NULL;
+			return FALSE;
 		}
 
 		/* we have data to read */
@@ -342,16 +394,16 @@ fu_io_channel_read_byte_array (FuIOChannel *self,
 					     FWUPD_ERROR_READ,
 					     "failed to read %i: %s", self->fd,
 					     strerror (errno));
-				return NULL;
+				return FALSE;
 			}
 			if (len > 0)
 				g_byte_array_append (buf2, buf, len);
 
 			/* check maximum size */
 			if (max_size > 0 && buf2->len >= (guint) max_size)
-				break;
+				return TRUE;
 			if (flags & FU_IO_CHANNEL_FLAG_SINGLE_SHOT)
-				break;
+				return TRUE;
 			continue;
 		}
 		if (fds.revents & G_IO_ERR) {
@@ -359,23 +411,131 @@ fu_io_channel_read_byte_array (FuIOChannel *self,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_READ,
 					     "error condition");
-			return NULL;
+			return FALSE;
 		}
 		if (fds.revents & G_IO_HUP) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_READ,
 					     "connection hung up");
-			return NULL;
+			return FALSE;
 		}
 		if (fds.revents & G_IO_NVAL) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_READ,
 					     "invalid request");
+			return FALSE;
+		}
+	}
+}
+
+/**
+ * fu_io_channel_read_bytes:
+ * @self: a #FuIOChannel
+ * @max_size: maximum size of the returned blob, or -1 for no limit
+ * @timeout_ms: timeout in ms
+ * @flags: some #FuIOChannelFlags, e.g. %FU_IO_CHANNEL_FLAG_SINGLE_SHOT
+ * @error: a #GError, or %NULL
+ *
+ * Reads bytes from the TTY, that will fail if exceeding @timeout_ms.
+ *
+ * Returns: a #GBytes, or %NULL for error
+ *
+ * Since: 1.2.2
+ **/
+GBytes *
+fu_io_channel_read_bytes (FuIOChannel *self,
+			  gssize max_size,
+			  guint timeout_ms,
+			  FuIOChannelFlags flags,
+			  GError **error)
+{
+	GByteArray *buf = fu_io_channel_read_byte_array (self,
+							 max_size,
+							 timeout_ms,
+							 flags,
+							 error);
+	if (buf == NULL)
+		return NULL;
+	return g_byte_array_free_to_bytes (buf);
+}
+
+/**
+ * fu_io_channel_read_byte_array:
+ * @self: a #FuIOChannel
+ * @max_size: maximum size of the returned blob, or -1 for no limit
+ * @timeout_ms: timeout in ms
+ * @flags: some #FuIOChannelFlags, e.g. %FU_IO_CHANNEL_FLAG_SINGLE_SHOT
+ * @error: a #GError, or %NULL
+ *
+ * Reads bytes from the TTY, that will fail if exceeding @timeout_ms.
+ *
+ * Returns: (transfer full): a #GByteArray, or %NULL for error
+ *
+ * Since: 1.3.2
+ **/
+GByteArray *
+fu_io_channel_read_byte_array (FuIOChannel *self,
+			       gssize max_size,
+			       guint timeout_ms,
+			       FuIOChannelFlags flags,
+			       GError **error)
+{
+	g_autoptr(GByteArray) buf2 = g_byte_array_new ();
+
+	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), NULL);
+
+	/* send any queued request */
+	if (!fu_io_channel_flush (self, timeout_ms, error))
+		return NULL;
+
+	/* already received by fu_io_channel_read_until() */
+	if (self->rbuf->len > 0) {
+		guint len = self->rbuf->len;
+		if (max_size > 0)
+			len = MIN (len, (guint) max_size);
+		g_byte_array_append (buf2, self->rbuf->data, len);
+		g_byte_array_remove_range (self->rbuf, 0, len);
+		if (max_size > 0 && buf2->len >= (guint) max_size)
+			return g_steal_pointer (&buf2);
+		if (flags & (FU_IO_CHANNEL_FLAG_SINGLE_SHOT |
+			     FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO))
+			return g_steal_pointer (&buf2);
+	}
+
+	/* answered from a recording */
+	if (fu_io_recording_is_replay (self->io_recording)) {
+		g_autoptr(GBytes) blob = NULL;
+		blob = fu_io_recording_replay (self->io_recording, "tty-read",
+					       NULL, 0, error);
+		if (blob == NULL)
+			return NULL;
+		g_byte_array_append (buf2,
+				     g_bytes_get_data (blob, NULL),
+				     g_bytes_get_size (blob));
+	} else {
+		guint offset = buf2->len;
+		gint64 start_time = g_get_monotonic_time ();
+		gboolean ret;
+		g_autoptr(GError) error_local = NULL;
+
+		ret = fu_io_channel_read_fd (self, buf2, max_size,
+					     timeout_ms, flags, &error_local);
+		if (self->io_recording != NULL) {
+			fu_io_recording_add (self->io_recording, "tty-read",
+					     NULL, 0,
+					     buf2->data + offset,
+					     buf2->len - offset,
+					     error_local, start_time);
+		}
+		if (!ret) {
+			g_propagate_error (error, g_steal_pointer (&error_local));
 			return NULL;
 		}
 	}
+	if (flags & FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO)
+		return g_steal_pointer (&buf2);
 
 	/* no data */
 	if (buf2->len == 0) {
@@ -433,12 +593,226 @@ fu_io_channel_read_raw (FuIOChannel *self,
 	return TRUE;
 }
 
+static gboolean
+fu_io_channel_wait_fd (FuIOChannel *self, GPollFD *fds, gint timeout_ms, GError **error)
+{
+	while (TRUE) {
+		gint rc = g_poll (fds, 1, timeout_ms);
+		if (rc == 0) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_TIMED_OUT,
+				     "timeout");
+			return FALSE;
+		}
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "failed to poll %i", self->fd);
+			return FALSE;
+		}
+		return TRUE;
+	}
+}
+
+static gboolean
+fu_io_channel_fill_fd (FuIOChannel *self, gint64 deadline, FuIOChannelFlags flags, GError **error)
+{
+	guint8 buf[FU_IO_CHANNEL_READ_BLOCK_SIZE];
+	gssize len;
+	GPollFD fds = {
+		.fd = self->fd,
+		.events = G_IO_IN | G_IO_PRI | G_IO_ERR,
+	};
+
+	if ((flags & FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO) == 0) {
+		gint64 remaining = deadline - g_get_monotonic_time ();
+		if (!fu_io_channel_wait_fd (self, &fds, MAX (remaining / 1000, 0), error))
+			return FALSE;
+		if ((fds.revents & G_IO_IN) == 0) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     fds.revents & G_IO_HUP ?
+					     "connection hung up" :
+					     "error condition");
+			return FALSE;
+		}
+	}
+	len = read (self->fd, buf, sizeof(buf));
+	if (len < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return TRUE;
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_READ,
+			     "failed to read %i: %s", self->fd,
+			     strerror (errno));
+		return FALSE;
+	}
+	if (len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "connection hung up");
+		return FALSE;
+	}
+	g_byte_array_append (self->rbuf, buf, len);
+	return TRUE;
+}
+
+/* appends whatever is available to the read buffer */
+static gboolean
+fu_io_channel_fill (FuIOChannel *self, gint64 deadline, FuIOChannelFlags flags, GError **error)
+{
+	guint offset = self->rbuf->len;
+	gint64 start_time = g_get_monotonic_time ();
+	gboolean ret;
+	g_autoptr(GError) error_local = NULL;
+
+	if (fu_io_recording_is_replay (self->io_recording)) {
+		g_autoptr(GBytes) blob = NULL;
+		blob = fu_io_recording_replay (self->io_recording, "tty-read",
+					       NULL, 0, error);
+		if (blob == NULL)
+			return FALSE;
+		g_byte_array_append (self->rbuf,
+				     g_bytes_get_data (blob, NULL),
+				     g_bytes_get_size (blob));
+		return TRUE;
+	}
+	ret = fu_io_channel_fill_fd (self, deadline, flags, &error_local);
+	if (self->io_recording != NULL) {
+		fu_io_recording_add (self->io_recording, "tty-read", NULL, 0,
+				     self->rbuf->data + offset,
+				     self->rbuf->len - offset,
+				     error_local, start_time);
+	}
+	if (!ret) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gssize
+fu_io_channel_find_delim (GByteArray *buf, gsize offset, const guint8 *delim, gsize delimsz)
+{
+	if (buf->len < delimsz)
+		return -1;
+	for (gsize i = offset; i <= buf->len - delimsz; i++) {
+		if (memcmp (buf->data + i, delim, delimsz) == 0)
+			return i + delimsz;
+	}
+	return -1;
+}
+
+/**
+ * fu_io_channel_read_until:
+ * @self: a #FuIOChannel
+ * @delim: (nullable): delimiter, e.g. `\n`, or %NULL
+ * @delimsz: size of @delim
+ * @max_size: maximum size of the returned data
+ * @timeout_ms: timeout in ms for the entire response
+ * @flags: some #FuIOChannelFlags, e.g. %FU_IO_CHANNEL_FLAG_NONE
+ * @error: a #GError, or %NULL
+ *
+ * Reads bytes from the TTY up to and including @delim, or exactly @max_size
+ * bytes if @delim is %NULL. Any data received after the response is kept
+ * and returned by the next read, which means line-oriented protocols do not
+ * need a poll and read for each small response.
+ *
+ * Returns: (transfer full): a #GByteArray, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GByteArray *
+fu_io_channel_read_until (FuIOChannel *self,
+			  const guint8 *delim,
+			  gsize delimsz,
+			  gsize max_size,
+			  guint timeout_ms,
+			  FuIOChannelFlags flags,
+			  GError **error)
+{
+	gint64 deadline = g_get_monotonic_time () + (gint64) timeout_ms * 1000;
+	gsize offset = 0;
+	gsize len = 0;
+	GByteArray *buf;
+
+	g_return_val_if_fail (FU_IS_IO_CHANNEL (self), NULL);
+	g_return_val_if_fail (delim == NULL || delimsz > 0, NULL);
+	g_return_val_if_fail (max_size > 0, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* send the request first */
+	if (!fu_io_channel_flush (self, timeout_ms, error))
+		return NULL;
+
+	while (TRUE) {
+		gssize idx = -1;
+		if (delim != NULL) {
+			idx = fu_io_channel_find_delim (self->rbuf, offset, delim, delimsz);
+			if (idx < 0 && self->rbuf->len >= delimsz)
+				offset = self->rbuf->len - delimsz + 1;
+		}
+		if (idx >= 0 && (gsize) idx <= max_size) {
+			len = idx;
+			break;
+		}
+		if (self->rbuf->len >= max_size) {
+			if (delim != NULL) {
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "no delimiter found in %" G_GSIZE_FORMAT " bytes",
+					     max_size);
+				return NULL;
+			}
+			len = max_size;
+			break;
+		}
+		if (!fu_io_channel_fill (self, deadline, flags, error))
+			return NULL;
+	}
+
+	/* keep the rest for next time */
+	buf = g_byte_array_sized_new (len);
+	g_byte_array_append (buf, self->rbuf->data, len);
+	g_byte_array_remove_range (self->rbuf, 0, len);
+	return buf;
+}
+
+/**
+ * fu_io_channel_set_io_recording:
+ * @self: a #FuIOChannel
+ * @io_recording: (nullable): a #FuIoRecording
+ *
+ * Saves all the reads and writes to @io_recording, or answers them from it if
+ * the recording was loaded from a file.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_io_channel_set_io_recording (FuIOChannel *self, FuIoRecording *io_recording)
+{
+	g_return_if_fail (FU_IS_IO_CHANNEL (self));
+	g_set_object (&self->io_recording, io_recording);
+}
+
 static void
 fu_io_channel_finalize (GObject *object)
 {
 	FuIOChannel *self = FU_IO_CHANNEL (object);
 	if (self->fd != -1)
 		g_close (self->fd, NULL);
+	g_byte_array_unref (self->rbuf);
+	g_byte_array_unref (self->wbuf);
+	if (self->io_recording != NULL)
+		g_object_unref (self->io_recording);
 	G_OBJECT_CLASS (fu_io_channel_parent_class)->finalize (object);
 }
 
@@ -453,6 +827,8 @@ static void
 fu_io_channel_init (FuIOChannel *self)
 {
 	self->fd = -1;
+	self->rbuf = g_byte_array_new ();
+	self->wbuf = g_byte_array_new ();
 }
 
 /**
@@ -8,6 +8,8 @@
 
 #include <glib-object.h>
 
+#include "fu-io-recording.h"
+
 #define FU_TYPE_IO_CHANNEL (fu_io_channel_get_type ())
 
 G_DECLARE_FINAL_TYPE (FuIOChannel, fu_io_channel, FU, IO_CHANNEL, GObject)
@@ -18,6 +20,7 @@ G_DECLARE_FINAL_TYPE (FuIOChannel, fu_io_channel, FU, IO_CHANNEL, GObject)
  * @FU_IO_CHANNEL_FLAG_SINGLE_SHOT:		Only one read or write is expected
  * @FU_IO_CHANNEL_FLAG_FLUSH_INPUT:		Flush pending input before writing
  * @FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO:		Block waiting for the TTY
+ * @FU_IO_CHANNEL_FLAG_BUFFER_WRITE:		Queue the write until the next unbuffered write, read or flush
  *
  * The flags used when reading data from the TTY.
  **/
@@ -26,6 +29,7 @@ typedef enum {
 	FU_IO_CHANNEL_FLAG_SINGLE_SHOT		= 1 << 0,	/* Since: 1.2.2 */
 	FU_IO_CHANNEL_FLAG_FLUSH_INPUT		= 1 << 1,	/* Since: 1.2.2 */
 	FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO	= 1 << 2,	/* Since: 1.2.2 */
+	FU_IO_CHANNEL_FLAG_BUFFER_WRITE		= 1 << 3,	/* Since: 1.5.0 */
 	/*< private >*/
 	FU_IO_CHANNEL_FLAG_LAST
 } FuIOChannelFlags;
@@ -35,6 +39,8 @@ FuIOChannel	*fu_io_channel_new_file		(const gchar	*filename,
 						 GError		**error);
 
 gint		 fu_io_channel_unix_get_fd	(FuIOChannel	*self);
+void		 fu_io_channel_set_io_recording	(FuIOChannel	*self,
+						 FuIoRecording	*io_recording);
 gboolean	 fu_io_channel_shutdown		(FuIOChannel	*self,
 						 GError		**error);
 gboolean	 fu_io_channel_write_raw	(FuIOChannel	*self,
@@ -70,3 +76,13 @@ GByteArray	*fu_io_channel_read_byte_array	(FuIOChannel	*self,
 						 guint		 timeout_ms,
 						 FuIOChannelFlags flags,
 						 GError		**error);
+GByteArray	*fu_io_channel_read_until	(FuIOChannel	*self,
+						 const guint8	*delim,
+						 gsize		 delimsz,
+						 gsize		 max_size,
+						 guint		 timeout_ms,
+						 FuIOChannelFlags flags,
+						 GError		**error);
+gboolean	 fu_io_channel_flush		(FuIOChannel	*self,
+						 guint		 timeout_ms,
+						 GError		**error);
@@ -0,0 +1,532 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuIoRecording"
+
+#include "config.h"
+
+#include <string.h>
+
+#include "fu-common.h"
+#include "fu-io-recording.h"
+
+#include "fwupd-error.h"
+
+/**
+ * SECTION:fu-io-recording
+ * @short_description: record and replay device I/O
+ *
+ * A recording captures each USB transfer, ioctl, pread, pwrite and TTY
+ * transfer made by a device, along with how long the device took to respond.
+ * The recording can then be loaded and attached to a device that is not
+ * physically present, in which case each request is checked against what
+ * was recorded and the recorded response is returned after the original
+ * latency, optionally scaled.
+ *
+ * This allows the update path of a plugin to be benchmarked without the
+ * hardware, and the time spent in the host to be measured separately from
+ * the time spent waiting for the device.
+ *
+ * See also: #FuDevice, #FuIOChannel
+ */
+
+typedef struct {
+	gchar			*id;
+	guint64			 timestamp;	/* us since the first event */
+	guint64			 duration;	/* us */
+	GBytes			*tx;
+	GBytes			*rx;
+	gchar			*error_domain;	/* nullable */
+	gint			 error_code;
+	gchar			*error_message;	/* nullable */
+} FuIoRecordingEvent;
+
+struct _FuIoRecording {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* for everything below */
+	FuIoRecordingMode	 mode;
+	GPtrArray		*events;	/* (element-type FuIoRecordingEvent) */
+	guint			 idx;		/* next event to replay */
+	gdouble			 latency_scale;
+	gint64			 time_first;	/* monotonic, us */
+	gint64			 time_last;	/* monotonic, us */
+	guint64			 device_time;	/* us */
+};
+
+G_DEFINE_TYPE (FuIoRecording, fu_io_recording, G_TYPE_OBJECT)
+
+#define FU_IO_RECORDING_FORMAT		"a(sttayaysis)"
+
+static void
+fu_io_recording_event_free (FuIoRecordingEvent *event)
+{
+	g_free (event->id);
+	g_bytes_unref (event->tx);
+	g_bytes_unref (event->rx);
+	g_free (event->error_domain);
+	g_free (event->error_message);
+	g_free (event);
+}
+
+/**
+ * fu_io_recording_get_mode:
+ * @self: A #FuIoRecording
+ *
+ * Gets the recording mode.
+ *
+ * Returns: a #FuIoRecordingMode, e.g. %FU_IO_RECORDING_MODE_REPLAY
+ *
+ * Since: 1.5.0
+ **/
+FuIoRecordingMode
+fu_io_recording_get_mode (FuIoRecording *self)
+{
+	g_return_val_if_fail (FU_IS_IO_RECORDING (self), FU_IO_RECORDING_MODE_LAST);
+	return self->mode;
+}
+
+/**
+ * fu_io_recording_is_replay:
+ * @self: (nullable): A #FuIoRecording
+ *
+ * Checks if device I/O should be answered from the recording rather than by
+ * the hardware.
+ *
+ * Returns: %TRUE if @self is set and has been loaded
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_io_recording_is_replay (FuIoRecording *self)
+{
+	return self != NULL && self->mode == FU_IO_RECORDING_MODE_REPLAY;
+}
+
+/**
+ * fu_io_recording_set_latency_scale:
+ * @self: A #FuIoRecording
+ * @latency_scale: a multiplier, where 0.0 does not wait at all
+ *
+ * Sets how much of the recorded device latency to wait for when replaying.
+ * The default of 1.0 replays with the original timing.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_io_recording_set_latency_scale (FuIoRecording *self, gdouble latency_scale)
+{
+	g_return_if_fail (FU_IS_IO_RECORDING (self));
+	g_return_if_fail (latency_scale >= 0.f);
+	self->latency_scale = latency_scale;
+}
+
+/**
+ * fu_io_recording_get_size:
+ * @self: A #FuIoRecording
+ *
+ * Gets the number of recorded events.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_io_recording_get_size (FuIoRecording *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_return_val_if_fail (FU_IS_IO_RECORDING (self), 0);
+	locker = g_mutex_locker_new (&self->mutex);
+	return self->events->len;
+}
+
+/**
+ * fu_io_recording_add:
+ * @self: A #FuIoRecording
+ * @id: a request identifier, e.g. `ioctl:0x5401`
+ * @tx: (nullable): data sent to the device
+ * @txsz: size of @tx
+ * @rx: (nullable): data received from the device
+ * @rxsz: size of @rx
+ * @error: (nullable): the error returned by the request
+ * @start_time: the monotonic time when the request was started
+ *
+ * Records a request made to the device. This does nothing when replaying.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_io_recording_add (FuIoRecording *self,
+		     const gchar *id,
+		     const guint8 *tx,
+		     gsize txsz,
+		     const guint8 *rx,
+		     gsize rxsz,
+		     const GError *error,
+		     gint64 start_time)
+{
+	FuIoRecordingEvent *event;
+	gint64 now = g_get_monotonic_time ();
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_IO_RECORDING (self));
+	g_return_if_fail (id != NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	if (self->mode != FU_IO_RECORDING_MODE_RECORD)
+		return;
+	if (self->events->len == 0)
+		self->time_first = start_time;
+	event = g_new0 (FuIoRecordingEvent, 1);
+	event->id = g_strdup (id);
+	event->timestamp = start_time - self->time_first;
+	event->duration = now - start_time;
+	event->tx = g_bytes_new (tx, tx != NULL ? txsz : 0);
+	event->rx = g_bytes_new (rx, rx != NULL ? rxsz : 0);
+	if (error != NULL) {
+		event->error_domain = g_strdup (g_quark_to_string (error->domain));
+		event->error_code = error->code;
+		event->error_message = g_strdup (error->message);
+	}
+	g_ptr_array_add (self->events, event);
+	self->time_last = now;
+	self->device_time += event->duration;
+}
+
+/**
+ * fu_io_recording_replay:
+ * @self: A #FuIoRecording
+ * @id: a request identifier, e.g. `ioctl:0x5401`
+ * @tx: (nullable): data sent to the device
+ * @txsz: size of @tx
+ * @error: A #GError, or %NULL
+ *
+ * Answers a request from the recording. The request must be the same as the
+ * next recorded event, and the response is returned after the recorded
+ * latency multiplied by the latency scale.
+ *
+ * Returns: (transfer full): the data received from the device, or %NULL if
+ * the recorded request failed or the request was not expected
+ *
+ * Since: 1.5.0
+ **/
+GBytes *
+fu_io_recording_replay (FuIoRecording *self,
+			const gchar *id,
+			const guint8 *tx,
+			gsize txsz,
+			GError **error)
+{
+	FuIoRecordingEvent *event;
+	guint64 sleep_us;
+	g_autoptr(GBytes) tx_blob = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_IO_RECORDING (self), NULL);
+	g_return_val_if_fail (id != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	if (self->mode != FU_IO_RECORDING_MODE_REPLAY) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "recording not loaded");
+		return NULL;
+	}
+	if (self->idx >= self->events->len) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "no more recorded events, but got %s", id);
+		return NULL;
+	}
+	event = g_ptr_array_index (self->events, self->idx);
+	if (g_strcmp0 (event->id, id) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_DATA,
+			     "event %u expected %s, but got %s",
+			     self->idx, event->id, id);
+		return NULL;
+	}
+	tx_blob = g_bytes_new_static (tx, tx != NULL ? txsz : 0);
+	if (!g_bytes_equal (event->tx, tx_blob)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_DATA,
+			     "event %u %s sent different data than recorded",
+			     self->idx, id);
+		return NULL;
+	}
+	if (self->idx == 0)
+		self->time_first = g_get_monotonic_time ();
+	self->idx++;
+	sleep_us = event->duration * self->latency_scale;
+	self->device_time += sleep_us;
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	/* wait like the device did */
+	if (sleep_us > 0)
+		g_usleep (sleep_us);
+	g_mutex_lock (&self->mutex);
+	self->time_last = g_get_monotonic_time ();
+	g_mutex_unlock (&self->mutex);
+
+	if (event->error_domain != NULL) {
+		g_set_error_literal (error,
+				     g_quark_from_string (event->error_domain),
+				     event->error_code,
+				     event->error_message);
+		return NULL;
+	}
+	return g_bytes_ref (event->rx);
+}
+
+/**
+ * fu_io_recording_replay_full:
+ * @self: A #FuIoRecording
+ * @id: a request identifier, e.g. `ioctl:0x5401`
+ * @tx: (nullable): data sent to the device
+ * @txsz: size of @tx
+ * @rx: (nullable): buffer for data received from the device
+ * @rxsz: size of @rx
+ * @rx_actual: (out) (nullable): number of bytes copied into @rx
+ * @error: A #GError, or %NULL
+ *
+ * Answers a request from the recording, copying the response into @rx.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_io_recording_replay_full (FuIoRecording *self,
+			     const gchar *id,
+			     const guint8 *tx,
+			     gsize txsz,
+			     guint8 *rx,
+			     gsize rxsz,
+			     gsize *rx_actual,
+			     GError **error)
+{
+	const guint8 *buf;
+	gsize bufsz = 0;
+	g_autoptr(GBytes) blob = NULL;
+
+	blob = fu_io_recording_replay (self, id, tx, txsz, error);
+	if (blob == NULL)
+		return FALSE;
+	buf = g_bytes_get_data (blob, &bufsz);
+	if (bufsz > rxsz) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_DATA,
+			     "%s recorded 0x%x bytes but buffer is 0x%x bytes",
+			     id, (guint) bufsz, (guint) rxsz);
+		return FALSE;
+	}
+	if (bufsz > 0)
+		memcpy (rx, buf, bufsz);
+	if (rx_actual != NULL)
+		*rx_actual = bufsz;
+	return TRUE;
+}
+
+/**
+ * fu_io_recording_load:
+ * @self: A #FuIoRecording
+ * @filename: a recording created with fu_io_recording_save()
+ * @error: A #GError, or %NULL
+ *
+ * Loads a recording, after which all device I/O is answered from the file.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_io_recording_load (FuIoRecording *self, const gchar *filename, GError **error)
+{
+	GVariantIter iter;
+	const gchar *id = NULL;
+	const gchar *error_domain = NULL;
+	const gchar *error_message = NULL;
+	gint32 error_code = 0;
+	guint64 timestamp = 0;
+	guint64 duration = 0;
+	GVariant *tx_val = NULL;
+	GVariant *rx_val = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FU_IS_IO_RECORDING (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	blob = fu_common_get_contents_bytes (filename, error);
+	if (blob == NULL)
+		return FALSE;
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (FU_IO_RECORDING_FORMAT),
+							    blob, FALSE));
+	if (!g_variant_is_normal_form (val)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid recording %s",
+			     filename);
+		return FALSE;
+	}
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_ptr_array_set_size (self->events, 0);
+	g_variant_iter_init (&iter, val);
+	while (g_variant_iter_next (&iter, "(&stt@ay@ay&si&s)",
+				    &id, &timestamp, &duration,
+				    &tx_val, &rx_val,
+				    &error_domain, &error_code, &error_message)) {
+		FuIoRecordingEvent *event = g_new0 (FuIoRecordingEvent, 1);
+		event->id = g_strdup (id);
+		event->timestamp = timestamp;
+		event->duration = duration;
+		event->tx = g_variant_get_data_as_bytes (tx_val);
+		event->rx = g_variant_get_data_as_bytes (rx_val);
+		if (error_domain[0] != '\0') {
+			event->error_domain = g_strdup (error_domain);
+			event->error_code = error_code;
+			event->error_message = g_strdup (error_message);
+		}
+		g_ptr_array_add (self->events, event);
+		g_variant_unref (tx_val);
+		g_variant_unref (rx_val);
+	}
+	self->mode = FU_IO_RECORDING_MODE_REPLAY;
+	self->idx = 0;
+	self->device_time = 0;
+	return TRUE;
+}
+
+/**
+ * fu_io_recording_save:
+ * @self: A #FuIoRecording
+ * @filename: a filename
+ * @error: A #GError, or %NULL
+ *
+ * Saves all the recorded events.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_io_recording_save (FuIoRecording *self, const gchar *filename, GError **error)
+{
+	GVariantBuilder builder;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FU_IS_IO_RECORDING (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (FU_IO_RECORDING_FORMAT));
+	for (guint i = 0; i < self->events->len; i++) {
+		FuIoRecordingEvent *event = g_ptr_array_index (self->events, i);
+		g_variant_builder_add (&builder, "(stt@ay@aysis)",
+				       event->id,
+				       event->timestamp,
+				       event->duration,
+				       g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING,
+								 event->tx, TRUE),
+				       g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING,
+								 event->rx, TRUE),
+				       event->error_domain != NULL ? event->error_domain : "",
+				       event->error_code,
+				       event->error_message != NULL ? event->error_message : "");
+	}
+	val = g_variant_ref_sink (g_variant_builder_end (&builder));
+	blob = g_variant_get_data_as_bytes (val);
+	if (!fu_common_mkdir_parent (filename, error))
+		return FALSE;
+	return fu_common_set_contents_bytes (filename, blob, error);
+}
+
+/**
+ * fu_io_recording_to_string:
+ * @self: A #FuIoRecording
+ *
+ * Summarizes the time spent waiting for the device and the time spent in the
+ * host between requests.
+ *
+ * Returns: (transfer full): a string
+ *
+ * Since: 1.5.0
+ **/
+gchar *
+fu_io_recording_to_string (FuIoRecording *self)
+{
+	guint64 elapsed = 0;
+	guint cnt;
+	GString *str = g_string_new (NULL);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_IO_RECORDING (self), NULL);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	cnt = self->mode == FU_IO_RECORDING_MODE_REPLAY ? self->idx : self->events->len;
+	if (cnt > 0 && self->time_last > self->time_first)
+		elapsed = self->time_last - self->time_first;
+	fu_common_string_append_kv (str, 0, "Mode",
+				    self->mode == FU_IO_RECORDING_MODE_REPLAY ? "replay" : "record");
+	fu_common_string_append_ku (str, 0, "Events", cnt);
+	fu_common_string_append_ku (str, 0, "ElapsedUs", elapsed);
+	fu_common_string_append_ku (str, 0, "DeviceUs", self->device_time);
+	fu_common_string_append_ku (str, 0, "HostUs",
+				    elapsed > self->device_time ? elapsed - self->device_time : 0);
+	return g_string_free (str, FALSE);
+}
+
+static void
+fu_io_recording_init (FuIoRecording *self)
+{
+	g_mutex_init (&self->mutex);
+	self->latency_scale = 1.f;
+	self->events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_io_recording_event_free);
+}
+
+static void
+fu_io_recording_finalize (GObject *obj)
+{
+	FuIoRecording *self = FU_IO_RECORDING (obj);
+	g_ptr_array_unref (self->events);
+	g_mutex_clear (&self->mutex);
+	G_OBJECT_CLASS (fu_io_recording_parent_class)->finalize (obj);
+}
+
+static void
+fu_io_recording_class_init (FuIoRecordingClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_io_recording_finalize;
+}
+
+/**
+ * fu_io_recording_new:
+ *
+ * Creates a new recording, which records device I/O until a recording is
+ * loaded using fu_io_recording_load().
+ *
+ * Returns: a #FuIoRecording
+ *
+ * Since: 1.5.0
+ **/
+FuIoRecording *
+fu_io_recording_new (void)
+{
+	return FU_IO_RECORDING (g_object_new (FU_TYPE_IO_RECORDING, NULL));
+}
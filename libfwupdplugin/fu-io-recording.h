@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_IO_RECORDING (fu_io_recording_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuIoRecording, fu_io_recording, FU, IO_RECORDING, GObject)
+
+/**
+ * FuIoRecordingMode:
+ * @FU_IO_RECORDING_MODE_RECORD:	Device I/O is performed and saved
+ * @FU_IO_RECORDING_MODE_REPLAY:	Device I/O is answered from the recording
+ *
+ * The mode of the recording.
+ **/
+typedef enum {
+	FU_IO_RECORDING_MODE_RECORD,		/* Since: 1.5.0 */
+	FU_IO_RECORDING_MODE_REPLAY,		/* Since: 1.5.0 */
+	/*< private >*/
+	FU_IO_RECORDING_MODE_LAST
+} FuIoRecordingMode;
+
+FuIoRecording	*fu_io_recording_new			(void);
+FuIoRecordingMode fu_io_recording_get_mode		(FuIoRecording	*self);
+gboolean	 fu_io_recording_is_replay		(FuIoRecording	*self);
+void		 fu_io_recording_set_latency_scale	(FuIoRecording	*self,
+							 gdouble	 latency_scale);
+guint		 fu_io_recording_get_size		(FuIoRecording	*self);
+gboolean	 fu_io_recording_load			(FuIoRecording	*self,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 fu_io_recording_save			(FuIoRecording	*self,
+							 const gchar	*filename,
+							 GError		**error);
+gchar		*fu_io_recording_to_string		(FuIoRecording	*self);
+
+/* for device classes */
+void		 fu_io_recording_add			(FuIoRecording	*self,
+							 const gchar	*id,
+							 const guint8	*tx,
+							 gsize		 txsz,
+							 const guint8	*rx,
+							 gsize		 rxsz,
+							 const GError	*error,
+							 gint64		 start_time);
+GBytes		*fu_io_recording_replay			(FuIoRecording	*self,
+							 const gchar	*id,
+							 const guint8	*tx,
+							 gsize		 txsz,
+							 GError		**error);
+gboolean	 fu_io_recording_replay_full		(FuIoRecording	*self,
+							 const gchar	*id,
+							 const guint8	*tx,
+							 gsize		 txsz,
+							 guint8		*rx,
+							 gsize		 rxsz,
+							 gsize		*rx_actual,
+							 GError		**error);
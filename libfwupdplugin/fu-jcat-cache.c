@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuJcatCache"
+
+#include "config.h"
+
+#include "fu-common.h"
+#include "fu-jcat-cache.h"
+#include "fu-metrics.h"
+
+/**
+ * SECTION:fu-jcat-cache
+ * @short_description: a cache of verified Jcat signatures
+ *
+ * Verifying a GPG or PKCS#7 signature is expensive, and the same metadata
+ * and archives are verified again each time the daemon is started. This
+ * object remembers the blobs that were successfully verified, and is
+ * invalidated when the trusted public keys change.
+ */
+
+#define FU_JCAT_CACHE_GROUP_FWUPD		"fwupd"
+#define FU_JCAT_CACHE_MAX_ENTRIES		256
+
+struct _FuJcatCache {
+	GObject			 parent_instance;
+	GMutex			 mutex;		/* for keyfile */
+	GKeyFile		*keyfile;
+	gchar			*filename;	/* (nullable) */
+};
+
+G_DEFINE_TYPE (FuJcatCache, fu_jcat_cache, G_TYPE_OBJECT)
+
+static void
+fu_jcat_cache_finalize (GObject *obj)
+{
+	FuJcatCache *self = FU_JCAT_CACHE (obj);
+	g_key_file_unref (self->keyfile);
+	g_free (self->filename);
+	g_mutex_clear (&self->mutex);
+	G_OBJECT_CLASS (fu_jcat_cache_parent_class)->finalize (obj);
+}
+
+static void
+fu_jcat_cache_class_init (FuJcatCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_jcat_cache_finalize;
+}
+
+static void
+fu_jcat_cache_init (FuJcatCache *self)
+{
+	g_mutex_init (&self->mutex);
+	self->keyfile = g_key_file_new ();
+}
+
+/* the signatures are part of the key, so a re-signed blob is verified again */
+static gchar *
+fu_jcat_cache_get_key (GBytes *blob, JcatItem *item, JcatVerifyFlags flags)
+{
+	guint8 buf[4] = { 0x0 };
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_autoptr(GPtrArray) blobs = jcat_item_get_blobs (item);
+
+	g_checksum_update (csum,
+			   g_bytes_get_data (blob, NULL),
+			   g_bytes_get_size (blob));
+	fu_common_write_uint32 (buf, flags, G_LITTLE_ENDIAN);
+	g_checksum_update (csum, buf, sizeof(buf));
+	for (guint i = 0; i < blobs->len; i++) {
+		JcatBlob *jcat_blob = g_ptr_array_index (blobs, i);
+		GBytes *data = jcat_blob_get_data (jcat_blob);
+		fu_common_write_uint32 (buf, jcat_blob_get_kind (jcat_blob), G_LITTLE_ENDIAN);
+		g_checksum_update (csum, buf, sizeof(buf));
+		g_checksum_update (csum,
+				   g_bytes_get_data (data, NULL),
+				   g_bytes_get_size (data));
+	}
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static gboolean
+fu_jcat_cache_save (FuJcatCache *self, GError **error)
+{
+	if (self->filename == NULL)
+		return TRUE;
+	if (!fu_common_mkdir_parent (self->filename, error))
+		return FALSE;
+	return g_key_file_save_to_file (self->keyfile, self->filename, error);
+}
+
+/**
+ * fu_jcat_cache_load:
+ * @self: A #FuJcatCache
+ * @filename: A filename, typically in the package state directory
+ * @keyring_id: A string that changes when the trusted keys change
+ * @error: A #GError, or %NULL
+ *
+ * Loads the previously verified results. If the results were saved using
+ * a different @keyring_id then all the results are discarded.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_jcat_cache_load (FuJcatCache *self,
+		    const gchar *filename,
+		    const gchar *keyring_id,
+		    GError **error)
+{
+	g_autofree gchar *keyring_id_old = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_JCAT_CACHE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (keyring_id != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	locker = g_mutex_locker_new (&self->mutex);
+	g_free (self->filename);
+	self->filename = g_strdup (filename);
+	if (g_file_test (filename, G_FILE_TEST_EXISTS)) {
+		if (!g_key_file_load_from_file (self->keyfile, filename,
+						G_KEY_FILE_NONE, error))
+			return FALSE;
+		keyring_id_old = g_key_file_get_string (self->keyfile,
+							FU_JCAT_CACHE_GROUP_FWUPD,
+							"KeyringId", NULL);
+	}
+
+	/* trusted keys added or removed, so nothing can be trusted */
+	if (g_strcmp0 (keyring_id_old, keyring_id) != 0) {
+		if (keyring_id_old != NULL)
+			g_debug ("trusted keys changed, invalidating cache");
+		g_key_file_unref (self->keyfile);
+		self->keyfile = g_key_file_new ();
+		g_key_file_set_string (self->keyfile,
+				       FU_JCAT_CACHE_GROUP_FWUPD,
+				       "KeyringId", keyring_id);
+		if (keyring_id_old != NULL)
+			return fu_jcat_cache_save (self, error);
+	}
+	return TRUE;
+}
+
+/**
+ * fu_jcat_cache_lookup:
+ * @self: A #FuJcatCache
+ * @blob: The data that was signed
+ * @item: A #JcatItem with the signatures for @blob
+ * @flags: The #JcatVerifyFlags used for verification
+ * @timestamp: (out) (nullable): The newest signing timestamp
+ *
+ * Finds out if @blob was previously verified using the same signatures.
+ *
+ * Returns: %TRUE if found
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_jcat_cache_lookup (FuJcatCache *self,
+		      GBytes *blob,
+		      JcatItem *item,
+		      JcatVerifyFlags flags,
+		      gint64 *timestamp)
+{
+	g_autofree gchar *key = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_JCAT_CACHE (self), FALSE);
+	g_return_val_if_fail (blob != NULL, FALSE);
+	g_return_val_if_fail (JCAT_IS_ITEM (item), FALSE);
+
+	key = fu_jcat_cache_get_key (blob, item, flags);
+	locker = g_mutex_locker_new (&self->mutex);
+	if (!g_key_file_has_group (self->keyfile, key)) {
+		fu_metrics_cache_lookup ("jcat", FALSE);
+		return FALSE;
+	}
+	fu_metrics_cache_lookup ("jcat", TRUE);
+	if (timestamp != NULL)
+		*timestamp = g_key_file_get_int64 (self->keyfile, key, "Timestamp", NULL);
+	return TRUE;
+}
+
+/**
+ * fu_jcat_cache_add:
+ * @self: A #FuJcatCache
+ * @blob: The data that was signed
+ * @item: A #JcatItem with the signatures for @blob
+ * @flags: The #JcatVerifyFlags used for verification
+ * @results: (element-type JcatResult): The successful verification results
+ * @error: A #GError, or %NULL
+ *
+ * Adds a successful verification, saving it to disk if a filename was
+ * loaded.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_jcat_cache_add (FuJcatCache *self,
+		   GBytes *blob,
+		   JcatItem *item,
+		   JcatVerifyFlags flags,
+		   GPtrArray *results,
+		   GError **error)
+{
+	JcatResult *result_newest = NULL;
+	gsize groups_len = 0;
+	g_autofree gchar *key = NULL;
+	g_auto(GStrv) groups = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_JCAT_CACHE (self), FALSE);
+	g_return_val_if_fail (blob != NULL, FALSE);
+	g_return_val_if_fail (JCAT_IS_ITEM (item), FALSE);
+	g_return_val_if_fail (results != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	for (guint i = 0; i < results->len; i++) {
+		JcatResult *result = g_ptr_array_index (results, i);
+		if (result_newest == NULL ||
+		    jcat_result_get_timestamp (result) > jcat_result_get_timestamp (result_newest))
+			result_newest = result;
+	}
+	if (result_newest == NULL)
+		return TRUE;
+
+	key = fu_jcat_cache_get_key (blob, item, flags);
+	locker = g_mutex_locker_new (&self->mutex);
+
+	/* drop the oldest entries */
+	groups = g_key_file_get_groups (self->keyfile, &groups_len);
+	for (gsize i = 0; i < groups_len && groups_len - i > FU_JCAT_CACHE_MAX_ENTRIES; i++) {
+		if (g_strcmp0 (groups[i], FU_JCAT_CACHE_GROUP_FWUPD) == 0)
+			continue;
+		g_key_file_remove_group (self->keyfile, groups[i], NULL);
+	}
+
+	g_key_file_set_int64 (self->keyfile, key, "Timestamp",
+			      jcat_result_get_timestamp (result_newest));
+	if (jcat_result_get_authority (result_newest) != NULL) {
+		g_key_file_set_string (self->keyfile, key, "Authority",
+				       jcat_result_get_authority (result_newest));
+	}
+	return fu_jcat_cache_save (self, error);
+}
+
+/**
+ * fu_jcat_cache_new:
+ *
+ * Creates a new #FuJcatCache.
+ *
+ * Returns: (transfer full): a #FuJcatCache
+ *
+ * Since: 1.5.0
+ **/
+FuJcatCache *
+fu_jcat_cache_new (void)
+{
+	return g_object_new (FU_TYPE_JCAT_CACHE, NULL);
+}
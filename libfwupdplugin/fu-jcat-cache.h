@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <jcat.h>
+
+#define FU_TYPE_JCAT_CACHE (fu_jcat_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuJcatCache, fu_jcat_cache, FU, JCAT_CACHE, GObject)
+
+FuJcatCache	*fu_jcat_cache_new		(void);
+gboolean	 fu_jcat_cache_load		(FuJcatCache		*self,
+						 const gchar		*filename,
+						 const gchar		*keyring_id,
+						 GError			**error);
+gboolean	 fu_jcat_cache_lookup		(FuJcatCache		*self,
+						 GBytes			*blob,
+						 JcatItem		*item,
+						 JcatVerifyFlags	 flags,
+						 gint64			*timestamp);
+gboolean	 fu_jcat_cache_add		(FuJcatCache		*self,
+						 GBytes			*blob,
+						 JcatItem		*item,
+						 JcatVerifyFlags	 flags,
+						 GPtrArray		*results,
+						 GError			**error);
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuMetrics"
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include "fu-metrics.h"
+
+/**
+ * SECTION:fu-metrics
+ * @short_description: counters and latencies for monitoring
+ *
+ * Metrics are shared by the whole process and are exported in the
+ * OpenMetrics text format, so that they can be scraped by Prometheus.
+ *
+ * Each metric family is identified by name, e.g. `fwupd_cache_lookups`, and
+ * each sample by a preformatted set of labels, e.g. `cache="devices"`. Label
+ * values must not contain quotes or backslashes.
+ *
+ * Histograms use fixed buckets suitable for durations in seconds.
+ */
+
+typedef enum {
+	FU_METRICS_KIND_COUNTER,
+	FU_METRICS_KIND_GAUGE,
+	FU_METRICS_KIND_HISTOGRAM,
+} FuMetricsKind;
+
+static const gdouble fu_metrics_buckets[] = {
+	0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 30, 60, 300
+};
+
+#define FU_METRICS_BUCKETS_LEN			G_N_ELEMENTS(fu_metrics_buckets)
+
+typedef struct {
+	gdouble		 value;				/* counter or gauge */
+	guint64		 buckets[FU_METRICS_BUCKETS_LEN];	/* not cumulative */
+	guint64		 count;
+	gdouble		 sum;
+} FuMetricsSample;
+
+typedef struct {
+	FuMetricsKind	 kind;
+	GHashTable	*samples;	/* labels:FuMetricsSample */
+} FuMetricsFamily;
+
+static GHashTable	*fu_metrics_families = NULL;	/* name:FuMetricsFamily */
+static GHashTable	*fu_metrics_helps = NULL;	/* name:help */
+static GMutex		 fu_metrics_mutex;
+
+static void
+fu_metrics_family_free (FuMetricsFamily *family)
+{
+	g_hash_table_unref (family->samples);
+	g_free (family);
+}
+
+/* called with the mutex held */
+static FuMetricsSample *
+fu_metrics_ensure_sample (const gchar *name, const gchar *labels, FuMetricsKind kind)
+{
+	FuMetricsFamily *family;
+	FuMetricsSample *sample;
+
+	if (fu_metrics_families == NULL) {
+		fu_metrics_families = g_hash_table_new_full (g_str_hash, g_str_equal,
+							     g_free,
+							     (GDestroyNotify) fu_metrics_family_free);
+	}
+	family = g_hash_table_lookup (fu_metrics_families, name);
+	if (family == NULL) {
+		family = g_new0 (FuMetricsFamily, 1);
+		family->kind = kind;
+		family->samples = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, g_free);
+		g_hash_table_insert (fu_metrics_families, g_strdup (name), family);
+	}
+	if (family->kind != kind) {
+		g_critical ("metric %s used with a different kind", name);
+		return NULL;
+	}
+	if (labels == NULL)
+		labels = "";
+	sample = g_hash_table_lookup (family->samples, labels);
+	if (sample == NULL) {
+		sample = g_new0 (FuMetricsSample, 1);
+		g_hash_table_insert (family->samples, g_strdup (labels), sample);
+	}
+	return sample;
+}
+
+/**
+ * fu_metrics_set_help:
+ * @name: a metric family name, e.g. `fwupd_cache_lookups`
+ * @help: a one-line description
+ *
+ * Sets the description exported for the metric family.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_set_help (const gchar *name, const gchar *help)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+	g_return_if_fail (name != NULL);
+	if (fu_metrics_helps == NULL)
+		fu_metrics_helps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_hash_table_insert (fu_metrics_helps, g_strdup (name), g_strdup (help));
+}
+
+/**
+ * fu_metrics_counter_add:
+ * @name: a metric family name, without the `_total` suffix
+ * @labels: (nullable): preformatted labels, e.g. `plugin="dfu"`
+ * @value: the amount to add
+ *
+ * Increments a counter.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_counter_add (const gchar *name, const gchar *labels, guint64 value)
+{
+	FuMetricsSample *sample;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+	g_return_if_fail (name != NULL);
+	sample = fu_metrics_ensure_sample (name, labels, FU_METRICS_KIND_COUNTER);
+	if (sample != NULL)
+		sample->value += value;
+}
+
+/**
+ * fu_metrics_counter_set:
+ * @name: a metric family name, without the `_total` suffix
+ * @labels: (nullable): preformatted labels
+ * @value: the new total
+ *
+ * Sets a counter that is maintained elsewhere, for instance by a #FuQuirks.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_counter_set (const gchar *name, const gchar *labels, guint64 value)
+{
+	FuMetricsSample *sample;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+	g_return_if_fail (name != NULL);
+	sample = fu_metrics_ensure_sample (name, labels, FU_METRICS_KIND_COUNTER);
+	if (sample != NULL)
+		sample->value = value;
+}
+
+/**
+ * fu_metrics_gauge_set:
+ * @name: a metric family name
+ * @labels: (nullable): preformatted labels
+ * @value: the new value
+ *
+ * Sets a gauge.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_gauge_set (const gchar *name, const gchar *labels, gdouble value)
+{
+	FuMetricsSample *sample;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+	g_return_if_fail (name != NULL);
+	sample = fu_metrics_ensure_sample (name, labels, FU_METRICS_KIND_GAUGE);
+	if (sample != NULL)
+		sample->value = value;
+}
+
+/**
+ * fu_metrics_histogram_observe:
+ * @name: a metric family name, e.g. `fwupd_coldplug_duration_seconds`
+ * @labels: (nullable): preformatted labels
+ * @value: the observed value, typically in seconds
+ *
+ * Adds an observation to a histogram.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_histogram_observe (const gchar *name, const gchar *labels, gdouble value)
+{
+	FuMetricsSample *sample;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+	g_return_if_fail (name != NULL);
+	sample = fu_metrics_ensure_sample (name, labels, FU_METRICS_KIND_HISTOGRAM);
+	if (sample == NULL)
+		return;
+	for (guint i = 0; i < FU_METRICS_BUCKETS_LEN; i++) {
+		if (value <= fu_metrics_buckets[i]) {
+			sample->buckets[i]++;
+			break;
+		}
+	}
+	sample->count++;
+	sample->sum += value;
+}
+
+/**
+ * fu_metrics_cache_lookup:
+ * @cache: a cache name, e.g. `devices`
+ * @hit: %TRUE if the value was found in the cache
+ *
+ * Records a cache lookup, so that the hit ratio can be calculated from the
+ * `fwupd_cache_lookups` and `fwupd_cache_hits` counters.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_cache_lookup (const gchar *cache, gboolean hit)
+{
+	g_autofree gchar *labels = g_strdup_printf ("cache=\"%s\"", cache);
+	fu_metrics_counter_add ("fwupd_cache_lookups", labels, 1);
+	fu_metrics_counter_add ("fwupd_cache_hits", labels, hit ? 1 : 0);
+}
+
+static void
+fu_metrics_string_append_sample (GString *str,
+				  const gchar *name,
+				  const gchar *suffix,
+				  const gchar *labels,
+				  const gchar *extra,
+				  const gchar *value)
+{
+	g_string_append_printf (str, "%s%s", name, suffix);
+	if (labels[0] != '\0' || extra != NULL) {
+		g_string_append_c (str, '{');
+		g_string_append (str, labels);
+		if (labels[0] != '\0' && extra != NULL)
+			g_string_append_c (str, ',');
+		if (extra != NULL)
+			g_string_append (str, extra);
+		g_string_append_c (str, '}');
+	}
+	g_string_append_printf (str, " %s\n", value);
+}
+
+static gint
+fu_metrics_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/**
+ * fu_metrics_to_string:
+ *
+ * Exports all the metrics in the OpenMetrics text format, sorted by name and
+ * then by labels.
+ *
+ * Returns: (transfer full): a string
+ *
+ * Since: 1.5.0
+ **/
+gchar *
+fu_metrics_to_string (void)
+{
+	GString *str = g_string_new (NULL);
+	g_autofree const gchar **names = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+
+	if (fu_metrics_families == NULL) {
+		g_string_append (str, "# EOF\n");
+		return g_string_free (str, FALSE);
+	}
+	names = (const gchar **) g_hash_table_get_keys_as_array (fu_metrics_families, NULL);
+	qsort (names, g_hash_table_size (fu_metrics_families), sizeof(gchar *), fu_metrics_sort_cb);
+	for (guint i = 0; names[i] != NULL; i++) {
+		FuMetricsFamily *family = g_hash_table_lookup (fu_metrics_families, names[i]);
+		const gchar *help = NULL;
+		const gchar *kind_str = "counter";
+		g_autofree const gchar **labels = NULL;
+
+		if (family->kind == FU_METRICS_KIND_GAUGE)
+			kind_str = "gauge";
+		else if (family->kind == FU_METRICS_KIND_HISTOGRAM)
+			kind_str = "histogram";
+		g_string_append_printf (str, "# TYPE %s %s\n", names[i], kind_str);
+		if (fu_metrics_helps != NULL)
+			help = g_hash_table_lookup (fu_metrics_helps, names[i]);
+		if (help != NULL)
+			g_string_append_printf (str, "# HELP %s %s\n", names[i], help);
+
+		labels = (const gchar **) g_hash_table_get_keys_as_array (family->samples, NULL);
+		qsort (labels, g_hash_table_size (family->samples), sizeof(gchar *), fu_metrics_sort_cb);
+		for (guint j = 0; labels[j] != NULL; j++) {
+			FuMetricsSample *sample = g_hash_table_lookup (family->samples, labels[j]);
+			gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+			guint64 cumulative = 0;
+			g_autofree gchar *count = NULL;
+
+			if (family->kind == FU_METRICS_KIND_COUNTER) {
+				g_ascii_dtostr (buf, sizeof(buf), sample->value);
+				fu_metrics_string_append_sample (str, names[i], "_total",
+								 labels[j], NULL, buf);
+				continue;
+			}
+			if (family->kind == FU_METRICS_KIND_GAUGE) {
+				g_ascii_dtostr (buf, sizeof(buf), sample->value);
+				fu_metrics_string_append_sample (str, names[i], "",
+								 labels[j], NULL, buf);
+				continue;
+			}
+			for (guint k = 0; k < FU_METRICS_BUCKETS_LEN; k++) {
+				g_autofree gchar *le = NULL;
+				g_autofree gchar *cnt = NULL;
+				cumulative += sample->buckets[k];
+				g_ascii_dtostr (buf, sizeof(buf), fu_metrics_buckets[k]);
+				le = g_strdup_printf ("le=\"%s\"", buf);
+				cnt = g_strdup_printf ("%" G_GUINT64_FORMAT, cumulative);
+				fu_metrics_string_append_sample (str, names[i], "_bucket",
+								 labels[j], le, cnt);
+			}
+			count = g_strdup_printf ("%" G_GUINT64_FORMAT, sample->count);
+			fu_metrics_string_append_sample (str, names[i], "_bucket",
+							 labels[j], "le=\"+Inf\"", count);
+			fu_metrics_string_append_sample (str, names[i], "_count",
+							 labels[j], NULL, count);
+			g_ascii_dtostr (buf, sizeof(buf), sample->sum);
+			fu_metrics_string_append_sample (str, names[i], "_sum",
+							 labels[j], NULL, buf);
+		}
+	}
+	g_string_append (str, "# EOF\n");
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * fu_metrics_clear:
+ *
+ * Removes all the recorded metrics, but not the descriptions.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_metrics_clear (void)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_metrics_mutex);
+	if (fu_metrics_families != NULL)
+		g_hash_table_remove_all (fu_metrics_families);
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib.h>
+
+void		 fu_metrics_set_help			(const gchar	*name,
+							 const gchar	*help);
+void		 fu_metrics_counter_add			(const gchar	*name,
+							 const gchar	*labels,
+							 guint64	 value);
+void		 fu_metrics_counter_set			(const gchar	*name,
+							 const gchar	*labels,
+							 guint64	 value);
+void		 fu_metrics_gauge_set			(const gchar	*name,
+							 const gchar	*labels,
+							 gdouble	 value);
+void		 fu_metrics_histogram_observe		(const gchar	*name,
+							 const gchar	*labels,
+							 gdouble	 value);
+void		 fu_metrics_cache_lookup		(const gchar	*cache,
+							 gboolean	 hit);
+gchar		*fu_metrics_to_string			(void);
+void		 fu_metrics_clear			(void);
@@ -27,6 +27,10 @@ void		 fu_plugin_set_compile_versions		(FuPlugin	*self,
 							 GHashTable	*compile_versions);
 void		 fu_plugin_set_smbios			(FuPlugin	*self,
 							 FuSmbios	*smbios);
+void		 fu_plugin_set_file_watch		(FuPlugin	*self,
+							 FuFileWatch	*file_watch);
+void		 fu_plugin_set_esrt			(FuPlugin	*self,
+							 FuEsrt		*esrt);
 guint		 fu_plugin_get_order			(FuPlugin	*self);
 void		 fu_plugin_set_order			(FuPlugin	*self,
 							 guint		 order);
@@ -42,6 +46,7 @@ gboolean	 fu_plugin_has_rule			(FuPlugin	*self,
 							 FuPluginRule	 rule,
 							 const gchar	*name);
 GHashTable	*fu_plugin_get_report_metadata		(FuPlugin	*self);
+GVariant	*fu_plugin_stats_to_variant		(FuPlugin	*self);
 gboolean	 fu_plugin_open				(FuPlugin	*self,
 							 const gchar	*filename,
 							 GError		**error);
@@ -12,6 +12,7 @@
 #include <gmodule.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #ifdef HAVE_VALGRIND
 #include <valgrind.h>
@@ -20,6 +21,7 @@
 #include "fu-device-private.h"
 #include "fu-plugin-private.h"
 #include "fu-mutex.h"
+#include "fu-trace.h"
 
 /**
  * SECTION:fu-plugin
@@ -49,11 +51,19 @@ typedef struct {
 	GHashTable		*compile_versions;
 	GPtrArray		*udev_subsystems;
 	FuSmbios		*smbios;
+	FuFileWatch		*file_watch;
+	FuEsrt			*esrt;
 	GType			 device_gtype;
 	GHashTable		*devices;		/* (nullable): platform_id:GObject */
 	GRWLock			 devices_mutex;
 	GHashTable		*report_metadata;	/* (nullable): key:value */
 	FuPluginData		*data;
+	GMutex			 stats_mutex;
+	guint64			 stats_calls;
+	guint64			 stats_wall_time;	/* µs */
+	guint64			 stats_cpu_time;	/* µs */
+	guint64			 stats_devices;
+	guint64			 stats_events;
 } FuPluginPrivate;
 
 enum {
@@ -74,6 +84,105 @@ static guint signals[SIGNAL_LAST] = { 0 };
 G_DEFINE_TYPE_WITH_PRIVATE (FuPlugin, fu_plugin, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fu_plugin_get_instance_private (o))
 
+/* accounts the time spent in one vfunc, like #FuTraceSpan */
+typedef struct {
+	FuPlugin	*plugin;
+	gint64		 wall_start;	/* µs */
+	gint64		 cpu_start;	/* µs */
+} FuPluginStatsScope;
+
+static gint64
+fu_plugin_get_thread_cpu_time (void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	struct timespec ts = { 0 };
+	if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+	return ((gint64) ts.tv_sec * G_USEC_PER_SEC) + (ts.tv_nsec / 1000);
+#else
+	return 0;
+#endif
+}
+
+static FuPluginStatsScope *
+fu_plugin_stats_scope_new (FuPlugin *self)
+{
+	FuPluginStatsScope *scope = g_new0 (FuPluginStatsScope, 1);
+	scope->plugin = self;
+	scope->wall_start = g_get_monotonic_time ();
+	scope->cpu_start = fu_plugin_get_thread_cpu_time ();
+	return scope;
+}
+
+static void
+fu_plugin_stats_scope_free (FuPluginStatsScope *scope)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (scope->plugin);
+	gint64 wall = g_get_monotonic_time () - scope->wall_start;
+	gint64 cpu = fu_plugin_get_thread_cpu_time () - scope->cpu_start;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+	priv->stats_calls++;
+	priv->stats_wall_time += MAX (wall, 0);
+	priv->stats_cpu_time += MAX (cpu, 0);
+	g_free (scope);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuPluginStatsScope, fu_plugin_stats_scope_free)
+
+static void
+fu_plugin_stats_add_device (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+	priv->stats_devices++;
+}
+
+static void
+fu_plugin_stats_add_event (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+	priv->stats_events++;
+}
+
+/**
+ * fu_plugin_stats_to_variant:
+ * @self: A #FuPlugin
+ *
+ * Exports the resources used by the plugin since it was loaded, i.e. the
+ * number of vfuncs called, the wall and thread CPU time spent in them in
+ * microseconds, the number of devices added and the number of USB and udev
+ * events handled.
+ *
+ * Returns: a #GVariant of type `a{sv}`
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fu_plugin_stats_to_variant (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	GVariantBuilder builder;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "Name",
+			       g_variant_new_string (priv->name != NULL ? priv->name : ""));
+	g_variant_builder_add (&builder, "{sv}", "Enabled",
+			       g_variant_new_boolean (priv->enabled));
+	g_variant_builder_add (&builder, "{sv}", "Calls",
+			       g_variant_new_uint64 (priv->stats_calls));
+	g_variant_builder_add (&builder, "{sv}", "WallTime",
+			       g_variant_new_uint64 (priv->stats_wall_time));
+	g_variant_builder_add (&builder, "{sv}", "CpuTime",
+			       g_variant_new_uint64 (priv->stats_cpu_time));
+	g_variant_builder_add (&builder, "{sv}", "Devices",
+			       g_variant_new_uint64 (priv->stats_devices));
+	g_variant_builder_add (&builder, "{sv}", "Events",
+			       g_variant_new_uint64 (priv->stats_events));
+	return g_variant_builder_end (&builder);
+}
+
 typedef const gchar	*(*FuPluginGetNameFunc)		(void);
 typedef void		 (*FuPluginInitFunc)		(FuPlugin	*self);
 typedef gboolean	 (*FuPluginStartupFunc)		(FuPlugin	*self,
@@ -486,6 +595,7 @@ fu_plugin_device_add (FuPlugin *self, FuDevice *device)
 		 fu_device_get_id (device));
 	fu_device_set_created (device, (guint64) g_get_real_time () / G_USEC_PER_SEC);
 	fu_device_set_plugin (device, fu_plugin_get_name (self));
+	fu_plugin_stats_add_device (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 
 	/* add children if they have not already been added */
@@ -976,6 +1086,85 @@ fu_plugin_set_smbios (FuPlugin *self, FuSmbios *smbios)
 	g_set_object (&priv->smbios, smbios);
 }
 
+/**
+ * fu_plugin_set_file_watch:
+ * @self: A #FuPlugin
+ * @file_watch: A #FuFileWatch
+ *
+ * Sets the file watch service shared by all plugins.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_plugin_set_file_watch (FuPlugin *self, FuFileWatch *file_watch)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_set_object (&priv->file_watch, file_watch);
+}
+
+/**
+ * fu_plugin_get_file_watch:
+ * @self: A #FuPlugin
+ *
+ * Gets the file watch service, which should be used instead of creating a
+ * #GFileMonitor so that change events are debounced and file contents are
+ * cached between all plugins.
+ *
+ * Returns: (transfer none): a #FuFileWatch
+ *
+ * Since: 1.5.0
+ **/
+FuFileWatch *
+fu_plugin_get_file_watch (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_PLUGIN (self), NULL);
+
+	/* not loaded by the engine */
+	if (priv->file_watch == NULL)
+		priv->file_watch = fu_file_watch_new ();
+	return priv->file_watch;
+}
+
+/**
+ * fu_plugin_set_esrt:
+ * @self: A #FuPlugin
+ * @esrt: A #FuEsrt
+ *
+ * Sets the ESRT shared by all plugins.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_plugin_set_esrt (FuPlugin *self, FuEsrt *esrt)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_set_object (&priv->esrt, esrt);
+}
+
+/**
+ * fu_plugin_get_esrt:
+ * @self: A #FuPlugin
+ *
+ * Gets the ESRT, which has to be loaded with fu_esrt_load() before use.
+ * The table is only read from sysfs once for all plugins.
+ *
+ * Returns: (transfer none): a #FuEsrt
+ *
+ * Since: 1.5.0
+ **/
+FuEsrt *
+fu_plugin_get_esrt (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_PLUGIN (self), NULL);
+
+	/* not loaded by the engine */
+	if (priv->esrt == NULL)
+		priv->esrt = fu_esrt_new ();
+	return priv->esrt;
+}
+
 /**
  * fu_plugin_set_coldplug_delay:
  * @self: A #FuPlugin
@@ -1059,38 +1248,20 @@ static gboolean
 fu_plugin_device_read_firmware (FuPlugin *self, FuDevice *device, GError **error)
 {
 	g_autoptr(FuDeviceLocker) locker = NULL;
-	g_autoptr(FuFirmware) firmware = NULL;
-	g_autoptr(GBytes) fw = NULL;
-	GChecksumType checksum_types[] = {
-		G_CHECKSUM_SHA1,
-		G_CHECKSUM_SHA256,
-		0 };
 	locker = fu_device_locker_new (device, error);
 	if (locker == NULL)
 		return FALSE;
 	if (!fu_device_detach (device, error))
 		return FALSE;
-	firmware = fu_device_read_firmware (device, error);
-	if (firmware == NULL) {
+
+	/* hash each chunk as it is read rather than the whole image */
+	if (!fu_device_read_firmware_checksums (device, NULL, error)) {
 		g_autoptr(GError) error_local = NULL;
 		if (!fu_device_attach (device, &error_local))
 			g_debug ("ignoring attach failure: %s", error_local->message);
 		g_prefix_error (error, "failed to read firmware: ");
 		return FALSE;
 	}
-	fw = fu_firmware_write (firmware, error);
-	if (fw == NULL) {
-		g_autoptr(GError) error_local = NULL;
-		if (!fu_device_attach (device, &error_local))
-			g_debug ("ignoring attach failure: %s", error_local->message);
-		g_prefix_error (error, "failed to write firmware: ");
-		return FALSE;
-	}
-	for (guint i = 0; checksum_types[i] != 0; i++) {
-		g_autofree gchar *hash = NULL;
-		hash = g_compute_checksum_for_bytes (checksum_types[i], fw);
-		fu_device_add_checksum (device, hash);
-	}
 	return fu_device_attach (device, error);
 }
 
@@ -1111,6 +1282,8 @@ fu_plugin_runner_startup (FuPlugin *self, GError **error)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1125,6 +1298,8 @@ fu_plugin_runner_startup (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing startup() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:startup", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for startup()",
@@ -1151,6 +1326,8 @@ fu_plugin_runner_device_generic (FuPlugin *self, FuDevice *device,
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1171,6 +1348,8 @@ fu_plugin_runner_device_generic (FuPlugin *self, FuDevice *device,
 		return TRUE;
 	}
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
+	span = fu_trace_span_new ("plugin", "%s:%s", priv->name, symbol_name + 10);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for %s()",
@@ -1196,6 +1375,8 @@ fu_plugin_runner_flagged_device_generic (FuPlugin *self, FwupdInstallFlags flags
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginFlaggedDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1210,6 +1391,8 @@ fu_plugin_runner_flagged_device_generic (FuPlugin *self, FwupdInstallFlags flags
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
+	span = fu_trace_span_new ("plugin", "%s:%s", priv->name, symbol_name + 10);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, flags, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for %s()",
@@ -1235,6 +1418,8 @@ fu_plugin_runner_device_array_generic (FuPlugin *self, GPtrArray *devices,
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceArrayFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1249,6 +1434,8 @@ fu_plugin_runner_device_array_generic (FuPlugin *self, GPtrArray *devices,
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
+	span = fu_trace_span_new ("plugin", "%s:%s", priv->name, symbol_name + 10);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, devices, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for %s()",
@@ -1283,6 +1470,8 @@ fu_plugin_runner_coldplug (FuPlugin *self, GError **error)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1297,6 +1486,8 @@ fu_plugin_runner_coldplug (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:coldplug", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for coldplug()",
@@ -1330,6 +1521,8 @@ fu_plugin_runner_recoldplug (FuPlugin *self, GError **error)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1344,6 +1537,8 @@ fu_plugin_runner_recoldplug (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing recoldplug() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:recoldplug", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for recoldplug()",
@@ -1378,6 +1573,8 @@ fu_plugin_runner_coldplug_prepare (FuPlugin *self, GError **error)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1392,6 +1589,8 @@ fu_plugin_runner_coldplug_prepare (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug_prepare() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:coldplug_prepare", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for coldplug_prepare()",
@@ -1426,6 +1625,8 @@ fu_plugin_runner_coldplug_cleanup (FuPlugin *self, GError **error)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1440,6 +1641,8 @@ fu_plugin_runner_coldplug_cleanup (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug_cleanup() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:coldplug_cleanup", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for coldplug_cleanup()",
@@ -1622,6 +1825,8 @@ fu_plugin_runner_add_security_attrs (FuPlugin *self, FuSecurityAttrs *attrs)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginSecurityAttrsFunc func = NULL;
 	const gchar *symbol_name = "fu_plugin_add_security_attrs";
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* no object loaded */
 	if (priv->module == NULL)
@@ -1632,6 +1837,8 @@ fu_plugin_runner_add_security_attrs (FuPlugin *self, FuSecurityAttrs *attrs)
 	if (func == NULL)
 		return;
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
+	span = fu_trace_span_new ("plugin", "%s:%s", priv->name, symbol_name + 10);
+	stats = fu_plugin_stats_scope_new (self);
 	func (self, attrs);
 }
 
@@ -1823,6 +2030,8 @@ fu_plugin_runner_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError *
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginUsbDeviceAddedFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1832,6 +2041,10 @@ fu_plugin_runner_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError *
 	if (priv->module == NULL)
 		return TRUE;
 
+	/* including the superclassed device creation */
+	fu_plugin_stats_add_event (self);
+	stats = fu_plugin_stats_scope_new (self);
+
 	/* optional */
 	g_module_symbol (priv->module, "fu_plugin_usb_device_added", (gpointer *) &func);
 	if (func == NULL) {
@@ -1843,6 +2056,7 @@ fu_plugin_runner_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError *
 		return TRUE;
 	}
 	g_debug ("performing usb_device_added() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:usb_device_added", priv->name);
 	if (!func (self, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for usb_device_added()",
@@ -1878,6 +2092,8 @@ fu_plugin_runner_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginUdevDeviceAddedFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1887,6 +2103,10 @@ fu_plugin_runner_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError
 	if (priv->module == NULL)
 		return TRUE;
 
+	/* including the superclassed device creation */
+	fu_plugin_stats_add_event (self);
+	stats = fu_plugin_stats_scope_new (self);
+
 	/* optional */
 	g_module_symbol (priv->module, "fu_plugin_udev_device_added", (gpointer *) &func);
 	if (func == NULL) {
@@ -1898,6 +2118,7 @@ fu_plugin_runner_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError
 		return TRUE;
 	}
 	g_debug ("performing udev_device_added() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:udev_device_added", priv->name);
 	if (!func (self, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for udev_device_added()",
@@ -1933,6 +2154,8 @@ fu_plugin_runner_udev_device_changed (FuPlugin *self, FuUdevDevice *device, GErr
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginUdevDeviceAddedFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1942,6 +2165,10 @@ fu_plugin_runner_udev_device_changed (FuPlugin *self, FuUdevDevice *device, GErr
 	if (priv->module == NULL)
 		return TRUE;
 
+	/* including the superclassed device creation */
+	fu_plugin_stats_add_event (self);
+	stats = fu_plugin_stats_scope_new (self);
+
 	/* optional */
 	g_module_symbol (priv->module, "fu_plugin_udev_device_changed", (gpointer *) &func);
 	if (func == NULL) {
@@ -1953,6 +2180,7 @@ fu_plugin_runner_udev_device_changed (FuPlugin *self, FuUdevDevice *device, GErr
 		return TRUE;
 	}
 	g_debug ("performing udev_device_changed() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:udev_device_changed", priv->name);
 	if (!func (self, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for udev_device_changed()",
@@ -1984,6 +2212,8 @@ fu_plugin_runner_device_added (FuPlugin *self, FuDevice *device)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceRegisterFunc func = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -1996,6 +2226,8 @@ fu_plugin_runner_device_added (FuPlugin *self, FuDevice *device)
 	if (func == NULL)
 		return;
 	g_debug ("performing fu_plugin_device_added() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:device_added", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	func (self, device);
 }
 
@@ -2034,6 +2266,8 @@ fu_plugin_runner_device_register (FuPlugin *self, FuDevice *device)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceRegisterFunc func = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -2049,6 +2283,8 @@ fu_plugin_runner_device_register (FuPlugin *self, FuDevice *device)
 	g_module_symbol (priv->module, "fu_plugin_device_registered", (gpointer *) &func);
 	if (func != NULL) {
 		g_debug ("performing fu_plugin_device_registered() on %s", priv->name);
+		span = fu_trace_span_new ("plugin", "%s:device_registered", priv->name);
+		stats = fu_plugin_stats_scope_new (self);
 		func (self, device);
 	}
 }
@@ -2070,6 +2306,8 @@ fu_plugin_runner_device_created (FuPlugin *self, FuDevice *device, GError **erro
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceFunc func = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -2082,6 +2320,8 @@ fu_plugin_runner_device_created (FuPlugin *self, FuDevice *device, GError **erro
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing fu_plugin_device_created() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:device_created", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	return func (self, device, error);
 }
 
@@ -2108,6 +2348,8 @@ fu_plugin_runner_verify (FuPlugin *self,
 	FuPluginVerifyFunc func = NULL;
 	GPtrArray *checksums;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -2136,6 +2378,8 @@ fu_plugin_runner_verify (FuPlugin *self,
 
 	/* run vfunc */
 	g_debug ("performing verify() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:verify", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, device, flags, &error_local)) {
 		g_autoptr(GError) error_attach = NULL;
 		if (error_local == NULL) {
@@ -2278,6 +2522,8 @@ fu_plugin_runner_update (FuPlugin *self,
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginUpdateFunc update_func;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled) {
@@ -2298,6 +2544,8 @@ fu_plugin_runner_update (FuPlugin *self,
 		return fu_plugin_device_write_firmware (self, device, blob_fw, flags, error);
 	}
 
+	span = fu_trace_span_new ("plugin", "%s:update", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	/* online */
 	if (!update_func (self, device, blob_fw, flags, &error_local)) {
 		if (error_local == NULL) {
@@ -2343,6 +2591,8 @@ fu_plugin_runner_clear_results (FuPlugin *self, FuDevice *device, GError **error
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -2357,6 +2607,8 @@ fu_plugin_runner_clear_results (FuPlugin *self, FuDevice *device, GError **error
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing clear_result() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:clear_result", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for clear_result()",
@@ -2392,6 +2644,8 @@ fu_plugin_runner_get_results (FuPlugin *self, FuDevice *device, GError **error)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	FuPluginDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(FuPluginStatsScope) stats = NULL;
 
 	/* not enabled */
 	if (!priv->enabled)
@@ -2406,6 +2660,8 @@ fu_plugin_runner_get_results (FuPlugin *self, FuDevice *device, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing get_results() on %s", priv->name);
+	span = fu_trace_span_new ("plugin", "%s:get_results", priv->name);
+	stats = fu_plugin_stats_scope_new (self);
 	if (!func (self, device, &error_local)) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for get_results()",
@@ -2504,6 +2760,26 @@ fu_plugin_set_priority (FuPlugin *self, guint priority)
  * NOTE: The depsolver is iterative and may not solve overly-complicated rules;
  * If depsolving fails then fwupd will not start.
  *
+ * When %FU_PLUGIN_RULE_COLDPLUG_THREAD_SAFE is used @name should be a short
+ * reason, e.g. `only uses the network`. The plugin coldplug may then be run in
+ * a worker thread at the same time as other plugins, and so it must not depend
+ * on plugin ordering or expect fu_plugin_device_register() to be processed
+ * before it returns.
+ *
+ * When %FU_PLUGIN_RULE_INSTALL_THREAD_SAFE is used @name should also be a short
+ * reason. Devices from the plugin that have a different root device may then
+ * be updated at the same time in worker threads, and so the update vfuncs must
+ * not use the main loop or rely on %FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG.
+ * The daemon keeps answering requests while these updates run, so the
+ * device must not use fu_device_set_poll_interval() either. Hotplug events
+ * are queued until every thread has finished.
+ *
+ * When %FU_PLUGIN_RULE_STARTUP_THREAD_SAFE is used @name should also be a short
+ * reason. The plugin startup may then be run in a worker thread at the same
+ * time as other plugins with the same depsolved order, and so it must not
+ * create objects that deliver signals on the thread-default main context,
+ * such as D-Bus proxies.
+ *
  * Since: 1.0.0
  **/
 void
@@ -2765,6 +3041,7 @@ fu_plugin_init (FuPlugin *self)
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	priv->enabled = TRUE;
 	g_rw_lock_init (&priv->devices_mutex);
+	g_mutex_init (&priv->stats_mutex);
 }
 
 static void
@@ -2775,6 +3052,7 @@ fu_plugin_finalize (GObject *object)
 	FuPluginInitFunc func = NULL;
 
 	g_rw_lock_clear (&priv->devices_mutex);
+	g_mutex_clear (&priv->stats_mutex);
 
 	/* optional */
 	if (priv->module != NULL) {
@@ -2799,6 +3077,10 @@ fu_plugin_finalize (GObject *object)
 		g_ptr_array_unref (priv->udev_subsystems);
 	if (priv->smbios != NULL)
 		g_object_unref (priv->smbios);
+	if (priv->file_watch != NULL)
+		g_object_unref (priv->file_watch);
+	if (priv->esrt != NULL)
+		g_object_unref (priv->esrt);
 	if (priv->runtime_versions != NULL)
 		g_hash_table_unref (priv->runtime_versions);
 	if (priv->compile_versions != NULL)
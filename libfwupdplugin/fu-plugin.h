@@ -14,6 +14,8 @@
 #include "fu-common-version.h"
 #include "fu-device.h"
 #include "fu-device-locker.h"
+#include "fu-esrt.h"
+#include "fu-file-watch.h"
 #include "fu-quirks.h"
 #include "fu-hwids.h"
 #include "fu-usb-device.h"
@@ -74,6 +76,9 @@ typedef enum {
  * @FU_PLUGIN_RULE_BETTER_THAN:		Is better than another plugin
  * @FU_PLUGIN_RULE_INHIBITS_IDLE:	The plugin inhibits the idle shutdown
  * @FU_PLUGIN_RULE_METADATA_SOURCE:	Uses another plugin as a source of report metadata
+ * @FU_PLUGIN_RULE_COLDPLUG_THREAD_SAFE:	The coldplug can be run in a worker thread
+ * @FU_PLUGIN_RULE_INSTALL_THREAD_SAFE:	Devices can be updated in a worker thread
+ * @FU_PLUGIN_RULE_STARTUP_THREAD_SAFE:	The startup can be run in a worker thread
  *
  * The rules used for ordering plugins.
  * Plugins are expected to add rules in fu_plugin_initialize().
@@ -85,6 +90,9 @@ typedef enum {
 	FU_PLUGIN_RULE_BETTER_THAN,
 	FU_PLUGIN_RULE_INHIBITS_IDLE,
 	FU_PLUGIN_RULE_METADATA_SOURCE,		/* Since: 1.3.6 */
+	FU_PLUGIN_RULE_COLDPLUG_THREAD_SAFE,	/* Since: 1.5.0 */
+	FU_PLUGIN_RULE_INSTALL_THREAD_SAFE,	/* Since: 1.5.0 */
+	FU_PLUGIN_RULE_STARTUP_THREAD_SAFE,	/* Since: 1.5.0 */
 	/*< private >*/
 	FU_PLUGIN_RULE_LAST
 } FuPluginRule;
@@ -143,6 +151,8 @@ void		 fu_plugin_add_rule			(FuPlugin	*self,
 void		 fu_plugin_add_udev_subsystem		(FuPlugin	*self,
 							 const gchar	*subsystem);
 FuQuirks	*fu_plugin_get_quirks			(FuPlugin	*self);
+FuFileWatch	*fu_plugin_get_file_watch		(FuPlugin	*self);
+FuEsrt		*fu_plugin_get_esrt			(FuPlugin	*self);
 const gchar	*fu_plugin_lookup_quirk_by_id		(FuPlugin	*self,
 							 const gchar	*group,
 							 const gchar	*key);
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuQuirks"
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "fu-quirks-private.h"
+
+int
+main (int argc, char *argv[])
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuQuirks) quirks = fu_quirks_new ();
+	g_autoptr(GError) error = NULL;
+
+	if (argc != 2) {
+		g_printerr ("Usage: %s PKGDATADIR\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	filename = g_build_filename (argv[1], "quirks.xmlb", NULL);
+	if (!fu_quirks_compile (quirks, argv[1], filename, &error)) {
+		g_printerr ("Failed to compile quirks: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include "fu-quirks.h"
+
+gboolean	 fu_quirks_compile			(FuQuirks	*self,
+							 const gchar	*path,
+							 const gchar	*filename,
+							 GError		**error);
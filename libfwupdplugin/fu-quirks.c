@@ -10,12 +10,13 @@
 
 #include <glib-object.h>
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <xmlb.h>
 
 #include "fu-common.h"
 #include "fu-mutex.h"
-#include "fu-quirks.h"
+#include "fu-quirks-private.h"
 
 #include "fwupd-common.h"
 #include "fwupd-error.h"
@@ -43,6 +44,9 @@
  * obviously need code changes, but allows us to get most existing devices working
  * in an easy way without the user compiling anything.
  *
+ * The quirks shipped with fwupd are compiled into a silo when installed so
+ * that only the quirk files added locally have to be parsed at startup.
+ *
  * See also: #FuDevice, #FuPlugin
  */
 
@@ -53,6 +57,10 @@ struct _FuQuirks
 	GObject			 parent_instance;
 	FuQuirksLoadFlags	 load_flags;
 	XbSilo			*silo;
+	XbSilo			*silo_prebuilt;	/* nullable */
+	GHashTable		*index;		/* group-id : GPtrArray of XbNode */
+	guint			 lookup_cnt;
+	guint			 lookup_hits;
 };
 
 G_DEFINE_TYPE (FuQuirks, fu_quirks, G_TYPE_OBJECT)
@@ -199,6 +207,98 @@ fu_quirks_add_quirks_for_path (FuQuirks *self, XbBuilder *builder,
 	return TRUE;
 }
 
+/* the prebuilt silo is only used if no shipped quirk file is newer */
+static gboolean
+fu_quirks_check_prebuilt_mtime (const gchar *path, const gchar *xmlbfn, GError **error)
+{
+	const gchar *tmp;
+	GStatBuf st_xmlb;
+	g_autofree gchar *path_hw = g_build_filename (path, "quirks.d", NULL);
+	g_autoptr(GDir) dir = NULL;
+
+	if (g_stat (xmlbfn, &st_xmlb) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_FOUND,
+			     "%s does not exist",
+			     xmlbfn);
+		return FALSE;
+	}
+	dir = g_dir_open (path_hw, 0, NULL);
+	if (dir == NULL)
+		return TRUE;
+	while ((tmp = g_dir_read_name (dir)) != NULL) {
+		GStatBuf st;
+		g_autofree gchar *fn = NULL;
+		if (!g_str_has_suffix (tmp, ".quirk"))
+			continue;
+		fn = g_build_filename (path_hw, tmp, NULL);
+		if (g_stat (fn, &st) == 0 && st.st_mtime > st_xmlb.st_mtime) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "%s is newer than %s",
+				     fn, xmlbfn);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_quirks_load_prebuilt (FuQuirks *self, const gchar *path, GError **error)
+{
+	g_autofree gchar *xmlbfn = g_build_filename (path, "quirks.xmlb", NULL);
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(XbSilo) silo = xb_silo_new ();
+
+	if (!fu_quirks_check_prebuilt_mtime (path, xmlbfn, error))
+		return FALSE;
+	file = g_file_new_for_path (xmlbfn);
+	if (!xb_silo_load_from_file (silo, file, XB_SILO_LOAD_FLAG_WATCH_BLOB, NULL, error))
+		return FALSE;
+	self->silo_prebuilt = g_steal_pointer (&silo);
+	return TRUE;
+}
+
+static gboolean
+fu_quirks_build_index (FuQuirks *self, XbSilo *silo, GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	/* the values are only valid for as long as the silo is */
+	devices = xb_silo_query (silo, "quirk/device", 0, &error_local);
+	if (devices == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return TRUE;
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	for (guint i = 0; i < devices->len; i++) {
+		XbNode *n = g_ptr_array_index (devices, i);
+		GPtrArray *values;
+		const gchar *group_id = xb_node_get_attr (n, "id");
+		g_autoptr(XbNode) c = NULL;
+
+		if (group_id == NULL)
+			continue;
+		values = g_hash_table_lookup (self->index, group_id);
+		if (values == NULL) {
+			values = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_hash_table_insert (self->index, g_strdup (group_id), values);
+		}
+		c = xb_node_get_child (n);
+		while (c != NULL) {
+			XbNode *next = xb_node_get_next (c);
+			g_ptr_array_add (values, g_steal_pointer (&c));
+			c = next;
+		}
+	}
+	g_debug ("indexed %u quirk groups", g_hash_table_size (self->index));
+	return TRUE;
+}
+
 static gboolean
 fu_quirks_check_silo (FuQuirks *self, GError **error)
 {
@@ -207,18 +307,25 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	g_autofree gchar *datadir = NULL;
 	g_autofree gchar *localstatedir = NULL;
 	g_autofree gchar *xmlbfn = NULL;
+	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GFile) file = NULL;
 	g_autoptr(XbBuilder) builder = NULL;
 
 	/* everything is okay */
-	if (self->silo != NULL && xb_silo_is_valid (self->silo))
+	if (self->silo != NULL && xb_silo_is_valid (self->silo) &&
+	    (self->silo_prebuilt == NULL || xb_silo_is_valid (self->silo_prebuilt)))
 		return TRUE;
 
-	/* system datadir */
+	/* system datadir, compiled at install time if possible */
+	g_hash_table_remove_all (self->index);
+	g_clear_object (&self->silo_prebuilt);
 	builder = xb_builder_new ();
 	datadir = fu_common_get_path (FU_PATH_KIND_DATADIR_PKG);
-	if (!fu_quirks_add_quirks_for_path (self, builder, datadir, error))
-		return FALSE;
+	if (!fu_quirks_load_prebuilt (self, datadir, &error_local)) {
+		g_debug ("parsing shipped quirks: %s", error_local->message);
+		if (!fu_quirks_add_quirks_for_path (self, builder, datadir, error))
+			return FALSE;
+	}
 
 	/* something we can write when using Ostree */
 	localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
@@ -236,8 +343,66 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	}
 	if (self->load_flags & FU_QUIRKS_LOAD_FLAG_READONLY_FS)
 		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
+	g_clear_object (&self->silo);
 	self->silo = xb_builder_ensure (builder, file, compile_flags, NULL, error);
-	return self->silo != NULL;
+	if (self->silo == NULL)
+		return FALSE;
+
+	/* build a GUID lookup table so that lookups do not need XPath, with
+	 * the shipped quirks first as before */
+	if (self->silo_prebuilt != NULL) {
+		if (!fu_quirks_build_index (self, self->silo_prebuilt, error))
+			return FALSE;
+	}
+	return fu_quirks_build_index (self, self->silo, error);
+}
+
+/**
+ * fu_quirks_compile:
+ * @self: A #FuQuirks
+ * @path: a directory containing `quirks.d`, e.g. `/usr/share/fwupd`
+ * @filename: the silo to write, e.g. `/usr/share/fwupd/quirks.xmlb`
+ * @error: A #GError, or %NULL
+ *
+ * Compiles all the quirk files in @path into a silo that is loaded directly
+ * by fu_quirks_load() rather than parsing each file again.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_quirks_compile (FuQuirks *self, const gchar *path, const gchar *filename, GError **error)
+{
+	g_autoptr(GFile) file = g_file_new_for_path (filename);
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbSilo) silo = NULL;
+
+	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!fu_quirks_add_quirks_for_path (self, builder, path, error))
+		return FALSE;
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, error);
+	if (silo == NULL)
+		return FALSE;
+	return xb_silo_save_to_file (silo, file, NULL, error);
+}
+
+static GPtrArray *
+fu_quirks_lookup_group (FuQuirks *self, const gchar *group)
+{
+	GPtrArray *values;
+	g_autofree gchar *group_key = fu_quirks_build_group_key (group);
+
+	g_atomic_int_inc (&self->lookup_cnt);
+	values = g_hash_table_lookup (self->index, group_key);
+	if (values == NULL)
+		return NULL;
+	g_atomic_int_inc (&self->lookup_hits);
+	return values;
 }
 
 /**
@@ -255,10 +420,8 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 const gchar *
 fu_quirks_lookup_by_id (FuQuirks *self, const gchar *group, const gchar *key)
 {
-	g_autofree gchar *group_key = NULL;
+	GPtrArray *values;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(XbNode) n = NULL;
-	g_autoptr(XbQuery) query = NULL;
 
 	g_return_val_if_fail (FU_IS_QUIRKS (self), NULL);
 	g_return_val_if_fail (group != NULL, NULL);
@@ -271,37 +434,15 @@ fu_quirks_lookup_by_id (FuQuirks *self, const gchar *group, const gchar *key)
 	}
 
 	/* query */
-	group_key = fu_quirks_build_group_key (group);
-	query = xb_query_new_full (self->silo,
-				   "quirk/device[@id=?]/value[@key=?]",
-				   XB_QUERY_FLAG_NONE,
-				   &error);
-	if (query == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return NULL;
-		g_warning ("failed to build query: %s", error->message);
+	values = fu_quirks_lookup_group (self, group);
+	if (values == NULL)
 		return NULL;
+	for (guint i = 0; i < values->len; i++) {
+		XbNode *n = g_ptr_array_index (values, i);
+		if (g_strcmp0 (xb_node_get_attr (n, "key"), key) == 0)
+			return xb_node_get_text (n);
 	}
-	if (!xb_query_bind_str (query, 0, group_key, &error)) {
-		g_warning ("failed to bind 0: %s", error->message);
-		return NULL;
-	}
-	if (!xb_query_bind_str (query, 1, key, &error)) {
-		g_warning ("failed to bind 1: %s", error->message);
-		return NULL;
-	}
-	n = xb_silo_query_first_full (self->silo, query, &error);
-	if (n == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return NULL;
-		g_warning ("failed to query: %s", error->message);
-		return NULL;
-	}
-	return xb_node_get_text (n);
+	return NULL;
 }
 
 /**
@@ -321,10 +462,8 @@ gboolean
 fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 			     FuQuirksIter iter_cb, gpointer user_data)
 {
-	g_autofree gchar *group_key = NULL;
+	GPtrArray *values;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) results = NULL;
-	g_autoptr(XbQuery) query = NULL;
 
 	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
 	g_return_val_if_fail (group != NULL, FALSE);
@@ -337,34 +476,11 @@ fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 	}
 
 	/* query */
-	group_key = fu_quirks_build_group_key (group);
-	query = xb_query_new_full (self->silo,
-				   "quirk/device[@id=?]/value",
-				   XB_QUERY_FLAG_NONE,
-				   &error);
-	if (query == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return FALSE;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return FALSE;
-		g_warning ("failed to build query: %s", error->message);
-		return FALSE;
-	}
-	if (!xb_query_bind_str (query, 0, group_key, &error)) {
-		g_warning ("failed to bind 0: %s", error->message);
-		return FALSE;
-	}
-	results = xb_silo_query_full (self->silo, query, &error);
-	if (results == NULL) {
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return FALSE;
-		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return FALSE;
-		g_warning ("failed to query: %s", error->message);
+	values = fu_quirks_lookup_group (self, group);
+	if (values == NULL)
 		return FALSE;
-	}
-	for (guint i = 0; i < results->len; i++) {
-		XbNode *n = g_ptr_array_index (results, i);
+	for (guint i = 0; i < values->len; i++) {
+		XbNode *n = g_ptr_array_index (values, i);
 		iter_cb (self,
 			 xb_node_get_attr (n, "key"),
 			 xb_node_get_text (n),
@@ -373,6 +489,40 @@ fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 	return TRUE;
 }
 
+/**
+ * fu_quirks_get_lookup_count:
+ * @self: A #FuQuirks
+ *
+ * Gets the number of group lookups made since the quirks were created.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_quirks_get_lookup_count (FuQuirks *self)
+{
+	g_return_val_if_fail (FU_IS_QUIRKS (self), 0);
+	return g_atomic_int_get (&self->lookup_cnt);
+}
+
+/**
+ * fu_quirks_get_lookup_hits:
+ * @self: A #FuQuirks
+ *
+ * Gets the number of group lookups that matched at least one quirk entry.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_quirks_get_lookup_hits (FuQuirks *self)
+{
+	g_return_val_if_fail (FU_IS_QUIRKS (self), 0);
+	return g_atomic_int_get (&self->lookup_hits);
+}
+
 /**
  * fu_quirks_load: (skip)
  * @self: A #FuQuirks
@@ -403,14 +553,20 @@ fu_quirks_class_init (FuQuirksClass *klass)
 static void
 fu_quirks_init (FuQuirks *self)
 {
+	self->index = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify) g_ptr_array_unref);
 }
 
 static void
 fu_quirks_finalize (GObject *obj)
 {
 	FuQuirks *self = FU_QUIRKS (obj);
+	g_debug ("quirk lookups: %u, hits: %u", self->lookup_cnt, self->lookup_hits);
+	g_hash_table_unref (self->index);
 	if (self->silo != NULL)
 		g_object_unref (self->silo);
+	if (self->silo_prebuilt != NULL)
+		g_object_unref (self->silo_prebuilt);
 	G_OBJECT_CLASS (fu_quirks_parent_class)->finalize (obj);
 }
 
@@ -11,9 +11,20 @@
 #include <fwupdplugin.h>
 #include <libgcab.h>
 #include <glib/gstdio.h>
+#include <string.h>
+#ifdef HAVE_GIO_UNIX
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
+#include "fu-cabinet.h"
 #include "fu-device-private.h"
+#include "fu-firmware-builder.h"
+#include "fu-jcat-cache.h"
 #include "fu-plugin-private.h"
+#include "fu-quirks-private.h"
 #include "fu-security-attrs-private.h"
 #include "fu-smbios-private.h"
 
@@ -70,9 +81,24 @@ fu_archive_invalid_func (void)
 	g_assert_null (archive);
 }
 
+static gboolean
+fu_archive_cab_iterate_cb (FuArchive *archive,
+			   const gchar *filename,
+			   GBytes *bytes,
+			   gpointer user_data,
+			   GError **error)
+{
+	guint *cnt = (guint *) user_data;
+	g_assert_nonnull (bytes);
+	(*cnt)++;
+	return TRUE;
+}
+
 static void
 fu_archive_cab_func (void)
 {
+	gboolean ret;
+	guint cnt = 0;
 	g_autofree gchar *checksum1 = NULL;
 	g_autofree gchar *checksum2 = NULL;
 	g_autofree gchar *filename = NULL;
@@ -105,6 +131,31 @@ fu_archive_cab_func (void)
 	data_tmp = fu_archive_lookup_by_fn (archive, "NOTGOINGTOEXIST.xml", &error);
 	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
 	g_assert_null (data_tmp);
+	g_clear_error (&error);
+
+	/* any entries not yet looked up are decompressed too */
+	ret = fu_archive_iterate (archive, fu_archive_cab_iterate_cb, &cnt, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (cnt, >=, 2);
+}
+
+static void
+fu_common_cpuid_func (void)
+{
+	guint32 ebx1 = 0;
+	guint32 ebx2 = 0;
+	g_autoptr(GError) error = NULL;
+
+	if (!fu_common_cpuid (0x0, NULL, &ebx1, NULL, NULL, &error)) {
+		g_test_skip (error->message);
+		return;
+	}
+
+	/* the second call is served from the cache */
+	g_assert_true (fu_common_cpuid (0x0, NULL, &ebx2, NULL, NULL, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (ebx1, ==, ebx2);
 }
 
 static void
@@ -175,6 +226,26 @@ fu_device_open_refcount_func (void)
 	g_assert_false (ret);
 }
 
+static void
+fu_device_packet_buffer_func (void)
+{
+	guint8 *buf;
+	guint8 *buf2;
+	g_autoptr(FuDevice) device = fu_device_new ();
+
+	/* grows as required */
+	buf = fu_device_get_packet_buffer (device, 64);
+	g_assert_nonnull (buf);
+	memset (buf, 0xff, 64);
+	buf = fu_device_get_packet_buffer (device, 4096);
+	g_assert_nonnull (buf);
+	memset (buf, 0xff, 4096);
+
+	/* reused when smaller */
+	buf2 = fu_device_get_packet_buffer (device, 32);
+	g_assert_true (buf == buf2);
+}
+
 static void
 fu_device_metadata_func (void)
 {
@@ -270,6 +341,7 @@ static void
 fu_hwids_func (void)
 {
 	g_autoptr(FuHwids) hwids = NULL;
+	g_autoptr(FuHwids) hwids_cached = NULL;
 	g_autoptr(FuSmbios) smbios = NULL;
 	g_autoptr(GError) error = NULL;
 	gboolean ret;
@@ -330,6 +402,79 @@ fu_hwids_func (void)
 	}
 	for (guint i = 0; guids[i].key != NULL; i++)
 		g_assert (fu_hwids_has_guid (hwids, guids[i].value));
+
+	/* the same table is loaded from the cache */
+	hwids_cached = fu_hwids_new ();
+	ret = fu_hwids_setup (hwids_cached, smbios, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (fu_hwids_get_value (hwids_cached, FU_HWIDS_KEY_BIOS_VERSION), ==,
+			 "GJET75WW (2.25 )");
+	for (guint i = 0; guids[i].key != NULL; i++) {
+		g_autofree gchar *guid = fu_hwids_get_guid (hwids_cached, guids[i].key, &error);
+		g_assert_no_error (error);
+		g_assert_cmpstr (guid, ==, guids[i].value);
+		g_assert (fu_hwids_has_guid (hwids_cached, guids[i].value));
+	}
+}
+
+static void
+fu_file_watch_changed_cb (FuFileWatch *file_watch, const gchar *filename, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+	fu_test_loop_quit ();
+}
+
+static void
+fu_file_watch_func (void)
+{
+	gboolean ret;
+	guint cnt = 0;
+	guint watch_id;
+	const gchar *fn = "/tmp/fwupd-self-test/file-watch.txt";
+	g_autoptr(FuFileWatch) file_watch = fu_file_watch_new ();
+	g_autoptr(GBytes) blob1 = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GBytes) blob3 = NULL;
+	g_autoptr(GError) error = NULL;
+
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn, "one", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	fu_file_watch_set_debounce (file_watch, 50);
+	watch_id = fu_file_watch_add (file_watch, fn, fu_file_watch_changed_cb, &cnt, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (watch_id, !=, 0);
+	blob1 = fu_file_watch_get_contents (file_watch, fn, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob1);
+	g_assert_cmpint (g_bytes_get_size (blob1), ==, 3);
+
+	/* change twice without dispatching, so the contents are still cached */
+	ret = g_file_set_contents (fn, "two", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn, "three", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	blob2 = fu_file_watch_get_contents (file_watch, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (blob2 == blob1);
+
+	/* debounced into one callback, and the cache is invalidated */
+	fu_test_loop_run_with_timeout (5000);
+	fu_test_loop_quit ();
+	g_assert_cmpint (cnt, ==, 1);
+	blob3 = fu_file_watch_get_contents (file_watch, fn, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob3);
+	g_assert_cmpint (g_bytes_get_size (blob3), ==, 5);
+	fu_file_watch_remove (file_watch, watch_id);
 }
 
 static void
@@ -344,8 +489,10 @@ static void
 fu_plugin_delay_func (void)
 {
 	FuDevice *device_tmp;
+	guint64 cnt = 0;
 	g_autoptr(FuPlugin) plugin = NULL;
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GVariant) stats = NULL;
 
 	plugin = fu_plugin_new ();
 	g_signal_connect (plugin, "device-added",
@@ -363,6 +510,11 @@ fu_plugin_delay_func (void)
 	g_assert_cmpstr (fu_device_get_id (device_tmp), ==, "b7eccd0059d6d7dc2ef76c35d6de0048cc8c029d");
 	g_clear_object (&device_tmp);
 
+	/* accounted */
+	stats = g_variant_ref_sink (fu_plugin_stats_to_variant (plugin));
+	g_assert_true (g_variant_lookup (stats, "Devices", "t", &cnt));
+	g_assert_cmpint (cnt, ==, 1);
+
 	/* remove device */
 	fu_plugin_device_remove (plugin, device);
 	g_assert (device_tmp != NULL);
@@ -424,6 +576,50 @@ fu_plugin_quirks_performance_func (void)
 		}
 	}
 	g_print ("lookup=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+	g_assert_cmpint (fu_quirks_get_lookup_count (quirks), ==, 3000);
+	g_assert_cmpint (fu_quirks_get_lookup_hits (quirks), ==, 3000);
+}
+
+static void
+fu_plugin_quirks_compile_func (void)
+{
+	const gchar *datadir = "/tmp/fwupd-self-test/quirks-compile";
+	const gchar *tmp;
+	gboolean ret;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *fn_src = NULL;
+	g_autofree gchar *fn_dst = NULL;
+	g_autofree gchar *xmlbfn = NULL;
+	g_autoptr(FuQuirks) quirks1 = fu_quirks_new ();
+	g_autoptr(FuQuirks) quirks2 = fu_quirks_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* install the quirks and compile them */
+	fn_src = g_build_filename (TESTDATADIR_SRC, "quirks.d", "tests.quirk", NULL);
+	fn_dst = g_build_filename (datadir, "quirks.d", "tests.quirk", NULL);
+	xmlbfn = g_build_filename (datadir, "quirks.xmlb", NULL);
+	ret = g_file_get_contents (fn_src, &data, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_common_mkdir_parent (fn_dst, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn_dst, data, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_quirks_compile (quirks1, datadir, xmlbfn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the source file is not needed any more */
+	g_unlink (fn_dst);
+	g_setenv ("FWUPD_DATADIR", datadir, TRUE);
+	ret = fu_quirks_load (quirks2, FU_QUIRKS_LOAD_FLAG_NONE, &error);
+	g_setenv ("FWUPD_DATADIR", TESTDATADIR_SRC, TRUE);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	tmp = fu_quirks_lookup_by_id (quirks2, "DeviceInstanceId=USB\\VID_0BDA&PID_1100", "Name");
+	g_assert_cmpstr (tmp, ==, "Hub");
 }
 
 static void
@@ -516,6 +712,49 @@ fu_common_firmware_builder_func (void)
 	g_assert_cmpstr (data, ==, "xobdnas eht ni gninnur");
 }
 
+static void
+fu_firmware_builder_func (void)
+{
+	g_autofree gchar *archive_fn = NULL;
+	g_autoptr(FuFirmwareBuilder) builder = fu_firmware_builder_new ();
+	g_autoptr(GBytes) archive_blob = NULL;
+	g_autoptr(GBytes) firmware_blob1 = NULL;
+	g_autoptr(GBytes) firmware_blob2 = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* get test file */
+	archive_fn = g_build_filename (TESTDATADIR_DST, "builder", "firmware.tar", NULL);
+	archive_blob = fu_common_get_contents_bytes (archive_fn, &error);
+	g_assert_no_error (error);
+	g_assert (archive_blob != NULL);
+
+	/* generate the firmware in a warm sandbox */
+	fu_firmware_builder_set_keep_sandbox (builder, TRUE);
+	firmware_blob1 = fu_firmware_builder_build (builder, archive_blob,
+						     "startup.sh", "firmware.bin",
+						     &error);
+	if (firmware_blob1 == NULL) {
+		if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_PERMISSION_DENIED)) {
+			g_test_skip ("Missing permissions to create namespace in container");
+			return;
+		}
+		if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
+			g_test_skip ("User namespaces not supported in container");
+			return;
+		}
+		g_assert_no_error (error);
+	}
+
+	/* the same archive is not built again */
+	firmware_blob2 = fu_firmware_builder_build (builder, archive_blob,
+						     "startup.sh", "firmware.bin",
+						     &error);
+	g_assert_no_error (error);
+	g_assert (firmware_blob2 == firmware_blob1);
+	g_assert_true (fu_firmware_builder_cleanup (builder, &error));
+	g_assert_no_error (error);
+}
+
 static void
 fu_test_stdout_cb (const gchar *line, gpointer user_data)
 {
@@ -820,6 +1059,47 @@ fu_common_store_cab_unsigned_func (void)
 	g_assert_nonnull (blob_tmp);
 }
 
+static void
+fu_common_store_cab_extract_payloads_func (void)
+{
+	GBytes *blob_tmp;
+	gboolean ret;
+	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) rel = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* parse with the payload decompressed to disk */
+	blob = _build_cab (GCAB_COMPRESSION_MSZIP,
+			   "acme.metainfo.xml",
+	"<component type=\"firmware\">\n"
+	"  <id>com.acme.example.firmware</id>\n"
+	"  <releases>\n"
+	"    <release version=\"1.2.3\">\n"
+	"      <checksum target=\"content\" type=\"sha1\">7c211433f02071597741e6ff5a8ea34789abbf43</checksum>\n"
+	"    </release>\n"
+	"  </releases>\n"
+	"</component>",
+			   "firmware.bin", "world",
+			   NULL);
+	fu_cabinet_set_size_max (cabinet, 10240);
+	ret = fu_cabinet_parse (cabinet, blob, FU_CABINET_PARSE_FLAG_EXTRACT_PAYLOADS, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	silo = fu_cabinet_get_silo (cabinet);
+	g_assert_nonnull (silo);
+
+	/* verify the mapped payload */
+	rel = xb_silo_query_first (silo, "components/component/releases/release", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (rel);
+	blob_tmp = xb_node_get_data (rel, "fwupd::FirmwareBlob");
+	g_assert_nonnull (blob_tmp);
+	g_assert_cmpint (g_bytes_get_size (blob_tmp), ==, 5);
+	g_assert_cmpint (memcmp (g_bytes_get_data (blob_tmp, NULL), "world", 5), ==, 0);
+}
+
 static void
 fu_common_store_cab_folder_func (void)
 {
@@ -994,23 +1274,32 @@ static void
 fu_device_poll_func (void)
 {
 	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
 	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (device);
 	guint cnt;
+	guint cnt2;
 
-	/* set up a 10ms poll */
+	/* set up a 10ms poll and a 20ms poll sharing the same timer */
 	klass->poll = fu_device_poll_cb;
 	fu_device_set_metadata_integer (device, "cnt", 0);
+	fu_device_set_metadata_integer (device2, "cnt", 0);
 	fu_device_set_poll_interval (device, 10);
+	fu_device_set_poll_interval (device2, 20);
 	fu_test_loop_run_with_timeout (100);
 	fu_test_loop_quit ();
 	cnt = fu_device_get_metadata_integer (device, "cnt");
 	g_assert_cmpint (cnt, >=, 8);
+	cnt2 = fu_device_get_metadata_integer (device2, "cnt");
+	g_assert_cmpint (cnt2, >=, 4);
+	g_assert_cmpint (cnt2, <, cnt);
 
 	/* disable the poll */
 	fu_device_set_poll_interval (device, 0);
 	fu_test_loop_run_with_timeout (100);
 	fu_test_loop_quit ();
 	g_assert_cmpint (fu_device_get_metadata_integer (device, "cnt"), ==, cnt);
+	g_assert_cmpint (fu_device_get_metadata_integer (device2, "cnt"), >, cnt2);
+	fu_device_set_poll_interval (device2, 0);
 }
 
 static void
@@ -1104,6 +1393,144 @@ fu_device_incorporate_func (void)
 	g_assert_cmpint (fu_device_get_icons(device)->len, ==, 1);
 }
 
+static void
+fu_device_incorporate_shared_func (void)
+{
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuDevice) donor = fu_device_new ();
+
+	fu_device_set_metadata (donor, "test", "me");
+	fu_device_add_parent_guid (donor, "8c8ba9d4-fc51-5f7a-8d8b-b4b8de5ee0df");
+	fu_device_incorporate (device, donor);
+	g_assert_cmpstr (fu_device_get_metadata (device, "test"), ==, "me");
+	g_assert_true (fu_device_has_parent_guid (device, "8c8ba9d4-fc51-5f7a-8d8b-b4b8de5ee0df"));
+
+	/* changing either device does not change the other */
+	fu_device_set_metadata (device, "test", "device");
+	fu_device_set_metadata (donor, "test2", "donor");
+	fu_device_add_parent_guid (donor, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	g_assert_cmpstr (fu_device_get_metadata (device, "test"), ==, "device");
+	g_assert_cmpstr (fu_device_get_metadata (device, "test2"), ==, NULL);
+	g_assert_cmpstr (fu_device_get_metadata (donor, "test"), ==, "me");
+	g_assert_cmpint (fu_device_get_parent_guids (device)->len, ==, 1);
+	g_assert_cmpint (fu_device_get_parent_guids (donor)->len, ==, 2);
+}
+
+static void
+fu_device_snapshot_func (void)
+{
+	gboolean ret;
+	const gchar *fn = "/tmp/fwupd-self-test/var/lib/fwupd/devices-setup.snapshot";
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) device3 = fu_device_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = g_ptr_array_new ();
+
+	/* set up the device the first time */
+	fu_device_set_physical_id (device1, "usb:01:02");
+	fu_device_set_version_format (device1, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device1, "1.2.3");
+	fu_device_set_skip_setup_unchanged (device1, TRUE);
+	ret = fu_device_setup (device1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fu_device_set_name (device1, "ColorHug");
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_NEEDS_REBOOT);
+	g_ptr_array_add (devices, device1);
+	ret = fu_device_snapshot_save (fn, devices, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_device_snapshot_load (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* same device again */
+	fu_device_set_physical_id (device2, "usb:01:02");
+	fu_device_set_version_format (device2, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device2, "1.2.3");
+	fu_device_set_skip_setup_unchanged (device2, TRUE);
+	ret = fu_device_setup (device2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (fu_device_get_name (device2), ==, "ColorHug");
+	g_assert_true (fu_device_has_flag (device2, FWUPD_DEVICE_FLAG_UPDATABLE));
+	g_assert_false (fu_device_has_flag (device2, FWUPD_DEVICE_FLAG_NEEDS_REBOOT));
+
+	/* new firmware version */
+	fu_device_set_physical_id (device3, "usb:01:02");
+	fu_device_set_version_format (device3, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device3, "1.2.4");
+	fu_device_set_skip_setup_unchanged (device3, TRUE);
+	ret = fu_device_setup (device3, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (fu_device_get_name (device3), ==, NULL);
+}
+
+static void
+fu_chunk_iter_func (void)
+{
+	FuChunk chk;
+	FuChunkIter iter;
+	guint cnt = 0;
+	const gchar *buf = "123456";
+
+	/* starts part way through a page */
+	fu_chunk_iter_init (&iter, (const guint8 *) buf, 6, 0x3, 4, 0);
+	g_assert_cmpint (fu_chunk_iter_get_count (&iter), ==, 3);
+	g_assert_true (fu_chunk_iter_next (&iter, &chk));
+	g_assert_cmpint (chk.idx, ==, 0);
+	g_assert_cmpint (chk.page, ==, 0);
+	g_assert_cmpint (chk.address, ==, 3);
+	g_assert_cmpint (chk.data_sz, ==, 1);
+	g_assert_true (chk.data == (const guint8 *) buf);
+	g_assert_true (fu_chunk_iter_next (&iter, &chk));
+	g_assert_cmpint (chk.idx, ==, 1);
+	g_assert_cmpint (chk.page, ==, 1);
+	g_assert_cmpint (chk.address, ==, 0);
+	g_assert_cmpint (chk.data_sz, ==, 4);
+	g_assert_true (chk.data == (const guint8 *) buf + 1);
+	g_assert_true (fu_chunk_iter_next (&iter, &chk));
+	g_assert_cmpint (chk.page, ==, 2);
+	g_assert_cmpint (chk.address, ==, 0);
+	g_assert_cmpint (chk.data_sz, ==, 1);
+	g_assert_false (fu_chunk_iter_next (&iter, &chk));
+
+	/* no page size */
+	fu_chunk_iter_init (&iter, NULL, 0x10001, 0x100, 0, 0x1000);
+	g_assert_cmpint (fu_chunk_iter_get_count (&iter), ==, 17);
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		g_assert_true (chk.data == NULL);
+		g_assert_cmpint (chk.address, ==, 0x100 + (cnt * 0x1000));
+		cnt++;
+	}
+	g_assert_cmpint (cnt, ==, 17);
+	g_assert_cmpint (chk.data_sz, ==, 1);
+}
+
+static void
+fu_chunk_diff_func (void)
+{
+	FuChunk *chk;
+	g_autoptr(GBytes) blob_old = g_bytes_new_static ("aaaabbbbcc", 10);
+	g_autoptr(GBytes) blob_new = g_bytes_new_static ("aaaaBbbbccdd", 12);
+	g_autoptr(GPtrArray) chunks = NULL;
+
+	/* second sector changed, third sector grew */
+	chunks = fu_chunk_array_new_diff (blob_old, blob_new, 0x100, 4);
+	g_assert_cmpint (chunks->len, ==, 2);
+	chk = g_ptr_array_index (chunks, 0);
+	g_assert_cmpint (chk->idx, ==, 1);
+	g_assert_cmpint (chk->address, ==, 0x104);
+	g_assert_cmpint (chk->data_sz, ==, 4);
+	chk = g_ptr_array_index (chunks, 1);
+	g_assert_cmpint (chk->idx, ==, 2);
+	g_assert_cmpint (chk->address, ==, 0x108);
+	g_assert_cmpint (chk->data_sz, ==, 4);
+}
+
 static void
 fu_chunk_func (void)
 {
@@ -1274,6 +1701,462 @@ fu_common_version_func (void)
 	}
 }
 
+static void
+fu_metrics_func (void)
+{
+	g_autofree gchar *str = NULL;
+
+	fu_metrics_clear ();
+	fu_metrics_set_help ("test_duration_seconds", "Test durations");
+	fu_metrics_counter_add ("test_retries", "plugin=\"dfu\"", 2);
+	fu_metrics_counter_add ("test_retries", "plugin=\"dfu\"", 1);
+	fu_metrics_gauge_set ("test_devices", NULL, 5);
+	fu_metrics_histogram_observe ("test_duration_seconds", "method=\"Foo\"", 0.003);
+	fu_metrics_histogram_observe ("test_duration_seconds", "method=\"Foo\"", 2);
+	str = fu_metrics_to_string ();
+	g_print ("%s", str);
+	g_assert_nonnull (g_strstr_len (str, -1, "# TYPE test_retries counter\n"
+					"test_retries_total{plugin=\"dfu\"} 3\n"));
+	g_assert_nonnull (g_strstr_len (str, -1, "test_devices 5\n"));
+	g_assert_nonnull (g_strstr_len (str, -1, "# HELP test_duration_seconds Test durations\n"));
+	g_assert_nonnull (g_strstr_len (str, -1, "test_duration_seconds_bucket{method=\"Foo\",le=\"0.005\"} 1\n"));
+	g_assert_nonnull (g_strstr_len (str, -1, "test_duration_seconds_bucket{method=\"Foo\",le=\"5\"} 2\n"));
+	g_assert_nonnull (g_strstr_len (str, -1, "test_duration_seconds_bucket{method=\"Foo\",le=\"+Inf\"} 2\n"));
+	g_assert_nonnull (g_strstr_len (str, -1, "test_duration_seconds_count{method=\"Foo\"} 2\n"));
+	g_assert_true (g_str_has_suffix (str, "# EOF\n"));
+}
+
+static void
+fu_trace_func (void)
+{
+	const gchar *category = NULL;
+	const gchar *name = NULL;
+	gint64 start = 0;
+	gint64 duration = 0;
+	guint32 thread_id = 0;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) untuple = NULL;
+
+	fu_trace_clear ();
+	for (guint i = 0; i < 5000; i++) {
+		g_autoptr(FuTraceSpan) span = fu_trace_span_new ("test", "span%u", i);
+	}
+
+	/* only the newest spans are kept, oldest first */
+	val = g_variant_ref_sink (fu_trace_to_variant ());
+	untuple = g_variant_get_child_value (val, 0);
+	g_assert_cmpint (g_variant_n_children (untuple), ==, 4096);
+	g_variant_get_child (untuple, 0, "(&s&sxxu)",
+			     &category, &name, &start, &duration, &thread_id);
+	g_assert_cmpstr (category, ==, "test");
+	g_assert_cmpstr (name, ==, "span904");
+	g_assert_cmpint (duration, >=, 0);
+	g_assert_cmpint (thread_id, >, 0);
+	g_variant_get_child (untuple, 4095, "(&s&sxxu)",
+			     &category, &name, &start, &duration, &thread_id);
+	g_assert_cmpstr (name, ==, "span4999");
+	fu_trace_clear ();
+}
+
+static void
+fu_io_channel_read_until_func (void)
+{
+#ifdef HAVE_GIO_UNIX
+	const gchar *lines = "abc\ndef\nghi";
+	gboolean ret;
+	gint fds[2] = { -1, -1 };
+	g_autoptr(FuIOChannel) io_r = NULL;
+	g_autoptr(FuIOChannel) io_w = NULL;
+	g_autoptr(GByteArray) buf1 = NULL;
+	g_autoptr(GByteArray) buf2 = NULL;
+	g_autoptr(GByteArray) buf3 = NULL;
+	g_autoptr(GByteArray) buf4 = NULL;
+	g_autoptr(GError) error = NULL;
+
+	ret = g_unix_open_pipe (fds, FD_CLOEXEC, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	io_r = fu_io_channel_unix_new (fds[0]);
+	io_w = fu_io_channel_unix_new (fds[1]);
+
+	/* coalesced into one write */
+	ret = fu_io_channel_write_raw (io_w, (const guint8 *) lines, 4, 100,
+				       FU_IO_CHANNEL_FLAG_BUFFER_WRITE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_io_channel_write_raw (io_w, (const guint8 *) lines + 4, strlen (lines) - 4,
+				       100, FU_IO_CHANNEL_FLAG_BUFFER_WRITE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_io_channel_flush (io_w, 100, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* one line at a time, with the rest remaining buffered */
+	buf1 = fu_io_channel_read_until (io_r, (const guint8 *) "\n", 1, 64, 100,
+					 FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (buf1);
+	g_assert_cmpint (buf1->len, ==, 4);
+	g_assert_cmpint (memcmp (buf1->data, "abc\n", 4), ==, 0);
+	buf2 = fu_io_channel_read_until (io_r, (const guint8 *) "\n", 1, 64, 100,
+					 FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (buf2);
+	g_assert_cmpint (buf2->len, ==, 4);
+	g_assert_cmpint (memcmp (buf2->data, "def\n", 4), ==, 0);
+
+	/* by length */
+	buf3 = fu_io_channel_read_until (io_r, NULL, 0, 2, 100,
+					 FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (buf3);
+	g_assert_cmpint (buf3->len, ==, 2);
+	g_assert_cmpint (memcmp (buf3->data, "gh", 2), ==, 0);
+
+	/* no delimiter before the timeout */
+	buf4 = fu_io_channel_read_until (io_r, (const guint8 *) "\n", 1, 64, 10,
+					 FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+	g_assert_null (buf4);
+#else
+	g_test_skip ("no pipe support");
+#endif
+}
+
+static void
+fu_io_recording_func (void)
+{
+#ifdef HAVE_GIO_UNIX
+	const gchar *fn = "/tmp/fwupd-self-test/io-recording.bin";
+	gboolean ret;
+	gint fds[2] = { -1, -1 };
+	g_autoptr(FuIoRecording) recording1 = fu_io_recording_new ();
+	g_autoptr(FuIoRecording) recording2 = fu_io_recording_new ();
+	g_autoptr(FuIOChannel) io_r = NULL;
+	g_autoptr(FuIOChannel) io_w = NULL;
+	g_autoptr(FuIOChannel) io_replay = fu_io_channel_unix_new (-1);
+	g_autoptr(GByteArray) buf1 = NULL;
+	g_autoptr(GByteArray) buf2 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *str = NULL;
+
+	/* record a request and the response */
+	ret = g_unix_open_pipe (fds, FD_CLOEXEC, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	io_r = fu_io_channel_unix_new (fds[0]);
+	io_w = fu_io_channel_unix_new (fds[1]);
+	fu_io_channel_set_io_recording (io_r, recording1);
+	fu_io_channel_set_io_recording (io_w, recording1);
+	ret = fu_io_channel_write_raw (io_w, (const guint8 *) "ping", 4, 100,
+				       FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	buf1 = fu_io_channel_read_byte_array (io_r, 4, 100,
+					      FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (buf1);
+	g_assert_cmpint (fu_io_recording_get_size (recording1), ==, 2);
+	ret = fu_io_recording_save (recording1, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* replay without a device or the recorded latency */
+	ret = fu_io_recording_load (recording2, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (fu_io_recording_is_replay (recording2));
+	fu_io_recording_set_latency_scale (recording2, 0.f);
+	fu_io_channel_set_io_recording (io_replay, recording2);
+	ret = fu_io_channel_write_raw (io_replay, (const guint8 *) "ping", 4, 100,
+				       FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	buf2 = fu_io_channel_read_byte_array (io_replay, 4, 100,
+					      FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (buf2);
+	g_assert_cmpint (buf2->len, ==, 4);
+	g_assert_cmpint (memcmp (buf2->data, "ping", 4), ==, 0);
+	str = fu_io_recording_to_string (recording2);
+	g_debug ("%s", str);
+
+	/* nothing else was recorded */
+	ret = fu_io_channel_write_raw (io_replay, (const guint8 *) "pong", 4, 100,
+				       FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* a different request to the one recorded */
+	ret = fu_io_recording_load (recording2, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_io_channel_write_raw (io_replay, (const guint8 *) "pong", 4, 100,
+				       FU_IO_CHANNEL_FLAG_NONE, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_DATA);
+	g_assert_false (ret);
+#else
+	g_test_skip ("no pipe support");
+#endif
+}
+
+static void
+fu_common_checksums_func (void)
+{
+	const GChecksumType types[] = { G_CHECKSUM_SHA1, G_CHECKSUM_SHA256 };
+	const gsize sizes[] = { 0x24000, 0x180000 };
+	g_autofree guint8 *buf = g_malloc (0x180000);
+
+	/* spans several blocks with a short tail, and large enough to use
+	 * the kernel crypto API if it is faster */
+	for (guint i = 0; i < 0x180000; i++)
+		buf[i] = i % 0xfb;
+	for (guint j = 0; j < G_N_ELEMENTS (sizes); j++) {
+		g_autoptr(GBytes) blob = g_bytes_new_static (buf, sizes[j]);
+		g_auto(GStrv) checksums = NULL;
+		checksums = fu_common_checksums_compute (blob, types, G_N_ELEMENTS (types));
+		g_assert_nonnull (checksums);
+		g_assert_cmpint (g_strv_length (checksums), ==, 2);
+		for (guint i = 0; i < G_N_ELEMENTS (types); i++) {
+			g_autofree gchar *tmp = g_compute_checksum_for_bytes (types[i], blob);
+			g_assert_cmpstr (checksums[i], ==, tmp);
+		}
+	}
+}
+
+static void
+fu_common_get_contents_fd_sealed_func (void)
+{
+#if defined(HAVE_GIO_UNIX) && defined(F_ADD_SEALS)
+	const gchar *buf = "hello world";
+	gint fd;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* sealed memfd is mapped */
+	fd = memfd_create ("fwupd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	g_assert_cmpint (fd, >=, 0);
+	g_assert_cmpint (write (fd, buf, strlen (buf)), ==, strlen (buf));
+	g_assert_cmpint (fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE), ==, 0);
+	blob = fu_common_get_contents_fd (fd, 1024, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+	g_assert_cmpint (g_bytes_get_size (blob), ==, strlen (buf));
+	g_assert_cmpint (memcmp (g_bytes_get_data (blob, NULL), buf, strlen (buf)), ==, 0);
+	g_clear_pointer (&blob, g_bytes_unref);
+
+	/* unsealed memfd is read from the current position */
+	fd = memfd_create ("fwupd", MFD_CLOEXEC);
+	g_assert_cmpint (fd, >=, 0);
+	g_assert_cmpint (write (fd, buf, strlen (buf)), ==, strlen (buf));
+	g_assert_cmpint (lseek (fd, 6, SEEK_SET), ==, 6);
+	blob = fu_common_get_contents_fd (fd, 1024, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+	g_assert_cmpint (g_bytes_get_size (blob), ==, 5);
+#else
+	g_test_skip ("no memfd sealing support");
+#endif
+}
+
+static void
+fu_common_bytes_find_func (void)
+{
+	const guint8 buf1[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x12 };
+	const guint8 buf2[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x13 };
+	gsize offset = 0;
+	g_autoptr(GBytes) blob_empty = g_bytes_new_static (buf1, 5);
+	g_autoptr(GBytes) blob_full = g_bytes_new_static (buf1, sizeof(buf1));
+	g_autoptr(GError) error = NULL;
+
+	/* empty */
+	g_assert_true (fu_common_bytes_is_empty (blob_empty));
+	g_assert_false (fu_common_bytes_is_empty (blob_full));
+
+	/* first and last block are not empty */
+	g_assert_true (fu_common_bytes_find_not_empty_raw (buf1, sizeof(buf1), 4, &offset));
+	g_assert_cmpint (offset, ==, 4);
+	offset += 4;
+	g_assert_true (fu_common_bytes_find_not_empty_raw (buf1, sizeof(buf1), 4, &offset));
+	g_assert_cmpint (offset, ==, 8);
+	offset += 4;
+	g_assert_false (fu_common_bytes_find_not_empty_raw (buf1, sizeof(buf1), 4, &offset));
+
+	/* only the short last block differs */
+	offset = 0;
+	g_assert_true (fu_common_bytes_find_diff_raw (buf1, buf2, sizeof(buf1), 4, &offset));
+	g_assert_cmpint (offset, ==, 8);
+	offset += 4;
+	g_assert_false (fu_common_bytes_find_diff_raw (buf1, buf2, sizeof(buf1), 4, &offset));
+
+	/* compare reports the first difference */
+	g_assert_true (fu_common_bytes_compare_raw (buf1, 9, buf2, 9, &error));
+	g_assert_no_error (error);
+	g_assert_false (fu_common_bytes_compare_raw (buf1, sizeof(buf1), buf2, sizeof(buf2), &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_cmpstr (error->message, ==, "got 0x12, expected 0x13 @ 0x0009");
+}
+
+static void
+fu_jcat_cache_func (void)
+{
+	gboolean ret;
+	const gchar *fn = "/tmp/fwupd-self-test/var/lib/fwupd/jcat-cache.ini";
+	g_autofree gchar *csum = NULL;
+	g_autoptr(FuJcatCache) cache1 = fu_jcat_cache_new ();
+	g_autoptr(FuJcatCache) cache2 = fu_jcat_cache_new ();
+	g_autoptr(FuJcatCache) cache3 = fu_jcat_cache_new ();
+	g_autoptr(GBytes) blob = g_bytes_new_static ("hello", 5);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(JcatBlob) jcat_blob = NULL;
+	g_autoptr(JcatContext) jcat_context = jcat_context_new ();
+	g_autoptr(JcatItem) jcat_item = jcat_item_new ("hello.bin");
+
+	/* verify using a checksum */
+	g_unlink (fn);
+	csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, blob);
+	jcat_blob = jcat_blob_new_utf8 (JCAT_BLOB_KIND_SHA256, csum);
+	jcat_item_add_blob (jcat_item, jcat_blob);
+	results = jcat_context_verify_item (jcat_context, blob, jcat_item,
+					    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM,
+					    &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (results);
+
+	/* add to an empty cache */
+	ret = fu_jcat_cache_load (cache1, fn, "keyring1", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_false (fu_jcat_cache_lookup (cache1, blob, jcat_item,
+					      JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM, NULL));
+	ret = fu_jcat_cache_add (cache1, blob, jcat_item,
+				 JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM,
+				 results, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (fu_jcat_cache_lookup (cache1, blob, jcat_item,
+					     JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM, NULL));
+	g_assert_false (fu_jcat_cache_lookup (cache1, blob, jcat_item,
+					      JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE, NULL));
+
+	/* loaded again with the same keys */
+	ret = fu_jcat_cache_load (cache2, fn, "keyring1", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (fu_jcat_cache_lookup (cache2, blob, jcat_item,
+					     JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM, NULL));
+
+	/* trusted keys changed */
+	ret = fu_jcat_cache_load (cache3, fn, "keyring2", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_false (fu_jcat_cache_lookup (cache3, blob, jcat_item,
+					      JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM, NULL));
+}
+
+static void
+fu_common_acpi_table_func (void)
+{
+	gboolean ret;
+	guint8 buf[0x28] = { 'T', 'E', 'S', 'T', 0x24, 0x00, 0x00, 0x00 };
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *fn_short = NULL;
+	g_autoptr(GBytes) blob1 = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GBytes) blob3 = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* padding after the declared length is not returned */
+	g_setenv ("FWUPD_ACPITABLESDIR", "/tmp/fwupd-self-test/acpi", TRUE);
+	fn = g_build_filename ("/tmp/fwupd-self-test/acpi", "TEST", NULL);
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn, (const gchar *) buf, sizeof(buf), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	blob1 = fu_common_get_acpi_table ("TEST", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob1);
+	g_assert_cmpint (g_bytes_get_size (blob1), ==, 0x24);
+
+	/* only read once */
+	g_unlink (fn);
+	blob2 = fu_common_get_acpi_table ("TEST", &error);
+	g_assert_no_error (error);
+	g_assert_true (blob1 == blob2);
+
+	/* truncated */
+	buf[4] = 0x30;
+	fn_short = g_build_filename ("/tmp/fwupd-self-test/acpi", "TRNC", NULL);
+	memcpy (buf, "TRNC", 4);
+	ret = g_file_set_contents (fn_short, (const gchar *) buf, sizeof(buf), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	blob3 = fu_common_get_acpi_table ("TRNC", &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (blob3);
+	g_unsetenv ("FWUPD_ACPITABLESDIR");
+}
+
+static void
+fu_common_crc_func (void)
+{
+	const guint8 buf[] = "123456789";
+	guint32 crc_tmp = 0xffffffff;
+	g_autofree guint8 *blob = g_malloc (0x100000);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* standard check values */
+	g_assert_cmpint (fu_common_crc8 (FU_COMMON_CRC_KIND_B8_STANDARD, buf, 9), ==, 0xf4);
+	g_assert_cmpint (fu_common_crc16 (FU_COMMON_CRC_KIND_B16_USB, buf, 9), ==, 0xb4c8);
+	g_assert_cmpint (fu_common_crc32 (FU_COMMON_CRC_KIND_B32_STANDARD, buf, 9), ==, 0xcbf43926);
+	g_assert_cmpint (fu_common_crc32 (FU_COMMON_CRC_KIND_B32_MPEG2, buf, 9), ==, 0x0376e6e7);
+
+	/* slicing-by-8 matches one byte at a time */
+	for (guint i = 0; i < 0x100000; i++)
+		blob[i] = (guint8) (i * 7 + (i >> 8));
+	g_timer_reset (timer);
+	for (guint i = 0; i < 0x100000; i++)
+		crc_tmp = fu_common_crc32_step (FU_COMMON_CRC_KIND_B32_STANDARD, blob + i, 1, crc_tmp);
+	g_debug ("byte-at-a-time CRC took %.2fms", g_timer_elapsed (timer, NULL) * 1000);
+	g_timer_reset (timer);
+	g_assert_cmpint (fu_common_crc32_step (FU_COMMON_CRC_KIND_B32_STANDARD,
+					       blob, 0x100000, 0xffffffff), ==, crc_tmp);
+	g_debug ("slicing-by-8 CRC took %.2fms", g_timer_elapsed (timer, NULL) * 1000);
+	crc_tmp = 0xffffffff;
+	for (guint i = 0; i < 0x100000; i++)
+		crc_tmp = fu_common_crc32_step (FU_COMMON_CRC_KIND_B32_MPEG2, blob + i, 1, crc_tmp);
+	g_assert_cmpint (fu_common_crc32_step (FU_COMMON_CRC_KIND_B32_MPEG2,
+					       blob, 0x100000, 0xffffffff), ==, crc_tmp);
+}
+
+static void
+fu_common_debug_enabled_func (void)
+{
+	g_autofree gchar *verbose_old = g_strdup (g_getenv ("FWUPD_VERBOSE"));
+
+	g_setenv ("FWUPD_VERBOSE", "FuCommon,FuEngine", TRUE);
+	g_assert_true (fu_common_debug_enabled ("FuEngine"));
+	g_assert_false (fu_common_debug_enabled ("FuPlugin"));
+	g_assert_false (fu_common_debug_enabled (NULL));
+
+	/* changed at runtime */
+	g_setenv ("FWUPD_VERBOSE", "FuPlugin", TRUE);
+	g_assert_false (fu_common_debug_enabled ("FuEngine"));
+	g_assert_true (fu_common_debug_enabled ("FuPlugin"));
+	g_setenv ("FWUPD_VERBOSE", "*", TRUE);
+	g_assert_true (fu_common_debug_enabled ("FuEngine"));
+
+	if (verbose_old != NULL)
+		g_setenv ("FWUPD_VERBOSE", verbose_old, TRUE);
+	else
+		g_unsetenv ("FWUPD_VERBOSE");
+}
+
 static void
 fu_common_vercmp_func (void)
 {
@@ -1322,6 +2205,36 @@ fu_common_vercmp_func (void)
 	g_assert_cmpint (fu_common_vercmp (NULL, NULL), ==, G_MAXINT);
 }
 
+static void
+fu_common_version_compare_func (void)
+{
+	const gchar *versions[] = {
+		"1.2.3", "1.2.4", "1.2.3.1", "001.002.009", "1.2.3a", "1.2.3b",
+		"1.2.3~rc1", "1.2.3~rc2", "alpha", "beta", "1.2a.3", NULL };
+
+	/* parsed versions compare exactly the same as the strings */
+	for (guint i = 0; versions[i] != NULL; i++) {
+		g_autoptr(FuCommonVersion) ver_a = fu_common_version_new (versions[i]);
+		g_assert_cmpstr (fu_common_version_get_str (ver_a), ==, versions[i]);
+		for (guint j = 0; versions[j] != NULL; j++) {
+			g_autoptr(FuCommonVersion) ver_b = fu_common_version_new (versions[j]);
+			g_assert_cmpint (fu_common_version_compare (ver_a, ver_b,
+								    FWUPD_VERSION_FORMAT_UNKNOWN), ==,
+					 fu_common_vercmp_full (versions[i], versions[j],
+								FWUPD_VERSION_FORMAT_UNKNOWN));
+			g_assert_cmpint (fu_common_version_compare (ver_a, ver_b,
+								    FWUPD_VERSION_FORMAT_PLAIN), ==,
+					 fu_common_vercmp_full (versions[i], versions[j],
+								FWUPD_VERSION_FORMAT_PLAIN));
+		}
+	}
+
+	/* invalid */
+	g_assert_null (fu_common_version_new (NULL));
+	g_assert_cmpint (fu_common_version_compare (NULL, NULL,
+						    FWUPD_VERSION_FORMAT_UNKNOWN), ==, G_MAXINT);
+}
+
 static void
 fu_firmware_ihex_func (void)
 {
@@ -1384,6 +2297,38 @@ fu_firmware_ihex_func (void)
 			 ":00000001FF\n");
 }
 
+static void
+fu_firmware_ihex_records_func (void)
+{
+	FuIhexFirmwareRecord *rcd;
+	GPtrArray *records;
+	const gchar *str = ":0400000001020304F2\r\n"
+			   "; comment\n"
+			   "\n"
+			   ":00000001FF\n";
+	gboolean ret;
+	g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+	g_autoptr(GBytes) blob = g_bytes_new_static (str, strlen (str));
+	g_autoptr(GBytes) data_fw = NULL;
+	g_autoptr(GError) error = NULL;
+
+	ret = fu_firmware_parse (firmware, blob, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	data_fw = fu_firmware_get_image_default_bytes (firmware, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (data_fw);
+	g_assert_cmpint (g_bytes_get_size (data_fw), ==, 4);
+
+	/* only split into lines when asked */
+	records = fu_ihex_firmware_get_records (FU_IHEX_FIRMWARE (firmware));
+	g_assert_cmpint (records->len, ==, 3);
+	rcd = g_ptr_array_index (records, 0);
+	g_assert_cmpstr (rcd->buf->str, ==, ":0400000001020304F2");
+	rcd = g_ptr_array_index (records, 2);
+	g_assert_cmpint (rcd->ln, ==, 4);
+}
+
 static void
 fu_firmware_ihex_signed_func (void)
 {
@@ -1640,7 +2585,10 @@ fu_efivar_func (void)
 	gboolean ret;
 	gsize sz = 0;
 	guint32 attr = 0;
+	guint hits = 0;
+	guint hits_old = 0;
 	g_autofree guint8 *data = NULL;
+	g_autofree guint8 *data2 = NULL;
 	g_autoptr(GError) error = NULL;
 
 	/* check supported */
@@ -1669,6 +2617,17 @@ fu_efivar_func (void)
 				   FU_EFIVAR_ATTR_RUNTIME_ACCESS);
 	g_assert_cmpint (data[0], ==, '1');
 
+	/* read it again, this time from the cache */
+	fu_efivar_get_cache_stats (&hits_old, NULL);
+	ret = fu_efivar_get_data (FU_EFIVAR_GUID_EFI_GLOBAL, "Test",
+				     &data2, &sz, &attr, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (sz, ==, 1);
+	g_assert_cmpint (data2[0], ==, '1');
+	fu_efivar_get_cache_stats (&hits, NULL);
+	g_assert_cmpint (hits, ==, hits_old + 1);
+
 	/* delete single key */
 	ret = fu_efivar_delete (FU_EFIVAR_GUID_EFI_GLOBAL, "Test", &error);
 	g_assert_no_error (error);
@@ -1765,6 +2724,31 @@ fu_device_retry_failed_func (void)
 	g_assert_cmpint (helper.cnt_failed, ==, 3);
 }
 
+static void
+fu_device_progress_phases_func (void)
+{
+	g_autoptr(FuDevice) device = fu_device_new ();
+
+	/* erase takes a quarter of the time */
+	fu_device_add_progress_phase (device, "erase", 1);
+	fu_device_add_progress_phase (device, "write", 3);
+	fu_device_set_progress_phase (device, "erase");
+	g_assert_cmpint (fu_device_get_progress (device), ==, 0);
+	fu_device_set_progress (device, 50);
+	g_assert_cmpint (fu_device_get_progress (device), ==, 12);
+	fu_device_set_progress_phase (device, "write");
+	g_assert_cmpint (fu_device_get_progress (device), ==, 25);
+	fu_device_set_progress_full (device, 2, 4);
+	g_assert_cmpint (fu_device_get_progress (device), ==, 62);
+	fu_device_set_progress (device, 100);
+	g_assert_cmpint (fu_device_get_progress (device), ==, 100);
+
+	/* no phases */
+	fu_device_clear_progress_phases (device);
+	fu_device_set_progress (device, 40);
+	g_assert_cmpint (fu_device_get_progress (device), ==, 40);
+}
+
 static void
 fu_device_retry_hardware_func (void)
 {
@@ -1780,6 +2764,59 @@ fu_device_retry_hardware_func (void)
 	g_assert_true (ret);
 	g_assert_cmpint (helper.cnt_success, ==, 1);
 	g_assert_cmpint (helper.cnt_failed, ==, 2);
+	g_assert_cmpint (fu_device_get_retry_count (device), ==, 2);
+}
+
+static void
+fu_device_retry_backoff_policy_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	FuDeviceRetryHelper helper = {
+		.cnt_success = 0,
+		.cnt_failed = 0,
+	};
+
+	/* 10ms then 30ms, rather than 10ms then 10ms */
+	fu_device_retry_set_delay (device, 10);
+	fu_device_retry_set_backoff (device, 3, 30);
+	fu_device_retry_set_jitter (device, 10);
+	ret = fu_device_retry (device, fu_device_retry_success_3rd_try, 3, &helper, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+	g_assert_cmpfloat (elapsed, >=, 9 + 27);
+	g_assert_cmpint (fu_device_get_retry_count (device), ==, 2);
+}
+
+static void
+fu_device_retry_backoff_func (void)
+{
+	gboolean ret;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(GError) error = NULL;
+	FuDeviceRetryHelper helper = {
+		.cnt_success = 0,
+		.cnt_failed = 0,
+	};
+
+	/* ready on the 3rd poll */
+	ret = fu_device_retry_with_backoff (device, fu_device_retry_success_3rd_try,
+					    1, 1000, &helper, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (helper.cnt_success, ==, 1);
+	g_assert_cmpint (helper.cnt_failed, ==, 2);
+
+	/* never ready */
+	ret = fu_device_retry_with_backoff (device, fu_device_retry_failed,
+					    1, 20, &helper, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL);
+	g_assert_false (ret);
+	g_assert_cmpint (helper.cnt_failed, >, 2);
 }
 
 static void
@@ -1893,20 +2930,38 @@ main (int argc, char **argv)
 	g_setenv ("FWUPD_LOCALSTATEDIR", "/tmp/fwupd-self-test/var", TRUE);
 
 	g_test_add_func ("/fwupd/security-attrs{hsi}", fu_security_attrs_hsi_func);
+	g_test_add_func ("/fwupd/file-watch", fu_file_watch_func);
 	g_test_add_func ("/fwupd/plugin{delay}", fu_plugin_delay_func);
 	g_test_add_func ("/fwupd/plugin{quirks}", fu_plugin_quirks_func);
 	g_test_add_func ("/fwupd/plugin{quirks-performance}", fu_plugin_quirks_performance_func);
 	g_test_add_func ("/fwupd/plugin{quirks-device}", fu_plugin_quirks_device_func);
+	g_test_add_func ("/fwupd/plugin{quirks-compile}", fu_plugin_quirks_compile_func);
 	g_test_add_func ("/fwupd/chunk", fu_chunk_func);
+	g_test_add_func ("/fwupd/chunk{iter}", fu_chunk_iter_func);
+	g_test_add_func ("/fwupd/chunk{diff}", fu_chunk_diff_func);
 	g_test_add_func ("/fwupd/common{string-append-kv}", fu_common_string_append_kv_func);
 	g_test_add_func ("/fwupd/common{version-guess-format}", fu_common_version_guess_format_func);
 	g_test_add_func ("/fwupd/common{version}", fu_common_version_func);
 	g_test_add_func ("/fwupd/common{vercmp}", fu_common_vercmp_func);
+	g_test_add_func ("/fwupd/common{version-compare}", fu_common_version_compare_func);
+	g_test_add_func ("/fwupd/common{crc}", fu_common_crc_func);
+	g_test_add_func ("/fwupd/common{acpi-table}", fu_common_acpi_table_func);
+	g_test_add_func ("/fwupd/common{cpuid}", fu_common_cpuid_func);
+	g_test_add_func ("/fwupd/jcat-cache", fu_jcat_cache_func);
+	g_test_add_func ("/fwupd/common{debug-enabled}", fu_common_debug_enabled_func);
+	g_test_add_func ("/fwupd/common{bytes-find}", fu_common_bytes_find_func);
+	g_test_add_func ("/fwupd/common{get-contents-fd-sealed}", fu_common_get_contents_fd_sealed_func);
+	g_test_add_func ("/fwupd/common{checksums}", fu_common_checksums_func);
+	g_test_add_func ("/fwupd/io-channel{read-until}", fu_io_channel_read_until_func);
+	g_test_add_func ("/fwupd/io-recording", fu_io_recording_func);
+	g_test_add_func ("/fwupd/trace", fu_trace_func);
+	g_test_add_func ("/fwupd/metrics", fu_metrics_func);
 	g_test_add_func ("/fwupd/common{strstrip}", fu_common_strstrip_func);
 	g_test_add_func ("/fwupd/common{endian}", fu_common_endian_func);
 	g_test_add_func ("/fwupd/common{cab-success}", fu_common_store_cab_func);
 	g_test_add_func ("/fwupd/common{cab-success-unsigned}", fu_common_store_cab_unsigned_func);
 	g_test_add_func ("/fwupd/common{cab-success-folder}", fu_common_store_cab_folder_func);
+	g_test_add_func ("/fwupd/common{cab-success-extract-payloads}", fu_common_store_cab_extract_payloads_func);
 	g_test_add_func ("/fwupd/common{cab-error-no-metadata}", fu_common_store_cab_error_no_metadata_func);
 	g_test_add_func ("/fwupd/common{cab-error-wrong-size}", fu_common_store_cab_error_wrong_size_func);
 	g_test_add_func ("/fwupd/common{cab-error-wrong-checksum}", fu_common_store_cab_error_wrong_checksum_func);
@@ -1915,6 +2970,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{spawn)", fu_common_spawn_func);
 	g_test_add_func ("/fwupd/common{spawn-timeout)", fu_common_spawn_timeout_func);
 	g_test_add_func ("/fwupd/common{firmware-builder}", fu_common_firmware_builder_func);
+	g_test_add_func ("/fwupd/firmware-builder", fu_firmware_builder_func);
 	g_test_add_func ("/fwupd/common{kernel-lockdown}", fu_common_kernel_lockdown_func);
 	g_test_add_func ("/fwupd/efivar", fu_efivar_func);
 	g_test_add_func ("/fwupd/hwids", fu_hwids_func);
@@ -1924,6 +2980,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/firmware{ihex}", fu_firmware_ihex_func);
 	g_test_add_func ("/fwupd/firmware{ihex-offset}", fu_firmware_ihex_offset_func);
 	g_test_add_func ("/fwupd/firmware{ihex-signed}", fu_firmware_ihex_signed_func);
+	g_test_add_func ("/fwupd/firmware{ihex-records}", fu_firmware_ihex_records_func);
 	g_test_add_func ("/fwupd/firmware{srec-tokenization}", fu_firmware_srec_tokenization_func);
 	g_test_add_func ("/fwupd/firmware{srec}", fu_firmware_srec_func);
 	g_test_add_func ("/fwupd/firmware{dfu}", fu_firmware_dfu_func);
@@ -1932,15 +2989,21 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/device{flags}", fu_device_flags_func);
 	g_test_add_func ("/fwupd/device{parent}", fu_device_parent_func);
 	g_test_add_func ("/fwupd/device{incorporate}", fu_device_incorporate_func);
+	g_test_add_func ("/fwupd/device{incorporate-shared}", fu_device_incorporate_shared_func);
+	g_test_add_func ("/fwupd/device{snapshot}", fu_device_snapshot_func);
 	if (g_test_slow ())
 		g_test_add_func ("/fwupd/device{poll}", fu_device_poll_func);
 	g_test_add_func ("/fwupd/device-locker{success}", fu_device_locker_func);
 	g_test_add_func ("/fwupd/device-locker{fail}", fu_device_locker_fail_func);
 	g_test_add_func ("/fwupd/device{metadata}", fu_device_metadata_func);
 	g_test_add_func ("/fwupd/device{open-refcount}", fu_device_open_refcount_func);
+	g_test_add_func ("/fwupd/device{packet-buffer}", fu_device_packet_buffer_func);
 	g_test_add_func ("/fwupd/device{version-format}", fu_device_version_format_func);
+	g_test_add_func ("/fwupd/device{progress-phases}", fu_device_progress_phases_func);
 	g_test_add_func ("/fwupd/device{retry-success}", fu_device_retry_success_func);
 	g_test_add_func ("/fwupd/device{retry-failed}", fu_device_retry_failed_func);
 	g_test_add_func ("/fwupd/device{retry-hardware}", fu_device_retry_hardware_func);
+	g_test_add_func ("/fwupd/device{retry-backoff}", fu_device_retry_backoff_func);
+	g_test_add_func ("/fwupd/device{retry-backoff-policy}", fu_device_retry_backoff_policy_func);
 	return g_test_run ();
 }
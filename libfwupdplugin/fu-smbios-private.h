@@ -18,3 +18,5 @@ gboolean	 fu_smbios_setup_from_path	(FuSmbios	*self,
 gboolean	 fu_smbios_setup_from_file	(FuSmbios	*self,
 						 const gchar	*filename,
 						 GError		**error);
+gchar		*fu_smbios_get_checksum		(FuSmbios	*self,
+						 GChecksumType	 checksum_type);
@@ -19,7 +19,9 @@ struct _FuSmbios {
 	GObject			 parent_instance;
 	gchar			*smbios_ver;
 	guint32			 structure_table_len;
+	GBytes			*blob;		/* (nullable): the whole table */
 	GPtrArray		*items;
+	GPtrArray		*items_by_type[0x100];	/* (nullable): of FuSmbiosItem, no ref */
 };
 
 /* little endian */
@@ -64,24 +66,34 @@ typedef struct __attribute__((packed)) {
 typedef struct {
 	guint8			 type;
 	guint16			 handle;
-	GBytes			*data;
-	GPtrArray		*strings;
+	GBytes			*data;		/* slice of the table */
+	GArray			*strings;	/* of guint32 offset into the table */
 } FuSmbiosItem;
 
 G_DEFINE_TYPE (FuSmbios, fu_smbios, G_TYPE_OBJECT)
 
+/* the items and strings all reference the table rather than copy from it */
 static gboolean
-fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError **error)
+fu_smbios_setup_from_bytes (FuSmbios *self, GBytes *blob, GError **error)
 {
+	gsize sz = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &sz);
+
+	if (self->blob != NULL)
+		g_bytes_unref (self->blob);
+	self->blob = g_bytes_ref (blob);
+
 	/* go through each structure */
 	for (gsize i = 0; i < sz; i++) {
 		FuSmbiosStructure *str = (FuSmbiosStructure *) &buf[i];
 		FuSmbiosItem *item;
 
 		/* invalid */
+		if (i + sizeof(FuSmbiosStructure) > sz)
+			break;
 		if (str->len == 0x00)
 			break;
-		if (str->len >= sz) {
+		if (i + str->len >= sz) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
@@ -93,13 +105,16 @@ fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError *
 		item = g_new0 (FuSmbiosItem, 1);
 		item->type = str->type;
 		item->handle = GUINT16_FROM_LE (str->handle);
-		item->data = g_bytes_new (buf + i, str->len);
-		item->strings = g_ptr_array_new_with_free_func (g_free);
+		item->data = g_bytes_new_from_bytes (blob, i, str->len);
+		item->strings = g_array_new (FALSE, FALSE, sizeof(guint32));
 		g_ptr_array_add (self->items, item);
+		if (self->items_by_type[item->type] == NULL)
+			self->items_by_type[item->type] = g_ptr_array_new ();
+		g_ptr_array_add (self->items_by_type[item->type], item);
 
 		/* jump to the end of the struct */
 		i += str->len;
-		if (buf[i] == '\0' && buf[i+1] == '\0') {
+		if (i + 1 < sz && buf[i] == '\0' && buf[i+1] == '\0') {
 			i++;
 			continue;
 		}
@@ -107,10 +122,10 @@ fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError *
 		/* add strings from table */
 		for (gsize start_offset = i; i < sz; i++) {
 			if (buf[i] == '\0') {
+				guint32 offset = (guint32) start_offset;
 				if (start_offset == i)
 					break;
-				g_ptr_array_add (item->strings,
-						 g_strdup ((const gchar *) &buf[start_offset]));
+				g_array_append_val (item->strings, offset);
 				start_offset = i + 1;
 			}
 		}
@@ -133,11 +148,16 @@ fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError *
 gboolean
 fu_smbios_setup_from_file (FuSmbios *self, const gchar *filename, GError **error)
 {
-	gsize sz = 0;
-	g_autofree gchar *buf = NULL;
-	if (!g_file_get_contents (filename, &buf, &sz, error))
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+
+	g_return_val_if_fail (FU_IS_SMBIOS (self), FALSE);
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+	if (mapped_file == NULL)
 		return FALSE;
-	return fu_smbios_setup_from_data (self, (guint8 *) buf, sz, error);
+	blob = g_mapped_file_get_bytes (mapped_file);
+	return fu_smbios_setup_from_bytes (self, blob, error);
 }
 
 static gboolean
@@ -245,9 +265,10 @@ gboolean
 fu_smbios_setup_from_path (FuSmbios *self, const gchar *path, GError **error)
 {
 	gsize sz = 0;
+	gchar *dmi_raw = NULL;
 	g_autofree gchar *dmi_fn = NULL;
-	g_autofree gchar *dmi_raw = NULL;
 	g_autofree gchar *ep_fn = NULL;
+	g_autoptr(GBytes) dmi_blob = NULL;
 	g_autofree gchar *ep_raw = NULL;
 
 	g_return_val_if_fail (FU_IS_SMBIOS (self), FALSE);
@@ -286,10 +307,12 @@ fu_smbios_setup_from_path (FuSmbios *self, const gchar *path, GError **error)
 		return FALSE;
 	}
 
-	/* get the DMI data */
+	/* get the DMI data; sysfs binary attributes cannot be mapped so this
+	 * is read once and then referenced by all the items and strings */
 	dmi_fn = g_build_filename (path, "DMI", NULL);
 	if (!g_file_get_contents (dmi_fn, &dmi_raw, &sz, error))
 		return FALSE;
+	dmi_blob = g_bytes_new_take (dmi_raw, sz);
 	if (sz != self->structure_table_len) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -301,7 +324,7 @@ fu_smbios_setup_from_path (FuSmbios *self, const gchar *path, GError **error)
 	}
 
 	/* parse blob */
-	return fu_smbios_setup_from_data (self, (guint8 *) dmi_raw, sz, error);
+	return fu_smbios_setup_from_bytes (self, dmi_blob, error);
 }
 
 /**
@@ -326,6 +349,14 @@ fu_smbios_setup (FuSmbios *self, GError **error)
 	return fu_smbios_setup_from_path (self, path, error);
 }
 
+/* strings are always NUL terminated inside the table */
+static const gchar *
+fu_smbios_item_get_string (FuSmbios *self, FuSmbiosItem *item, guint idx)
+{
+	const guint8 *buf = g_bytes_get_data (self->blob, NULL);
+	return (const gchar *) buf + g_array_index (item->strings, guint32, idx);
+}
+
 /**
  * fu_smbios_to_string:
  * @self: A #FuSmbios
@@ -352,7 +383,7 @@ fu_smbios_to_string (FuSmbios *self)
 					g_bytes_get_size (item->data));
 		g_string_append_printf (str, " Handle: 0x%04x\n", item->handle);
 		for (guint j = 0; j < item->strings->len; j++) {
-			const gchar *tmp = g_ptr_array_index (item->strings, j);
+			const gchar *tmp = fu_smbios_item_get_string (self, item, j);
 			g_string_append_printf (str, "  String[%02u]: %s\n", j, tmp);
 		}
 	}
@@ -362,12 +393,9 @@ fu_smbios_to_string (FuSmbios *self)
 static FuSmbiosItem *
 fu_smbios_get_item_for_type (FuSmbios *self, guint8 type)
 {
-	for (guint i = 0; i < self->items->len; i++) {
-		FuSmbiosItem *item = g_ptr_array_index (self->items, i);
-		if (item->type == type)
-			return item;
-	}
-	return NULL;
+	if (self->items_by_type[type] == NULL)
+		return NULL;
+	return g_ptr_array_index (self->items_by_type[type], 0);
 }
 
 /**
@@ -398,6 +426,27 @@ fu_smbios_get_data (FuSmbios *self, guint8 type, GError **error)
 	return g_bytes_ref (item->data);
 }
 
+/**
+ * fu_smbios_get_checksum:
+ * @self: A #FuSmbios
+ * @checksum_type: A #GChecksumType, e.g. %G_CHECKSUM_SHA256
+ *
+ * Gets a checksum of the entire SMBIOS table, which changes when the firmware
+ * is updated or reconfigured.
+ *
+ * Returns: a checksum, or %NULL if no table has been loaded
+ *
+ * Since: 1.5.0
+ **/
+gchar *
+fu_smbios_get_checksum (FuSmbios *self, GChecksumType checksum_type)
+{
+	g_return_val_if_fail (FU_IS_SMBIOS (self), NULL);
+	if (self->blob == NULL)
+		return NULL;
+	return g_compute_checksum_for_bytes (checksum_type, self->blob);
+}
+
 /**
  * fu_smbios_get_string:
  * @self: A #FuSmbios
@@ -459,14 +508,14 @@ fu_smbios_get_string (FuSmbios *self, guint8 type, guint8 offset, GError **error
 			     data[offset]);
 		return NULL;
 	}
-	return g_ptr_array_index (item->strings, data[offset] - 1);
+	return fu_smbios_item_get_string (self, item, data[offset] - 1);
 }
 
 static void
 fu_smbios_item_free (FuSmbiosItem *item)
 {
 	g_bytes_unref (item->data);
-	g_ptr_array_unref (item->strings);
+	g_array_unref (item->strings);
 	g_free (item);
 }
 
@@ -475,7 +524,13 @@ fu_smbios_finalize (GObject *object)
 {
 	FuSmbios *self = FU_SMBIOS (object);
 	g_free (self->smbios_ver);
+	for (guint i = 0; i < G_N_ELEMENTS (self->items_by_type); i++) {
+		if (self->items_by_type[i] != NULL)
+			g_ptr_array_unref (self->items_by_type[i]);
+	}
 	g_ptr_array_unref (self->items);
+	if (self->blob != NULL)
+		g_bytes_unref (self->blob);
 	G_OBJECT_CLASS (fu_smbios_parent_class)->finalize (object);
 }
 
@@ -90,6 +90,9 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 	gsize sz = 0;
 	g_auto(GStrv) lines = NULL;
 
+	/* the same object may be used to parse more than one blob */
+	g_ptr_array_set_size (self->records, 0);
+
 	/* parse records */
 	data = g_bytes_get_data (fw, &sz);
 	lines = fu_common_strnsplit (data, sz, "\n", -1);
@@ -0,0 +1,267 @@
+#!/usr/bin/python3
+""" Builds a header of inline accessors from a binary struct description """
+
+# pylint: disable=invalid-name,wrong-import-position,pointless-string-statement
+
+"""
+SPDX-License-Identifier: LGPL-2.1+
+"""
+
+# The description is a list of structs, each with one field per line:
+#
+#   # EFI_SIGNATURE_LIST
+#   struct FuUefiDbxSignatureList {
+#       signature_type: guid
+#       list_size: u32le
+#       header_size: u32le
+#       size: u32le
+#   }
+#
+# Supported types are u8, u16le, u16be, u32le, u32be, u64le, u64be, guid and
+# fixed size arrays of those, e.g. u32le[4] or char[16]. Scalar fields can be
+# given a constant value, e.g. `signature: u32le == 0x54435746`, which is
+# checked by the generated validate() functions.
+
+import re
+import sys
+
+TYPES = {
+    'u8': (1, 'guint8', None),
+    'u16le': (2, 'guint16', 'GUINT16_FROM_LE'),
+    'u16be': (2, 'guint16', 'GUINT16_FROM_BE'),
+    'u32le': (4, 'guint32', 'GUINT32_FROM_LE'),
+    'u32be': (4, 'guint32', 'GUINT32_FROM_BE'),
+    'u64le': (8, 'guint64', 'GUINT64_FROM_LE'),
+    'u64be': (8, 'guint64', 'GUINT64_FROM_BE'),
+    'guid': (16, None, None),
+    'char': (1, None, None),
+}
+
+
+class Field:
+    def __init__(self, name, kind, n_elements, constant, offset):
+        self.name = name
+        self.kind = kind
+        self.n_elements = n_elements
+        self.constant = constant
+        self.offset = offset
+
+    @property
+    def size(self):
+        return TYPES[self.kind][0] * max(self.n_elements, 1)
+
+
+class Struct:
+    def __init__(self, name):
+        self.name = name
+        self.fields = []
+        self.size = 0
+
+    @property
+    def prefix(self):
+        return re.sub(r'(?<!^)(?=[A-Z])', '_', self.name).lower()
+
+    def add_field(self, name, kind, n_elements, constant):
+        field = Field(name, kind, n_elements, constant, self.size)
+        self.fields.append(field)
+        self.size += field.size
+
+
+def parse(filename):
+    structs = []
+    struct = None
+    with open(filename) as f:
+        for lineno, line in enumerate(f, 1):
+            line = line.split('#')[0].strip()
+            if not line:
+                continue
+            where = '%s:%u' % (filename, lineno)
+            m = re.match(r'^struct\s+([A-Za-z0-9]+)\s*{$', line)
+            if m:
+                if struct is not None:
+                    raise ValueError('%s: nested struct' % where)
+                struct = Struct(m.group(1))
+                continue
+            if line == '}':
+                if struct is None or not struct.fields:
+                    raise ValueError('%s: unexpected end of struct' % where)
+                structs.append(struct)
+                struct = None
+                continue
+            m = re.match(r'^([a-z0-9_]+)\s*:\s*([a-z0-9]+)(?:\[(\d+)\])?'
+                         r'(?:\s*==\s*(\S+))?$', line)
+            if not m or struct is None:
+                raise ValueError('%s: invalid line: %s' % (where, line))
+            name, kind, n_elements, constant = m.groups()
+            if kind not in TYPES:
+                raise ValueError('%s: unknown type %s' % (where, kind))
+            if kind == 'char' and n_elements is None:
+                raise ValueError('%s: char must be an array' % where)
+            if constant is not None and \
+                    (n_elements is not None or TYPES[kind][1] is None):
+                raise ValueError('%s: only integers can be constant' % where)
+            struct.add_field(name, kind, int(n_elements or 0), constant)
+    if struct is not None:
+        raise ValueError('%s: missing end of struct' % filename)
+    return structs
+
+
+def write_struct(out, struct):
+    prefix = struct.prefix
+    upper = prefix.upper()
+
+    out.append('/* %s */' % struct.name)
+    out.append('#define %s_SIZE\t\t0x%x' % (upper, struct.size))
+    for field in struct.fields:
+        out.append('#define %s_OFFSET_%s\t0x%x' %
+                   (upper, field.name.upper(), field.offset))
+        if field.n_elements:
+            out.append('#define %s_%s_LEN\t%u' %
+                       (upper, field.name.upper(), field.n_elements))
+    out.append('')
+
+    # getters
+    for field in struct.fields:
+        size, ctype, swap = TYPES[field.kind]
+        if field.kind == 'guid':
+            if field.n_elements:
+                out.append('static inline const fwupd_guid_t *')
+                out.append('%s_get_%s (const guint8 *st, guint idx)' % (prefix, field.name))
+                out.append('{')
+                out.append('\treturn (const fwupd_guid_t *) (st + 0x%x + idx * %u);' %
+                           (field.offset, size))
+            else:
+                out.append('static inline const fwupd_guid_t *')
+                out.append('%s_get_%s (const guint8 *st)' % (prefix, field.name))
+                out.append('{')
+                out.append('\treturn (const fwupd_guid_t *) (st + 0x%x);' % field.offset)
+            out.append('}')
+            out.append('')
+            continue
+        if field.kind == 'char':
+            out.append('/* not NUL terminated */')
+            out.append('static inline const gchar *')
+            out.append('%s_get_%s (const guint8 *st)' % (prefix, field.name))
+            out.append('{')
+            out.append('\treturn (const gchar *) (st + 0x%x);' % field.offset)
+            out.append('}')
+            out.append('')
+            continue
+
+        # integers, possibly with an index
+        if field.n_elements:
+            out.append('static inline %s' % ctype)
+            out.append('%s_get_%s (const guint8 *st, guint idx)' % (prefix, field.name))
+            ptr = 'st + 0x%x + idx * %u' % (field.offset, size)
+        else:
+            out.append('static inline %s' % ctype)
+            out.append('%s_get_%s (const guint8 *st)' % (prefix, field.name))
+            ptr = 'st + 0x%x' % field.offset
+        out.append('{')
+        if swap is None:
+            out.append('\treturn *(%s);' % ptr)
+        else:
+            out.append('\t%s tmp;' % ctype)
+            out.append('\tmemcpy (&tmp, %s, sizeof(tmp));' % ptr)
+            out.append('\treturn %s (tmp);' % swap)
+        out.append('}')
+        out.append('')
+
+        # decode the whole array at once
+        if field.n_elements:
+            out.append('static inline void')
+            out.append('%s_get_%s_array (const guint8 *st, %s *dst)' %
+                       (prefix, field.name, ctype))
+            out.append('{')
+            out.append('\tmemcpy (dst, st + 0x%x, %u);' % (field.offset, field.size))
+            if swap is not None:
+                out.append('#if G_BYTE_ORDER != G_%s_ENDIAN' %
+                           ('LITTLE' if field.kind.endswith('le') else 'BIG'))
+                out.append('\tfor (guint i = 0; i < %u; i++)' % field.n_elements)
+                out.append('\t\tdst[i] = %s (dst[i]);' % swap)
+                out.append('#endif')
+            out.append('}')
+            out.append('')
+
+    # check the constant fields of one struct that is known to be in bounds
+    constants = [field for field in struct.fields if field.constant is not None]
+    out.append('static inline gboolean')
+    out.append('%s_validate_constants (const guint8 *st, GError **error)' % prefix)
+    out.append('{')
+    if not constants:
+        out.append('\treturn TRUE;')
+    for field in constants:
+        out.append('\tif (%s_get_%s (st) != %s) {' % (prefix, field.name, field.constant))
+        out.append('\t\tg_set_error (error,')
+        out.append('\t\t\t     FWUPD_ERROR,')
+        out.append('\t\t\t     FWUPD_ERROR_INVALID_FILE,')
+        out.append('\t\t\t     "%s.%s was not valid, "' % (struct.name, field.name))
+        out.append('\t\t\t     "expected 0x%%" G_GINT64_MODIFIER "x and got 0x%%" G_GINT64_MODIFIER "x",')
+        out.append('\t\t\t     (guint64) %s,' % field.constant)
+        out.append('\t\t\t     (guint64) %s_get_%s (st));' % (prefix, field.name))
+        out.append('\t\treturn FALSE;')
+        out.append('\t}')
+    if constants:
+        out.append('\treturn TRUE;')
+    out.append('}')
+    out.append('')
+
+    # one bounds check for any number of consecutive structs
+    out.append('static inline gboolean')
+    out.append('%s_validate_n (const guint8 *buf, gsize bufsz, gsize offset, gsize n, GError **error)' % prefix)
+    out.append('{')
+    out.append('\tif (offset > bufsz || n > (bufsz - offset) / %s_SIZE) {' % upper)
+    out.append('\t\tg_set_error (error,')
+    out.append('\t\t\t     FWUPD_ERROR,')
+    out.append('\t\t\t     FWUPD_ERROR_READ,')
+    out.append('\t\t\t     "attempted to read %%" G_GSIZE_FORMAT " %s at offset 0x%%" G_GSIZE_MODIFIER "x from buffer of 0x%%" G_GSIZE_MODIFIER "x",' % struct.name)
+    out.append('\t\t\t     n, offset, bufsz);')
+    out.append('\t\treturn FALSE;')
+    out.append('\t}')
+    if constants:
+        out.append('\tfor (gsize i = 0; i < n; i++) {')
+        out.append('\t\tif (!%s_validate_constants (buf + offset + i * %s_SIZE, error))' % (prefix, upper))
+        out.append('\t\t\treturn FALSE;')
+        out.append('\t}')
+    out.append('\treturn TRUE;')
+    out.append('}')
+    out.append('')
+
+    out.append('static inline gboolean')
+    out.append('%s_validate (const guint8 *buf, gsize bufsz, gsize offset, GError **error)' % prefix)
+    out.append('{')
+    out.append('\treturn %s_validate_n (buf, bufsz, offset, 1, error);' % prefix)
+    out.append('}')
+    out.append('')
+
+
+def usage(return_code):
+    """ print usage and exit with the supplied return code """
+    if return_code == 0:
+        out = sys.stdout
+    else:
+        out = sys.stderr
+    out.write("usage: fu-struct.py <INPUT> <HEADER>")
+    sys.exit(return_code)
+
+
+if __name__ == '__main__':
+    if {'-?', '--help', '--usage'}.intersection(set(sys.argv)):
+        usage(0)
+    if len(sys.argv) != 3:
+        usage(1)
+    try:
+        structs = parse(sys.argv[1])
+    except ValueError as e:
+        sys.stderr.write('%s\n' % str(e))
+        sys.exit(1)
+    lines = ['/* generated by fu-struct.py, do not edit */',
+             '#pragma once',
+             '',
+             '#include <string.h>',
+             '#include <fwupd.h>',
+             '']
+    for struct in structs:
+        write_struct(lines, struct)
+    with open(sys.argv[2], 'w') as f2:
+        f2.write('\n'.join(lines))
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuTrace"
+
+#include <config.h>
+
+#include "fu-trace.h"
+
+/**
+ * SECTION:fu-trace
+ * @short_description: record where time is spent
+ *
+ * Spans are recorded into a fixed-size ring buffer shared by the whole
+ * process, so the oldest spans are dropped once it is full.
+ */
+
+#define FU_TRACE_RING_SIZE			4096
+
+struct _FuTraceSpan {
+	gchar		*category;
+	gchar		*name;
+	gint64		 start;		/* monotonic, in µs */
+	gint64		 duration;	/* µs */
+	guint		 thread_id;
+};
+
+static FuTraceSpan	 fu_trace_ring[FU_TRACE_RING_SIZE];
+static guint		 fu_trace_ring_idx = 0;		/* next to write */
+static guint		 fu_trace_ring_len = 0;
+static GMutex		 fu_trace_mutex;
+static GPrivate		 fu_trace_thread_id;
+static gint		 fu_trace_thread_cnt = 0;
+
+static guint
+fu_trace_get_thread_id (void)
+{
+	gpointer tid = g_private_get (&fu_trace_thread_id);
+	if (tid == NULL) {
+		tid = GINT_TO_POINTER (g_atomic_int_add (&fu_trace_thread_cnt, 1) + 1);
+		g_private_set (&fu_trace_thread_id, tid);
+	}
+	return GPOINTER_TO_UINT (tid);
+}
+
+/**
+ * fu_trace_span_new:
+ * @category: a category, e.g. `plugin`
+ * @format: the printf-style span name, e.g. `%s:coldplug`
+ * @...: the format arguments
+ *
+ * Starts a span, which is recorded when it is freed. This is typically used
+ * with g_autoptr() so that all the return paths are included.
+ *
+ * Returns: (transfer full): a #FuTraceSpan
+ *
+ * Since: 1.5.0
+ **/
+FuTraceSpan *
+fu_trace_span_new (const gchar *category, const gchar *format, ...)
+{
+	FuTraceSpan *span = g_new0 (FuTraceSpan, 1);
+	va_list args;
+
+	va_start (args, format);
+	span->name = g_strdup_vprintf (format, args);
+	va_end (args);
+	span->category = g_strdup (category);
+	span->thread_id = fu_trace_get_thread_id ();
+	span->start = g_get_monotonic_time ();
+	return span;
+}
+
+/**
+ * fu_trace_span_free:
+ * @span: a #FuTraceSpan
+ *
+ * Finishes a span and adds it to the ring buffer.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_trace_span_free (FuTraceSpan *span)
+{
+	FuTraceSpan *slot;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (span != NULL);
+
+	span->duration = g_get_monotonic_time () - span->start;
+	locker = g_mutex_locker_new (&fu_trace_mutex);
+	slot = &fu_trace_ring[fu_trace_ring_idx];
+	g_free (slot->category);
+	g_free (slot->name);
+	*slot = *span;
+	fu_trace_ring_idx = (fu_trace_ring_idx + 1) % FU_TRACE_RING_SIZE;
+	if (fu_trace_ring_len < FU_TRACE_RING_SIZE)
+		fu_trace_ring_len++;
+	g_free (span);
+}
+
+/**
+ * fu_trace_to_variant:
+ *
+ * Exports all the recorded spans, oldest first, as an array of
+ * category, name, start, duration and thread ID.
+ *
+ * Returns: a #GVariant of type `(a(ssxxu))`
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fu_trace_to_variant (void)
+{
+	GVariantBuilder builder;
+	guint idx;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_trace_mutex);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssxxu)"));
+	idx = (fu_trace_ring_idx + FU_TRACE_RING_SIZE - fu_trace_ring_len) % FU_TRACE_RING_SIZE;
+	for (guint i = 0; i < fu_trace_ring_len; i++) {
+		FuTraceSpan *span = &fu_trace_ring[(idx + i) % FU_TRACE_RING_SIZE];
+		g_variant_builder_add (&builder, "(ssxxu)",
+				       span->category,
+				       span->name,
+				       span->start,
+				       span->duration,
+				       span->thread_id);
+	}
+	return g_variant_new ("(a(ssxxu))", &builder);
+}
+
+/**
+ * fu_trace_clear:
+ *
+ * Removes all the recorded spans.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_trace_clear (void)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&fu_trace_mutex);
+	for (guint i = 0; i < FU_TRACE_RING_SIZE; i++) {
+		g_clear_pointer (&fu_trace_ring[i].category, g_free);
+		g_clear_pointer (&fu_trace_ring[i].name, g_free);
+	}
+	fu_trace_ring_idx = 0;
+	fu_trace_ring_len = 0;
+}
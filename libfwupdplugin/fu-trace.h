@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib.h>
+
+typedef struct _FuTraceSpan FuTraceSpan;
+
+FuTraceSpan	*fu_trace_span_new			(const gchar	*category,
+							 const gchar	*format,
+							 ...) G_GNUC_PRINTF (2, 3);
+void		 fu_trace_span_free			(FuTraceSpan	*span);
+GVariant	*fu_trace_to_variant			(void);
+void		 fu_trace_clear				(void);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuTraceSpan, fu_trace_span_free)
@@ -847,8 +847,9 @@ fu_udev_device_open (FuDevice *device, GError **error)
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
 	FuUdevDeviceClass *klass = FU_UDEV_DEVICE_GET_CLASS (device);
 
-	/* open device */
-	if (priv->device_file != NULL && priv->flags != FU_UDEV_DEVICE_FLAG_NONE) {
+	/* open device, unless the I/O is answered from a recording */
+	if (priv->device_file != NULL && priv->flags != FU_UDEV_DEVICE_FLAG_NONE &&
+	    !fu_io_recording_is_replay (fu_device_get_io_recording (device))) {
 		gint flags;
 		if (priv->flags & FU_UDEV_DEVICE_FLAG_OPEN_READ &&
 		    priv->flags & FU_UDEV_DEVICE_FLAG_OPEN_WRITE) {
@@ -927,29 +928,60 @@ fu_udev_device_ioctl (FuUdevDevice *self,
 {
 #ifdef HAVE_IOCTL_H
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	FuIoRecording *io_recording = fu_device_get_io_recording (FU_DEVICE (self));
 	gint rc_tmp;
+	gint64 start_time = 0;
+	gsize bufsz = 0;
+	g_autofree gchar *id = NULL;
+	g_autofree guint8 *tx = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
 	g_return_val_if_fail (request != 0x0, FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
+
+	/* the kernel encodes the buffer size in most requests */
+	if (io_recording != NULL) {
+#ifdef _IOC_SIZE
+		bufsz = _IOC_SIZE (request);
+#endif
+		id = g_strdup_printf ("ioctl:0x%lx", request);
+	}
+	if (fu_io_recording_is_replay (io_recording)) {
+		if (rc != NULL)
+			*rc = 0;
+		return fu_io_recording_replay_full (io_recording, id, buf, bufsz,
+						    buf, bufsz, NULL, error);
+	}
 	g_return_val_if_fail (priv->fd > 0, FALSE);
+	if (io_recording != NULL) {
+		tx = g_memdup (buf, bufsz);
+		start_time = g_get_monotonic_time ();
+	}
 
 	rc_tmp = ioctl (priv->fd, request, buf);
 	if (rc != NULL)
 		*rc = rc_tmp;
 	if (rc_tmp < 0) {
 		if (rc_tmp == -EPERM) {
-			g_set_error_literal (error,
+			g_set_error_literal (&error_local,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_PERMISSION_DENIED,
 					     "permission denied");
-			return FALSE;
+		} else {
+			g_set_error (&error_local,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "ioctl not supported: %s",
+				     strerror (errno));
 		}
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INTERNAL,
-			     "ioctl not supported: %s",
-			     strerror (errno));
+	}
+	if (io_recording != NULL) {
+		fu_io_recording_add (io_recording, id, tx, bufsz, buf, bufsz,
+				     error_local, start_time);
+	}
+	if (error_local != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
 	}
 	return TRUE;
@@ -962,6 +994,44 @@ fu_udev_device_ioctl (FuUdevDevice *self,
 #endif
 }
 
+/**
+ * fu_udev_device_ioctl_batch:
+ * @self: A #FuUdevDevice
+ * @requests: (array length=requests_len): requests to submit in order
+ * @requests_len: number of @requests
+ * @error: A #GError, or %NULL
+ *
+ * Control a device using a sequence of low-level requests, stopping at the
+ * first failure. The raw return value of each ioctl is stored in the request.
+ *
+ * Returns: %TRUE if all the requests succeeded
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_udev_device_ioctl_batch (FuUdevDevice *self,
+			    FuUdevDeviceIoctl *requests,
+			    guint requests_len,
+			    GError **error)
+{
+	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
+	g_return_val_if_fail (requests != NULL || requests_len == 0, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	for (guint i = 0; i < requests_len; i++) {
+		if (!fu_udev_device_ioctl (self,
+					   requests[i].request,
+					   requests[i].buf,
+					   &requests[i].rc,
+					   error)) {
+			g_prefix_error (error, "request %u of %u failed: ",
+					i + 1, requests_len);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /**
  * fu_udev_device_pread_full:
  * @self: A #FuUdevDevice
@@ -982,20 +1052,51 @@ fu_udev_device_pread_full (FuUdevDevice *self, goffset port,
 			   GError **error)
 {
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	FuIoRecording *io_recording = fu_device_get_io_recording (FU_DEVICE (self));
+	gint64 start_time = g_get_monotonic_time ();
+	g_autofree gchar *id = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
 	g_return_val_if_fail (port != 0x0, FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
+
+	/* answered from a recording */
+	if (io_recording != NULL)
+		id = g_strdup_printf ("pread:0x%x", (guint) port);
+	if (fu_io_recording_is_replay (io_recording)) {
+		gsize bufsz_actual = 0;
+		if (!fu_io_recording_replay_full (io_recording, id, NULL, 0,
+						  buf, bufsz, &bufsz_actual, error))
+			return FALSE;
+		if (bufsz_actual != bufsz) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "failed to read from port 0x%04x",
+				     (guint) port);
+			return FALSE;
+		}
+		return TRUE;
+	}
 	g_return_val_if_fail (priv->fd > 0, FALSE);
 
 #ifdef HAVE_PWRITE
 	if (pread (priv->fd, buf, bufsz, port) != (gssize) bufsz) {
-		g_set_error (error,
+		g_set_error (&error_local,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
 			     "failed to read from port 0x%04x: %s",
 			     (guint) port,
 			     strerror (errno));
+	}
+	if (io_recording != NULL) {
+		fu_io_recording_add (io_recording, id, NULL, 0,
+				     buf, error_local == NULL ? bufsz : 0,
+				     error_local, start_time);
+	}
+	if (error_local != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
 	}
 	return TRUE;
@@ -1028,19 +1129,39 @@ fu_udev_device_pwrite_full (FuUdevDevice *self, goffset port,
 			    GError **error)
 {
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	FuIoRecording *io_recording = fu_device_get_io_recording (FU_DEVICE (self));
+	gint64 start_time = g_get_monotonic_time ();
+	g_autofree gchar *id = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
 	g_return_val_if_fail (port != 0x0, FALSE);
+
+	/* answered from a recording */
+	if (io_recording != NULL)
+		id = g_strdup_printf ("pwrite:0x%x", (guint) port);
+	if (fu_io_recording_is_replay (io_recording)) {
+		g_autoptr(GBytes) blob = NULL;
+		blob = fu_io_recording_replay (io_recording, id, buf, bufsz, error);
+		return blob != NULL;
+	}
 	g_return_val_if_fail (priv->fd > 0, FALSE);
 
 #ifdef HAVE_PWRITE
 	if (pwrite (priv->fd, buf, bufsz, port) != (gssize) bufsz) {
-		g_set_error (error,
+		g_set_error (&error_local,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
 			     "failed to write to port %04x: %s",
 			     (guint) port,
 			     strerror (errno));
+	}
+	if (io_recording != NULL) {
+		fu_io_recording_add (io_recording, id, buf, bufsz, NULL, 0,
+				     error_local, start_time);
+	}
+	if (error_local != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
 	}
 	return TRUE;
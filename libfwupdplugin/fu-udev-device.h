@@ -17,6 +17,20 @@
 
 #include "fu-plugin.h"
 
+/**
+ * FuUdevDeviceIoctl:
+ * @request: request number
+ * @buf: A buffer to use, which *must* be large enough for the request
+ * @rc: the raw return value from the ioctl
+ *
+ * A low-level request to submit using fu_udev_device_ioctl_batch().
+ **/
+typedef struct {
+	gulong		 request;
+	guint8		*buf;
+	gint		 rc;
+} FuUdevDeviceIoctl;
+
 #define FU_TYPE_UDEV_DEVICE (fu_udev_device_get_type ())
 G_DECLARE_DERIVABLE_TYPE (FuUdevDevice, fu_udev_device, FU, UDEV_DEVICE, FuDevice)
 
@@ -79,6 +93,10 @@ gboolean	 fu_udev_device_ioctl			(FuUdevDevice	*self,
 							 guint8		*buf,
 							 gint		*rc,
 							 GError		**error);
+gboolean	 fu_udev_device_ioctl_batch		(FuUdevDevice	*self,
+							 FuUdevDeviceIoctl *requests,
+							 guint		 requests_len,
+							 GError		**error);
 gboolean	 fu_udev_device_pwrite			(FuUdevDevice	*self,
 							 goffset	 port,
 							 guint8		 data,
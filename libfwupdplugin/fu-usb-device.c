@@ -8,6 +8,7 @@
 
 #include "config.h"
 
+#include "fu-chunk.h"
 #include "fu-device-private.h"
 #include "fu-usb-device-private.h"
 
@@ -24,6 +25,7 @@ typedef struct
 {
 	GUsbDevice		*usb_device;
 	FuDeviceLocker		*usb_device_locker;
+	gboolean		 replay_open;
 } FuUsbDevicePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuUsbDevice, fu_usb_device, FU_TYPE_DEVICE)
@@ -108,7 +110,7 @@ fu_usb_device_is_open (FuUsbDevice *device)
 {
 	FuUsbDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_val_if_fail (FU_IS_USB_DEVICE (device), FALSE);
-	return priv->usb_device_locker != NULL;
+	return priv->usb_device_locker != NULL || priv->replay_open;
 }
 
 static gboolean
@@ -167,9 +169,19 @@ fu_usb_device_open (FuDevice *device, GError **error)
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	/* already open */
-	if (priv->usb_device_locker != NULL)
+	if (priv->usb_device_locker != NULL || priv->replay_open)
 		return TRUE;
 
+	/* the transfers are answered from a recording */
+	if (fu_io_recording_is_replay (fu_device_get_io_recording (device))) {
+		if (klass->open != NULL) {
+			if (!klass->open (self, error))
+				return FALSE;
+		}
+		priv->replay_open = TRUE;
+		return TRUE;
+	}
+
 	/* open */
 	locker = fu_device_locker_new (priv->usb_device, error);
 	if (locker == NULL)
@@ -281,7 +293,7 @@ fu_usb_device_close (FuDevice *device, GError **error)
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	/* already open */
-	if (priv->usb_device_locker == NULL)
+	if (priv->usb_device_locker == NULL && !priv->replay_open)
 		return TRUE;
 
 	/* subclassed */
@@ -291,6 +303,7 @@ fu_usb_device_close (FuDevice *device, GError **error)
 	}
 
 	g_clear_object (&priv->usb_device_locker);
+	priv->replay_open = FALSE;
 	return TRUE;
 }
 
@@ -561,6 +574,393 @@ fu_usb_device_get_dev (FuUsbDevice *device)
 	return priv->usb_device;
 }
 
+typedef struct {
+	FuUsbDevice		*self;
+	GPtrArray		*chunks;	/* of FuChunk */
+	GMainLoop		*loop;
+	GCancellable		*cancellable;
+	guint8			 endpoint;
+	guint			 queue_depth;
+	guint			 timeout;
+	guint			 idx_next;
+	guint			 in_flight;
+	guint			 done;
+	guint			 failures;
+	GError			*error;		/* first failure */
+} FuUsbDeviceQueueHelper;
+
+typedef struct {
+	FuUsbDeviceQueueHelper	*helper;
+	FuChunk			*chk;
+} FuUsbDeviceQueueItem;
+
+static void fu_usb_device_queue_submit (FuUsbDeviceQueueHelper *helper);
+
+static void
+fu_usb_device_queue_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	FuUsbDeviceQueueItem *item = (FuUsbDeviceQueueItem *) user_data;
+	FuUsbDeviceQueueHelper *helper = item->helper;
+	gssize actual_len;
+	g_autoptr(GError) error_local = NULL;
+
+	helper->in_flight--;
+	actual_len = g_usb_device_bulk_transfer_finish (G_USB_DEVICE (source_object),
+							res, &error_local);
+	if (actual_len >= 0 && (gsize) actual_len != item->chk->data_sz) {
+		g_set_error (&error_local,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "only wrote %" G_GSSIZE_FORMAT " of %u bytes",
+			     actual_len, item->chk->data_sz);
+	}
+	if (error_local != NULL) {
+		/* transfers aborted because of an earlier failure do not count */
+		if (helper->error == NULL ||
+		    !g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			helper->failures++;
+			g_debug ("failed to write chunk 0x%x: %s",
+				 item->chk->idx, error_local->message);
+		}
+		if (helper->error == NULL) {
+			g_propagate_prefixed_error (&helper->error,
+						    g_steal_pointer (&error_local),
+						    "failed to write chunk 0x%x: ",
+						    item->chk->idx);
+			g_cancellable_cancel (helper->cancellable);
+		}
+	} else {
+		helper->done++;
+		fu_device_set_progress_full (FU_DEVICE (helper->self),
+					     helper->done, helper->chunks->len);
+	}
+	g_free (item);
+
+	/* refill the queue, or finish */
+	fu_usb_device_queue_submit (helper);
+}
+
+static void
+fu_usb_device_queue_submit (FuUsbDeviceQueueHelper *helper)
+{
+	FuUsbDevicePrivate *priv = GET_PRIVATE (helper->self);
+
+	/* stop submitting new transfers after the first failure */
+	while (helper->error == NULL &&
+	       helper->in_flight < helper->queue_depth &&
+	       helper->idx_next < helper->chunks->len) {
+		FuUsbDeviceQueueItem *item = g_new0 (FuUsbDeviceQueueItem, 1);
+		item->helper = helper;
+		item->chk = g_ptr_array_index (helper->chunks, helper->idx_next++);
+		g_usb_device_bulk_transfer_async (priv->usb_device,
+						  helper->endpoint,
+						  (guint8 *) item->chk->data,
+						  item->chk->data_sz,
+						  helper->timeout,
+						  helper->cancellable,
+						  fu_usb_device_queue_cb,
+						  item);
+		helper->in_flight++;
+	}
+	if (helper->in_flight == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+/**
+ * fu_usb_device_bulk_transfer_queued:
+ * @device: A #FuUsbDevice
+ * @endpoint: the address of a valid OUT endpoint
+ * @chunks: (element-type FuChunk): data to send
+ * @queue_depth: the maximum number of transfers in flight, e.g. 4
+ * @timeout: timeout for each transfer in milliseconds
+ * @error: A #GError, or %NULL
+ *
+ * Writes each chunk to the device using a bulk transfer, keeping up to
+ * @queue_depth transfers in flight so that the bus is never left idle while
+ * the next transfer is being submitted. Chunks are submitted in order, and no
+ * further chunks are sent after a transfer fails.
+ *
+ * The device progress is updated as each transfer completes.
+ *
+ * Returns: %TRUE if all the chunks were written
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_bulk_transfer_queued (FuUsbDevice *device,
+				    guint8 endpoint,
+				    GPtrArray *chunks,
+				    guint queue_depth,
+				    guint timeout,
+				    GError **error)
+{
+	FuUsbDevicePrivate *priv = GET_PRIVATE (device);
+	FuUsbDeviceQueueHelper helper = { NULL };
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+
+	g_return_val_if_fail (FU_IS_USB_DEVICE (device), FALSE);
+	g_return_val_if_fail (chunks != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (priv->usb_device == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no GUsbDevice");
+		return FALSE;
+	}
+
+	/* completions are dispatched to the context of the calling thread */
+	helper.self = device;
+	helper.chunks = chunks;
+	helper.loop = loop;
+	helper.cancellable = cancellable;
+	helper.endpoint = endpoint;
+	helper.queue_depth = MAX (queue_depth, 1);
+	helper.timeout = timeout;
+	g_main_context_push_thread_default (context);
+	fu_usb_device_queue_submit (&helper);
+	if (helper.in_flight > 0)
+		g_main_loop_run (loop);
+	g_main_context_pop_thread_default (context);
+
+	/* report the first failure */
+	if (helper.error != NULL) {
+		if (helper.failures > 1) {
+			g_prefix_error (&helper.error, "%u of %u transfers failed, first ",
+					helper.failures, chunks->len);
+		}
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_usb_device_control_transfer:
+ * @device: A #FuUsbDevice
+ * @direction: the #GUsbDeviceDirection
+ * @request_type: the #GUsbDeviceRequestType
+ * @recipient: the #GUsbDeviceRecipient
+ * @request: the request field for the setup packet
+ * @value: the value field for the setup packet
+ * @idx: the index field for the setup packet
+ * @data: (array length=length): a suitably-sized data buffer
+ * @length: the size of @data
+ * @actual_length: (out) (optional): the actual number of bytes sent, or %NULL
+ * @timeout: timeout in milliseconds
+ * @error: A #GError, or %NULL
+ *
+ * Performs a USB control transfer in the same way as
+ * g_usb_device_control_transfer(), but the transfer is saved to the device
+ * #FuIoRecording if one is set, or answered from it when replaying.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_control_transfer (FuUsbDevice *device,
+				GUsbDeviceDirection direction,
+				GUsbDeviceRequestType request_type,
+				GUsbDeviceRecipient recipient,
+				guint8 request,
+				guint16 value,
+				guint16 idx,
+				guint8 *data,
+				gsize length,
+				gsize *actual_length,
+				guint timeout,
+				GError **error)
+{
+	FuUsbDevicePrivate *priv = GET_PRIVATE (device);
+	FuIoRecording *io_recording = fu_device_get_io_recording (FU_DEVICE (device));
+	gboolean is_in = direction == G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST;
+	gint64 start_time = g_get_monotonic_time ();
+	gsize actual_length_tmp = 0;
+	g_autofree gchar *id = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	g_return_val_if_fail (FU_IS_USB_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (io_recording != NULL) {
+		id = g_strdup_printf ("usb-ctrl:%u:%u:%u:%02x:%04x:%04x",
+				      direction, request_type, recipient,
+				      request, value, idx);
+	}
+	if (fu_io_recording_is_replay (io_recording)) {
+		if (!fu_io_recording_replay_full (io_recording, id,
+						  is_in ? NULL : data,
+						  is_in ? 0 : length,
+						  is_in ? data : NULL,
+						  is_in ? length : 0,
+						  &actual_length_tmp, error))
+			return FALSE;
+		if (actual_length != NULL)
+			*actual_length = is_in ? actual_length_tmp : length;
+		return TRUE;
+	}
+	if (priv->usb_device == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no GUsbDevice");
+		return FALSE;
+	}
+	g_usb_device_control_transfer (priv->usb_device,
+				       direction, request_type, recipient,
+				       request, value, idx,
+				       data, length, &actual_length_tmp,
+				       timeout, NULL, &error_local);
+	if (io_recording != NULL) {
+		fu_io_recording_add (io_recording, id,
+				     is_in ? NULL : data,
+				     is_in ? 0 : length,
+				     is_in ? data : NULL,
+				     is_in ? actual_length_tmp : 0,
+				     error_local, start_time);
+	}
+	if (error_local != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	if (actual_length != NULL)
+		*actual_length = actual_length_tmp;
+	return TRUE;
+}
+
+static gboolean
+fu_usb_device_transfer (FuUsbDevice *device,
+			const gchar *kind,
+			guint8 endpoint,
+			guint8 *data,
+			gsize length,
+			gsize *actual_length,
+			guint timeout,
+			GError **error)
+{
+	FuUsbDevicePrivate *priv = GET_PRIVATE (device);
+	FuIoRecording *io_recording = fu_device_get_io_recording (FU_DEVICE (device));
+	gboolean is_in = (endpoint & 0x80) > 0;
+	gint64 start_time = g_get_monotonic_time ();
+	gsize actual_length_tmp = 0;
+	g_autofree gchar *id = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	g_return_val_if_fail (FU_IS_USB_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (io_recording != NULL)
+		id = g_strdup_printf ("usb-%s:%02x", kind, endpoint);
+	if (fu_io_recording_is_replay (io_recording)) {
+		if (!fu_io_recording_replay_full (io_recording, id,
+						  is_in ? NULL : data,
+						  is_in ? 0 : length,
+						  is_in ? data : NULL,
+						  is_in ? length : 0,
+						  &actual_length_tmp, error))
+			return FALSE;
+		if (actual_length != NULL)
+			*actual_length = is_in ? actual_length_tmp : length;
+		return TRUE;
+	}
+	if (priv->usb_device == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no GUsbDevice");
+		return FALSE;
+	}
+	if (g_strcmp0 (kind, "bulk") == 0) {
+		g_usb_device_bulk_transfer (priv->usb_device, endpoint,
+					    data, length, &actual_length_tmp,
+					    timeout, NULL, &error_local);
+	} else {
+		g_usb_device_interrupt_transfer (priv->usb_device, endpoint,
+						 data, length, &actual_length_tmp,
+						 timeout, NULL, &error_local);
+	}
+	if (io_recording != NULL) {
+		fu_io_recording_add (io_recording, id,
+				     is_in ? NULL : data,
+				     is_in ? 0 : length,
+				     is_in ? data : NULL,
+				     is_in ? actual_length_tmp : 0,
+				     error_local, start_time);
+	}
+	if (error_local != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	if (actual_length != NULL)
+		*actual_length = actual_length_tmp;
+	return TRUE;
+}
+
+/**
+ * fu_usb_device_bulk_transfer:
+ * @device: A #FuUsbDevice
+ * @endpoint: the address of a valid endpoint
+ * @data: (array length=length): a suitably-sized data buffer
+ * @length: the size of @data
+ * @actual_length: (out) (optional): the actual number of bytes sent, or %NULL
+ * @timeout: timeout in milliseconds
+ * @error: A #GError, or %NULL
+ *
+ * Performs a USB bulk transfer in the same way as
+ * g_usb_device_bulk_transfer(), but using the device #FuIoRecording if set.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_bulk_transfer (FuUsbDevice *device,
+			     guint8 endpoint,
+			     guint8 *data,
+			     gsize length,
+			     gsize *actual_length,
+			     guint timeout,
+			     GError **error)
+{
+	return fu_usb_device_transfer (device, "bulk", endpoint, data, length,
+				       actual_length, timeout, error);
+}
+
+/**
+ * fu_usb_device_interrupt_transfer:
+ * @device: A #FuUsbDevice
+ * @endpoint: the address of a valid endpoint
+ * @data: (array length=length): a suitably-sized data buffer
+ * @length: the size of @data
+ * @actual_length: (out) (optional): the actual number of bytes sent, or %NULL
+ * @timeout: timeout in milliseconds
+ * @error: A #GError, or %NULL
+ *
+ * Performs a USB interrupt transfer in the same way as
+ * g_usb_device_interrupt_transfer(), but using the device #FuIoRecording
+ * if set.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_interrupt_transfer (FuUsbDevice *device,
+				  guint8 endpoint,
+				  guint8 *data,
+				  gsize length,
+				  gsize *actual_length,
+				  guint timeout,
+				  GError **error)
+{
+	return fu_usb_device_transfer (device, "intr", endpoint, data, length,
+				       actual_length, timeout, error);
+}
+
 static void
 fu_usb_device_incorporate (FuDevice *self, FuDevice *donor)
 {
@@ -17,18 +17,24 @@
 #include <libfwupdplugin/fu-chunk.h>
 #include <libfwupdplugin/fu-common.h>
 #include <libfwupdplugin/fu-common-cab.h>
+#include <libfwupdplugin/fu-common-acpi.h>
+#include <libfwupdplugin/fu-common-crc.h>
 #include <libfwupdplugin/fu-common-guid.h>
 #include <libfwupdplugin/fu-common-version.h>
 #include <libfwupdplugin/fu-device.h>
 #include <libfwupdplugin/fu-device-locker.h>
 #include <libfwupdplugin/fu-device-metadata.h>
 #include <libfwupdplugin/fu-dfu-firmware.h>
+#include <libfwupdplugin/fu-file-watch.h>
 #include <libfwupdplugin/fu-firmware.h>
+#include <libfwupdplugin/fu-firmware-builder.h>
 #include <libfwupdplugin/fu-firmware-common.h>
 #include <libfwupdplugin/fu-firmware-image.h>
 #include <libfwupdplugin/fu-hwids.h>
 #include <libfwupdplugin/fu-ihex-firmware.h>
 #include <libfwupdplugin/fu-io-channel.h>
+#include <libfwupdplugin/fu-io-recording.h>
+#include <libfwupdplugin/fu-metrics.h>
 #include <libfwupdplugin/fu-plugin.h>
 #include <libfwupdplugin/fu-plugin-vfuncs.h>
 #include <libfwupdplugin/fu-quirks.h>
@@ -36,6 +42,8 @@
 #include <libfwupdplugin/fu-smbios.h>
 #include <libfwupdplugin/fu-srec-firmware.h>
 #include <libfwupdplugin/fu-efivar.h>
+#include <libfwupdplugin/fu-esrt.h>
+#include <libfwupdplugin/fu-trace.h>
 #include <libfwupdplugin/fu-udev-device.h>
 #include <libfwupdplugin/fu-usb-device.h>
 
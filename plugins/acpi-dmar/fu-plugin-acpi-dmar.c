@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include "fu-plugin-vfuncs.h"
+#include "fu-common-acpi.h"
 #include "fu-hash.h"
 #include "fu-acpi-dmar.h"
 
@@ -19,8 +20,6 @@ fu_plugin_init (FuPlugin *plugin)
 void
 fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 {
-	g_autofree gchar *fn = NULL;
-	g_autofree gchar *path = NULL;
 	g_autoptr(FuAcpiDmar) dmar = NULL;
 	g_autoptr(FwupdSecurityAttr) attr = NULL;
 	g_autoptr(GBytes) blob = NULL;
@@ -37,17 +36,15 @@ fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 	fu_security_attrs_append (attrs, attr);
 
 	/* load DMAR table */
-	path = fu_common_get_path (FU_PATH_KIND_ACPI_TABLES);
-	fn = g_build_filename (path, "DMAR", NULL);
-	blob = fu_common_get_contents_bytes (fn, &error_local);
+	blob = fu_common_get_acpi_table ("DMAR", &error_local);
 	if (blob == NULL) {
-		g_debug ("failed to load %s: %s", fn, error_local->message);
+		g_debug ("failed to load DMAR: %s", error_local->message);
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_VALID);
 		return;
 	}
 	dmar = fu_acpi_dmar_new (blob, &error_local);
 	if (dmar == NULL) {
-		g_warning ("failed to parse %s: %s", fn, error_local->message);
+		g_warning ("failed to parse DMAR: %s", error_local->message);
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_VALID);
 		return;
 	}
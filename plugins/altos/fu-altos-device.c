@@ -15,6 +15,9 @@
 #include "fu-altos-device.h"
 #include "fu-altos-firmware.h"
 
+#define FU_ALTOS_DEVICE_PAGE_SIZE		0x100
+#define FU_ALTOS_DEVICE_BATCH_SIZE		0x1000	/* bytes in flight */
+
 struct _FuAltosDevice {
 	FuUsbDevice		 parent_instance;
 	gchar			*tty;
@@ -99,6 +102,7 @@ static gboolean
 fu_altos_device_tty_write (FuAltosDevice *self,
 			   const gchar *data,
 			   gssize data_len,
+			   FuIOChannelFlags flags,
 			   GError **error)
 {
 	/* lets assume this is text */
@@ -110,7 +114,7 @@ fu_altos_device_tty_write (FuAltosDevice *self,
 					(const guint8 *) data,
 					(gsize) data_len,
 					500, /* ms */
-					FU_IO_CHANNEL_FLAG_NONE,
+					flags,
 					error);
 }
 
@@ -195,34 +199,63 @@ fu_altos_device_tty_close (FuAltosDevice *self, GError **error)
 	return TRUE;
 }
 
-static GString *
-fu_altos_device_read_page (FuAltosDevice *self, guint address, GError **error)
-{
-	g_autoptr(GString) str = NULL;
-	g_autofree gchar *cmd = g_strdup_printf ("R %x\n", address);
-	if (!fu_altos_device_tty_write (self, cmd, -1, error))
-		return NULL;
-	str = fu_altos_device_tty_read (self, 1500, 256, error);
-	if (str == NULL)
-		return NULL;
-	return g_steal_pointer (&str);
-}
-
+/* the bootloader handles one page per command, but processes commands in
+ * order so several can be sent before reading any of the responses */
 static gboolean
-fu_altos_device_write_page (FuAltosDevice *self,
+fu_altos_device_read_pages (FuAltosDevice *self,
 			    guint address,
-			    const guint8 *data,
-			    guint data_len,
+			    guint n_pages,
+			    GByteArray *buf,
 			    GError **error)
 {
-	g_autofree gchar *cmd = g_strdup_printf ("W %x\n", address);
-	if (!fu_altos_device_tty_write (self, cmd, -1, error))
-		return FALSE;
-	if (!fu_altos_device_tty_write (self, (const gchar *) data, data_len, error))
+	g_autoptr(GString) cmds = g_string_new (NULL);
+
+	for (guint i = 0; i < n_pages; i++)
+		g_string_append_printf (cmds, "R %x\n", address + i * FU_ALTOS_DEVICE_PAGE_SIZE);
+	if (!fu_altos_device_tty_write (self, cmds->str, cmds->len,
+					FU_IO_CHANNEL_FLAG_NONE, error))
 		return FALSE;
+	for (guint i = 0; i < n_pages; i++) {
+		g_autoptr(GByteArray) page = NULL;
+		page = fu_io_channel_read_until (self->io_channel, NULL, 0,
+						 FU_ALTOS_DEVICE_PAGE_SIZE, 1500,
+						 FU_IO_CHANNEL_FLAG_NONE, error);
+		if (page == NULL) {
+			g_prefix_error (error, "failed to read @%x: ",
+					address + i * FU_ALTOS_DEVICE_PAGE_SIZE);
+			return FALSE;
+		}
+		if (g_getenv ("FWUPD_ALTOS_VERBOSE") != NULL)
+			fu_common_dump_raw (G_LOG_DOMAIN, "read", page->data, page->len);
+		g_byte_array_append (buf, page->data, page->len);
+	}
 	return TRUE;
 }
 
+static gboolean
+fu_altos_device_write_pages (FuAltosDevice *self,
+			     guint address,
+			     const guint8 *data,
+			     guint n_pages,
+			     GError **error)
+{
+	/* sent as one write */
+	for (guint i = 0; i < n_pages; i++) {
+		g_autofree gchar *cmd = NULL;
+		cmd = g_strdup_printf ("W %x\n", address + i * FU_ALTOS_DEVICE_PAGE_SIZE);
+		if (!fu_altos_device_tty_write (self, cmd, -1,
+						FU_IO_CHANNEL_FLAG_BUFFER_WRITE, error))
+			return FALSE;
+		if (!fu_altos_device_tty_write (self,
+						(const gchar *) data + i * FU_ALTOS_DEVICE_PAGE_SIZE,
+						FU_ALTOS_DEVICE_PAGE_SIZE,
+						FU_IO_CHANNEL_FLAG_BUFFER_WRITE,
+						error))
+			return FALSE;
+	}
+	return fu_io_channel_flush (self->io_channel, 500, error);
+}
+
 static FuFirmware *
 fu_altos_device_prepare_firmware (FuDevice *device,
 				  GBytes *fw,
@@ -247,8 +280,8 @@ fu_altos_device_write_firmware (FuDevice *device,
 	guint flash_len;
 	g_autoptr(FuDeviceLocker) locker  = NULL;
 	g_autoptr(FuFirmwareImage) img = NULL;
+	g_autoptr(GByteArray) buf = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GString) buf = g_string_new (NULL);
 
 	/* check kind */
 	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_IS_BOOTLOADER)) {
@@ -309,6 +342,14 @@ fu_altos_device_write_firmware (FuDevice *device,
 		return FALSE;
 	}
 
+	/* pad the whole image to the flash size ahead of time */
+	buf = g_byte_array_sized_new (flash_len + FU_ALTOS_DEVICE_PAGE_SIZE);
+	g_byte_array_append (buf, (const guint8 *) data, data_len);
+	while (buf->len < flash_len || buf->len % FU_ALTOS_DEVICE_PAGE_SIZE != 0) {
+		const guint8 pad = 0xff;
+		g_byte_array_append (buf, &pad, 1);
+	}
+
 	/* open tty for download */
 	locker = fu_device_locker_new_full (device,
 					    (FuDeviceLockerFunc) fu_altos_device_tty_open,
@@ -317,61 +358,46 @@ fu_altos_device_write_firmware (FuDevice *device,
 	if (locker == NULL)
 		return FALSE;
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 0; i < flash_len; i+= 0x100) {
-		g_autoptr(GString) str = NULL;
-		guint8 buf_tmp[0x100];
-
-		/* copy remaining data into buf if required */
-		memset (buf_tmp, 0xff, sizeof (buf));
-		if (i < data_len) {
-			gsize chunk_len = 0x100;
-			if (i + 0x100 > data_len)
-				chunk_len = data_len - i;
-			if (!fu_memcpy_safe (buf_tmp, sizeof(buf_tmp), 0,		/* dst */
-					     (const guint8 *) data, data_len, i,	/* src */
-					     chunk_len, error))
-				return FALSE;
-		}
-
-		/* verify data from device */
-		if (!fu_altos_device_write_page (self,
-						 self->addr_base + i,
-						 buf_tmp,
-						 0x100,
-						 error))
+	for (guint i = 0; i < flash_len; i += FU_ALTOS_DEVICE_BATCH_SIZE) {
+		guint n_pages = (MIN (flash_len - i, FU_ALTOS_DEVICE_BATCH_SIZE) +
+				 FU_ALTOS_DEVICE_PAGE_SIZE - 1) / FU_ALTOS_DEVICE_PAGE_SIZE;
+		g_autoptr(GByteArray) buf_verify = g_byte_array_new ();
+
+		/* write data to device */
+		if (!fu_altos_device_write_pages (self,
+						  self->addr_base + i,
+						  buf->data + i,
+						  n_pages,
+						  error))
 			return FALSE;
 
 		/* verify data written on device */
-		str = fu_altos_device_read_page (self,
+		if (!fu_altos_device_read_pages (self,
 						 self->addr_base + i,
-						 error);
-		if (str == NULL)
-			return FALSE;
-		if (str->len != 0x100) {
-			g_set_error (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_WRITE,
-					     "failed to verify @%x, "
-					     "not enough data returned",
-					     (guint) (self->addr_base + i));
+						 n_pages,
+						 buf_verify,
+						 error))
 			return FALSE;
-		}
-		if (memcmp (str->str, buf_tmp, 0x100) != 0) {
-			g_set_error (error,
+		for (guint j = 0; j < n_pages; j++) {
+			guint offset = j * FU_ALTOS_DEVICE_PAGE_SIZE;
+			if (memcmp (buf_verify->data + offset,
+				    buf->data + i + offset,
+				    FU_ALTOS_DEVICE_PAGE_SIZE) != 0) {
+				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_WRITE,
 					     "failed to verify @%x",
-					     (guint) (self->addr_base + i));
-			return FALSE;
+					     (guint) (self->addr_base + i + offset));
+				return FALSE;
+			}
 		}
 
 		/* progress */
 		fu_device_set_progress_full (device, i, flash_len);
-		g_string_append_len (buf, str->str, str->len);
 	}
 
 	/* go to application mode */
-	if (!fu_altos_device_tty_write (self, "a\n", -1, error))
+	if (!fu_altos_device_tty_write (self, "a\n", -1, FU_IO_CHANNEL_FLAG_NONE, error))
 		return FALSE;
 
 	/* progress complete */
@@ -387,8 +413,8 @@ fu_altos_device_read_firmware (FuDevice *device, GError **error)
 	FuAltosDevice *self = FU_ALTOS_DEVICE (device);
 	guint flash_len;
 	g_autoptr(FuDeviceLocker) locker  = NULL;
+	g_autoptr(GByteArray) buf = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GString) buf = g_string_new (NULL);
 
 	/* check kind */
 	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_IS_BOOTLOADER)) {
@@ -425,23 +451,22 @@ fu_altos_device_read_firmware (FuDevice *device, GError **error)
 					    error);
 	if (locker == NULL)
 		return NULL;
-	for (guint i = self->addr_base; i < self->addr_bound; i+= 0x100) {
-		g_autoptr(GString) str = NULL;
+	buf = g_byte_array_sized_new (flash_len);
+	for (guint i = 0; i < flash_len; i += FU_ALTOS_DEVICE_BATCH_SIZE) {
+		guint n_pages = (MIN (flash_len - i, FU_ALTOS_DEVICE_BATCH_SIZE) +
+				 FU_ALTOS_DEVICE_PAGE_SIZE - 1) / FU_ALTOS_DEVICE_PAGE_SIZE;
 
 		/* request data from device */
-		str = fu_altos_device_read_page (self, i, error);
-		if (str == NULL)
+		if (!fu_altos_device_read_pages (self, self->addr_base + i,
+						 n_pages, buf, error))
 			return NULL;
 
 		/* progress */
-		fu_device_set_progress_full (device,
-					     i - self->addr_base,
-					     self->addr_bound - self->addr_base);
-		g_string_append_len (buf, str->str, str->len);
+		fu_device_set_progress_full (device, i, flash_len);
 	}
 
 	/* success */
-	fw = g_bytes_new (buf->str, buf->len);
+	fw = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
 	return fu_firmware_new_from_bytes (fw);
 }
 
@@ -463,7 +488,7 @@ fu_altos_device_probe_bootloader (FuAltosDevice *self, GError **error)
 		return FALSE;
 
 	/* get the version information */
-	if (!fu_altos_device_tty_write (self, "v\n", -1, error))
+	if (!fu_altos_device_tty_write (self, "v\n", -1, FU_IO_CHANNEL_FLAG_NONE, error))
 		return FALSE;
 	str = fu_altos_device_tty_read (self, 100, -1, error);
 	if (str == NULL) {
@@ -443,14 +443,121 @@ amt_get_provisioning_state (mei_context *mei_cl, guint8 *state, GError **error)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(mei_context, mei_context_free)
 #pragma clang diagnostic pop
 
+#define FU_PLUGIN_AMT_CACHE_GROUP		"amt"
+
+static gchar *
+fu_plugin_amt_get_boot_id (void)
+{
+	g_autofree gchar *buf = NULL;
+	if (!g_file_get_contents ("/proc/sys/kernel/random/boot_id", &buf, NULL, NULL))
+		return NULL;
+	return g_strdup (g_strstrip (buf));
+}
+
+static gchar *
+fu_plugin_amt_get_cache_filename (void)
+{
+	g_autofree gchar *localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	return g_build_filename (localstatedir, "amt.cache", NULL);
+}
+
+/* the ME can only be updated with a reboot, so the code versions are valid
+ * until the boot ID changes; the provisioning state is always read live */
+static gboolean
+fu_plugin_amt_load_cache (const gchar *boot_id, GString *version_fw, GString *version_bl)
+{
+	g_autofree gchar *boot_id_cache = NULL;
+	g_autofree gchar *filename = fu_plugin_amt_get_cache_filename ();
+	g_autofree gchar *tmp_fw = NULL;
+	g_autofree gchar *tmp_bl = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (kf, filename, G_KEY_FILE_NONE, NULL))
+		return FALSE;
+	boot_id_cache = g_key_file_get_string (kf, FU_PLUGIN_AMT_CACHE_GROUP, "BootId", NULL);
+	if (g_strcmp0 (boot_id_cache, boot_id) != 0)
+		return FALSE;
+	tmp_fw = g_key_file_get_string (kf, FU_PLUGIN_AMT_CACHE_GROUP, "VersionFw", NULL);
+	tmp_bl = g_key_file_get_string (kf, FU_PLUGIN_AMT_CACHE_GROUP, "VersionBl", NULL);
+	if (tmp_fw == NULL || tmp_bl == NULL)
+		return FALSE;
+	g_string_append (version_fw, tmp_fw);
+	g_string_append (version_bl, tmp_bl);
+	g_debug ("using AMT code versions from cache");
+	return TRUE;
+}
+
+static void
+fu_plugin_amt_save_cache (const gchar *boot_id, GString *version_fw, GString *version_bl)
+{
+	g_autofree gchar *filename = fu_plugin_amt_get_cache_filename ();
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	g_key_file_set_string (kf, FU_PLUGIN_AMT_CACHE_GROUP, "BootId", boot_id);
+	g_key_file_set_string (kf, FU_PLUGIN_AMT_CACHE_GROUP, "VersionFw", version_fw->str);
+	g_key_file_set_string (kf, FU_PLUGIN_AMT_CACHE_GROUP, "VersionBl", version_bl->str);
+	if (!fu_common_mkdir_parent (filename, &error_local) ||
+	    !g_key_file_save_to_file (kf, filename, &error_local))
+		g_debug ("failed to save AMT cache: %s", error_local->message);
+}
+
+static gboolean
+fu_plugin_amt_get_code_versions (mei_context *ctx,
+				 GString *version_fw,
+				 GString *version_bl,
+				 GError **error)
+{
+	struct amt_code_versions ver;
+	g_autofree struct amt_host_if_resp_header *response = NULL;
+
+	if (!amt_host_if_call (ctx,
+			       (const guchar *) &CODE_VERSION_REQ,
+			       sizeof(CODE_VERSION_REQ),
+			       (guint8 **) &response,
+			       AMT_HOST_IF_CODE_VERSIONS_RESPONSE, 0,
+			       5000,
+			       error)) {
+		g_prefix_error (error, "Failed to check version: ");
+		return FALSE;
+	}
+	if (!amt_verify_code_versions (response, error)) {
+		g_prefix_error (error, "failed to verify code versions: ");
+		return FALSE;
+	}
+	memcpy (&ver, response->data, sizeof(struct amt_code_versions));
+
+	/* get version numbers */
+	for (guint i = 0; i < ver.count; i++) {
+		if (g_strcmp0 (ver.versions[i].description.string, "AMT") == 0) {
+			g_string_append (version_fw, ver.versions[i].version.string);
+			continue;
+		}
+		if (g_strcmp0 (ver.versions[i].description.string, "Recovery Version") == 0) {
+			g_string_append (version_bl, ver.versions[i].version.string);
+			continue;
+		}
+		if (g_strcmp0 (ver.versions[i].description.string, "Build Number") == 0) {
+			g_string_append_printf (version_fw, ".%s",
+						ver.versions[i].version.string);
+			continue;
+		}
+		if (g_strcmp0 (ver.versions[i].description.string, "Recovery Build Num") == 0) {
+			g_string_append_printf (version_bl, ".%s",
+						ver.versions[i].version.string);
+			continue;
+		}
+	}
+	return TRUE;
+}
+
 static FuDevice *
 fu_plugin_amt_create_device (GError **error)
 {
 	guint8 state;
-	struct amt_code_versions ver;
 	fwupd_guid_t uu;
+	g_autofree gchar *boot_id = fu_plugin_amt_get_boot_id ();
 	g_autofree gchar *guid_buf = NULL;
-	g_autofree struct amt_host_if_resp_header *response = NULL;
 	g_autoptr(FuDevice) dev = NULL;
 	g_autoptr(GString) version_bl = g_string_new (NULL);
 	g_autoptr(GString) version_fw = g_string_new (NULL);
@@ -464,21 +571,13 @@ fu_plugin_amt_create_device (GError **error)
 		return NULL;
 
 	/* check version */
-	if (!amt_host_if_call (ctx,
-			       (const guchar *) &CODE_VERSION_REQ,
-			       sizeof(CODE_VERSION_REQ),
-			       (guint8 **) &response,
-			       AMT_HOST_IF_CODE_VERSIONS_RESPONSE, 0,
-			       5000,
-			       error)) {
-		g_prefix_error (error, "Failed to check version: ");
-		return NULL;
+	if (boot_id == NULL ||
+	    !fu_plugin_amt_load_cache (boot_id, version_fw, version_bl)) {
+		if (!fu_plugin_amt_get_code_versions (ctx, version_fw, version_bl, error))
+			return NULL;
+		if (boot_id != NULL)
+			fu_plugin_amt_save_cache (boot_id, version_fw, version_bl);
 	}
-	if (!amt_verify_code_versions (response, error)) {
-		g_prefix_error (error, "failed to verify code versions: ");
-		return NULL;
-	}
-	memcpy (&ver, response->data, sizeof(struct amt_code_versions));
 
 	dev = fu_device_new ();
 	fu_device_set_id (dev, "/dev/mei0");
@@ -510,27 +609,6 @@ fu_plugin_amt_create_device (GError **error)
 	guid_buf = fwupd_guid_to_string ((const fwupd_guid_t *) &uu, FWUPD_GUID_FLAG_NONE);
 	fu_device_add_guid (dev, guid_buf);
 
-	/* get version numbers */
-	for (guint i = 0; i < ver.count; i++) {
-		if (g_strcmp0 (ver.versions[i].description.string, "AMT") == 0) {
-			g_string_append (version_fw, ver.versions[i].version.string);
-			continue;
-		}
-		if (g_strcmp0 (ver.versions[i].description.string, "Recovery Version") == 0) {
-			g_string_append (version_bl, ver.versions[i].version.string);
-			continue;
-		}
-		if (g_strcmp0 (ver.versions[i].description.string, "Build Number") == 0) {
-			g_string_append_printf (version_fw, ".%s",
-						ver.versions[i].version.string);
-			continue;
-		}
-		if (g_strcmp0 (ver.versions[i].description.string, "Recovery Build Num") == 0) {
-			g_string_append_printf (version_bl, ".%s",
-						ver.versions[i].version.string);
-			continue;
-		}
-	}
 	fu_device_set_version_format (dev, FWUPD_VERSION_FORMAT_INTEL_ME);
 	if (version_fw->len > 0)
 		fu_device_set_version (dev, version_fw->str);
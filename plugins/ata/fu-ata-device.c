@@ -33,6 +33,7 @@ struct ata_tf {
 #define ATA_OP_IDENTIFY			0xec
 #define ATA_OP_FLUSH_CACHE		0xe7
 #define ATA_OP_DOWNLOAD_MICROCODE	0x92
+#define ATA_OP_DOWNLOAD_MICROCODE_DMA	0x93
 #define ATA_OP_STANDBY_IMMEDIATE	0xe0
 
 #define ATA_SUBCMD_MICROCODE_OBSOLETE			0x01
@@ -50,6 +51,11 @@ struct ata_tf {
 #define SG_ATA_PROTO_NON_DATA		(3 << 1)
 #define SG_ATA_PROTO_PIO_IN		(4 << 1)
 #define SG_ATA_PROTO_PIO_OUT		(5 << 1)
+#define SG_ATA_PROTO_DMA		(6 << 1)
+
+/* large enough that the per-command overhead does not matter, but small
+ * enough to show progress on big images */
+#define FU_ATA_DEVICE_TRANSFER_BLOCKS_DEFAULT	0x800
 
 enum {
 	SG_CDB2_TLEN_NODATA	= 0 << 0,
@@ -71,6 +77,7 @@ struct _FuAtaDevice {
 	guint			 usb_depth;
 	guint16			 transfer_blocks;
 	guint8			 transfer_mode;
+	gboolean		 dma_supported;
 	guint32			 oui;
 	gboolean		 unknown_oui_report;
 };
@@ -89,6 +96,12 @@ fu_ata_device_get_transfer_blocks (FuAtaDevice *self)
 	return self->transfer_blocks;
 }
 
+gboolean
+fu_ata_device_get_dma_supported (FuAtaDevice *self)
+{
+	return self->dma_supported;
+}
+
 void
 fu_ata_device_set_unknown_oui_report (FuAtaDevice *self, gboolean enabled)
 {
@@ -119,6 +132,7 @@ fu_ata_device_to_string (FuDevice *device, guint idt, GString *str)
 	FuAtaDevice *self = FU_ATA_DEVICE (device);
 	fu_common_string_append_kx (str, idt, "TransferMode", self->transfer_mode);
 	fu_common_string_append_kx (str, idt, "TransferBlocks", self->transfer_blocks);
+	fu_common_string_append_kb (str, idt, "DmaSupported", self->dma_supported);
 	if (self->oui != 0x0)
 		fu_common_string_append_kx (str, idt, "OUI", self->oui);
 	fu_common_string_append_ku (str, idt, "PciDepth", self->pci_depth);
@@ -348,6 +362,9 @@ fu_ata_device_parse_id (FuAtaDevice *self, const guint8 *buf, gsize sz, GError *
 		return FALSE;
 	}
 
+	/* DOWNLOAD_MICROCODE_DMA */
+	self->dma_supported = (id[69] & (1 << 8)) > 0;
+
 	fu_ata_device_parse_id_maybe_dell (self, id);
 
 	/* firmware will be applied when the device restarts */
@@ -365,11 +382,17 @@ fu_ata_device_parse_id (FuAtaDevice *self, const guint8 *buf, gsize sz, GError *
 			xfer_max = xfer_min;
 	}
 
-	/* fall back to a sane block size */
-	if (self->transfer_blocks == 0x0)
-		self->transfer_blocks = xfer_min;
-	else if (self->transfer_blocks == 0xffff)
+	/* use the largest segment the drive supports, up to a sane limit */
+	if (self->transfer_blocks == 0x0) {
+		if (self->transfer_mode == ATA_SUBCMD_MICROCODE_DOWNLOAD_CHUNK) {
+			self->transfer_blocks = xfer_min;
+		} else {
+			self->transfer_blocks = MIN (xfer_max, FU_ATA_DEVICE_TRANSFER_BLOCKS_DEFAULT);
+			self->transfer_blocks = MAX (self->transfer_blocks, xfer_min);
+		}
+	} else if (self->transfer_blocks == 0xffff) {
 		self->transfer_blocks = xfer_max;
+	}
 
 	/* get values in case the kernel didn't */
 	if (fu_device_get_serial (device) == NULL) {
@@ -492,21 +515,15 @@ fu_ata_device_tf_to_pack_id (struct ata_tf *tf)
 }
 
 static gboolean
-fu_ata_device_command (FuAtaDevice *self, struct ata_tf *tf,
-		       gint dxfer_direction, guint timeout_ms,
-		       guint8 *dxferp, gsize dxfer_len, GError **error)
+fu_ata_device_command_full (FuAtaDevice *self, struct ata_tf *tf, guint8 protocol,
+			    gint dxfer_direction, guint timeout_ms,
+			    guint8 *dxferp, gsize dxfer_len, GError **error)
 {
 	guint8 cdb[SG_ATA_12_LEN] = { 0x0 };
 	guint8 sb[32] = { 0x0 };
 	sg_io_hdr_t io_hdr = { 0x0 };
 
-	/* map _TO_DEV to PIO mode */
-	if (dxfer_direction == SG_DXFER_TO_DEV)
-		cdb[1] = SG_ATA_PROTO_PIO_OUT;
-	else if (dxfer_direction == SG_DXFER_FROM_DEV)
-		cdb[1] = SG_ATA_PROTO_PIO_IN;
-	else
-		cdb[1] = SG_ATA_PROTO_NON_DATA;
+	cdb[1] = protocol;
 
 	/* libata workaround: don't demand sense data for IDENTIFY */
 	if (dxfer_len > 0) {
@@ -601,6 +618,24 @@ fu_ata_device_command (FuAtaDevice *self, struct ata_tf *tf,
 	return TRUE;
 }
 
+static gboolean
+fu_ata_device_command (FuAtaDevice *self, struct ata_tf *tf,
+		       gint dxfer_direction, guint timeout_ms,
+		       guint8 *dxferp, gsize dxfer_len, GError **error)
+{
+	guint8 protocol;
+
+	/* map _TO_DEV to PIO mode */
+	if (dxfer_direction == SG_DXFER_TO_DEV)
+		protocol = SG_ATA_PROTO_PIO_OUT;
+	else if (dxfer_direction == SG_DXFER_FROM_DEV)
+		protocol = SG_ATA_PROTO_PIO_IN;
+	else
+		protocol = SG_ATA_PROTO_NON_DATA;
+	return fu_ata_device_command_full (self, tf, protocol, dxfer_direction,
+					   timeout_ms, dxferp, dxfer_len, error);
+}
+
 static gboolean
 fu_ata_device_setup (FuDevice *device, GError **error)
 {
@@ -676,6 +711,7 @@ fu_ata_device_fw_download (FuAtaDevice *self,
 	struct ata_tf tf = { 0x0 };
 	guint32 block_count = data_sz / FU_ATA_BLOCK_SIZE;
 	guint32 buffer_offset = addr / FU_ATA_BLOCK_SIZE;
+	guint8 protocol = SG_ATA_PROTO_PIO_OUT;
 
 	/* write block */
 	tf.dev = 0xa0 | ATA_USING_LBA;
@@ -685,9 +721,14 @@ fu_ata_device_fw_download (FuAtaDevice *self,
 	tf.lbal = block_count >> 8;
 	tf.lbam = buffer_offset & 0xff;
 	tf.lbah = buffer_offset >> 8;
-	if (!fu_ata_device_command (self, &tf, SG_DXFER_TO_DEV,
-				    120 * 1000, /* a long time! */
-				    (guint8 *) data, data_sz, error)) {
+	if (self->dma_supported &&
+	    !fu_device_has_custom_flag (FU_DEVICE (self), "no-dma-download")) {
+		tf.command = ATA_OP_DOWNLOAD_MICROCODE_DMA;
+		protocol = SG_ATA_PROTO_DMA;
+	}
+	if (!fu_ata_device_command_full (self, &tf, protocol, SG_DXFER_TO_DEV,
+					 120 * 1000, /* a long time! */
+					 (guint8 *) data, data_sz, error)) {
 		g_prefix_error (error, "failed to write firmware @0x%0x",
 				(guint) addr);
 		return FALSE;
@@ -728,8 +769,10 @@ fu_ata_device_write_firmware (FuDevice *device,
 	FuAtaDevice *self = FU_ATA_DEVICE (device);
 	guint32 chunksz = (guint32) self->transfer_blocks * FU_ATA_BLOCK_SIZE;
 	guint max_size = 0xffff * FU_ATA_BLOCK_SIZE;
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* get default image */
 	fw = fu_firmware_get_image_default_bytes (firmware, error);
@@ -760,19 +803,19 @@ fu_ata_device_write_firmware (FuDevice *device,
 
 	/* write each block */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	chunks = fu_chunk_array_new_from_bytes (fw, 0x00, 0x00, chunksz);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init_bytes (&iter, fw, 0x00, 0x00, chunksz);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (!fu_ata_device_fw_download (self,
-						chk->idx,
-						chk->address,
-						chk->data,
-						chk->data_sz,
+						chk.idx,
+						chk.address,
+						chk.data,
+						chk.data_sz,
 						error)) {
-			g_prefix_error (error, "failed to write chunk %u: ", i);
+			g_prefix_error (error, "failed to write chunk %u: ", chk.idx);
 			return FALSE;
 		}
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len + 1);
+		fu_device_set_progress_full (device, (gsize) chk.idx + 1, (gsize) chunks_cnt + 1);
 	}
 
 	/* success! */
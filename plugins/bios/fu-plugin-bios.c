@@ -72,9 +72,7 @@ fu_plugin_bios_create_dummy (FuPlugin *plugin, const gchar *reason, GError **err
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
-	g_autofree gchar *sysfsfwdir = NULL;
 	g_autoptr(GError) error_local = NULL;
-	g_autofree gchar *esrt_path = NULL;
 
 	/* are the EFI dirs set up so we can update each device */
 	if (!fu_efivar_supported (&error_local)) {
@@ -83,10 +81,8 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		return fu_plugin_bios_create_dummy (plugin, reason, error);
 	}
 
-	/* get the directory of ESRT entries */
-	sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
-	esrt_path = g_build_filename (sysfsfwdir, "efi", "esrt", NULL);
-	if (!g_file_test (esrt_path, G_FILE_TEST_IS_DIR)) {
+	/* the ESRT is only read once, and the uefi plugin uses it too */
+	if (!fu_esrt_load (fu_plugin_get_esrt (plugin), NULL)) {
 		const gchar *reason = "UEFI Capsule updates not available or enabled";
 		return fu_plugin_bios_create_dummy (plugin, reason, error);
 	}
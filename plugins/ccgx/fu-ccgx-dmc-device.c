@@ -337,6 +337,18 @@ fu_ccgx_dmc_get_image_write_status_cb (FuDevice *device, gpointer user_data, GEr
 	return TRUE;
 }
 
+static gboolean
+fu_ccgx_dmc_device_send_data_record (FuCcgxDmcDevice *self,
+				     GPtrArray *data_records,
+				     guint32 data_index,
+				     GError **error)
+{
+	FuCcgxDmcFirmwareDataRecord *data_rcd = g_ptr_array_index (data_records, data_index);
+	gsize row_size = 0;
+	const guint8 *row_buffer = g_bytes_get_data (data_rcd->data, &row_size);
+	return fu_ccgx_dmc_device_send_row_data (self, row_buffer, (guint16) row_size, error);
+}
+
 static gboolean
 fu_ccgx_dmc_write_firmware_image (FuDevice *device,
 				  FuCcgxDmcFirmwareImageRecord *img_rcd,
@@ -346,6 +358,7 @@ fu_ccgx_dmc_write_firmware_image (FuDevice *device,
 {
 	FuCcgxDmcDevice *self = FU_CCGX_DMC_DEVICE (device);
 	GPtrArray *seg_records;
+	gboolean double_buffered = fu_device_has_custom_flag (device, "has-double-buffered-rows");
 
 	g_return_val_if_fail (img_rcd != NULL, FALSE);
 	g_return_val_if_fail (fw_data_written != NULL, FALSE);
@@ -366,22 +379,22 @@ fu_ccgx_dmc_write_firmware_image (FuDevice *device,
 		/* get data records */
 		data_records = seg_rcd->data_records;
 		for (guint32 data_index = 0; data_index < data_records->len; data_index++) {
-			FuCcgxDmcFirmwareDataRecord *data_rcd;
-			const guint8 *row_buffer = NULL;
-			gsize row_size = 0;
-
-			/* write row data */
-			data_rcd = g_ptr_array_index (data_records, data_index);
-			row_buffer = g_bytes_get_data (data_rcd->data, &row_size);
-			if (!fu_ccgx_dmc_device_send_row_data (self,
-							       row_buffer,
-							       (guint16) row_size,
-							       error))
-				return FALSE;
-
-			/* increase fw written size */
-			*fw_data_written += row_size;
-			fu_device_set_progress_full (device, *fw_data_written, fw_data_size);
+			FuCcgxDmcFirmwareDataRecord *data_rcd = g_ptr_array_index (data_records, data_index);
+
+			/* write row data, unless already sent */
+			if (data_index == 0 || !double_buffered) {
+				if (!fu_ccgx_dmc_device_send_data_record (self, data_records,
+									  data_index, error))
+					return FALSE;
+			}
+
+			/* the dock can accept the next row while it programs this
+			 * one, and the bulk endpoint NAKs until there is space */
+			if (double_buffered && data_index + 1 < data_records->len) {
+				if (!fu_ccgx_dmc_device_send_data_record (self, data_records,
+									  data_index + 1, error))
+					return FALSE;
+			}
 
 			/* get status */
 			if (!fu_device_retry (FU_DEVICE (self),
@@ -389,6 +402,10 @@ fu_ccgx_dmc_write_firmware_image (FuDevice *device,
 					      DMC_FW_WRITE_STATUS_RETRY_COUNT,
 					      NULL, error))
 				return FALSE;
+
+			/* increase fw written size */
+			*fw_data_written += g_bytes_get_size (data_rcd->data);
+			fu_device_set_progress_full (device, *fw_data_written, fw_data_size);
 		}
 	}
 	return TRUE;
@@ -467,8 +484,12 @@ fu_ccgx_dmc_write_firmware (FuDevice *device,
 			return FALSE;
 		}
 
-		/* write image */
+		/* write image; the dock compares the digests in the FWCT itself
+		 * and only asks for the images that are not already installed */
 		img_rcd = g_ptr_array_index (image_records, img_index);
+		g_debug ("dock requested image %u of %u for component 0x%02x",
+			 (guint) img_index, image_records->len,
+			 img_rcd->info_header.comp_id);
 		if (!fu_ccgx_dmc_write_firmware_image (device, img_rcd, &fw_data_written,
 						       fw_data_size, error))
 			return FALSE;
@@ -250,8 +250,6 @@ fu_ccgx_dmc_firmware_parse (FuFirmware *firmware,
 	gsize fw_bufsz = 0;
 	guint16 custom_meta_bufsz = 0;
 	const guint8 *fw_buf = g_bytes_get_data (fw, &fw_bufsz);
-	g_autofree guint8 *custom_meta_buf = NULL;
-	g_autofree guint8 *fwct_buf = NULL;
 	g_autoptr(FuFirmwareImage) img = fu_firmware_image_new (fw);
 
 	/* read fwct info */
@@ -290,15 +288,10 @@ fu_ccgx_dmc_firmware_parse (FuFirmware *firmware,
 		fu_firmware_set_version (firmware, ver);
 	}
 
-	/* read fwct data */
-	fwct_buf = g_malloc0 (self->fwct_info.size);
-	if (!fu_memcpy_safe ((guint8 *) fwct_buf, self->fwct_info.size, 0x0,	/* dst */
-			     fw_buf, fw_bufsz, 0,				/* src */
-			     self->fwct_info.size, error))
-		return FALSE;
-
 	/* create fwct binary */
-	self->fwct_blob = g_bytes_new (fwct_buf, self->fwct_info.size);
+	self->fwct_blob = fu_common_bytes_new_offset (fw, 0x0, self->fwct_info.size, error);
+	if (self->fwct_blob == NULL)
+		return FALSE;
 
 	/* create custom meta binary */
 	if (!fu_common_read_uint16_safe (fw_buf, fw_bufsz, self->fwct_info.size, &custom_meta_bufsz,
@@ -306,14 +299,12 @@ fu_ccgx_dmc_firmware_parse (FuFirmware *firmware,
 		return FALSE;
 
 	if (custom_meta_bufsz > 0) {
-		/* alloc custom meta buffer */
-		custom_meta_buf = g_malloc0 (custom_meta_bufsz);
-		/* read custom metadata */
-		if (!fu_memcpy_safe ((guint8 *)custom_meta_buf, custom_meta_bufsz, 0x0,	/* dst */
-				     fw_buf, fw_bufsz, self->fwct_info.size + 2,	/* src */
-				     custom_meta_bufsz, error))
+		self->custom_meta_blob = fu_common_bytes_new_offset (fw,
+								     self->fwct_info.size + 2,
+								     custom_meta_bufsz,
+								     error);
+		if (self->custom_meta_blob == NULL)
 			return FALSE;
-		self->custom_meta_blob = g_bytes_new (custom_meta_buf, custom_meta_bufsz);
 	}
 
 	/* set row data start offset */
@@ -301,8 +301,7 @@ fu_ccgx_hpi_device_i2c_read (FuCcgxHpiDevice *self,
 		return FALSE;
 	}
 
-	/* 10 msec delay */
-	g_usleep (I2C_READ_WRITE_DELAY_US);
+	/* the interrupt transfer completes when the bridge has finished */
 	if (!fu_ccgx_hpi_device_wait_for_notify (self, NULL, error)) {
 		g_prefix_error (error, "i2c read error: ");
 		return FALSE;
@@ -345,8 +344,7 @@ fu_ccgx_hpi_device_i2c_write (FuCcgxHpiDevice *self,
 		return FALSE;
 	}
 
-	/* 10 msec delay */
-	g_usleep (I2C_READ_WRITE_DELAY_US);
+	/* the interrupt transfer completes when the bridge has finished */
 	if (!fu_ccgx_hpi_device_wait_for_notify (self, NULL, error)) {
 		g_prefix_error (error, "i2c wait for notification error: ");
 		return FALSE;
@@ -412,7 +410,6 @@ fu_ccgx_hpi_device_reg_read_cb (FuDevice *device, gpointer user_data, GError **e
 		g_prefix_error (error, "read error: ");
 		return FALSE;
 	}
-	g_usleep (HPI_CMD_REG_READ_WRITE_DELAY_US);
 	return TRUE;
 }
 
@@ -874,9 +871,9 @@ fu_ccgx_hpi_write_flash_cb (FuDevice *device, gpointer user_data, GError **error
 		helper->addr >> 8,
 	};
 
-	if (!fu_ccgx_hpi_device_clear_all_events (self,
-						  HPI_CMD_COMMAND_CLEAR_EVENT_TIME_MS,
-						  error))
+	/* the previous row response has already been consumed, so only drain
+	 * anything pending rather than waiting for late events on every port */
+	if (!fu_ccgx_hpi_device_clear_all_events (self, 0, error))
 		return FALSE;
 
 	/* write data to memory */
@@ -945,9 +942,7 @@ fu_ccgx_hpi_read_flash_cb (FuDevice *device, gpointer user_data, GError **error)
 	};
 
 	/* set address */
-	if (!fu_ccgx_hpi_device_clear_all_events (self,
-						  HPI_CMD_COMMAND_CLEAR_EVENT_TIME_MS,
-						  error))
+	if (!fu_ccgx_hpi_device_clear_all_events (self, 0, error))
 		return FALSE;
 	if (!fu_ccgx_hpi_device_reg_write (self, CY_PD_REG_FLASH_READ_WRITE_ADDR,
 					   bufhw, sizeof(bufhw), error)) {
@@ -379,8 +379,14 @@ fu_colorhug_device_write_firmware (FuDevice *device,
 						0x00,	/* page_sz */
 						CH_FLASH_TRANSFER_BLOCK_SIZE);
 
+	/* reading back is much quicker than writing */
+	fu_device_add_progress_phase (device, "erase", 5);
+	fu_device_add_progress_phase (device, "write", 70);
+	fu_device_add_progress_phase (device, "verify", 25);
+
 	/* don't auto-boot firmware */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	fu_device_set_progress_phase (device, "erase");
 	if (!fu_colorhug_device_set_flash_success (self, FALSE, error))
 		return FALSE;
 
@@ -389,6 +395,7 @@ fu_colorhug_device_write_firmware (FuDevice *device,
 		return FALSE;
 
 	/* write each block */
+	fu_device_set_progress_phase (device, "write");
 	for (guint i = 0; i < chunks->len; i++) {
 		FuChunk *chk = g_ptr_array_index (chunks, i);
 		guint8 buf[CH_FLASH_TRANSFER_BLOCK_SIZE+4];
@@ -415,11 +422,12 @@ fu_colorhug_device_write_firmware (FuDevice *device,
 		}
 
 		/* update progress */
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len * 2);
+		fu_device_set_progress_full (device, (gsize) i + 1, (gsize) chunks->len);
 	}
 
 	/* verify each block */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	fu_device_set_progress_phase (device, "verify");
 	for (guint i = 0; i < chunks->len; i++) {
 		FuChunk *chk = g_ptr_array_index (chunks, i);
 		guint8 buf[3];
@@ -453,9 +461,7 @@ fu_colorhug_device_write_firmware (FuDevice *device,
 		}
 
 		/* update progress */
-		fu_device_set_progress_full (device,
-					     (gsize) chunks->len + i,
-					     (gsize) chunks->len * 2);
+		fu_device_set_progress_full (device, (gsize) i + 1, (gsize) chunks->len);
 	}
 
 	/* success! */
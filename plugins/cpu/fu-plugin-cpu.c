@@ -30,16 +30,27 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 	gsize length;
 	g_autofree gchar *buf = NULL;
 	g_auto(GStrv) lines = NULL;
+	g_autoptr(GHashTable) packages = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	if (!g_file_get_contents ("/proc/cpuinfo", &buf, &length, error))
 		return FALSE;
 
 	lines = g_strsplit (buf, "\n\n", 0);
 	for (guint i = 0; lines[i] != NULL; i++) {
+		const gchar *physical_id;
 		g_autoptr(FuCpuDevice) dev = NULL;
 		if (strlen (lines[i]) == 0)
 			continue;
 		dev = fu_cpu_device_new (lines[i]);
+
+		/* every logical CPU in a package is identical, and would only
+		 * replace the same device in the device list */
+		physical_id = fu_device_get_physical_id (FU_DEVICE (dev));
+		if (physical_id != NULL) {
+			if (g_hash_table_contains (packages, physical_id))
+				continue;
+			g_hash_table_add (packages, g_strdup (physical_id));
+		}
 		if (!fu_device_setup (FU_DEVICE (dev), error))
 			return FALSE;
 		if (fu_cpu_device_has_flag (dev, FU_CPU_DEVICE_FLAG_SHSTK) &&
@@ -8,7 +8,6 @@
 
 #include <string.h>
 
-#include "fu-chunk.h"
 #include "fu-cros-ec-usb-device.h"
 #include "fu-cros-ec-common.h"
 #include "fu-cros-ec-firmware.h"
@@ -322,8 +321,7 @@ fu_cros_ec_usb_device_transfer_block (FuDevice *device, gpointer user_data,
 	gsize image_size = 0;
 	gsize transfer_size = 0;
 	guint32 reply = 0;
-	g_autoptr(GBytes) block_bytes = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
+	const guint8 *buf;
 
 	g_return_val_if_fail (block_info != NULL, FALSE);
 
@@ -340,13 +338,7 @@ fu_cros_ec_usb_device_transfer_block (FuDevice *device, gpointer user_data,
 		return FALSE;
 	}
 
-	block_bytes = g_bytes_new_from_bytes (block_info->image_bytes,
-					      block_info->offset,
-					      block_info->payload_size);
-	chunks = fu_chunk_array_new_from_bytes (block_bytes,
-						0x00,
-						0x00,
-						self->chunk_len);
+	buf = g_bytes_get_data (block_info->image_bytes, NULL);
 
 	/* first send the header */
 	if (!fu_cros_ec_usb_device_do_xfer (self, (guint8 *)&block_info->ufh,
@@ -356,19 +348,14 @@ fu_cros_ec_usb_device_transfer_block (FuDevice *device, gpointer user_data,
 					    NULL, error))
 		return FALSE;
 
-	/* send the block, chunk by chunk */
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
-
-		if (!fu_cros_ec_usb_device_do_xfer (self,
-						    (guint8 *)chk->data,
-						    chk->data_sz,
-						    NULL,
-						    0, FALSE,
-						    NULL, error)) {
-			return FALSE;
-		}
-	}
+	/* send the whole block, and let libusb split it into packets */
+	if (!fu_cros_ec_usb_device_do_xfer (self,
+					    (guint8 *) buf + block_info->offset,
+					    block_info->payload_size,
+					    NULL,
+					    0, FALSE,
+					    NULL, error))
+		return FALSE;
 
 	/* get the reply */
 	if (!fu_cros_ec_usb_device_do_xfer (self, NULL, 0,
@@ -430,6 +417,14 @@ fu_cros_ec_usb_device_transfer_section (FuDevice *device,
 		return FALSE;
 	}
 
+	if (self->targ.common.maximum_pdu_size == 0) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "maximum PDU size is zero");
+		return FALSE;
+	}
+
 	/* smart update: trim trailing bytes */
 	while (data_len != 0 && (data_ptr[data_len - 1] == 0xff))
 		data_len--;
@@ -561,6 +556,8 @@ fu_cros_ec_usb_device_prepare_firmware (FuDevice *device,
 {
 	FuCrosEcUsbDevice *self = FU_CROS_EC_USB_DEVICE (device);
 	FuCrosEcFirmware *cros_ec_firmware = NULL;
+	GPtrArray *sections;
+	guint sections_needed = 0;
 	g_autoptr(FuFirmware) firmware = fu_cros_ec_firmware_new ();
 
 	fu_device_set_status (device, FWUPD_STATUS_DECOMPRESSING);
@@ -575,6 +572,33 @@ fu_cros_ec_usb_device_prepare_firmware (FuDevice *device,
 		g_prefix_error (error, "failed to pick sections: ");
 		return NULL;
 	}
+
+	/* the start response has the version of the writeable region, so skip
+	 * sections that are already identical unless they were built dirty */
+	sections = fu_cros_ec_firmware_get_sections (cros_ec_firmware);
+	for (guint i = 0; i < sections->len; i++) {
+		FuCrosEcFirmwareSection *section = g_ptr_array_index (sections, i);
+		if (section->ustatus != FU_CROS_EC_FW_NEEDED)
+			continue;
+		if ((flags & FWUPD_INSTALL_FLAG_ALLOW_REINSTALL) == 0 &&
+		    !self->version.dirty &&
+		    strncmp (section->version, self->targ.common.version,
+			     FU_CROS_EC_STRLEN) == 0) {
+			g_debug ("section %s is already %s, skipping",
+				 section->name, section->version);
+			section->ustatus = FU_CROS_EC_FW_NOT_NEEDED;
+			continue;
+		}
+		sections_needed++;
+	}
+	if (sections_needed == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOTHING_TO_DO,
+			     "writeable section is already %s",
+			     self->targ.common.version);
+		return NULL;
+	}
 	return g_steal_pointer (&firmware);
 }
 
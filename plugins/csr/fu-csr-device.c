@@ -36,6 +36,7 @@ struct _FuCsrDevice
 	FuCsrDeviceQuirks	 quirks;
 	DfuState		 dfu_state;
 	guint32			 dnload_timeout;
+	guint			 write_window;	/* reports sent before checking the status */
 };
 
 G_DEFINE_TYPE (FuCsrDevice, fu_csr_device, FU_TYPE_HID_DEVICE)
@@ -58,12 +59,16 @@ G_DEFINE_TYPE (FuCsrDevice, fu_csr_device, FU_TYPE_HID_DEVICE)
 
 #define FU_CSR_DEVICE_TIMEOUT			5000	/* ms */
 
+/* the HID endpoint only buffers a few reports */
+#define FU_CSR_DEVICE_WRITE_WINDOW_MAX		16
+
 static void
 fu_csr_device_to_string (FuDevice *device, guint idt, GString *str)
 {
 	FuCsrDevice *self = FU_CSR_DEVICE (device);
 	fu_common_string_append_kv (str, idt, "State", dfu_state_to_string (self->dfu_state));
 	fu_common_string_append_ku (str, idt, "DownloadTimeout", self->dnload_timeout);
+	fu_common_string_append_ku (str, idt, "WriteWindow", self->write_window);
 }
 
 static gboolean
@@ -258,7 +263,47 @@ fu_csr_device_upload (FuDevice *device, GError **error)
 }
 
 static gboolean
-fu_csr_device_download_chunk (FuCsrDevice *self, guint16 idx, GBytes *chunk, GError **error)
+fu_csr_device_download_chunk_check (FuCsrDevice *self, GError **error)
+{
+	/* wait for hardware */
+	if (self->quirks & FU_CSR_DEVICE_QUIRK_REQUIRE_DELAY) {
+		g_debug ("sleeping for %ums", self->dnload_timeout);
+		g_usleep (self->dnload_timeout * 1000);
+	}
+
+	/* get status */
+	if (!fu_csr_device_get_status (self, error))
+		return FALSE;
+
+	/* is still busy */
+	if (self->dfu_state == DFU_STATE_DFU_DNBUSY) {
+		g_debug ("busy, so sleeping a bit longer");
+		g_usleep (G_USEC_PER_SEC);
+		if (!fu_csr_device_get_status (self, error))
+			return FALSE;
+	}
+
+	/* not correct */
+	if (self->dfu_state != DFU_STATE_DFU_DNLOAD_IDLE &&
+	    self->dfu_state != DFU_STATE_DFU_IDLE) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "device did not return to IDLE");
+		return FALSE;
+	}
+
+	/* success */
+	return TRUE;
+}
+
+/* sends one report, only checking the status if @check is set */
+static gboolean
+fu_csr_device_download_chunk (FuCsrDevice *self,
+			      guint16 idx,
+			      GBytes *chunk,
+			      gboolean check,
+			      GError **error)
 {
 	const guint8 *chunk_data;
 	gsize chunk_sz = 0;
@@ -295,37 +340,9 @@ fu_csr_device_download_chunk (FuCsrDevice *self, guint16 idx, GBytes *chunk, GEr
 		g_prefix_error (error, "failed to Upgrade: ");
 		return FALSE;
 	}
-
-	/* wait for hardware */
-	if (self->quirks & FU_CSR_DEVICE_QUIRK_REQUIRE_DELAY) {
-		g_debug ("sleeping for %ums", self->dnload_timeout);
-		g_usleep (self->dnload_timeout * 1000);
-	}
-
-	/* get status */
-	if (!fu_csr_device_get_status (self, error))
-		return FALSE;
-
-	/* is still busy */
-	if (self->dfu_state == DFU_STATE_DFU_DNBUSY) {
-		g_debug ("busy, so sleeping a bit longer");
-		g_usleep (G_USEC_PER_SEC);
-		if (!fu_csr_device_get_status (self, error))
-			return FALSE;
-	}
-
-	/* not correct */
-	if (self->dfu_state != DFU_STATE_DFU_DNLOAD_IDLE &&
-	    self->dfu_state != DFU_STATE_DFU_IDLE) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INTERNAL,
-				     "device did not return to IDLE");
-		return FALSE;
-	}
-
-	/* success */
-	return TRUE;
+	if (!check)
+		return TRUE;
+	return fu_csr_device_download_chunk_check (self, error);
 }
 
 static FuFirmware *
@@ -373,23 +390,55 @@ fu_csr_device_download (FuDevice *device,
 	chunks = fu_chunk_array_new_from_bytes (blob, 0x0, 0x0,
 						FU_CSR_PACKET_DATA_SIZE - FU_CSR_COMMAND_HEADER_SIZE);
 
-	/* send to hardware */
+	/* send to hardware, only checking the status after each window */
 	for (idx = 0; idx < chunks->len; idx++) {
 		FuChunk *chk = g_ptr_array_index (chunks, idx);
+		gboolean check = (idx + 1) % self->write_window == 0;
 		g_autoptr(GBytes) blob_tmp = g_bytes_new_static (chk->data, chk->data_sz);
 
 		/* send packet */
-		if (!fu_csr_device_download_chunk (self, idx, blob_tmp, error))
+		if (!fu_csr_device_download_chunk (self, idx, blob_tmp, check, error)) {
+			g_prefix_error (error, "failed at report %u: ", (guint) idx);
 			return FALSE;
+		}
 
 		/* update progress */
 		fu_device_set_progress_full (device,
 					     (gsize) idx, (gsize) chunks->len);
 	}
 
-	/* all done */
+	/* all done, which also checks any unconfirmed reports */
 	blob_empty = g_bytes_new (NULL, 0);
-	return fu_csr_device_download_chunk (self, idx, blob_empty, error);
+	return fu_csr_device_download_chunk (self, idx, blob_empty, TRUE, error);
+}
+
+static gboolean
+fu_csr_device_set_quirk_kv (FuDevice *device,
+			    const gchar *key,
+			    const gchar *value,
+			    GError **error)
+{
+	FuCsrDevice *self = FU_CSR_DEVICE (device);
+
+	if (g_strcmp0 (key, "CsrWriteWindow") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp < 1 || tmp > FU_CSR_DEVICE_WRITE_WINDOW_MAX) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_INVALID_DATA,
+					     "CsrWriteWindow out of range");
+			return FALSE;
+		}
+		self->write_window = tmp;
+		return TRUE;
+	}
+
+	/* failed */
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "quirk key not supported");
+	return FALSE;
 }
 
 static gboolean
@@ -424,6 +473,7 @@ fu_csr_device_setup (FuDevice *device, GError **error)
 static void
 fu_csr_device_init (FuCsrDevice *self)
 {
+	self->write_window = 1;
 	fu_device_set_protocol (FU_DEVICE (self), "com.qualcomm.dfu");
 }
 
@@ -438,5 +488,6 @@ fu_csr_device_class_init (FuCsrDeviceClass *klass)
 	klass_device->prepare_firmware = fu_csr_device_prepare_firmware;
 	klass_device->attach = fu_csr_device_attach;
 	klass_device->setup = fu_csr_device_setup;
+	klass_device->set_quirk_kv = fu_csr_device_set_quirk_kv;
 	klass_usb_device->probe = fu_csr_device_probe;
 }
@@ -164,7 +164,10 @@ fu_dell_dock_hub_finalize (GObject *object)
 static void
 fu_dell_dock_hub_init (FuDellDockHub *self)
 {
-	fu_device_retry_set_delay (FU_DEVICE (self), 1000);
+	/* recover quickly from transient HID failures, but still allow about
+	 * the same total time as a fixed 1s delay for a slow dock */
+	fu_device_retry_set_delay (FU_DEVICE (self), 250);
+	fu_device_retry_set_backoff (FU_DEVICE (self), 2, 2000);
 }
 
 static void
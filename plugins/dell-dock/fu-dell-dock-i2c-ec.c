@@ -146,6 +146,8 @@ struct _FuDellDockEc {
 	guint64				 blob_version_offset;
 	guint8				 passive_flow;
 	guint32				 dock_unlock_status;
+	guint32				 dock_lock_deferred;
+	gboolean			 composite;
 };
 
 static gboolean	fu_dell_dock_get_ec_status	(FuDevice *device,
@@ -584,6 +586,20 @@ fu_dell_dock_ec_modify_lock (FuDevice *device,
 	g_return_val_if_fail (device != NULL, FALSE);
 	g_return_val_if_fail (target != 0, FALSE);
 
+	/* during a composite update leave each target unlocked until the end */
+	if (self->composite) {
+		if (unlocked && (self->dock_unlock_status & (1u << target))) {
+			BIT_CLEAR (self->dock_lock_deferred, target);
+			g_debug ("%d already unlocked", target);
+			return TRUE;
+		}
+		if (!unlocked) {
+			BIT_SET (self->dock_lock_deferred, target);
+			g_debug ("deferring lock for %d", target);
+			return TRUE;
+		}
+	}
+
 	cmd = EC_CMD_MODIFY_LOCK |	/* cmd */
 	      2 << 8 |			/* length of data arguments */
 	      target << 16 |		/* device to operate on */
@@ -608,6 +624,45 @@ fu_dell_dock_ec_modify_lock (FuDevice *device,
 	return TRUE;
 }
 
+gboolean
+fu_dell_dock_ec_composite_begin (FuDevice *device, GError **error)
+{
+	FuDellDockEc *self = FU_DELL_DOCK_EC (device);
+
+	g_return_val_if_fail (device != NULL, FALSE);
+
+	/* keep the EC open for the whole transaction */
+	if (!fu_device_open (device, error))
+		return FALSE;
+	self->composite = TRUE;
+	self->dock_lock_deferred = 0;
+	return TRUE;
+}
+
+gboolean
+fu_dell_dock_ec_composite_end (FuDevice *device, GError **error)
+{
+	FuDellDockEc *self = FU_DELL_DOCK_EC (device);
+
+	g_return_val_if_fail (device != NULL, FALSE);
+
+	if (!self->composite)
+		return TRUE;
+	self->composite = FALSE;
+
+	/* apply the locks that were skipped */
+	for (guint8 i = 1; i < 32; i++) {
+		if ((self->dock_lock_deferred & (1u << i)) == 0)
+			continue;
+		if (!fu_dell_dock_ec_modify_lock (device, i, FALSE, error)) {
+			fu_device_close (device, NULL);
+			return FALSE;
+		}
+	}
+	self->dock_lock_deferred = 0;
+	return fu_device_close (device, error);
+}
+
 static gboolean
 fu_dell_dock_ec_reset (FuDevice *device, GError **error)
 {
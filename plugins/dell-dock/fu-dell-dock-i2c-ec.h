@@ -36,6 +36,10 @@ gboolean	 fu_dell_dock_ec_modify_lock		(FuDevice *self,
 
 gboolean	fu_dell_dock_ec_reboot_dock		(FuDevice *device,
 							 GError **error);
+gboolean	 fu_dell_dock_ec_composite_begin	(FuDevice *device,
+							 GError **error);
+gboolean	 fu_dell_dock_ec_composite_end		(FuDevice *device,
+							 GError **error);
 
 const gchar	*fu_dell_dock_ec_get_mst_version	(FuDevice *device);
 const gchar	*fu_dell_dock_ec_get_tbt_version	(FuDevice *device);
@@ -176,6 +176,11 @@ fu_plugin_composite_prepare (FuPlugin *plugin, GPtrArray *devices,
 	if (sku != NULL)
 		fu_plugin_add_report_metadata (plugin, "DellDockSKU", sku);
 
+	/* stage all the components without relocking between each one */
+	if (!fu_dell_dock_ec_composite_begin (parent, error))
+		return FALSE;
+	fu_plugin_cache_add (plugin, "composite-ec", parent);
+
 	return TRUE;
 }
 
@@ -186,9 +191,24 @@ fu_plugin_composite_cleanup (FuPlugin *plugin,
 {
 	FuDevice *parent = fu_plugin_dell_dock_get_ec (devices);
 	FuDevice *dev = NULL;
+	FuDevice *composite_ec = fu_plugin_cache_lookup (plugin, "composite-ec");
 	g_autoptr(FuDeviceLocker) locker = NULL;
 	gboolean needs_activation = FALSE;
 
+	/* the EC may have been replaced if the dock replugged */
+	if (composite_ec != NULL) {
+		g_autoptr(FuDevice) ec_tmp = g_object_ref (composite_ec);
+		g_autoptr(GError) error_local = NULL;
+		fu_plugin_cache_remove (plugin, "composite-ec");
+		if (!fu_dell_dock_ec_composite_end (ec_tmp, &error_local)) {
+			if (ec_tmp == parent) {
+				g_propagate_error (error, g_steal_pointer (&error_local));
+				return FALSE;
+			}
+			g_debug ("ignoring: %s", error_local->message);
+		}
+	}
+
 	if (parent == NULL)
 		return TRUE;
 
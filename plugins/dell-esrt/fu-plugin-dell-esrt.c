@@ -94,13 +94,9 @@ gboolean
 fu_plugin_startup (FuPlugin *plugin, GError **error)
 {
 	gboolean capsule_disable = FALSE;
-	g_autofree gchar *sysfsfwdir = NULL;
-	g_autofree gchar *esrtdir = NULL;
 
-	/* already exists */
-	sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
-	esrtdir = g_build_filename (sysfsfwdir, "efi", "esrt", NULL);
-	if (g_file_test (esrtdir, G_FILE_TEST_EXISTS)) {
+	/* already exists, and the uefi plugin will reuse the parsed table */
+	if (fu_esrt_load (fu_plugin_get_esrt (plugin), NULL)) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOT_SUPPORTED,
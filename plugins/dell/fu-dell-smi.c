@@ -30,6 +30,15 @@ typedef union _ADDR_UNION{
 } ADDR_UNION;
 #pragma pack()
 
+/* each SMI stalls every CPU core, so keep track of how many we do */
+static guint fu_dell_smi_count = 0;
+
+guint
+fu_dell_smi_get_count (void)
+{
+	return fu_dell_smi_count;
+}
+
 static void
 _dell_smi_obj_free (FuDellSmiObj *obj)
 {
@@ -64,6 +73,7 @@ fu_dell_execute_smi (FuDellSmiObj *obj)
 	if (obj->fake_smbios)
 		return TRUE;
 
+	fu_dell_smi_count++;
 	ret = dell_smi_obj_execute (obj->smi);
 	if (ret != 0) {
 		g_debug ("SMI execution failed: %i", ret);
@@ -88,6 +98,7 @@ fu_dell_execute_simple_smi (FuDellSmiObj *obj, guint16 class, guint16 select)
 	if (obj->fake_smbios)
 		return TRUE;
 
+	fu_dell_smi_count++;
 	if (dell_simple_ci_smi (class,
 				select,
 				obj->input,
@@ -178,21 +189,11 @@ fu_dell_query_dock (FuDellSmiObj *smi_obj, DOCK_UNION *buf)
 	return TRUE;
 }
 
+/* the type comes from the dock info that was just queried, so querying
+ * again for DOCK_TYPE_NONE would only return the same record */
 const gchar*
 fu_dell_get_dock_type (guint8 type)
 {
-	g_autoptr (FuDellSmiObj) smi_obj = NULL;
-	DOCK_UNION buf;
-
-	/* not yet initialized, look it up */
-	if (type == DOCK_TYPE_NONE) {
-		smi_obj = g_malloc0 (sizeof(FuDellSmiObj));
-		smi_obj->smi = dell_smi_factory (DELL_SMI_DEFAULTS);
-		if (!fu_dell_query_dock (smi_obj, &buf))
-			return NULL;
-		type = buf.record->dock_info_header.dock_type;
-	}
-
 	switch (type) {
 	case DOCK_TYPE_TB16:
 		return "TB16";
@@ -250,6 +251,7 @@ fu_dell_toggle_host_mode (FuDellSmiObj *smi_obj, const efi_guid_t guid, int mode
 		return FALSE;
 	}
 	*buf.guid = guid;
+	fu_dell_smi_count++;
 	ret = dell_smi_obj_execute(smi_obj->smi);
 	if (ret != SMI_SUCCESS){
 		g_debug ("failed to execute SMI: %d", ret);
@@ -70,6 +70,9 @@ typedef enum _CABLE_TYPE
 	CABLE_TYPE_TBT
 } CABLE_TYPE;
 
+guint
+fu_dell_smi_get_count (void);
+
 gboolean
 fu_dell_clear_smi (FuDellSmiObj *obj);
 
@@ -338,6 +338,7 @@ fu_plugin_usb_device_added (FuPlugin *plugin,
 		g_debug ("no dock detected");
 		return TRUE;
 	}
+	g_debug ("%u SMIs used in total", fu_dell_smi_get_count ());
 
 	if (buf.record->dock_info_header.dir_version != 1) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED,
@@ -907,6 +908,7 @@ fu_plugin_dell_coldplug (FuPlugin *plugin, GError **error)
 	/* look for switchable TPM */
 	if (!fu_plugin_dell_detect_tpm (plugin, error))
 		g_debug ("No switchable TPM detected");
+	g_debug ("%u SMIs used at coldplug", fu_dell_smi_get_count ());
 	return TRUE;
 }
 
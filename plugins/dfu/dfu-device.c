@@ -44,6 +44,7 @@
  * * `legacy-protocol`:		Use a legacy protocol version
  * * `detach-for-attach`:	Requires a DFU_REQUEST_DETACH to attach
  * * `absent-sector-size`:	In absence of sector size, assume byte
+ * * `diff-flash`:		Only erase and write DfuSe sectors that have changed
  *
  * Default value: `none`
  *
@@ -95,6 +96,7 @@ typedef struct {
 	guint16			 runtime_vid;
 	guint16			 runtime_release;
 	guint16			 transfer_size;
+	guint16			 force_transfer_size;
 	guint8			 iface_number;
 	guint			 dnload_timeout;
 	guint			 timeout_ms;
@@ -122,6 +124,8 @@ dfu_device_to_string (FuDevice *device, guint idt, GString *str)
 	fu_common_string_append_kx (str, idt, "RuntimeVid", priv->runtime_vid);
 	fu_common_string_append_kx (str, idt, "RuntimeRelease", priv->runtime_release);
 	fu_common_string_append_kx (str, idt, "TransferSize", priv->transfer_size);
+	if (priv->force_transfer_size > 0)
+		fu_common_string_append_kx (str, idt, "ForceTransferSize", priv->force_transfer_size);
 	fu_common_string_append_kx (str, idt, "IfaceNumber", priv->iface_number);
 	fu_common_string_append_kx (str, idt, "DnloadTimeout", priv->dnload_timeout);
 	fu_common_string_append_kx (str, idt, "TimeoutMs", priv->timeout_ms);
@@ -341,7 +345,10 @@ dfu_device_add_targets (DfuDevice *device, GError **error)
 		}
 
 		/* fix up the transfer size */
-		if (priv->transfer_size == 0xffff) {
+		if (priv->force_transfer_size > 0) {
+			priv->transfer_size = priv->force_transfer_size;
+			g_debug ("DFU transfer size forced by quirk");
+		} else if (priv->transfer_size == 0xffff) {
 			priv->transfer_size = 0x0400;
 			g_debug ("DFU transfer size unspecified, guessing");
 		}
@@ -1180,6 +1187,26 @@ dfu_device_get_interface (DfuDevice *device)
 	return priv->iface_number;
 }
 
+static gboolean
+dfu_device_wait_for_idle_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	DfuDevice *self = DFU_DEVICE (device);
+	DfuDevicePrivate *priv = GET_PRIVATE (self);
+
+	if (!dfu_device_refresh (self, error))
+		return FALSE;
+	if (priv->state != DFU_STATE_APP_IDLE &&
+	    priv->state != DFU_STATE_DFU_IDLE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "device is %s",
+			     dfu_state_to_string (priv->state));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /**
  * dfu_device_open:
  * @device: a #DfuDevice
@@ -1206,6 +1233,22 @@ dfu_device_open (FuUsbDevice *device, GError **error)
 		priv->status = DFU_STATUS_OK;
 	}
 
+	/* hardware rom Jabra literally reboots if you try to retry a failed
+	 * write, so wait until it reports it is idle after re-enumerating */
+	if (fu_device_has_custom_flag (FU_DEVICE (self), "attach-extra-reset")) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_device_retry_with_backoff (FU_DEVICE (self),
+						   dfu_device_wait_for_idle_cb,
+						   100,		/* ms */
+						   10000,	/* ms */
+						   NULL, &error_local)) {
+			g_propagate_prefixed_error (error,
+						    g_steal_pointer (&error_local),
+						    "device did not become idle: ");
+			return FALSE;
+		}
+	}
+
 	/* set up target ready for use */
 	for (guint j = 0; j < targets->len; j++) {
 		DfuTarget *target = g_ptr_array_index (targets, j);
@@ -1265,11 +1308,6 @@ dfu_device_probe (FuUsbDevice *device, GError **error)
 			   g_usb_device_get_pid (usb_device));
 	}
 
-	/* hardware rom Jabra literally reboots if you try to retry a failed
-	 * write -- there's no way to avoid blocking the daemon like this... */
-	if (fu_device_has_custom_flag (FU_DEVICE (device), "attach-extra-reset"))
-		g_usleep (10 * G_USEC_PER_SEC);
-
 	/* success */
 	return TRUE;
 }
@@ -1759,6 +1797,18 @@ dfu_device_set_quirk_kv (FuDevice *device,
 				     "invalid DFU timeout");
 		return FALSE;
 	}
+	if (g_strcmp0 (key, "DfuForceTransferSize") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp > 0 && tmp < G_MAXUINT16) {
+			priv->force_transfer_size = tmp;
+			return TRUE;
+		}
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "invalid DFU transfer size");
+		return FALSE;
+	}
 
 	/* failed */
 	g_set_error_literal (error,
@@ -502,7 +502,9 @@ dfu_target_avr_download_element (DfuTarget *target,
 	guint16 page_last = G_MAXUINT16;
 	guint32 address;
 	guint32 address_offset = 0x0;
-	g_autoptr(GPtrArray) chunks = NULL;
+	guint32 chunks_cnt;
+	FuChunk chk;
+	FuChunkIter iter;
 	const guint8 footer[] = { 0x00, 0x00, 0x00, 0x00,	/* CRC */
 				  16,				/* len */
 				  'D', 'F', 'U',		/* signature */
@@ -555,56 +557,57 @@ dfu_target_avr_download_element (DfuTarget *target,
 
 	/* chunk up the memory space into pages */
 	data = g_bytes_get_data (blob, NULL);
-	chunks = fu_chunk_array_new (data + address_offset,
-				     g_bytes_get_size (blob) - address_offset,
-				     dfu_sector_get_address (sector),
-				     ATMEL_64KB_PAGE,
-				     ATMEL_MAX_TRANSFER_SIZE);
+	fu_chunk_iter_init (&iter,
+			    data + address_offset,
+			    g_bytes_get_size (blob) - address_offset,
+			    dfu_sector_get_address (sector),
+			    ATMEL_64KB_PAGE,
+			    ATMEL_MAX_TRANSFER_SIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 
 	/* update UI */
 	dfu_target_set_action (target, FWUPD_STATUS_DEVICE_WRITE);
 
 	/* process each chunk */
-	for (guint i = 0; i < chunks->len; i++) {
-		const FuChunk *chk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_autofree guint8 *buf = NULL;
 		g_autoptr(GBytes) chunk_tmp = NULL;
 
 		/* select page if required */
-		if (chk->page != page_last) {
+		if (chk.page != page_last) {
 			if (fu_device_has_custom_flag (FU_DEVICE (dfu_target_get_device (target)),
 						       "legacy-protocol")) {
 				if (!dfu_target_avr_select_memory_page (target,
-									chk->page,
+									chk.page,
 									error))
 					return FALSE;
 			} else {
 				if (!dfu_target_avr32_select_memory_page (target,
-									  chk->page,
+									  chk.page,
 									  error))
 					return FALSE;
 			}
-			page_last = chk->page;
+			page_last = chk.page;
 		}
 
 		/* create chk with header and footer */
-		buf = g_malloc0 (chk->data_sz + header_sz + sizeof(footer));
+		buf = g_malloc0 (chk.data_sz + header_sz + sizeof(footer));
 		buf[0] = DFU_AVR32_GROUP_DOWNLOAD;
 		buf[1] = DFU_AVR32_CMD_PROGRAM_START;
-		fu_common_write_uint16 (&buf[2], chk->address, G_BIG_ENDIAN);
-		fu_common_write_uint16 (&buf[4], chk->address + chk->data_sz - 1, G_BIG_ENDIAN);
-		memcpy (&buf[header_sz], chk->data, chk->data_sz);
-		memcpy (&buf[header_sz + chk->data_sz], footer, sizeof(footer));
+		fu_common_write_uint16 (&buf[2], chk.address, G_BIG_ENDIAN);
+		fu_common_write_uint16 (&buf[4], chk.address + chk.data_sz - 1, G_BIG_ENDIAN);
+		memcpy (&buf[header_sz], chk.data, chk.data_sz);
+		memcpy (&buf[header_sz + chk.data_sz], footer, sizeof(footer));
 
 		/* download data */
-		chunk_tmp = g_bytes_new_static (buf, chk->data_sz + header_sz + sizeof(footer));
+		chunk_tmp = g_bytes_new_static (buf, chk.data_sz + header_sz + sizeof(footer));
 		g_debug ("sending %" G_GSIZE_FORMAT " bytes to the hardware",
 			 g_bytes_get_size (chunk_tmp));
-		if (!dfu_target_download_chunk (target, i, chunk_tmp, error))
+		if (!dfu_target_download_chunk (target, chk.idx, chunk_tmp, error))
 			return FALSE;
 
 		/* update UI */
-		dfu_target_set_percentage (target, i + 1, chunks->len);
+		dfu_target_set_percentage (target, chk.idx + 1, chunks_cnt);
 	}
 
 	/* done */
@@ -626,7 +629,9 @@ dfu_target_avr_upload_element (DfuTarget *target,
 	g_autoptr(GBytes) contents = NULL;
 	g_autoptr(GBytes) contents_truncated = NULL;
 	g_autoptr(GPtrArray) blobs = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
+	guint32 chunks_cnt;
+	FuChunk chk;
+	FuChunkIter iter;
 	DfuSector *sector;
 
 	/* select unit */
@@ -656,46 +661,46 @@ dfu_target_avr_upload_element (DfuTarget *target,
 	address &= ~0x80000000;
 
 	/* chunk up the memory space into pages */
-	chunks = fu_chunk_array_new (NULL, maximum_size, address,
-				     ATMEL_64KB_PAGE, ATMEL_MAX_TRANSFER_SIZE);
+	fu_chunk_iter_init (&iter, NULL, maximum_size, address,
+			    ATMEL_64KB_PAGE, ATMEL_MAX_TRANSFER_SIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 
 	/* update UI */
 	dfu_target_set_action (target, FWUPD_STATUS_DEVICE_READ);
 
 	/* process each chunk */
 	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
-	for (guint i = 0; i < chunks->len; i++) {
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		GBytes *blob_tmp = NULL;
-		const FuChunk *chk = g_ptr_array_index (chunks, i);
 
 		/* select page if required */
-		if (chk->page != page_last) {
+		if (chk.page != page_last) {
 			if (fu_device_has_custom_flag (FU_DEVICE (dfu_target_get_device (target)),
 						       "legacy-protocol")) {
 				if (!dfu_target_avr_select_memory_page (target,
-									chk->page,
+									chk.page,
 									error))
 					return NULL;
 			} else {
 				if (!dfu_target_avr32_select_memory_page (target,
-									  chk->page,
+									  chk.page,
 									  error))
 					return NULL;
 			}
-			page_last = chk->page;
+			page_last = chk.page;
 		}
 
 		/* prepare to read */
 		if (!dfu_target_avr_read_memory (target,
-						 chk->address,
-						 chk->address + chk->data_sz - 1,
+						 chk.address,
+						 chk.address + chk.data_sz - 1,
 						 error))
 			return NULL;
 
 		/* upload data */
 		g_debug ("requesting %i bytes from the hardware for chunk 0x%x",
-			 ATMEL_MAX_TRANSFER_SIZE, i);
-		blob_tmp = dfu_target_upload_chunk (target, i,
+			 ATMEL_MAX_TRANSFER_SIZE, chk.idx);
+		blob_tmp = dfu_target_upload_chunk (target, chk.idx,
 						    ATMEL_MAX_TRANSFER_SIZE,
 						    error);
 		if (blob_tmp == NULL)
@@ -705,14 +710,14 @@ dfu_target_avr_upload_element (DfuTarget *target,
 		/* this page has valid data */
 		if (!fu_common_bytes_is_empty (blob_tmp)) {
 			g_debug ("chunk %u has data (page %" G_GUINT32_FORMAT ")",
-				 i, chk->page);
-			chunk_valid = i;
+				 chk.idx, chk.page);
+			chunk_valid = chk.idx;
 		} else {
-			g_debug ("chunk %u is empty", i);
+			g_debug ("chunk %u is empty", chk.idx);
 		}
 
 		/* update UI */
-		dfu_target_set_percentage (target, i + 1, chunks->len);
+		dfu_target_set_percentage (target, chk.idx + 1, chunks_cnt);
 	}
 
 	/* done */
@@ -722,7 +727,6 @@ dfu_target_avr_upload_element (DfuTarget *target,
 	/* truncate the image if any sectors are empty, i.e. all 0xff */
 	if (chunk_valid == G_MAXUINT) {
 		g_debug ("all %u chunks are empty", blobs->len);
-		g_ptr_array_set_size (chunks, 0);
 	} else if (blobs->len != chunk_valid + 1) {
 		g_debug ("truncating chunks from %u to %u",
 			 blobs->len, chunk_valid + 1);
@@ -234,6 +234,40 @@ dfu_target_stm_erase_address (DfuTarget *target, guint32 address, GError **error
 	return dfu_target_check_status (target, error);
 }
 
+/* reads back the part of @sector covered by @element and compares it with the
+ * new contents, so that unchanged sectors do not need erasing or writing */
+static gboolean
+dfu_target_stm_sector_is_unchanged (DfuTarget *target,
+				    DfuElement *element,
+				    DfuSector *sector,
+				    gboolean *unchanged,
+				    GError **error)
+{
+	GBytes *bytes = dfu_element_get_contents (element);
+	guint32 img_start = dfu_element_get_address (element);
+	guint32 img_end = img_start + g_bytes_get_size (bytes);
+	guint32 start = MAX (dfu_sector_get_address (sector), img_start);
+	guint32 end = MIN (dfu_sector_get_address (sector) + dfu_sector_get_size (sector), img_end);
+	g_autoptr(DfuElement) element_old = NULL;
+	g_autoptr(GBytes) bytes_new = NULL;
+
+	/* cannot tell */
+	*unchanged = FALSE;
+	if (!dfu_sector_has_cap (sector, DFU_SECTOR_CAP_READABLE) || end <= start)
+		return TRUE;
+
+	element_old = dfu_target_stm_upload_element (target, start,
+						     end - start, end - start,
+						     error);
+	if (element_old == NULL) {
+		g_prefix_error (error, "failed to read back 0x%04x: ", start);
+		return FALSE;
+	}
+	bytes_new = g_bytes_new_from_bytes (bytes, start - img_start, end - start);
+	*unchanged = g_bytes_equal (dfu_element_get_contents (element_old), bytes_new);
+	return TRUE;
+}
+
 static gboolean
 dfu_target_stm_download_element (DfuTarget *target,
 				 DfuElement *element,
@@ -245,9 +279,12 @@ dfu_target_stm_download_element (DfuTarget *target,
 	GBytes *bytes;
 	guint nr_chunks;
 	guint zone_last = G_MAXUINT;
+	guint blk_base = 0;
+	gboolean set_address = FALSE;
 	guint16 transfer_size = dfu_device_get_transfer_size (device);
 	g_autoptr(GPtrArray) sectors_array = NULL;
 	g_autoptr(GHashTable) sectors_hash = NULL;
+	g_autoptr(GHashTable) sectors_unchanged = NULL;
 
 	/* round up as we have to transfer incomplete blocks */
 	bytes = dfu_element_get_contents (element);
@@ -301,10 +338,30 @@ dfu_target_stm_download_element (DfuTarget *target,
 		}
 	}
 
+	/* optionally skip the sectors where the contents already match */
+	if (fu_device_has_custom_flag (FU_DEVICE (device), "diff-flash")) {
+		sectors_unchanged = g_hash_table_new (g_direct_hash, g_direct_equal);
+		for (guint i = 0; i < sectors_array->len; i++) {
+			gboolean unchanged = FALSE;
+			sector = g_ptr_array_index (sectors_array, i);
+			if (!dfu_target_stm_sector_is_unchanged (target, element, sector,
+								 &unchanged, error))
+				return FALSE;
+			if (unchanged) {
+				g_debug ("sector 0x%04x unchanged, skipping",
+					 dfu_sector_get_address (sector));
+				g_hash_table_add (sectors_unchanged, sector);
+			}
+		}
+	}
+
 	/* 2nd pass: actually erase sectors */
 	dfu_target_set_action (target, FWUPD_STATUS_DEVICE_ERASE);
 	for (guint i = 0; i < sectors_array->len; i++) {
 		sector = g_ptr_array_index (sectors_array, i);
+		if (sectors_unchanged != NULL &&
+		    g_hash_table_contains (sectors_unchanged, sector))
+			continue;
 		g_debug ("erasing sector at 0x%04x",
 			 dfu_sector_get_address (sector));
 		if (!dfu_target_stm_erase_address (target,
@@ -332,8 +389,24 @@ dfu_target_stm_download_element (DfuTarget *target,
 		sector = dfu_target_get_sector_for_addr (target, offset_dev);
 		g_assert (sector != NULL);
 
-		/* manually set the sector address */
-		if (dfu_sector_get_zone (sector) != zone_last) {
+		/* we have to write one final zero-sized chunk for EOF */
+		length = g_bytes_get_size (bytes) - offset;
+		if (length > transfer_size)
+			length = transfer_size;
+
+		/* the whole chunk is in sectors that already match */
+		if (sectors_unchanged != NULL &&
+		    g_hash_table_contains (sectors_unchanged, sector) &&
+		    g_hash_table_contains (sectors_unchanged,
+					   dfu_target_get_sector_for_addr (target,
+									   offset_dev + length - 1))) {
+			set_address = TRUE;
+			continue;
+		}
+
+		/* manually set the sector address, restarting the block
+		 * numbering if any chunks were skipped */
+		if (dfu_sector_get_zone (sector) != zone_last || set_address) {
 			g_debug ("setting address to 0x%04x",
 				 (guint) offset_dev);
 			if (!dfu_target_stm_set_address (target,
@@ -341,19 +414,18 @@ dfu_target_stm_download_element (DfuTarget *target,
 							 error))
 				return FALSE;
 			zone_last = dfu_sector_get_zone (sector);
+			if (set_address)
+				blk_base = i;
+			set_address = FALSE;
 		}
 
-		/* we have to write one final zero-sized chunk for EOF */
-		length = g_bytes_get_size (bytes) - offset;
-		if (length > transfer_size)
-			length = transfer_size;
 		bytes_tmp = g_bytes_new_from_bytes (bytes, offset, length);
 		g_debug ("writing sector at 0x%04x (0x%" G_GSIZE_FORMAT ")",
 			 offset_dev,
 			 g_bytes_get_size (bytes_tmp));
 		/* ST uses wBlockNum=0 for DfuSe commands and wBlockNum=1 is reserved */
 		if (!dfu_target_download_chunk (target,
-						(guint8) (i + 2),
+						(guint8) (i - blk_base + 2),
 						bytes_tmp,
 						error))
 			return FALSE;
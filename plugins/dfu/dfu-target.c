@@ -712,27 +712,30 @@ dfu_target_download_chunk (DfuTarget *target, guint16 index, GBytes *bytes, GErr
 		return FALSE;
 	}
 
-	/* for STM32 devices, the action only occurs when we do GetStatus */
-	if (dfu_device_get_version (priv->device) == DFU_VERSION_DFUSE) {
-		if (!dfu_device_refresh (priv->device, error))
-			return FALSE;
-	}
+	/* the action only occurs when we do GetStatus, and the device then
+	 * tells us exactly how long to wait before asking again */
+	if (!dfu_device_refresh (priv->device, error))
+		return FALSE;
 
 	/* wait for the device to write contents to the EEPROM */
 	if (g_bytes_get_size (bytes) == 0 &&
 	    dfu_device_get_download_timeout (priv->device) > 0) {
 		dfu_target_set_action (target, FWUPD_STATUS_IDLE);
 		dfu_target_set_action (target, FWUPD_STATUS_DEVICE_BUSY);
-	}
-	if (dfu_device_get_download_timeout (priv->device) > 0) {
 		g_debug ("sleeping for %ums…",
 			 dfu_device_get_download_timeout (priv->device));
 		g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
 	}
 
-	/* find out if the write was successful */
-	if (!dfu_device_refresh (priv->device, error))
-		return FALSE;
+	/* only wait when the device says it is still busy, rather than always
+	 * sleeping for the bwPollTimeout of the previous chunk */
+	while (dfu_device_get_state (priv->device) == DFU_STATE_DFU_DNBUSY) {
+		g_debug ("sleeping for %ums…",
+			 dfu_device_get_download_timeout (priv->device));
+		g_usleep (dfu_device_get_download_timeout (priv->device) * 1000);
+		if (!dfu_device_refresh (priv->device, error))
+			return FALSE;
+	}
 
 	g_assert (actual_length == g_bytes_get_size (bytes));
 	return TRUE;
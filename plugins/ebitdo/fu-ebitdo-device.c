@@ -17,6 +17,7 @@
 struct _FuEbitdoDevice {
 	FuUsbDevice		 parent_instance;
 	guint32			 serial[9];
+	gboolean		 verbose;
 };
 
 G_DEFINE_TYPE (FuEbitdoDevice, fu_ebitdo_device, FU_TYPE_USB_DEVICE)
@@ -71,7 +72,7 @@ fu_ebitdo_device_send (FuEbitdoDevice *self,
 	}
 
 	/* debug */
-	if (g_getenv ("FWUPD_EBITDO_VERBOSE") != NULL) {
+	if (self->verbose) {
 		fu_common_dump_raw (G_LOG_DOMAIN, "->DEVICE", packet, (gsize) hdr->pkt_len + 1);
 		fu_ebitdo_dump_pkt (hdr);
 	}
@@ -132,7 +133,7 @@ fu_ebitdo_device_receive (FuEbitdoDevice *self,
 	}
 
 	/* debug */
-	if (g_getenv ("FWUPD_EBITDO_VERBOSE") != NULL) {
+	if (self->verbose) {
 		fu_common_dump_raw (G_LOG_DOMAIN, "<-DEVICE", packet, actual_length);
 		fu_ebitdo_dump_pkt (hdr);
 	}
@@ -449,7 +450,7 @@ fu_ebitdo_device_write_firmware (FuDevice *device,
 	chunks = fu_chunk_array_new_from_bytes (fw_payload, 0x0, 0x0, 32);
 	for (guint i = 0; i < chunks->len; i++) {
 		FuChunk *chunk = g_ptr_array_index (chunks, i);
-		if (g_getenv ("FWUPD_EBITDO_VERBOSE") != NULL) {
+		if (self->verbose) {
 			g_debug ("writing %u bytes to 0x%04x of 0x%04x",
 				 chunk->data_sz, chunk->address, chunk->data_sz);
 		}
@@ -590,6 +591,8 @@ fu_ebitdo_device_prepare_firmware (FuDevice *device,
 static void
 fu_ebitdo_device_init (FuEbitdoDevice *self)
 {
+	/* checked for every packet, so only look up the environment once */
+	self->verbose = g_getenv ("FWUPD_EBITDO_VERBOSE") != NULL;
 	fu_device_set_protocol (FU_DEVICE (self), "com.8bitdo");
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_ADD_COUNTERPART_GUIDS);
 }
@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include "fu-ebitdo-firmware.h"
+#include "fu-ebitdo-struct.h"
 
 struct _FuEbitdoFirmware {
 	FuFirmwareClass		 parent_instance;
@@ -14,14 +15,6 @@ struct _FuEbitdoFirmware {
 
 G_DEFINE_TYPE (FuEbitdoFirmware, fu_ebitdo_firmware, FU_TYPE_FIRMWARE)
 
-/* little endian */
-typedef struct __attribute__((packed)) {
-	guint32		version;
-	guint32		destination_addr;
-	guint32		destination_len;
-	guint32		reserved[4];
-} FuEbitdoFirmwareHeader;
-
 static gboolean
 fu_ebitdo_firmware_parse (FuFirmware *firmware,
 			  GBytes *fw,
@@ -30,8 +23,10 @@ fu_ebitdo_firmware_parse (FuFirmware *firmware,
 			  FwupdInstallFlags flags,
 			  GError **error)
 {
-	FuEbitdoFirmwareHeader *hdr;
+	const guint8 *buf;
+	gsize bufsz = 0;
 	guint32 payload_len;
+	guint32 reserved[FU_EBITDO_FIRMWARE_HDR_RESERVED_LEN];
 	g_autofree gchar *version = NULL;
 	g_autoptr(FuFirmwareImage) img_hdr = fu_firmware_image_new (NULL);
 	g_autoptr(FuFirmwareImage) img_payload = fu_firmware_image_new (NULL);
@@ -39,7 +34,8 @@ fu_ebitdo_firmware_parse (FuFirmware *firmware,
 	g_autoptr(GBytes) fw_payload = NULL;
 
 	/* corrupt */
-	if (g_bytes_get_size (fw) < sizeof (FuEbitdoFirmwareHeader)) {
+	buf = g_bytes_get_data (fw, &bufsz);
+	if (!fu_ebitdo_firmware_hdr_validate (buf, bufsz, 0x0, NULL)) {
 		g_set_error_literal (error,
 				     G_IO_ERROR,
 				     G_IO_ERROR_INVALID_DATA,
@@ -48,44 +44,44 @@ fu_ebitdo_firmware_parse (FuFirmware *firmware,
 	}
 
 	/* check the file size */
-	hdr = (FuEbitdoFirmwareHeader *) g_bytes_get_data (fw, NULL);
-	payload_len = (guint32) (g_bytes_get_size (fw) - sizeof (FuEbitdoFirmwareHeader));
-	if (payload_len != GUINT32_FROM_LE(hdr->destination_len)) {
+	payload_len = (guint32) (bufsz - FU_EBITDO_FIRMWARE_HDR_SIZE);
+	if (payload_len != fu_ebitdo_firmware_hdr_get_destination_len (buf)) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_INVALID_DATA,
 			     "file size incorrect, expected 0x%04x got 0x%04x",
-			     (guint) GUINT32_FROM_LE (hdr->destination_len),
+			     (guint) fu_ebitdo_firmware_hdr_get_destination_len (buf),
 			     (guint) payload_len);
 		return FALSE;
 	}
 
 	/* check if this is firmware */
-	for (guint i = 0; i < 4; i++) {
-		if (hdr->reserved[i] != 0x0) {
+	fu_ebitdo_firmware_hdr_get_reserved_array (buf, reserved);
+	for (guint i = 0; i < FU_EBITDO_FIRMWARE_HDR_RESERVED_LEN; i++) {
+		if (reserved[i] != 0x0) {
 			g_set_error (error,
 				     G_IO_ERROR,
 				     G_IO_ERROR_INVALID_DATA,
 				     "data invalid, reserved[%u] = 0x%04x",
-				     i, hdr->reserved[i]);
+				     i, reserved[i]);
 			return FALSE;
 		}
 	}
 
 	/* parse version */
-	version = g_strdup_printf ("%.2f", GUINT32_FROM_LE(hdr->version) / 100.f);
+	version = g_strdup_printf ("%.2f", fu_ebitdo_firmware_hdr_get_version (buf) / 100.f);
 	fu_firmware_set_version (firmware, version);
 
 	/* add header */
-	fw_hdr = g_bytes_new_from_bytes (fw, 0x0, sizeof(FuEbitdoFirmwareHeader));
+	fw_hdr = g_bytes_new_from_bytes (fw, 0x0, FU_EBITDO_FIRMWARE_HDR_SIZE);
 	fu_firmware_image_set_id (img_hdr, FU_FIRMWARE_IMAGE_ID_HEADER);
 	fu_firmware_image_set_bytes (img_hdr, fw_hdr);
 	fu_firmware_add_image (firmware, img_hdr);
 
 	/* add payload */
-	fw_payload = g_bytes_new_from_bytes (fw, sizeof(FuEbitdoFirmwareHeader), payload_len);
+	fw_payload = g_bytes_new_from_bytes (fw, FU_EBITDO_FIRMWARE_HDR_SIZE, payload_len);
 	fu_firmware_image_set_id (img_payload, FU_FIRMWARE_IMAGE_ID_PAYLOAD);
-	fu_firmware_image_set_addr (img_payload, GUINT32_FROM_LE(hdr->destination_addr));
+	fu_firmware_image_set_addr (img_payload, fu_ebitdo_firmware_hdr_get_destination_addr (buf));
 	fu_firmware_image_set_bytes (img_payload, fw_payload);
 	fu_firmware_add_image (firmware, img_payload);
 	return TRUE;
@@ -6,6 +6,7 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <sys/ioctl.h>
 #include <linux/mmc/ioctl.h>
 
@@ -19,7 +20,9 @@
 #define MMC_SWITCH			6	/* ac	[31:0] See below	R1b */
 #define MMC_SEND_EXT_CSD		8	/* adtc				R1  */
 #define MMC_SWITCH_MODE_WRITE_BYTE	0x03	/* Set target to value */
+#define MMC_SET_BLOCK_COUNT		23	/* adtc [31:0] data addr	R1  */
 #define MMC_WRITE_BLOCK			24	/* adtc [31:0] data addr	R1  */
+#define MMC_WRITE_MULTIPLE_BLOCK	25	/* adtc				R1  */
 
 /* From kernel linux/mmc/core.h */
 #define MMC_RSP_PRESENT	(1 << 0)
@@ -311,6 +314,60 @@ fu_emmc_device_prepare_firmware (FuDevice *device,
 	return fu_firmware_new_from_bytes (fw);
 }
 
+static void
+fu_emmc_device_set_switch_cmd (struct mmc_ioc_cmd *cmd, guint8 field, guint8 value)
+{
+	memset (cmd, 0x0, sizeof(*cmd));
+	cmd->opcode = MMC_SWITCH;
+	cmd->arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
+		   (field << 16) |
+		   (value << 8) |
+		   EXT_CSD_CMD_SET_NORMAL;
+	cmd->flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	cmd->write_flag = 1;
+}
+
+/* the whole chunk is sent with CMD23 and CMD25 if @blocks > 1, otherwise
+ * each sector is sent with CMD24 */
+static struct mmc_ioc_multi_cmd *
+fu_emmc_device_build_download_cmd (FuEmmcDevice *self, guint32 arg, guint32 blocks)
+{
+	struct mmc_ioc_multi_cmd *multi_cmd;
+	guint idx = 0;
+
+	multi_cmd = g_malloc0 (sizeof(struct mmc_ioc_multi_cmd) +
+			       4 * sizeof(struct mmc_ioc_cmd));
+
+	/* put device into ffu mode */
+	fu_emmc_device_set_switch_cmd (&multi_cmd->cmds[idx++],
+				       EXT_CSD_MODE_CONFIG,
+				       EXT_CSD_FFU_MODE);
+
+	/* send image chunk */
+	if (blocks > 1) {
+		multi_cmd->cmds[idx].opcode = MMC_SET_BLOCK_COUNT;
+		multi_cmd->cmds[idx].arg = blocks;
+		multi_cmd->cmds[idx].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_AC;
+		idx++;
+		multi_cmd->cmds[idx].opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	} else {
+		multi_cmd->cmds[idx].opcode = MMC_WRITE_BLOCK;
+	}
+	multi_cmd->cmds[idx].blksz = self->sect_size;
+	multi_cmd->cmds[idx].blocks = blocks;
+	multi_cmd->cmds[idx].arg = arg;
+	multi_cmd->cmds[idx].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	multi_cmd->cmds[idx].write_flag = 1;
+	idx++;
+
+	/* return device into normal mode */
+	fu_emmc_device_set_switch_cmd (&multi_cmd->cmds[idx++],
+				       EXT_CSD_MODE_CONFIG,
+				       EXT_CSD_NORMAL_MODE);
+	multi_cmd->num_of_cmds = idx;
+	return multi_cmd;
+}
+
 static gboolean
 fu_emmc_device_write_firmware (FuDevice *device,
 			       FuFirmware *firmware,
@@ -321,9 +378,11 @@ fu_emmc_device_write_firmware (FuDevice *device,
 	gsize fw_size = 0;
 	gsize total_done;
 	guint32 arg;
+	guint32 blocks;
 	guint32 sect_done = 0;
 	guint8 ext_csd[512];
 	guint failure_cnt = 0;
+	struct mmc_ioc_cmd cmd_normal;
 	g_autofree struct mmc_ioc_multi_cmd *multi_cmd = NULL;
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(GPtrArray) chunks = NULL;
@@ -342,56 +401,53 @@ fu_emmc_device_write_firmware (FuDevice *device,
 	      ext_csd[EXT_CSD_FFU_ARG_2] << 16 |
 	      ext_csd[EXT_CSD_FFU_ARG_3] << 24;
 
-	/* prepare multi_cmd to be sent */
-	multi_cmd = g_malloc0 (sizeof(struct mmc_ioc_multi_cmd) +
-			       3 * sizeof(struct mmc_ioc_cmd));
-	multi_cmd->num_of_cmds = 3;
-
-	/* put device into ffu mode */
-	multi_cmd->cmds[0].opcode = MMC_SWITCH;
-	multi_cmd->cmds[0].arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
-				 (EXT_CSD_MODE_CONFIG << 16) |
-				 (EXT_CSD_FFU_MODE << 8) |
-				  EXT_CSD_CMD_SET_NORMAL;
-	multi_cmd->cmds[0].flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-	multi_cmd->cmds[0].write_flag = 1;
-
-	/* send image chunk */
-	multi_cmd->cmds[1].opcode = MMC_WRITE_BLOCK;
-	multi_cmd->cmds[1].blksz = self->sect_size;
-	multi_cmd->cmds[1].blocks = 1;
-	multi_cmd->cmds[1].arg = arg;
-	multi_cmd->cmds[1].flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
-	multi_cmd->cmds[1].write_flag = 1;
+	/* used if the multi-cmd ioctl fails before exiting from ffu mode */
+	fu_emmc_device_set_switch_cmd (&cmd_normal, EXT_CSD_MODE_CONFIG, EXT_CSD_NORMAL_MODE);
 
-	/* return device into normal mode */
-	multi_cmd->cmds[2].opcode = MMC_SWITCH;
-	multi_cmd->cmds[2].arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
-				 (EXT_CSD_MODE_CONFIG << 16) |
-				 (EXT_CSD_NORMAL_MODE << 8) |
-				  EXT_CSD_CMD_SET_NORMAL;
-	multi_cmd->cmds[2].flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-	multi_cmd->cmds[2].write_flag = 1;
+	/* as many sectors as the kernel allows in each ioctl */
+	blocks = MIN (MMC_IOC_MAX_BYTES / self->sect_size, G_MAXUINT16);
+	blocks = MIN (blocks, fw_size / self->sect_size);
+	if (blocks == 0)
+		blocks = 1;
 
 	/* build packets */
-	chunks = fu_chunk_array_new_from_bytes (fw,
-						0x00,	/* start addr */
-						0x00,	/* page_sz */
-						self->sect_size);
 	while (sect_done == 0) {
+		g_clear_pointer (&multi_cmd, g_free);
+		multi_cmd = fu_emmc_device_build_download_cmd (self, arg, blocks);
+		g_clear_pointer (&chunks, g_ptr_array_unref);
+		chunks = fu_chunk_array_new_from_bytes (fw,
+							0x00,	/* start addr */
+							0x00,	/* page_sz */
+							blocks * self->sect_size);
 		for (guint i = 0; i < chunks->len; i++) {
 			FuChunk *chk = g_ptr_array_index (chunks, i);
+			struct mmc_ioc_cmd *cmd_write = &multi_cmd->cmds[multi_cmd->num_of_cmds - 2];
+			g_autoptr(GError) error_local = NULL;
 
-			mmc_ioc_cmd_set_data (multi_cmd->cmds[1], chk->data);
+			cmd_write->blocks = chk->data_sz / self->sect_size;
+			if (blocks > 1)
+				multi_cmd->cmds[1].arg = cmd_write->blocks;
+			mmc_ioc_cmd_set_data ((*cmd_write), chk->data);
 
 			if (!fu_udev_device_ioctl (FU_UDEV_DEVICE (self),
 						   MMC_IOC_MULTI_CMD, (guint8 *) multi_cmd,
-						   NULL, error)) {
-				g_prefix_error (error, "multi-cmd failed: ");
+						   NULL, &error_local)) {
 				/* multi-cmd ioctl failed before exiting from ffu mode */
 				fu_udev_device_ioctl (FU_UDEV_DEVICE (self),
-						      MMC_IOC_CMD, (guint8 *) &multi_cmd->cmds[2],
+						      MMC_IOC_CMD, (guint8 *) &cmd_normal,
 						      NULL, NULL);
+
+				/* the host or card may not support CMD23 */
+				if (blocks > 1 && i == 0) {
+					g_debug ("multi-block write failed, "
+						 "using single blocks: %s",
+						 error_local->message);
+					blocks = 1;
+					break;
+				}
+				g_propagate_prefixed_error (error,
+							    g_steal_pointer (&error_local),
+							    "multi-cmd failed: ");
 				return FALSE;
 			}
 
@@ -441,15 +497,9 @@ fu_emmc_device_write_firmware (FuDevice *device,
 		multi_cmd->num_of_cmds = 2;
 
 		/* set ext_csd to install mode */
-		multi_cmd->cmds[1].opcode = MMC_SWITCH;
-		multi_cmd->cmds[1].blksz = 0;
-		multi_cmd->cmds[1].blocks = 0;
-		multi_cmd->cmds[1].arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
-					 (EXT_CSD_MODE_OPERATION_CODES << 16) |
-					 (EXT_CSD_FFU_INSTALL << 8) |
-					 EXT_CSD_CMD_SET_NORMAL;
-		multi_cmd->cmds[1].flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-		multi_cmd->cmds[1].write_flag = 1;
+		fu_emmc_device_set_switch_cmd (&multi_cmd->cmds[1],
+					       EXT_CSD_MODE_OPERATION_CODES,
+					       EXT_CSD_FFU_INSTALL);
 
 		/* send ioctl with multi-cmd */
 		if (!fu_udev_device_ioctl (FU_UDEV_DEVICE (self),
@@ -458,7 +508,7 @@ fu_emmc_device_write_firmware (FuDevice *device,
 			/* In case multi-cmd ioctl failed before exiting from ffu mode */
 			g_prefix_error (error, "multi-cmd failed setting install mode: ");
 			fu_udev_device_ioctl (FU_UDEV_DEVICE (self),
-					      MMC_IOC_CMD, (guint8 *) &multi_cmd->cmds[2],
+					      MMC_IOC_CMD, (guint8 *) &cmd_normal,
 					      NULL, NULL);
 			return FALSE;
 		}
@@ -19,14 +19,32 @@
 #define FASTBOOT_EP_IN				0x81
 #define FASTBOOT_EP_OUT				0x01
 #define FASTBOOT_CMD_BUFSZ			64 /* bytes */
+#define FASTBOOT_TRANSFER_QUEUE_DEPTH		4
+#define FASTBOOT_TRANSFER_BLOCKS		128 /* per bulk transfer */
+
+#define FASTBOOT_SPARSE_MAGIC			0xed26ff3a
+#define FASTBOOT_SPARSE_HEADER_SZ		28 /* bytes */
+#define FASTBOOT_SPARSE_CHUNK_HEADER_SZ		12 /* bytes */
+#define FASTBOOT_SPARSE_BLOCK_SZ		0x1000
+#define FASTBOOT_SPARSE_CHUNK_RAW		0xcac1
+#define FASTBOOT_SPARSE_CHUNK_FILL		0xcac2
+#define FASTBOOT_SPARSE_CHUNK_DONT_CARE		0xcac3
 
 struct _FuFastbootDevice {
 	FuUsbDevice			 parent_instance;
 	gboolean			 secure;
 	guint				 blocksz;
 	guint8				 intf_nr;
+	guint64				 max_download_sz;
 };
 
+typedef struct {
+	guint16				 kind;
+	guint32				 blk_start;
+	guint32				 blk_cnt;
+	guint32				 fill;
+} FuFastbootSparseChunk;
+
 G_DEFINE_TYPE (FuFastbootDevice, fu_fastboot_device, FU_TYPE_USB_DEVICE)
 
 static void
@@ -35,6 +53,8 @@ fu_fastboot_device_to_string (FuDevice *device, guint idt, GString *str)
 	FuFastbootDevice *self = FU_FASTBOOT_DEVICE (device);
 	fu_common_string_append_kx (str, idt, "InterfaceNumber", self->intf_nr);
 	fu_common_string_append_kx (str, idt, "BlockSize", self->blocksz);
+	if (self->max_download_sz > 0)
+		fu_common_string_append_kx (str, idt, "MaxDownloadSize", self->max_download_sz);
 	fu_common_string_append_kb (str, idt, "Secure", self->secure);
 }
 
@@ -140,7 +160,6 @@ fu_fastboot_device_read (FuDevice *device,
 			 FuFastbootDeviceReadFlags flags,
 			 GError **error)
 {
-	FuFastbootDevice *self = FU_FASTBOOT_DEVICE (device);
 	GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (device));
 	guint retries = 1;
 
@@ -184,7 +203,7 @@ fu_fastboot_device_read (FuDevice *device,
 		}
 
 		/* info */
-		tmp = g_strndup ((const gchar *) buf + 4, self->blocksz - 4);
+		tmp = g_strndup ((const gchar *) buf + 4, actual_len - 4);
 		if (memcmp (buf, "INFO", 4) == 0) {
 			if (g_strcmp0 (tmp, "erasing flash") == 0)
 				fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
@@ -273,17 +292,20 @@ fu_fastboot_device_download (FuDevice *device, GBytes *fw, GError **error)
 				     error))
 		return FALSE;
 
-	/* send the data in chunks */
+	/* send the data in chunks, which the kernel splits into packets */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
 	chunks = fu_chunk_array_new_from_bytes (fw,
 						0x00,	/* start addr */
 						0x00,	/* page_sz */
-						self->blocksz);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
-		if (!fu_fastboot_device_write (device, chk->data, chk->data_sz, error))
-			return FALSE;
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len * 2);
+						self->blocksz * FASTBOOT_TRANSFER_BLOCKS);
+	if (!fu_usb_device_bulk_transfer_queued (FU_USB_DEVICE (device),
+						 FASTBOOT_EP_OUT,
+						 chunks,
+						 FASTBOOT_TRANSFER_QUEUE_DEPTH,
+						 FASTBOOT_TRANSACTION_TIMEOUT,
+						 error)) {
+		g_prefix_error (error, "failed to download: ");
+		return FALSE;
 	}
 	if (!fu_fastboot_device_read (device, NULL,
 				      FU_FASTBOOT_DEVICE_READ_FLAG_STATUS_POLL, error))
@@ -291,6 +313,234 @@ fu_fastboot_device_download (FuDevice *device, GBytes *fw, GError **error)
 	return TRUE;
 }
 
+/* a block is a fill block if it is one repeated 32 bit value */
+static gboolean
+fu_fastboot_device_sparse_block_is_fill (const guint8 *buf, guint32 *fill)
+{
+	guint32 tmp = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
+	for (guint i = 4; i < FASTBOOT_SPARSE_BLOCK_SZ; i += 4) {
+		if (fu_common_read_uint32 (buf + i, G_LITTLE_ENDIAN) != tmp)
+			return FALSE;
+	}
+	*fill = tmp;
+	return TRUE;
+}
+
+/* describe @buf as runs of raw and fill blocks, with no raw run longer
+ * than @raw_blk_max so that each one fits in a single download */
+static GPtrArray *
+fu_fastboot_device_sparse_chunks_new (const guint8 *buf, gsize bufsz, guint32 raw_blk_max)
+{
+	GPtrArray *chunks = g_ptr_array_new_with_free_func (g_free);
+	FuFastbootSparseChunk *chk = NULL;
+
+	for (guint32 i = 0; i < bufsz / FASTBOOT_SPARSE_BLOCK_SZ; i++) {
+		guint16 kind = FASTBOOT_SPARSE_CHUNK_RAW;
+		guint32 fill = 0;
+		if (fu_fastboot_device_sparse_block_is_fill (buf + ((gsize) i * FASTBOOT_SPARSE_BLOCK_SZ), &fill))
+			kind = FASTBOOT_SPARSE_CHUNK_FILL;
+
+		/* continue the existing run */
+		if (chk != NULL && chk->kind == kind &&
+		    (kind == FASTBOOT_SPARSE_CHUNK_FILL ?
+		     chk->fill == fill : chk->blk_cnt < raw_blk_max)) {
+			chk->blk_cnt++;
+			continue;
+		}
+		chk = g_new0 (FuFastbootSparseChunk, 1);
+		chk->kind = kind;
+		chk->blk_start = i;
+		chk->blk_cnt = 1;
+		chk->fill = fill;
+		g_ptr_array_add (chunks, chk);
+	}
+	return chunks;
+}
+
+static gsize
+fu_fastboot_device_sparse_chunk_get_size (FuFastbootSparseChunk *chk)
+{
+	if (chk->kind == FASTBOOT_SPARSE_CHUNK_RAW)
+		return FASTBOOT_SPARSE_CHUNK_HEADER_SZ + (gsize) chk->blk_cnt * FASTBOOT_SPARSE_BLOCK_SZ;
+	return FASTBOOT_SPARSE_CHUNK_HEADER_SZ + sizeof(guint32);
+}
+
+static void
+fu_fastboot_device_sparse_append_chunk_header (GByteArray *buf,
+					       guint16 kind,
+					       guint32 blk_cnt,
+					       guint32 total_sz)
+{
+	fu_byte_array_append_uint16 (buf, kind, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint16 (buf, 0x0, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint32 (buf, blk_cnt, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint32 (buf, total_sz, G_LITTLE_ENDIAN);
+}
+
+/* build a sparse image containing chunks @idx_start to @idx_end, with the
+ * rest of the partition left untouched */
+static GBytes *
+fu_fastboot_device_sparse_build (const guint8 *data,
+				 guint32 total_blks,
+				 GPtrArray *chunks,
+				 guint idx_start,
+				 guint idx_end)
+{
+	FuFastbootSparseChunk *chk_first = g_ptr_array_index (chunks, idx_start);
+	FuFastbootSparseChunk *chk_last = g_ptr_array_index (chunks, idx_end - 1);
+	guint32 blk_end = chk_last->blk_start + chk_last->blk_cnt;
+	guint32 total_chunks = idx_end - idx_start;
+	GByteArray *buf = g_byte_array_new ();
+
+	if (chk_first->blk_start > 0)
+		total_chunks++;
+	if (blk_end < total_blks)
+		total_chunks++;
+
+	/* file header */
+	fu_byte_array_append_uint32 (buf, FASTBOOT_SPARSE_MAGIC, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint16 (buf, 0x1, G_LITTLE_ENDIAN);	/* major */
+	fu_byte_array_append_uint16 (buf, 0x0, G_LITTLE_ENDIAN);	/* minor */
+	fu_byte_array_append_uint16 (buf, FASTBOOT_SPARSE_HEADER_SZ, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint16 (buf, FASTBOOT_SPARSE_CHUNK_HEADER_SZ, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint32 (buf, FASTBOOT_SPARSE_BLOCK_SZ, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint32 (buf, total_blks, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint32 (buf, total_chunks, G_LITTLE_ENDIAN);
+	fu_byte_array_append_uint32 (buf, 0x0, G_LITTLE_ENDIAN);	/* checksum */
+
+	/* skip the blocks written by earlier images */
+	if (chk_first->blk_start > 0) {
+		fu_fastboot_device_sparse_append_chunk_header (buf,
+							       FASTBOOT_SPARSE_CHUNK_DONT_CARE,
+							       chk_first->blk_start,
+							       FASTBOOT_SPARSE_CHUNK_HEADER_SZ);
+	}
+	for (guint i = idx_start; i < idx_end; i++) {
+		FuFastbootSparseChunk *chk = g_ptr_array_index (chunks, i);
+		fu_fastboot_device_sparse_append_chunk_header (buf, chk->kind, chk->blk_cnt,
+							       fu_fastboot_device_sparse_chunk_get_size (chk));
+		if (chk->kind == FASTBOOT_SPARSE_CHUNK_RAW) {
+			g_byte_array_append (buf,
+					     data + ((gsize) chk->blk_start * FASTBOOT_SPARSE_BLOCK_SZ),
+					     chk->blk_cnt * FASTBOOT_SPARSE_BLOCK_SZ);
+		} else {
+			fu_byte_array_append_uint32 (buf, chk->fill, G_LITTLE_ENDIAN);
+		}
+	}
+
+	/* skip the blocks written by later images */
+	if (blk_end < total_blks) {
+		fu_fastboot_device_sparse_append_chunk_header (buf,
+							       FASTBOOT_SPARSE_CHUNK_DONT_CARE,
+							       total_blks - blk_end,
+							       FASTBOOT_SPARSE_CHUNK_HEADER_SZ);
+	}
+	return g_byte_array_free_to_bytes (buf);
+}
+
+static gboolean
+fu_fastboot_device_flash_sparse (FuDevice *device,
+				 const gchar *partition,
+				 GBytes *fw,
+				 GError **error)
+{
+	FuFastbootDevice *self = FU_FASTBOOT_DEVICE (device);
+	gsize bufsz = 0;
+	gsize budget = G_MAXSIZE;
+	gsize piece_sz = 0;
+	guint idx_start = 0;
+	guint32 raw_blk_max = G_MAXUINT32;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+	g_autoptr(GPtrArray) chunks = NULL;
+	g_autoptr(GPtrArray) pieces = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+
+	/* each image has a file header and up to two skip chunks */
+	if (self->max_download_sz > 0) {
+		gsize overhead = FASTBOOT_SPARSE_HEADER_SZ + (3 * FASTBOOT_SPARSE_CHUNK_HEADER_SZ);
+		if (self->max_download_sz < overhead + FASTBOOT_SPARSE_BLOCK_SZ) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_SUPPORTED,
+				     "max-download-size 0x%x is too small",
+				     (guint) self->max_download_sz);
+			return FALSE;
+		}
+		budget = self->max_download_sz - overhead + FASTBOOT_SPARSE_CHUNK_HEADER_SZ;
+		raw_blk_max = (budget - FASTBOOT_SPARSE_CHUNK_HEADER_SZ) / FASTBOOT_SPARSE_BLOCK_SZ;
+	}
+
+	/* split into images that each fit into the download buffer */
+	chunks = fu_fastboot_device_sparse_chunks_new (buf, bufsz, raw_blk_max);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuFastbootSparseChunk *chk = g_ptr_array_index (chunks, i);
+		gsize chk_sz = fu_fastboot_device_sparse_chunk_get_size (chk);
+		if (i > idx_start && piece_sz + chk_sz > budget) {
+			g_ptr_array_add (pieces,
+					 fu_fastboot_device_sparse_build (buf,
+									  bufsz / FASTBOOT_SPARSE_BLOCK_SZ,
+									  chunks, idx_start, i));
+			idx_start = i;
+			piece_sz = 0;
+		}
+		piece_sz += chk_sz;
+	}
+	if (chunks->len > 0) {
+		g_ptr_array_add (pieces,
+				 fu_fastboot_device_sparse_build (buf,
+								  bufsz / FASTBOOT_SPARSE_BLOCK_SZ,
+								  chunks, idx_start, chunks->len));
+	}
+
+	/* flash each image in turn */
+	for (guint i = 0; i < pieces->len; i++) {
+		GBytes *piece = g_ptr_array_index (pieces, i);
+		g_debug ("sending sparse %s %u/%u (0x%x bytes)",
+			 partition, i + 1, pieces->len,
+			 (guint) g_bytes_get_size (piece));
+		if (!fu_fastboot_device_download (device, piece, error))
+			return FALSE;
+		if (!fu_fastboot_device_flash (device, partition, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_fastboot_device_flash_image (FuDevice *device,
+				const gchar *partition,
+				GBytes *fw,
+				GError **error)
+{
+	FuFastbootDevice *self = FU_FASTBOOT_DEVICE (device);
+	gsize sz = g_bytes_get_size (fw);
+	gboolean is_sparse = FALSE;
+
+	/* already a sparse image */
+	if (sz >= FASTBOOT_SPARSE_HEADER_SZ) {
+		const guint8 *buf = g_bytes_get_data (fw, NULL);
+		is_sparse = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN) == FASTBOOT_SPARSE_MAGIC;
+	}
+
+	/* only send the data blocks */
+	if (!is_sparse &&
+	    sz % FASTBOOT_SPARSE_BLOCK_SZ == 0 &&
+	    fu_device_has_custom_flag (device, "sparse"))
+		return fu_fastboot_device_flash_sparse (device, partition, fw, error);
+
+	/* the bootloader would just FAIL the download */
+	if (self->max_download_sz > 0 && sz > self->max_download_sz) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "%s image of 0x%x bytes is larger than max-download-size 0x%x",
+			     partition, (guint) sz, (guint) self->max_download_sz);
+		return FALSE;
+	}
+	if (!fu_fastboot_device_download (device, fw, error))
+		return FALSE;
+	return fu_fastboot_device_flash (device, partition, error);
+}
+
 static gboolean
 fu_fastboot_device_setup (FuDevice *device, GError **error)
 {
@@ -300,6 +550,8 @@ fu_fastboot_device_setup (FuDevice *device, GError **error)
 	g_autofree gchar *version = NULL;
 	g_autofree gchar *secure = NULL;
 	g_autofree gchar *version_bootloader = NULL;
+	g_autofree gchar *max_download_sz = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	/* product */
 	if (!fu_fastboot_device_getvar (device, "product", &product, error))
@@ -335,6 +587,14 @@ fu_fastboot_device_setup (FuDevice *device, GError **error)
 	if (secure != NULL && secure[0] != '\0')
 		self->secure = TRUE;
 
+	/* the size of the download buffer is optional */
+	if (!fu_fastboot_device_getvar (device, "max-download-size",
+					&max_download_sz, &error_local)) {
+		g_debug ("ignoring: %s", error_local->message);
+	} else if (max_download_sz != NULL && max_download_sz[0] != '\0') {
+		self->max_download_sz = fu_common_strtoull (max_download_sz);
+	}
+
 	/* success */
 	return TRUE;
 }
@@ -367,9 +627,7 @@ fu_fastboot_device_write_qfil_part (FuDevice *device,
 		partition += 2;
 
 	/* flash the partition */
-	if (!fu_fastboot_device_download (device, data, error))
-		return FALSE;
-	return fu_fastboot_device_flash (device, partition, error);
+	return fu_fastboot_device_flash_image (device, partition, data, error);
 }
 
 static gboolean
@@ -492,9 +750,7 @@ fu_fastboot_device_write_motorola_part (FuDevice *device,
 		}
 
 		/* flash the partition */
-		if (!fu_fastboot_device_download (device, data, error))
-			return FALSE;
-		return fu_fastboot_device_flash (device, partition, error);
+		return fu_fastboot_device_flash_image (device, partition, data, error);
 	}
 
 	/* dumb operation that doesn't expect a response */
@@ -608,7 +864,7 @@ fu_fastboot_device_write_firmware (FuDevice *device,
 	if (fw == NULL)
 		return FALSE;
 
-	/* decompress entire archive ahead of time */
+	/* only the files referenced by the manifest are decompressed */
 	archive = fu_archive_new (fw, FU_ARCHIVE_FLAG_IGNORE_PATH, error);
 	if (archive == NULL)
 		return FALSE;
@@ -22,13 +22,24 @@
 #include "config.h"
 
 #include <string.h>
+#include <glib/gstdio.h>
 
 #include "fu-plugin-vfuncs.h"
 #include "fu-hash.h"
+#include "fu-fmap-firmware.h"
 #include "libflashrom.h"
 
 #define SELFCHECK_TRUE 1
 
+/* the region hashes of the image last written, only trusted once the BIOS
+ * version has changed to something new after a reboot */
+#define FU_FLASHROM_REGIONS_GROUP_FWUPD		"fwupd"
+#define FU_FLASHROM_REGIONS_GROUP_HASHES	"Hashes"
+#define FU_FLASHROM_REGIONS_KEY_WRITTEN_FROM	"WrittenFrom"
+#define FU_FLASHROM_REGIONS_KEY_VERSION		"Version"
+#define FU_FLASHROM_REGIONS_KEY_CURRENT_CHECKSUM	"CurrentChecksum"
+#define FU_FLASHROM_REGIONS_KEY_FLASH_SIZE	"FlashSize"
+
 struct FuPluginData {
 	gsize				 flash_size;
 	struct flashrom_flashctx	*flashctx;
@@ -80,6 +91,42 @@ fu_plugin_flashrom_debug_cb (enum flashrom_log_level lvl, const char *fmt, va_li
 	return 0;
 }
 
+static gchar *
+fu_plugin_flashrom_get_filename (FuDevice *device, const gchar *suffix)
+{
+	g_autofree gchar *basename = NULL;
+	basename = g_strdup_printf ("flashrom-%s.%s", fu_device_get_id (device), suffix);
+	return g_build_filename (FWUPD_LOCALSTATEDIR, "lib", "fwupd",
+				 "builder", basename, NULL);
+}
+
+/* the first start after an update confirms what is now on the chip */
+static void
+fu_plugin_flashrom_regions_confirm (FuDevice *device)
+{
+	const gchar *version = fu_device_get_version (device);
+	g_autofree gchar *fn = fu_plugin_flashrom_get_filename (device, "regions");
+	g_autofree gchar *written_from = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (version == NULL)
+		return;
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL))
+		return;
+	if (g_key_file_has_key (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+				FU_FLASHROM_REGIONS_KEY_VERSION, NULL))
+		return;
+	written_from = g_key_file_get_string (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+					      FU_FLASHROM_REGIONS_KEY_WRITTEN_FROM, NULL);
+	if (g_strcmp0 (written_from, version) == 0)
+		return;
+	g_key_file_set_string (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+			       FU_FLASHROM_REGIONS_KEY_VERSION, version);
+	if (!g_key_file_save_to_file (kf, fn, &error_local))
+		g_debug ("failed to save %s: %s", fn, error_local->message);
+}
+
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
@@ -160,10 +207,271 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 		FuDevice *dev = g_ptr_array_index (devices, i);
 		fu_plugin_device_add (plugin, dev);
 		fu_plugin_cache_add (plugin, fu_device_get_id (dev), dev);
+		fu_plugin_flashrom_regions_confirm (dev);
 	}
 	return TRUE;
 }
 
+static gboolean
+fu_plugin_flashrom_area_contains (FuFirmwareImage *img, FuFirmwareImage *img2)
+{
+	g_autoptr(GBytes) blob = fu_firmware_image_write (img, NULL);
+	g_autoptr(GBytes) blob2 = fu_firmware_image_write (img2, NULL);
+	guint64 addr = fu_firmware_image_get_addr (img);
+	guint64 addr2 = fu_firmware_image_get_addr (img2);
+	return addr2 >= addr &&
+	       addr2 + g_bytes_get_size (blob2) <= addr + g_bytes_get_size (blob);
+}
+
+/* flashrom cannot write overlapping regions, so only areas with no other
+ * areas inside are written, and only those inside SI_BIOS if it exists */
+static GPtrArray *
+fu_plugin_flashrom_get_leaf_areas (GPtrArray *images)
+{
+	FuFirmwareImage *img_bios = NULL;
+	GPtrArray *leaves = g_ptr_array_new ();
+
+	for (guint i = 0; i < images->len; i++) {
+		FuFirmwareImage *img = g_ptr_array_index (images, i);
+		if (g_strcmp0 (fu_firmware_image_get_id (img), "SI_BIOS") == 0)
+			img_bios = img;
+	}
+	for (guint i = 0; i < images->len; i++) {
+		FuFirmwareImage *img = g_ptr_array_index (images, i);
+		gboolean is_leaf = TRUE;
+		if (img_bios != NULL &&
+		    (img == img_bios || !fu_plugin_flashrom_area_contains (img_bios, img)))
+			continue;
+		for (guint j = 0; j < images->len; j++) {
+			FuFirmwareImage *img2 = g_ptr_array_index (images, j);
+			if (i == j)
+				continue;
+			if (!fu_plugin_flashrom_area_contains (img, img2))
+				continue;
+			/* identical areas are only written once */
+			if (fu_plugin_flashrom_area_contains (img2, img) && i < j)
+				continue;
+			is_leaf = FALSE;
+			break;
+		}
+		if (is_leaf)
+			g_ptr_array_add (leaves, img);
+	}
+	return leaves;
+}
+
+static gchar *
+fu_plugin_flashrom_area_checksum (FuFirmwareImage *img)
+{
+	g_autoptr(GBytes) blob = fu_firmware_image_write (img, NULL);
+	if (blob == NULL)
+		return NULL;
+	return g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, blob);
+}
+
+/* returns the saved region hashes, or %NULL if they may not match the chip */
+static GKeyFile *
+fu_plugin_flashrom_load_regions (FuDevice *device)
+{
+	const gchar *version = fu_device_get_version (device);
+	g_autofree gchar *fn = fu_plugin_flashrom_get_filename (device, "regions");
+	g_autofree gchar *version_written = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	/* only trusted if nothing else has flashed the chip since */
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL))
+		return NULL;
+	version_written = g_key_file_get_string (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+						 FU_FLASHROM_REGIONS_KEY_VERSION, NULL);
+	if (version_written == NULL || g_strcmp0 (version_written, version) != 0) {
+		g_debug ("region hashes not valid for %s", version);
+		return NULL;
+	}
+	return g_steal_pointer (&kf);
+}
+
+/* the image last read from or verified on the chip, so that flashrom does not
+ * have to read the included regions again before erasing */
+static GBytes *
+fu_plugin_flashrom_load_current (FuPlugin *plugin, FuDevice *device, GKeyFile *kf)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *checksum_old = NULL;
+	g_autofree gchar *fn = fu_plugin_flashrom_get_filename (device, "current");
+	g_autoptr(GBytes) blob = NULL;
+
+	checksum_old = g_key_file_get_string (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+					      FU_FLASHROM_REGIONS_KEY_CURRENT_CHECKSUM, NULL);
+	if (checksum_old == NULL)
+		return NULL;
+	if (g_key_file_get_uint64 (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+				   FU_FLASHROM_REGIONS_KEY_FLASH_SIZE, NULL) != data->flash_size) {
+		g_debug ("flash size changed, ignoring %s", fn);
+		return NULL;
+	}
+	blob = fu_common_get_contents_bytes (fn, NULL);
+	if (blob == NULL || g_bytes_get_size (blob) != data->flash_size)
+		return NULL;
+	checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, blob);
+	if (g_strcmp0 (checksum, checksum_old) != 0) {
+		g_debug ("%s does not match, ignoring", fn);
+		return NULL;
+	}
+	return g_steal_pointer (&blob);
+}
+
+/* @confirmed is set when @current was read from the chip rather than written */
+static void
+fu_plugin_flashrom_save_regions (FuPlugin *plugin,
+				 FuDevice *device,
+				 FuFirmware *firmware,
+				 GBytes *current,
+				 gboolean confirmed)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	const gchar *version = fu_device_get_version (device);
+	g_autofree gchar *fn = fu_plugin_flashrom_get_filename (device, "regions");
+	g_autofree gchar *fn_current = fu_plugin_flashrom_get_filename (device, "current");
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (version != NULL) {
+		g_key_file_set_string (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+				       confirmed ? FU_FLASHROM_REGIONS_KEY_VERSION :
+						   FU_FLASHROM_REGIONS_KEY_WRITTEN_FROM,
+				       version);
+	}
+	if (firmware != NULL) {
+		g_autoptr(GPtrArray) images = fu_firmware_get_images (firmware);
+		for (guint i = 0; i < images->len; i++) {
+			FuFirmwareImage *img = g_ptr_array_index (images, i);
+			g_autofree gchar *checksum = fu_plugin_flashrom_area_checksum (img);
+			if (checksum == NULL)
+				continue;
+			g_key_file_set_string (kf, FU_FLASHROM_REGIONS_GROUP_HASHES,
+					       fu_firmware_image_get_id (img), checksum);
+		}
+	}
+	if (!fu_common_mkdir_parent (fn, &error_local)) {
+		g_debug ("failed to save %s: %s", fn, error_local->message);
+		return;
+	}
+	if (current != NULL) {
+		if (fu_common_set_contents_bytes (fn_current, current, &error_local)) {
+			g_autofree gchar *checksum = NULL;
+			checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, current);
+			g_key_file_set_string (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+					       FU_FLASHROM_REGIONS_KEY_CURRENT_CHECKSUM,
+					       checksum);
+			g_key_file_set_uint64 (kf, FU_FLASHROM_REGIONS_GROUP_FWUPD,
+					       FU_FLASHROM_REGIONS_KEY_FLASH_SIZE,
+					       data->flash_size);
+		} else {
+			g_debug ("failed to save %s: %s", fn_current, error_local->message);
+			g_clear_error (&error_local);
+		}
+	}
+	if (!g_key_file_save_to_file (kf, fn, &error_local))
+		g_debug ("failed to save %s: %s", fn, error_local->message);
+}
+
+/* returns the FMAP areas included in the layout, which may be none if nothing
+ * has changed, or %NULL if the FMAP cannot be used */
+static GPtrArray *
+fu_plugin_flashrom_setup_fmap_layout (FuPlugin *plugin,
+				      FuFirmware *firmware,
+				      GBytes *blob_fw,
+				      GKeyFile *kf)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	gsize sz = 0;
+	const guint8 *buf = g_bytes_get_data (blob_fw, &sz);
+	g_autoptr(GPtrArray) images = fu_firmware_get_images (firmware);
+	g_autoptr(GPtrArray) leaves = NULL;
+	g_autoptr(GPtrArray) included = NULL;
+
+	/* a changed area that is not covered by a changed leaf, e.g. padding */
+	leaves = fu_plugin_flashrom_get_leaf_areas (images);
+	for (guint i = 0; i < images->len; i++) {
+		FuFirmwareImage *img = g_ptr_array_index (images, i);
+		g_autofree gchar *checksum = fu_plugin_flashrom_area_checksum (img);
+		g_autofree gchar *checksum_old = NULL;
+		gboolean covered = FALSE;
+
+		checksum_old = g_key_file_get_string (kf, FU_FLASHROM_REGIONS_GROUP_HASHES,
+						      fu_firmware_image_get_id (img), NULL);
+		if (g_strcmp0 (checksum, checksum_old) == 0)
+			continue;
+		for (guint j = 0; j < leaves->len; j++) {
+			FuFirmwareImage *leaf = g_ptr_array_index (leaves, j);
+			g_autofree gchar *checksum_leaf = NULL;
+			g_autofree gchar *checksum_leaf_old = NULL;
+			if (!fu_plugin_flashrom_area_contains (img, leaf))
+				continue;
+			checksum_leaf = fu_plugin_flashrom_area_checksum (leaf);
+			checksum_leaf_old = g_key_file_get_string (kf, FU_FLASHROM_REGIONS_GROUP_HASHES,
+								   fu_firmware_image_get_id (leaf),
+								   NULL);
+			if (g_strcmp0 (checksum_leaf, checksum_leaf_old) != 0) {
+				covered = TRUE;
+				break;
+			}
+		}
+		if (!covered) {
+			g_debug ("%s changed outside of a region, writing everything",
+				 fu_firmware_image_get_id (img));
+			return NULL;
+		}
+	}
+
+	/* include just the changed regions */
+	if (flashrom_layout_read_fmap_from_buffer (&data->layout, data->flashctx, buf, sz)) {
+		g_debug ("failed to read layout from FMAP");
+		return NULL;
+	}
+	included = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < leaves->len; i++) {
+		FuFirmwareImage *img = g_ptr_array_index (leaves, i);
+		const gchar *id = fu_firmware_image_get_id (img);
+		g_autofree gchar *checksum = fu_plugin_flashrom_area_checksum (img);
+		g_autofree gchar *checksum_old = NULL;
+
+		checksum_old = g_key_file_get_string (kf, FU_FLASHROM_REGIONS_GROUP_HASHES,
+						      id, NULL);
+		if (g_strcmp0 (checksum, checksum_old) == 0)
+			continue;
+		if (flashrom_layout_include_region (data->layout, id)) {
+			g_debug ("invalid region name %s", id);
+			flashrom_layout_release (data->layout);
+			data->layout = NULL;
+			return NULL;
+		}
+		g_debug ("including changed region %s", id);
+		g_ptr_array_add (included, g_object_ref (img));
+	}
+	return g_steal_pointer (&included);
+}
+
+/* the chip is now @current, apart from the areas that were just written */
+static GBytes *
+fu_plugin_flashrom_merge_current (GBytes *current, GPtrArray *included)
+{
+	gsize sz = g_bytes_get_size (current);
+	guint8 *buf = g_memdup (g_bytes_get_data (current, NULL), sz);
+	for (guint i = 0; i < included->len; i++) {
+		FuFirmwareImage *img = g_ptr_array_index (included, i);
+		g_autoptr(GBytes) blob = fu_firmware_image_write (img, NULL);
+		guint64 addr = fu_firmware_image_get_addr (img);
+		if (blob == NULL || addr + g_bytes_get_size (blob) > sz) {
+			g_free (buf);
+			return NULL;
+		}
+		memcpy (buf + addr, g_bytes_get_data (blob, NULL), g_bytes_get_size (blob));
+	}
+	return g_bytes_new_take (buf, sz);
+}
+
 gboolean
 fu_plugin_update_prepare (FuPlugin *plugin,
 			  FwupdInstallFlags flags,
@@ -172,33 +480,39 @@ fu_plugin_update_prepare (FuPlugin *plugin,
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	g_autofree gchar *firmware_orig = NULL;
-	g_autofree gchar *basename = NULL;
 
 	/* not us */
 	if (fu_plugin_cache_lookup (plugin, fu_device_get_id (device)) == NULL)
 		return TRUE;
 
 	/* if the original firmware doesn't exist, grab it now */
-	basename = g_strdup_printf ("flashrom-%s.bin", fu_device_get_id (device));
-	firmware_orig = g_build_filename (FWUPD_LOCALSTATEDIR, "lib", "fwupd",
-					  "builder", basename, NULL);
+	firmware_orig = fu_plugin_flashrom_get_filename (device, "bin");
 	if (!fu_common_mkdir_parent (firmware_orig, error))
 		return FALSE;
 	if (!g_file_test (firmware_orig, G_FILE_TEST_EXISTS)) {
-		g_autofree guint8 *newcontents = g_malloc0 (data->flash_size);
+		guint8 *newcontents = g_malloc0 (data->flash_size);
+		g_autoptr(FuFirmware) firmware = fu_fmap_firmware_new ();
 		g_autoptr(GBytes) buf = NULL;
 
+		/* the whole chip, not the regions from the last update */
+		flashrom_layout_set (data->flashctx, NULL);
 		fu_device_set_status (device, FWUPD_STATUS_DEVICE_READ);
 		if (flashrom_image_read (data->flashctx, newcontents, data->flash_size)) {
+			g_free (newcontents);
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_READ,
 					     "failed to back up original firmware");
 			return FALSE;
 		}
-		buf = g_bytes_new_static (newcontents, data->flash_size);
+		buf = g_bytes_new_take (newcontents, data->flash_size);
 		if (!fu_common_set_contents_bytes (firmware_orig, buf, error))
 			return FALSE;
+
+		/* this is what is on the chip right now */
+		if (!fu_firmware_parse (firmware, buf, FWUPD_INSTALL_FLAG_NONE, NULL))
+			g_clear_object (&firmware);
+		fu_plugin_flashrom_save_regions (plugin, device, firmware, buf, TRUE);
 	}
 
 	return TRUE;
@@ -215,26 +529,15 @@ fu_plugin_update (FuPlugin *plugin,
 	gsize sz = 0;
 	gint rc;
 	const guint8 *buf = g_bytes_get_data (blob_fw, &sz);
+	g_autofree gchar *fn_current = fu_plugin_flashrom_get_filename (device, "current");
+	g_autofree gchar *fn_regions = fu_plugin_flashrom_get_filename (device, "regions");
+	g_autoptr(FuFirmware) firmware = fu_fmap_firmware_new ();
+	g_autoptr(GBytes) current = NULL;
+	g_autoptr(GBytes) current_new = NULL;
+	g_autoptr(GError) error_fmap = NULL;
+	g_autoptr(GKeyFile) kf = NULL;
+	g_autoptr(GPtrArray) included = NULL;
 
-	if (flashrom_layout_read_from_ifd (&data->layout, data->flashctx, NULL, 0)) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_READ,
-				     "failed to read layout from Intel ICH descriptor");
-		return FALSE;
-	}
-
-	/* include bios region for safety reasons */
-	if (flashrom_layout_include_region (data->layout, "bios")) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_SUPPORTED,
-				     "invalid region name");
-		return FALSE;
-	}
-
-	/* write region */
-	flashrom_layout_set (data->flashctx, data->layout);
 	if (sz != data->flash_size) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -244,8 +547,57 @@ fu_plugin_update (FuPlugin *plugin,
 		return FALSE;
 	}
 
+	if (!fu_firmware_parse (firmware, blob_fw, FWUPD_INSTALL_FLAG_NONE, &error_fmap)) {
+		g_debug ("not using FMAP: %s", error_fmap->message);
+		g_clear_object (&firmware);
+	}
+
+	/* what we know about the chip from the last update */
+	kf = fu_plugin_flashrom_load_regions (device);
+	if (kf != NULL)
+		current = fu_plugin_flashrom_load_current (plugin, device, kf);
+
+	/* only write the FMAP regions that changed since the last update */
+	if (data->layout != NULL) {
+		flashrom_layout_release (data->layout);
+		data->layout = NULL;
+	}
+	if (firmware != NULL && kf != NULL)
+		included = fu_plugin_flashrom_setup_fmap_layout (plugin, firmware, blob_fw, kf);
+	if (included != NULL) {
+		if (included->len == 0) {
+			g_debug ("no regions changed, nothing to write");
+			return TRUE;
+		}
+	} else {
+		if (flashrom_layout_read_from_ifd (&data->layout, data->flashctx, NULL, 0)) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "failed to read layout from Intel ICH descriptor");
+			return FALSE;
+		}
+
+		/* include bios region for safety reasons */
+		if (flashrom_layout_include_region (data->layout, "bios")) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOT_SUPPORTED,
+					     "invalid region name");
+			return FALSE;
+		}
+	}
+
+	/* the old hashes are for an image that may only be partly written */
+	g_unlink (fn_regions);
+	g_unlink (fn_current);
+
+	/* write region, which only reads back the included regions */
+	flashrom_layout_set (data->flashctx, data->layout);
+
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	rc = flashrom_image_write (data->flashctx, (void *) buf, sz, NULL /* refbuffer */);
+	rc = flashrom_image_write (data->flashctx, (void *) buf, sz,
+				   current != NULL ? (void *) g_bytes_get_data (current, NULL) : NULL);
 	if (rc != 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -263,6 +615,13 @@ fu_plugin_update (FuPlugin *plugin,
 		return FALSE;
 	}
 
+	/* so the next update can skip the regions that do not change; the
+	 * offsets of the IFD bios region are not known so that is not merged */
+	if (current != NULL && included != NULL)
+		current_new = fu_plugin_flashrom_merge_current (current, included);
+	if (firmware != NULL || current_new != NULL)
+		fu_plugin_flashrom_save_regions (plugin, device, firmware, current_new, FALSE);
+
 	/* success */
 	return TRUE;
 }
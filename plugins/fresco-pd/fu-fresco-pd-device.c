@@ -7,6 +7,8 @@
 
 #include "config.h"
 
+#include "fu-chunk.h"
+
 #include "fu-fresco-pd-common.h"
 #include "fu-fresco-pd-device.h"
 #include "fu-fresco-pd-firmware.h"
@@ -15,6 +17,7 @@ struct _FuFrescoPdDevice
 {
 	FuUsbDevice		 parent_instance;
 	guint8			 customer_id;
+	guint16			 transfer_size;
 };
 
 G_DEFINE_TYPE (FuFrescoPdDevice, fu_fresco_pd_device, FU_TYPE_USB_DEVICE)
@@ -24,6 +27,7 @@ fu_fresco_pd_device_to_string (FuDevice *device, guint idt, GString *str)
 {
 	FuFrescoPdDevice *self = FU_FRESCO_PD_DEVICE (device);
 	fu_common_string_append_ku (str, idt, "CustomerID", self->customer_id);
+	fu_common_string_append_kx (str, idt, "TransferSize", self->transfer_size);
 }
 
 static gboolean
@@ -123,17 +127,55 @@ fu_fresco_pd_device_write_byte (FuFrescoPdDevice *self,
 }
 
 static gboolean
-fu_fresco_pd_device_set_byte (FuFrescoPdDevice *self,
-			      guint16 offset,
-			      guint8 val,
-			      GError **error)
+fu_fresco_pd_device_read_block (FuFrescoPdDevice *self,
+				guint16 offset,
+				guint8 *buf,
+				guint16 bufsz,
+				GError **error)
 {
-	guint8 buf = 0x0;
-	if (!fu_fresco_pd_device_read_byte (self, offset, &buf, error))
+	g_autoptr(GPtrArray) chunks = NULL;
+	chunks = fu_chunk_array_new (buf, bufsz, offset, 0x0, self->transfer_size);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		if (!fu_fresco_pd_device_transfer_read (self,
+							chk->address,
+							(guint8 *) chk->data,
+							chk->data_sz,
+							error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* only writes the runs of bytes that differ from what is already there */
+static gboolean
+fu_fresco_pd_device_set_block (FuFrescoPdDevice *self,
+			       guint16 offset,
+			       const guint8 *buf,
+			       guint16 bufsz,
+			       GError **error)
+{
+	g_autofree guint8 *buf_old = g_malloc0 (bufsz);
+
+	if (!fu_fresco_pd_device_read_block (self, offset, buf_old, bufsz, error))
 		return FALSE;
-	if (buf == val)
-		return TRUE;
-	return fu_fresco_pd_device_write_byte (self, offset, val, error);
+	for (guint16 i = 0; i < bufsz;) {
+		guint16 j;
+		if (buf_old[i] == buf[i]) {
+			i++;
+			continue;
+		}
+		for (j = i + 1; j < bufsz && j - i < self->transfer_size; j++) {
+			if (buf_old[j] == buf[j])
+				break;
+		}
+		if (!fu_fresco_pd_device_transfer_write (self, offset + i,
+							 (guint8 *) buf + i,
+							 j - i, error))
+			return FALSE;
+		i = j;
+	}
+	return TRUE;
 }
 
 static gboolean
@@ -171,11 +213,23 @@ fu_fresco_pd_device_setup (FuDevice *device, GError **error)
 	g_autofree gchar *instance_id = NULL;
 	g_autofree gchar *version = NULL;
 
-	/* read existing device version */
-	for (guint i = 0; i < 4; i++) {
-		if (!fu_fresco_pd_device_transfer_read (self, 0x3000 + i, &ver[i], 1, error)) {
-			g_prefix_error (error, "failed to read device version [%u]: ", i);
-			return FALSE;
+	/* read existing device version, which also tells us if ranged
+	 * transfers work on this device */
+	if (self->transfer_size > 1) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_fresco_pd_device_read_block (self, 0x3000, ver, sizeof(ver),
+						     &error_local)) {
+			g_debug ("ranged read failed, using single bytes: %s",
+				 error_local->message);
+			self->transfer_size = 1;
+		}
+	}
+	if (self->transfer_size == 1) {
+		for (guint i = 0; i < 4; i++) {
+			if (!fu_fresco_pd_device_transfer_read (self, 0x3000 + i, &ver[i], 1, error)) {
+				g_prefix_error (error, "failed to read device version [%u]: ", i);
+				return FALSE;
+			}
 		}
 	}
 	version = fu_fresco_pd_version_from_buf (ver);
@@ -264,8 +318,10 @@ fu_fresco_pd_device_write_firmware (FuDevice *device,
 	const guint8 *buf;
 	gsize bufsz = 0x0;
 	guint16 begin_addr = 0x6420;
-	guint8 config[3] = { 0x0 };
+	guint8 config[0x400 + 3] = { 0x0 };
+	guint8 customize[0x31] = { 0x0 };
 	guint8 start_symbols[2] = { 0x0 };
+	g_autofree guint8 *buf_verify = g_malloc0 (0x4000);
 	g_autoptr(GBytes) fw = NULL;
 
 	/* get default blob, which we know is already bigger than FirmwareMin */
@@ -300,48 +356,42 @@ fu_fresco_pd_device_write_firmware (FuDevice *device,
 
 	/* fill safe code in the boot code */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	if (!fu_fresco_pd_device_read_block (self, begin_addr, config, sizeof(config), error)) {
+		g_prefix_error (error, "failed to read config: ");
+		return FALSE;
+	}
 	for (guint16 i = 0; i < 0x400; i += 3) {
-		for (guint j = 0; j < 3; j++) {
-			if (!fu_fresco_pd_device_read_byte (self,
-							    begin_addr + i + j,
-							    &config[j],
-							    error)) {
-				g_prefix_error (error, "failed to read config byte %u: ", j);
-				return FALSE;
-			}
-		}
-		if (config[0] == start_symbols[0] &&
-		    config[1] == start_symbols[1]) {
+		if (config[i + 0] == start_symbols[0] &&
+		    config[i + 1] == start_symbols[1]) {
 			begin_addr = 0x6420 + i;
 			break;
 		}
-		if (config[0] == 0 && config[1] == 0 && config[2] == 0)
+		if (config[i + 0] == 0 && config[i + 1] == 0 && config[i + 2] == 0)
 			break;
 	}
 	g_debug ("begin_addr: 0x%04x", begin_addr);
-	for (guint16 i = begin_addr + 3; i < begin_addr + 0x400; i += 3) {
-		for (guint j = 0; j < 3; j++) {
-			if (!fu_fresco_pd_device_read_byte (self, i + j, &config[j], error)) {
-				g_prefix_error (error, "failed to read config byte %u: ", j);
-				return FALSE;
-			}
-		}
-		if (config[0] == 0x74 && config[1] == 0x06 && config[2] != 0x22) {
-			if (!fu_fresco_pd_device_write_byte (self, i + 2, 0x22, error))
+	if (!fu_fresco_pd_device_read_block (self, begin_addr, config, sizeof(config), error)) {
+		g_prefix_error (error, "failed to read config: ");
+		return FALSE;
+	}
+	for (guint16 i = 3; i < 0x400; i += 3) {
+		if (config[i] == 0x74 && config[i + 1] == 0x06 && config[i + 2] != 0x22) {
+			if (!fu_fresco_pd_device_write_byte (self, begin_addr + i + 2, 0x22, error))
 				return FALSE;
-		} else if (config[0] == 0x6c && config[1] == 0x00 && config[2] != 0x01) {
-			if (!fu_fresco_pd_device_write_byte (self, i + 2, 0x01, error))
+		} else if (config[i] == 0x6c && config[i + 1] == 0x00 && config[i + 2] != 0x01) {
+			if (!fu_fresco_pd_device_write_byte (self, begin_addr + i + 2, 0x01, error))
 				return FALSE;
-		} else if (config[0] == 0x00 && config[1] == 0x00 && config[2] != 0x00)
+		} else if (config[i] == 0x00 && config[i + 1] == 0x00 && config[i + 2] != 0x00)
 			break;
 	}
 
 	/* copy buf offset [0 - 0x3FFFF] to mmio address [0x2000 - 0x5FFF] */
 	g_debug ("fill firmware body");
-	for (guint16 byte_index = 0; byte_index < 0x4000; byte_index++) {
-		if (!fu_fresco_pd_device_set_byte (self, byte_index + 0x2000, buf[byte_index], error))
+	for (guint16 byte_index = 0; byte_index < 0x4000; byte_index += 0x400) {
+		if (!fu_fresco_pd_device_set_block (self, byte_index + 0x2000,
+						    buf + byte_index, 0x400, error))
 			return FALSE;
-		fu_device_set_progress_full (device, (gsize) byte_index, 0x4000);
+		fu_device_set_progress_full (device, (gsize) byte_index + 0x400, 0x4000);
 	}
 
 	/* write file buf 0x4200 ~ 0x4205, 6 bytes to internal address 0x6600 ~ 0x6605
@@ -349,54 +399,70 @@ fu_fresco_pd_device_write_firmware (FuDevice *device,
 	 * write file buf 0x4220 ~ 0x4225, 6 bytes to internal address 0x6620 ~ 0x6625
 	 * write file buf 0x4230, 1 byte, to internal address 0x6630 */
 	g_debug ("update customize data");
+	if (!fu_fresco_pd_device_read_block (self, 0x6600, customize, sizeof(customize), error)) {
+		g_prefix_error (error, "failed to read customize data: ");
+		return FALSE;
+	}
 	for (guint16 byte_index = 0; byte_index < 6; byte_index++) {
-		if (!fu_fresco_pd_device_set_byte (self,
-						   0x6600 + byte_index,
-						   buf[0x4200 + byte_index],
-						   error))
-			return FALSE;
-		if (!fu_fresco_pd_device_set_byte (self,
-						   0x6610 + byte_index,
-						   buf[0x4210 + byte_index],
-						   error))
-			return FALSE;
-		if (!fu_fresco_pd_device_set_byte (self,
-						   0x6620 + byte_index,
-						   buf[0x4220 + byte_index],
-						   error))
-			return FALSE;
+		customize[0x00 + byte_index] = buf[0x4200 + byte_index];
+		customize[0x10 + byte_index] = buf[0x4210 + byte_index];
+		customize[0x20 + byte_index] = buf[0x4220 + byte_index];
 	}
-	if (!fu_fresco_pd_device_set_byte (self, 0x6630, buf[0x4230], error))
+	customize[0x30] = buf[0x4230];
+	if (!fu_fresco_pd_device_set_block (self, 0x6600, customize, sizeof(customize), error))
 		return FALSE;
 
 	/* overwrite firmware file's boot code area (0x4020 ~ 0x41ff) to the area on the device marked by begin_addr
 	 * example: if the begin_addr = 0x6420, then copy file buf [0x4020 ~ 0x41ff] to device offset[0x6420 ~ 0x65ff] */
 	g_debug ("write boot configuration area");
-	for (guint16 byte_index = 0; byte_index < 0x1e0; byte_index += 3) {
-		if (!fu_fresco_pd_device_set_byte (self,
-						   begin_addr + byte_index + 0,
-						   buf[0x4020 + byte_index],
-						   error))
-			return FALSE;
-		if (!fu_fresco_pd_device_set_byte (self,
-						   begin_addr + byte_index + 1,
-						   buf[0x4021 + byte_index],
-						   error))
-			return FALSE;
-		if (!fu_fresco_pd_device_set_byte (self,
-						   begin_addr + byte_index + 2,
-						   buf[0x4022 + byte_index],
-						   error))
-			return FALSE;
+	if (!fu_fresco_pd_device_set_block (self, begin_addr, buf + 0x4020, 0x1e0, error))
+		return FALSE;
+
+	/* verify the firmware body in one pass */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	if (!fu_fresco_pd_device_read_block (self, 0x2000, buf_verify, 0x4000, error)) {
+		g_prefix_error (error, "failed to read back firmware: ");
+		return FALSE;
+	}
+	if (!fu_common_bytes_compare_raw (buf_verify, 0x4000, buf, 0x4000, error)) {
+		g_prefix_error (error, "failed to verify firmware: ");
+		return FALSE;
 	}
 
 	/* reset the device */
 	return fu_fresco_pd_device_panther_reset_device (self, error);
 }
 
+static gboolean
+fu_fresco_pd_device_set_quirk_kv (FuDevice *device,
+				  const gchar *key,
+				  const gchar *value,
+				  GError **error)
+{
+	FuFrescoPdDevice *self = FU_FRESCO_PD_DEVICE (device);
+	if (g_strcmp0 (key, "FrescoPdTransferSize") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp == 0 || tmp > G_MAXUINT16) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_INVALID_DATA,
+					     "invalid transfer size");
+			return FALSE;
+		}
+		self->transfer_size = tmp;
+		return TRUE;
+	}
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "quirk key not supported");
+	return FALSE;
+}
+
 static void
 fu_fresco_pd_device_init (FuFrescoPdDevice *self)
 {
+	self->transfer_size = 0x40;
 	fu_device_add_icon (FU_DEVICE (self), "audio-card");
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_UPDATABLE);
 	fu_device_set_protocol (FU_DEVICE (self), "com.frescologic.pd");
@@ -414,4 +480,5 @@ fu_fresco_pd_device_class_init (FuFrescoPdDeviceClass *klass)
 	klass_device->setup = fu_fresco_pd_device_setup;
 	klass_device->write_firmware = fu_fresco_pd_device_write_firmware;
 	klass_device->prepare_firmware = fu_fresco_pd_device_prepare_firmware;
+	klass_device->set_quirk_kv = fu_fresco_pd_device_set_quirk_kv;
 }
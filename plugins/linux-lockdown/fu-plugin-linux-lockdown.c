@@ -10,8 +10,8 @@
 #include "fu-hash.h"
 
 struct FuPluginData {
-	GFile			*file;
-	GFileMonitor		*monitor;
+	gchar			*fn;
+	guint			 watch_id;
 };
 
 void
@@ -25,17 +25,14 @@ void
 fu_plugin_destroy (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
-	if (data->file != NULL)
-		g_object_unref (data->file);
-	if (data->monitor != NULL)
-		g_object_unref (data->monitor);
+	if (data->watch_id != 0)
+		fu_file_watch_remove (fu_plugin_get_file_watch (plugin), data->watch_id);
+	g_free (data->fn);
 }
 
 static void
-fu_plugin_linux_lockdown_changed_cb (GFileMonitor *monitor,
-				     GFile *file,
-				     GFile *other_file,
-				     GFileMonitorEvent event_type,
+fu_plugin_linux_lockdown_changed_cb (FuFileWatch *file_watch,
+				     const gchar *filename,
 				     gpointer user_data)
 {
 	FuPlugin *plugin = FU_PLUGIN (user_data);
@@ -51,12 +48,12 @@ fu_plugin_startup (FuPlugin *plugin, GError **error)
 
 	path = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_SECURITY);
 	fn = g_build_filename (path, "lockdown", NULL);
-	data->file = g_file_new_for_path (fn);
-	data->monitor = g_file_monitor (data->file, G_FILE_MONITOR_NONE, NULL, error);
-	if (data->monitor == NULL)
+	data->watch_id = fu_file_watch_add (fu_plugin_get_file_watch (plugin), fn,
+					    fu_plugin_linux_lockdown_changed_cb,
+					    plugin, error);
+	if (data->watch_id == 0)
 		return FALSE;
-	g_signal_connect (data->monitor, "changed",
-			  G_CALLBACK (fu_plugin_linux_lockdown_changed_cb), plugin);
+	data->fn = g_steal_pointer (&fn);
 	return TRUE;
 }
 
@@ -65,7 +62,8 @@ fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	gsize bufsz = 0;
-	g_autofree gchar *buf = NULL;
+	const gchar *buf;
+	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(FwupdSecurityAttr) attr = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -76,12 +74,13 @@ fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 	fu_security_attrs_append (attrs, attr);
 
 	/* load file */
-	if (!g_file_load_contents (data->file, NULL, &buf, &bufsz, NULL, &error_local)) {
-		g_autofree gchar *fn = g_file_get_path (data->file);
-		g_warning ("could not open %s: %s", fn, error_local->message);
+	blob = fu_file_watch_get_contents (fu_plugin_get_file_watch (plugin), data->fn, &error_local);
+	if (blob == NULL) {
+		g_warning ("could not open %s: %s", data->fn, error_local->message);
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_VALID);
 		return;
 	}
+	buf = g_bytes_get_data (blob, &bufsz);
 	if (g_strstr_len (buf, bufsz, "[integrity]") == NULL &&
 	    g_strstr_len (buf, bufsz, "[confidentiality]") == NULL) {
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_ENABLED);
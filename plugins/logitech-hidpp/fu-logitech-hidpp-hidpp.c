@@ -31,6 +31,8 @@ fu_logitech_hidpp_msg_to_string (FuLogitechHidPpHidppMsg *msg)
 			g_string_append (flags_str, "ignore-fnct-id,");
 		if (msg->flags & FU_UNIFYING_HIDPP_MSG_FLAG_IGNORE_SWID)
 			g_string_append (flags_str, "ignore-swid,");
+		if (msg->flags & FU_UNIFYING_HIDPP_MSG_FLAG_NO_FLUSH)
+			g_string_append (flags_str, "no-flush,");
 		if (str->len > 0)
 			g_string_truncate (str, str->len - 1);
 	}
@@ -63,7 +65,7 @@ fu_logitech_hidpp_send (FuIOChannel *io_channel,
 			GError **error)
 {
 	gsize len = fu_logitech_hidpp_msg_get_payload_length (msg);
-	FuIOChannelFlags write_flags = FU_IO_CHANNEL_FLAG_FLUSH_INPUT;
+	FuIOChannelFlags write_flags = FU_IO_CHANNEL_FLAG_NONE;
 
 	/* only for HID++2.0 */
 	if (msg->hidpp_version >= 2.f)
@@ -76,6 +78,10 @@ fu_logitech_hidpp_send (FuIOChannel *io_channel,
 		g_print ("%s", str);
 	}
 
+	/* do not throw away the replies to packets that are still in flight */
+	if ((msg->flags & FU_UNIFYING_HIDPP_MSG_FLAG_NO_FLUSH) == 0)
+		write_flags |= FU_IO_CHANNEL_FLAG_FLUSH_INPUT;
+
 	/* only use blocking IO when it will be a short timeout for reboot */
 	if ((msg->flags & FU_UNIFYING_HIDPP_MSG_FLAG_LONGER_TIMEOUT) == 0)
 		write_flags |= FU_IO_CHANNEL_FLAG_USE_BLOCKING_IO;
@@ -138,7 +144,8 @@ fu_logitech_hidpp_transfer (FuIOChannel *io_channel, FuLogitechHidPpHidppMsg *ms
 {
 	guint timeout = FU_UNIFYING_DEVICE_TIMEOUT_MS;
 	guint ignore_cnt = 0;
-	g_autoptr(FuLogitechHidPpHidppMsg) msg_tmp = fu_logitech_hidpp_msg_new ();
+	FuLogitechHidPpHidppMsg msg_buf = { 0x0 };
+	FuLogitechHidPpHidppMsg *msg_tmp = &msg_buf;
 
 	/* increase timeout for some operations */
 	if (msg->flags & FU_UNIFYING_HIDPP_MSG_FLAG_LONGER_TIMEOUT)
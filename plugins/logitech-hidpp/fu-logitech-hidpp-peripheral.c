@@ -7,11 +7,19 @@
 #include "config.h"
 
 #include <string.h>
+#include <glib-unix.h>
 
 #include "fu-logitech-hidpp-common.h"
 #include "fu-logitech-hidpp-peripheral.h"
 #include "fu-logitech-hidpp-hidpp.h"
 
+#define FU_LOGITECH_HIDPP_PERIPHERAL_WINDOW_SIZE	4
+
+/* HID++1.0 devices do not send notifications and have to be pinged; when
+ * listening for notifications the ping is only a fallback */
+#define FU_LOGITECH_HIDPP_PERIPHERAL_POLL_INTERVAL		30000	/* ms */
+#define FU_LOGITECH_HIDPP_PERIPHERAL_POLL_INTERVAL_NOTIFY	300000	/* ms */
+
 struct _FuLogitechHidPpPeripheral
 {
 	FuUdevDevice		 parent_instance;
@@ -23,6 +31,7 @@ struct _FuLogitechHidPpPeripheral
 	gboolean		 is_active;
 	FuIOChannel		*io_channel;
 	GPtrArray		*feature_index;	/* of FuLogitechHidPpHidppMap */
+	guint			 notify_id;	/* fd watch while listening */
 };
 
 typedef struct {
@@ -177,6 +186,119 @@ fu_logitech_hidpp_peripheral_ping (FuLogitechHidPpPeripheral *self, GError **err
 	return TRUE;
 }
 
+static void
+fu_logitech_hidpp_peripheral_set_active (FuLogitechHidPpPeripheral *self, gboolean is_active)
+{
+	if (self->is_active == is_active)
+		return;
+	self->is_active = is_active;
+	fu_logitech_hidpp_peripheral_refresh_updatable (self);
+
+	/* this is the first time the device has been active */
+	if (is_active && self->feature_index->len == 0) {
+		g_autoptr(GError) error_local = NULL;
+		fu_device_probe_invalidate (FU_DEVICE (self));
+		if (!fu_device_setup (FU_DEVICE (self), &error_local))
+			g_debug ("failed to setup on wakeup: %s", error_local->message);
+	}
+}
+
+static guint8 fu_logitech_hidpp_peripheral_feature_get_idx (FuLogitechHidPpPeripheral *self,
+							    guint16 feature);
+
+static void
+fu_logitech_hidpp_peripheral_handle_notification (FuLogitechHidPpPeripheral *self,
+						  FuLogitechHidPpHidppMsg *msg)
+{
+	guint8 idx;
+
+	/* the receiver tells us when the RF link comes and goes */
+	if (msg->sub_id == HIDPP_SUBID_DEVICE_CONNECTION) {
+		fu_logitech_hidpp_peripheral_set_active (self, (msg->data[0] & 0x40) == 0);
+		return;
+	}
+	if (msg->sub_id == HIDPP_SUBID_DEVICE_DISCONNECTION) {
+		fu_logitech_hidpp_peripheral_set_active (self, FALSE);
+		return;
+	}
+
+	/* HID++2.0 BatteryLevelStatus event */
+	idx = fu_logitech_hidpp_peripheral_feature_get_idx (self, HIDPP_FEATURE_BATTERY_LEVEL_STATUS);
+	if (idx != 0x00 && msg->sub_id == idx && msg->function_id == 0x00) {
+		if (msg->data[0] != 0x00)
+			self->battery_level = msg->data[0];
+		return;
+	}
+
+	/* anything else means the device is awake */
+	fu_logitech_hidpp_peripheral_set_active (self, TRUE);
+}
+
+static void
+fu_logitech_hidpp_peripheral_notify_stop (FuLogitechHidPpPeripheral *self)
+{
+	g_autoptr(GError) error_local = NULL;
+	if (self->notify_id == 0)
+		return;
+	g_source_remove (self->notify_id);
+	self->notify_id = 0;
+	if (!fu_device_close (FU_DEVICE (self), &error_local))
+		g_debug ("failed to close: %s", error_local->message);
+}
+
+static gboolean
+fu_logitech_hidpp_peripheral_notify_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	FuLogitechHidPpPeripheral *self = FU_UNIFYING_PERIPHERAL (user_data);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(FuLogitechHidPpHidppMsg) msg = fu_logitech_hidpp_msg_new ();
+
+	/* the hidraw device has gone, or is broken */
+	if (condition & (G_IO_HUP | G_IO_ERR)) {
+		g_debug ("stopping notifications as hidraw device went away");
+		fu_logitech_hidpp_peripheral_notify_stop (self);
+		return G_SOURCE_REMOVE;
+	}
+	msg->hidpp_version = self->hidpp_version;
+	if (!fu_logitech_hidpp_receive (self->io_channel, msg, 1, &error_local)) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+			return G_SOURCE_CONTINUE;
+		g_debug ("falling back to polling: %s", error_local->message);
+		fu_logitech_hidpp_peripheral_notify_stop (self);
+		fu_device_set_poll_interval (FU_DEVICE (self),
+					     FU_LOGITECH_HIDPP_PERIPHERAL_POLL_INTERVAL);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* for a different device on the same receiver */
+	if (self->hidpp_id != HIDPP_DEVICE_ID_UNSET && msg->device_id != self->hidpp_id)
+		return G_SOURCE_CONTINUE;
+	fu_logitech_hidpp_peripheral_handle_notification (self, msg);
+	return G_SOURCE_CONTINUE;
+}
+
+/* keep the hidraw device open so the notifications are queued for us */
+static gboolean
+fu_logitech_hidpp_peripheral_notify_start (FuLogitechHidPpPeripheral *self, GError **error)
+{
+	if (self->notify_id != 0)
+		return TRUE;
+	if (self->hidpp_version < 2.f) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_SUPPORTED,
+				     "HID++1.0 does not send notifications");
+		return FALSE;
+	}
+	if (!fu_device_open (FU_DEVICE (self), error))
+		return FALSE;
+	self->notify_id = g_unix_fd_add (fu_io_channel_unix_get_fd (self->io_channel),
+					 G_IO_IN | G_IO_HUP | G_IO_ERR,
+					 fu_logitech_hidpp_peripheral_notify_cb,
+					 self);
+	return TRUE;
+}
+
 static gboolean
 fu_logitech_hidpp_peripheral_close (FuDevice *device, GError **error)
 {
@@ -201,10 +323,11 @@ fu_logitech_hidpp_peripheral_poll (FuDevice *device, GError **error)
 	if (locker == NULL)
 		return FALSE;
 
-	/* flush pending data */
+	/* flush pending data, unless listening for it */
 	msg->device_id = self->hidpp_id;
 	msg->hidpp_version = self->hidpp_version;
-	if (!fu_logitech_hidpp_receive (self->io_channel, msg, timeout, &error_local)) {
+	if (self->notify_id == 0 &&
+	    !fu_logitech_hidpp_receive (self->io_channel, msg, timeout, &error_local)) {
 		if (!g_error_matches (error_local,
 				      G_IO_ERROR,
 				      G_IO_ERROR_TIMED_OUT)) {
@@ -492,6 +615,7 @@ fu_logitech_hidpp_peripheral_setup (FuDevice *device, GError **error)
 {
 	FuLogitechHidPpPeripheral *self = FU_UNIFYING_PERIPHERAL (device);
 	guint8 idx;
+	g_autoptr(GError) error_notify = NULL;
 	const guint16 map_features[] = {
 		HIDPP_FEATURE_GET_DEVICE_NAME_TYPE,
 		HIDPP_FEATURE_I_FIRMWARE_INFO,
@@ -612,8 +736,13 @@ fu_logitech_hidpp_peripheral_setup (FuDevice *device, GError **error)
 	/* this device may have changed state */
 	fu_logitech_hidpp_peripheral_refresh_updatable (self);
 
-	/* poll for pings to track active state */
-	fu_device_set_poll_interval (device, 30000);
+	/* listen for notifications to track active state, falling back to pings */
+	if (!fu_logitech_hidpp_peripheral_notify_start (self, &error_notify)) {
+		g_debug ("polling as not listening: %s", error_notify->message);
+		fu_device_set_poll_interval (device, FU_LOGITECH_HIDPP_PERIPHERAL_POLL_INTERVAL);
+	} else {
+		fu_device_set_poll_interval (device, FU_LOGITECH_HIDPP_PERIPHERAL_POLL_INTERVAL_NOTIFY);
+	}
 	return TRUE;
 }
 
@@ -624,6 +753,9 @@ fu_logitech_hidpp_peripheral_detach (FuDevice *device, GError **error)
 	guint8 idx;
 	g_autoptr(FuLogitechHidPpHidppMsg) msg = fu_logitech_hidpp_msg_new ();
 
+	/* the update needs all the replies */
+	fu_logitech_hidpp_peripheral_notify_stop (self);
+
 	/* sanity check */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_IS_BOOTLOADER)) {
 		g_debug ("already in bootloader mode, skipping");
@@ -837,29 +969,53 @@ fu_logitech_hidpp_peripheral_check_status (guint8 status, GError **error)
 	return FALSE;
 }
 
+/* a reply with the SwID set is for one of our packets, and not an event */
 static gboolean
-fu_logitech_hidpp_peripheral_write_firmware_pkt (FuLogitechHidPpPeripheral *self,
-					   guint8 idx,
-					   guint8 cmd,
-					   const guint8 *data,
-					   GError **error)
+fu_logitech_hidpp_peripheral_wait_for_event (FuLogitechHidPpPeripheral *self,
+					     FuLogitechHidPpHidppMsg *msg,
+					     GPtrArray *replies,
+					     GError **error)
+{
+	for (guint retry = 0; retry < 10; retry++) {
+		g_autoptr(FuLogitechHidPpHidppMsg) msg2 = fu_logitech_hidpp_msg_new ();
+		msg2->flags = FU_UNIFYING_HIDPP_MSG_FLAG_IGNORE_FNCT_ID;
+		if (!fu_logitech_hidpp_receive (self->io_channel, msg2, 15000, error))
+			return FALSE;
+		if (replies != NULL && fu_logitech_hidpp_msg_verify_swid (msg2)) {
+			g_debug ("got reply for later packet, queuing");
+			msg2->flags = FU_UNIFYING_HIDPP_MSG_FLAG_NONE;
+			g_ptr_array_add (replies, g_steal_pointer (&msg2));
+			continue;
+		}
+		if (fu_logitech_hidpp_msg_is_reply (msg, msg2)) {
+			g_autoptr(GError) error2 = NULL;
+			if (!fu_logitech_hidpp_peripheral_check_status (msg2->data[4], &error2)) {
+				g_debug ("got %s, waiting a bit longer", error2->message);
+				continue;
+			}
+			return TRUE;
+		} else {
+			g_debug ("got wrong packet, continue to wait...");
+		}
+	}
+
+	/* nothing in the queue */
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to get event after timeout");
+	return FALSE;
+}
+
+static gboolean
+fu_logitech_hidpp_peripheral_check_pkt_status (FuLogitechHidPpPeripheral *self,
+					       FuLogitechHidPpHidppMsg *msg,
+					       GPtrArray *replies,
+					       GError **error)
 {
 	guint32 packet_cnt;
-	g_autoptr(FuLogitechHidPpHidppMsg) msg = fu_logitech_hidpp_msg_new ();
 	g_autoptr(GError) error_local = NULL;
 
-	/* send firmware data */
-	msg->report_id = HIDPP_REPORT_ID_LONG;
-	msg->device_id = self->hidpp_id;
-	msg->sub_id = idx;
-	msg->function_id = cmd << 4; /* dfuStart or dfuCmdDataX */
-	msg->hidpp_version = self->hidpp_version;
-	memcpy (msg->data, data, 16);
-	if (!fu_logitech_hidpp_transfer (self->io_channel, msg, &error_local)) {
-		g_prefix_error (error, "failed to supply program data: ");
-		return FALSE;
-	}
-
 	/* check error */
 	packet_cnt = fu_common_read_uint32 (msg->data, G_BIG_ENDIAN);
 	g_debug ("packet_cnt=0x%04x", packet_cnt);
@@ -879,29 +1035,142 @@ fu_logitech_hidpp_peripheral_write_firmware_pkt (FuLogitechHidPpPeripheral *self
 
 	/* wait for the HID++ notification */
 	g_debug ("ignoring: %s", error_local->message);
-	for (guint retry = 0; retry < 10; retry++) {
+	return fu_logitech_hidpp_peripheral_wait_for_event (self, msg, replies, error);
+}
+
+static gboolean
+fu_logitech_hidpp_peripheral_write_firmware_pkt (FuLogitechHidPpPeripheral *self,
+					   guint8 idx,
+					   guint8 cmd,
+					   const guint8 *data,
+					   GError **error)
+{
+	FuLogitechHidPpHidppMsg *msg;
+
+	/* send firmware data */
+	msg = (FuLogitechHidPpHidppMsg *) fu_device_get_packet_buffer (FU_DEVICE (self), sizeof(*msg));
+	memset (msg, 0x0, sizeof(*msg));
+	msg->report_id = HIDPP_REPORT_ID_LONG;
+	msg->device_id = self->hidpp_id;
+	msg->sub_id = idx;
+	msg->function_id = cmd << 4; /* dfuStart or dfuCmdDataX */
+	msg->hidpp_version = self->hidpp_version;
+	memcpy (msg->data, data, 16);
+	if (!fu_logitech_hidpp_transfer (self->io_channel, msg, error)) {
+		g_prefix_error (error, "failed to supply program data: ");
+		return FALSE;
+	}
+	return fu_logitech_hidpp_peripheral_check_pkt_status (self, msg, NULL, error);
+}
+
+/* replies arrive in order, but some may have been queued while waiting for
+ * an event for an earlier packet */
+static gboolean
+fu_logitech_hidpp_peripheral_wait_for_ack (FuLogitechHidPpPeripheral *self,
+					   FuLogitechHidPpHidppMsg *msg,
+					   GPtrArray *replies,
+					   GError **error)
+{
+	guint ignore_cnt = 0;
+
+	for (guint i = 0; i < replies->len; i++) {
+		FuLogitechHidPpHidppMsg *msg_tmp = g_ptr_array_index (replies, i);
+		if (fu_logitech_hidpp_msg_is_reply (msg, msg_tmp)) {
+			g_autoptr(FuLogitechHidPpHidppMsg) msg2 = fu_logitech_hidpp_msg_new ();
+			fu_logitech_hidpp_msg_copy (msg2, msg_tmp);
+			g_ptr_array_remove_index (replies, i);
+			return fu_logitech_hidpp_peripheral_check_pkt_status (self, msg2, replies, error);
+		}
+	}
+	while (1) {
 		g_autoptr(FuLogitechHidPpHidppMsg) msg2 = fu_logitech_hidpp_msg_new ();
-		msg2->flags = FU_UNIFYING_HIDPP_MSG_FLAG_IGNORE_FNCT_ID;
-		if (!fu_logitech_hidpp_receive (self->io_channel, msg2, 15000, error))
+		msg2->hidpp_version = self->hidpp_version;
+		if (!fu_logitech_hidpp_receive (self->io_channel, msg2,
+						FU_UNIFYING_DEVICE_TIMEOUT_MS, error))
 			return FALSE;
-		if (fu_logitech_hidpp_msg_is_reply (msg, msg2)) {
-			g_autoptr(GError) error2 = NULL;
-			if (!fu_logitech_hidpp_peripheral_check_status (msg2->data[4], &error2)) {
-				g_debug ("got %s, waiting a bit longer", error2->message);
-				continue;
+		if (!fu_logitech_hidpp_msg_is_error (msg2, error))
+			return FALSE;
+		if (fu_logitech_hidpp_msg_is_reply (msg, msg2))
+			return fu_logitech_hidpp_peripheral_check_pkt_status (self, msg2, replies, error);
+
+		/* hardware not responding */
+		if (ignore_cnt++ > 10) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "too many messages to ignore");
+			return FALSE;
+		}
+		g_debug ("ignoring message %u", ignore_cnt);
+	}
+}
+
+/* the DFU feature has four dfuCmdDataX functions, so up to four packets can
+ * be in flight and the replies can still be told apart */
+static gboolean
+fu_logitech_hidpp_peripheral_write_firmware_windowed (FuLogitechHidPpPeripheral *self,
+						      guint8 idx,
+						      const guint8 *data,
+						      gsize sz,
+						      GError **error)
+{
+	gsize pkt_cnt = sz / 16;
+	gsize pkt_sent = 1;
+	guint8 cmd = 0x04;
+	g_autoptr(GPtrArray) inflight = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GPtrArray) replies = g_ptr_array_new_with_free_func (g_free);
+
+	/* dfuStart has to complete before any program data is sent */
+	if (pkt_cnt == 0)
+		return TRUE;
+	if (!fu_logitech_hidpp_peripheral_write_firmware_pkt (self, idx, cmd, data, error)) {
+		g_prefix_error (error, "failed to write @0x0000: ");
+		return FALSE;
+	}
+	cmd = (cmd + 1) % 4;
+
+	for (gsize i = 1; i < pkt_cnt; i++) {
+		FuLogitechHidPpHidppMsg *msg;
+
+		/* keep the window full */
+		while (pkt_sent < pkt_cnt &&
+		       inflight->len < FU_LOGITECH_HIDPP_PERIPHERAL_WINDOW_SIZE) {
+			g_autoptr(FuLogitechHidPpHidppMsg) msg2 = fu_logitech_hidpp_msg_new ();
+			msg2->report_id = HIDPP_REPORT_ID_LONG;
+			msg2->device_id = self->hidpp_id;
+			msg2->sub_id = idx;
+			msg2->function_id = cmd << 4; /* dfuCmdDataX */
+			msg2->hidpp_version = self->hidpp_version;
+			msg2->flags = FU_UNIFYING_HIDPP_MSG_FLAG_NO_FLUSH;
+			memcpy (msg2->data, data + (pkt_sent * 16), 16);
+			if (!fu_logitech_hidpp_send (self->io_channel, msg2,
+						     FU_UNIFYING_DEVICE_TIMEOUT_MS,
+						     error)) {
+				g_prefix_error (error,
+						"failed to write @0x%04x: ",
+						(guint) pkt_sent * 16);
+				return FALSE;
 			}
-			return TRUE;
-		} else {
-			g_debug ("got wrong packet, continue to wait...");
+			g_ptr_array_add (inflight, g_steal_pointer (&msg2));
+			cmd = (cmd + 1) % 4;
+			pkt_sent++;
+		}
+
+		/* check the oldest packet was accepted */
+		msg = g_ptr_array_index (inflight, 0);
+		if (!fu_logitech_hidpp_peripheral_wait_for_ack (self, msg, replies, error)) {
+			g_prefix_error (error,
+					"failed to write @0x%04x: ",
+					(guint) i * 16);
+			return FALSE;
 		}
+		g_ptr_array_remove_index (inflight, 0);
+
+		/* update progress-bar */
+		fu_device_set_progress_full (FU_DEVICE (self), i * 16, sz);
 	}
 
-	/* nothing in the queue */
-	g_set_error_literal (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_FAILED,
-			     "failed to get event after timeout");
-	return FALSE;
+	return TRUE;
 }
 
 static gboolean
@@ -935,6 +1204,8 @@ fu_logitech_hidpp_peripheral_write_firmware (FuDevice *device,
 	/* flash hardware */
 	data = g_bytes_get_data (fw, &sz);
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	if (fu_device_has_custom_flag (device, "windowed-write"))
+		return fu_logitech_hidpp_peripheral_write_firmware_windowed (self, idx, data, sz, error);
 	for (gsize i = 0; i < sz / 16; i++) {
 
 		/* send packet and wait for reply */
@@ -1010,6 +1281,10 @@ static void
 fu_logitech_hidpp_peripheral_finalize (GObject *object)
 {
 	FuLogitechHidPpPeripheral *self = FU_UNIFYING_PERIPHERAL (object);
+	if (self->notify_id != 0)
+		g_source_remove (self->notify_id);
+	if (self->io_channel != NULL)
+		g_object_unref (self->io_channel);
 	g_ptr_array_unref (self->feature_index);
 	G_OBJECT_CLASS (fu_logitech_hidpp_peripheral_parent_class)->finalize (object);
 }
@@ -519,6 +519,7 @@ fu_mm_qmi_pdc_archive_iterate_mcfg (FuArchive	*archive,
 	file_info = g_new0 (FuMmFileInfo, 1);
 	file_info->filename = g_strdup (filename);
 	file_info->bytes = g_bytes_ref (bytes);
+	file_info->digest = fu_qmi_pdc_updater_get_checksum (bytes);
 	file_info->active = fu_mm_should_be_active (fu_device_get_version (FU_DEVICE (ctx->device)), filename);
 	g_ptr_array_add (ctx->file_infos, file_info);
 	ctx->total_bytes += g_bytes_get_size (file_info->bytes);
@@ -571,7 +572,14 @@ fu_mm_device_write_firmware_qmi_pdc (FuDevice *device, GBytes *fw, GArray **acti
 	if (archive == NULL)
 		return FALSE;
 
-	/* boot to fastboot mode */
+	/* select the MCFG files and hash them before the QMI port is claimed,
+	 * so the modem is only kept busy while actually loading data */
+	if (!fu_archive_iterate (archive,
+				 fu_mm_qmi_pdc_archive_iterate_mcfg,
+				 &archive_context,
+				 error))
+		return FALSE;
+
 	locker = fu_device_locker_new_full (device,
 					    (FuDeviceLockerFunc) fu_mm_device_qmi_open,
 					    (FuDeviceLockerFunc) fu_mm_device_qmi_close,
@@ -580,23 +588,22 @@ fu_mm_device_write_firmware_qmi_pdc (FuDevice *device, GBytes *fw, GArray **acti
 		return FALSE;
 
 	/* process the list of MCFG files to write */
-	if (!fu_archive_iterate (archive,
-				 fu_mm_qmi_pdc_archive_iterate_mcfg,
-				 &archive_context,
-				 error))
-		return FALSE;
-
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
 	for (guint i = 0; i < file_infos->len; i++) {
 		FuMmFileInfo *file_info = g_ptr_array_index (file_infos, i);
-		file_info->digest = fu_qmi_pdc_updater_write (archive_context.device->qmi_pdc_updater,
-							      file_info->filename,
-							      file_info->bytes,
-							      &archive_context.error);
-		if (file_info->digest == NULL) {
+		if (!fu_qmi_pdc_updater_write (archive_context.device->qmi_pdc_updater,
+					       file_info->filename,
+					       file_info->bytes,
+					       file_info->digest,
+					       &archive_context.error)) {
 			g_prefix_error (&archive_context.error,
 					"Failed to write file '%s':", file_info->filename);
 			break;
 		}
+		archive_context.total_written += g_bytes_get_size (file_info->bytes);
+		fu_device_set_progress_full (device,
+					     archive_context.total_written,
+					     archive_context.total_bytes);
 		/* if we wrongly detect more than one, just assume the latest one; this
 		 * is not critical, it may just take a bit more time to perform the
 		 * automatic carrier config switching in ModemManager */
@@ -832,6 +839,20 @@ fu_mm_device_udev_new (MMManager *manager,
 	return self;
 }
 
+/* TRUE if all the ports needed by the supported update methods exist */
+gboolean
+fu_mm_device_udev_has_ports (FuMmDevice *self)
+{
+	g_return_val_if_fail (FU_IS_MM_DEVICE (self), FALSE);
+	if ((self->update_methods & MM_MODEM_FIRMWARE_UPDATE_METHOD_FASTBOOT) &&
+	    self->port_at == NULL)
+		return FALSE;
+	if ((self->update_methods & MM_MODEM_FIRMWARE_UPDATE_METHOD_QMI_PDC) &&
+	    self->port_qmi == NULL)
+		return FALSE;
+	return TRUE;
+}
+
 void
 fu_mm_device_udev_add_port (FuMmDevice	*self,
 			    const gchar	*subsystem,
@@ -46,5 +46,6 @@ void				 fu_mm_device_udev_add_port		(FuMmDevice	*device,
 									 const gchar	*subsystem,
 									 const gchar	*path,
 									 gint		 ifnum);
+gboolean			 fu_mm_device_udev_has_ports		(FuMmDevice	*device);
 
 #endif /* __FU_MM_DEVICE_H */
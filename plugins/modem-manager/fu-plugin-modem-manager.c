@@ -25,6 +25,12 @@ struct FuPluginData {
 	gboolean	 manager_ready;
 	GUdevClient	*udev_client;
 	guint		 udev_timeout_id;
+	gboolean	 udev_device_added;
+
+	/* inhibition is requested when the update is being prepared, and is
+	 * only waited for just before the device is detached */
+	GThread		*inhibit_thread;
+	FuPluginMmInhibitedDeviceInfo *inhibiting;
 
 	/* when a device is inhibited from MM, we store all relevant details
 	 * ourselves to recreate a functional device object even without MM
@@ -48,6 +54,7 @@ fu_plugin_mm_udev_device_removed (FuPlugin *plugin)
 	/* once the first port is gone, consider device is gone */
 	fu_plugin_cache_remove (plugin, priv->inhibited->physical_id);
 	fu_plugin_device_remove (plugin, FU_DEVICE (dev));
+	priv->udev_device_added = FALSE;
 
 	/* no need to wait for more ports, cancel that right away */
 	if (priv->udev_timeout_id != 0) {
@@ -72,25 +79,37 @@ fu_plugin_mm_uninhibit_device (FuPlugin *plugin)
 	}
 }
 
+static void
+fu_plugin_mm_udev_device_ports_ready (FuPlugin *plugin, FuMmDevice *dev)
+{
+	FuPluginData *priv = fu_plugin_get_data (plugin);
+	g_autoptr(GError) error = NULL;
+
+	if (priv->udev_timeout_id != 0) {
+		g_source_remove (priv->udev_timeout_id);
+		priv->udev_timeout_id = 0;
+	}
+	if (!fu_device_probe (FU_DEVICE (dev), &error)) {
+		g_warning ("failed to probe MM device: %s", error->message);
+		return;
+	}
+	fu_plugin_device_add (plugin, FU_DEVICE (dev));
+	priv->udev_device_added = TRUE;
+}
+
 static gboolean
 fu_plugin_mm_udev_device_ports_timeout (gpointer user_data)
 {
 	FuPlugin *plugin = user_data;
 	FuPluginData *priv = fu_plugin_get_data (plugin);
 	FuMmDevice *dev;
-	g_autoptr(GError) error = NULL;
 
 	g_return_val_if_fail (priv->inhibited != NULL, G_SOURCE_REMOVE);
 	priv->udev_timeout_id = 0;
 
 	dev = fu_plugin_cache_lookup (plugin, priv->inhibited->physical_id);
-	if (dev != NULL) {
-		if (!fu_device_probe (FU_DEVICE (dev), &error)) {
-			g_warning ("failed to probe MM device: %s", error->message);
-		} else {
-			fu_plugin_device_add (plugin, FU_DEVICE (dev));
-		}
-	}
+	if (dev != NULL)
+		fu_plugin_mm_udev_device_ports_ready (plugin, dev);
 
 	return G_SOURCE_REMOVE;
 }
@@ -117,20 +136,27 @@ fu_plugin_mm_udev_device_port_added (FuPlugin		*plugin,
 	FuPluginData *priv = fu_plugin_get_data (plugin);
 	FuMmDevice *existing;
 	g_autoptr(FuMmDevice) dev = NULL;
-	g_autoptr(GError) error = NULL;
 
 	g_return_if_fail (priv->inhibited != NULL);
 	existing = fu_plugin_cache_lookup (plugin, priv->inhibited->physical_id);
 	if (existing != NULL) {
 		/* add port to existing device */
 		fu_mm_device_udev_add_port (existing, subsystem, path, ifnum);
-		fu_plugin_mm_udev_device_ports_timeout_reset (plugin);
+		if (priv->udev_device_added)
+			return;
+		dev = g_object_ref (existing);
+	} else {
+		/* create device and add to cache */
+		dev = fu_mm_device_udev_new (priv->manager, priv->inhibited);
+		fu_mm_device_udev_add_port (dev, subsystem, path, ifnum);
+		fu_plugin_cache_add (plugin, priv->inhibited->physical_id, dev);
+	}
+
+	/* every port the update needs is here, so no need to wait */
+	if (fu_mm_device_udev_has_ports (dev)) {
+		fu_plugin_mm_udev_device_ports_ready (plugin, dev);
 		return;
 	}
-	/* create device and add to cache */
-	dev = fu_mm_device_udev_new (priv->manager, priv->inhibited);
-	fu_mm_device_udev_add_port (dev, subsystem, path, ifnum);
-	fu_plugin_cache_add (plugin, priv->inhibited->physical_id, dev);
 
 	/* wait a bit before probing, in case more ports get added */
 	fu_plugin_mm_udev_device_ports_timeout_reset (plugin);
@@ -178,23 +204,53 @@ fu_plugin_mm_udev_uevent_cb (GUdevClient	*udev,
 	return TRUE;
 }
 
-static gboolean
-fu_plugin_mm_inhibit_device (FuPlugin *plugin, FuDevice *device, GError **error)
+/* returns a #GError, or %NULL for success */
+static gpointer
+fu_plugin_mm_inhibit_thread_cb (gpointer user_data)
 {
-	static const gchar *subsystems[] = { "tty", "usbmisc", NULL };
+	FuPlugin *plugin = FU_PLUGIN (user_data);
 	FuPluginData *priv = fu_plugin_get_data (plugin);
-	g_autoptr(FuPluginMmInhibitedDeviceInfo) info = NULL;
+	GError *error = NULL;
+
+	g_debug ("inhibit modemmanager device with uid %s", priv->inhibiting->inhibited_uid);
+	mm_manager_inhibit_device_sync (priv->manager,
+					priv->inhibiting->inhibited_uid,
+					NULL, &error);
+	return error;
+}
+
+static void
+fu_plugin_mm_inhibit_device_start (FuPlugin *plugin, FuDevice *device)
+{
+	FuPluginData *priv = fu_plugin_get_data (plugin);
+
+	g_return_if_fail (priv->inhibit_thread == NULL);
 
 	fu_plugin_mm_uninhibit_device (plugin);
+	priv->inhibiting = fu_plugin_mm_inhibited_device_info_new (FU_MM_DEVICE (device));
+	priv->inhibit_thread = g_thread_new ("fu-mm-inhibit",
+					     fu_plugin_mm_inhibit_thread_cb,
+					     plugin);
+}
 
-	info = fu_plugin_mm_inhibited_device_info_new (FU_MM_DEVICE (device));
+static gboolean
+fu_plugin_mm_inhibit_device_finish (FuPlugin *plugin, GError **error)
+{
+	static const gchar *subsystems[] = { "tty", "usbmisc", NULL };
+	FuPluginData *priv = fu_plugin_get_data (plugin);
+	GError *error_thread;
+	g_autoptr(FuPluginMmInhibitedDeviceInfo) info = NULL;
 
-	g_debug ("inhibit modemmanager device with uid %s", info->inhibited_uid);
-	if (!mm_manager_inhibit_device_sync (priv->manager, info->inhibited_uid, NULL, error))
+	error_thread = g_thread_join (g_steal_pointer (&priv->inhibit_thread));
+	info = g_steal_pointer (&priv->inhibiting);
+	if (error_thread != NULL) {
+		g_propagate_error (error, error_thread);
 		return FALSE;
+	}
 
 	/* setup inhibited device info */
 	priv->inhibited = g_steal_pointer (&info);
+	priv->udev_device_added = FALSE;
 
 	/* as soon as inhibition is place, we need to do modem device monitoring based
 	 * on the udev client, as MM no longer reports devices */
@@ -205,6 +261,13 @@ fu_plugin_mm_inhibit_device (FuPlugin *plugin, FuDevice *device, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_plugin_mm_inhibit_device (FuPlugin *plugin, FuDevice *device, GError **error)
+{
+	fu_plugin_mm_inhibit_device_start (plugin, device);
+	return fu_plugin_mm_inhibit_device_finish (plugin, error);
+}
+
 static void
 fu_plugin_mm_device_add (FuPlugin *plugin, MMObject *modem)
 {
@@ -346,6 +409,8 @@ fu_plugin_destroy (FuPlugin *plugin)
 {
 	FuPluginData *priv = fu_plugin_get_data (plugin);
 
+	if (priv->inhibit_thread != NULL)
+		fu_plugin_mm_inhibit_device_finish (plugin, NULL);
 	fu_plugin_mm_uninhibit_device (plugin);
 
 	if (priv->udev_timeout_id)
@@ -356,6 +421,46 @@ fu_plugin_destroy (FuPlugin *plugin)
 		g_object_unref (priv->manager);
 }
 
+gboolean
+fu_plugin_update_prepare (FuPlugin *plugin,
+			  FwupdInstallFlags flags,
+			  FuDevice *device,
+			  GError **error)
+{
+	FuPluginData *priv = fu_plugin_get_data (plugin);
+
+	/* not us, or already inhibited for an earlier write */
+	if (!FU_IS_MM_DEVICE (device))
+		return TRUE;
+	if (priv->inhibited != NULL || priv->inhibit_thread != NULL)
+		return TRUE;
+
+	/* ModemManager can take a while to release the ports, so ask now and
+	 * let the engine parse the firmware while waiting */
+	fu_plugin_mm_inhibit_device_start (plugin, device);
+	return TRUE;
+}
+
+gboolean
+fu_plugin_update_cleanup (FuPlugin *plugin,
+			  FwupdInstallFlags flags,
+			  FuDevice *device,
+			  GError **error)
+{
+	FuPluginData *priv = fu_plugin_get_data (plugin);
+	g_autoptr(GError) error_local = NULL;
+
+	/* the install failed before the device was detached */
+	if (priv->inhibit_thread == NULL)
+		return TRUE;
+	if (!fu_plugin_mm_inhibit_device_finish (plugin, &error_local)) {
+		g_debug ("failed to inhibit device: %s", error_local->message);
+		return TRUE;
+	}
+	fu_plugin_mm_uninhibit_device (plugin);
+	return TRUE;
+}
+
 gboolean
 fu_plugin_update_detach (FuPlugin *plugin, FuDevice *device, GError **error)
 {
@@ -371,7 +476,10 @@ fu_plugin_update_detach (FuPlugin *plugin, FuDevice *device, GError **error)
 	 * lifetime of the FuMmDevice, because that object will only exist for
 	 * as long as the ModemManager device exists, and inhibiting will
 	 * implicitly remove the device from ModemManager. */
-	if (priv->inhibited == NULL) {
+	if (priv->inhibit_thread != NULL) {
+		if (!fu_plugin_mm_inhibit_device_finish (plugin, error))
+			return FALSE;
+	} else if (priv->inhibited == NULL) {
 		if (!fu_plugin_mm_inhibit_device (plugin, device, error))
 			return FALSE;
 	}
@@ -6,8 +6,6 @@
 
 #include "config.h"
 
-#include <cpuid.h>
-
 #include "fu-plugin-vfuncs.h"
 #include "fu-hash.h"
 
@@ -36,49 +34,20 @@ fu_plugin_init (FuPlugin *plugin)
 	fu_plugin_add_udev_subsystem (plugin, "msr");
 }
 
-static gboolean
-fu_plugin_msr_cpuid (guint leaf,
-		     guint *eax, guint *ebx,
-		     guint *ecx, guint *edx,
-		     GError **error)
-{
-	guint eax_tmp = 0;
-	guint ebx_tmp = 0;
-	guint ecx_tmp = 0;
-	guint edx_tmp = 0;
-
-	/* sdbg is supported: https://en.wikipedia.org/wiki/CPUID */
-	if (__get_cpuid (leaf, &eax_tmp, &ebx_tmp, &ecx_tmp, &edx_tmp) == 0) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_FOUND,
-			     "CPUID leaf 0x%x is not supported on this CPU", leaf);
-		return FALSE;
-	}
-
-	/* success */
-	if (eax != NULL)
-		*eax = eax_tmp;
-	if (ebx != NULL)
-		*ebx = ebx_tmp;
-	if (ecx != NULL)
-		*ecx = ecx_tmp;
-	if (edx != NULL)
-		*edx = edx_tmp;
-	return TRUE;
-}
-
 gboolean
 fu_plugin_startup (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *priv = fu_plugin_get_data (plugin);
-	guint ecx = 0;
+	guint32 ecx = 0;
 
 	/* sdbg is supported: https://en.wikipedia.org/wiki/CPUID */
-	if (!fu_plugin_msr_cpuid (0x01, NULL, NULL, &ecx, NULL, error))
+	if (!fu_common_cpuid (0x01, NULL, NULL, &ecx, NULL, error))
 		return FALSE;
 
-	priv->ia32_debug_supported = ((ecx >> 11) & 0x1) > 0;
+	/* this MSR is only valid for a subset of Intel CPUs, so only ask
+	 * the CPU for the vendor once */
+	priv->ia32_debug_supported = fu_common_is_cpu_intel () &&
+				     ((ecx >> 11) & 0x1) > 0;
 	return TRUE;
 }
 
@@ -94,6 +63,10 @@ fu_plugin_udev_device_added (FuPlugin *plugin, FuUdevDevice *device, GError **er
 	if (g_strcmp0 (fu_udev_device_get_subsystem (device), "msr") != 0)
 		return TRUE;
 
+	/* nothing to read, so do not even open the device */
+	if (!priv->ia32_debug_supported)
+		return TRUE;
+
 	/* we only care about the first processor */
 	basename = g_path_get_basename (fu_udev_device_get_sysfs_path (device));
 	if (g_strcmp0 (basename, "msr0") != 0)
@@ -106,21 +79,19 @@ fu_plugin_udev_device_added (FuPlugin *plugin, FuUdevDevice *device, GError **er
 		return FALSE;
 
 	/* grab MSR */
-	if (priv->ia32_debug_supported) {
-		if (!fu_udev_device_pread_full (device, PCI_MSR_IA32_DEBUG_INTERFACE,
-						buf, sizeof(buf), error)) {
-			g_prefix_error (error, "could not read IA32_DEBUG_INTERFACE: ");
-			return FALSE;
-		}
-		if (!fu_common_read_uint32_safe (buf, sizeof(buf), 0x0,
-						 &priv->ia32_debug.data, G_LITTLE_ENDIAN,
-						 error))
-			return FALSE;
-		g_debug ("IA32_DEBUG_INTERFACE: enabled=%i, locked=%i, debug_occurred=%i",
-			 priv->ia32_debug.fields.enabled,
-			 priv->ia32_debug.fields.locked,
-			 priv->ia32_debug.fields.debug_occurred);
+	if (!fu_udev_device_pread_full (device, PCI_MSR_IA32_DEBUG_INTERFACE,
+					buf, sizeof(buf), error)) {
+		g_prefix_error (error, "could not read IA32_DEBUG_INTERFACE: ");
+		return FALSE;
 	}
+	if (!fu_common_read_uint32_safe (buf, sizeof(buf), 0x0,
+					 &priv->ia32_debug.data, G_LITTLE_ENDIAN,
+					 error))
+		return FALSE;
+	g_debug ("IA32_DEBUG_INTERFACE: enabled=%i, locked=%i, debug_occurred=%i",
+		 priv->ia32_debug.fields.enabled,
+		 priv->ia32_debug.fields.locked,
+		 priv->ia32_debug.fields.debug_occurred);
 	return TRUE;
 }
 
@@ -131,8 +102,6 @@ fu_plugin_add_security_attr_dci_enabled (FuPlugin *plugin, FuSecurityAttrs *attr
 	g_autoptr(FwupdSecurityAttr) attr = NULL;
 
 	/* this MSR is only valid for a subset of Intel CPUs */
-	if (!fu_common_is_cpu_intel ())
-		return;
 	if (!priv->ia32_debug_supported)
 		return;
 
@@ -160,8 +129,6 @@ fu_plugin_add_security_attr_dci_locked (FuPlugin *plugin, FuSecurityAttrs *attrs
 	g_autoptr(FwupdSecurityAttr) attr = NULL;
 
 	/* this MSR is only valid for a subset of Intel CPUs */
-	if (!fu_common_is_cpu_intel ())
-		return;
 	if (!priv->ia32_debug_supported)
 		return;
 
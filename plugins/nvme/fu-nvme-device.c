@@ -6,28 +6,64 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <sys/ioctl.h>
 #include <linux/nvme_ioctl.h>
 
-#include "fu-chunk.h"
 #include "fu-nvme-common.h"
 #include "fu-nvme-device.h"
 
 #define FU_NVME_ID_CTRL_SIZE	0x1000
+#define FU_NVME_BLOCK_SIZE_MIN	0x1000		/* CAP.MPSMIN is 4k on all known drives */
+#define FU_NVME_BLOCK_SIZE_MAX	0x20000		/* if MDTS is unlimited */
 
 struct _FuNvmeDevice {
 	FuUdevDevice		 parent_instance;
 	guint			 pci_depth;
 	guint64			 write_block_size;
+	guint8			 fwug;
+	guint8			 mdts;
 };
 
 G_DEFINE_TYPE (FuNvmeDevice, fu_nvme_device, FU_TYPE_UDEV_DEVICE)
 
+/* the largest chunk that is a multiple of FWUG and no larger than MDTS */
+guint32
+fu_nvme_device_get_write_block_size (FuNvmeDevice *self)
+{
+	guint32 block_max = FU_NVME_BLOCK_SIZE_MAX;
+	guint32 block_gran;
+
+	/* set from a quirk */
+	if (self->write_block_size > 0)
+		return (guint32) self->write_block_size;
+
+	/* no information provided, so use the smallest size */
+	if (self->fwug == 0x00)
+		return FU_NVME_BLOCK_SIZE_MIN;
+
+	/* MDTS is a power of two in units of the minimum page size */
+	if (self->mdts > 0 && self->mdts < 6)
+		block_max = FU_NVME_BLOCK_SIZE_MIN << self->mdts;
+
+	/* no restriction */
+	if (self->fwug == 0xff)
+		return block_max;
+
+	/* FWUG is in 4k units */
+	block_gran = (guint32) self->fwug * 0x1000;
+	if (block_gran >= block_max)
+		return block_gran;
+	return (block_max / block_gran) * block_gran;
+}
+
 static void
 fu_nvme_device_to_string (FuDevice *device, guint idt, GString *str)
 {
 	FuNvmeDevice *self = FU_NVME_DEVICE (device);
 	fu_common_string_append_ku (str, idt, "PciDepth", self->pci_depth);
+	fu_common_string_append_kx (str, idt, "WriteBlockSize",
+				    fu_nvme_device_get_write_block_size (self));
 }
 
 /* @addr_start and @addr_end are *inclusive* to match the NMVe specification */
@@ -187,7 +223,6 @@ static gboolean
 fu_nvme_device_parse_cns (FuNvmeDevice *self, const guint8 *buf, gsize sz, GError **error)
 {
 	guint8 fawr;
-	guint8 fwug;
 	guint8 nfws;
 	guint8 s1ro;
 	g_autofree gchar *gu = NULL;
@@ -217,10 +252,12 @@ fu_nvme_device_parse_cns (FuNvmeDevice *self, const guint8 *buf, gsize sz, GErro
 	if (sr != NULL)
 		fu_device_set_version (FU_DEVICE (self), sr);
 
+	/* maximum data transfer size (MDTS) */
+	self->mdts = buf[77];
+
 	/* firmware update granularity (FWUG) */
-	fwug = buf[319];
-	if (fwug != 0x00 && fwug != 0xff)
-		self->write_block_size = ((guint64) fwug) * 0x1000;
+	self->fwug = buf[319];
+	g_debug ("mdts: %u, fwug: %u", self->mdts, self->fwug);
 
 	/* firmware slot information */
 	fawr = (buf[260] & 0x10) >> 4;
@@ -305,50 +342,55 @@ fu_nvme_device_setup (FuDevice *device, GError **error)
 }
 
 static gboolean
-fu_nvme_device_write_firmware (FuDevice *device,
-			       FuFirmware *firmware,
-			       FwupdInstallFlags flags,
-			       GError **error)
+fu_nvme_device_write_firmware_stream (FuDevice *device,
+				      GInputStream *stream,
+				      gsize streamsz,
+				      FwupdInstallFlags flags,
+				      GError **error)
 {
 	FuNvmeDevice *self = FU_NVME_DEVICE (device);
-	g_autoptr(GBytes) fw2 = NULL;
-	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
-	guint64 block_size = self->write_block_size > 0 ?
-			     self->write_block_size : 0x1000;
-
-	/* get default image */
-	fw = fu_firmware_get_image_default_bytes (firmware, error);
-	if (fw == NULL)
-		return FALSE;
+	guint32 block_size = fu_nvme_device_get_write_block_size (self);
+	guint32 chunks_cnt = (streamsz + block_size - 1) / block_size;
+	g_autofree guint8 *buf = g_malloc (block_size);
 
-	/* some vendors provide firmware files whose sizes are not multiples
-	 * of blksz *and* the device won't accept blocks of different sizes */
-	if (fu_device_has_custom_flag (device, "force-align")) {
-		fw2 = fu_common_bytes_align (fw, block_size, 0xff);
-	} else {
-		fw2 = g_bytes_ref (fw);
-	}
+	/* write each block as it is read from the payload */
+	g_debug ("using block size 0x%x", block_size);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	for (guint32 i = 0; i < chunks_cnt; i++) {
+		gsize data_sz = 0;
 
-	/* build packets */
-	chunks = fu_chunk_array_new_from_bytes (fw2,
-						0x00,		/* start_addr */
-						0x00,		/* page_sz */
-						block_size);	/* block size */
+		if (!g_input_stream_read_all (stream, buf, block_size,
+					      &data_sz, NULL, error)) {
+			g_prefix_error (error, "failed to read chunk %u: ", i);
+			return FALSE;
+		}
+		if (data_sz == 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "payload ended early at chunk %u", i);
+			return FALSE;
+		}
 
-	/* write each block */
-	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+		/* some vendors provide firmware files whose sizes are not
+		 * multiples of blksz *and* the device won't accept blocks of
+		 * different sizes, so pad just the last block */
+		if (data_sz < block_size &&
+		    fu_device_has_custom_flag (device, "force-align")) {
+			memset (buf + data_sz, 0xff, block_size - data_sz);
+			g_debug ("aligning 0x%x bytes to 0x%x",
+				 (guint) data_sz, (guint) block_size);
+			data_sz = block_size;
+		}
 		if (!fu_nvme_device_fw_download (self,
-						 chk->address,
-						 chk->data,
-						 chk->data_sz,
+						 i * block_size,
+						 buf,
+						 data_sz,
 						 error)) {
 			g_prefix_error (error, "failed to write chunk %u: ", i);
 			return FALSE;
 		}
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len + 1);
+		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks_cnt + 1);
 	}
 
 	/* commit */
@@ -415,7 +457,7 @@ fu_nvme_device_class_init (FuNvmeDeviceClass *klass)
 	klass_device->to_string = fu_nvme_device_to_string;
 	klass_device->set_quirk_kv = fu_nvme_device_set_quirk_kv;
 	klass_device->setup = fu_nvme_device_setup;
-	klass_device->write_firmware = fu_nvme_device_write_firmware;
+	klass_device->write_firmware_stream = fu_nvme_device_write_firmware_stream;
 	klass_udev_device->probe = fu_nvme_device_probe;
 }
 
@@ -14,3 +14,4 @@ G_DECLARE_FINAL_TYPE (FuNvmeDevice, fu_nvme_device, FU, NVME_DEVICE, FuUdevDevic
 FuNvmeDevice	*fu_nvme_device_new_from_blob		(const guint8	*buf,
 							 gsize		 sz,
 							 GError		**error);
+guint32		 fu_nvme_device_get_write_block_size	(FuNvmeDevice	*self);
@@ -33,6 +33,43 @@ fu_nvme_cns_func (void)
 	g_assert_cmpstr (fu_device_get_version (FU_DEVICE (dev)), ==, "410557LA");
 	g_assert_cmpstr (fu_device_get_serial (FU_DEVICE (dev)), ==, "37RSDEADBEEF");
 	g_assert_cmpstr (fu_device_get_guid_default (FU_DEVICE (dev)), ==, "e1409b09-50cf-5aef-8ad8-760b9022f88d");
+	g_assert_cmpint (fu_nvme_device_get_write_block_size (dev), ==, 0x1000);
+}
+
+static void
+fu_nvme_block_size_func (void)
+{
+	gboolean ret;
+	gsize sz;
+	g_autofree gchar *data = NULL;
+	g_autofree gchar *path = NULL;
+	g_autoptr(GError) error = NULL;
+	struct {
+		guint8		 mdts;
+		guint8		 fwug;
+		guint32		 block_size;
+	} values[] = {
+		{ 0x00, 0x00, 0x1000 },		/* no information */
+		{ 0x00, 0xff, 0x20000 },	/* no restrictions */
+		{ 0x03, 0xff, 0x8000 },		/* MDTS only */
+		{ 0x05, 0x03, 0x1e000 },	/* multiple of FWUG */
+		{ 0x01, 0x04, 0x4000 },		/* FWUG larger than MDTS */
+		{ 0x00, 0x00, 0x0 }
+	};
+
+	path = g_build_filename (TESTDATADIR, "TOSHIBA_THNSN5512GPU7.bin", NULL);
+	ret = g_file_get_contents (path, &data, &sz, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (guint i = 0; values[i].block_size != 0x0; i++) {
+		g_autoptr(FuNvmeDevice) dev = NULL;
+		data[77] = values[i].mdts;
+		data[319] = values[i].fwug;
+		dev = fu_nvme_device_new_from_blob ((guint8 *) data, sz, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (dev);
+		g_assert_cmpint (fu_nvme_device_get_write_block_size (dev), ==, values[i].block_size);
+	}
 }
 
 static void
@@ -83,5 +120,6 @@ main (int argc, char **argv)
 	/* tests go here */
 	g_test_add_func ("/fwupd/cns", fu_nvme_cns_func);
 	g_test_add_func ("/fwupd/cns{all}", fu_nvme_cns_all_func);
+	g_test_add_func ("/fwupd/cns{block-size}", fu_nvme_block_size_func);
 	return g_test_run ();
 }
@@ -10,6 +10,7 @@
 #include <glib/gstdio.h>
 #include <string.h>
 
+#include "fu-common.h"
 #include "fu-rom.h"
 
 static void fu_rom_finalize			 (GObject *object);
@@ -71,29 +72,60 @@ fu_rom_kind_to_string (FuRomKind kind)
 	return NULL;
 }
 
-static guint8 *
-fu_rom_pci_strstr (FuRomPciHeader *hdr, const gchar *needle)
+#define FU_ROM_NEEDLES_MAX		32
+
+/* finds the first match of each needle in a single pass over the data, only
+ * comparing where the first byte matches a needle that is not yet found */
+static void
+fu_rom_pci_strstr_multi (FuRomPciHeader *hdr, const gchar **needles, guint8 **matches)
 {
-	gsize needle_len;
 	guint8 *haystack;
 	gsize haystack_len;
-
-	if (needle == NULL || needle[0] == '\0')
-		return NULL;
+	gsize needle_lens[FU_ROM_NEEDLES_MAX] = { 0 };
+	guint32 first_bytes[256] = { 0 };	/* bitmask of needles */
+	guint needles_todo = 0;
+
+	for (guint j = 0; needles[j] != NULL; j++) {
+		g_return_if_fail (j < FU_ROM_NEEDLES_MAX);
+		matches[j] = NULL;
+		needle_lens[j] = strlen (needles[j]);
+		if (needle_lens[j] == 0)
+			continue;
+		first_bytes[(guint8) needles[j][0]] |= 1u << j;
+		needles_todo++;
+	}
 	if (hdr->rom_data == NULL)
-		return NULL;
+		return;
 	if (hdr->data_len > hdr->rom_len)
-		return NULL;
+		return;
 	haystack = &hdr->rom_data[hdr->data_len];
 	haystack_len = hdr->rom_len - hdr->data_len;
-	needle_len = strlen (needle);
-	if (needle_len > haystack_len)
-		return NULL;
-	for (guint i = 0; i < haystack_len - needle_len; i++) {
-		if (memcmp (haystack + i, needle, needle_len) == 0)
-			return &haystack[i];
+	for (gsize i = 0; i < haystack_len && needles_todo > 0; i++) {
+		guint32 mask = first_bytes[haystack[i]];
+		for (guint j = 0; mask != 0; j++, mask >>= 1) {
+			if ((mask & 0x1) == 0)
+				continue;
+			if (needle_lens[j] > haystack_len - i)
+				continue;
+			if (memcmp (haystack + i, needles[j], needle_lens[j]) != 0)
+				continue;
+			matches[j] = &haystack[i];
+			first_bytes[haystack[i]] &= ~(1u << j);
+			needles_todo--;
+		}
 	}
-	return NULL;
+}
+
+static guint8 *
+fu_rom_pci_strstr (FuRomPciHeader *hdr, const gchar *needle)
+{
+	const gchar *needles[] = { needle, NULL };
+	guint8 *matches[1] = { NULL };
+
+	if (needle == NULL)
+		return NULL;
+	fu_rom_pci_strstr_multi (hdr, needles, matches);
+	return matches[0];
 }
 
 static guint
@@ -417,7 +449,7 @@ fu_rom_pci_get_header (guint8 *buffer, guint32 sz)
 	hdr->rom_len = buffer[0x02] * 512;
 
 	/* fix up misreporting */
-	if (hdr->rom_len == 0) {
+	if (hdr->rom_len == 0 || hdr->rom_len > sz) {
 		g_debug ("fixing up last image size");
 		hdr->rom_len = sz;
 	}
@@ -455,24 +487,19 @@ fu_rom_find_version_pci (FuRomPciHeader *hdr)
 static gchar *
 fu_rom_find_version_nvidia (FuRomPciHeader *hdr)
 {
-	gchar *str;
+	const gchar *needles[] = { "Version ", "Vension:", "Version", NULL };
+	guint8 *matches[G_N_ELEMENTS (needles)] = { NULL };
 
 	/* static location for some firmware */
 	if (memcmp (hdr->rom_data + 0x013d, "Version ", 8) == 0)
 		return g_strdup ((gchar *) &hdr->rom_data[0x013d + 8]);
 
-	/* usual search string */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Version ");
-	if (str != NULL)
-		return g_strdup (str + 8);
-
-	/* broken */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Vension:");
-	if (str != NULL)
-		return g_strdup (str + 8);
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Version");
-	if (str != NULL)
-		return g_strdup (str + 7);
+	/* usual search string, then broken */
+	fu_rom_pci_strstr_multi (hdr, needles, matches);
+	for (guint i = 0; needles[i] != NULL; i++) {
+		if (matches[i] != NULL)
+			return g_strdup ((gchar *) matches[i] + strlen (needles[i]));
+	}
 
 	/* fallback to VBIOS */
 	if (memcmp (hdr->rom_data + 0xfa, "VBIOS Ver", 9) == 0)
@@ -483,10 +510,13 @@ fu_rom_find_version_nvidia (FuRomPciHeader *hdr)
 static gchar *
 fu_rom_find_version_intel (FuRomPciHeader *hdr)
 {
+	const gchar *needles[] = { "Build Number:", "VBIOS ", NULL };
+	guint8 *matches[G_N_ELEMENTS (needles)] = { NULL };
 	gchar *str;
 
 	/* 2175_RYan PC 14.34  06/06/2013  21:27:53 */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "Build Number:");
+	fu_rom_pci_strstr_multi (hdr, needles, matches);
+	str = (gchar *) matches[0];
 	if (str != NULL) {
 		g_auto(GStrv) split = NULL;
 		split = g_strsplit (str + 14, " ", -1);
@@ -498,7 +528,7 @@ fu_rom_find_version_intel (FuRomPciHeader *hdr)
 	}
 
 	/* fallback to VBIOS */
-	str = (gchar *) fu_rom_pci_strstr (hdr, "VBIOS ");
+	str = (gchar *) matches[1];
 	if (str != NULL)
 		return g_strdup (str + 6);
 	return NULL;
@@ -507,16 +537,15 @@ fu_rom_find_version_intel (FuRomPciHeader *hdr)
 static gchar *
 fu_rom_find_version_ati (FuRomPciHeader *hdr)
 {
-	gchar *str;
-
-	str = (gchar *) fu_rom_pci_strstr (hdr, " VER0");
-	if (str != NULL)
-		return g_strdup (str + 4);
+	const gchar *needles[] = { " VER0", " VR", NULL };
+	guint8 *matches[G_N_ELEMENTS (needles)] = { NULL };
 
-	/* broken */
-	str = (gchar *) fu_rom_pci_strstr (hdr, " VR");
-	if (str != NULL)
-		return g_strdup (str + 4);
+	/* usual search string, then broken */
+	fu_rom_pci_strstr_multi (hdr, needles, matches);
+	for (guint i = 0; needles[i] != NULL; i++) {
+		if (matches[i] != NULL)
+			return g_strdup ((gchar *) matches[i] + 4);
+	}
 	return NULL;
 }
 
@@ -706,8 +735,27 @@ fu_rom_load_file (FuRom *self, GFile *file, FuRomLoadFlags flags,
 		return FALSE;
 	}
 
-	/* we have to enable the read for devices */
+	/* local images can be mapped rather than copied */
 	fn = g_file_get_path (file);
+	if (fn != NULL && !g_str_has_prefix (fn, "/sys")) {
+		g_autoptr(GBytes) blob = fu_common_get_contents_bytes (fn, error);
+		if (blob == NULL)
+			return FALSE;
+		if (g_bytes_get_size (blob) < 512) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "Firmware too small: %" G_GSIZE_FORMAT " bytes",
+				     g_bytes_get_size (blob));
+			return FALSE;
+		}
+		return fu_rom_load_data (self,
+					 (guint8 *) g_bytes_get_data (blob, NULL),
+					 g_bytes_get_size (blob),
+					 flags, cancellable, error);
+	}
+
+	/* we have to enable the read for devices */
 	if (g_str_has_prefix (fn, "/sys")) {
 		g_autoptr(GFileOutputStream) output_stream = NULL;
 		output_stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE,
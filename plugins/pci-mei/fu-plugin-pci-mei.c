@@ -144,7 +144,7 @@ fu_plugin_udev_device_added (FuPlugin *plugin, FuUdevDevice *device, GError **er
 {
 	FuPluginData *priv = fu_plugin_get_data (plugin);
 	const gchar *fwvers;
-	guint8 buf[4] = { 0x0 };
+	guint8 buf[PCI_CFG_HFS_6 + 4 - PCI_CFG_HFS_1] = { 0x0 };
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
 	/* interesting device? */
@@ -159,37 +159,17 @@ fu_plugin_udev_device_added (FuPlugin *plugin, FuUdevDevice *device, GError **er
 	if (locker == NULL)
 		return FALSE;
 
-	/* grab MEI config registers */
+	/* grab all the MEI config registers in one read */
 	if (!fu_udev_device_pread_full (device, PCI_CFG_HFS_1, buf, sizeof(buf), error)) {
-		g_prefix_error (error, "could not read HFS1: ");
+		g_prefix_error (error, "could not read HFS: ");
 		return FALSE;
 	}
 	priv->hfsts1.data = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
-	if (!fu_udev_device_pread_full (device, PCI_CFG_HFS_2, buf, sizeof(buf), error)) {
-		g_prefix_error (error, "could not read HFS2: ");
-		return FALSE;
-	}
-	priv->hfsts2.data = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
-	if (!fu_udev_device_pread_full (device, PCI_CFG_HFS_3, buf, sizeof(buf), error)) {
-		g_prefix_error (error, "could not read HFS3: ");
-		return FALSE;
-	}
-	priv->hfsts3.data = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
-	if (!fu_udev_device_pread_full (device, PCI_CFG_HFS_4, buf, sizeof(buf), error)) {
-		g_prefix_error (error, "could not read HFS4: ");
-		return FALSE;
-	}
-	priv->hfsts4.data = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
-	if (!fu_udev_device_pread_full (device, PCI_CFG_HFS_5, buf, sizeof(buf), error)) {
-		g_prefix_error (error, "could not read HFS5: ");
-		return FALSE;
-	}
-	priv->hfsts5.data = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
-	if (!fu_udev_device_pread_full (device, PCI_CFG_HFS_6, buf, sizeof(buf), error)) {
-		g_prefix_error (error, "could not read HFS6: ");
-		return FALSE;
-	}
-	priv->hfsts6.data = fu_common_read_uint32 (buf, G_LITTLE_ENDIAN);
+	priv->hfsts2.data = fu_common_read_uint32 (buf + PCI_CFG_HFS_2 - PCI_CFG_HFS_1, G_LITTLE_ENDIAN);
+	priv->hfsts3.data = fu_common_read_uint32 (buf + PCI_CFG_HFS_3 - PCI_CFG_HFS_1, G_LITTLE_ENDIAN);
+	priv->hfsts4.data = fu_common_read_uint32 (buf + PCI_CFG_HFS_4 - PCI_CFG_HFS_1, G_LITTLE_ENDIAN);
+	priv->hfsts5.data = fu_common_read_uint32 (buf + PCI_CFG_HFS_5 - PCI_CFG_HFS_1, G_LITTLE_ENDIAN);
+	priv->hfsts6.data = fu_common_read_uint32 (buf + PCI_CFG_HFS_6 - PCI_CFG_HFS_1, G_LITTLE_ENDIAN);
 	priv->has_device = TRUE;
 
 	/* dump to console */
@@ -117,6 +117,10 @@ fu_plugin_init (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
 	data->client = fu_redfish_client_new ();
+	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_COLDPLUG_THREAD_SAFE,
+			    "only uses the network");
+	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_STARTUP_THREAD_SAFE,
+			    "only uses the network");
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
 }
 
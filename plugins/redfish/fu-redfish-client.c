@@ -31,9 +31,24 @@ struct _FuRedfishClient
 	gboolean		 auth_created;
 	gboolean		 use_https;
 	gboolean		 cacheck;
+	gboolean		 expand_supported;
 	GPtrArray		*devices;
+	GHashTable		*cache;		/* uri_path : FuRedfishClientCacheItem */
 };
 
+typedef struct {
+	gchar			*etag;
+	GBytes			*blob;
+} FuRedfishClientCacheItem;
+
+/* BMCs are typically low-powered, so do not open too many connections */
+#define FU_REDFISH_CLIENT_MAX_CONNS		4
+
+/* backoff when polling a TaskService task, in ms, and the timeout in s */
+#define FU_REDFISH_CLIENT_TASK_DELAY_MIN	1000
+#define FU_REDFISH_CLIENT_TASK_DELAY_MAX	30000
+#define FU_REDFISH_CLIENT_TASK_TIMEOUT		1800
+
 G_DEFINE_TYPE (FuRedfishClient, fu_redfish_client, G_TYPE_OBJECT)
 
 static void
@@ -58,11 +73,22 @@ fu_redfish_client_set_auth (FuRedfishClient *self, SoupURI *uri,
 	}
 }
 
-static GBytes *
-fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+static void
+fu_redfish_client_cache_item_free (FuRedfishClientCacheItem *item)
 {
-	guint status_code;
-	g_autoptr(SoupMessage) msg = NULL;
+	g_free (item->etag);
+	g_bytes_unref (item->blob);
+	g_free (item);
+}
+
+static SoupMessage *
+fu_redfish_client_build_message (FuRedfishClient *self,
+				 const gchar *uri_path,
+				 const gchar *query,
+				 GError **error)
+{
+	FuRedfishClientCacheItem *item;
+	SoupMessage *msg;
 	g_autoptr(SoupURI) uri = NULL;
 
 	/* create URI */
@@ -71,6 +97,8 @@ fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GErr
 	soup_uri_set_path (uri, uri_path);
 	soup_uri_set_host (uri, self->hostname);
 	soup_uri_set_port (uri, self->port);
+	if (query != NULL)
+		soup_uri_set_query (uri, query);
 	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
 	if (msg == NULL) {
 		g_autofree gchar *tmp = soup_uri_to_string (uri, FALSE);
@@ -81,17 +109,135 @@ fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GErr
 		return NULL;
 	}
 	fu_redfish_client_set_auth (self, uri, msg);
-	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_autofree gchar *tmp = soup_uri_to_string (uri, FALSE);
+
+	/* only fetch the body again if it has changed */
+	item = g_hash_table_lookup (self->cache, uri_path);
+	if (item != NULL && query == NULL) {
+		soup_message_headers_append (msg->request_headers,
+					     "If-None-Match", item->etag);
+	}
+	return msg;
+}
+
+static GBytes *
+fu_redfish_client_message_to_blob (FuRedfishClient *self,
+				   SoupMessage *msg,
+				   const gchar *uri_path,
+				   GError **error)
+{
+	const gchar *etag;
+	GBytes *blob;
+
+	/* use the cached copy */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		FuRedfishClientCacheItem *item = g_hash_table_lookup (self->cache, uri_path);
+		if (item != NULL)
+			return g_bytes_ref (item->blob);
+	}
+	if (msg->status_code != SOUP_STATUS_OK) {
+		g_autofree gchar *tmp = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "failed to download %s: %s",
-			     tmp, soup_status_get_phrase (status_code));
+			     tmp, soup_status_get_phrase (msg->status_code));
 		return NULL;
 	}
-	return g_bytes_new (msg->response_body->data, msg->response_body->length);
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+
+	/* save for next time */
+	etag = soup_message_headers_get_one (msg->response_headers, "ETag");
+	if (etag != NULL && soup_message_get_uri (msg)->query == NULL) {
+		FuRedfishClientCacheItem *item = g_new0 (FuRedfishClientCacheItem, 1);
+		item->etag = g_strdup (etag);
+		item->blob = g_bytes_ref (blob);
+		g_hash_table_insert (self->cache, g_strdup (uri_path), item);
+	}
+	return blob;
+}
+
+static GBytes *
+fu_redfish_client_fetch_data_with_query (FuRedfishClient *self,
+					 const gchar *uri_path,
+					 const gchar *query,
+					 GError **error)
+{
+	g_autoptr(SoupMessage) msg = NULL;
+
+	msg = fu_redfish_client_build_message (self, uri_path, query, error);
+	if (msg == NULL)
+		return NULL;
+	soup_session_send_message (self->session, msg);
+	return fu_redfish_client_message_to_blob (self, msg, uri_path, error);
+}
+
+static GBytes *
+fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+{
+	return fu_redfish_client_fetch_data_with_query (self, uri_path, NULL, error);
+}
+
+typedef struct {
+	GMainLoop		*loop;
+	guint			 pending;
+} FuRedfishClientBatchHelper;
+
+static void
+fu_redfish_client_batch_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientBatchHelper *helper = (FuRedfishClientBatchHelper *) user_data;
+	if (--helper->pending == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+/* fetch all the URIs at the same time over a few kept-alive connections,
+ * returning the blobs in the same order */
+static GPtrArray *
+fu_redfish_client_fetch_data_batch (FuRedfishClient *self,
+				    GPtrArray *uri_paths,
+				    GError **error)
+{
+	FuRedfishClientBatchHelper helper = { NULL, 0 };
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	g_autoptr(GPtrArray) blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	g_autoptr(GPtrArray) msgs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	/* create all the messages up-front so errors do not leave requests queued */
+	for (guint i = 0; i < uri_paths->len; i++) {
+		const gchar *uri_path = g_ptr_array_index (uri_paths, i);
+		SoupMessage *msg = fu_redfish_client_build_message (self, uri_path, NULL, error);
+		if (msg == NULL)
+			return NULL;
+		g_ptr_array_add (msgs, msg);
+	}
+	if (msgs->len == 0)
+		return g_steal_pointer (&blobs);
+
+	/* the session runs queued messages in the thread-default context */
+	helper.loop = loop;
+	helper.pending = msgs->len;
+	g_main_context_push_thread_default (context);
+	for (guint i = 0; i < msgs->len; i++) {
+		SoupMessage *msg = g_ptr_array_index (msgs, i);
+		soup_session_queue_message (self->session,
+					    g_object_ref (msg),
+					    fu_redfish_client_batch_cb,
+					    &helper);
+	}
+	g_main_loop_run (loop);
+	g_main_context_pop_thread_default (context);
+
+	/* process results */
+	for (guint i = 0; i < msgs->len; i++) {
+		SoupMessage *msg = g_ptr_array_index (msgs, i);
+		const gchar *uri_path = g_ptr_array_index (uri_paths, i);
+		GBytes *blob = fu_redfish_client_message_to_blob (self, msg, uri_path, error);
+		if (blob == NULL)
+			return NULL;
+		g_ptr_array_add (blobs, blob);
+	}
+	return g_steal_pointer (&blobs);
 }
 
 static gboolean
@@ -148,23 +294,66 @@ fu_redfish_client_coldplug_member (FuRedfishClient *self,
 	return TRUE;
 }
 
+static gboolean
+fu_redfish_client_coldplug_member_blob (FuRedfishClient *self,
+					GBytes *blob,
+					GError **error)
+{
+	JsonNode *node_root;
+	JsonObject *member;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+
+	/* get the member object */
+	if (!json_parser_load_from_data (parser,
+					 g_bytes_get_data (blob, NULL),
+					 (gssize) g_bytes_get_size (blob),
+					 error)) {
+		g_prefix_error (error, "failed to parse node: ");
+		return FALSE;
+	}
+	node_root = json_parser_get_root (parser);
+	if (node_root == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no root node");
+		return FALSE;
+	}
+	member = json_node_get_object (node_root);
+	if (member == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no member object");
+		return FALSE;
+	}
+
+	/* Create the device for the member */
+	return fu_redfish_client_coldplug_member (self, member, error);
+}
+
 static gboolean
 fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 				       JsonObject *collection,
 				       GError **error)
 {
 	JsonArray *members;
-	JsonNode *node_root;
-	JsonObject *member;
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) member_uris = g_ptr_array_new ();
 
 	members = json_object_get_array_member (collection, "Members");
 	for (guint i = 0; i < json_array_get_length (members); i++) {
-		g_autoptr(JsonParser) parser = json_parser_new ();
-		g_autoptr(GBytes) blob = NULL;
 		JsonObject *member_id;
 		const gchar *member_uri;
 
+		/* already expanded by the BMC */
 		member_id = json_array_get_object_element (members, i);
+		if (json_object_has_member (member_id, "Id")) {
+			if (!fu_redfish_client_coldplug_member (self, member_id, error))
+				return FALSE;
+			continue;
+		}
+
 		member_uri = json_object_get_string_member (member_id, "@odata.id");
 		if (member_uri == NULL) {
 			g_set_error_literal (error,
@@ -173,39 +362,16 @@ fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 					     "no @odata.id string");
 			return FALSE;
 		}
+		g_ptr_array_add (member_uris, (gpointer) member_uri);
+	}
 
-		/* try to connect */
-		blob = fu_redfish_client_fetch_data (self, member_uri, error);
-		if (blob == NULL)
-			return FALSE;
-
-		/* get the member object */
-		if (!json_parser_load_from_data (parser,
-						 g_bytes_get_data (blob, NULL),
-						 (gssize) g_bytes_get_size (blob),
-						 error)) {
-			g_prefix_error (error, "failed to parse node: ");
-			return FALSE;
-		}
-		node_root = json_parser_get_root (parser);
-		if (node_root == NULL) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no root node");
-			return FALSE;
-		}
-		member = json_node_get_object (node_root);
-		if (member == NULL) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no member object");
-			return FALSE;
-		}
-
-		/* Create the device for the member */
-		if (!fu_redfish_client_coldplug_member (self, member, error))
+	/* try to connect */
+	blobs = fu_redfish_client_fetch_data_batch (self, member_uris, error);
+	if (blobs == NULL)
+		return FALSE;
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		if (!fu_redfish_client_coldplug_member_blob (self, blob, error))
 			return FALSE;
 	}
 	return TRUE;
@@ -239,8 +405,11 @@ fu_redfish_client_coldplug_inventory (FuRedfishClient *self,
 		return FALSE;
 	}
 
-	/* try to connect */
-	blob = fu_redfish_client_fetch_data (self, collection_uri, error);
+	/* try to connect, getting all the members in one request if possible */
+	blob = fu_redfish_client_fetch_data_with_query (self, collection_uri,
+							self->expand_supported ?
+							"$expand=*($levels=1)" : NULL,
+							error);
 	if (blob == NULL)
 		return FALSE;
 
@@ -289,6 +458,9 @@ fu_redfish_client_coldplug (FuRedfishClient *self, GError **error)
 		return FALSE;
 	}
 
+	/* do not add duplicate devices */
+	g_ptr_array_set_size (self->devices, 0);
+
 	/* try to connect */
 	blob = fu_redfish_client_fetch_data (self, self->update_uri_path, error);
 	if (blob == NULL)
@@ -568,17 +740,149 @@ fu_redfish_client_set_smbios_interfaces (FuRedfishClient *self,
 	return TRUE;
 }
 
+typedef struct {
+	FuDevice		*device;
+	gsize			 done;
+	gsize			 total;
+} FuRedfishClientUploadHelper;
+
+static void
+fu_redfish_client_wrote_body_data_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+{
+	FuRedfishClientUploadHelper *helper = (FuRedfishClientUploadHelper *) user_data;
+	helper->done += chunk->length;
+	fu_device_set_progress_full (helper->device, helper->done, helper->total);
+}
+
+/* poll with exponential backoff until the BMC has applied the update */
+static gboolean
+fu_redfish_client_wait_for_task (FuRedfishClient *self,
+				 FuDevice *device,
+				 const gchar *location,
+				 GError **error)
+{
+	guint delay_ms = FU_REDFISH_CLIENT_TASK_DELAY_MIN;
+	g_autofree gchar *task_path = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* the Location header may be absolute */
+	if (g_str_has_prefix (location, "/")) {
+		task_path = g_strdup (location);
+	} else {
+		g_autoptr(SoupURI) uri = soup_uri_new (location);
+		if (uri == NULL) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "invalid task location %s", location);
+			return FALSE;
+		}
+		task_path = g_strdup (soup_uri_get_path (uri));
+	}
+
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_BUSY);
+	while (g_timer_elapsed (timer, NULL) < FU_REDFISH_CLIENT_TASK_TIMEOUT) {
+		JsonNode *node_root;
+		JsonObject *obj_task;
+		const gchar *task_state;
+		const gchar *task_status = NULL;
+		g_autoptr(JsonParser) parser = json_parser_new ();
+		g_autoptr(SoupMessage) msg = NULL;
+
+		g_usleep (delay_ms * 1000);
+		delay_ms = MIN (delay_ms * 2, FU_REDFISH_CLIENT_TASK_DELAY_MAX);
+
+		msg = fu_redfish_client_build_message (self, task_path, NULL, error);
+		if (msg == NULL)
+			return FALSE;
+		soup_session_send_message (self->session, msg);
+
+		/* task monitors return 202 while running, perhaps without a body */
+		if (msg->status_code == SOUP_STATUS_ACCEPTED &&
+		    msg->response_body->length == 0)
+			continue;
+		if (msg->status_code != SOUP_STATUS_OK &&
+		    msg->status_code != SOUP_STATUS_ACCEPTED) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_WRITE,
+				     "failed to get task %s: %s",
+				     task_path,
+				     soup_status_get_phrase (msg->status_code));
+			return FALSE;
+		}
+		if (!json_parser_load_from_data (parser,
+						 msg->response_body->data,
+						 (gssize) msg->response_body->length,
+						 error)) {
+			g_prefix_error (error, "failed to parse task: ");
+			return FALSE;
+		}
+		node_root = json_parser_get_root (parser);
+		obj_task = node_root != NULL ? json_node_get_object (node_root) : NULL;
+		if (obj_task == NULL ||
+		    !json_object_has_member (obj_task, "TaskState")) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "no TaskState in task");
+			return FALSE;
+		}
+		task_state = json_object_get_string_member (obj_task, "TaskState");
+		if (json_object_has_member (obj_task, "TaskStatus"))
+			task_status = json_object_get_string_member (obj_task, "TaskStatus");
+		if (json_object_has_member (obj_task, "PercentComplete")) {
+			gint64 pc = json_object_get_int_member (obj_task, "PercentComplete");
+			if (pc >= 0 && pc <= 100)
+				fu_device_set_progress (device, (guint) pc);
+		}
+		g_debug ("task %s is %s", task_path, task_state);
+
+		/* finished */
+		if (g_strcmp0 (task_state, "Completed") == 0) {
+			if (g_strcmp0 (task_status, "Critical") == 0) {
+				g_set_error_literal (error,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_WRITE,
+						     "task completed with critical status");
+				return FALSE;
+			}
+			return TRUE;
+		}
+		if (g_strcmp0 (task_state, "Exception") == 0 ||
+		    g_strcmp0 (task_state, "Killed") == 0 ||
+		    g_strcmp0 (task_state, "Cancelled") == 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_WRITE,
+				     "task failed: %s", task_state);
+			return FALSE;
+		}
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_TIMED_OUT,
+		     "task %s did not complete in %us",
+		     task_path, (guint) FU_REDFISH_CLIENT_TASK_TIMEOUT);
+	return FALSE;
+}
+
 gboolean
 fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_fw,
 			  GError **error)
 {
 	FwupdRelease *release;
+	FuRedfishClientUploadHelper helper = { device, 0, 0 };
+	const gchar *location;
+	g_autofree gchar *boundary = NULL;
+	g_autofree gchar *content_type = NULL;
 	g_autofree gchar *filename = NULL;
+	g_autofree gchar *part_header = NULL;
+	g_autofree gchar *part_trailer = NULL;
 
 	guint status_code;
 	g_autoptr(SoupMessage) msg = NULL;
 	g_autoptr(SoupURI) uri = NULL;
-	g_autoptr(SoupMultipart) multipart = NULL;
 	g_autoptr(SoupBuffer) buffer = NULL;
 	g_autofree gchar *uri_str = NULL;
 
@@ -600,16 +904,7 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 	soup_uri_set_host (uri, self->hostname);
 	soup_uri_set_port (uri, self->port);
 	uri_str = soup_uri_to_string (uri, FALSE);
-
-	/* Create the multipart request */
-	multipart = soup_multipart_new (SOUP_FORM_MIME_TYPE_MULTIPART);
-	buffer = soup_buffer_new (SOUP_MEMORY_COPY,
-				  g_bytes_get_data (blob_fw, NULL),
-				  g_bytes_get_size (blob_fw));
-	soup_multipart_append_form_file (multipart, filename, filename,
-					 "application/octet-stream",
-					 buffer);
-	msg = soup_form_request_new_from_multipart (uri_str, multipart);
+	msg = soup_message_new_from_uri (SOUP_METHOD_POST, uri);
 	if (msg == NULL) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -617,9 +912,40 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 			     "failed to create message for URI %s", uri_str);
 		return FALSE;
 	}
+
+	/* create the multipart request around the firmware without copying it,
+	 * freeing each chunk as soon as it has been written */
+	boundary = g_strdup_printf ("fwupd-%08x%08x", g_random_int (), g_random_int ());
+	content_type = g_strdup_printf ("%s; boundary=%s",
+					SOUP_FORM_MIME_TYPE_MULTIPART, boundary);
+	part_header = g_strdup_printf ("--%s\r\n"
+				       "Content-Disposition: form-data; name=\"%s\"; filename=\"%s\"\r\n"
+				       "Content-Type: application/octet-stream\r\n"
+				       "\r\n",
+				       boundary, filename, filename);
+	part_trailer = g_strdup_printf ("\r\n--%s--\r\n", boundary);
+	buffer = soup_buffer_new_with_owner (g_bytes_get_data (blob_fw, NULL),
+					     g_bytes_get_size (blob_fw),
+					     g_bytes_ref (blob_fw),
+					     (GDestroyNotify) g_bytes_unref);
+	soup_message_headers_replace (msg->request_headers, "Content-Type", content_type);
+	soup_message_body_set_accumulate (msg->request_body, FALSE);
+	soup_message_body_append (msg->request_body, SOUP_MEMORY_COPY,
+				  part_header, strlen (part_header));
+	soup_message_body_append_buffer (msg->request_body, buffer);
+	soup_message_body_append (msg->request_body, SOUP_MEMORY_COPY,
+				  part_trailer, strlen (part_trailer));
+
+	/* report real upload progress */
+	helper.total = strlen (part_header) + g_bytes_get_size (blob_fw) + strlen (part_trailer);
+	g_signal_connect (msg, "wrote-body-data",
+			  G_CALLBACK (fu_redfish_client_wrote_body_data_cb), &helper);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+
 	fu_redfish_client_set_auth (self, uri, msg);
 	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
+	if (status_code != SOUP_STATUS_OK &&
+	    status_code != SOUP_STATUS_ACCEPTED) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
@@ -629,6 +955,11 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 		return FALSE;
 	}
 
+	/* the BMC is applying the update in the background */
+	location = soup_message_headers_get_one (msg->response_headers, "Location");
+	if (status_code == SOUP_STATUS_ACCEPTED && location != NULL)
+		return fu_redfish_client_wait_for_task (self, device, location, error);
+
 	return TRUE;
 }
 
@@ -665,6 +996,8 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	user_agent = g_strdup_printf ("%s/%s", PACKAGE_NAME, PACKAGE_VERSION);
 	self->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, user_agent,
 						       SOUP_SESSION_TIMEOUT, 60,
+						       SOUP_SESSION_MAX_CONNS_PER_HOST,
+						       FU_REDFISH_CLIENT_MAX_CONNS,
 						       NULL);
 	if (self->session == NULL) {
 		g_set_error_literal (error,
@@ -744,6 +1077,23 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	g_debug ("UUID:     %s",
 		 json_object_get_string_member (obj_root, "UUID"));
 
+	/* can the BMC return the collection members inline */
+	if (json_object_has_member (obj_root, "ProtocolFeaturesSupported")) {
+		JsonObject *obj_features = json_object_get_object_member (obj_root, "ProtocolFeaturesSupported");
+		if (obj_features != NULL &&
+		    json_object_has_member (obj_features, "ExpandQuery")) {
+			JsonObject *obj_expand = json_object_get_object_member (obj_features, "ExpandQuery");
+			if (obj_expand != NULL &&
+			    json_object_has_member (obj_expand, "ExpandAll") &&
+			    json_object_has_member (obj_expand, "Levels")) {
+				self->expand_supported =
+					json_object_get_boolean_member (obj_expand, "ExpandAll") &&
+					json_object_get_boolean_member (obj_expand, "Levels");
+			}
+		}
+	}
+	g_debug ("Expand:   %s", self->expand_supported ? "yes" : "no");
+
 	if (json_object_has_member (obj_root, "UpdateService"))
 		obj_update_service = json_object_get_object_member (obj_root, "UpdateService");
 	if (obj_update_service == NULL) {
@@ -822,6 +1172,7 @@ fu_redfish_client_finalize (GObject *object)
 	g_free (self->username);
 	g_free (self->password);
 	g_ptr_array_unref (self->devices);
+	g_hash_table_unref (self->cache);
 	G_OBJECT_CLASS (fu_redfish_client_parent_class)->finalize (object);
 }
 
@@ -836,6 +1187,8 @@ static void
 fu_redfish_client_init (FuRedfishClient *self)
 {
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) fu_redfish_client_cache_item_free);
 }
 
 FuRedfishClient *
@@ -17,6 +17,7 @@ struct _FuRts54HubDevice {
 	gboolean			 dual_bank;
 	gboolean			 running_on_flash;
 	guint8				 vendor_cmd;
+	guint32				 block_size;
 };
 
 G_DEFINE_TYPE (FuRts54HubDevice, fu_rts54hub_device, FU_TYPE_USB_DEVICE)
@@ -26,6 +27,7 @@ G_DEFINE_TYPE (FuRts54HubDevice, fu_rts54hub_device, FU_TYPE_USB_DEVICE)
 #define FU_RTS54HUB_DEVICE_TIMEOUT_ERASE		5000	/* ms */
 #define FU_RTS54HUB_DEVICE_TIMEOUT_AUTH			10000	/* ms */
 #define FU_RTS54HUB_DEVICE_BLOCK_SIZE			4096
+#define FU_RTS54HUB_DEVICE_BLOCK_SIZE_MAX		0x8000	/* fits in wLength */
 #define FU_RTS54HUB_DEVICE_STATUS_LEN			25
 
 typedef enum {
@@ -41,6 +43,7 @@ fu_rts54hub_device_to_string (FuDevice *device, guint idt, GString *str)
 	fu_common_string_append_kb (str, idt, "FwAuth", self->fw_auth);
 	fu_common_string_append_kb (str, idt, "DualBank", self->dual_bank);
 	fu_common_string_append_kb (str, idt, "RunningOnFlash", self->running_on_flash);
+	fu_common_string_append_kx (str, idt, "BlockSize", self->block_size);
 }
 
 static gboolean
@@ -86,16 +89,16 @@ fu_rts54hub_device_reset_flash (FuRts54HubDevice *self, GError **error)
 	return TRUE;
 }
 
+/* @datarw is not const as libusb needs a mutable buffer */
 static gboolean
 fu_rts54hub_device_write_flash (FuRts54HubDevice *self,
 				guint32 addr,
-				const guint8 *data,
+				guint8 *datarw,
 				gsize datasz,
 				GError **error)
 {
 	GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
 	gsize actual_len = 0;
-	g_autofree guint8 *datarw = g_memdup (data, datasz);
 	if (!g_usb_device_control_transfer (usb_device,
 					    G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
 					    G_USB_DEVICE_REQUEST_TYPE_VENDOR,
@@ -313,8 +316,11 @@ fu_rts54hub_device_write_firmware (FuDevice *device,
 				   GError **error)
 {
 	FuRts54HubDevice *self = FU_RTS54HUB_DEVICE (device);
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
+	g_autofree guint8 *buf = NULL;
 	g_autoptr(GBytes) fw = NULL;
-	g_autoptr(GPtrArray) chunks = NULL;
 
 	/* get default image */
 	fw = fu_firmware_get_image_default_bytes (firmware, error);
@@ -347,27 +353,25 @@ fu_rts54hub_device_write_firmware (FuDevice *device,
 		return FALSE;
 	}
 
-	/* build packets */
-	chunks = fu_chunk_array_new_from_bytes (fw,
-						0x00,	/* start addr */
-						0x00,	/* page_sz */
-						FU_RTS54HUB_DEVICE_BLOCK_SIZE);
-
-	/* write each block */
+	/* write each block, reusing the same buffer */
+	buf = g_malloc (self->block_size);
+	fu_chunk_iter_init_bytes (&iter, fw,
+				  0x00,	/* start addr */
+				  0x00,	/* page_sz */
+				  self->block_size);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
-
-		/* write chunk */
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		memcpy (buf, chk.data, chk.data_sz);
 		if (!fu_rts54hub_device_write_flash (self,
-						     chk->address,
-						     chk->data,
-						     chk->data_sz,
+						     chk.address,
+						     buf,
+						     chk.data_sz,
 						     error))
 			return FALSE;
 
 		/* update progress */
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len - 1);
+		fu_device_set_progress_full (device, (gsize) chk.idx + 1, (gsize) chunks_cnt);
 	}
 
 	/* get device to authenticate the firmware */
@@ -413,9 +417,36 @@ fu_rts54hub_device_prepare_firmware (FuDevice *device,
 	return fu_firmware_new_from_bytes (fw);
 }
 
+static gboolean
+fu_rts54hub_device_set_quirk_kv (FuDevice *device,
+				 const gchar *key,
+				 const gchar *value,
+				 GError **error)
+{
+	FuRts54HubDevice *self = FU_RTS54HUB_DEVICE (device);
+	if (g_strcmp0 (key, "Rts54BlockSize") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp > 0 && tmp <= FU_RTS54HUB_DEVICE_BLOCK_SIZE_MAX) {
+			self->block_size = tmp;
+			return TRUE;
+		}
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "invalid Rts54BlockSize");
+		return FALSE;
+	}
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "no supported");
+	return FALSE;
+}
+
 static void
 fu_rts54hub_device_init (FuRts54HubDevice *self)
 {
+	self->block_size = FU_RTS54HUB_DEVICE_BLOCK_SIZE;
 	fu_device_set_protocol (FU_DEVICE (self), "com.realtek.rts54");
 	fu_device_set_remove_delay (FU_DEVICE (self), FU_DEVICE_REMOVE_DELAY_RE_ENUMERATE);
 }
@@ -429,5 +460,6 @@ fu_rts54hub_device_class_init (FuRts54HubDeviceClass *klass)
 	klass_device->setup = fu_rts54hub_device_setup;
 	klass_device->to_string = fu_rts54hub_device_to_string;
 	klass_device->prepare_firmware = fu_rts54hub_device_prepare_firmware;
+	klass_device->set_quirk_kv = fu_rts54hub_device_set_quirk_kv;
 	klass_usb_device->close = fu_rts54hub_device_close;
 }
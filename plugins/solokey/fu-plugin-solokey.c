@@ -16,6 +16,8 @@ void
 fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
+	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_INSTALL_THREAD_SAFE,
+			    "each key has its own HID channel");
 	fu_plugin_set_device_gtype (plugin, FU_TYPE_SOLOKEY_DEVICE);
 	fu_plugin_add_firmware_gtype (plugin, "solokey", FU_TYPE_SOLOKEY_FIRMWARE);
 }
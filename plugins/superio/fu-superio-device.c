@@ -63,11 +63,11 @@ fu_superio_device_regwrite (FuSuperioDevice *self, guint8 addr,
 			    guint8 data, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	if (!fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->port, addr, error))
-		return FALSE;
-	if (!fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->port + 1, data, error))
-		return FALSE;
-	return TRUE;
+	const guint8 buf[] = { addr, data };
+
+	/* the data port follows the index port, so write both at once */
+	return fu_udev_device_pwrite_full (FU_UDEV_DEVICE (self), priv->port,
+					   buf, sizeof(buf), error);
 }
 
 static gboolean
@@ -147,17 +147,24 @@ static gboolean
 fu_superio_device_wait_for (FuSuperioDevice *self, guint8 mask, gboolean set, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	g_autoptr(GTimer) timer = g_timer_new ();
+	gint64 deadline = 0;
 	do {
 		guint8 status = 0x00;
 		if (!fu_udev_device_pread (FU_UDEV_DEVICE (self), priv->pm1_iobad1, &status, error))
 			return FALSE;
-		if (g_timer_elapsed (timer, NULL) > FU_PLUGIN_SUPERIO_TIMEOUT)
-			break;
 		if (set && (status & mask) != 0)
 			return TRUE;
 		if (!set && (status & mask) == 0)
 			return TRUE;
+
+		/* the EC is usually ready on the first poll, so only start
+		 * the clock when it is not -- this is called for every byte */
+		if (deadline == 0) {
+			deadline = g_get_monotonic_time () +
+				   FU_PLUGIN_SUPERIO_TIMEOUT * G_USEC_PER_SEC;
+		} else if (g_get_monotonic_time () > deadline) {
+			break;
+		}
 	} while (TRUE);
 	g_set_error (error,
 		     G_IO_ERROR,
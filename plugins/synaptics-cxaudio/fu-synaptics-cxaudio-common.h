@@ -14,6 +14,12 @@
 #define FU_SYNAPTICS_CXAUDIO_OUTPUT_REPORT_SIZE			39
 #define FU_SYNAPTICS_CXAUDIO_USB_TIMEOUT			2000 /* ms */
 
+/* the payload follows the 5 byte header in the output report and the
+ * report ID in the input report */
+#define FU_SYNAPTICS_CXAUDIO_PAYLOAD_MAX			MIN(FU_SYNAPTICS_CXAUDIO_OUTPUT_REPORT_SIZE - 5, \
+								    FU_SYNAPTICS_CXAUDIO_INPUT_REPORT_SIZE - 1)
+#define FU_SYNAPTICS_CXAUDIO_PAYLOAD_MAX_DEFAULT		0x20
+
 /* commands */
 #define FU_SYNAPTICS_CXAUDIO_MEM_WRITEID			0x4
 #define FU_SYNAPTICS_CXAUDIO_MEM_READID				0x5
@@ -29,6 +29,7 @@ struct _FuSynapticsCxaudioDevice
 	guint32			 eeprom_storage_address;
 	guint32			 eeprom_storage_sz;
 	guint32			 eeprom_sz;
+	guint32			 payload_max;
 	guint8			 patch_level;
 };
 
@@ -44,6 +45,7 @@ fu_synaptics_cxaudio_device_to_string (FuDevice *device, guint idt, GString *str
 	fu_common_string_append_kx (str, idt, "EepromStorageAddress", self->eeprom_storage_address);
 	fu_common_string_append_kx (str, idt, "EepromStorageSz", self->eeprom_storage_sz);
 	fu_common_string_append_kx (str, idt, "EepromSz", self->eeprom_sz);
+	fu_common_string_append_kx (str, idt, "PayloadMax", self->payload_max);
 	fu_common_string_append_kb (str, idt, "SwResetSupported", self->sw_reset_supported);
 	fu_common_string_append_kb (str, idt, "SerialNumberSet", self->serial_number_set);
 }
@@ -93,7 +95,6 @@ typedef enum {
 
 typedef enum {
 	FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_NONE		= 0,
-	FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_VERIFY		= (1 << 4),
 } FuSynapticsCxaudioOperationFlags;
 
 static gboolean
@@ -108,7 +109,6 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 {
 	const guint32 idx_read = 0x1;
 	const guint32 idx_write = 0x5;
-	const guint32 payload_max = 0x20;
 	guint32 size = 0x02800;
 	g_autoptr(GPtrArray) chunks = NULL;
 
@@ -139,7 +139,7 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 	}
 
 	/* send to hardware */
-	chunks = fu_chunk_array_new (buf, bufsz, addr, 0x0, payload_max);
+	chunks = fu_chunk_array_new (buf, bufsz, addr, 0x0, self->payload_max);
 	for (guint i = 0; i < chunks->len; i++) {
 		FuChunk *chunk = g_ptr_array_index (chunks, i);
 		guint8 inbuf[FU_SYNAPTICS_CXAUDIO_INPUT_REPORT_SIZE] = { 0 };
@@ -168,34 +168,12 @@ fu_synaptics_cxaudio_device_operation (FuSynapticsCxaudioDevice *self,
 		}
 		if (!fu_synaptics_cxaudio_device_output_report (self, outbuf, sizeof(outbuf), error))
 			return FALSE;
-
-		/* issue additional write directive to read */
-		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_WRITE &&
-		    flags & FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_VERIFY) {
-			outbuf[1] &= ~(1 << 6);
-			if (!fu_synaptics_cxaudio_device_output_report (self, outbuf, sizeof(outbuf), error))
-				return FALSE;
-		}
-		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_READ ||
-		    flags & FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_VERIFY) {
+		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_READ) {
 			if (!fu_synaptics_cxaudio_device_input_report (self,
 							       FU_SYNAPTICS_CXAUDIO_MEM_READID,
 							       inbuf, sizeof(inbuf),
 							       error))
 				return FALSE;
-		}
-		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_WRITE &&
-		    flags & FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_VERIFY) {
-			if (!fu_common_bytes_compare_raw (outbuf + idx_write, payload_max,
-							  inbuf + idx_read, payload_max,
-							  error)) {
-				g_prefix_error (error,
-						"failed to verify on packet %u @0x%x: ",
-						chunk->idx, chunk->address);
-				return FALSE;
-			}
-		}
-		if (operation == FU_SYNAPTICS_CXAUDIO_OPERATION_READ) {
 			if (!fu_memcpy_safe ((guint8 *) chunk->data, chunk->data_sz, 0x0, /* dst */
 					     inbuf, sizeof(inbuf), idx_read, /* src */
 					     chunk->data_sz, error))
@@ -566,6 +544,60 @@ fu_synaptics_cxaudio_device_prepare_firmware (FuDevice *device,
 	return g_steal_pointer (&firmware);
 }
 
+typedef struct {
+	guint32			 addr;
+	GByteArray		*buf;
+} FuSynapticsCxaudioRange;
+
+static void
+fu_synaptics_cxaudio_range_free (FuSynapticsCxaudioRange *range)
+{
+	g_byte_array_unref (range->buf);
+	g_free (range);
+}
+
+/* merge the S3 records into contiguous ranges */
+static GPtrArray *
+fu_synaptics_cxaudio_device_get_ranges (GPtrArray *records)
+{
+	GPtrArray *ranges = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_synaptics_cxaudio_range_free);
+	for (guint i = 0; i < records->len; i++) {
+		FuSrecFirmwareRecord *rcd = g_ptr_array_index (records, i);
+		FuSynapticsCxaudioRange *range = NULL;
+		if (rcd->kind != FU_FIRMWARE_SREC_RECORD_KIND_S3_DATA_32)
+			continue;
+		if (ranges->len > 0)
+			range = g_ptr_array_index (ranges, ranges->len - 1);
+		if (range == NULL || range->addr + range->buf->len != rcd->addr) {
+			range = g_new0 (FuSynapticsCxaudioRange, 1);
+			range->addr = rcd->addr;
+			range->buf = g_byte_array_new ();
+			g_ptr_array_add (ranges, range);
+		}
+		g_byte_array_append (range->buf, rcd->buf->data, rcd->buf->len);
+	}
+	return ranges;
+}
+
+static gboolean
+fu_synaptics_cxaudio_device_verify_range (FuSynapticsCxaudioDevice *self,
+					  FuSynapticsCxaudioRange *range,
+					  GError **error)
+{
+	g_autofree guint8 *buf = g_malloc0 (range->buf->len);
+	if (!fu_synaptics_cxaudio_device_operation (self,
+						    FU_SYNAPTICS_CXAUDIO_OPERATION_READ,
+						    FU_SYNAPTICS_CXAUDIO_MEM_KIND_EEPROM,
+						    range->addr,
+						    buf, range->buf->len,
+						    FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_NONE,
+						    error))
+		return FALSE;
+	return fu_common_bytes_compare_raw (range->buf->data, range->buf->len,
+					    buf, range->buf->len,
+					    error);
+}
+
 static gboolean
 fu_synaptics_cxaudio_device_write_firmware (FuDevice *device,
 					    FuFirmware *firmware,
@@ -575,6 +607,7 @@ fu_synaptics_cxaudio_device_write_firmware (FuDevice *device,
 	FuSynapticsCxaudioDevice *self = FU_SYNAPTICS_CXAUDIO_DEVICE (device);
 	GPtrArray *records = fu_srec_firmware_get_records (FU_SREC_FIRMWARE (firmware));
 	FuSynapticsCxaudioFileKind file_kind;
+	g_autoptr(GPtrArray) ranges = NULL;
 
 	/* check if a patch file fits completely into the EEPROM */
 	for (guint i = 0; i < records->len; i++) {
@@ -628,25 +661,36 @@ fu_synaptics_cxaudio_device_write_firmware (FuDevice *device,
 		g_debug ("initialized layout signature");
 	}
 
-	/* perform the actual write */
+	/* perform the actual write, filling each report with sequential data */
+	ranges = fu_synaptics_cxaudio_device_get_ranges (records);
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	for (guint i = 0; i < records->len; i++) {
-		FuSrecFirmwareRecord *rcd = g_ptr_array_index (records, i);
-		if (rcd->kind != FU_FIRMWARE_SREC_RECORD_KIND_S3_DATA_32)
-			continue;
-		g_debug ("writing @0x%04x len:0x%02x", rcd->addr, rcd->buf->len);
+	for (guint i = 0; i < ranges->len; i++) {
+		FuSynapticsCxaudioRange *range = g_ptr_array_index (ranges, i);
+		g_debug ("writing @0x%04x len:0x%02x", range->addr, range->buf->len);
 		if (!fu_synaptics_cxaudio_device_operation (self,
 							    FU_SYNAPTICS_CXAUDIO_OPERATION_WRITE,
 							    FU_SYNAPTICS_CXAUDIO_MEM_KIND_EEPROM,
-							    rcd->addr,
-							    rcd->buf->data, rcd->buf->len,
-							    FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_VERIFY,
+							    range->addr,
+							    range->buf->data, range->buf->len,
+							    FU_SYNAPTICS_CXAUDIO_OPERATION_FLAG_NONE,
 							    error)) {
 			g_prefix_error (error, "failed to write @0x%04x len:0x%02x: ",
-					rcd->addr, rcd->buf->len);
+					range->addr, range->buf->len);
+			return FALSE;
+		}
+		fu_device_set_progress_full (device, (gsize) i, (gsize) ranges->len);
+	}
+
+	/* read back each range once everything has been written */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	for (guint i = 0; i < ranges->len; i++) {
+		FuSynapticsCxaudioRange *range = g_ptr_array_index (ranges, i);
+		if (!fu_synaptics_cxaudio_device_verify_range (self, range, error)) {
+			g_prefix_error (error, "failed to verify @0x%04x len:0x%02x: ",
+					range->addr, range->buf->len);
 			return FALSE;
 		}
-		fu_device_set_progress_full (device, (gsize) i, (gsize) records->len);
+		fu_device_set_progress_full (device, (gsize) i, (gsize) ranges->len);
 	}
 
 	/* in case of a full FW upgrade invalidate the old FW patch (if any)
@@ -746,6 +790,20 @@ fu_synaptics_cxaudio_device_set_quirk_kv (FuDevice *device,
 		self->eeprom_patch2_valid_addr = fu_common_strtoull (value);
 		return TRUE;
 	}
+	if (g_strcmp0 (key, "PayloadMax") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp == 0 || tmp > FU_SYNAPTICS_CXAUDIO_PAYLOAD_MAX) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_DATA,
+				     "payload size 0x%x invalid, maximum is 0x%x",
+				     (guint) tmp,
+				     (guint) FU_SYNAPTICS_CXAUDIO_PAYLOAD_MAX);
+			return FALSE;
+		}
+		self->payload_max = tmp;
+		return TRUE;
+	}
 	g_set_error_literal (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_SUPPORTED,
@@ -757,6 +815,7 @@ static void
 fu_synaptics_cxaudio_device_init (FuSynapticsCxaudioDevice *self)
 {
 	self->sw_reset_supported = TRUE;
+	self->payload_max = FU_SYNAPTICS_CXAUDIO_PAYLOAD_MAX_DEFAULT;
 	fu_device_add_icon (FU_DEVICE (self), "audio-card");
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_UPDATABLE);
 	fu_device_set_version_format (FU_DEVICE (self), FWUPD_VERSION_FORMAT_PLAIN);
@@ -469,21 +469,42 @@ fu_synaptics_mst_connection_rc_special_get_command (FuSynapticsMstConnection *se
 	return TRUE;
 }
 
+/* only the hub addressed by @self, the upstream hubs must already be enabled */
 gboolean
-fu_synaptics_mst_connection_enable_rc (FuSynapticsMstConnection *self, GError **error)
+fu_synaptics_mst_connection_enable_rc_one (FuSynapticsMstConnection *self, GError **error)
 {
 	const gchar *sc = "PRIUS";
+	if (!fu_synaptics_mst_connection_rc_set_command (self,
+							 UPDC_ENABLE_RC,
+							 5, 0, (guint8*)sc,
+							 error)) {
+		g_prefix_error (error, "failed to enable remote control: ");
+		return FALSE;
+	}
+	return TRUE;
+}
 
+gboolean
+fu_synaptics_mst_connection_disable_rc_one (FuSynapticsMstConnection *self, GError **error)
+{
+	if (!fu_synaptics_mst_connection_rc_set_command (self,
+							 UPDC_DISABLE_RC,
+							 0, 0, NULL,
+							 error)) {
+		g_prefix_error (error, "failed to disable remote control: ");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+fu_synaptics_mst_connection_enable_rc (FuSynapticsMstConnection *self, GError **error)
+{
 	for (gint i = 0; i <= self->layer; i++) {
 		g_autoptr(FuSynapticsMstConnection) connection_tmp = NULL;
 		connection_tmp = fu_synaptics_mst_connection_new (self->fd, i, self->rad);
-		if (!fu_synaptics_mst_connection_rc_set_command (connection_tmp,
-								 UPDC_ENABLE_RC,
-								 5, 0, (guint8*)sc,
-								 error)) {
-			g_prefix_error (error, "failed to enable remote control: ");
+		if (!fu_synaptics_mst_connection_enable_rc_one (connection_tmp, error))
 			return FALSE;
-		}
 	}
 
 	return TRUE;
@@ -495,13 +516,8 @@ fu_synaptics_mst_connection_disable_rc (FuSynapticsMstConnection *self, GError *
 	for (gint i = self->layer; i >= 0; i--) {
 		g_autoptr(FuSynapticsMstConnection) connection_tmp = NULL;
 		connection_tmp = fu_synaptics_mst_connection_new (self->fd, i, self->rad);
-		if (!fu_synaptics_mst_connection_rc_set_command (connection_tmp,
-								 UPDC_DISABLE_RC,
-								 0, 0, NULL,
-								 error)) {
-			g_prefix_error (error, "failed to disable remote control: ");
+		if (!fu_synaptics_mst_connection_disable_rc_one (connection_tmp, error))
 			return FALSE;
-		}
 	}
 
 	return TRUE;
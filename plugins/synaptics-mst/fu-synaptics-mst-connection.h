@@ -103,3 +103,9 @@ gboolean	 fu_synaptics_mst_connection_enable_rc		(FuSynapticsMstConnection *self
 
 gboolean	 fu_synaptics_mst_connection_disable_rc		(FuSynapticsMstConnection *self,
 								 GError **error);
+
+gboolean	 fu_synaptics_mst_connection_enable_rc_one	(FuSynapticsMstConnection *self,
+								 GError **error);
+
+gboolean	 fu_synaptics_mst_connection_disable_rc_one	(FuSynapticsMstConnection *self,
+								 GError **error);
@@ -38,7 +38,8 @@
 #define REG_QUAD_DISABLE		0x200fc0
 #define REG_HDCP22_DISABLE		0x200f90
 
-#define FLASH_SETTLE_TIME		5000000	/* us */
+#define FLASH_SETTLE_TIME		5000	/* ms */
+#define FLASH_SETTLE_POLL		10	/* ms */
 
 struct _FuSynapticsMstDevice {
 	FuUdevDevice		 parent_instance;
@@ -243,6 +244,54 @@ fu_synaptics_mst_device_set_flash_sector_erase (FuSynapticsMstDevice *self,
 	return TRUE;
 }
 
+static gboolean
+fu_synaptics_mst_device_check_erased_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	FuSynapticsMstDevice *self = FU_SYNAPTICS_MST_DEVICE (device);
+	guint32 offset = GPOINTER_TO_UINT (user_data);
+	guint8 buf[16] = { 0x0 };
+	g_autoptr(FuSynapticsMstConnection) connection = NULL;
+
+	connection = fu_synaptics_mst_connection_new (fu_udev_device_get_fd (FU_UDEV_DEVICE (self)),
+						      self->layer, self->rad);
+	if (!fu_synaptics_mst_connection_rc_get_command (connection,
+							 UPDC_READ_FROM_EEPROM,
+							 sizeof(buf), offset, buf,
+							 error)) {
+		g_prefix_error (error, "failed to read flash: ");
+		return FALSE;
+	}
+	for (guint i = 0; i < sizeof(buf); i++) {
+		if (buf[i] != 0xff) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_BUSY,
+				     "flash at 0x%x not yet erased",
+				     offset);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* poll the start of the last sector erased rather than always sleeping for
+ * the worst-case settle time; if it never reads as blank we have still waited
+ * as long as before, and the CRC check will catch a bad write */
+static void
+fu_synaptics_mst_device_wait_for_erase (FuSynapticsMstDevice *self, guint32 offset)
+{
+	g_autoptr(GError) error_local = NULL;
+
+	g_debug ("Waiting for flash clear to settle");
+	if (!fu_device_retry_with_backoff (FU_DEVICE (self),
+					   fu_synaptics_mst_device_check_erased_cb,
+					   FLASH_SETTLE_POLL,
+					   FLASH_SETTLE_TIME,
+					   GUINT_TO_POINTER (offset),
+					   &error_local))
+		g_debug ("ignoring: %s", error_local->message);
+}
+
 static gboolean
 fu_synaptics_mst_device_update_esm (FuSynapticsMstDevice *self,
 				    const guint8 *payload_data,
@@ -291,9 +340,7 @@ fu_synaptics_mst_device_update_esm (FuSynapticsMstDevice *self,
 				return FALSE;
 			}
 		}
-
-		g_debug ("Waiting for flash clear to settle");
-		g_usleep (FLASH_SETTLE_TIME);
+		fu_synaptics_mst_device_wait_for_erase (self, 7 * PAYLOAD_SIZE_64K);
 
 		/* write firmware */
 		for (guint32 i = 0; i < write_loops; i++) {
@@ -352,6 +399,7 @@ fu_synaptics_mst_device_update_tesla_leaf_firmware (FuSynapticsMstDevice *self,
 						    GError **error)
 {
 	g_autoptr(FuSynapticsMstConnection) connection = NULL;
+	guint32 checksum = 0;
 	guint32 data_to_write = 0;
 	guint32 offset = 0;
 	guint32 write_loops = 0;
@@ -362,16 +410,18 @@ fu_synaptics_mst_device_update_tesla_leaf_firmware (FuSynapticsMstDevice *self,
 	if (payload_len % BLOCK_UNIT)
 		write_loops++;
 
+	/* the expected checksum does not change between attempts */
+	for (guint32 i = 0; i < payload_len; i++)
+		checksum += *(payload_data + i);
+
 	connection = fu_synaptics_mst_connection_new (fu_udev_device_get_fd (FU_UDEV_DEVICE (self)),
 						      self->layer, self->rad);
 	for (guint32 retries_cnt = 0; ; retries_cnt++) {
-		guint32 checksum = 0;
 		guint32 flash_checksum = 0;
 
 		if (!fu_synaptics_mst_device_set_flash_sector_erase (self, 0xffff, 0, error))
 			return FALSE;
-		g_debug ("Waiting for flash clear to settle");
-		g_usleep (FLASH_SETTLE_TIME);
+		fu_synaptics_mst_device_wait_for_erase (self, 0x0);
 
 		for (guint32 i = 0; i < write_loops; i++) {
 			g_autoptr(GError) error_local = NULL;
@@ -405,9 +455,6 @@ fu_synaptics_mst_device_update_tesla_leaf_firmware (FuSynapticsMstDevice *self,
 		}
 
 		/* check data just written */
-		for (guint32 i = 0; i < payload_len; i++)
-			checksum += *(payload_data + i);
-
 		if (!fu_synaptics_mst_device_get_flash_checksum (self,
 								 payload_len,
 								 0,
@@ -497,8 +544,10 @@ fu_synaptics_mst_device_update_panamera_firmware (FuSynapticsMstDevice *self,
 	if (fw_size % unit_sz)
 		write_loops++;
 
+	/* used to verify every attempt and for the tag */
+	crc_tmp = fu_synaptics_mst_device_get_crc (0, 16, fw_size, payload_data);
+
 	for (guint32 retries_cnt = 0; ; retries_cnt++) {
-		guint32 checksum = 0;
 		guint32 erase_offset;
 		guint32 flash_checksum = 0;
 		guint32 write_idx;
@@ -512,8 +561,7 @@ fu_synaptics_mst_device_update_panamera_firmware (FuSynapticsMstDevice *self,
 		if (!fu_synaptics_mst_device_set_flash_sector_erase (self,
 								     FLASH_SECTOR_ERASE_64K, erase_offset, error))
 			return FALSE;
-		g_debug ("Waiting for flash clear to settle");
-		g_usleep (FLASH_SETTLE_TIME);
+		fu_synaptics_mst_device_wait_for_erase (self, erase_offset * PAYLOAD_SIZE_64K);
 
 		/* write */
 		write_idx = 0;
@@ -549,7 +597,6 @@ fu_synaptics_mst_device_update_panamera_firmware (FuSynapticsMstDevice *self,
 		}
 
 		/* verify CRC */
-		checksum = fu_synaptics_mst_device_get_crc (0, 16, fw_size, payload_data );
 		for (guint32 i = 0; i < 4; i++) {
 			g_usleep (1000);	/* wait crc calculation */
 			if (!fu_synaptics_mst_connection_rc_special_get_command (connection,
@@ -560,8 +607,10 @@ fu_synaptics_mst_device_update_panamera_firmware (FuSynapticsMstDevice *self,
 				g_prefix_error (error, "Failed to get flash checksum: ");
 				return FALSE;
 			}
+			if (crc_tmp == flash_checksum)
+				break;
 		}
-		if (checksum == flash_checksum)
+		if (crc_tmp == flash_checksum)
 			break;
 		if (retries_cnt > MAX_RETRY_COUNTS) {
 			g_set_error_literal (error,
@@ -582,7 +631,6 @@ fu_synaptics_mst_device_update_panamera_firmware (FuSynapticsMstDevice *self,
 	tagData[1] = pTM->tm_mon + 1;
 	tagData[2] = pTM->tm_mday;
 	tagData[3] = pTM->tm_year + 1900 - 2000;
-	crc_tmp = fu_synaptics_mst_device_get_crc (0, 16, fw_size, payload_data);
 	tagData[0] = bank_to_update;
 	tagData[4] = (crc_tmp >> 8) & 0xff;
 	tagData[5] = crc_tmp & 0xff;
@@ -928,9 +976,12 @@ fu_synaptics_mst_device_read_board_id (FuSynapticsMstDevice *self,
 	return TRUE;
 }
 
+/* remote control must already be enabled on every hub down to @layer */
 static gboolean
 fu_synaptics_mst_device_scan_cascade (FuSynapticsMstDevice *self, guint8 layer, GError **error)
 {
+	gint fd = fu_udev_device_get_fd (FU_UDEV_DEVICE (self));
+
 	/* in test mode we skip this */
 	if (fu_udev_device_get_dev (FU_UDEV_DEVICE (self)) == NULL)
 		return TRUE;
@@ -938,40 +989,27 @@ fu_synaptics_mst_device_scan_cascade (FuSynapticsMstDevice *self, guint8 layer,
 	/* test each relative address in this layer */
 	for (guint16 rad = 0; rad <= 2; rad++) {
 		guint8 byte[4];
-		g_autoptr(FuDeviceLocker) locker = NULL;
 		g_autoptr(FuSynapticsMstConnection) connection = NULL;
-		g_autoptr(FuSynapticsMstDevice) device_tmp = NULL;
 		g_autoptr(GError) error_local = NULL;
 
-		/* enable remote control and disable on exit */
-		device_tmp = fu_synaptics_mst_device_new (FU_UDEV_DEVICE (self));
-		device_tmp->layer = layer;
-		device_tmp->rad = rad;
-		locker = fu_device_locker_new_full (device_tmp,
-						    (FuDeviceLockerFunc) fu_synaptics_mst_device_enable_rc,
-						    (FuDeviceLockerFunc) fu_synaptics_mst_device_disable_rc,
-						    &error_local);
-		if (locker == NULL) {
-			g_debug ("no cascade device found: %s", error_local->message);
-			continue;
-		}
-		connection = fu_synaptics_mst_connection_new (fu_udev_device_get_fd (FU_UDEV_DEVICE (self)),
-							      layer + 1, rad);
+		connection = fu_synaptics_mst_connection_new (fd, layer + 1, rad);
 		if (!fu_synaptics_mst_connection_read (connection, REG_RC_CAP, byte, 1, &error_local)) {
 			g_debug ("no valid cascade device: %s", error_local->message);
 			continue;
 		}
-
-		/* check recursively for more devices */
-		if (!fu_device_locker_close (locker, &error_local)) {
-			g_debug ("failed to close parent: %s", error_local->message);
-			continue;
-		}
 		self->mode = FU_SYNAPTICS_MST_MODE_REMOTE;
 		self->layer = layer + 1;
 		self->rad = rad;
+
+		/* check recursively for more devices, reusing the parent session */
+		if (!fu_synaptics_mst_connection_enable_rc_one (connection, &error_local)) {
+			g_debug ("no cascade device found: %s", error_local->message);
+			continue;
+		}
 		if (!fu_synaptics_mst_device_scan_cascade (self, layer + 1, error))
 			return FALSE;
+		if (!fu_synaptics_mst_connection_disable_rc_one (connection, &error_local))
+			g_debug ("failed to close cascade device: %s", error_local->message);
 	}
 	return TRUE;
 }
@@ -1073,13 +1111,14 @@ fu_synaptics_mst_device_rescan (FuDevice *device, GError **error)
 			return FALSE;
 	}
 
-	/* recursively look for cascade devices */
+	/* recursively look for cascade devices while the root is still in
+	 * remote control mode */
+	if (!fu_synaptics_mst_device_scan_cascade (self, 0, error))
+		return FALSE;
 	if (!fu_device_locker_close (locker, error)) {
 		g_prefix_error (error, "failed to close parent: ");
 		return FALSE;
 	}
-	if (!fu_synaptics_mst_device_scan_cascade (self, 0, error))
-		return FALSE;
 
 	/* set up the device name via quirks */
 	group = g_strdup_printf ("SynapticsMSTBoardID=%u", self->board_id);
@@ -229,14 +229,16 @@ fu_synaprom_device_setup (FuDevice *device, GError **error)
 
 static gboolean
 fu_synaprom_device_cmd_download_chunk (FuSynapromDevice *device,
-				       const GByteArray *chunk,
+				       GByteArray *request,
+				       GByteArray *reply,
+				       const guint8 *buf,
+				       gsize bufsz,
 				       GError **error)
 {
-	g_autoptr(GByteArray) request = NULL;
-	g_autoptr(GByteArray) reply = NULL;
-	request = fu_synaprom_request_new (FU_SYNAPROM_CMD_BOOTLDR_PATCH,
-					   chunk->data, chunk->len);
-	reply = fu_synaprom_reply_new (sizeof(FuSynapromReplyGeneric));
+	/* the request is reused for every chunk to avoid reallocating */
+	g_byte_array_set_size (request, 0);
+	fu_byte_array_append_uint8 (request, FU_SYNAPROM_CMD_BOOTLDR_PATCH);
+	g_byte_array_append (request, buf, bufsz);
 	return fu_synaprom_device_cmd_send (device, request, reply, 20000, error);
 }
 
@@ -294,6 +296,8 @@ fu_synaprom_device_write_fw (FuSynapromDevice *self, GBytes *fw, GError **error)
 {
 	const guint8 *buf;
 	gsize sz = 0;
+	g_autoptr(GByteArray) request = g_byte_array_new ();
+	g_autoptr(GByteArray) reply = fu_synaprom_reply_new (sizeof(FuSynapromReplyGeneric));
 
 	/* write chunks */
 	fu_device_set_progress (FU_DEVICE (self), 10);
@@ -301,7 +305,6 @@ fu_synaprom_device_write_fw (FuSynapromDevice *self, GBytes *fw, GError **error)
 	buf = g_bytes_get_data (fw, &sz);
 	while (sz != 0) {
 		guint32 chunksz;
-		g_autoptr(GByteArray) chunk = g_byte_array_new ();
 
 		/* get chunk size */
 		if (sz < sizeof(guint32)) {
@@ -323,8 +326,8 @@ fu_synaprom_device_write_fw (FuSynapromDevice *self, GBytes *fw, GError **error)
 		}
 
 		/* download chunk */
-		g_byte_array_append (chunk, buf, chunksz);
-		if (!fu_synaprom_device_cmd_download_chunk (self, chunk, error))
+		if (!fu_synaprom_device_cmd_download_chunk (self, request, reply,
+							    buf, chunksz, error))
 			return FALSE;
 
 		/* next chunk */
@@ -708,9 +708,11 @@ fu_synaptics_rmi_device_poll_wait (FuSynapticsRmiDevice *self, GError **error)
 {
 	g_autoptr(GError) error_local = NULL;
 
-	/* try to poll every 20ms for up to 400ms */
-	for (guint i = 0; i < 20; i++) {
-		g_usleep (1000 * 20);
+	/* the command has usually completed by the time we get the attention
+	 * report, so try right away and then every 20ms for up to 400ms */
+	for (guint i = 0; i <= 20; i++) {
+		if (i > 0)
+			g_usleep (1000 * 20);
 		g_clear_error (&error_local);
 		if (fu_synaptics_rmi_device_poll (self, &error_local))
 			return TRUE;
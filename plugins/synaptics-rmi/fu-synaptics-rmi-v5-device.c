@@ -128,11 +128,14 @@ fu_synaptics_rmi_v5_device_write_firmware (FuDevice *device,
 	FuSynapticsRmiDevice *self = FU_SYNAPTICS_RMI_DEVICE (device);
 	FuSynapticsRmiFlash *flash = fu_synaptics_rmi_device_get_flash (self);
 	FuSynapticsRmiFunction *f34;
+	FuChunk chk;
+	FuChunkIter iter_bin;
+	FuChunkIter iter_cfg;
 	guint32 address;
+	guint32 chunks_bin_cnt;
+	guint32 chunks_cfg_cnt;
 	g_autoptr(GBytes) bytes_bin = NULL;
 	g_autoptr(GBytes) bytes_cfg = NULL;
-	g_autoptr(GPtrArray) chunks_bin = NULL;
-	g_autoptr(GPtrArray) chunks_cfg = NULL;
 	g_autoptr(GByteArray) req_addr = g_byte_array_new ();
 
 	/* we should be in bootloader mode now, but check anyway */
@@ -197,27 +200,28 @@ fu_synaptics_rmi_v5_device_write_firmware (FuDevice *device,
 		address = f34->data_base + RMI_F34_BLOCK_DATA_V1_OFFSET;
 	else
 		address = f34->data_base + RMI_F34_BLOCK_DATA_OFFSET;
-	chunks_bin = fu_chunk_array_new_from_bytes (bytes_bin,
-						    0x00,	/* start addr */
-						    0x00,	/* page_sz */
-						    flash->block_size);
-	chunks_cfg = fu_chunk_array_new_from_bytes (bytes_cfg,
-						    0x00,	/* start addr */
-						    0x00,	/* page_sz */
-						    flash->block_size);
-	for (guint i = 0; i < chunks_bin->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks_bin, i);
+	fu_chunk_iter_init_bytes (&iter_bin, bytes_bin,
+				  0x00,	/* start addr */
+				  0x00,	/* page_sz */
+				  flash->block_size);
+	fu_chunk_iter_init_bytes (&iter_cfg, bytes_cfg,
+				  0x00,	/* start addr */
+				  0x00,	/* page_sz */
+				  flash->block_size);
+	chunks_bin_cnt = fu_chunk_iter_get_count (&iter_bin);
+	chunks_cfg_cnt = fu_chunk_iter_get_count (&iter_cfg);
+	while (fu_chunk_iter_next (&iter_bin, &chk)) {
 		if (!fu_synaptics_rmi_v5_device_write_block (self,
 							     RMI_F34_WRITE_FW_BLOCK,
 							     address,
-							     chk->data,
-							     chk->data_sz,
+							     chk.data,
+							     chk.data_sz,
 							     error)) {
-			g_prefix_error (error, "failed to write bin block %u: ", chk->idx);
+			g_prefix_error (error, "failed to write bin block %u: ", chk.idx);
 			return FALSE;
 		}
-		fu_device_set_progress_full (device, (gsize) i,
-					     (gsize) chunks_bin->len + chunks_cfg->len);
+		fu_device_set_progress_full (device, (gsize) chk.idx,
+					     (gsize) chunks_bin_cnt + chunks_cfg_cnt);
 	}
 
 	/* program the configuration image */
@@ -225,20 +229,19 @@ fu_synaptics_rmi_v5_device_write_firmware (FuDevice *device,
 		g_prefix_error (error, "failed to 2nd write address zero: ");
 		return FALSE;
 	}
-	for (guint i = 0; i < chunks_cfg->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks_cfg, i);
+	while (fu_chunk_iter_next (&iter_cfg, &chk)) {
 		if (!fu_synaptics_rmi_v5_device_write_block (self,
 							     RMI_F34_WRITE_CONFIG_BLOCK,
 							     address,
-							     chk->data,
-							     chk->data_sz,
+							     chk.data,
+							     chk.data_sz,
 							     error)) {
-			g_prefix_error (error, "failed to write cfg block %u: ", chk->idx);
+			g_prefix_error (error, "failed to write cfg block %u: ", chk.idx);
 			return FALSE;
 		}
 		fu_device_set_progress_full (device,
-					     (gsize) chunks_bin->len + i,
-					     (gsize) chunks_bin->len + chunks_cfg->len);
+					     (gsize) chunks_bin_cnt + chk.idx,
+					     (gsize) chunks_bin_cnt + chunks_cfg_cnt);
 	}
 
 	/* success */
@@ -151,9 +151,8 @@ fu_synaptics_rmi_v7_device_erase_all (FuSynapticsRmiDevice *self, GError **error
 		g_prefix_error (error, "failed to unlock erasing: ");
 		return FALSE;
 	}
-	g_usleep (1000 * 100);
 	if (flash->bootloader_id[1] == 8){
-		/* wait for ATTN */
+		/* wait for ATTN, which is queued if it arrives early */
 		if (!fu_synaptics_rmi_device_wait_for_idle (self,
 							    RMI_F34_ERASE_WAIT_MS,
 							    RMI_DEVICE_WAIT_FOR_IDLE_FLAG_NONE,
@@ -161,6 +160,8 @@ fu_synaptics_rmi_v7_device_erase_all (FuSynapticsRmiDevice *self, GError **error
 			g_prefix_error (error, "failed to wait for idle: ");
 			return FALSE;
 		}
+	} else {
+		g_usleep (1000 * 100);
 	}
 	if (!fu_synaptics_rmi_device_poll_wait (self, error)) {
 		g_prefix_error (error, "failed to get flash success: ");
@@ -185,7 +186,6 @@ fu_synaptics_rmi_v7_device_erase_all (FuSynapticsRmiDevice *self, GError **error
 		}
 
 		/* wait for ATTN */
-		g_usleep (1000 * 100);
 		if (!fu_synaptics_rmi_device_wait_for_idle (self,
 							    RMI_F34_ERASE_WAIT_MS,
 							    RMI_DEVICE_WAIT_FOR_IDLE_FLAG_REFRESH_F34,
@@ -209,19 +209,19 @@ fu_synaptics_rmi_v7_device_write_blocks (FuSynapticsRmiDevice *self,
 					 GError **error)
 {
 	FuSynapticsRmiFlash *flash = fu_synaptics_rmi_device_get_flash (self);
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunkIter iter;
 
 	/* write FW blocks */
-	chunks = fu_chunk_array_new (data, datasz,
-				     0x00,	/* start addr */
-				     0x00,	/* page_sz */
-				     flash->block_size);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init (&iter, data, datasz,
+			    0x00,	/* start addr */
+			    0x00,	/* page_sz */
+			    flash->block_size);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_autoptr(GByteArray) req = g_byte_array_new ();
-		g_byte_array_append (req, chk->data, chk->data_sz);
+		g_byte_array_append (req, chk.data, chk.data_sz);
 		if (!fu_synaptics_rmi_device_write (self, address, req, error)) {
-			g_prefix_error (error, "failed to write block @0x%x:%x ", address, chk->address);
+			g_prefix_error (error, "failed to write block @0x%x:%x ", address, chk.address);
 			return FALSE;
 		}
 	}
@@ -249,7 +249,9 @@ fu_synaptics_rmi_v7_device_write_partition (FuSynapticsRmiDevice *self,
 	FuSynapticsRmiFlash *flash = fu_synaptics_rmi_device_get_flash (self);
 	g_autoptr(GByteArray) req_offset = g_byte_array_new ();
 	g_autoptr(GByteArray) req_partition_id = g_byte_array_new ();
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 
 	/* f34 */
 	f34 = fu_synaptics_rmi_device_get_function (self, 0x34, error);
@@ -277,17 +279,17 @@ fu_synaptics_rmi_v7_device_write_partition (FuSynapticsRmiDevice *self,
 	}
 
 	/* write partition */
-	chunks = fu_chunk_array_new_from_bytes (bytes,
-						0x00,	/* start addr */
-						0x00,	/* page_sz */
-						(gsize) flash->payload_length *
-						(gsize) flash->block_size);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	fu_chunk_iter_init_bytes (&iter, bytes,
+				  0x00,	/* start addr */
+				  0x00,	/* page_sz */
+				  (gsize) flash->payload_length *
+				  (gsize) flash->block_size);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		g_autoptr(GByteArray) req_trans_sz = g_byte_array_new ();
 		g_autoptr(GByteArray) req_cmd = g_byte_array_new ();
 		fu_byte_array_append_uint16 (req_trans_sz,
-					     chk->data_sz / flash->block_size,
+					     chk.data_sz / flash->block_size,
 					     G_LITTLE_ENDIAN);
 		if (!fu_synaptics_rmi_device_write (self,
 						    f34->data_base + 0x3,
@@ -306,11 +308,11 @@ fu_synaptics_rmi_v7_device_write_partition (FuSynapticsRmiDevice *self,
 		}
 		if (!fu_synaptics_rmi_v7_device_write_blocks (self,
 							      f34->data_base + 0x5,
-							      chk->data,
-							      chk->data_sz,
+							      chk.data,
+							      chk.data_sz,
 							      error))
 			return FALSE;
-		fu_device_set_progress_full (FU_DEVICE (self), (gsize) i, (gsize) chunks->len);
+		fu_device_set_progress_full (FU_DEVICE (self), (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return TRUE;
 }
@@ -327,6 +329,7 @@ fu_synaptics_rmi_v7_device_write_firmware (FuDevice *device,
 	g_autoptr(GBytes) bytes_bin = NULL;
 	g_autoptr(GBytes) bytes_cfg = NULL;
 	g_autoptr(GBytes) bytes_flashcfg = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* we should be in bootloader mode now, but check anyway */
 	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_IS_BOOTLOADER)) {
@@ -365,29 +368,37 @@ fu_synaptics_rmi_v7_device_write_firmware (FuDevice *device,
 		g_prefix_error (error, "failed to erase all: ");
 		return FALSE;
 	}
+	g_debug ("erase took %.0fms", g_timer_elapsed (timer, NULL) * 1000.f);
 
 	/* write flash config for v8 */
 	if (bytes_flashcfg != NULL) {
+		g_timer_reset (timer);
 		if (!fu_synaptics_rmi_v7_device_write_partition (self,
 								 RMI_PARTITION_ID_FLASH_CONFIG,
 								 bytes_flashcfg,
 								 error))
 			return FALSE;
+		g_debug ("write flash config took %.0fms",
+			 g_timer_elapsed (timer, NULL) * 1000.f);
 	}
 
 	/* write core code */
+	g_timer_reset (timer);
 	if (!fu_synaptics_rmi_v7_device_write_partition (self,
 							 RMI_PARTITION_ID_CORE_CODE,
 							 bytes_bin,
 							 error))
 		return FALSE;
+	g_debug ("write core code took %.0fms", g_timer_elapsed (timer, NULL) * 1000.f);
 
 	/* write core config */
+	g_timer_reset (timer);
 	if (!fu_synaptics_rmi_v7_device_write_partition (self,
 							 RMI_PARTITION_ID_CORE_CONFIG,
 							 bytes_cfg,
 							 error))
 		return FALSE;
+	g_debug ("write core config took %.0fms", g_timer_elapsed (timer, NULL) * 1000.f);
 
 	/* success */
 	return TRUE;
@@ -11,13 +11,35 @@
 
 struct FuPluginData {
 	GMutex			 mutex;
+	guint			 synthetic_count;
+	guint			 synthetic_depth;
+	guint			 synthetic_guids;
+	guint			 synthetic_poll_interval;	/* ms */
+	guint			 synthetic_write_speed;		/* KiB/s */
+	guint			 synthetic_replug_delay;	/* ms */
 };
 
+static guint
+fu_plugin_test_get_config_uint (FuPlugin *plugin, const gchar *key, guint value_default)
+{
+	g_autofree gchar *tmp = fu_plugin_get_config_value (plugin, key);
+	if (tmp == NULL)
+		return value_default;
+	return (guint) fu_common_strtoull (tmp);
+}
+
 void
 fu_plugin_init (FuPlugin *plugin)
 {
+	FuPluginData *data;
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
-	fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	data = fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	data->synthetic_count = fu_plugin_test_get_config_uint (plugin, "SyntheticDevices", 0);
+	data->synthetic_depth = MAX (fu_plugin_test_get_config_uint (plugin, "SyntheticDepth", 1), 1);
+	data->synthetic_guids = MAX (fu_plugin_test_get_config_uint (plugin, "SyntheticGuids", 1), 1);
+	data->synthetic_poll_interval = fu_plugin_test_get_config_uint (plugin, "SyntheticPollInterval", 0);
+	data->synthetic_write_speed = fu_plugin_test_get_config_uint (plugin, "SyntheticWriteSpeed", 0);
+	data->synthetic_replug_delay = fu_plugin_test_get_config_uint (plugin, "SyntheticReplugDelay", 0);
 	g_debug ("init");
 }
 
@@ -28,9 +50,59 @@ fu_plugin_destroy (FuPlugin *plugin)
 	g_debug ("destroy");
 }
 
+static FuDevice *
+fu_plugin_test_synthetic_device_new (FuPluginData *data, guint idx)
+{
+	FuDevice *device = fu_device_new ();
+	g_autofree gchar *logical_id = g_strdup_printf ("synthetic-%05u", idx);
+	g_autofree gchar *name = g_strdup_printf ("Synthetic Device %u", idx);
+
+	fu_device_set_physical_id (device, "synthetic");
+	fu_device_set_logical_id (device, logical_id);
+	for (guint i = 0; i < data->synthetic_guids; i++) {
+		g_autofree gchar *instance_id = NULL;
+		instance_id = g_strdup_printf ("TEST\\SYNTHETIC_%05u&GUID_%02u", idx, i);
+		fu_device_add_instance_id (device, instance_id);
+	}
+	fu_device_convert_instance_ids (device);
+	fu_device_set_name (device, name);
+	fu_device_set_vendor_id (device, "USB:0xFFFF");
+	fu_device_set_protocol (device, "com.acme.test");
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, "1.2.2");
+	fu_device_set_metadata_boolean (device, "Synthetic", TRUE);
+	if (data->synthetic_poll_interval > 0)
+		fu_device_set_poll_interval (device, data->synthetic_poll_interval);
+	return device;
+}
+
+/* creates chains of devices SyntheticDepth long, which are added when
+ * the root device is added */
+static void
+fu_plugin_test_coldplug_synthetic (FuPlugin *plugin)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	FuDevice *parent = NULL;
+	g_autoptr(GPtrArray) roots = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	for (guint i = 0; i < data->synthetic_count; i++) {
+		g_autoptr(FuDevice) device = fu_plugin_test_synthetic_device_new (data, i);
+		if (i % data->synthetic_depth == 0)
+			g_ptr_array_add (roots, g_object_ref (device));
+		else
+			fu_device_add_child (parent, device);
+		parent = device;
+	}
+	for (guint i = 0; i < roots->len; i++)
+		fu_plugin_device_add (plugin, g_ptr_array_index (roots, i));
+	g_debug ("added %u synthetic devices", data->synthetic_count);
+}
+
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
+	FuPluginData *data = fu_plugin_get_data (plugin);
 	g_autoptr(FuDevice) device = NULL;
 	device = fu_device_new ();
 	fu_device_set_id (device, "FakeDevice");
@@ -91,6 +163,10 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 
 	}
 
+	/* for benchmarking the daemon with a large inventory */
+	if (data->synthetic_count > 0)
+		fu_plugin_test_coldplug_synthetic (plugin);
+
 	return TRUE;
 }
 
@@ -141,6 +217,34 @@ fu_plugin_test_get_version (GBytes *blob_fw)
 	return fu_common_version_from_uint32 (val, FWUPD_VERSION_FORMAT_TRIPLET);
 }
 
+/* sleeps for as long as the configured device would take to write and
+ * re-enumerate, so that install scheduling can be measured */
+static gboolean
+fu_plugin_test_update_synthetic (FuPlugin *plugin,
+				 FuDevice *device,
+				 GBytes *blob_fw,
+				 GError **error)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autofree gchar *ver = fu_plugin_test_get_version (blob_fw);
+
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	if (data->synthetic_write_speed > 0) {
+		guint64 duration_us = (guint64) g_bytes_get_size (blob_fw) *
+				      G_USEC_PER_SEC / ((guint64) data->synthetic_write_speed * 1024);
+		for (guint i = 1; i <= 100; i++) {
+			g_usleep (duration_us / 100);
+			fu_device_set_progress (device, i);
+		}
+	}
+	if (data->synthetic_replug_delay > 0) {
+		fu_device_set_status (device, FWUPD_STATUS_DEVICE_RESTART);
+		g_usleep ((gulong) data->synthetic_replug_delay * 1000);
+	}
+	fu_device_set_version (device, ver != NULL ? ver : "1.2.3");
+	return TRUE;
+}
+
 gboolean
 fu_plugin_update (FuPlugin *plugin,
 		  FuDevice *device,
@@ -150,6 +254,8 @@ fu_plugin_update (FuPlugin *plugin,
 {
 	const gchar *test = g_getenv ("FWUPD_PLUGIN_TEST");
 	gboolean requires_activation = g_strcmp0 (test, "requires-activation") == 0;
+	if (fu_device_get_metadata_boolean (device, "Synthetic"))
+		return fu_plugin_test_update_synthetic (plugin, device, blob_fw, error);
 	if (g_strcmp0 (test, "fail") == 0) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
@@ -71,6 +71,101 @@ fu_plugin_device_registered (FuPlugin *plugin, FuDevice *device)
 	}
 }
 
+static gint
+fu_plugin_thunderbolt_device_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuThunderboltDevice *device1 = *((FuThunderboltDevice **) a);
+	FuThunderboltDevice *device2 = *((FuThunderboltDevice **) b);
+	gboolean host1 = fu_thunderbolt_device_is_host_controller (device1);
+	gboolean host2 = fu_thunderbolt_device_is_host_controller (device2);
+	if (host1 == host2)
+		return 0;
+	return host1 ? 1 : -1;
+}
+
+static GPtrArray *
+fu_plugin_thunderbolt_get_devices (GPtrArray *devices)
+{
+	GPtrArray *devices_tbt = g_ptr_array_new ();
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fu_device_get_plugin (dev), "thunderbolt") != 0)
+			continue;
+		if (!FU_IS_THUNDERBOLT_DEVICE (dev))
+			continue;
+		g_ptr_array_add (devices_tbt, dev);
+	}
+	return devices_tbt;
+}
+
+gboolean
+fu_plugin_composite_prepare (FuPlugin *plugin,
+			     GPtrArray *devices,
+			     GError **error)
+{
+	g_autoptr(GPtrArray) devices_tbt = fu_plugin_thunderbolt_get_devices (devices);
+	g_autoptr(GPtrArray) devices_batch = g_ptr_array_new ();
+
+	/* the OS finishes these updates later */
+	for (guint i = 0; i < devices_tbt->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices_tbt, i);
+		if (!fu_device_has_flag (dev, FWUPD_DEVICE_FLAG_SKIPS_RESTART))
+			g_ptr_array_add (devices_batch, dev);
+	}
+
+	/* write all the images, and then authenticate them together so that
+	 * each reset does not wait for the one before */
+	if (devices_batch->len > 1) {
+		for (guint i = 0; i < devices_batch->len; i++) {
+			FuThunderboltDevice *dev = g_ptr_array_index (devices_batch, i);
+			fu_thunderbolt_device_set_authenticate_deferred (dev, TRUE);
+		}
+		return TRUE;
+	}
+
+	/* authenticating resets the device, and so it cannot be installed in
+	 * a worker thread while the hotplug events are deferred */
+	for (guint i = 0; i < devices_batch->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices_batch, i);
+		if (!fu_device_has_flag (dev, FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE))
+			fu_device_add_flag (dev, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
+	}
+	return TRUE;
+}
+
+gboolean
+fu_plugin_composite_cleanup (FuPlugin *plugin,
+			     GPtrArray *devices,
+			     GError **error)
+{
+	g_autoptr(GPtrArray) devices_tbt = fu_plugin_thunderbolt_get_devices (devices);
+	g_autoptr(GPtrArray) devices_auth = g_ptr_array_new ();
+
+	for (guint i = 0; i < devices_tbt->len; i++) {
+		FuThunderboltDevice *dev = g_ptr_array_index (devices_tbt, i);
+		if (fu_thunderbolt_device_get_authenticate_deferred (dev))
+			g_ptr_array_add (devices_auth, dev);
+	}
+
+	/* resetting the host controller may remove the devices behind it */
+	g_ptr_array_sort (devices_auth, fu_plugin_thunderbolt_device_sort_cb);
+	for (guint i = 0; i < devices_auth->len; i++) {
+		FuThunderboltDevice *dev = g_ptr_array_index (devices_auth, i);
+		if (!fu_thunderbolt_device_authenticate_deferred (dev, error))
+			return FALSE;
+	}
+
+	/* devices that do not reset will not be re-enumerated */
+	for (guint i = 0; i < devices_auth->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices_auth, i);
+		if (!fu_device_has_flag (dev, FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE))
+			continue;
+		if (!fu_device_rescan (dev, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 void
 fu_plugin_init (FuPlugin *plugin)
 {
@@ -79,6 +174,8 @@ fu_plugin_init (FuPlugin *plugin)
 	fu_plugin_set_device_gtype (plugin, FU_TYPE_THUNDERBOLT_DEVICE);
 	fu_plugin_add_firmware_gtype (plugin, "thunderbolt", FU_TYPE_THUNDERBOLT_FIRMWARE);
 	fu_plugin_add_firmware_gtype (plugin, "thunderbolt-update", FU_TYPE_THUNDERBOLT_FIRMWARE_UPDATE);
+	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_INSTALL_THREAD_SAFE,
+			    "only writes to the per-device nvmem");
 	/* dell-dock plugin uses a slower bus for flashing */
 	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_BETTER_THAN, "dell_dock");
 }
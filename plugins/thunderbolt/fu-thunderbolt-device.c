@@ -35,9 +35,12 @@ struct _FuThunderboltDevice {
 	guint16			 gen;
 	gchar			*devpath;
 	const gchar		*auth_method;
+	gsize			 write_block_size;
+	gboolean		 authenticate_deferred;
 };
 
 #define TBT_NVM_RETRY_TIMEOUT				200	/* ms */
+#define TBT_NVM_WRITE_BLOCK_SIZE			0x10000	/* bytes */
 #define FU_PLUGIN_THUNDERBOLT_UPDATE_TIMEOUT		60000	/* ms */
 
 G_DEFINE_TYPE (FuThunderboltDevice, fu_thunderbolt_device, FU_TYPE_UDEV_DEVICE)
@@ -206,6 +209,7 @@ fu_thunderbolt_device_to_string (FuDevice *device, guint idt, GString *str)
 	fu_common_string_append_kb (str, idt, "Native mode", self->is_native);
 	fu_common_string_append_ku (str, idt, "Generation", self->gen);
 	fu_common_string_append_kv (str, idt, "AuthAttribute", self->auth_method);
+	fu_common_string_append_kx (str, idt, "WriteBlockSize", self->write_block_size);
 }
 
 static gboolean
@@ -370,10 +374,19 @@ fu_thunderbolt_device_setup_retimer (FuDevice *device, GError **error)
 	FuThunderboltDevice *self = FU_THUNDERBOLT_DEVICE (device);
 	guint16 did;
 	guint16 vid;
+	gchar *tmp;
 	g_autofree gchar *idx = g_path_get_basename (self->devpath);
 	g_autofree gchar *instance = NULL;
+	g_autofree gchar *port = NULL;
 
 	fu_device_set_physical_id (device, idx);
+
+	/* retimers on the same port share the sideband channel, e.g. 0-0:1.1 */
+	port = g_strdup (idx);
+	tmp = g_strrstr (port, ".");
+	if (tmp != NULL)
+		*tmp = '\0';
+	fu_device_set_install_group (device, port);
 	/* as defined in PCIe 4.0 spec */
 	fu_device_set_summary (device, "A physical layer protocol-aware, software-transparent extension device "
 				        "that forms two separate electrical link segments");
@@ -501,56 +514,92 @@ fu_thunderbolt_device_write_data (FuThunderboltDevice	*self,
 				  GBytes		*blob_fw,
 				  GError		**error)
 {
-	gsize fw_size;
-	gsize nwritten;
-	gssize n;
+	const guint8 *buf;
+	gint fd;
+	gsize fw_size = 0;
+	gsize nwritten = 0;
+	guint percentage_last = G_MAXUINT;
+	g_autofree gchar *fn = NULL;
 	g_autoptr(GFile) nvmem = NULL;
-	g_autoptr(GOutputStream) os = NULL;
 
 	nvmem = fu_thunderbolt_device_find_nvmem (self, FALSE, error);
 	if (nvmem == NULL)
 		return FALSE;
-
-	os = (GOutputStream *) g_file_append_to (nvmem,
-						 G_FILE_CREATE_NONE,
-						 NULL,
-						 error);
-
-	if (os == NULL)
+	fn = g_file_get_path (nvmem);
+	fd = open (fn, O_WRONLY | O_APPEND | O_CLOEXEC);
+	if (fd < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "could not open %s: %s",
+			     fn, g_strerror (errno));
 		return FALSE;
+	}
 
-	nwritten = 0;
-	fw_size = g_bytes_get_size (blob_fw);
+	/* write straight from the firmware blob, without any copies */
+	buf = g_bytes_get_data (blob_fw, &fw_size);
 	fu_device_set_progress_full (FU_DEVICE (self), nwritten, fw_size);
-
-	do {
-		g_autoptr(GBytes) fw_data = NULL;
-
-		fw_data = g_bytes_new_from_bytes (blob_fw,
-						  nwritten,
-						  fw_size - nwritten);
-
-		n = g_output_stream_write_bytes (os,
-						 fw_data,
-						 NULL,
-						 error);
-		if (n < 0)
+	while (nwritten < fw_size) {
+		guint percentage;
+		gssize n;
+
+		n = write (fd, buf + nwritten, MIN (self->write_block_size, fw_size - nwritten));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_WRITE,
+				     "Could not write all data to nvmem: %s",
+				     n < 0 ? g_strerror (errno) : "no data written");
+			close (fd);
 			return FALSE;
-
+		}
 		nwritten += n;
-		fu_device_set_progress_full (FU_DEVICE (self), nwritten, fw_size);
 
-	} while (nwritten < fw_size);
+		/* only emit a signal when the value has actually changed */
+		percentage = (guint) ((100 * (guint64) nwritten) / fw_size);
+		if (percentage != percentage_last) {
+			fu_device_set_progress_full (FU_DEVICE (self), nwritten, fw_size);
+			percentage_last = percentage;
+		}
+	}
 
-	if (nwritten != fw_size) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_WRITE,
-				     "Could not write all data to nvmem");
+	if (close (fd) < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "could not close %s: %s",
+			     fn, g_strerror (errno));
 		return FALSE;
 	}
+	return TRUE;
+}
 
-	return g_output_stream_close (os, NULL, error);
+static gboolean
+fu_thunderbolt_device_set_quirk_kv (FuDevice *device,
+				    const gchar *key,
+				    const gchar *value,
+				    GError **error)
+{
+	FuThunderboltDevice *self = FU_THUNDERBOLT_DEVICE (device);
+	if (g_strcmp0 (key, "ThunderboltWriteBlockSize") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp == 0 || tmp > G_MAXUINT32) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_INVALID_DATA,
+					     "ThunderboltWriteBlockSize is invalid");
+			return FALSE;
+		}
+		self->write_block_size = tmp;
+		return TRUE;
+	}
+	g_set_error_literal (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_SUPPORTED,
+			     "quirk key not supported");
+	return FALSE;
 }
 
 static FuFirmware *
@@ -670,6 +719,13 @@ fu_thunderbolt_device_write_firmware (FuDevice *device,
 		fu_device_add_flag (device, FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION);
 	}
 
+	/* the plugin authenticates all the devices in the transaction at once */
+	if (self->authenticate_deferred) {
+		g_debug ("deferring authentication of %s", self->devpath);
+		fu_device_add_flag (device, FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION);
+		return TRUE;
+	}
+
 	/* using an active delayed activation flow later (either shutdown or another plugin) */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_SKIPS_RESTART)) {
 		g_debug ("Skipping Thunderbolt reset per quirk request");
@@ -693,6 +749,55 @@ fu_thunderbolt_device_write_firmware (FuDevice *device,
 	return TRUE;
 }
 
+gboolean
+fu_thunderbolt_device_is_host_controller (FuThunderboltDevice *self)
+{
+	g_return_val_if_fail (FU_IS_THUNDERBOLT_DEVICE (self), FALSE);
+	return self->device_type == FU_THUNDERBOLT_DEVICE_TYPE_HOST_CONTROLLER;
+}
+
+gboolean
+fu_thunderbolt_device_get_authenticate_deferred (FuThunderboltDevice *self)
+{
+	g_return_val_if_fail (FU_IS_THUNDERBOLT_DEVICE (self), FALSE);
+	return self->authenticate_deferred;
+}
+
+/* write_firmware() only writes and flushes the image, and the caller has to
+ * authenticate the device and handle the reset */
+void
+fu_thunderbolt_device_set_authenticate_deferred (FuThunderboltDevice *self,
+						 gboolean authenticate_deferred)
+{
+	g_return_if_fail (FU_IS_THUNDERBOLT_DEVICE (self));
+	self->authenticate_deferred = authenticate_deferred;
+}
+
+/* authenticate an image written with the authentication deferred */
+gboolean
+fu_thunderbolt_device_authenticate_deferred (FuThunderboltDevice *self, GError **error)
+{
+	FuDevice *device = FU_DEVICE (self);
+
+	g_return_val_if_fail (FU_IS_THUNDERBOLT_DEVICE (self), FALSE);
+
+	self->authenticate_deferred = FALSE;
+	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION))
+		return TRUE;
+	if (!fu_thunderbolt_device_authenticate (device, error)) {
+		g_prefix_error (error, "could not start thunderbolt device upgrade: ");
+		return FALSE;
+	}
+	fu_device_remove_flag (device, FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION);
+
+	/* the kernel re-enumerates the device when it has reset */
+	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_USABLE_DURING_UPDATE)) {
+		fu_device_set_status (device, FWUPD_STATUS_DEVICE_RESTART);
+		fu_device_set_remove_delay (device, FU_PLUGIN_THUNDERBOLT_UPDATE_TIMEOUT);
+	}
+	return TRUE;
+}
+
 static void
 fu_thunderbolt_device_init (FuThunderboltDevice *self)
 {
@@ -700,6 +805,7 @@ fu_thunderbolt_device_init (FuThunderboltDevice *self)
 	fu_device_add_icon (FU_DEVICE (self), "thunderbolt");
 	fu_device_set_protocol (FU_DEVICE (self), "com.intel.thunderbolt");
 	fu_device_set_version_format (FU_DEVICE (self), FWUPD_VERSION_FORMAT_PAIR);
+	self->write_block_size = TBT_NVM_WRITE_BLOCK_SIZE;
 }
 
 static void
@@ -719,6 +825,7 @@ fu_thunderbolt_device_class_init (FuThunderboltDeviceClass *klass)
 	object_class->finalize = fu_thunderbolt_device_finalize;
 	klass_device->activate = fu_thunderbolt_device_authenticate;
 	klass_device->to_string = fu_thunderbolt_device_to_string;
+	klass_device->set_quirk_kv = fu_thunderbolt_device_set_quirk_kv;
 	klass_device->setup = fu_thunderbolt_device_setup;
 	klass_device->prepare_firmware = fu_thunderbolt_device_prepare_firmware;
 	klass_device->write_firmware = fu_thunderbolt_device_write_firmware;
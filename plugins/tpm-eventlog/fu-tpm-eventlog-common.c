@@ -172,6 +172,8 @@ fu_tpm_eventlog_calc_checksums (GPtrArray *items, guint8 pcr, GError **error)
 	guint8 digest_sha256[TPM2_SHA256_DIGEST_SIZE] = { 0x0 };
 	gsize digest_sha1_len = sizeof(digest_sha1);
 	gsize digest_sha256_len = sizeof(digest_sha256);
+	g_autoptr(GChecksum) csum_sha1 = g_checksum_new (G_CHECKSUM_SHA1);
+	g_autoptr(GChecksum) csum_sha256 = g_checksum_new (G_CHECKSUM_SHA256);
 	g_autoptr(GPtrArray) csums = g_ptr_array_new_with_free_func (g_free);
 
 	/* sanity check */
@@ -190,7 +192,7 @@ fu_tpm_eventlog_calc_checksums (GPtrArray *items, guint8 pcr, GError **error)
 		if (item->pcr != pcr)
 			continue;
 		if (item->checksum_sha1 != NULL) {
-			g_autoptr(GChecksum) csum_sha1 = g_checksum_new (G_CHECKSUM_SHA1);
+			g_checksum_reset (csum_sha1);
 			g_checksum_update (csum_sha1,
 					   (const guchar *) digest_sha1,
 					   digest_sha1_len);
@@ -201,7 +203,7 @@ fu_tpm_eventlog_calc_checksums (GPtrArray *items, guint8 pcr, GError **error)
 			cnt_sha1++;
 		}
 		if (item->checksum_sha256 != NULL) {
-			g_autoptr(GChecksum) csum_sha256 = g_checksum_new (G_CHECKSUM_SHA256);
+			g_checksum_reset (csum_sha256);
 			g_checksum_update (csum_sha256,
 					   (const guchar *) digest_sha256,
 					   digest_sha256_len);
@@ -16,6 +16,7 @@
 struct _FuTpmEventlogDevice {
 	FuDevice		 parent_instance;
 	GPtrArray		*items;
+	GHashTable		*pcr_checksums;	/* pcr : GPtrArray */
 };
 
 G_DEFINE_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU_TYPE_DEVICE)
@@ -23,7 +24,19 @@ G_DEFINE_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU_TYPE_DEVICE)
 GPtrArray *
 fu_tpm_eventlog_device_get_checksums (FuTpmEventlogDevice *self, guint8 pcr, GError **error)
 {
-	return fu_tpm_eventlog_calc_checksums (self->items, pcr, error);
+	GPtrArray *csums;
+
+	/* the items never change, so only replay each PCR once */
+	csums = g_hash_table_lookup (self->pcr_checksums, GUINT_TO_POINTER (pcr));
+	if (csums != NULL)
+		return g_ptr_array_ref (csums);
+	csums = fu_tpm_eventlog_calc_checksums (self->items, pcr, error);
+	if (csums == NULL)
+		return NULL;
+	g_hash_table_insert (self->pcr_checksums,
+			     GUINT_TO_POINTER (pcr),
+			     g_ptr_array_ref (csums));
+	return csums;
 }
 
 static void
@@ -54,7 +67,7 @@ fu_tpm_eventlog_device_report_metadata (FuTpmEventlogDevice *self)
 			g_string_append_printf (str, " [%s]", blobstr);
 		g_string_append (str, "\n");
 	}
-	pcrs = fu_tpm_eventlog_calc_checksums (self->items, 0, NULL);
+	pcrs = fu_tpm_eventlog_device_get_checksums (self, 0, NULL);
 	if (pcrs != NULL) {
 		for (guint j = 0; j < pcrs->len; j++) {
 			const gchar *csum = g_ptr_array_index (pcrs, j);
@@ -75,6 +88,8 @@ fu_tpm_eventlog_device_init (FuTpmEventlogDevice *self)
 	fu_device_set_logical_id (FU_DEVICE (self), "eventlog");
 	fu_device_add_parent_guid (FU_DEVICE (self), "system-tpm");
 	fu_device_add_instance_id (FU_DEVICE (self), "system-tpm-eventlog");
+	self->pcr_checksums = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+						     (GDestroyNotify) g_ptr_array_unref);
 }
 
 static void
@@ -82,7 +97,9 @@ fu_tpm_eventlog_device_finalize (GObject *object)
 {
 	FuTpmEventlogDevice *self = FU_TPM_EVENTLOG_DEVICE (object);
 
-	g_ptr_array_unref (self->items);
+	if (self->items != NULL)
+		g_ptr_array_unref (self->items);
+	g_hash_table_unref (self->pcr_checksums);
 
 	G_OBJECT_CLASS (fu_tpm_eventlog_device_parent_class)->finalize (object);
 }
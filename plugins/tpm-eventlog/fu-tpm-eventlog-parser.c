@@ -88,6 +88,7 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 		guint32 event_type = 0;
 		guint32 digestcnt = 0;
 		guint32 datasz = 0;
+		gboolean wanted;
 		g_autoptr(GBytes) checksum_sha1 = NULL;
 		g_autoptr(GBytes) checksum_sha256 = NULL;
 
@@ -107,6 +108,7 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 
 		/* read checksum block */
 		idx += FU_TPM_EVENTLOG_V2_SIZE;
+		wanted = pcr == ESYS_TR_PCR0 || flags & FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS;
 		for (guint i = 0; i < digestcnt; i++) {
 			guint16 alg_type = 0;
 			guint32 alg_size = 0;
@@ -129,6 +131,12 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 			/* build checksum */
 			idx += sizeof(alg_type);
 
+			/* not going to be saved */
+			if (!wanted) {
+				idx += alg_size;
+				continue;
+			}
+
 			/* copy hash */
 			digest = g_malloc0 (alg_size);
 			if (!fu_memcpy_safe (digest, alg_size, 0x0,	/* dst */
@@ -160,8 +168,7 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 
 		/* save blob if PCR=0 */
 		idx += sizeof(datasz);
-		if (pcr == ESYS_TR_PCR0 ||
-		    flags & FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS) {
+		if (wanted) {
 			FuTpmEventlogItem *item;
 			g_autofree guint8 *data = NULL;
 
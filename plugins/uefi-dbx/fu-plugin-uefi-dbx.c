@@ -45,15 +45,14 @@ void
 fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
-	GPtrArray *checksums;
 	gsize bufsz = 0;
-	guint missing_cnt = 0;
 	g_autofree guint8 *buf_system = NULL;
 	g_autofree guint8 *buf_update = NULL;
 	g_autoptr(FuUefiDbxFile) dbx_system = NULL;
 	g_autoptr(FuUefiDbxFile) dbx_update = NULL;
 	g_autoptr(FwupdSecurityAttr) attr = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) checksums = NULL;
 
 	/* create attr */
 	attr = fwupd_security_attr_new (FWUPD_SECURITY_ATTR_ID_UEFI_DBX);
@@ -100,17 +99,14 @@ fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 	}
 
 	/* look for each checksum in the update in the system version */
-	checksums = fu_uefi_dbx_file_get_checksums (dbx_update);
+	checksums = fu_uefi_dbx_file_get_checksums_missing (dbx_update, dbx_system);
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *checksum = g_ptr_array_index (checksums, i);
-		if (!fu_uefi_dbx_file_has_checksum (dbx_system, checksum)) {
-			g_debug ("%s missing from the system DBX", checksum);
-			missing_cnt += 1;
-		}
+		g_debug ("%s missing from the system DBX", checksum);
 	}
 
 	/* add security attribute */
-	if (missing_cnt > 0) {
+	if (checksums->len > 0) {
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_FOUND);
 		return;
 	}
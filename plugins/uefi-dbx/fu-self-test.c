@@ -20,6 +20,7 @@ fu_uefi_dbx_file_parse_func (void)
 	g_autofree guint8 *buf = NULL;
 	g_autoptr(FuUefiDbxFile) uefi_dbx_file = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) missing = NULL;
 
 	/* load file */
 	fn = fu_uefi_dbx_get_dbxupdate (NULL);
@@ -40,6 +41,10 @@ fu_uefi_dbx_file_parse_func (void)
 	g_assert_cmpint (fu_uefi_dbx_file_get_checksums(uefi_dbx_file)->len, ==, 77);
 	g_assert_true (fu_uefi_dbx_file_has_checksum (uefi_dbx_file, "72e0bd1867cf5d9d56ab158adf3bddbc82bf32a8d8aa1d8c5e2f6df29428d6d8"));
 	g_assert_false (fu_uefi_dbx_file_has_checksum (uefi_dbx_file, "dave"));
+
+	/* nothing is missing when compared against itself */
+	missing = fu_uefi_dbx_file_get_checksums_missing (uefi_dbx_file, uefi_dbx_file);
+	g_assert_cmpint (missing->len, ==, 0);
 }
 
 int
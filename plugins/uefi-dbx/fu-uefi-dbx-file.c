@@ -12,10 +12,12 @@
 #include "fu-common.h"
 #include "fu-uefi-dbx-common.h"
 #include "fu-uefi-dbx-file.h"
+#include "fu-uefi-dbx-struct.h"
 
 struct _FuUefiDbxFile {
 	GObject		 parent_instance;
 	GPtrArray	*checksums;
+	GHashTable	*digests;	/* of GBytes */
 };
 
 G_DEFINE_TYPE (FuUefiDbxFile, fu_uefi_dbx_file, G_TYPE_OBJECT)
@@ -56,6 +58,8 @@ fu_uefi_dbx_file_parse_sig_item (FuUefiDbxFile *self,
 	if (g_getenv ("FWUPD_UEFI_DBX_VERBOSE") != NULL)
 		g_debug ("Owner: %s, Data: %s", sig_owner, sig_datastr->str);
 	g_ptr_array_add (self->checksums, g_string_free (sig_datastr, FALSE));
+	g_hash_table_add (self->digests,
+			  g_bytes_new_take (g_steal_pointer (&sig_data), sig_datasz));
 	return TRUE;
 }
 
@@ -66,40 +70,37 @@ fu_uefi_dbx_file_parse_sig_list (FuUefiDbxFile *self,
 				 gsize *offset,
 				 GError **error)
 {
-	fwupd_guid_t guid;
+	const guint8 *st;
 	gsize offset_tmp;
-	guint32 sig_header_size = 0;
-	guint32 sig_list_size = 0;
-	guint32 sig_size = 0;
+	guint32 sig_header_size;
+	guint32 sig_list_size;
+	guint32 sig_size;
 	g_autofree gchar *sig_type = NULL;
 
 	/* read EFI_SIGNATURE_LIST */
-	if (!fu_memcpy_safe ((guint8 *) &guid, sizeof(guid), 0x0,	/* dst */
-			     buf, bufsz, *offset,			/* src */
-			     sizeof(guid), error)) {
+	if (!fu_uefi_dbx_signature_list_validate (buf, bufsz, *offset, error)) {
 		g_prefix_error (error, "failed to read GUID header: ");
 		return FALSE;
 	}
-	sig_type = fwupd_guid_to_string (&guid, FWUPD_GUID_FLAG_MIXED_ENDIAN);
+	st = buf + *offset;
+	sig_type = fwupd_guid_to_string (fu_uefi_dbx_signature_list_get_signature_type (st),
+					 FWUPD_GUID_FLAG_MIXED_ENDIAN);
 	if (g_strcmp0 (sig_type, "c1c41626-504c-4092-aca9-41f936934328") == 0)
 		g_debug ("EFI_SIGNATURE_LIST SHA256");
 	else if (g_strcmp0 (sig_type, "a5c059a1-94e4-4aa7-87b5-ab155c2bf072") == 0)
 		g_debug ("EFI_SIGNATURE_LIST X509");
 	else
 		g_debug ("EFI_SIGNATURE_LIST unknown: %s", sig_type);
-	if (!fu_common_read_uint32_safe (buf, bufsz, *offset + 0x10,
-					 &sig_list_size, G_LITTLE_ENDIAN, error))
-		return FALSE;
-	if (sig_list_size < 0x1c || sig_list_size > 1024 * 1024) {
+	sig_list_size = fu_uefi_dbx_signature_list_get_list_size (st);
+	if (sig_list_size < FU_UEFI_DBX_SIGNATURE_LIST_SIZE ||
+	    sig_list_size > 1024 * 1024) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
 			     "SignatureListSize invalid: 0x%x", sig_list_size);
 		return FALSE;
 	}
-	if (!fu_common_read_uint32_safe (buf, bufsz, *offset + 0x14,
-					 &sig_header_size, G_LITTLE_ENDIAN, error))
-		return FALSE;
+	sig_header_size = fu_uefi_dbx_signature_list_get_header_size (st);
 	if (sig_header_size > 1024 * 1024) {
 		g_set_error (error,
 			     G_IO_ERROR,
@@ -107,9 +108,7 @@ fu_uefi_dbx_file_parse_sig_list (FuUefiDbxFile *self,
 			     "SignatureHeaderSize invalid: 0x%x", sig_size);
 		return FALSE;
 	}
-	if (!fu_common_read_uint32_safe (buf, bufsz, *offset + 0x18,
-					 &sig_size, G_LITTLE_ENDIAN, error))
-		return FALSE;
+	sig_size = fu_uefi_dbx_signature_list_get_size (st);
 	if (sig_size < sizeof(fwupd_guid_t) || sig_size > 1024 * 1024) {
 		g_set_error (error,
 			     G_IO_ERROR,
@@ -119,8 +118,8 @@ fu_uefi_dbx_file_parse_sig_list (FuUefiDbxFile *self,
 	}
 
 	/* header is typically unused */
-	offset_tmp = *offset + 0x1c + sig_header_size;
-	for (guint i = 0; i < (sig_list_size - 0x1c) / sig_size; i++) {
+	offset_tmp = *offset + FU_UEFI_DBX_SIGNATURE_LIST_SIZE + sig_header_size;
+	for (guint i = 0; i < (sig_list_size - FU_UEFI_DBX_SIGNATURE_LIST_SIZE) / sig_size; i++) {
 		if (!fu_uefi_dbx_file_parse_sig_item (self, buf, bufsz,
 						      offset_tmp, sig_size,
 						      error))
@@ -161,16 +160,66 @@ fu_uefi_dbx_file_new (const guint8 *buf, gsize bufsz,
 	return g_steal_pointer (&self);
 }
 
+static GBytes *
+fu_uefi_dbx_file_checksum_to_digest (const gchar *checksum)
+{
+	gsize bufsz = strlen (checksum) / 2;
+	g_autofree guint8 *buf = NULL;
+
+	if (bufsz == 0 || strlen (checksum) % 2 != 0)
+		return NULL;
+	buf = g_malloc (bufsz);
+	for (gsize i = 0; i < bufsz; i++) {
+		gint hi = g_ascii_xdigit_value (checksum[i * 2]);
+		gint lo = g_ascii_xdigit_value (checksum[i * 2 + 1]);
+		if (hi < 0 || lo < 0)
+			return NULL;
+		buf[i] = (guint8) ((hi << 4) | lo);
+	}
+	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+}
+
 gboolean
 fu_uefi_dbx_file_has_checksum (FuUefiDbxFile *self, const gchar *checksum)
 {
+	g_autoptr(GBytes) digest = NULL;
+
 	g_return_val_if_fail (FU_IS_UEFI_DBX_FILE (self), FALSE);
-	for (guint i = 0; i < self->checksums->len; i++) {
-		const gchar *checksums_tmp = g_ptr_array_index (self->checksums, i);
-		if (g_strcmp0 (checksums_tmp, checksum) == 0)
-			return TRUE;
+	g_return_val_if_fail (checksum != NULL, FALSE);
+
+	digest = fu_uefi_dbx_file_checksum_to_digest (checksum);
+	if (digest == NULL)
+		return FALSE;
+	return g_hash_table_contains (self->digests, digest);
+}
+
+/* returns the checksums in @self that are not present in @other */
+GPtrArray *
+fu_uefi_dbx_file_get_checksums_missing (FuUefiDbxFile *self, FuUefiDbxFile *other)
+{
+	GHashTableIter iter;
+	gpointer key;
+	GPtrArray *missing = g_ptr_array_new_with_free_func (g_free);
+
+	g_return_val_if_fail (FU_IS_UEFI_DBX_FILE (self), NULL);
+	g_return_val_if_fail (FU_IS_UEFI_DBX_FILE (other), NULL);
+
+	g_hash_table_iter_init (&iter, self->digests);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		GBytes *digest = (GBytes *) key;
+		const guint8 *buf;
+		gsize bufsz = 0;
+		GString *str;
+
+		if (g_hash_table_contains (other->digests, digest))
+			continue;
+		buf = g_bytes_get_data (digest, &bufsz);
+		str = g_string_sized_new (bufsz * 2);
+		for (gsize i = 0; i < bufsz; i++)
+			g_string_append_printf (str, "%02x", buf[i]);
+		g_ptr_array_add (missing, g_string_free (str, FALSE));
 	}
-	return FALSE;
+	return missing;
 }
 
 GPtrArray *
@@ -185,6 +234,7 @@ fu_uefi_dbx_file_finalize (GObject *obj)
 {
 	FuUefiDbxFile *self = FU_UEFI_DBX_FILE (obj);
 	g_ptr_array_unref (self->checksums);
+	g_hash_table_unref (self->digests);
 	G_OBJECT_CLASS (fu_uefi_dbx_file_parent_class)->finalize (obj);
 }
 
@@ -199,4 +249,6 @@ static void
 fu_uefi_dbx_file_init (FuUefiDbxFile *self)
 {
 	self->checksums = g_ptr_array_new_with_free_func (g_free);
+	self->digests = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+					       (GDestroyNotify) g_bytes_unref, NULL);
 }
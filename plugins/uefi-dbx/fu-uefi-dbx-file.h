@@ -24,3 +24,5 @@ FuUefiDbxFile	*fu_uefi_dbx_file_new		(const guint8	*buf,
 GPtrArray	*fu_uefi_dbx_file_get_checksums	(FuUefiDbxFile	*self);
 gboolean	 fu_uefi_dbx_file_has_checksum	(FuUefiDbxFile	*self,
 						 const gchar	*checksum);
+GPtrArray	*fu_uefi_dbx_file_get_checksums_missing	(FuUefiDbxFile	*self,
+							 FuUefiDbxFile	*other);
@@ -29,6 +29,8 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(GUnixMountEntry, g_unix_mount_free)
 
 struct FuPluginData {
 	FuUefiBgrt		*bgrt;
+	gchar			*esp_path;	/* shared by a composite update */
+	gboolean		 esp_automounted;
 };
 
 void
@@ -38,6 +40,8 @@ fu_plugin_init (FuPlugin *plugin)
 	data->bgrt = fu_uefi_bgrt_new ();
 	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_RUN_AFTER, "upower");
 	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_METADATA_SOURCE, "tpm_eventlog");
+	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_STARTUP_THREAD_SAFE,
+			    "only reads SMBIOS and sysfs");
 	fu_plugin_add_compile_version (plugin, "com.redhat.efivar", EFIVAR_LIBRARY_VERSION);
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
 }
@@ -47,6 +51,7 @@ fu_plugin_destroy (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	g_object_unref (data->bgrt);
+	g_free (data->esp_path);
 }
 
 gboolean
@@ -408,6 +413,104 @@ fu_plugin_update (FuPlugin *plugin,
 	return fu_device_write_firmware (device, blob_fw, flags, error);
 }
 
+gboolean
+fu_plugin_composite_prepare (FuPlugin *plugin, GPtrArray *devices, GError **error)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autoptr(GPtrArray) devices_esp = g_ptr_array_new ();
+	g_autoptr(GPtrArray) devices_uefi = g_ptr_array_new ();
+
+	/* only devices that would each detect and mount the ESP */
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fu_device_get_plugin (device), "uefi") != 0)
+			continue;
+		g_ptr_array_add (devices_uefi, device);
+		if (fu_device_get_metadata (device, "EspPath") != NULL)
+			continue;
+		g_ptr_array_add (devices_esp, device);
+	}
+	if (devices_uefi->len < 2)
+		return TRUE;
+
+	/* mount once for all the capsules */
+	if (devices_esp->len > 0) {
+		data->esp_automounted = FALSE;
+		data->esp_path = fu_uefi_mount_esp (&data->esp_automounted, error);
+		if (data->esp_path == NULL)
+			return FALSE;
+		for (guint i = 0; i < devices_esp->len; i++) {
+			FuDevice *device = g_ptr_array_index (devices_esp, i);
+			fu_device_set_metadata (device, "EspPath", data->esp_path);
+		}
+	}
+
+	/* stage all the capsules, and then set BootNext once in cleanup */
+	for (guint i = 0; i < devices_uefi->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices_uefi, i);
+		fu_device_set_metadata_boolean (device, "UefiDeferBootNext", TRUE);
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_plugin_uefi_composite_cleanup_esp (FuPlugin *plugin, GPtrArray *devices, GError **error)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+
+	/* nothing shared */
+	if (data->esp_path == NULL)
+		return TRUE;
+
+	/* we will detect again if necessary */
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fu_device_get_plugin (device), "uefi") != 0)
+			continue;
+		if (g_strcmp0 (fu_device_get_metadata (device, "EspPath"), data->esp_path) == 0)
+			fu_device_remove_metadata (device, "EspPath");
+	}
+	g_clear_pointer (&data->esp_path, g_free);
+	if (data->esp_automounted) {
+		data->esp_automounted = FALSE;
+		if (!fu_uefi_umount_esp (error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+fu_plugin_composite_cleanup (FuPlugin *plugin, GPtrArray *devices, GError **error)
+{
+	gboolean bootnext_done = FALSE;
+	g_autoptr(GError) error_bootnext = NULL;
+
+	/* set BootNext once for all the staged capsules, even if a later
+	 * device failed, so that the capsules written so far are applied */
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fu_device_get_plugin (device), "uefi") != 0)
+			continue;
+		if (!bootnext_done &&
+		    fu_device_get_metadata_boolean (device, "UefiBootNextPending")) {
+			fu_uefi_device_write_bootnext (FU_UEFI_DEVICE (device),
+						       &error_bootnext);
+			bootnext_done = TRUE;
+		}
+		fu_device_remove_metadata (device, "UefiBootNextPending");
+		fu_device_remove_metadata (device, "UefiDeferBootNext");
+	}
+
+	/* the ESP is still needed to install the bootloader above */
+	if (!fu_plugin_uefi_composite_cleanup_esp (plugin, devices, error))
+		return FALSE;
+	if (error_bootnext != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_bootnext));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_plugin_uefi_load_config (FuPlugin *plugin, FuDevice *device, GError **error)
 {
@@ -733,19 +836,16 @@ gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
+	FuEsrt *esrt = fu_plugin_get_esrt (plugin);
+	GPtrArray *entries;
 	const gchar *str;
-	g_autofree gchar *esrt_path = NULL;
-	g_autofree gchar *sysfsfwdir = NULL;
 	g_autoptr(GError) error_efivarfs = NULL;
 	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) entries = NULL;
 
-	/* get the directory of ESRT entries */
-	sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
-	esrt_path = g_build_filename (sysfsfwdir, "efi", "esrt", NULL);
-	entries = fu_uefi_get_esrt_entry_paths (esrt_path, error);
-	if (entries == NULL)
+	/* get the ESRT entries, which are only read once */
+	if (!fu_esrt_load (esrt, error))
 		return FALSE;
+	entries = fu_esrt_get_entries (esrt);
 
 	/* make sure that efivarfs is rw */
 	if (!fu_plugin_uefi_ensure_efivarfs_rw (&error_efivarfs))
@@ -753,11 +853,13 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 
 	/* add each device */
 	for (guint i = 0; i < entries->len; i++) {
-		const gchar *path = g_ptr_array_index (entries, i);
+		FuEsrtEntry *entry = g_ptr_array_index (entries, i);
 		g_autoptr(GError) error_parse = NULL;
-		g_autoptr(FuUefiDevice) dev = fu_uefi_device_new_from_entry (path, &error_parse);
+		g_autoptr(FuUefiDevice) dev = fu_uefi_device_new_from_esrt_entry (entry, &error_parse);
 		if (dev == NULL) {
-			g_warning ("failed to add %s: %s", path, error_parse->message);
+			g_warning ("failed to add %s: %s",
+				   fu_esrt_entry_get_path (entry),
+				   error_parse->message);
 			continue;
 		}
 		fu_device_set_quirks (FU_DEVICE (dev), fu_plugin_get_quirks (plugin));
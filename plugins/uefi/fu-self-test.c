@@ -7,7 +7,9 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <glib/gstdio.h>
 
+#include "fu-common.h"
 #include "fu-ucs2.h"
 #include "fu-uefi-bgrt.h"
 #include "fu-uefi-common.h"
@@ -43,12 +45,18 @@ fu_uefi_pcrs_1_2_func (void)
 static void
 fu_uefi_pcrs_2_0_func (void)
 {
+	gboolean ret;
 	g_autoptr(FuUefiPcrs) pcrs = fu_uefi_pcrs_new ();
+	g_autoptr(FuUefiPcrs) pcrs_cached = fu_uefi_pcrs_new ();
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) pcr0s = NULL;
+	g_autoptr(GPtrArray) pcr0s_cached = NULL;
 	g_autoptr(GPtrArray) pcrXs = NULL;
+	g_autofree gchar *localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	g_autofree gchar *fn_cache = g_build_filename (localstatedir, "pcrs.cache", NULL);
 	const gchar *tpm_server_running = g_getenv ("TPM_SERVER_RUNNING");
 	g_setenv ("FWUPD_FORCE_TPM2", "1", TRUE);
+	g_unlink (fn_cache);
 
 #ifdef HAVE_GETUID
 	if (tpm_server_running == NULL &&
@@ -72,6 +80,17 @@ fu_uefi_pcrs_2_0_func (void)
 	pcrXs = fu_uefi_pcrs_get_checksums (pcrs, 999);
 	g_assert_nonnull (pcrXs);
 	g_assert_cmpint (pcrXs->len, ==, 0);
+
+	/* same values without using the TPM */
+	ret = fu_uefi_pcrs_setup (pcrs_cached, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	pcr0s_cached = fu_uefi_pcrs_get_checksums (pcrs_cached, 0);
+	g_assert_cmpint (pcr0s_cached->len, ==, pcr0s->len);
+	for (guint i = 0; i < pcr0s->len; i++) {
+		g_assert_cmpstr (g_ptr_array_index (pcr0s_cached, i), ==,
+				 g_ptr_array_index (pcr0s, i));
+	}
 	g_unsetenv ("FWUPD_FORCE_TPM2");
 }
 
@@ -142,12 +161,18 @@ fu_uefi_bitmap_func (void)
 static void
 fu_uefi_device_func (void)
 {
-	g_autofree gchar *fn = NULL;
+	FuEsrtEntry *entry;
+	gboolean ret;
+	g_autoptr(FuEsrt) esrt = fu_esrt_new ();
 	g_autoptr(FuUefiDevice) dev = NULL;
 	g_autoptr(GError) error = NULL;
 
-	fn = g_build_filename (TESTDATADIR, "efi/esrt/entries/entry0", NULL);
-	dev = fu_uefi_device_new_from_entry (fn, &error);
+	ret = fu_esrt_load (esrt, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	entry = fu_esrt_get_entry_by_fw_class (esrt, "ddc0ee61-e7f0-4e7d-acc5-c070a398838e");
+	g_assert_nonnull (entry);
+	dev = fu_uefi_device_new_from_esrt_entry (entry, &error);
 	g_assert_nonnull (dev);
 	g_assert_no_error (error);
 
@@ -169,25 +194,27 @@ static void
 fu_uefi_plugin_func (void)
 {
 	FuUefiDevice *dev;
-	g_autofree gchar *esrt_path = NULL;
-	g_autofree gchar *sysfsfwdir = NULL;
+	GPtrArray *entries;
+	gboolean ret;
+	g_autoptr(FuEsrt) esrt = fu_esrt_new ();
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
-	g_autoptr(GPtrArray) entries = NULL;
 
 	/* add each device */
-	sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
-	esrt_path = g_build_filename (sysfsfwdir, "efi", "esrt", NULL);
-	entries = fu_uefi_get_esrt_entry_paths (esrt_path, &error);
+	ret = fu_esrt_load (esrt, &error);
 	g_assert_no_error (error);
-	g_assert_nonnull (entries);
+	g_assert_true (ret);
+	entries = fu_esrt_get_entries (esrt);
+	g_assert_cmpint (entries->len, ==, 3);
 	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (guint i = 0; i < entries->len; i++) {
-		const gchar *path = g_ptr_array_index (entries, i);
+		FuEsrtEntry *entry = g_ptr_array_index (entries, i);
 		g_autoptr(GError) error_local = NULL;
-		g_autoptr(FuUefiDevice) dev_tmp = fu_uefi_device_new_from_entry (path, &error_local);
+		g_autoptr(FuUefiDevice) dev_tmp = fu_uefi_device_new_from_esrt_entry (entry, &error_local);
 		if (dev_tmp == NULL) {
-			g_debug ("failed to add %s: %s", path, error_local->message);
+			g_debug ("failed to add %s: %s",
+				 fu_esrt_entry_get_path (entry),
+				 error_local->message);
 			continue;
 		}
 		g_ptr_array_add (devices, g_object_ref (dev_tmp));
@@ -218,13 +245,18 @@ fu_uefi_plugin_func (void)
 static void
 fu_uefi_update_info_func (void)
 {
-	g_autofree gchar *fn = NULL;
+	FuEsrtEntry *entry;
+	gboolean ret;
+	g_autoptr(FuEsrt) esrt = fu_esrt_new ();
 	g_autoptr(FuUefiDevice) dev = NULL;
 	g_autoptr(FuUefiUpdateInfo) info = NULL;
 	g_autoptr(GError) error = NULL;
 
-	fn = g_build_filename (TESTDATADIR, "efi/esrt/entries/entry0", NULL);
-	dev = fu_uefi_device_new_from_entry (fn, &error);
+	ret = fu_esrt_load (esrt, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	entry = g_ptr_array_index (fu_esrt_get_entries (esrt), 0);
+	dev = fu_uefi_device_new_from_esrt_entry (entry, &error);
 	g_assert_no_error (error);
 	g_assert_nonnull (dev);
 	g_assert_cmpint (fu_uefi_device_get_kind (dev), ==, FU_UEFI_DEVICE_KIND_SYSTEM_FIRMWARE);
@@ -247,6 +279,7 @@ main (int argc, char **argv)
 	g_test_init (&argc, &argv, NULL);
 	g_setenv ("FWUPD_SYSFSFWDIR", TESTDATADIR, TRUE);
 	g_setenv ("FWUPD_SYSFSDRIVERDIR", TESTDATADIR, TRUE);
+	g_setenv ("FWUPD_LOCALSTATEDIR", "/tmp/fwupd-self-test/var", TRUE);
 
 	/* only critical and error are fatal */
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
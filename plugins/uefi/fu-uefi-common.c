@@ -198,35 +198,6 @@ fu_uefi_get_bitmap_size (const guint8 *buf,
 	return TRUE;
 }
 
-static gint
-fu_uefi_strcmp_sort_cb (gconstpointer a, gconstpointer b)
-{
-	const gchar *stra = *((const gchar **) a);
-	const gchar *strb = *((const gchar **) b);
-	return g_strcmp0 (stra, strb);
-}
-
-GPtrArray *
-fu_uefi_get_esrt_entry_paths (const gchar *esrt_path, GError **error)
-{
-	GPtrArray *entries = g_ptr_array_new_with_free_func (g_free);
-	const gchar *fn;
-	g_autofree gchar *esrt_entries = NULL;
-	g_autoptr(GDir) dir = NULL;
-
-	/* search ESRT */
-	esrt_entries = g_build_filename (esrt_path, "entries", NULL);
-	dir = g_dir_open (esrt_entries, 0, error);
-	if (dir == NULL)
-		return NULL;
-	while ((fn = g_dir_read_name (dir)) != NULL)
-		g_ptr_array_add (entries, g_build_filename (esrt_entries, fn, NULL));
-
-	/* sort by name */
-	g_ptr_array_sort (entries, fu_uefi_strcmp_sort_cb);
-	return entries;
-}
-
 gchar *
 fu_uefi_get_esp_path_for_os (const gchar *base)
 {
@@ -421,6 +392,49 @@ fu_uefi_guess_esp_path (GError **error)
 	return fu_uefi_probe_udisks_esp (error);
 }
 
+/* returns the mount point of the ESP, mounting it using udisks if required */
+gchar *
+fu_uefi_mount_esp (gboolean *automounted, GError **error)
+{
+	g_autofree gchar *guessed = NULL;
+	g_autofree gchar *detected_esp = NULL;
+
+	guessed = fu_uefi_guess_esp_path (error);
+	if (guessed == NULL)
+		return NULL;
+
+	/* already mounted */
+	if (!fu_uefi_udisks_objpath (guessed))
+		return g_steal_pointer (&guessed);
+
+	/* udisks objpath */
+	detected_esp = fu_uefi_udisks_objpath_is_mounted (guessed);
+	if (detected_esp != NULL) {
+		g_debug ("ESP already mounted @ %s", detected_esp);
+		return g_steal_pointer (&detected_esp);
+	}
+
+	/* not mounted */
+	g_debug ("Mounting ESP @ %s", guessed);
+	detected_esp = fu_uefi_udisks_objpath_mount (guessed, error);
+	if (detected_esp == NULL)
+		return NULL;
+	if (automounted != NULL)
+		*automounted = TRUE;
+	return g_steal_pointer (&detected_esp);
+}
+
+gboolean
+fu_uefi_umount_esp (GError **error)
+{
+	g_autofree gchar *guessed = NULL;
+	guessed = fu_uefi_guess_esp_path (error);
+	if (guessed == NULL)
+		return FALSE;
+	g_debug ("Unmounting ESP @ %s", guessed);
+	return fu_uefi_udisks_objpath_umount (guessed, error);
+}
+
 void
 fu_uefi_print_efivar_errors (void)
 {
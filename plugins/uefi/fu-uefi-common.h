@@ -70,14 +70,15 @@ gboolean	 fu_uefi_get_framebuffer_size	(guint32	*width,
 						 guint32	*height,
 						 GError		**error);
 gchar		*fu_uefi_guess_esp_path		(GError		**error);
+gchar		*fu_uefi_mount_esp		(gboolean	*automounted,
+						 GError		**error);
+gboolean	 fu_uefi_umount_esp		(GError		**error);
 gboolean	 fu_uefi_check_esp_path		(const gchar	*path,
 						 GError		**error);
 gboolean	 fu_uefi_check_esp_free_space	(const gchar	*path,
 						 guint64	 required,
 						 GError		**error);
 gchar		*fu_uefi_get_esp_path_for_os	(const gchar	*esp_path);
-GPtrArray	*fu_uefi_get_esrt_entry_paths	(const gchar	*esrt_path,
-						 GError		**error);
 guint64		 fu_uefi_read_file_as_uint64	(const gchar	*path,
 						 const gchar	*attr_name);
 void		 fu_uefi_print_efivar_errors	(void);
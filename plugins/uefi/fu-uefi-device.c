@@ -21,7 +21,6 @@
 #include "fu-uefi-bootmgr.h"
 #include "fu-uefi-pcrs.h"
 #include "fu-efivar.h"
-#include "fu-uefi-udisks.h"
 
 struct _FuUefiDevice {
 	FuDevice		 parent_instance;
@@ -519,32 +518,13 @@ fu_uefi_device_prepare (FuDevice *device,
 			FwupdInstallFlags flags,
 			GError **error)
 {
-	/* not set in conf, figure it out */
+	/* not set in conf or by a composite prepare, figure it out */
 	if (fu_device_get_metadata (device, "EspPath") == NULL) {
-		g_autofree gchar *guessed = NULL;
+		FuUefiDevice *self = FU_UEFI_DEVICE (device);
 		g_autofree gchar *detected_esp = NULL;
-		guessed = fu_uefi_guess_esp_path (error);
-		if (guessed == NULL)
+		detected_esp = fu_uefi_mount_esp (&self->automounted_esp, error);
+		if (detected_esp == NULL)
 			return FALSE;
-
-		/* udisks objpath */
-		if (fu_uefi_udisks_objpath (guessed)) {
-			FuUefiDevice *self = FU_UEFI_DEVICE (device);
-			detected_esp = fu_uefi_udisks_objpath_is_mounted (guessed);
-			if (detected_esp != NULL) {
-				g_debug ("ESP already mounted @ %s", detected_esp);
-			/* not mounted */
-			} else {
-				g_debug ("Mounting ESP @ %s", guessed);
-				detected_esp = fu_uefi_udisks_objpath_mount (guessed, error);
-				if (detected_esp == NULL)
-					return FALSE;
-				self->automounted_esp = TRUE;
-			}
-		/* already mounted */
-		} else {
-			detected_esp = g_steal_pointer (&guessed);
-		}
 		fu_device_set_metadata (device, "EspPath", detected_esp);
 	}
 
@@ -568,12 +548,7 @@ fu_uefi_device_cleanup (FuDevice *device,
 {
 	FuUefiDevice *self = FU_UEFI_DEVICE (device);
 	if (self->automounted_esp) {
-		g_autofree gchar *guessed = NULL;
-		guessed = fu_uefi_guess_esp_path (error);
-		if (guessed == NULL)
-			return FALSE;
-		g_debug ("Unmounting ESP @ %s", guessed);
-		if (!fu_uefi_udisks_objpath_umount (guessed, error))
+		if (!fu_uefi_umount_esp (error))
 			return FALSE;
 		self->automounted_esp = FALSE;
 		/* we will detect again if necessary */
@@ -583,6 +558,25 @@ fu_uefi_device_cleanup (FuDevice *device,
 	return TRUE;
 }
 
+gboolean
+fu_uefi_device_write_bootnext (FuUefiDevice *self, GError **error)
+{
+	FuDevice *device = FU_DEVICE (self);
+	FuUefiBootmgrFlags flags = FU_UEFI_BOOTMGR_FLAG_NONE;
+	const gchar *bootmgr_desc = "Linux Firmware Updater";
+	const gchar *esp_path = fu_device_get_metadata (device, "EspPath");
+
+	if (fu_device_get_metadata_boolean (device, "RequireShimForSecureBoot"))
+		flags |= FU_UEFI_BOOTMGR_FLAG_USE_SHIM_FOR_SB;
+	if (fu_device_has_custom_flag (device, "use-shim-unique"))
+		flags |= FU_UEFI_BOOTMGR_FLAG_USE_SHIM_UNIQUE;
+
+	/* some legacy devices use the old name to deduplicate boot entries */
+	if (fu_device_has_custom_flag (device, "use-legacy-bootmgr-desc"))
+		bootmgr_desc = "Linux-Firmware-Updater";
+	return fu_uefi_bootmgr_bootnext (esp_path, bootmgr_desc, flags, error);
+}
+
 static gboolean
 fu_uefi_device_write_firmware (FuDevice *device,
 			       FuFirmware *firmware,
@@ -590,8 +584,6 @@ fu_uefi_device_write_firmware (FuDevice *device,
 			       GError **error)
 {
 	FuUefiDevice *self = FU_UEFI_DEVICE (device);
-	FuUefiBootmgrFlags flags = FU_UEFI_BOOTMGR_FLAG_NONE;
-	const gchar *bootmgr_desc = "Linux Firmware Updater";
 	const gchar *esp_path = fu_device_get_metadata (device, "EspPath");
 	efi_guid_t guid;
 	g_autoptr(GBytes) fixed_fw = NULL;
@@ -638,20 +630,14 @@ fu_uefi_device_write_firmware (FuDevice *device,
 	if (!fu_uefi_device_write_update_info (self, fn, varname, &guid, error))
 		return FALSE;
 
-	/* update the firmware before the bootloader runs */
-	if (fu_device_get_metadata_boolean (device, "RequireShimForSecureBoot"))
-		flags |= FU_UEFI_BOOTMGR_FLAG_USE_SHIM_FOR_SB;
-	if (fu_device_has_custom_flag (device, "use-shim-unique"))
-		flags |= FU_UEFI_BOOTMGR_FLAG_USE_SHIM_UNIQUE;
-
-	/* some legacy devices use the old name to deduplicate boot entries */
-	if (fu_device_has_custom_flag (device, "use-legacy-bootmgr-desc"))
-		bootmgr_desc = "Linux-Firmware-Updater";
-	if (!fu_uefi_bootmgr_bootnext (esp_path, bootmgr_desc, flags, error))
-		return FALSE;
+	/* the plugin sets BootNext once for all the capsules */
+	if (fu_device_get_metadata_boolean (device, "UefiDeferBootNext")) {
+		fu_device_set_metadata_boolean (device, "UefiBootNextPending", TRUE);
+		return TRUE;
+	}
 
-	/* success! */
-	return TRUE;
+	/* update the firmware before the bootloader runs */
+	return fu_uefi_device_write_bootnext (self, error);
 }
 
 static gboolean
@@ -801,27 +787,24 @@ fu_uefi_device_class_init (FuUefiDeviceClass *klass)
 }
 
 FuUefiDevice *
-fu_uefi_device_new_from_entry (const gchar *entry_path, GError **error)
+fu_uefi_device_new_from_esrt_entry (FuEsrtEntry *entry, GError **error)
 {
 	g_autoptr(FuUefiDevice) self = NULL;
-	g_autofree gchar *fw_class_fn = NULL;
 	g_autofree gchar *id = NULL;
 
-	g_return_val_if_fail (entry_path != NULL, NULL);
+	g_return_val_if_fail (entry != NULL, NULL);
 
 	/* create object */
 	self = g_object_new (FU_TYPE_UEFI_DEVICE, NULL);
 
-	/* read values from sysfs */
-	fw_class_fn = g_build_filename (entry_path, "fw_class", NULL);
-	if (g_file_get_contents (fw_class_fn, &self->fw_class, NULL, NULL))
-		g_strdelimit (self->fw_class, "\n", '\0');
-	self->capsule_flags = fu_uefi_read_file_as_uint64 (entry_path, "capsule_flags");
-	self->kind = fu_uefi_read_file_as_uint64 (entry_path, "fw_type");
-	self->fw_version = fu_uefi_read_file_as_uint64 (entry_path, "fw_version");
-	self->last_attempt_status = fu_uefi_read_file_as_uint64 (entry_path, "last_attempt_status");
-	self->last_attempt_version = fu_uefi_read_file_as_uint64 (entry_path, "last_attempt_version");
-	self->fw_version_lowest = fu_uefi_read_file_as_uint64 (entry_path, "lowest_supported_fw_version");
+	/* copy values already read from sysfs */
+	self->fw_class = g_strdup (fu_esrt_entry_get_fw_class (entry));
+	self->capsule_flags = fu_esrt_entry_get_capsule_flags (entry);
+	self->kind = fu_esrt_entry_get_fw_type (entry);
+	self->fw_version = fu_esrt_entry_get_fw_version (entry);
+	self->last_attempt_status = fu_esrt_entry_get_last_attempt_status (entry);
+	self->last_attempt_version = fu_esrt_entry_get_last_attempt_version (entry);
+	self->fw_version_lowest = fu_esrt_entry_get_fw_version_lowest (entry);
 
 	/* the hardware instance is not in the ESRT table and we should really
 	 * write the EFI stub to query with FMP -- but we still have not ever
@@ -37,7 +37,7 @@ typedef enum {
 } FuUefiDeviceStatus;
 
 FuUefiDevice	*fu_uefi_device_new_from_guid		(const gchar	*guid);
-FuUefiDevice	*fu_uefi_device_new_from_entry		(const gchar	*entry_path,
+FuUefiDevice	*fu_uefi_device_new_from_esrt_entry	(FuEsrtEntry	*entry,
 							 GError		**error);
 FuUefiDevice	*fu_uefi_device_new_from_dev		(FuDevice	*dev);
 gboolean	 fu_uefi_device_clear_status		(FuUefiDevice	*self,
@@ -54,6 +54,8 @@ const gchar	*fu_uefi_device_kind_to_string		(FuUefiDeviceKind kind);
 const gchar	*fu_uefi_device_status_to_string	(FuUefiDeviceStatus status);
 FuUefiUpdateInfo *fu_uefi_device_load_update_info	(FuUefiDevice	*self,
 							 GError		**error);
+gboolean	 fu_uefi_device_write_bootnext		(FuUefiDevice	*self,
+							 GError		**error);
 gboolean	 fu_uefi_device_write_update_info	(FuUefiDevice	*self,
 							 const gchar	*filename,
 							 const gchar	*varname,
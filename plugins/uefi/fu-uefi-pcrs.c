@@ -14,6 +14,8 @@
 #include "fu-uefi-pcrs.h"
 #include "fwupd-error.h"
 
+#define FU_UEFI_PCRS_CACHE_GROUP		"pcrs"
+
 typedef struct {
 	guint		 idx;
 	gchar		*checksum;
@@ -184,6 +186,71 @@ fu_uefi_pcrs_setup_tpm20 (FuUefiPcrs *self, GError **error)
 	return TRUE;
 }
 
+static gchar *
+fu_uefi_pcrs_get_boot_id (void)
+{
+	g_autofree gchar *buf = NULL;
+	if (!g_file_get_contents ("/proc/sys/kernel/random/boot_id", &buf, NULL, NULL))
+		return NULL;
+	return g_strdup (g_strstrip (buf));
+}
+
+static gchar *
+fu_uefi_pcrs_get_cache_filename (void)
+{
+	g_autofree gchar *localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	return g_build_filename (localstatedir, "pcrs.cache", NULL);
+}
+
+/* the measurements cannot change until the next reboot, and setting up the
+ * TPM context and sending the commands is slow */
+static gboolean
+fu_uefi_pcrs_load_cache (FuUefiPcrs *self, const gchar *boot_id)
+{
+	g_autofree gchar *boot_id_cache = NULL;
+	g_autofree gchar *filename = fu_uefi_pcrs_get_cache_filename ();
+	g_auto(GStrv) checksums = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (kf, filename, G_KEY_FILE_NONE, NULL))
+		return FALSE;
+	boot_id_cache = g_key_file_get_string (kf, FU_UEFI_PCRS_CACHE_GROUP, "BootId", NULL);
+	if (g_strcmp0 (boot_id_cache, boot_id) != 0)
+		return FALSE;
+	checksums = g_key_file_get_string_list (kf, FU_UEFI_PCRS_CACHE_GROUP,
+						"Pcr0", NULL, NULL);
+	if (checksums == NULL || checksums[0] == NULL)
+		return FALSE;
+	for (guint i = 0; checksums[i] != NULL; i++) {
+		FuUefiPcrItem *item = g_new0 (FuUefiPcrItem, 1);
+		item->idx = 0;
+		item->checksum = g_strdup (checksums[i]);
+		g_ptr_array_add (self->items, item);
+		g_debug ("added PCR-%02u=%s from cache", item->idx, item->checksum);
+	}
+	return TRUE;
+}
+
+static void
+fu_uefi_pcrs_save_cache (FuUefiPcrs *self, const gchar *boot_id)
+{
+	g_autofree gchar *filename = fu_uefi_pcrs_get_cache_filename ();
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+	g_autoptr(GPtrArray) checksums = fu_uefi_pcrs_get_checksums (self, 0);
+
+	if (checksums->len == 0)
+		return;
+	g_ptr_array_add (checksums, NULL);
+	g_key_file_set_string (kf, FU_UEFI_PCRS_CACHE_GROUP, "BootId", boot_id);
+	g_key_file_set_string_list (kf, FU_UEFI_PCRS_CACHE_GROUP, "Pcr0",
+				    (const gchar * const *) checksums->pdata,
+				    checksums->len - 1);
+	if (!fu_common_mkdir_parent (filename, &error_local) ||
+	    !g_key_file_save_to_file (kf, filename, &error_local))
+		g_debug ("failed to save PCR cache: %s", error_local->message);
+}
+
 gboolean
 fu_uefi_pcrs_setup (FuUefiPcrs *self, GError **error)
 {
@@ -204,8 +271,13 @@ fu_uefi_pcrs_setup (FuUefiPcrs *self, GError **error)
 
 	/* assume TPM 2.0 */
 	} else {
-		if (!fu_uefi_pcrs_setup_tpm20 (self, error))
-			return FALSE;
+		g_autofree gchar *boot_id = fu_uefi_pcrs_get_boot_id ();
+		if (boot_id == NULL || !fu_uefi_pcrs_load_cache (self, boot_id)) {
+			if (!fu_uefi_pcrs_setup_tpm20 (self, error))
+				return FALSE;
+			if (boot_id != NULL)
+				fu_uefi_pcrs_save_cache (self, boot_id);
+		}
 	}
 
 	/* check we got anything */
@@ -188,29 +188,27 @@ main (int argc, char *argv[])
 	}
 
 	if (action_list || action_supported || action_info) {
-		g_autoptr(GPtrArray) entries = NULL;
-		g_autofree gchar *esrt_path = NULL;
-		g_autofree gchar *sysfsfwdir = NULL;
+		GPtrArray *entries;
+		g_autoptr(FuEsrt) esrt = fu_esrt_new ();
 		g_autoptr(GError) error_local = NULL;
 
-		/* get the directory of ESRT entries */
-		sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
-		esrt_path = g_build_filename (sysfsfwdir, "efi", "esrt", NULL);
-		entries = fu_uefi_get_esrt_entry_paths (esrt_path, &error_local);
-		if (entries == NULL) {
+		/* get the ESRT entries */
+		if (!fu_esrt_load (esrt, &error_local)) {
 			g_printerr ("failed: %s\n", error_local->message);
 			return EXIT_FAILURE;
 		}
+		entries = fu_esrt_get_entries (esrt);
 
 		/* add each device */
 		devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 		for (guint i = 0; i < entries->len; i++) {
-			const gchar *path = g_ptr_array_index (entries, i);
+			FuEsrtEntry *entry = g_ptr_array_index (entries, i);
 			g_autoptr(GError) error_parse = NULL;
-			g_autoptr(FuUefiDevice) dev = fu_uefi_device_new_from_entry (path, &error_parse);
+			g_autoptr(FuUefiDevice) dev = fu_uefi_device_new_from_esrt_entry (entry, &error_parse);
 			if (dev == NULL) {
 				g_warning ("failed to parse %s: %s",
-					   path, error_parse->message);
+					   fu_esrt_entry_get_path (entry),
+					   error_parse->message);
 				continue;
 			}
 			if (esp_path != NULL)
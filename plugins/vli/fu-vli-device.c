@@ -17,6 +17,7 @@ typedef struct {
 	gboolean		 spi_auto_detect;
 	FuVliDeviceSpiReq	 spi_cmds[FU_VLI_DEVICE_SPI_REQ_LAST];
 	guint8			 spi_cmd_read_id_sz;
+	guint16			 spi_read_block_sz;
 	guint32			 flash_id;
 } FuVliDevicePrivate;
 
@@ -255,27 +256,61 @@ fu_vli_device_spi_erase_sector (FuVliDevice *self, guint32 addr, GError **error)
 GBytes *
 fu_vli_device_spi_read (FuVliDevice *self, guint32 address, gsize bufsz, GError **error)
 {
+	FuVliDevicePrivate *priv = GET_PRIVATE (self);
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 	g_autofree guint8 *buf = g_malloc0 (bufsz);
-	g_autoptr(GPtrArray) chunks = NULL;
 
-	/* get data from hardware */
-	chunks = fu_chunk_array_new (buf, bufsz, address, 0x0, FU_VLI_DEVICE_TXSIZE);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
+	/* get data from hardware, using blocks as large as the device allows */
+	fu_chunk_iter_init (&iter, buf, bufsz, address, 0x0, priv->spi_read_block_sz);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (!fu_vli_device_spi_read_block (self,
-						  chk->address,
-						  (guint8 *) chk->data,
-						  chk->data_sz,
+						  chk.address,
+						  (guint8 *) chk.data,
+						  chk.data_sz,
 						  error)) {
-			g_prefix_error (error, "SPI data read failed @0x%x: ", chk->address);
+			g_prefix_error (error, "SPI data read failed @0x%x: ", chk.address);
 			return NULL;
 		}
 		fu_device_set_progress_full (FU_DEVICE (self),
-					     (gsize) i, (gsize) chunks->len);
+					     (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
 }
 
+/* only one block is kept in memory, and @func can abort the read early */
+gboolean
+fu_vli_device_spi_read_chunked (FuVliDevice *self,
+				guint32 address,
+				gsize bufsz,
+				FuDeviceReadChunkFunc func,
+				gpointer user_data,
+				GError **error)
+{
+	FuVliDevicePrivate *priv = GET_PRIVATE (self);
+	gsize blocksz = priv->spi_read_block_sz;
+	g_autofree guint8 *buf = g_malloc0 (blocksz);
+
+	for (gsize offset = 0; offset < bufsz; offset += blocksz) {
+		gsize chunksz = MIN (blocksz, bufsz - offset);
+		if (!fu_vli_device_spi_read_block (self,
+						  address + offset,
+						  buf,
+						  chunksz,
+						  error)) {
+			g_prefix_error (error, "SPI data read failed @0x%x: ",
+					(guint) (address + offset));
+			return FALSE;
+		}
+		if (!func (FU_DEVICE (self), buf, chunksz, user_data, error))
+			return FALSE;
+		fu_device_set_progress_full (FU_DEVICE (self), offset + chunksz, bufsz);
+	}
+	return TRUE;
+}
+
 gboolean
 fu_vli_device_spi_write_block (FuVliDevice *self,
 			       guint32 address,
@@ -283,7 +318,7 @@ fu_vli_device_spi_write_block (FuVliDevice *self,
 			       gsize bufsz,
 			       GError **error)
 {
-	g_autofree guint8 *buf_tmp = g_malloc0 (bufsz);
+	guint8 *buf_tmp;
 
 	/* sanity check */
 	if (bufsz > FU_VLI_DEVICE_TXSIZE) {
@@ -309,6 +344,7 @@ fu_vli_device_spi_write_block (FuVliDevice *self,
 	g_usleep (800);
 
 	/* verify */
+	buf_tmp = fu_device_get_packet_buffer (FU_DEVICE (self), bufsz);
 	if (!fu_vli_device_spi_read_block (self, address, buf_tmp, bufsz, error)) {
 		g_prefix_error (error, "SPI data read failed: ");
 		return FALSE;
@@ -323,38 +359,120 @@ fu_vli_device_spi_write (FuVliDevice *self,
 			 gsize bufsz,
 			 GError **error)
 {
-	FuChunk *chk;
-	g_autoptr(GPtrArray) chunks = NULL;
+	FuChunk chk;
+	FuChunk chk0;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
 
 	/* write SPI data, then CRC bytes last */
 	g_debug ("writing 0x%x bytes @0x%x", (guint) bufsz, address);
-	chunks = fu_chunk_array_new (buf, bufsz, 0x0, 0x0, FU_VLI_DEVICE_TXSIZE);
-	if (chunks->len > 1) {
-		for (guint i = 1; i < chunks->len; i++) {
-			chk = g_ptr_array_index (chunks, i);
-			if (!fu_vli_device_spi_write_block (self,
-							    chk->address + address,
-							    chk->data,
-							    chk->data_sz,
-							    error)) {
-				g_prefix_error (error, "failed to write block 0x%x: ", chk->idx);
-				return FALSE;
-			}
-			fu_device_set_progress_full (FU_DEVICE (self),
-						     (gsize) i - 1,
-						     (gsize) chunks->len);
+	fu_chunk_iter_init (&iter, buf, bufsz, 0x0, 0x0, FU_VLI_DEVICE_TXSIZE);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
+	if (!fu_chunk_iter_next (&iter, &chk0)) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "no data to write");
+		return FALSE;
+	}
+	while (fu_chunk_iter_next (&iter, &chk)) {
+		if (!fu_vli_device_spi_write_block (self,
+						    chk.address + address,
+						    chk.data,
+						    chk.data_sz,
+						    error)) {
+			g_prefix_error (error, "failed to write block 0x%x: ", chk.idx);
+			return FALSE;
 		}
+		fu_device_set_progress_full (FU_DEVICE (self),
+					     (gsize) chk.idx - 1,
+					     (gsize) chunks_cnt);
 	}
-	chk = g_ptr_array_index (chunks, 0);
 	if (!fu_vli_device_spi_write_block (self,
-					    chk->address + address,
-					    chk->data,
-					    chk->data_sz,
+					    chk0.address + address,
+					    chk0.data,
+					    chk0.data_sz,
 					    error)) {
 		g_prefix_error (error, "failed to write CRC block: ");
 		return FALSE;
 	}
-	fu_device_set_progress_full (FU_DEVICE (self), (gsize) chunks->len, (gsize) chunks->len);
+	fu_device_set_progress_full (FU_DEVICE (self), (gsize) chunks_cnt, (gsize) chunks_cnt);
+	return TRUE;
+}
+
+/* only erase and write the sectors that have changed */
+gboolean
+fu_vli_device_spi_write_diff (FuVliDevice *self,
+			      guint32 address,
+			      const guint8 *buf,
+			      gsize bufsz,
+			      GError **error)
+{
+	gboolean write_crc = FALSE;
+	g_autoptr(GBytes) fw_old = NULL;
+	g_autoptr(GBytes) fw_new = g_bytes_new_static (buf, bufsz);
+	g_autoptr(GPtrArray) sectors = NULL;
+
+	/* read back the current contents */
+	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_READ);
+	fw_old = fu_vli_device_spi_read (self, address, bufsz, error);
+	if (fw_old == NULL) {
+		g_prefix_error (error, "failed to read back: ");
+		return FALSE;
+	}
+	sectors = fu_chunk_array_new_diff (fw_old, fw_new, address, 0x1000);
+	g_debug ("0x%x of 0x%x sectors changed @0x%x",
+		 sectors->len, (guint) ((bufsz + 0xfff) / 0x1000), address);
+	if (sectors->len == 0)
+		return TRUE;
+
+	/* make space */
+	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_ERASE);
+	for (guint i = 0; i < sectors->len; i++) {
+		FuChunk *chk = g_ptr_array_index (sectors, i);
+		if (!fu_vli_device_spi_erase_sector (self, chk->address, error)) {
+			g_prefix_error (error,
+					"failed to erase FW sector @0x%x: ",
+					chk->address);
+			return FALSE;
+		}
+		fu_device_set_progress_full (FU_DEVICE (self),
+					     (gsize) i + 1, (gsize) sectors->len);
+	}
+
+	/* write SPI data, then CRC bytes last */
+	fu_device_set_status (FU_DEVICE (self), FWUPD_STATUS_DEVICE_WRITE);
+	for (guint i = 0; i < sectors->len; i++) {
+		FuChunk *chk = g_ptr_array_index (sectors, i);
+		FuChunk blk;
+		FuChunkIter iter;
+		fu_chunk_iter_init (&iter, chk->data, chk->data_sz,
+				    chk->address, 0x0, FU_VLI_DEVICE_TXSIZE);
+		while (fu_chunk_iter_next (&iter, &blk)) {
+			if (blk.address == address) {
+				write_crc = TRUE;
+				continue;
+			}
+			if (!fu_vli_device_spi_write_block (self,
+							    blk.address,
+							    blk.data,
+							    blk.data_sz,
+							    error)) {
+				g_prefix_error (error, "failed to write block @0x%x: ", blk.address);
+				return FALSE;
+			}
+		}
+		fu_device_set_progress_full (FU_DEVICE (self),
+					     (gsize) i + 1, (gsize) sectors->len);
+	}
+	if (write_crc) {
+		if (!fu_vli_device_spi_write_block (self, address, buf,
+						    MIN (bufsz, FU_VLI_DEVICE_TXSIZE),
+						    error)) {
+			g_prefix_error (error, "failed to write CRC block: ");
+			return FALSE;
+		}
+	}
 	return TRUE;
 }
 
@@ -397,20 +515,24 @@ fu_vli_device_spi_erase_all (FuVliDevice *self, GError **error)
 gboolean
 fu_vli_device_spi_erase (FuVliDevice *self, guint32 addr, gsize sz, GError **error)
 {
-	g_autoptr(GPtrArray) chunks = fu_chunk_array_new (NULL, sz, addr, 0x0, 0x1000);
+	FuChunk chk;
+	FuChunkIter iter;
+	guint32 chunks_cnt;
+
+	fu_chunk_iter_init (&iter, NULL, sz, addr, 0x0, 0x1000);
+	chunks_cnt = fu_chunk_iter_get_count (&iter);
 	g_debug ("erasing 0x%x bytes @0x%x", (guint) sz, addr);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chunk = g_ptr_array_index (chunks, i);
+	while (fu_chunk_iter_next (&iter, &chk)) {
 		if (g_getenv ("FWUPD_VLI_USBHUB_VERBOSE") != NULL)
-			g_debug ("erasing @0x%x", chunk->address);
-		if (!fu_vli_device_spi_erase_sector (FU_VLI_DEVICE (self), chunk->address, error)) {
+			g_debug ("erasing @0x%x", chk.address);
+		if (!fu_vli_device_spi_erase_sector (FU_VLI_DEVICE (self), chk.address, error)) {
 			g_prefix_error (error,
 					"failed to erase FW sector @0x%x: ",
-					chunk->address);
+					chk.address);
 			return FALSE;
 		}
 		fu_device_set_progress_full (FU_DEVICE (self),
-					     (gsize) i, (gsize) chunks->len);
+					     (gsize) chk.idx, (gsize) chunks_cnt);
 	}
 	return TRUE;
 }
@@ -476,6 +598,7 @@ fu_vli_device_to_string (FuDevice *device, guint idt, GString *str)
 	fu_common_string_append_kv (str, idt, "DeviceKind",
 				    fu_vli_common_device_kind_to_string (priv->kind));
 	fu_common_string_append_kb (str, idt, "SpiAutoDetect", priv->spi_auto_detect);
+	fu_common_string_append_kx (str, idt, "SpiReadBlockSize", priv->spi_read_block_sz);
 	if (priv->flash_id != 0x0) {
 		g_autofree gchar *tmp = fu_vli_device_get_flash_id_str (self);
 		fu_common_string_append_kv (str, idt, "FlashId", tmp);
@@ -610,6 +733,19 @@ fu_vli_device_set_quirk_kv (FuDevice *device,
 		priv->spi_auto_detect = fu_common_strtoull (value) > 0;
 		return TRUE;
 	}
+	if (g_strcmp0 (key, "SpiReadBlockSize") == 0) {
+		guint64 tmp = fu_common_strtoull (value);
+		if (tmp == 0 || tmp > FU_VLI_DEVICE_READ_BLOCK_SIZE_MAX) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "SpiReadBlockSize 0x%x is not supported",
+				     (guint) tmp);
+			return FALSE;
+		}
+		priv->spi_read_block_sz = tmp;
+		return TRUE;
+	}
 	if (g_strcmp0 (key, "DeviceKind") == 0) {
 		FuVliDeviceKind device_kind;
 		device_kind = fu_vli_common_device_kind_from_string (value);
@@ -682,6 +818,7 @@ fu_vli_device_init (FuVliDevice *self)
 	priv->spi_cmds[FU_VLI_DEVICE_SPI_REQ_CHIP_ERASE]	= 0x60;
 	priv->spi_cmds[FU_VLI_DEVICE_SPI_REQ_READ_ID]		= 0x9f;
 	priv->spi_cmd_read_id_sz = 2;
+	priv->spi_read_block_sz = FU_VLI_DEVICE_TXSIZE;
 	priv->spi_auto_detect = TRUE;
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_ADD_COUNTERPART_GUIDS);
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_NO_GUID_MATCHING);
@@ -60,6 +60,7 @@ typedef enum {
 
 #define FU_VLI_DEVICE_TIMEOUT			3000	/* ms */
 #define FU_VLI_DEVICE_TXSIZE			0x20	/* bytes */
+#define FU_VLI_DEVICE_READ_BLOCK_SIZE_MAX	0x1000	/* bytes */
 
 void		 fu_vli_device_set_kind			(FuVliDevice	*self,
 							 FuVliDeviceKind device_kind);
@@ -89,6 +90,12 @@ GBytes		*fu_vli_device_spi_read			(FuVliDevice	*self,
 							 guint32	 address,
 							 gsize		 bufsz,
 							 GError		**error);
+gboolean	 fu_vli_device_spi_read_chunked		(FuVliDevice	*self,
+							 guint32	 address,
+							 gsize		 bufsz,
+							 FuDeviceReadChunkFunc func,
+							 gpointer	 user_data,
+							 GError		**error);
 gboolean	 fu_vli_device_spi_write_block		(FuVliDevice	*self,
 							 guint32	 address,
 							 const guint8	*buf,
@@ -99,3 +106,8 @@ gboolean	 fu_vli_device_spi_write		(FuVliDevice	*self,
 							 const guint8	*buf,
 							 gsize		 bufsz,
 							 GError		**error);
+gboolean	 fu_vli_device_spi_write_diff		(FuVliDevice	*self,
+							 guint32	 address,
+							 const guint8	*buf,
+							 gsize		 bufsz,
+							 GError		**error);
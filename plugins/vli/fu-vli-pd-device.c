@@ -377,6 +377,18 @@ fu_vli_pd_device_read_firmware (FuDevice *device, GError **error)
 	return fu_firmware_new_from_bytes (fw);
 }
 
+static gboolean
+fu_vli_pd_device_read_firmware_chunked (FuDevice *device,
+					FuDeviceReadChunkFunc func,
+					gpointer user_data,
+					GError **error)
+{
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	return fu_vli_device_spi_read_chunked (FU_VLI_DEVICE (device), 0x0,
+					       fu_device_get_firmware_size_max (device),
+					       func, user_data, error);
+}
+
 static gboolean
 fu_vli_pd_device_write_gpios (FuVliPdDevice *self, GError **error)
 {
@@ -626,6 +638,7 @@ fu_vli_pd_device_class_init (FuVliPdDeviceClass *klass)
 	FuDeviceClass *klass_device = FU_DEVICE_CLASS (klass);
 	FuVliDeviceClass *klass_vli_device = FU_VLI_DEVICE_CLASS (klass);
 	klass_device->read_firmware = fu_vli_pd_device_read_firmware;
+	klass_device->read_firmware_chunked = fu_vli_pd_device_read_firmware_chunked;
 	klass_device->write_firmware = fu_vli_pd_device_write_firmware;
 	klass_device->prepare_firmware = fu_vli_pd_device_prepare_firmware;
 	klass_device->attach = fu_vli_pd_device_attach;
@@ -191,9 +191,16 @@ fu_vli_usbhub_pd_device_write_firmware (FuDevice *device,
 	if (locker == NULL)
 		return FALSE;
 
+	/* only write what has changed */
+	buf = g_bytes_get_data (fw, &bufsz);
+	if (fu_device_has_custom_flag (FU_DEVICE (parent), "diff-write")) {
+		return fu_vli_device_spi_write_diff (FU_VLI_DEVICE (parent),
+						     fu_vli_common_device_kind_get_offset (self->device_kind),
+						     buf, bufsz, error);
+	}
+
 	/* erase */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
-	buf = g_bytes_get_data (fw, &bufsz);
 	if (!fu_vli_device_spi_erase (FU_VLI_DEVICE (parent),
 				      fu_vli_common_device_kind_get_offset (self->device_kind),
 				      bufsz, error))
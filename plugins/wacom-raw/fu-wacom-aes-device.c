@@ -159,12 +159,11 @@ fu_wacom_aes_device_erase_all (FuWacomAesDevice *self, GError **error)
 	};
 	FuWacomRawResponse rsp = { 0x00 };
 	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp,
-				  2000 * 1000, /* this takes a long time */
+				  FU_WACOM_RAW_ERASE_TIMEOUT, /* this takes a long time */
 				  FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING, error)) {
 		g_prefix_error (error, "failed to send eraseall command: ");
 		return FALSE;
 	}
-	g_usleep (2 * G_USEC_PER_SEC);
 	return TRUE;
 }
 
@@ -187,18 +186,19 @@ fu_wacom_aes_device_write_block (FuWacomAesDevice *self,
 	FuWacomRawResponse rsp = { 0x00 };
 
 	/* check size */
-	if (datasz != blocksz) {
+	if (datasz == 0 || datasz % blocksz != 0 || datasz > sizeof(req.data)) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
-			     "block size 0x%x != 0x%x untested",
+			     "data size 0x%x not a multiple of block size 0x%x",
 			     datasz, (guint) blocksz);
 		return FALSE;
 	}
 	memcpy (&req.data, data, datasz);
 
 	/* write */
-	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp, 1000,
+	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp,
+				  FU_WACOM_RAW_CMD_TIMEOUT,
 				  FU_WACOM_DEVICE_CMD_FLAG_NONE, error)) {
 		g_prefix_error (error, "failed to write block %u: ", idx);
 		return FALSE;
@@ -210,11 +210,14 @@ static gboolean
 fu_wacom_aes_device_write_firmware (FuDevice *device, GPtrArray *chunks, GError **error)
 {
 	FuWacomAesDevice *self = FU_WACOM_AES_DEVICE (device);
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* erase */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
 	if (!fu_wacom_aes_device_erase_all (self, error))
 		return FALSE;
+	g_debug ("erase took %.0fms", g_timer_elapsed (timer, NULL) * 1000.f);
+	g_timer_reset (timer);
 
 	/* write */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
@@ -229,6 +232,8 @@ fu_wacom_aes_device_write_firmware (FuDevice *device, GPtrArray *chunks, GError
 			return FALSE;
 		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len);
 	}
+	g_debug ("writing %u chunks took %.0fms",
+		 chunks->len, g_timer_elapsed (timer, NULL) * 1000.f);
 	return TRUE;
 }
 
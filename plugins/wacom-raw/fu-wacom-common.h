@@ -8,7 +8,9 @@
 
 #include <glib-object.h>
 
-#define FU_WACOM_RAW_CMD_RETRIES		1000
+#define FU_WACOM_RAW_CMD_TIMEOUT		1000	/* ms */
+#define FU_WACOM_RAW_ERASE_TIMEOUT		120000	/* ms */
+#define FU_WACOM_RAW_MODE_SWITCH_TIMEOUT	300	/* ms */
 
 #define FU_WACOM_RAW_STATUS_REPORT_ID		0x04
 #define FU_WACOM_RAW_STATUS_REPORT_SZ		16
@@ -17,6 +17,7 @@
 typedef struct
 {
 	guint			 flash_block_size;
+	guint			 flash_blocks_per_write;
 	guint32			 flash_base_addr;
 	guint32			 flash_size;
 } FuWacomDevicePrivate;
@@ -31,6 +32,7 @@ fu_wacom_device_to_string (FuDevice *device, guint idt, GString *str)
 	FuWacomDevice *self = FU_WACOM_DEVICE (device);
 	FuWacomDevicePrivate *priv = GET_PRIVATE (self);
 	fu_common_string_append_kx (str, idt, "FlashBlockSize", priv->flash_block_size);
+	fu_common_string_append_ku (str, idt, "FlashBlocksPerWrite", priv->flash_blocks_per_write);
 	fu_common_string_append_kx (str, idt, "FlashBaseAddr", priv->flash_base_addr);
 	fu_common_string_append_kx (str, idt, "FlashSize", priv->flash_size);
 }
@@ -98,6 +100,37 @@ fu_wacom_device_probe (FuUdevDevice *device, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_wacom_device_check_mode (FuWacomDevice *self, GError **error);
+
+static gboolean
+fu_wacom_device_check_mode_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	return fu_wacom_device_check_mode (FU_WACOM_DEVICE (device), error);
+}
+
+static gboolean
+fu_wacom_device_check_runtime_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	guint8 buf[FU_WACOM_RAW_FW_REPORT_SZ] = {
+		FU_WACOM_RAW_FW_REPORT_ID,
+		FU_WACOM_RAW_FW_CMD_QUERY_MODE,
+	};
+
+	/* 0x00=runtime, 0x02=bootloader */
+	if (!fu_wacom_device_get_feature (FU_WACOM_DEVICE (device), buf, sizeof(buf), error))
+		return FALSE;
+	if (buf[1] != 0x00) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_BUSY,
+			     "not in runtime mode, got 0x%02x",
+			     buf[1]);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_wacom_device_detach (FuDevice *device, GError **error)
 {
@@ -106,6 +139,7 @@ fu_wacom_device_detach (FuDevice *device, GError **error)
 		FU_WACOM_RAW_FW_REPORT_ID,
 		FU_WACOM_RAW_FW_CMD_DETACH,
 	};
+	g_autoptr(GError) error_local = NULL;
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_IS_BOOTLOADER)) {
 		g_debug ("already in bootloader mode, skipping");
 		return TRUE;
@@ -114,7 +148,12 @@ fu_wacom_device_detach (FuDevice *device, GError **error)
 		g_prefix_error (error, "failed to switch to bootloader mode: ");
 		return FALSE;
 	}
-	g_usleep (300 * 1000);
+
+	/* the mode is checked again before writing, so carry on regardless */
+	if (!fu_device_retry_with_backoff (device, fu_wacom_device_check_mode_cb,
+					   1, FU_WACOM_RAW_MODE_SWITCH_TIMEOUT,
+					   NULL, &error_local))
+		g_debug ("bootloader did not respond: %s", error_local->message);
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_IS_BOOTLOADER);
 	return TRUE;
 }
@@ -129,6 +168,7 @@ fu_wacom_device_attach (FuDevice *device, GError **error)
 		.echo = FU_WACOM_RAW_ECHO_DEFAULT,
 		0x00
 	};
+	g_autoptr(GError) error_local = NULL;
 	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_IS_BOOTLOADER)) {
 		g_debug ("already in runtime mode, skipping");
 		return TRUE;
@@ -138,7 +178,10 @@ fu_wacom_device_attach (FuDevice *device, GError **error)
 		return FALSE;
 	}
 	/* only required on AES, but harmless for EMR */
-	g_usleep (300 * 1000);
+	if (!fu_device_retry_with_backoff (device, fu_wacom_device_check_runtime_cb,
+					   1, FU_WACOM_RAW_MODE_SWITCH_TIMEOUT,
+					   NULL, &error_local))
+		g_debug ("runtime did not respond: %s", error_local->message);
 	fu_device_remove_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_IS_BOOTLOADER);
 	return TRUE;
 }
@@ -209,6 +252,7 @@ fu_wacom_device_write_firmware (FuDevice *device,
 	FuWacomDevice *self = FU_WACOM_DEVICE (device);
 	FuWacomDevicePrivate *priv = GET_PRIVATE (self);
 	FuWacomDeviceClass *klass = FU_WACOM_DEVICE_GET_CLASS (device);
+	guint write_sz = priv->flash_block_size * priv->flash_blocks_per_write;
 	g_autoptr(FuFirmwareImage) img = NULL;
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(GPtrArray) chunks = NULL;
@@ -241,6 +285,16 @@ fu_wacom_device_write_firmware (FuDevice *device,
 		return FALSE;
 	}
 
+	/* several blocks can be sent in one report if the bootloader allows */
+	if (write_sz == 0 || write_sz > sizeof(((FuWacomRawRequest *) NULL)->data)) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "write size invalid: 0x%x",
+			     write_sz);
+		return FALSE;
+	}
+
 	/* we're in bootloader mode now */
 	if (!fu_wacom_device_check_mode (self, error))
 		return FALSE;
@@ -250,7 +304,7 @@ fu_wacom_device_write_firmware (FuDevice *device,
 	/* flash chunks */
 	chunks = fu_chunk_array_new_from_bytes (fw, priv->flash_base_addr,
 						0x00,	/* page_sz */
-						priv->flash_block_size);
+						write_sz);
 	return klass->write_firmware (device, chunks, error);
 }
 
@@ -280,44 +334,74 @@ fu_wacom_device_get_feature (FuWacomDevice *self,
 	return TRUE;
 }
 
+typedef struct {
+	FuWacomRawRequest	*req;
+	FuWacomRawResponse	*rsp;
+	FuWacomDeviceCmdFlags	 flags;
+} FuWacomDeviceCmdHelper;
+
+static gboolean
+fu_wacom_device_cmd_response_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	FuWacomDevice *self = FU_WACOM_DEVICE (device);
+	FuWacomDeviceCmdHelper *helper = (FuWacomDeviceCmdHelper *) user_data;
+	FuWacomRawResponse *rsp = helper->rsp;
+
+	rsp->report_id = FU_WACOM_RAW_BL_REPORT_ID_GET;
+	if (!fu_wacom_device_get_feature (self, (guint8 *) rsp, sizeof(*rsp), error)) {
+		g_prefix_error (error, "failed to receive: ");
+		return FALSE;
+	}
+
+	/* still the reply to the previous command */
+	if (!fu_wacom_common_check_reply (helper->req, rsp, error))
+		return FALSE;
+
+	/* wait for the command to complete */
+	if (rsp->resp == FU_WACOM_RAW_RC_IN_PROGRESS ||
+	    (rsp->resp == FU_WACOM_RAW_RC_BUSY &&
+	     helper->flags & FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING)) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_BUSY,
+			     "command 0x%02x in progress, got 0x%02x",
+			     helper->req->cmd, rsp->resp);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 gboolean
 fu_wacom_device_cmd (FuWacomDevice *self,
 		     FuWacomRawRequest *req, FuWacomRawResponse *rsp,
-		     gulong delay_us, FuWacomDeviceCmdFlags flags,
+		     guint timeout_ms, FuWacomDeviceCmdFlags flags,
 		     GError **error)
 {
+	FuWacomDeviceCmdHelper helper = {
+		.req = req,
+		.rsp = rsp,
+		.flags = flags,
+	};
+
 	req->report_id = FU_WACOM_RAW_BL_REPORT_ID_SET;
 	if (!fu_wacom_device_set_feature (self, (const guint8 *)req, sizeof(*req), error)) {
 		g_prefix_error (error, "failed to send: ");
 		return FALSE;
 	}
-	if (delay_us > 0)
-		g_usleep (delay_us);
-	rsp->report_id = FU_WACOM_RAW_BL_REPORT_ID_GET;
-	if (!fu_wacom_device_get_feature (self, (guint8 *)rsp, sizeof(*rsp), error)) {
-		g_prefix_error (error, "failed to receive: ");
-		return FALSE;
-	}
-	if (flags & FU_WACOM_DEVICE_CMD_FLAG_NO_ERROR_CHECK)
-		return TRUE;
-	if (!fu_wacom_common_check_reply (req, rsp, error))
-		return FALSE;
-
-	/* wait for the command to complete */
-	if (flags & FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING &&
-	    rsp->resp != FU_WACOM_RAW_RC_OK) {
-		for (guint i = 0; i < FU_WACOM_RAW_CMD_RETRIES; i++) {
-			if (delay_us > 0)
-				g_usleep (delay_us);
-			if (!fu_wacom_device_get_feature (self, (guint8 *)rsp, sizeof(*rsp), error))
-				return FALSE;
-			if (!fu_wacom_common_check_reply (req, rsp, error))
-				return FALSE;
-			if (rsp->resp != FU_WACOM_RAW_RC_IN_PROGRESS &&
-			    rsp->resp != FU_WACOM_RAW_RC_BUSY)
-				break;
+	if (flags & FU_WACOM_DEVICE_CMD_FLAG_NO_ERROR_CHECK) {
+		rsp->report_id = FU_WACOM_RAW_BL_REPORT_ID_GET;
+		if (!fu_wacom_device_get_feature (self, (guint8 *)rsp, sizeof(*rsp), error)) {
+			g_prefix_error (error, "failed to receive: ");
+			return FALSE;
 		}
+		return TRUE;
 	}
+
+	/* query the status rather than sleeping for the worst case */
+	if (!fu_device_retry_with_backoff (FU_DEVICE (self),
+					   fu_wacom_device_cmd_response_cb,
+					   1, timeout_ms, &helper, error))
+		return FALSE;
 	return fu_wacom_common_rc_set_error (rsp, error);
 }
 
@@ -333,6 +417,10 @@ fu_wacom_device_set_quirk_kv (FuDevice *device,
 		priv->flash_block_size = fu_common_strtoull (value);
 		return TRUE;
 	}
+	if (g_strcmp0 (key, "WacomI2cFlashBlocksPerWrite") == 0) {
+		priv->flash_blocks_per_write = fu_common_strtoull (value);
+		return TRUE;
+	}
 	if (g_strcmp0 (key, "WacomI2cFlashBaseAddr") == 0) {
 		priv->flash_base_addr = fu_common_strtoull (value);
 		return TRUE;
@@ -351,6 +439,8 @@ fu_wacom_device_set_quirk_kv (FuDevice *device,
 static void
 fu_wacom_device_init (FuWacomDevice *self)
 {
+	FuWacomDevicePrivate *priv = GET_PRIVATE (self);
+	priv->flash_blocks_per_write = 1;
 	fu_device_set_protocol (FU_DEVICE (self), "com.wacom.raw");
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_UPDATABLE);
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_INTERNAL);
@@ -37,7 +37,7 @@ gboolean	 fu_wacom_device_get_feature	(FuWacomDevice	*self,
 gboolean	 fu_wacom_device_cmd		(FuWacomDevice	*self,
 						 FuWacomRawRequest *req,
 						 FuWacomRawResponse *rsp,
-						 gulong		 delay_us,
+						 guint		 timeout_ms,
 						 FuWacomDeviceCmdFlags flags,
 						 GError 	**error);
 gboolean	 fu_wacom_device_erase_all	(FuWacomDevice	*self,
@@ -72,12 +72,12 @@ fu_wacom_emr_device_w9013_erase_data (FuWacomEmrDevice *self, GError **error)
 	buf[0] = 0x00; /* erased block */
 	buf[1] = fu_wacom_emr_device_calc_checksum (0x05 + 0x00 + 0x07 + 0x00,
 						    (const guint8 *) &req, 4);
-	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp, 50,
+	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp,
+				  FU_WACOM_RAW_CMD_TIMEOUT,
 				  FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING, error)) {
 		g_prefix_error (error, "failed to erase datamem: ");
 		return FALSE;
 	}
-	g_usleep (50);
 	return TRUE;
 }
 
@@ -97,12 +97,12 @@ fu_wacom_emr_device_w9013_erase_code (FuWacomEmrDevice *self,
 	buf[0] = block_nr;
 	buf[1] = fu_wacom_emr_device_calc_checksum (0x05 + 0x00 + 0x07 + 0x00,
 						    (const guint8 *) &req, 4);
-	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp, 50,
+	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp,
+				  FU_WACOM_RAW_CMD_TIMEOUT,
 				  FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING, error)) {
 		g_prefix_error (error, "failed to erase codemem: ");
 		return FALSE;
 	}
-	g_usleep (50);
 	return TRUE;
 }
 
@@ -116,7 +116,7 @@ fu_wacom_device_w9021_erase_all (FuWacomEmrDevice *self, GError **error)
 	};
 	FuWacomRawResponse rsp = { 0x00 };
 	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp,
-				  2000 * 1000, /* this takes a long time */
+				  FU_WACOM_RAW_ERASE_TIMEOUT, /* this takes a long time */
 				  FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING, error)) {
 		g_prefix_error (error, "failed to send eraseall command: ");
 		return FALSE;
@@ -125,7 +125,6 @@ fu_wacom_device_w9021_erase_all (FuWacomEmrDevice *self, GError **error)
 		g_prefix_error (error, "failed to erase");
 		return FALSE;
 	}
-	g_usleep (50);
 	return TRUE;
 }
 
@@ -156,11 +155,11 @@ fu_wacom_emr_device_write_block (FuWacomEmrDevice *self,
 			     datasz);
 		return FALSE;
 	}
-	if (datasz != blocksz) {
+	if (datasz == 0 || datasz % blocksz != 0) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
-			     "block size 0x%x != 0x%x untested",
+			     "data size 0x%x not a multiple of block size 0x%x",
 			     datasz, (guint) blocksz);
 		return FALSE;
 	}
@@ -169,10 +168,11 @@ fu_wacom_emr_device_write_block (FuWacomEmrDevice *self,
 	memcpy (&req.data, data, datasz);
 
 	/* cmd and data checksums */
-	req.data[blocksz + 0] = fu_wacom_emr_device_calc_checksum (0x05 + 0x00 + 0x4c + 0x00,
-								   (const guint8 *) &req, 8);
-	req.data[blocksz + 1] = fu_wacom_emr_device_calc_checksum (0x00, data, datasz);
-	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp, 50,
+	req.data[datasz + 0] = fu_wacom_emr_device_calc_checksum (0x05 + 0x00 + 0x4c + 0x00,
+								  (const guint8 *) &req, 8);
+	req.data[datasz + 1] = fu_wacom_emr_device_calc_checksum (0x00, data, datasz);
+	if (!fu_wacom_device_cmd (FU_WACOM_DEVICE (self), &req, &rsp,
+				  FU_WACOM_RAW_CMD_TIMEOUT,
 				  FU_WACOM_DEVICE_CMD_FLAG_NONE, error)) {
 		g_prefix_error (error, "failed to write at 0x%x: ", address);
 		return FALSE;
@@ -185,6 +185,7 @@ fu_wacom_emr_device_write_firmware (FuDevice *device, GPtrArray *chunks, GError
 {
 	FuWacomEmrDevice *self = FU_WACOM_EMR_DEVICE (device);
 	guint8 idx = 0;
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* erase W9013 */
 	if (fu_device_has_instance_id (device, "WacomEMR_W9013")) {
@@ -202,6 +203,8 @@ fu_wacom_emr_device_write_firmware (FuDevice *device, GPtrArray *chunks, GError
 		if (!fu_wacom_device_w9021_erase_all (self, error))
 			return FALSE;
 	}
+	g_debug ("erase took %.0fms", g_timer_elapsed (timer, NULL) * 1000.f);
+	g_timer_reset (timer);
 
 	/* write */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
@@ -218,6 +221,8 @@ fu_wacom_emr_device_write_firmware (FuDevice *device, GPtrArray *chunks, GError
 			return FALSE;
 		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len);
 	}
+	g_debug ("writing %u chunks took %.0fms",
+		 chunks->len, g_timer_elapsed (timer, NULL) * 1000.f);
 
 	fu_device_set_progress (device, 100);
 	return TRUE;
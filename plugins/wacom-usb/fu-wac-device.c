@@ -309,7 +309,7 @@ fu_wac_device_write_block (FuWacDevice *self,
 	const guint8 *tmp;
 	gsize bufsz = self->write_block_sz + 5;
 	gsize sz = 0;
-	g_autofree guint8 *buf = NULL;
+	guint8 *buf;
 
 	/* check size */
 	tmp = g_bytes_get_data (blob, &sz);
@@ -323,7 +323,7 @@ fu_wac_device_write_block (FuWacDevice *self,
 	}
 
 	/* build packet */
-	buf = g_malloc (bufsz);
+	buf = fu_device_get_packet_buffer (FU_DEVICE (self), bufsz);
 	memset (buf, 0xff, bufsz);
 	buf[0] = FU_WAC_REPORT_ID_WRITE_BLOCK;
 	fu_common_write_uint32 (buf + 1, addr, G_LITTLE_ENDIAN);
@@ -450,6 +450,7 @@ fu_wac_device_write_firmware (FuDevice *device,
 	FuWacDevice *self = FU_WAC_DEVICE (device);
 	gsize blocks_done = 0;
 	gsize blocks_total = 0;
+	g_autofree gboolean *unchanged = NULL;
 	g_autofree guint32 *csum_local = NULL;
 	g_autoptr(FuFirmwareImage) img = NULL;
 	g_autoptr(GHashTable) fd_blobs = NULL;
@@ -480,19 +481,11 @@ fu_wac_device_write_firmware (FuDevice *device,
 	if (!fu_wac_device_ensure_checksums (self, error))
 		return FALSE;
 
-	/* clear all checksums of pages */
-	fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
-	for (guint16 i = 0; i < self->flash_descriptors->len; i++) {
-		FuWacFlashDescriptor *fd = g_ptr_array_index (self->flash_descriptors, i);
-		if (fu_wav_device_flash_descriptor_is_wp (fd))
-			continue;
-		if (!fu_wac_device_set_checksum_of_block (self, i, 0x0, error))
-			return FALSE;
-	}
-
-	/* get the blobs for each chunk */
+	/* get the blobs and expected checksum for each chunk */
 	fd_blobs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
 					  NULL, (GDestroyNotify) g_bytes_unref);
+	csum_local = g_new0 (guint32, self->flash_descriptors->len);
+	unchanged = g_new0 (gboolean, self->flash_descriptors->len);
 	for (guint16 i = 0; i < self->flash_descriptors->len; i++) {
 		FuWacFlashDescriptor *fd = g_ptr_array_index (self->flash_descriptors, i);
 		GBytes *blob_block;
@@ -508,6 +501,29 @@ fu_wac_device_write_firmware (FuDevice *device,
 			break;
 		blob_block = fu_common_bytes_pad (blob_tmp, fd->block_sz);
 		g_hash_table_insert (fd_blobs, fd, blob_block);
+		csum_local[i] = fu_wac_calculate_checksum32le_bytes (blob_block);
+		g_debug ("block checksum %02u: 0x%08x", i, csum_local[i]);
+
+		/* the checksum is a plain sum, so this is opt-in */
+		if (fu_device_has_custom_flag (device, "skip-unchanged-blocks") &&
+		    i < self->checksums->len &&
+		    !fu_common_bytes_is_empty (blob_block) &&
+		    g_array_index (self->checksums, guint32, i) == csum_local[i]) {
+			g_debug ("block %02u unchanged, skipping", i);
+			unchanged[i] = TRUE;
+		}
+	}
+
+	/* clear all checksums of pages */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_ERASE);
+	for (guint16 i = 0; i < self->flash_descriptors->len; i++) {
+		FuWacFlashDescriptor *fd = g_ptr_array_index (self->flash_descriptors, i);
+		if (fu_wav_device_flash_descriptor_is_wp (fd))
+			continue;
+		if (unchanged[i])
+			continue;
+		if (!fu_wac_device_set_checksum_of_block (self, i, 0x0, error))
+			return FALSE;
 	}
 
 	/* checksum actions post-write */
@@ -515,11 +531,11 @@ fu_wac_device_write_firmware (FuDevice *device,
 
 	/* write the data into the flash page */
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	csum_local = g_new0 (guint32, self->flash_descriptors->len);
 	for (guint16 i = 0; i < self->flash_descriptors->len; i++) {
 		FuWacFlashDescriptor *fd = g_ptr_array_index (self->flash_descriptors, i);
+		FuChunk chk;
+		FuChunkIter iter;
 		GBytes *blob_block;
-		g_autoptr(GPtrArray) chunks = NULL;
 
 		/* if page is protected */
 		if (fu_wav_device_flash_descriptor_is_wp (fd))
@@ -530,9 +546,8 @@ fu_wac_device_write_firmware (FuDevice *device,
 		if (blob_block == NULL)
 			break;
 
-		/* ignore empty blocks */
-		if (fu_common_bytes_is_empty (blob_block)) {
-			g_debug ("empty block, ignoring");
+		/* ignore empty and unchanged blocks */
+		if (fu_common_bytes_is_empty (blob_block) || unchanged[i]) {
 			fu_device_set_progress_full (device, blocks_done++, blocks_total);
 			continue;
 		}
@@ -542,20 +557,17 @@ fu_wac_device_write_firmware (FuDevice *device,
 			return FALSE;
 
 		/* write block in chunks */
-		chunks = fu_chunk_array_new_from_bytes (blob_block,
-							fd->start_addr,
-							0, /* page_sz */
-							self->write_block_sz);
-		for (guint j = 0; j < chunks->len; j++) {
-			FuChunk *chk = g_ptr_array_index (chunks, j);
-			g_autoptr(GBytes) blob_chunk = g_bytes_new (chk->data, chk->data_sz);
-			if (!fu_wac_device_write_block (self, chk->address, blob_chunk, error))
+		fu_chunk_iter_init_bytes (&iter, blob_block,
+					  fd->start_addr,
+					  0, /* page_sz */
+					  self->write_block_sz);
+		while (fu_chunk_iter_next (&iter, &chk)) {
+			g_autoptr(GBytes) blob_chunk = g_bytes_new (chk.data, chk.data_sz);
+			if (!fu_wac_device_write_block (self, chk.address, blob_chunk, error))
 				return FALSE;
 		}
 
-		/* calculate expected checksum and save to device RAM */
-		csum_local[i] = fu_wac_calculate_checksum32le_bytes (blob_block);
-		g_debug ("block checksum %02u: 0x%08x", i, csum_local[i]);
+		/* save expected checksum to device RAM */
 		if (!fu_wac_device_set_checksum_of_block (self, i, csum_local[i], error))
 			return FALSE;
 
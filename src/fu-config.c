@@ -13,6 +13,7 @@
 
 #include "fu-common.h"
 #include "fu-config.h"
+#include "fu-file-watch.h"
 
 enum {
 	SIGNAL_CHANGED,
@@ -26,13 +27,21 @@ static void fu_config_finalize	 (GObject *obj);
 struct _FuConfig
 {
 	GObject			 parent_instance;
-	GFileMonitor		*monitor;
+	FuFileWatch		*file_watch;
+	guint			 watch_id;
 	GPtrArray		*disabled_devices;	/* (element-type utf-8) */
 	GPtrArray		*disabled_plugins;	/* (element-type utf-8) */
 	GPtrArray		*approved_firmware;	/* (element-type utf-8) */
 	guint64			 archive_size_max;
+	guint64			 archive_cache_size_max;
+	guint64			 memory_budget;		/* 0 for no limit */
 	guint			 idle_timeout;
+	guint			 udev_change_debounce;	/* ms */
+	guint			 progress_notify_rate;	/* Hz */
+	guint			 history_max_age;	/* days */
+	guint			 history_max_entries;
 	gchar			*config_file;
+	gchar			*metrics_socket;
 	gboolean		 update_motd;
 	gboolean		 enumerate_all_devices;
 };
@@ -51,10 +60,12 @@ fu_config_reload (FuConfig *self, GError **error)
 {
 	guint64 archive_size_max;
 	guint idle_timeout;
+	guint udev_change_debounce;
 	g_auto(GStrv) approved_firmware = NULL;
 	g_auto(GStrv) devices = NULL;
 	g_auto(GStrv) plugins = NULL;
 	g_autofree gchar *domains = NULL;
+	g_autofree gchar *metrics_socket = NULL;
 	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
 	g_autoptr(GError) error_update_motd = NULL;
 	g_autoptr(GError) error_enumerate_all = NULL;
@@ -114,6 +125,20 @@ fu_config_reload (FuConfig *self, GError **error)
 	if (archive_size_max > 0)
 		self->archive_size_max = archive_size_max *= 0x100000;
 
+	/* get maximum size of parsed archives to keep, where 0 disables */
+	if (g_key_file_has_key (keyfile, "fwupd", "ArchiveCacheSizeMax", NULL)) {
+		self->archive_cache_size_max = g_key_file_get_uint64 (keyfile,
+								      "fwupd",
+								      "ArchiveCacheSizeMax",
+								      NULL) * 0x100000;
+	}
+
+	/* get the total size of the caches and loaded archives, where 0 is unlimited */
+	self->memory_budget = g_key_file_get_uint64 (keyfile,
+						     "fwupd",
+						     "MemoryBudget",
+						     NULL) * 0x100000;
+
 	/* get idle timeout */
 	idle_timeout = g_key_file_get_uint64 (keyfile,
 					      "fwupd",
@@ -122,6 +147,38 @@ fu_config_reload (FuConfig *self, GError **error)
 	if (idle_timeout > 0)
 		self->idle_timeout = idle_timeout;
 
+	/* get how long to wait for more udev change events */
+	udev_change_debounce = g_key_file_get_uint64 (keyfile,
+						      "fwupd",
+						      "UdevChangeDebounce",
+						      NULL);
+	if (udev_change_debounce > 0)
+		self->udev_change_debounce = udev_change_debounce;
+
+	/* get how often progress can cause a device change, where 0 is unlimited */
+	if (g_key_file_has_key (keyfile, "fwupd", "ProgressNotifyRate", NULL)) {
+		self->progress_notify_rate = g_key_file_get_uint64 (keyfile,
+								    "fwupd",
+								    "ProgressNotifyRate",
+								    NULL);
+	}
+
+	/* get how long to keep history entries, where 0 is forever */
+	if (g_key_file_has_key (keyfile, "fwupd", "HistoryMaxAge", NULL)) {
+		self->history_max_age = g_key_file_get_uint64 (keyfile,
+							       "fwupd",
+							       "HistoryMaxAge",
+							       NULL);
+	}
+
+	/* get how many history entries to keep, where 0 is unlimited */
+	if (g_key_file_has_key (keyfile, "fwupd", "HistoryMaxEntries", NULL)) {
+		self->history_max_entries = g_key_file_get_uint64 (keyfile,
+								   "fwupd",
+								   "HistoryMaxEntries",
+								   NULL);
+	}
+
 	/* get the domains to run in verbose */
 	domains = g_key_file_get_string (keyfile,
 					 "fwupd",
@@ -130,6 +187,15 @@ fu_config_reload (FuConfig *self, GError **error)
 	if (domains != NULL && domains[0] != '\0')
 		g_setenv ("FWUPD_VERBOSE", domains, TRUE);
 
+	/* optional unix socket to serve metrics on */
+	g_clear_pointer (&self->metrics_socket, g_free);
+	metrics_socket = g_key_file_get_string (keyfile,
+						"fwupd",
+						"MetricsSocket",
+						NULL);
+	if (metrics_socket != NULL && metrics_socket[0] != '\0')
+		self->metrics_socket = g_steal_pointer (&metrics_socket);
+
 	/* whether to update the motd on changes */
 	self->update_motd = g_key_file_get_boolean (keyfile,
 						   "fwupd",
@@ -155,11 +221,9 @@ fu_config_reload (FuConfig *self, GError **error)
 }
 
 static void
-fu_config_monitor_changed_cb (GFileMonitor *monitor,
-			      GFile *file,
-			      GFile *other_file,
-			      GFileMonitorEvent event_type,
-			      gpointer user_data)
+fu_config_file_watch_changed_cb (FuFileWatch *file_watch,
+				 const gchar *filename,
+				 gpointer user_data)
 {
 	FuConfig *self = FU_CONFIG (user_data);
 	g_autoptr(GError) error = NULL;
@@ -182,11 +246,19 @@ fu_config_set_key_value (FuConfig *self, const gchar *key, const gchar *value, G
 	return fu_config_reload (self, error);
 }
 
+/* share the daemon-wide watch rather than creating another monitor */
+void
+fu_config_set_file_watch (FuConfig *self, FuFileWatch *file_watch)
+{
+	g_return_if_fail (FU_IS_CONFIG (self));
+	g_return_if_fail (self->watch_id == 0);
+	g_set_object (&self->file_watch, file_watch);
+}
+
 gboolean
 fu_config_load (FuConfig *self, GError **error)
 {
 	g_autofree gchar *configdir = NULL;
-	g_autoptr(GFile) file = NULL;
 
 	g_return_val_if_fail (FU_IS_CONFIG (self), FALSE);
 	g_return_val_if_fail (self->config_file == NULL, FALSE);
@@ -202,12 +274,13 @@ fu_config_load (FuConfig *self, GError **error)
 	}
 
 	/* set up a notify watch */
-	file = g_file_new_for_path (self->config_file);
-	self->monitor = g_file_monitor (file, G_FILE_MONITOR_NONE, NULL, error);
-	if (self->monitor == NULL)
+	if (self->file_watch == NULL)
+		self->file_watch = fu_file_watch_new ();
+	self->watch_id = fu_file_watch_add (self->file_watch, self->config_file,
+					    fu_config_file_watch_changed_cb,
+					    self, error);
+	if (self->watch_id == 0)
 		return FALSE;
-	g_signal_connect (self->monitor, "changed",
-			  G_CALLBACK (fu_config_monitor_changed_cb), self);
 
 	/* success */
 	return TRUE;
@@ -220,6 +293,20 @@ fu_config_get_idle_timeout (FuConfig *self)
 	return self->idle_timeout;
 }
 
+guint
+fu_config_get_udev_change_debounce (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->udev_change_debounce;
+}
+
+guint
+fu_config_get_progress_notify_rate (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->progress_notify_rate;
+}
+
 GPtrArray *
 fu_config_get_disabled_devices (FuConfig *self)
 {
@@ -234,6 +321,20 @@ fu_config_get_archive_size_max (FuConfig *self)
 	return self->archive_size_max;
 }
 
+guint64
+fu_config_get_archive_cache_size_max (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->archive_cache_size_max;
+}
+
+guint64
+fu_config_get_memory_budget (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->memory_budget;
+}
+
 GPtrArray *
 fu_config_get_disabled_plugins (FuConfig *self)
 {
@@ -262,6 +363,27 @@ fu_config_get_enumerate_all_devices (FuConfig *self)
 	return self->enumerate_all_devices;
 }
 
+guint
+fu_config_get_history_max_age (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->history_max_age;
+}
+
+guint
+fu_config_get_history_max_entries (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->history_max_entries;
+}
+
+const gchar *
+fu_config_get_metrics_socket (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), NULL);
+	return self->metrics_socket;
+}
+
 static void
 fu_config_class_init (FuConfigClass *klass)
 {
@@ -279,6 +401,9 @@ static void
 fu_config_init (FuConfig *self)
 {
 	self->archive_size_max = 512 * 0x100000;
+	self->archive_cache_size_max = 64 * 0x100000;
+	self->udev_change_debounce = 500;
+	self->progress_notify_rate = 4;
 	self->disabled_devices = g_ptr_array_new_with_free_func (g_free);
 	self->disabled_plugins = g_ptr_array_new_with_free_func (g_free);
 	self->approved_firmware = g_ptr_array_new_with_free_func (g_free);
@@ -289,12 +414,15 @@ fu_config_finalize (GObject *obj)
 {
 	FuConfig *self = FU_CONFIG (obj);
 
-	if (self->monitor != NULL)
-		g_object_unref (self->monitor);
+	if (self->watch_id != 0)
+		fu_file_watch_remove (self->file_watch, self->watch_id);
+	if (self->file_watch != NULL)
+		g_object_unref (self->file_watch);
 	g_ptr_array_unref (self->disabled_devices);
 	g_ptr_array_unref (self->disabled_plugins);
 	g_ptr_array_unref (self->approved_firmware);
 	g_free (self->config_file);
+	g_free (self->metrics_socket);
 
 	G_OBJECT_CLASS (fu_config_parent_class)->finalize (obj);
 }
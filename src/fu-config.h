@@ -10,10 +10,14 @@
 
 #include "fwupd-remote.h"
 
+#include "fu-file-watch.h"
+
 #define FU_TYPE_CONFIG (fu_config_get_type ())
 G_DECLARE_FINAL_TYPE (FuConfig, fu_config, FU, CONFIG, GObject)
 
 FuConfig	*fu_config_new				(void);
+void		 fu_config_set_file_watch		(FuConfig	*self,
+							 FuFileWatch	*file_watch);
 gboolean	 fu_config_load				(FuConfig	*self,
 							 GError		**error);
 gboolean	 fu_config_set_key_value		(FuConfig	*self,
@@ -22,9 +26,16 @@ gboolean	 fu_config_set_key_value		(FuConfig	*self,
 							 GError		**error);
 
 guint64		 fu_config_get_archive_size_max		(FuConfig	*self);
+guint64		 fu_config_get_archive_cache_size_max	(FuConfig	*self);
+guint64		 fu_config_get_memory_budget		(FuConfig	*self);
 guint		 fu_config_get_idle_timeout		(FuConfig	*self);
+guint		 fu_config_get_udev_change_debounce	(FuConfig	*self);
+guint		 fu_config_get_progress_notify_rate	(FuConfig	*self);
+guint		 fu_config_get_history_max_age		(FuConfig	*self);
+guint		 fu_config_get_history_max_entries	(FuConfig	*self);
 GPtrArray	*fu_config_get_disabled_devices		(FuConfig	*self);
 GPtrArray	*fu_config_get_disabled_plugins		(FuConfig	*self);
 GPtrArray	*fu_config_get_approved_firmware	(FuConfig	*self);
 gboolean	 fu_config_get_update_motd		(FuConfig	*self);
 gboolean	 fu_config_get_enumerate_all_devices	(FuConfig	*self);
+const gchar	*fu_config_get_metrics_socket		(FuConfig	*self);
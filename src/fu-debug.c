@@ -13,6 +13,8 @@
 
 #include <fu-debug.h>
 
+#include "fu-common.h"
+
 typedef struct {
 	GOptionGroup	*group;
 	gboolean	 verbose;
@@ -36,11 +38,8 @@ fu_debug_free (FuDebug *self)
 static gboolean
 fu_debug_filter_cb (FuDebug *self, const gchar *log_domain, GLogLevelFlags log_level)
 {
-	const gchar *domains = g_getenv ("FWUPD_VERBOSE");
-	g_auto(GStrv) domains_str = NULL;
-
 	/* include important things by default only */
-	if (domains == NULL) {
+	if (g_getenv ("FWUPD_VERBOSE") == NULL) {
 		if (log_level == G_LOG_LEVEL_INFO ||
 		    log_level == G_LOG_LEVEL_CRITICAL ||
 		    log_level == G_LOG_LEVEL_WARNING ||
@@ -50,13 +49,8 @@ fu_debug_filter_cb (FuDebug *self, const gchar *log_domain, GLogLevelFlags log_l
 		return FALSE;
 	}
 
-	/* everything */
-	if (g_strcmp0 (domains, "*") == 0)
-		return TRUE;
-
 	/* filter on domain */
-	domains_str = g_strsplit (domains, ",", -1);
-	return g_strv_contains ((const gchar * const *) domains_str, log_domain);
+	return fu_common_debug_enabled (log_domain);
 }
 
 static void
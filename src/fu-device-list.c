@@ -38,6 +38,13 @@ struct _FuDeviceList
 	GObject			 parent_instance;
 	GPtrArray		*devices;	/* of FuDeviceItem */
 	GRWLock			 devices_mutex;
+	GPtrArray		*snapshot_all;		/* (nullable): of FuDevice, immutable */
+	GPtrArray		*snapshot_active;	/* (nullable): of FuDevice, immutable */
+	GMutex			 snapshot_mutex;	/* for snapshot_all and snapshot_active */
+	GHashTable		*guid_index;	/* guid:GPtrArray of FuDeviceItem */
+	GHashTable		*id_index;	/* device-id:GPtrArray of FuDeviceItem */
+	GHashTable		*connection_index; /* physical-id\tlogical-id:GPtrArray of FuDeviceItem */
+	guint			 serial_next;
 	GMainLoop		*replug_loop;	/* block waiting for replug */
 	guint			 replug_id;	/* timeout the loop */
 };
@@ -56,8 +63,20 @@ typedef struct {
 	FuDevice		*device_old;
 	FuDeviceList		*self;		/* no ref */
 	guint			 remove_id;
+	guint			 serial;	/* insertion order */
+	GPtrArray		*index_keys;	/* of FuDeviceIndexKey */
+	guint			 guids_len;	/* when indexed */
+	guint			 guids_old_len;	/* when indexed */
 } FuDeviceItem;
 
+typedef struct {
+	GHashTable		*index;		/* no ref */
+	gchar			*key;
+} FuDeviceIndexKey;
+
+typedef gboolean (*FuDeviceListMatchFunc)	(FuDevice	*device,
+						 const gchar	*key);
+
 G_DEFINE_TYPE (FuDeviceList, fu_device_list, G_TYPE_OBJECT)
 
 static void
@@ -81,6 +100,47 @@ fu_device_list_emit_device_changed (FuDeviceList *self, FuDevice *device)
 	g_signal_emit (self, signals[SIGNAL_CHANGED], 0, device);
 }
 
+/* the snapshots are rebuilt on the first read after the list has changed, and
+ * are then shared by every caller without copying */
+static GPtrArray *
+fu_device_list_get_snapshot (FuDeviceList *self, gboolean include_old)
+{
+	GPtrArray **snapshot = include_old ? &self->snapshot_all : &self->snapshot_active;
+	GPtrArray *devices;
+
+	g_mutex_lock (&self->snapshot_mutex);
+	if (*snapshot == NULL) {
+		devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_rw_lock_reader_lock (&self->devices_mutex);
+		for (guint i = 0; i < self->devices->len; i++) {
+			FuDeviceItem *item = g_ptr_array_index (self->devices, i);
+			g_ptr_array_add (devices, g_object_ref (item->device));
+		}
+		for (guint i = 0; include_old && i < self->devices->len; i++) {
+			FuDeviceItem *item = g_ptr_array_index (self->devices, i);
+			if (item->device_old == NULL)
+				continue;
+			g_ptr_array_add (devices, g_object_ref (item->device_old));
+		}
+		g_rw_lock_reader_unlock (&self->devices_mutex);
+		*snapshot = devices;
+	}
+	devices = g_ptr_array_ref (*snapshot);
+	g_mutex_unlock (&self->snapshot_mutex);
+	return devices;
+}
+
+/* must be called after the writer lock has been released, so that a snapshot
+ * built while the list was being changed is not kept */
+static void
+fu_device_list_invalidate_snapshots (FuDeviceList *self)
+{
+	g_mutex_lock (&self->snapshot_mutex);
+	g_clear_pointer (&self->snapshot_all, g_ptr_array_unref);
+	g_clear_pointer (&self->snapshot_active, g_ptr_array_unref);
+	g_mutex_unlock (&self->snapshot_mutex);
+}
+
 /**
  * fu_device_list_get_all:
  * @self: A #FuDeviceList
@@ -89,6 +149,8 @@ fu_device_list_emit_device_changed (FuDeviceList *self, FuDevice *device)
  * This includes devices that are no longer active, for instance where a
  * different plugin has taken over responsibility of the #FuDevice.
  *
+ * The array is shared with other callers and must not be modified.
+ *
  * Returns: (transfer container) (element-type FuDevice): the devices
  *
  * Since: 1.0.2
@@ -96,23 +158,8 @@ fu_device_list_emit_device_changed (FuDeviceList *self, FuDevice *device)
 GPtrArray *
 fu_device_list_get_all (FuDeviceList *self)
 {
-	GPtrArray *devices;
 	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), NULL);
-	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-
-	g_rw_lock_reader_lock (&self->devices_mutex);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		g_ptr_array_add (devices, g_object_ref (item->device));
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		g_ptr_array_add (devices, g_object_ref (item->device_old));
-	}
-	g_rw_lock_reader_unlock (&self->devices_mutex);
-	return devices;
+	return fu_device_list_get_snapshot (self, TRUE);
 }
 
 /**
@@ -123,6 +170,8 @@ fu_device_list_get_all (FuDeviceList *self)
  * An active device is defined as a device that is currently connected and has
  * is owned by a plugin.
  *
+ * The array is shared with other callers and must not be modified.
+ *
  * Returns: (transfer container) (element-type FuDevice): the devices
  *
  * Since: 1.0.2
@@ -130,16 +179,8 @@ fu_device_list_get_all (FuDeviceList *self)
 GPtrArray *
 fu_device_list_get_active (FuDeviceList *self)
 {
-	GPtrArray *devices;
 	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), NULL);
-	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	g_rw_lock_reader_lock (&self->devices_mutex);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		g_ptr_array_add (devices, g_object_ref (item->device));
-	}
-	g_rw_lock_reader_unlock (&self->devices_mutex);
-	return devices;
+	return fu_device_list_get_snapshot (self, FALSE);
 }
 
 static FuDeviceItem *
@@ -160,71 +201,273 @@ fu_device_list_find_by_device (FuDeviceList *self, FuDevice *device)
 	return NULL;
 }
 
-static FuDeviceItem *
-fu_device_list_find_by_guid (FuDeviceList *self, const gchar *guid)
+static void
+fu_device_index_key_free (FuDeviceIndexKey *index_key)
 {
-	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
-	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (fu_device_has_guid (item->device, guid))
-			return item;
+	g_free (index_key->key);
+	g_free (index_key);
+}
+
+static gchar *
+fu_device_list_connection_key (const gchar *physical_id, const gchar *logical_id)
+{
+	if (physical_id == NULL)
+		return NULL;
+	return g_strdup_printf ("%s\t%s", physical_id,
+				logical_id != NULL ? logical_id : "");
+}
+
+/* must be called with the writer lock held */
+static void
+fu_device_list_item_index_add (FuDeviceItem *item, GHashTable *index, const gchar *key)
+{
+	FuDeviceIndexKey *index_key;
+	GPtrArray *items;
+
+	if (key == NULL)
+		return;
+	items = g_hash_table_lookup (index, key);
+	if (items == NULL) {
+		items = g_ptr_array_new ();
+		g_hash_table_insert (index, g_strdup (key), items);
+	}
+	for (guint i = 0; i < items->len; i++) {
+		if (g_ptr_array_index (items, i) == item)
+			return;
+	}
+	g_ptr_array_add (items, item);
+	index_key = g_new0 (FuDeviceIndexKey, 1);
+	index_key->index = index;
+	index_key->key = g_strdup (key);
+	g_ptr_array_add (item->index_keys, index_key);
+}
+
+/* must be called with the writer lock held */
+static void
+fu_device_list_item_unindex (FuDeviceItem *item)
+{
+	for (guint i = 0; i < item->index_keys->len; i++) {
+		FuDeviceIndexKey *index_key = g_ptr_array_index (item->index_keys, i);
+		GPtrArray *items = g_hash_table_lookup (index_key->index, index_key->key);
+		if (items == NULL)
+			continue;
+		g_ptr_array_remove (items, item);
+		if (items->len == 0)
+			g_hash_table_remove (index_key->index, index_key->key);
+	}
+	g_ptr_array_set_size (item->index_keys, 0);
+}
+
+static void
+fu_device_list_item_index_device (FuDeviceItem *item, FuDevice *device)
+{
+	FuDeviceList *self = item->self;
+	GPtrArray *guids = fu_device_get_guids (device);
+	g_autofree gchar *connection = NULL;
+
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		fu_device_list_item_index_add (item, self->guid_index, guid);
+	}
+	fu_device_list_item_index_add (item, self->id_index,
+				       fu_device_get_id (device));
+	fu_device_list_item_index_add (item, self->id_index,
+				       fu_device_get_equivalent_id (device));
+	connection = fu_device_list_connection_key (fu_device_get_physical_id (device),
+						    fu_device_get_logical_id (device));
+	fu_device_list_item_index_add (item, self->connection_index, connection);
+}
+
+/* must be called with the writer lock held */
+static void
+fu_device_list_item_reindex (FuDeviceItem *item)
+{
+	fu_device_list_item_unindex (item);
+	if (item->device != NULL) {
+		fu_device_list_item_index_device (item, item->device);
+		item->guids_len = fu_device_get_guids (item->device)->len;
 	}
+	if (item->device_old != NULL) {
+		fu_device_list_item_index_device (item, item->device_old);
+		item->guids_old_len = fu_device_get_guids (item->device_old)->len;
+	}
+}
+
+/* GUIDs are only ever appended to a device, so any device with a different
+ * number of GUIDs to when it was indexed needs indexing again */
+static gboolean
+fu_device_list_reindex_stale_guids (FuDeviceList *self)
+{
+	gboolean changed = FALSE;
+	g_autoptr(GRWLockWriterLocker) locker = g_rw_lock_writer_locker_new (&self->devices_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
 	for (guint i = 0; i < self->devices->len; i++) {
 		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
+		if (fu_device_get_guids (item->device)->len != item->guids_len ||
+		    (item->device_old != NULL &&
+		     fu_device_get_guids (item->device_old)->len != item->guids_old_len)) {
+			fu_device_list_item_reindex (item);
+			changed = TRUE;
+		}
+	}
+	return changed;
+}
+
+static void
+fu_device_list_item_notify_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	FuDeviceItem *item = (FuDeviceItem *) user_data;
+	g_rw_lock_writer_lock (&item->self->devices_mutex);
+	fu_device_list_item_reindex (item);
+	g_rw_lock_writer_unlock (&item->self->devices_mutex);
+}
+
+static void
+fu_device_list_item_watch_device (FuDeviceItem *item, FuDevice *device)
+{
+	g_signal_connect (device, "notify::physical-id",
+			  G_CALLBACK (fu_device_list_item_notify_cb), item);
+	g_signal_connect (device, "notify::logical-id",
+			  G_CALLBACK (fu_device_list_item_notify_cb), item);
+}
+
+/* must be called with the reader lock held; prefers the active devices and
+ * then the devices added first, to match the order of self->devices */
+static FuDeviceItem *
+fu_device_list_find_in_index (GHashTable *index,
+			      const gchar *key,
+			      FuDeviceListMatchFunc func,
+			      gboolean only_removed,
+			      FuDeviceItem **item_old)
+{
+	FuDeviceItem *item_active = NULL;
+	GPtrArray *items = g_hash_table_lookup (index, key);
+
+	if (items == NULL)
+		return NULL;
+	for (guint i = 0; i < items->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (items, i);
+		if (only_removed && item->remove_id == 0)
 			continue;
-		if (fu_device_has_guid (item->device_old, guid))
-			return item;
+		if (func (item->device, key)) {
+			if (item_active == NULL || item->serial < item_active->serial)
+				item_active = item;
+			continue;
+		}
+		if (item_old != NULL &&
+		    item->device_old != NULL &&
+		    func (item->device_old, key)) {
+			if (*item_old == NULL || item->serial < (*item_old)->serial)
+				*item_old = item;
+		}
+	}
+	return item_active;
+}
+
+static gboolean
+fu_device_list_match_guid (FuDevice *device, const gchar *guid)
+{
+	return fwupd_device_has_guid (FWUPD_DEVICE (device), guid);
+}
+
+static gboolean
+fu_device_list_match_connection (FuDevice *device, const gchar *key)
+{
+	g_autofree gchar *connection = NULL;
+	connection = fu_device_list_connection_key (fu_device_get_physical_id (device),
+						    fu_device_get_logical_id (device));
+	return g_strcmp0 (connection, key) == 0;
+}
+
+static gboolean
+fu_device_list_match_id (FuDevice *device, const gchar *device_id)
+{
+	return g_strcmp0 (fu_device_get_id (device), device_id) == 0 ||
+		g_strcmp0 (fu_device_get_equivalent_id (device), device_id) == 0;
+}
+
+static FuDeviceItem *
+fu_device_list_get_by_guids_full (FuDeviceList *self, GPtrArray *guids, gboolean only_removed)
+{
+	for (guint attempt = 0; attempt < 2; attempt++) {
+		FuDeviceItem *item_active = NULL;
+		FuDeviceItem *item_old = NULL;
+		g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
+		g_return_val_if_fail (locker != NULL, NULL);
+		for (guint j = 0; j < guids->len; j++) {
+			g_autofree gchar *tmp = NULL;
+			const gchar *guid = g_ptr_array_index (guids, j);
+			FuDeviceItem *item;
+
+			/* same as fu_device_has_guid() */
+			if (!fwupd_guid_is_valid (guid)) {
+				tmp = fwupd_guid_hash_string (guid);
+				guid = tmp;
+			}
+			item = fu_device_list_find_in_index (self->guid_index,
+							     guid,
+							     fu_device_list_match_guid,
+							     only_removed,
+							     &item_old);
+			if (item == NULL)
+				continue;
+			if (item_active == NULL || item->serial < item_active->serial)
+				item_active = item;
+		}
+		if (item_active != NULL)
+			return item_active;
+		if (item_old != NULL)
+			return item_old;
+
+		/* check no GUIDs were added since the devices were indexed */
+		g_clear_pointer (&locker, g_rw_lock_reader_locker_free);
+		if (!fu_device_list_reindex_stale_guids (self))
+			break;
 	}
 	return NULL;
 }
 
+static FuDeviceItem *
+fu_device_list_find_by_guid (FuDeviceList *self, const gchar *guid)
+{
+	g_autoptr(GPtrArray) guids = g_ptr_array_new ();
+	g_ptr_array_add (guids, (gpointer) guid);
+	return fu_device_list_get_by_guids_full (self, guids, FALSE);
+}
+
 static FuDeviceItem *
 fu_device_list_find_by_connection (FuDeviceList *self,
 				   const gchar *physical_id,
 				   const gchar *logical_id)
 {
+	FuDeviceItem *item;
+	FuDeviceItem *item_old = NULL;
+	g_autofree gchar *connection = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	if (physical_id == NULL)
 		return NULL;
+	connection = fu_device_list_connection_key (physical_id, logical_id);
 	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		FuDevice *device = item_tmp->device;
-		if (device != NULL &&
-		    g_strcmp0 (fu_device_get_physical_id (device), physical_id) == 0 &&
-		    g_strcmp0 (fu_device_get_logical_id (device), logical_id) == 0)
-			return item_tmp;
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		FuDevice *device = item_tmp->device_old;
-		if (device != NULL &&
-		    g_strcmp0 (fu_device_get_physical_id (device), physical_id) == 0 &&
-		    g_strcmp0 (fu_device_get_logical_id (device), logical_id) == 0)
-			return item_tmp;
-	}
-	return NULL;
+	item = fu_device_list_find_in_index (self->connection_index,
+					     connection,
+					     fu_device_list_match_connection,
+					     FALSE,
+					     &item_old);
+	if (item != NULL)
+		return item;
+	return item_old;
 }
 
+/* only used for abbreviated hashes, typically from the command line */
 static FuDeviceItem *
-fu_device_list_find_by_id (FuDeviceList *self,
-			   const gchar *device_id,
-			   gboolean *multiple_matches)
+fu_device_list_find_by_id_prefix (FuDeviceList *self,
+				  const gchar *device_id,
+				  gboolean *multiple_matches)
 {
 	FuDeviceItem *item = NULL;
-	gsize device_id_len;
-
-	/* sanity check */
-	if (device_id == NULL) {
-		g_critical ("device ID was NULL");
-		return NULL;
-	}
+	gsize device_id_len = strlen (device_id);
 
-	/* support abbreviated hashes */
-	device_id_len = strlen (device_id);
 	g_rw_lock_reader_lock (&self->devices_mutex);
 	for (guint i = 0; i < self->devices->len; i++) {
 		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
@@ -265,6 +508,61 @@ fu_device_list_find_by_id (FuDeviceList *self,
 	return item;
 }
 
+static FuDeviceItem *
+fu_device_list_find_by_id (FuDeviceList *self,
+			   const gchar *device_id,
+			   gboolean *multiple_matches)
+{
+	GPtrArray *items;
+	FuDeviceItem *item_active = NULL;
+	FuDeviceItem *item_old = NULL;
+	guint matches_active = 0;
+	guint matches_old = 0;
+	g_autoptr(GRWLockReaderLocker) locker = NULL;
+
+	/* sanity check */
+	if (device_id == NULL) {
+		g_critical ("device ID was NULL");
+		return NULL;
+	}
+
+	/* support abbreviated hashes */
+	if (!fwupd_device_id_is_valid (device_id))
+		return fu_device_list_find_by_id_prefix (self, device_id, multiple_matches);
+
+	/* exact match */
+	locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
+	g_return_val_if_fail (locker != NULL, NULL);
+	items = g_hash_table_lookup (self->id_index, device_id);
+	if (items == NULL)
+		return NULL;
+	for (guint i = 0; i < items->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (items, i);
+		if (fu_device_list_match_id (item->device, device_id)) {
+			if (item_active == NULL || item->serial > item_active->serial)
+				item_active = item;
+			matches_active++;
+			continue;
+		}
+		if (item->device_old != NULL &&
+		    fu_device_list_match_id (item->device_old, device_id)) {
+			if (item_old == NULL || item->serial > item_old->serial)
+				item_old = item;
+			matches_old++;
+		}
+	}
+
+	/* only use old devices if we didn't find the active device */
+	if (item_active != NULL) {
+		if (matches_active > 1 && multiple_matches != NULL)
+			*multiple_matches = TRUE;
+		return item_active;
+	}
+	if (matches_old > 1 && multiple_matches != NULL)
+		*multiple_matches = TRUE;
+	return item_old;
+}
+
 /**
  * fu_device_list_get_old:
  * @self: A #FuDeviceList
@@ -290,57 +588,13 @@ fu_device_list_get_old (FuDeviceList *self, FuDevice *device)
 static FuDeviceItem *
 fu_device_list_get_by_guids (FuDeviceList *self, GPtrArray *guids)
 {
-	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
-	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device, guid))
-				return item;
-		}
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device_old, guid))
-				return item;
-		}
-	}
-	return NULL;
+	return fu_device_list_get_by_guids_full (self, guids, FALSE);
 }
 
 static FuDeviceItem *
 fu_device_list_get_by_guids_removed (FuDeviceList *self, GPtrArray *guids)
 {
-	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&self->devices_mutex);
-	g_return_val_if_fail (locker != NULL, NULL);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->remove_id == 0)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device, guid))
-				return item;
-		}
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		if (item->remove_id == 0)
-			continue;
-		for (guint j = 0; j < guids->len; j++) {
-			const gchar *guid = g_ptr_array_index (guids, j);
-			if (fu_device_has_guid (item->device_old, guid))
-				return item;
-		}
-	}
-	return NULL;
+	return fu_device_list_get_by_guids_full (self, guids, TRUE);
 }
 
 static gboolean
@@ -368,6 +622,7 @@ fu_device_list_device_delayed_remove_cb (gpointer user_data)
 		g_rw_lock_writer_lock (&self->devices_mutex);
 		g_ptr_array_remove (self->devices, child_item);
 		g_rw_lock_writer_unlock (&self->devices_mutex);
+		fu_device_list_invalidate_snapshots (self);
 	}
 
 	/* just remove now */
@@ -376,6 +631,7 @@ fu_device_list_device_delayed_remove_cb (gpointer user_data)
 	g_rw_lock_writer_lock (&self->devices_mutex);
 	g_ptr_array_remove (self->devices, item);
 	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_invalidate_snapshots (self);
 	return G_SOURCE_REMOVE;
 }
 
@@ -454,6 +710,7 @@ fu_device_list_remove (FuDeviceList *self, FuDevice *device)
 		g_rw_lock_writer_lock (&self->devices_mutex);
 		g_ptr_array_remove (self->devices, child_item);
 		g_rw_lock_writer_unlock (&self->devices_mutex);
+		fu_device_list_invalidate_snapshots (self);
 	}
 
 	/* remove right now */
@@ -461,6 +718,7 @@ fu_device_list_remove (FuDeviceList *self, FuDevice *device)
 	g_rw_lock_writer_lock (&self->devices_mutex);
 	g_ptr_array_remove (self->devices, item);
 	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_invalidate_snapshots (self);
 }
 
 static void
@@ -494,6 +752,7 @@ fu_device_list_item_finalized_cb (gpointer data, GObject *where_the_object_was)
 	g_rw_lock_writer_lock (&self->devices_mutex);
 	g_ptr_array_remove (self->devices, item);
 	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_invalidate_snapshots (self);
 }
 
 /* this should never be required, and yet here we are */
@@ -501,11 +760,13 @@ static void
 fu_device_list_item_set_device (FuDeviceItem *item, FuDevice *device)
 {
 	if (item->device != NULL) {
+		g_signal_handlers_disconnect_by_data (item->device, item);
 		g_object_weak_unref (G_OBJECT (item->device),
 				     fu_device_list_item_finalized_cb,
 				     item);
 	}
 	if (device != NULL) {
+		fu_device_list_item_watch_device (item, device);
 		g_object_weak_ref (G_OBJECT (device),
 				   fu_device_list_item_finalized_cb,
 				   item);
@@ -513,6 +774,16 @@ fu_device_list_item_set_device (FuDeviceItem *item, FuDevice *device)
 	g_set_object (&item->device, device);
 }
 
+static void
+fu_device_list_item_set_device_old (FuDeviceItem *item, FuDevice *device)
+{
+	if (item->device_old != NULL)
+		g_signal_handlers_disconnect_by_data (item->device_old, item);
+	if (device != NULL)
+		fu_device_list_item_watch_device (item, device);
+	g_set_object (&item->device_old, device);
+}
+
 static void
 fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device)
 {
@@ -557,6 +828,9 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 		fu_device_add_flag (device, FWUPD_DEVICE_FLAG_ANOTHER_WRITE_REQUIRED);
 	}
 
+	/* use the firmware prepared before detaching */
+	fu_device_incorporate_firmware_cache (device, item->device);
+
 	/* device won't come back in right mode */
 	if (fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_WILL_DISAPPEAR)) {
 		g_debug ("copying will-disappear to new device");
@@ -574,8 +848,12 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 	}
 
 	/* assign the new device */
-	g_set_object (&item->device_old, item->device);
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	fu_device_list_item_set_device_old (item, item->device);
 	fu_device_list_item_set_device (item, device);
+	fu_device_list_item_reindex (item);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_invalidate_snapshots (self);
 	fu_device_list_emit_device_changed (self, device);
 
 	/* we were waiting for this... */
@@ -703,10 +981,14 @@ fu_device_list_add (FuDeviceList *self, FuDevice *device)
 	/* add helper */
 	item = g_new0 (FuDeviceItem, 1);
 	item->self = self; /* no ref */
+	item->index_keys = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_index_key_free);
 	fu_device_list_item_set_device (item, device);
 	g_rw_lock_writer_lock (&self->devices_mutex);
+	item->serial = self->serial_next++;
+	fu_device_list_item_reindex (item);
 	g_ptr_array_add (self->devices, item);
 	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_invalidate_snapshots (self);
 	fu_device_list_emit_device_added (self, device);
 }
 
@@ -773,7 +1055,10 @@ gboolean
 fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **error)
 {
 	FuDeviceItem *item;
+	gint64 replug_start;
 	guint remove_delay;
+	guint replug_time;
+	guint replug_time_old;
 
 	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), FALSE);
 	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
@@ -817,8 +1102,10 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 	}
 
 	/* time to unplug and then re-plug */
+	replug_start = g_get_monotonic_time ();
 	self->replug_id = g_timeout_add (remove_delay, fu_device_list_replug_cb, self);
 	g_main_loop_run (self->replug_loop);
+	replug_time = (g_get_monotonic_time () - replug_start) / 1000;
 
 	/* cancel timeout if still pending */
 	if (self->replug_id != 0) {
@@ -847,8 +1134,15 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 		}
 	}
 
+	/* remember the slowest replug so the remove delay can be tuned */
+	g_debug ("waited %ums for replug, remove delay was %ums",
+		 replug_time, remove_delay);
+	replug_time_old = fu_device_get_metadata_integer (device, "ReplugTime");
+	if (replug_time_old != G_MAXUINT)
+		replug_time = MAX (replug_time, replug_time_old);
+	fu_device_set_metadata_integer (item->device, "ReplugTime", replug_time);
+
 	/* the loop was quit without the timer */
-	g_debug ("waited for replug");
 	return TRUE;
 }
 
@@ -900,14 +1194,16 @@ fu_device_list_get_by_id (FuDeviceList *self, const gchar *device_id, GError **e
 	return g_object_ref (item->device);
 }
 
+/* called with the writer lock held, or when finalizing */
 static void
 fu_device_list_item_free (FuDeviceItem *item)
 {
 	if (item->remove_id != 0)
 		g_source_remove (item->remove_id);
-	if (item->device_old != NULL)
-		g_object_unref (item->device_old);
+	fu_device_list_item_unindex (item);
+	fu_device_list_item_set_device_old (item, NULL);
 	fu_device_list_item_set_device (item, NULL);
+	g_ptr_array_unref (item->index_keys);
 	g_free (item);
 }
 
@@ -938,8 +1234,15 @@ static void
 fu_device_list_init (FuDeviceList *self)
 {
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_list_item_free);
+	self->guid_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->id_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, (GDestroyNotify) g_ptr_array_unref);
+	self->connection_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, (GDestroyNotify) g_ptr_array_unref);
 	self->replug_loop = g_main_loop_new (NULL, FALSE);
 	g_rw_lock_init (&self->devices_mutex);
+	g_mutex_init (&self->snapshot_mutex);
 }
 
 static void
@@ -948,10 +1251,18 @@ fu_device_list_finalize (GObject *obj)
 	FuDeviceList *self = FU_DEVICE_LIST (obj);
 
 	g_rw_lock_clear (&self->devices_mutex);
+	g_mutex_clear (&self->snapshot_mutex);
+	if (self->snapshot_all != NULL)
+		g_ptr_array_unref (self->snapshot_all);
+	if (self->snapshot_active != NULL)
+		g_ptr_array_unref (self->snapshot_active);
 
 	if (self->replug_id != 0)
 		g_source_remove (self->replug_id);
 	g_ptr_array_unref (self->devices);
+	g_hash_table_unref (self->guid_index);
+	g_hash_table_unref (self->id_index);
+	g_hash_table_unref (self->connection_index);
 	g_main_loop_unref (self->replug_loop);
 
 	G_OBJECT_CLASS (fu_device_list_parent_class)->finalize (obj);
@@ -13,6 +13,7 @@
 #include <gio/gunixinputstream.h>
 #endif
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #ifdef HAVE_GUDEV
 #include <gudev/gudev.h>
 #endif
@@ -21,6 +22,7 @@
 #include <sys/utsname.h>
 #endif
 #include <errno.h>
+#include <unistd.h>
 
 #include "fwupd-common-private.h"
 #include "fwupd-enums-private.h"
@@ -39,11 +41,14 @@
 #include "fu-engine.h"
 #include "fu-engine-helper.h"
 #include "fu-engine-request.h"
+#include "fu-efivar.h"
+#include "fu-firmware-builder.h"
 #include "fu-hwids.h"
 #include "fu-idle.h"
 #include "fu-keyring-utils.h"
 #include "fu-hash.h"
 #include "fu-history.h"
+#include "fu-metrics.h"
 #include "fu-mutex.h"
 #include "fu-plugin.h"
 #include "fu-plugin-list.h"
@@ -53,6 +58,7 @@
 #include "fu-security-attr.h"
 #include "fu-security-attrs-private.h"
 #include "fu-smbios-private.h"
+#include "fu-trace.h"
 #include "fu-udev-device-private.h"
 #include "fu-usb-device-private.h"
 
@@ -67,9 +73,28 @@
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
 #endif
+#ifdef HAVE_ZSTD
+#include "fu-zstd-decompressor.h"
+#endif
 
 static void fu_engine_finalize	 (GObject *obj);
 static void fu_engine_ensure_security_attrs	(FuEngine *self);
+static void fu_engine_emit_changed		(FuEngine *self);
+static void fu_engine_emit_device_changed	(FuEngine *self, FuDevice *device);
+static void fu_engine_schedule_idle_tasks	(FuEngine *self);
+
+typedef enum {
+	FU_ENGINE_QUERY_RELEASES_BY_GUID,
+	FU_ENGINE_QUERY_LAST
+} FuEngineQuery;
+
+/* each has one string parameter bound before use */
+static const gchar *fu_engine_query_xpaths[FU_ENGINE_QUERY_LAST] = {
+	[FU_ENGINE_QUERY_RELEASES_BY_GUID] =
+		"components/component/"
+		"provides/firmware[@type='flashed'][text()=?]/"
+		"../../releases/release",
+};
 
 struct _FuEngine
 {
@@ -81,34 +106,71 @@ struct _FuEngine
 #endif
 	FuConfig		*config;
 	FuRemoteList		*remote_list;
+	FuFileWatch		*file_watch;
+	FuEsrt			*esrt;
 	FuDeviceList		*device_list;
 	FwupdStatus		 status;
 	gboolean		 tainted;
 	guint			 percentage;
+	GMutex			 status_mutex;		/* for status and percentage */
+	GMutex			 install_mutex;		/* for install_devices and deferred events */
+	GPtrArray		*install_devices;	/* (nullable): installing in parallel */
+	GPtrArray		*install_devices_changed; /* of FuDevice, deferred until done */
+	gboolean		 install_emit_changed;	/* deferred until done */
+	GPtrArray		*install_hotplug_events; /* of FuEngineHotplugEvent */
+	guint			 install_threads_max;	/* 0 for one per group */
+	GHashTable		*install_phases;	/* device-id:FuEngineInstallPhases */
+	GMutex			 device_locks_mutex;	/* for device_locks */
+	GCond			 device_locks_cond;
+	GHashTable		*device_locks;		/* device-id:FuEngineDeviceLock */
 	FuHistory		*history;
 	FuIdle			*idle;
-	XbSilo			*silo;
+	GPtrArray		*shards;		/* of FuEngineShard, in remote order */
+	gchar			*silo_remotes_key;	/* (nullable): remotes used for silo */
 	gboolean		 coldplug_running;
 	guint			 coldplug_id;
+	guint			 progress_notify_id;
+	GHashTable		*progress_notify_pending;	/* FuDevice:NULL */
 	guint			 coldplug_delay;
+	GMutex			 coldplug_mutex;	/* for coldplug_queue */
+	GPtrArray		*coldplug_queue;	/* (nullable): of FuEngineColdplugItem */
+	GPtrArray		*hotplug_batch;		/* of FuDevice */
+	guint			 hotplug_batch_id;
+	GThread			*main_thread;
 	FuPluginList		*plugin_list;
 	GPtrArray		*plugin_filter;
+	GHashTable		*plugins_deferred;	/* name:filename */
 	GPtrArray		*udev_subsystems;
 #ifdef HAVE_GUDEV
 	GHashTable		*udev_changed_ids;	/* sysfs:FuEngineUdevChangedHelper */
+	guint			 udev_changed_merged;
 #endif
 	FuSmbios		*smbios;
 	FuHwids			*hwids;
 	FuQuirks		*quirks;
 	GHashTable		*runtime_versions;
 	GHashTable		*compile_versions;
+	GHashTable		*report_metadata_boot;	/* (nullable): constant for this boot */
+	GMutex			 report_metadata_mutex;	/* for report_metadata_boot */
 	GHashTable		*approved_firmware;	/* (nullable) */
+	GHashTable		*releases_cache;	/* key:FuEngineReleasesCacheItem */
+	guint64			 releases_generation;
+	GPtrArray		*devices_sorted;	/* (nullable): of FuDevice */
+	guint64			 devices_generation;
+	GQueue			*silo_cache;		/* of FuEngineSiloCacheItem, newest first */
+	GMutex			 silo_cache_mutex;	/* for silo_cache and silo_cache_size */
+	guint			 component_index;
+	guint64			 silo_cache_size;
 	GHashTable		*firmware_gtypes;
 	gchar			*host_machine_id;
 	JcatContext		*jcat_context;
+	FuJcatCache		*jcat_cache;
+	FuFirmwareBuilder	*firmware_builder;
 	gboolean		 loaded;
+	FuEngineLoadFlags	 load_flags;
 	gchar			*host_security_id;
 	FuSecurityAttrs		*host_security_attrs;
+	GHashTable		*security_attrs_cache;	/* plugin-name:FuEngineSecurityAttrsCacheItem */
 };
 
 enum {
@@ -125,9 +187,285 @@ static guint signals[SIGNAL_LAST] = { 0 };
 
 G_DEFINE_TYPE (FuEngine, fu_engine, G_TYPE_OBJECT)
 
+typedef struct {
+	GPtrArray		*releases;	/* (nullable) (element-type FwupdRelease) */
+	GError			*error;		/* (nullable) */
+} FuEngineReleasesCacheItem;
+
+static void
+fu_engine_releases_cache_item_free (FuEngineReleasesCacheItem *item)
+{
+	if (item->releases != NULL)
+		g_ptr_array_unref (item->releases);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+static void
+fu_engine_invalidate_releases_cache (FuEngine *self)
+{
+	g_hash_table_remove_all (self->releases_cache);
+	self->releases_generation++;
+}
+
+static void
+fu_engine_invalidate_devices_cache (FuEngine *self)
+{
+	g_clear_pointer (&self->devices_sorted, g_ptr_array_unref);
+	self->devices_generation++;
+}
+
+/* plugins reading hardware state without a change notification are re-run
+ * after this many seconds */
+#define FU_ENGINE_SECURITY_ATTRS_TTL		300
+#define FU_ENGINE_HOTPLUG_BATCH_DELAY		20	/* ms */
+
+typedef struct {
+	FuSecurityAttrs		*attrs;
+	gint64			 created;	/* monotonic, in us */
+} FuEngineSecurityAttrsCacheItem;
+
+static void
+fu_engine_security_attrs_cache_item_free (FuEngineSecurityAttrsCacheItem *item)
+{
+	g_object_unref (item->attrs);
+	g_free (item);
+}
+
+/* if @plugin is NULL then the attributes for all plugins are invalidated */
+static void
+fu_engine_invalidate_security_attrs (FuEngine *self, FuPlugin *plugin)
+{
+	if (plugin != NULL)
+		g_hash_table_remove (self->security_attrs_cache, fu_plugin_get_name (plugin));
+	else
+		g_hash_table_remove_all (self->security_attrs_cache);
+	g_clear_pointer (&self->host_security_id, g_free);
+}
+
+typedef struct {
+	gchar			*checksum;	/* of the cabinet archive */
+	XbSilo			*silo;
+	gsize			 size;
+} FuEngineSiloCacheItem;
+
+static void
+fu_engine_silo_cache_item_free (FuEngineSiloCacheItem *item)
+{
+	g_free (item->checksum);
+	g_object_unref (item->silo);
+	g_free (item);
+}
+
+/* drop the least recently used archives until under @size_max */
+static void
+fu_engine_silo_cache_trim (FuEngine *self, guint64 size_max)
+{
+	while (self->silo_cache_size > size_max) {
+		FuEngineSiloCacheItem *item = g_queue_pop_tail (self->silo_cache);
+		if (item == NULL)
+			break;
+		g_debug ("removing %s from archive cache", item->checksum);
+		self->silo_cache_size -= item->size;
+		fu_engine_silo_cache_item_free (item);
+	}
+}
+
+/* the archive cache never holds more than the whole memory budget */
+static guint64
+fu_engine_get_archive_cache_size_max (FuEngine *self)
+{
+	guint64 cache_size_max = fu_config_get_archive_cache_size_max (self->config);
+	guint64 memory_budget = fu_config_get_memory_budget (self->config);
+	if (memory_budget > 0)
+		return MIN (cache_size_max, memory_budget);
+	return cache_size_max;
+}
+
+/* each enabled remote is compiled into its own silo, and the flashed GUIDs
+ * and container checksums it provides are summarised in a bloom filter saved
+ * next to it, so remotes that cannot match a device are never mapped */
+typedef struct {
+	FwupdRemote		*remote;	/* (nullable): for fu_engine_set_silo() */
+	gchar			*key;		/* (nullable): what the silo is built from */
+	GFile			*xmlb;		/* (nullable) */
+	gchar			*bloom_fn;	/* (nullable) */
+	GByteArray		*bloom;		/* (nullable): everything might match */
+	XbSilo			*silo;		/* (nullable): until first needed */
+	XbBuilderCompileFlags	 compile_flags;
+	gboolean		 failed;
+	XbQuery			*queries[FU_ENGINE_QUERY_LAST];	/* (nullable) */
+	GHashTable		*component_guids;	/* (nullable): guid:GPtrArray of XbNode */
+	GHashTable		*checksum_remote_ids;	/* (nullable): container-checksum:remote-id */
+	GHashTable		*requirements_cache;	/* fwupd-index:GPtrArray */
+} FuEngineShard;
+
+#define FU_ENGINE_SHARD_BLOOM_HASHES		4
+#define FU_ENGINE_SHARD_BLOOM_BITS_PER_KEY	10
+
+static FuEngineShard *
+fu_engine_shard_new (void)
+{
+	FuEngineShard *shard = g_new0 (FuEngineShard, 1);
+	shard->requirements_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							   NULL,
+							   (GDestroyNotify) g_ptr_array_unref);
+	return shard;
+}
+
+static void
+fu_engine_shard_free (FuEngineShard *shard)
+{
+	for (guint i = 0; i < FU_ENGINE_QUERY_LAST; i++) {
+		if (shard->queries[i] != NULL)
+			g_object_unref (shard->queries[i]);
+	}
+	if (shard->component_guids != NULL)
+		g_hash_table_unref (shard->component_guids);
+	if (shard->checksum_remote_ids != NULL)
+		g_hash_table_unref (shard->checksum_remote_ids);
+	g_hash_table_unref (shard->requirements_cache);
+	if (shard->silo != NULL)
+		g_object_unref (shard->silo);
+	if (shard->bloom != NULL)
+		g_byte_array_unref (shard->bloom);
+	if (shard->xmlb != NULL)
+		g_object_unref (shard->xmlb);
+	if (shard->remote != NULL)
+		g_object_unref (shard->remote);
+	g_free (shard->bloom_fn);
+	g_free (shard->key);
+	g_free (shard);
+}
+
+/* two independent hashes, combined to make the others */
+static void
+fu_engine_shard_bloom_hashes (const gchar *key, guint32 *h1, guint32 *h2)
+{
+	*h1 = g_str_hash (key);
+	*h2 = 2166136261u;
+	for (const gchar *tmp = key; *tmp != '\0'; tmp++) {
+		*h2 ^= (guint8) *tmp;
+		*h2 *= 16777619u;
+	}
+	*h2 |= 1;
+}
+
+static void
+fu_engine_shard_bloom_add (GByteArray *bloom, const gchar *key)
+{
+	guint32 h1 = 0;
+	guint32 h2 = 0;
+	guint32 nbits = bloom->len * 8;
+	fu_engine_shard_bloom_hashes (key, &h1, &h2);
+	for (guint i = 0; i < FU_ENGINE_SHARD_BLOOM_HASHES; i++) {
+		guint32 bit = (h1 + i * h2) % nbits;
+		bloom->data[bit / 8] |= 1u << (bit % 8);
+	}
+}
+
+/* may return a false positive, but never a false negative */
+static gboolean
+fu_engine_shard_might_contain (FuEngineShard *shard, const gchar *key)
+{
+	guint32 h1 = 0;
+	guint32 h2 = 0;
+	guint32 nbits;
+
+	if (shard->failed)
+		return FALSE;
+	if (shard->bloom == NULL)
+		return TRUE;
+	nbits = shard->bloom->len * 8;
+	fu_engine_shard_bloom_hashes (key, &h1, &h2);
+	for (guint i = 0; i < FU_ENGINE_SHARD_BLOOM_HASHES; i++) {
+		guint32 bit = (h1 + i * h2) % nbits;
+		if ((shard->bloom->data[bit / 8] & (1u << (bit % 8))) == 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the file is the shard key, a NUL byte and then the filter */
+static gboolean
+fu_engine_shard_load_bloom (FuEngineShard *shard)
+{
+	const guint8 *buf;
+	const guint8 *tmp;
+	gsize bufsz = 0;
+	gsize keysz;
+	g_autoptr(GBytes) blob = NULL;
+
+	if (shard->bloom_fn == NULL || shard->key == NULL)
+		return FALSE;
+	blob = fu_common_get_contents_bytes (shard->bloom_fn, NULL);
+	if (blob == NULL)
+		return FALSE;
+	buf = g_bytes_get_data (blob, &bufsz);
+	tmp = memchr (buf, '\0', bufsz);
+	if (tmp == NULL)
+		return FALSE;
+	keysz = tmp - buf;
+	if (g_strcmp0 ((const gchar *) buf, shard->key) != 0 || keysz + 1 >= bufsz) {
+		g_debug ("bloom filter %s is out of date", shard->bloom_fn);
+		return FALSE;
+	}
+	shard->bloom = g_byte_array_new ();
+	g_byte_array_append (shard->bloom, buf + keysz + 1, bufsz - (keysz + 1));
+	return TRUE;
+}
+
+static void
+fu_engine_shard_save_bloom (FuEngineShard *shard)
+{
+	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	if (shard->bloom_fn == NULL || shard->key == NULL || shard->bloom == NULL)
+		return;
+	g_byte_array_append (buf, (const guint8 *) shard->key, strlen (shard->key) + 1);
+	g_byte_array_append (buf, shard->bloom->data, shard->bloom->len);
+	blob = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+	if (!fu_common_set_contents_bytes (shard->bloom_fn, blob, &error_local))
+		g_debug ("failed to save bloom filter: %s", error_local->message);
+}
+
+static gboolean fu_engine_shard_ensure_silo	(FuEngine	*self,
+						 FuEngineShard	*shard);
+
+static gboolean
+fu_engine_emit_changed_idle_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	fu_engine_emit_changed (self);
+	return G_SOURCE_REMOVE;
+}
+
 static void
 fu_engine_emit_changed (FuEngine *self)
 {
+	/* the main loop is running while devices are installed in worker
+	 * threads, so wait until they are done before looking at devices */
+	g_mutex_lock (&self->install_mutex);
+	if (self->install_devices != NULL) {
+		self->install_emit_changed = TRUE;
+		g_mutex_unlock (&self->install_mutex);
+		return;
+	}
+	g_mutex_unlock (&self->install_mutex);
+
+	/* only emit from the main thread */
+	if (g_thread_self () != self->main_thread) {
+		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+				 fu_engine_emit_changed_idle_cb,
+				 g_object_ref (self),
+				 (GDestroyNotify) g_object_unref);
+		return;
+	}
+
+	fu_engine_invalidate_releases_cache (self);
 	g_signal_emit (self, signals[SIGNAL_CHANGED], 0);
 	fu_engine_idle_reset (self);
 
@@ -140,14 +478,248 @@ fu_engine_emit_changed (FuEngine *self)
 	}
 }
 
+typedef struct {
+	FuEngine		*self;
+	FuDevice		*device;
+	gboolean		 progress_only;
+} FuEngineDeviceChangedHelper;
+
+static void fu_engine_emit_device_changed_progress (FuEngine *self, FuDevice *device);
+
+static void
+fu_engine_device_changed_helper_free (FuEngineDeviceChangedHelper *helper)
+{
+	g_object_unref (helper->self);
+	g_object_unref (helper->device);
+	g_free (helper);
+}
+
+static gboolean
+fu_engine_emit_device_changed_idle_cb (gpointer user_data)
+{
+	FuEngineDeviceChangedHelper *helper = (FuEngineDeviceChangedHelper *) user_data;
+	if (helper->progress_only)
+		fu_engine_emit_device_changed_progress (helper->self, helper->device);
+	else
+		fu_engine_emit_device_changed (helper->self, helper->device);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_engine_emit_device_changed_defer (FuEngine *self, FuDevice *device, gboolean progress_only)
+{
+	FuEngineDeviceChangedHelper *helper = g_new0 (FuEngineDeviceChangedHelper, 1);
+	helper->self = g_object_ref (self);
+	helper->device = g_object_ref (device);
+	helper->progress_only = progress_only;
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			 fu_engine_emit_device_changed_idle_cb,
+			 helper,
+			 (GDestroyNotify) fu_engine_device_changed_helper_free);
+}
+
+/* devices being installed in worker threads must not be serialized by the
+ * main thread, so their changes are emitted once all the threads are done */
+static gboolean
+fu_engine_install_defer_device_changed (FuEngine *self, FuDevice *device)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->install_mutex);
+
+	if (self->install_devices == NULL)
+		return FALSE;
+	if (g_thread_self () == self->main_thread) {
+		gboolean installing = FALSE;
+		for (guint i = 0; i < self->install_devices->len; i++) {
+			FuDevice *device_tmp = g_ptr_array_index (self->install_devices, i);
+			if (g_strcmp0 (fu_device_get_id (device_tmp),
+				       fu_device_get_id (device)) == 0) {
+				installing = TRUE;
+				break;
+			}
+		}
+		if (!installing)
+			return FALSE;
+	}
+	for (guint i = 0; i < self->install_devices_changed->len; i++) {
+		if (g_ptr_array_index (self->install_devices_changed, i) == device)
+			return TRUE;
+	}
+	g_ptr_array_add (self->install_devices_changed, g_object_ref (device));
+	return TRUE;
+}
+
 static void
 fu_engine_emit_device_changed (FuEngine *self, FuDevice *device)
 {
-	/* invalidate host security attributes */
+	if (fu_engine_install_defer_device_changed (self, device))
+		return;
+
+	/* only emit from the main thread */
+	if (g_thread_self () != self->main_thread) {
+		fu_engine_emit_device_changed_defer (self, device, FALSE);
+		return;
+	}
+
+	/* this supersedes any pending progress change */
+	g_hash_table_remove (self->progress_notify_pending, device);
+
+	/* invalidate host security attributes and cached releases */
 	g_clear_pointer (&self->host_security_id, g_free);
+	fu_engine_invalidate_releases_cache (self);
+	fu_engine_invalidate_devices_cache (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
 }
 
+static gboolean
+fu_engine_progress_notify_timeout_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autoptr(GList) devices = NULL;
+
+	/* nothing changed since the last emission, so stop the timer */
+	if (g_hash_table_size (self->progress_notify_pending) == 0) {
+		self->progress_notify_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+	devices = g_hash_table_get_keys (self->progress_notify_pending);
+	for (GList *l = devices; l != NULL; l = l->next) {
+		g_autoptr(FuDevice) device = g_object_ref (l->data);
+		fu_engine_emit_device_changed (self, device);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+/* progress updates can happen for every packet written, so coalesce the
+ * changes for each device and emit at most ProgressNotifyRate times a second;
+ * the percentage itself is sent as a lightweight property change */
+static void
+fu_engine_emit_device_changed_progress (FuEngine *self, FuDevice *device)
+{
+	guint rate = fu_config_get_progress_notify_rate (self->config);
+
+	if (fu_engine_install_defer_device_changed (self, device))
+		return;
+
+	/* only emit from the main thread */
+	if (g_thread_self () != self->main_thread) {
+		fu_engine_emit_device_changed_defer (self, device, TRUE);
+		return;
+	}
+
+	/* no limit */
+	if (rate == 0) {
+		fu_engine_emit_device_changed (self, device);
+		return;
+	}
+
+	/* already sent one recently */
+	if (self->progress_notify_id != 0) {
+		g_hash_table_add (self->progress_notify_pending, g_object_ref (device));
+		return;
+	}
+	fu_engine_emit_device_changed (self, device);
+	self->progress_notify_id = g_timeout_add (MAX (1000 / rate, 1),
+						  fu_engine_progress_notify_timeout_cb,
+						  self);
+}
+
+typedef struct {
+	GThread			*owner;
+	guint			 depth;
+} FuEngineDeviceLock;
+
+typedef struct {
+	FuEngine		*self;
+	GPtrArray		*ids;		/* of gchar* */
+} FuEngineDeviceLocker;
+
+static void
+fu_engine_device_locker_add_ids (FuDevice *device, GPtrArray *ids)
+{
+	for (FuDevice *tmp = device; tmp != NULL; tmp = fu_device_get_parent (tmp)) {
+		const gchar *id = fu_device_get_id (tmp);
+		FuDevice *proxy = fu_device_get_proxy (tmp);
+		gboolean found = FALSE;
+		if (id == NULL)
+			continue;
+		for (guint i = 0; i < ids->len; i++) {
+			if (g_strcmp0 (g_ptr_array_index (ids, i), id) == 0) {
+				found = TRUE;
+				break;
+			}
+		}
+		if (found)
+			return;
+		g_ptr_array_add (ids, g_strdup (id));
+		if (proxy != NULL)
+			fu_engine_device_locker_add_ids (proxy, ids);
+	}
+}
+
+static gboolean
+fu_engine_device_locker_is_available (FuEngine *self, GPtrArray *ids)
+{
+	for (guint i = 0; i < ids->len; i++) {
+		FuEngineDeviceLock *lock;
+		lock = g_hash_table_lookup (self->device_locks, g_ptr_array_index (ids, i));
+		if (lock != NULL && lock->owner != g_thread_self ())
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* locks the device, its parents and any proxy so that operations on
+ * unrelated devices can run at the same time; blocks until available */
+static FuEngineDeviceLocker *
+fu_engine_device_locker_new (FuEngine *self, FuDevice *device)
+{
+	FuEngineDeviceLocker *locker = g_new0 (FuEngineDeviceLocker, 1);
+	g_autoptr(GMutexLocker) mutex_locker = NULL;
+
+	locker->self = g_object_ref (self);
+	locker->ids = g_ptr_array_new_with_free_func (g_free);
+	fu_engine_device_locker_add_ids (device, locker->ids);
+
+	mutex_locker = g_mutex_locker_new (&self->device_locks_mutex);
+	while (!fu_engine_device_locker_is_available (self, locker->ids)) {
+		g_debug ("waiting for %s to be available", fu_device_get_id (device));
+		g_cond_wait (&self->device_locks_cond, &self->device_locks_mutex);
+	}
+	for (guint i = 0; i < locker->ids->len; i++) {
+		const gchar *id = g_ptr_array_index (locker->ids, i);
+		FuEngineDeviceLock *lock = g_hash_table_lookup (self->device_locks, id);
+		if (lock == NULL) {
+			lock = g_new0 (FuEngineDeviceLock, 1);
+			lock->owner = g_thread_self ();
+			g_hash_table_insert (self->device_locks, g_strdup (id), lock);
+		}
+		lock->depth++;
+	}
+	return locker;
+}
+
+static void
+fu_engine_device_locker_free (FuEngineDeviceLocker *locker)
+{
+	FuEngine *self = locker->self;
+	g_mutex_lock (&self->device_locks_mutex);
+	for (guint i = 0; i < locker->ids->len; i++) {
+		const gchar *id = g_ptr_array_index (locker->ids, i);
+		FuEngineDeviceLock *lock = g_hash_table_lookup (self->device_locks, id);
+		if (lock == NULL)
+			continue;
+		if (--lock->depth == 0)
+			g_hash_table_remove (self->device_locks, id);
+	}
+	g_cond_broadcast (&self->device_locks_cond);
+	g_mutex_unlock (&self->device_locks_mutex);
+	g_ptr_array_unref (locker->ids);
+	g_object_unref (locker->self);
+	g_free (locker);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuEngineDeviceLocker, fu_engine_device_locker_free)
+
 static gint
 fu_engine_gtypes_sort_cb (gconstpointer a, gconstpointer b)
 {
@@ -199,9 +771,13 @@ fu_engine_get_status (FuEngine *self)
 static void
 fu_engine_set_status (FuEngine *self, FwupdStatus status)
 {
-	if (self->status == status)
+	g_mutex_lock (&self->status_mutex);
+	if (self->status == status) {
+		g_mutex_unlock (&self->status_mutex);
 		return;
+	}
 	self->status = status;
+	g_mutex_unlock (&self->status_mutex);
 
 	/* emit changed */
 	g_debug ("Emitting PropertyChanged('Status'='%s')",
@@ -212,21 +788,145 @@ fu_engine_set_status (FuEngine *self, FwupdStatus status)
 static void
 fu_engine_set_percentage (FuEngine *self, guint percentage)
 {
-	if (self->percentage == percentage)
+	g_mutex_lock (&self->status_mutex);
+	if (self->percentage == percentage) {
+		g_mutex_unlock (&self->status_mutex);
 		return;
+	}
 	self->percentage = percentage;
+	g_mutex_unlock (&self->status_mutex);
 
 	/* emit changed */
 	g_signal_emit (self, signals[SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
 }
 
+typedef enum {
+	FU_ENGINE_INSTALL_PHASE_DETACH,
+	FU_ENGINE_INSTALL_PHASE_WRITE,
+	FU_ENGINE_INSTALL_PHASE_ATTACH,
+	FU_ENGINE_INSTALL_PHASE_VERIFY,
+	FU_ENGINE_INSTALL_PHASE_LAST
+} FuEngineInstallPhase;
+
+typedef struct {
+	gdouble			 weights[FU_ENGINE_INSTALL_PHASE_LAST];	/* sum to 1 */
+	FuEngineInstallPhase	 phase;
+	gdouble			 progress;	/* never goes backwards */
+} FuEngineInstallPhases;
+
+/* the device only reports the completion of the current phase, so scale it
+ * using how long each phase took the last few times for this device */
+static gdouble
+fu_engine_get_install_progress_device (FuEngine *self, FuDevice *device)
+{
+	FuEngineInstallPhases *phases;
+	gdouble start = 0.f;
+
+	phases = g_hash_table_lookup (self->install_phases, fu_device_get_id (device));
+	if (phases == NULL)
+		return fu_device_get_progress (device);
+	for (guint i = 0; i < phases->phase; i++)
+		start += phases->weights[i];
+	phases->progress = MAX (phases->progress,
+				100.f * (start + (phases->weights[phases->phase] *
+						  fu_device_get_progress (device)) / 100.f));
+	return phases->progress;
+}
+
+/* when installing in parallel the percentage is weighted by the expected
+ * duration of each device so that a slow device dominates the estimate */
+static guint
+fu_engine_get_install_progress (FuEngine *self, FuDevice *device)
+{
+	gdouble total = 0.f;
+	gdouble weight_total = 0.f;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->install_mutex);
+
+	if (self->install_devices == NULL || self->install_devices->len == 0)
+		return (guint) fu_engine_get_install_progress_device (self, device);
+	for (guint i = 0; i < self->install_devices->len; i++) {
+		FuDevice *device_tmp = g_ptr_array_index (self->install_devices, i);
+		gdouble weight = MAX (fu_device_get_install_duration (device_tmp), 1);
+		total += fu_engine_get_install_progress_device (self, device_tmp) * weight;
+		weight_total += weight;
+	}
+	return (guint) (total / weight_total);
+}
+
+static void
+fu_engine_install_phases_start (FuEngine *self, FuDevice *device)
+{
+	FuHistoryDurations durations = { 0 };
+	FuEngineInstallPhases *phases = g_new0 (FuEngineInstallPhases, 1);
+	gdouble total;
+	g_autoptr(GError) error_local = NULL;
+
+	/* defaults for a device that has never been updated */
+	phases->weights[FU_ENGINE_INSTALL_PHASE_DETACH] = 5;
+	phases->weights[FU_ENGINE_INSTALL_PHASE_WRITE] = 80;
+	phases->weights[FU_ENGINE_INSTALL_PHASE_ATTACH] = 5;
+	phases->weights[FU_ENGINE_INSTALL_PHASE_VERIFY] = 10;
+	if (fu_device_get_plugin (device) != NULL &&
+	    fu_device_get_guid_default (device) != NULL) {
+		if (fu_history_get_durations (self->history,
+					      fu_device_get_plugin (device),
+					      fu_device_get_guid_default (device),
+					      &durations,
+					      &error_local)) {
+			phases->weights[FU_ENGINE_INSTALL_PHASE_DETACH] = durations.detach + 1;
+			phases->weights[FU_ENGINE_INSTALL_PHASE_WRITE] = durations.write + 1;
+			phases->weights[FU_ENGINE_INSTALL_PHASE_ATTACH] = durations.attach + 1;
+			phases->weights[FU_ENGINE_INSTALL_PHASE_VERIFY] = durations.verify + 1;
+		} else if (!g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND)) {
+			g_debug ("no install durations: %s", error_local->message);
+		}
+	}
+	total = 0.f;
+	for (guint i = 0; i < FU_ENGINE_INSTALL_PHASE_LAST; i++)
+		total += phases->weights[i];
+	for (guint i = 0; i < FU_ENGINE_INSTALL_PHASE_LAST; i++)
+		phases->weights[i] /= total;
+	phases->phase = FU_ENGINE_INSTALL_PHASE_DETACH;
+
+	g_mutex_lock (&self->install_mutex);
+	g_hash_table_insert (self->install_phases,
+			     g_strdup (fu_device_get_id (device)),
+			     phases);
+	g_mutex_unlock (&self->install_mutex);
+}
+
+static void
+fu_engine_install_phases_set (FuEngine *self, const gchar *device_id, FuEngineInstallPhase phase)
+{
+	FuEngineInstallPhases *phases;
+	g_autoptr(FuDevice) device = NULL;
+
+	g_mutex_lock (&self->install_mutex);
+	phases = g_hash_table_lookup (self->install_phases, device_id);
+	if (phases != NULL)
+		phases->phase = phase;
+	g_mutex_unlock (&self->install_mutex);
+
+	/* the completion left over from the last phase is meaningless */
+	device = fu_device_list_get_by_id (self->device_list, device_id, NULL);
+	if (device != NULL)
+		fu_device_set_progress (device, 0);
+}
+
+static void
+fu_engine_install_phases_stop (FuEngine *self, const gchar *device_id)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->install_mutex);
+	g_hash_table_remove (self->install_phases, device_id);
+}
+
 static void
 fu_engine_progress_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
 {
 	if (fu_device_get_status (device) == FWUPD_STATUS_UNKNOWN)
 		return;
-	fu_engine_set_percentage (self, fu_device_get_progress (device));
-	fu_engine_emit_device_changed (self, device);
+	fu_engine_set_percentage (self, fu_engine_get_install_progress (self, device));
+	fu_engine_emit_device_changed_progress (self, device);
 }
 
 static void
@@ -258,6 +958,8 @@ static void
 fu_engine_device_added_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
 	fu_engine_watch_device (self, device);
+	fu_engine_invalidate_releases_cache (self);
+	fu_engine_invalidate_devices_cache (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 }
 
@@ -276,6 +978,8 @@ fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngi
 {
 	fu_engine_device_runner_device_removed (self, device);
 	g_signal_handlers_disconnect_by_data (device, self);
+	fu_engine_invalidate_releases_cache (self);
+	fu_engine_invalidate_devices_cache (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
 }
 
@@ -463,20 +1167,39 @@ fu_engine_set_release_from_appstream (FuEngine *self,
 	return TRUE;
 }
 
-/* finds the remote-id for the first firmware in the silo that matches this
- * container checksum */
+/* the query is compiled once for each shard, and the caller binds the value */
+static XbQuery *
+fu_engine_shard_get_query (FuEngineShard *shard, FuEngineQuery kind, GError **error)
+{
+	if (shard->queries[kind] == NULL) {
+		shard->queries[kind] = xb_query_new_full (shard->silo,
+							  fu_engine_query_xpaths[kind],
+							  XB_QUERY_FLAG_OPTIMIZE |
+							  XB_QUERY_FLAG_USE_INDEXES,
+							  error);
+		if (shard->queries[kind] == NULL)
+			return NULL;
+	}
+	return shard->queries[kind];
+}
+
+/* finds the remote-id for the first firmware in the remotes that matches
+ * this container checksum */
 static const gchar *
 fu_engine_get_remote_id_for_checksum (FuEngine *self, const gchar *csum)
 {
-	g_autofree gchar *xpath = NULL;
-	g_autoptr(XbNode) key = NULL;
-	xpath = g_strdup_printf ("components/component/releases/release/"
-				 "checksum[@target='container'][text()='%s']/../../"
-				 "../../custom/value[@key='fwupd::RemoteId']", csum);
-	key = xb_silo_query_first (self->silo, xpath, NULL);
-	if (key == NULL)
-		return NULL;
-	return xb_node_get_text (key);
+	for (guint i = 0; i < self->shards->len; i++) {
+		FuEngineShard *shard = g_ptr_array_index (self->shards, i);
+		const gchar *remote_id;
+		if (!fu_engine_shard_might_contain (shard, csum))
+			continue;
+		if (!fu_engine_shard_ensure_silo (self, shard))
+			continue;
+		remote_id = g_hash_table_lookup (shard->checksum_remote_ids, csum);
+		if (remote_id != NULL)
+			return remote_id;
+	}
+	return NULL;
 }
 
 /**
@@ -494,6 +1217,7 @@ fu_engine_unlock (FuEngine *self, const gchar *device_id, GError **error)
 {
 	FuPlugin *plugin;
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(FuEngineDeviceLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -512,6 +1236,7 @@ fu_engine_unlock (FuEngine *self, const gchar *device_id, GError **error)
 		return FALSE;
 
 	/* run the correct plugin that added this */
+	locker = fu_engine_device_locker_new (self, device);
 	if (!fu_plugin_runner_unlock (plugin, device, error))
 		return FALSE;
 
@@ -526,9 +1251,12 @@ fu_engine_modify_config (FuEngine *self, const gchar *key, const gchar *value, G
 {
 	const gchar *keys[] = {
 		"ArchiveSizeMax",
+		"ArchiveCacheSizeMax",
+		"MemoryBudget",
 		"DisabledDevices",
 		"DisabledPlugins",
 		"IdleTimeout",
+		"UdevChangeDebounce",
 		"VerboseDomains",
 		"UpdateMotd",
 		"EnumerateAllDevices",
@@ -578,6 +1306,7 @@ fu_engine_modify_remote (FuEngine *self,
 		"Enabled",
 		"FirmwareBaseURI",
 		"MetadataURI",
+		"PeerCacheURI",
 		"ReportURI",
 		"SecurityReportURI",
 		NULL,
@@ -689,6 +1418,7 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 	g_autoptr(XbBuilderNode) release = NULL;
 	g_autoptr(XbBuilderNode) releases = NULL;
 	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(FuEngineDeviceLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -698,6 +1428,7 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
 		return FALSE;
+	locker = fu_engine_device_locker_new (self, device);
 
 	/* get the plugin */
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -773,26 +1504,160 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 	return TRUE;
 }
 
-XbNode *
-fu_engine_get_component_by_guids (FuEngine *self, FuDevice *device)
+/* map every flashed GUID to the components providing it, and every container
+ * checksum to the remote, so that looking up all the devices or cabinets
+ * costs one pass over the shard rather than a query each; if the shard has
+ * no bloom filter yet then one is built from the same keys */
+static void
+fu_engine_shard_ensure_index (FuEngineShard *shard)
 {
-	GPtrArray *guids = fu_device_get_guids (device);
-	g_autoptr(GString) xpath = g_string_new (NULL);
-	g_autoptr(XbNode) component = NULL;
-	for (guint i = 0; i < guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (guids, i);
-		xb_string_append_union (xpath,
-					"components/component/"
-					"provides/firmware[@type='flashed'][text()='%s']/"
-					"../..", guid);
-	}
-	component = xb_silo_query_first (self->silo, xpath->str, NULL);
-	if (component != NULL)
-		return g_steal_pointer (&component);
-	return NULL;
-}
+	GHashTableIter iter;
+	gpointer key = NULL;
+	guint nkeys;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(GPtrArray) components = NULL;
 
-static XbNode *
+	if (shard->component_guids != NULL)
+		return;
+	shard->component_guids = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free,
+							(GDestroyNotify) g_ptr_array_unref);
+	shard->checksum_remote_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free, g_free);
+	if (shard->silo == NULL)
+		return;
+	span = fu_trace_span_new ("engine", "ensure_silo_index");
+	components = xb_silo_query (shard->silo, "components/component", 0, NULL);
+	for (guint i = 0; components != NULL && i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+		const gchar *remote_id;
+		g_autoptr(GPtrArray) csums = NULL;
+		g_autoptr(GPtrArray) provides = NULL;
+
+		/* the first remote providing the checksum wins */
+		remote_id = xb_node_query_text (component,
+						"../custom/value[@key='fwupd::RemoteId']",
+						NULL);
+		csums = xb_node_query (component,
+				       "releases/release/checksum[@target='container']",
+				       0, NULL);
+		for (guint j = 0; remote_id != NULL && csums != NULL && j < csums->len; j++) {
+			XbNode *csum = g_ptr_array_index (csums, j);
+			const gchar *tmp = xb_node_get_text (csum);
+			if (tmp == NULL ||
+			    g_hash_table_contains (shard->checksum_remote_ids, tmp))
+				continue;
+			g_hash_table_insert (shard->checksum_remote_ids,
+					     g_strdup (tmp),
+					     g_strdup (remote_id));
+		}
+
+		provides = xb_node_query (component,
+					  "provides/firmware[@type='flashed']",
+					  0, NULL);
+		if (provides == NULL)
+			continue;
+		for (guint j = 0; j < provides->len; j++) {
+			XbNode *firmware = g_ptr_array_index (provides, j);
+			const gchar *guid = xb_node_get_text (firmware);
+			GPtrArray *array;
+			if (guid == NULL)
+				continue;
+			array = g_hash_table_lookup (shard->component_guids, guid);
+			if (array == NULL) {
+				array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+				g_hash_table_insert (shard->component_guids,
+						     g_strdup (guid), array);
+			}
+
+			/* the same GUID listed twice in one component */
+			if (array->len > 0 &&
+			    g_ptr_array_index (array, array->len - 1) == component)
+				continue;
+			g_ptr_array_add (array, g_object_ref (component));
+		}
+	}
+	g_debug ("%u flashed GUIDs and %u container checksums in %s",
+		 g_hash_table_size (shard->component_guids),
+		 g_hash_table_size (shard->checksum_remote_ids),
+		 shard->remote != NULL ? fwupd_remote_get_id (shard->remote) : "silo");
+
+	/* the filter is only useful when it can be saved for next time */
+	if (shard->bloom != NULL || shard->bloom_fn == NULL)
+		return;
+	nkeys = g_hash_table_size (shard->component_guids) +
+		g_hash_table_size (shard->checksum_remote_ids);
+	shard->bloom = g_byte_array_new ();
+	g_byte_array_set_size (shard->bloom,
+			       MAX (nkeys * FU_ENGINE_SHARD_BLOOM_BITS_PER_KEY / 8, 8));
+	memset (shard->bloom->data, 0x0, shard->bloom->len);
+	g_hash_table_iter_init (&iter, shard->component_guids);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		fu_engine_shard_bloom_add (shard->bloom, key);
+	g_hash_table_iter_init (&iter, shard->checksum_remote_ids);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		fu_engine_shard_bloom_add (shard->bloom, key);
+	fu_engine_shard_save_bloom (shard);
+}
+
+/* returns the components in @shard providing @guid, which may be %NULL */
+static GPtrArray *
+fu_engine_shard_get_components_by_guid (FuEngine *self,
+					FuEngineShard *shard,
+					const gchar *guid)
+{
+	if (!fu_engine_shard_might_contain (shard, guid))
+		return NULL;
+	if (!fu_engine_shard_ensure_silo (self, shard))
+		return NULL;
+	return g_hash_table_lookup (shard->component_guids, guid);
+}
+
+/* returns all the components providing any of the device GUIDs, in GUID order */
+static GPtrArray *
+fu_engine_get_components_by_guids (FuEngine *self, FuDevice *device)
+{
+	GPtrArray *guids = fu_device_get_guids (device);
+	GPtrArray *components;
+	g_autoptr(GHashTable) seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	components = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		for (guint k = 0; k < self->shards->len; k++) {
+			FuEngineShard *shard = g_ptr_array_index (self->shards, k);
+			GPtrArray *array = fu_engine_shard_get_components_by_guid (self, shard, guid);
+			if (array == NULL)
+				continue;
+			for (guint j = 0; j < array->len; j++) {
+				XbNode *component = g_ptr_array_index (array, j);
+				if (!g_hash_table_add (seen, component))
+					continue;
+				g_ptr_array_add (components, g_object_ref (component));
+			}
+		}
+	}
+	return components;
+}
+
+XbNode *
+fu_engine_get_component_by_guids (FuEngine *self, FuDevice *device)
+{
+	GPtrArray *guids = fu_device_get_guids (device);
+
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		for (guint k = 0; k < self->shards->len; k++) {
+			FuEngineShard *shard = g_ptr_array_index (self->shards, k);
+			GPtrArray *array = fu_engine_shard_get_components_by_guid (self, shard, guid);
+			if (array != NULL && array->len > 0)
+				return g_object_ref (g_ptr_array_index (array, 0));
+		}
+	}
+	return NULL;
+}
+
+static XbNode *
 fu_engine_verify_from_local_metadata (FuEngine *self,
 				      FuDevice *device,
 				      GError **error)
@@ -849,47 +1714,57 @@ fu_engine_verify_from_system_metadata (FuEngine *self,
 {
 	FwupdVersionFormat fmt = fu_device_get_version_format (device);
 	GPtrArray *guids = fu_device_get_guids (device);
-	g_autoptr(XbQuery) query = NULL;
 
-	/* prepare query with bound GUID parameter */
-	query = xb_query_new_full (self->silo,
-				   "components/component/"
-				   "provides/firmware[@type='flashed'][text()=?]/"
-				   "../../releases/release",
-				   XB_QUERY_FLAG_OPTIMIZE |
-				   XB_QUERY_FLAG_USE_INDEXES,
-				   error);
-	if (query == NULL)
+	if (self->shards->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no metadata loaded");
 		return NULL;
+	}
 
-	/* use prepared query for each GUID */
+	/* use prepared query for each GUID, only in shards that may match */
 	for (guint i = 0; i < guids->len; i++) {
 		const gchar *guid = g_ptr_array_index (guids, i);
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GPtrArray) releases = NULL;
+		for (guint k = 0; k < self->shards->len; k++) {
+			FuEngineShard *shard = g_ptr_array_index (self->shards, k);
+			XbQuery *query;
+			g_autoptr(GError) error_local = NULL;
+			g_autoptr(GPtrArray) releases = NULL;
 
-		/* bind GUID and then query */
-		if (!xb_query_bind_str (query, 0, guid, error)) {
-			g_prefix_error (error, "failed to bind string: ");
-			return NULL;
-		}
-		releases = xb_silo_query_full (self->silo, query, &error_local);
-		if (releases == NULL) {
-			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
-			    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
-				g_debug ("could not find %s: %s",
-					 guid, error_local->message);
+			if (!fu_engine_shard_might_contain (shard, guid))
 				continue;
+			if (!fu_engine_shard_ensure_silo (self, shard))
+				continue;
+
+			/* bind GUID and then query */
+			query = fu_engine_shard_get_query (shard,
+							   FU_ENGINE_QUERY_RELEASES_BY_GUID,
+							   error);
+			if (query == NULL)
+				return NULL;
+			if (!xb_query_bind_str (query, 0, guid, error)) {
+				g_prefix_error (error, "failed to bind string: ");
+				return NULL;
+			}
+			releases = xb_silo_query_full (shard->silo, query, &error_local);
+			if (releases == NULL) {
+				if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+				    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
+					g_debug ("could not find %s: %s",
+						 guid, error_local->message);
+					continue;
+				}
+				g_propagate_error (error, g_steal_pointer (&error_local));
+				return NULL;
+			}
+			for (guint j = 0; j < releases->len; j++) {
+				XbNode *rel = g_ptr_array_index (releases, j);
+				const gchar *rel_ver = xb_node_get_attr (rel, "version");
+				g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
+				if (fu_common_vercmp_full (tmp_ver, fu_device_get_version (device), fmt) == 0)
+					return g_object_ref (rel);
 			}
-			g_propagate_error (error, g_steal_pointer (&error_local));
-			return NULL;
-		}
-		for (guint j = 0; j < releases->len; j++) {
-			XbNode *rel = g_ptr_array_index (releases, j);
-			const gchar *rel_ver = xb_node_get_attr (rel, "version");
-			g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
-			if (fu_common_vercmp_full (tmp_ver, fu_device_get_version (device), fmt) == 0)
-				return g_object_ref (rel);
 		}
 	}
 
@@ -901,35 +1776,13 @@ fu_engine_verify_from_system_metadata (FuEngine *self,
 	return NULL;
 }
 
-/**
- * fu_engine_verify:
- * @self: A #FuEngine
- * @device_id: A device ID
- * @error: A #GError, or %NULL
- *
- * Verifies a device firmware checksum using the verification silo entry.
- *
- * Returns: %TRUE for success
- **/
-gboolean
-fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
+/* update the device firmware hashes if possible, which is safe to do from
+ * a worker thread if the plugin allows installing from one */
+static gboolean
+fu_engine_verify_readback (FuEngine *self, FuDevice *device, GError **error)
 {
 	FuPlugin *plugin;
-	GPtrArray *checksums;
-	g_autoptr(FuDevice) device = NULL;
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GString) xpath_csum = g_string_new (NULL);
-	g_autoptr(XbNode) csum = NULL;
-	g_autoptr(XbNode) release = NULL;
-
-	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
-	g_return_val_if_fail (device_id != NULL, FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
-	/* check the id exists */
-	device = fu_device_list_get_by_id (self->device_list, device_id, error);
-	if (device == NULL)
-		return FALSE;
+	g_autoptr(FuEngineDeviceLocker) locker = fu_engine_device_locker_new (self, device);
 
 	/* get the plugin */
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -937,13 +1790,21 @@ fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
 					      error);
 	if (plugin == NULL)
 		return FALSE;
+	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE))
+		return TRUE;
+	return fu_plugin_runner_verify (plugin, device,
+				       FU_PLUGIN_VERIFY_FLAG_NONE, error);
+}
 
-	/* update the device firmware hashes if possible */
-	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE)) {
-		if (!fu_plugin_runner_verify (plugin, device,
-					      FU_PLUGIN_VERIFY_FLAG_NONE, error))
-			return FALSE;
-	}
+/* compare the device checksums with the metadata on the main thread */
+static gboolean
+fu_engine_verify_checksums (FuEngine *self, FuDevice *device, GError **error)
+{
+	GPtrArray *checksums;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GString) xpath_csum = g_string_new (NULL);
+	g_autoptr(XbNode) csum = NULL;
+	g_autoptr(XbNode) release = NULL;
 
 	/* find component in local metadata */
 	release = fu_engine_verify_from_local_metadata (self, device, &error_local);
@@ -1041,45 +1902,239 @@ fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
 	return TRUE;
 }
 
+/**
+ * fu_engine_verify:
+ * @self: A #FuEngine
+ * @device_id: A device ID
+ * @error: A #GError, or %NULL
+ *
+ * Verifies a device firmware checksum using the verification silo entry.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
+{
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(FuEngineDeviceLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (device_id != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* check the id exists */
+	device = fu_device_list_get_by_id (self->device_list, device_id, error);
+	if (device == NULL)
+		return FALSE;
+	locker = fu_engine_device_locker_new (self, device);
+	if (!fu_engine_verify_readback (self, device, error))
+		return FALSE;
+	return fu_engine_verify_checksums (self, device, error);
+}
+
+/* requirements are compiled once per metadata component so that checking
+ * thousands of releases does not repeat the XPath queries and parsing */
+typedef enum {
+	FU_ENGINE_REQUIREMENT_KIND_UNKNOWN,
+	FU_ENGINE_REQUIREMENT_KIND_ID,
+	FU_ENGINE_REQUIREMENT_KIND_FIRMWARE,
+	FU_ENGINE_REQUIREMENT_KIND_HARDWARE,
+	FU_ENGINE_REQUIREMENT_KIND_CLIENT,
+} FuEngineRequirementKind;
+
+typedef enum {
+	FU_ENGINE_REQUIREMENT_COMPARE_UNKNOWN,
+	FU_ENGINE_REQUIREMENT_COMPARE_EQ,
+	FU_ENGINE_REQUIREMENT_COMPARE_NE,
+	FU_ENGINE_REQUIREMENT_COMPARE_LT,
+	FU_ENGINE_REQUIREMENT_COMPARE_GT,
+	FU_ENGINE_REQUIREMENT_COMPARE_LE,
+	FU_ENGINE_REQUIREMENT_COMPARE_GE,
+	FU_ENGINE_REQUIREMENT_COMPARE_GLOB,
+	FU_ENGINE_REQUIREMENT_COMPARE_REGEX,
+} FuEngineRequirementCompare;
+
+typedef struct {
+	FuEngineRequirementKind	 kind;
+	FuEngineRequirementCompare compare;
+	gchar			*element;
+	gchar			*text;		/* (nullable) */
+	gchar			*compare_str;	/* (nullable) */
+	gchar			*version;	/* (nullable) */
+	FuCommonVersion		*version_parsed;	/* (nullable) */
+	gchar			**values;	/* (nullable): text split on '|' */
+	guint64			 depth;
+} FuEngineRequirement;
+
+static void
+fu_engine_requirement_free (FuEngineRequirement *req)
+{
+	g_free (req->element);
+	g_free (req->text);
+	g_free (req->compare_str);
+	g_free (req->version);
+	fu_common_version_free (req->version_parsed);
+	g_strfreev (req->values);
+	g_free (req);
+}
+
+static FuEngineRequirementCompare
+fu_engine_requirement_compare_from_string (const gchar *compare)
+{
+	if (g_strcmp0 (compare, "eq") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_EQ;
+	if (g_strcmp0 (compare, "ne") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_NE;
+	if (g_strcmp0 (compare, "lt") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_LT;
+	if (g_strcmp0 (compare, "gt") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_GT;
+	if (g_strcmp0 (compare, "le") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_LE;
+	if (g_strcmp0 (compare, "ge") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_GE;
+	if (g_strcmp0 (compare, "glob") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_GLOB;
+	if (g_strcmp0 (compare, "regex") == 0)
+		return FU_ENGINE_REQUIREMENT_COMPARE_REGEX;
+	return FU_ENGINE_REQUIREMENT_COMPARE_UNKNOWN;
+}
+
+static FuEngineRequirement *
+fu_engine_requirement_new (XbNode *n)
+{
+	FuEngineRequirement *req = g_new0 (FuEngineRequirement, 1);
+	const gchar *element = xb_node_get_element (n);
+
+	req->element = g_strdup (element);
+	req->text = g_strdup (xb_node_get_text (n));
+	req->compare_str = g_strdup (xb_node_get_attr (n, "compare"));
+	req->compare = fu_engine_requirement_compare_from_string (req->compare_str);
+	req->version = g_strdup (xb_node_get_attr (n, "version"));
+	req->version_parsed = fu_common_version_new (req->version);
+	req->depth = xb_node_get_attr_as_uint (n, "depth");
+	if (g_strcmp0 (element, "id") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_ID;
+	} else if (g_strcmp0 (element, "firmware") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_FIRMWARE;
+	} else if (g_strcmp0 (element, "hardware") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_HARDWARE;
+	} else if (g_strcmp0 (element, "client") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_CLIENT;
+	}
+	if (req->kind == FU_ENGINE_REQUIREMENT_KIND_HARDWARE ||
+	    req->kind == FU_ENGINE_REQUIREMENT_KIND_CLIENT)
+		req->values = g_strsplit (req->text != NULL ? req->text : "", "|", -1);
+	return req;
+}
+
+static GPtrArray *
+fu_engine_compile_requirements (XbNode *component, GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) reqs = NULL;
+	g_autoptr(GPtrArray) compiled = NULL;
+
+	compiled = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_requirement_free);
+	reqs = xb_node_query (component, "requires/*", 0, &error_local);
+	if (reqs == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return g_steal_pointer (&compiled);
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			return g_steal_pointer (&compiled);
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
+	}
+	for (guint i = 0; i < reqs->len; i++) {
+		XbNode *req = g_ptr_array_index (reqs, i);
+		g_ptr_array_add (compiled, fu_engine_requirement_new (req));
+	}
+	return g_steal_pointer (&compiled);
+}
+
+/* components in the metadata silo carry an index added when the silo is
+ * built, which is used to find the compiled requirements */
+static GPtrArray *
+fu_engine_get_requirements (FuEngine *self, XbNode *component, GError **error)
+{
+	FuEngineShard *shard = NULL;
+	GPtrArray *compiled;
+	XbSilo *silo = xb_node_get_silo (component);
+	guint64 idx;
+
+	/* archives and test silos are not indexed */
+	for (guint i = 0; i < self->shards->len; i++) {
+		FuEngineShard *shard_tmp = g_ptr_array_index (self->shards, i);
+		if (shard_tmp->silo != NULL && shard_tmp->silo == silo) {
+			shard = shard_tmp;
+			break;
+		}
+	}
+	if (shard == NULL)
+		return fu_engine_compile_requirements (component, error);
+	idx = xb_node_get_attr_as_uint (component, "fwupd-index");
+	if (idx == G_MAXUINT64)
+		return fu_engine_compile_requirements (component, error);
+
+	compiled = g_hash_table_lookup (shard->requirements_cache, GUINT_TO_POINTER (idx));
+	fu_metrics_cache_lookup ("requirements", compiled != NULL);
+	if (compiled == NULL) {
+		compiled = fu_engine_compile_requirements (component, error);
+		if (compiled == NULL)
+			return NULL;
+		g_hash_table_insert (shard->requirements_cache,
+				     GUINT_TO_POINTER (idx),
+				     compiled);
+	}
+	return g_ptr_array_ref (compiled);
+}
+
 static gboolean
-fu_engine_require_vercmp (XbNode *req,
+fu_engine_require_vercmp (FuEngineRequirement *req,
 			  const gchar *version,
 			  FwupdVersionFormat fmt,
 			  GError **error)
 {
 	gboolean ret = FALSE;
-	gint rc = 0;
-	const gchar *tmp = xb_node_get_attr (req, "compare");
-	const gchar *version_req = xb_node_get_attr (req, "version");
-
-	if (g_strcmp0 (tmp, "eq") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc == 0;
-	} else if (g_strcmp0 (tmp, "ne") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc != 0;
-	} else if (g_strcmp0 (tmp, "lt") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc < 0;
-	} else if (g_strcmp0 (tmp, "gt") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc > 0;
-	} else if (g_strcmp0 (tmp, "le") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc <= 0;
-	} else if (g_strcmp0 (tmp, "ge") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc >= 0;
-	} else if (g_strcmp0 (tmp, "glob") == 0) {
-		ret = fu_common_fnmatch (version_req, version);
-	} else if (g_strcmp0 (tmp, "regex") == 0) {
-		ret = g_regex_match_simple (version_req, version, 0, 0);
-	} else {
+	g_autoptr(FuCommonVersion) version_parsed = NULL;
+
+	switch (req->compare) {
+	case FU_ENGINE_REQUIREMENT_COMPARE_EQ:
+	case FU_ENGINE_REQUIREMENT_COMPARE_NE:
+	case FU_ENGINE_REQUIREMENT_COMPARE_LT:
+	case FU_ENGINE_REQUIREMENT_COMPARE_GT:
+	case FU_ENGINE_REQUIREMENT_COMPARE_LE:
+	case FU_ENGINE_REQUIREMENT_COMPARE_GE:
+	{
+		gint rc;
+		version_parsed = fu_common_version_new (version);
+		rc = fu_common_version_compare (version_parsed, req->version_parsed, fmt);
+		if (req->compare == FU_ENGINE_REQUIREMENT_COMPARE_EQ)
+			ret = rc == 0;
+		else if (req->compare == FU_ENGINE_REQUIREMENT_COMPARE_NE)
+			ret = rc != 0;
+		else if (req->compare == FU_ENGINE_REQUIREMENT_COMPARE_LT)
+			ret = rc < 0;
+		else if (req->compare == FU_ENGINE_REQUIREMENT_COMPARE_GT)
+			ret = rc > 0;
+		else if (req->compare == FU_ENGINE_REQUIREMENT_COMPARE_LE)
+			ret = rc <= 0;
+		else
+			ret = rc >= 0;
+		break;
+	}
+	case FU_ENGINE_REQUIREMENT_COMPARE_GLOB:
+		ret = fu_common_fnmatch (req->version, version);
+		break;
+	case FU_ENGINE_REQUIREMENT_COMPARE_REGEX:
+		ret = g_regex_match_simple (req->version, version, 0, 0);
+		break;
+	default:
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_SUPPORTED,
 			     "failed to compare [%s] and [%s]",
-			     version_req,
+			     req->version,
 			     version);
 		return FALSE;
 	}
@@ -1090,24 +2145,24 @@ fu_engine_require_vercmp (XbNode *req,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INTERNAL,
 			     "failed predicate [%s %s %s]",
-			     version_req, tmp, version);
+			     req->version, req->compare_str, version);
 	}
 	return ret;
 }
 
 static gboolean
-fu_engine_check_requirement_not_child (FuEngine *self, XbNode *req,
+fu_engine_check_requirement_not_child (FuEngine *self, FuEngineRequirement *req,
 				       FuDevice *device, GError **error)
 {
 	GPtrArray *children = fu_device_get_children (device);
 
 	/* only <firmware> supported */
-	if (g_strcmp0 (xb_node_get_element (req), "firmware") != 0) {
+	if (g_strcmp0 (req->element, "firmware") != 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_SUPPORTED,
 			     "cannot handle not-child %s requirement",
-			     xb_node_get_element (req));
+			     req->element);
 		return FALSE;
 	}
 
@@ -1139,7 +2194,7 @@ fu_engine_check_requirement_not_child (FuEngine *self, XbNode *req,
 }
 
 static gboolean
-fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
+fu_engine_check_requirement_firmware (FuEngine *self, FuEngineRequirement *req,
 				      FuDevice *device, GError **error)
 {
 	guint64 depth;
@@ -1147,7 +2202,7 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	g_autoptr(GError) error_local = NULL;
 
 	/* look at the parent device */
-	depth = xb_node_get_attr_as_uint (req, "depth");
+	depth = req->depth;
 	if (depth != G_MAXUINT64) {
 		for (guint64 i = 0; i < depth; i++) {
 			FuDevice *device_tmp = fu_device_get_parent (device_actual);
@@ -1165,17 +2220,17 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* old firmware version */
-	if (xb_node_get_text (req) == NULL) {
+	if (req->text == NULL) {
 		const gchar *version = fu_device_get_version (device_actual);
 		if (!fu_engine_require_vercmp (req, version,
 					       fu_device_get_version_format (device_actual),
 					       &error_local)) {
-			if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+			if (g_strcmp0 (req->compare_str, "ge") == 0) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "Not compatible with firmware version %s, requires >= %s",
-					     version, xb_node_get_attr (req, "version"));
+					     version, req->version);
 			} else {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -1189,17 +2244,17 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* bootloader version */
-	if (g_strcmp0 (xb_node_get_text (req), "bootloader") == 0) {
+	if (g_strcmp0 (req->text, "bootloader") == 0) {
 		const gchar *version = fu_device_get_version_bootloader (device_actual);
 		if (!fu_engine_require_vercmp (req, version,
 					       fu_device_get_version_format (device_actual),
 					       &error_local)) {
-			if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+			if (g_strcmp0 (req->compare_str, "ge") == 0) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_NOT_SUPPORTED,
 					     "Not compatible with bootloader version %s, requires >= %s",
-                                             version, xb_node_get_attr (req, "version"));
+                                             version, req->version);
 
 			} else {
 				g_debug ("Bootloader is not compatible: %s", error_local->message);
@@ -1214,7 +2269,7 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* vendor ID */
-	if (g_strcmp0 (xb_node_get_text (req), "vendor-id") == 0 &&
+	if (g_strcmp0 (req->text, "vendor-id") == 0 &&
 	    fu_device_get_vendor_id (device_actual) != NULL) {
 		const gchar *version = fu_device_get_vendor_id (device_actual);
 		if (!fu_engine_require_vercmp (req, version,
@@ -1231,12 +2286,12 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* child version */
-	if (g_strcmp0 (xb_node_get_text (req), "not-child") == 0)
+	if (g_strcmp0 (req->text, "not-child") == 0)
 		return fu_engine_check_requirement_not_child (self, req, device_actual, error);
 
 	/* another device */
-	if (fwupd_guid_is_valid (xb_node_get_text (req))) {
-		const gchar *guid = xb_node_get_text (req);
+	if (fwupd_guid_is_valid (req->text)) {
+		const gchar *guid = req->text;
 		const gchar *version;
 
 		/* find if the other device exists */
@@ -1262,18 +2317,18 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 		/* get the version of the other device */
 		version = fu_device_get_version (device_actual);
 		if (version != NULL &&
-		    xb_node_get_attr (req, "compare") != NULL &&
+		    req->compare_str != NULL &&
 		    !fu_engine_require_vercmp (req, version,
 					       fu_device_get_version_format (device_actual),
 					       &error_local)) {
-			if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+			if (g_strcmp0 (req->compare_str, "ge") == 0) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "Not compatible with %s version %s, requires >= %s",
 					     fu_device_get_name (device_actual),
 					     version,
-					     xb_node_get_attr (req, "version"));
+					     req->version);
 			} else {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -1293,59 +2348,56 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_NOT_SUPPORTED,
 		     "cannot handle firmware requirement '%s'",
-		     xb_node_get_text (req));
+		     req->text);
 	return FALSE;
 }
 
 static gboolean
-fu_engine_check_requirement_id (FuEngine *self, XbNode *req, GError **error)
+fu_engine_check_requirement_id (FuEngine *self, FuEngineRequirement *req, GError **error)
 {
 	g_autoptr(GError) error_local = NULL;
 	const gchar *version = g_hash_table_lookup (self->runtime_versions,
-						    xb_node_get_text (req));
+						    req->text);
 	if (version == NULL) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_FOUND,
 			     "no version available for %s",
-			     xb_node_get_text (req));
+			     req->text);
 		return FALSE;
 	}
 	if (!fu_engine_require_vercmp (req, version, FWUPD_VERSION_FORMAT_UNKNOWN, &error_local)) {
-		if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+		if (g_strcmp0 (req->compare_str, "ge") == 0) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "Not compatible with %s version %s, requires >= %s",
-				     xb_node_get_text (req), version,
-				     xb_node_get_attr (req, "version"));
+				     req->text, version,
+				     req->version);
 		} else {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "Not compatible with %s version: %s",
-				     xb_node_get_text (req), error_local->message);
+				     req->text, error_local->message);
 		}
 		return FALSE;
 	}
 
 	g_debug ("requirement %s %s %s on %s passed",
-		 xb_node_get_attr (req, "version"),
-		 xb_node_get_attr (req, "compare"),
-		 version, xb_node_get_text (req));
+		 req->version,
+		 req->compare_str,
+		 version, req->text);
 	return TRUE;
 }
 
 static gboolean
-fu_engine_check_requirement_hardware (FuEngine *self, XbNode *req, GError **error)
+fu_engine_check_requirement_hardware (FuEngine *self, FuEngineRequirement *req, GError **error)
 {
-	g_auto(GStrv) hwid_split = NULL;
-
-	/* split and treat as OR */
-	hwid_split = g_strsplit (xb_node_get_text (req), "|", -1);
-	for (guint i = 0; hwid_split[i] != NULL; i++) {
-		if (fu_hwids_has_guid (self->hwids, hwid_split[i])) {
-			g_debug ("HWID provided %s", hwid_split[i]);
+	/* treat as OR */
+	for (guint i = 0; req->values[i] != NULL; i++) {
+		if (fu_hwids_has_guid (self->hwids, req->values[i])) {
+			g_debug ("HWID provided %s", req->values[i]);
 			return TRUE;
 		}
 	}
@@ -1355,22 +2407,20 @@ fu_engine_check_requirement_hardware (FuEngine *self, XbNode *req, GError **erro
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_INVALID_FILE,
 		     "no HWIDs matched %s",
-		     xb_node_get_text (req));
+		     req->text);
 	return FALSE;
 }
 
 static gboolean
 fu_engine_check_requirement_client (FuEngine *self,
 				    FuEngineRequest *request,
-				    XbNode *req,
+				    FuEngineRequirement *req,
 				    GError **error)
 {
-	FwupdFeatureFlags flags;
-	g_auto(GStrv) feature_split = NULL;
+	FwupdFeatureFlags flags = fu_engine_request_get_feature_flags (request);
+	gchar **feature_split = req->values;
 
-	/* split and treat as AND */
-	feature_split = g_strsplit (xb_node_get_text (req), "|", -1);
-	flags = fu_engine_request_get_feature_flags (request);
+	/* treat as AND */
 	for (guint i = 0; feature_split[i] != NULL; i++) {
 		FwupdFeatureFlags flag = fwupd_feature_flag_from_string (feature_split[i]);
 
@@ -1402,35 +2452,31 @@ fu_engine_check_requirement_client (FuEngine *self,
 static gboolean
 fu_engine_check_requirement (FuEngine *self,
 			     FuEngineRequest *request,
-			     XbNode *req,
+			     FuEngineRequirement *req,
 			     FuDevice *device,
 			     GError **error)
 {
-	/* ensure component requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "id") == 0)
+	switch (req->kind) {
+	case FU_ENGINE_REQUIREMENT_KIND_ID:
 		return fu_engine_check_requirement_id (self, req, error);
-
-	/* ensure firmware requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "firmware") == 0) {
+	case FU_ENGINE_REQUIREMENT_KIND_FIRMWARE:
 		if (device == NULL)
 			return TRUE;
 		return fu_engine_check_requirement_firmware (self, req, device, error);
-	}
-
-	/* ensure hardware requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "hardware") == 0)
+	case FU_ENGINE_REQUIREMENT_KIND_HARDWARE:
 		return fu_engine_check_requirement_hardware (self, req, error);
-
-	/* ensure client requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "client") == 0)
+	case FU_ENGINE_REQUIREMENT_KIND_CLIENT:
 		return fu_engine_check_requirement_client (self, request, req, error);
+	default:
+		break;
+	}
 
 	/* not supported */
 	g_set_error (error,
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_NOT_SUPPORTED,
 		     "cannot handle requirement type %s",
-		     xb_node_get_element (req));
+		     req->element);
 	return FALSE;
 }
 
@@ -1442,7 +2488,6 @@ fu_engine_check_requirements (FuEngine *self,
 			      GError **error)
 {
 	FuDevice *device = fu_install_task_get_device (task);
-	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) reqs = NULL;
 
 	/* all install task checks require a device */
@@ -1452,18 +2497,11 @@ fu_engine_check_requirements (FuEngine *self,
 	}
 
 	/* do engine checks */
-	reqs = xb_node_query (fu_install_task_get_component (task),
-			      "requires/*", 0, &error_local);
-	if (reqs == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return TRUE;
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return TRUE;
-		g_propagate_error (error, g_steal_pointer (&error_local));
+	reqs = fu_engine_get_requirements (self, fu_install_task_get_component (task), error);
+	if (reqs == NULL)
 		return FALSE;
-	}
 	for (guint i = 0; i < reqs->len; i++) {
-		XbNode *req = g_ptr_array_index (reqs, i);
+		FuEngineRequirement *req = g_ptr_array_index (reqs, i);
 		if (!fu_engine_check_requirement (self, request, req, device, error))
 			return FALSE;
 	}
@@ -1611,8 +2649,9 @@ fu_engine_get_report_metadata_kernel_cmdline (GHashTable *hash, GError **error)
 	return TRUE;
 }
 
-GHashTable *
-fu_engine_get_report_metadata (FuEngine *self, GError **error)
+/* none of these values can change without a reboot */
+static GHashTable *
+fu_engine_get_report_metadata_boot (FuEngine *self, GError **error)
 {
 	const gchar *tmp;
 	gchar *btime;
@@ -1620,25 +2659,8 @@ fu_engine_get_report_metadata (FuEngine *self, GError **error)
 	struct utsname name_tmp;
 #endif
 	g_autoptr(GHashTable) hash = NULL;
-	g_autoptr(GList) compile_keys = g_hash_table_get_keys (self->compile_versions);
-	g_autoptr(GList) runtime_keys = g_hash_table_get_keys (self->runtime_versions);
 
-	/* convert all the runtime and compile-time versions */
 	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-	for (GList *l = compile_keys; l != NULL; l = l->next) {
-		const gchar *id = l->data;
-		const gchar *version = g_hash_table_lookup (self->compile_versions, id);
-		g_hash_table_insert (hash,
-				     g_strdup_printf ("CompileVersion(%s)", id),
-				     g_strdup (version));
-	}
-	for (GList *l = runtime_keys; l != NULL; l = l->next) {
-		const gchar *id = l->data;
-		const gchar *version = g_hash_table_lookup (self->runtime_versions, id);
-		g_hash_table_insert (hash,
-				     g_strdup_printf ("RuntimeVersion(%s)", id),
-				     g_strdup (version));
-	}
 	if (!fu_engine_get_report_metadata_os_release (hash, error))
 		return NULL;
 	if (!fu_engine_get_report_metadata_kernel_cmdline (hash, error))
@@ -1679,6 +2701,49 @@ fu_engine_get_report_metadata (FuEngine *self, GError **error)
 	return g_steal_pointer (&hash);
 }
 
+GHashTable *
+fu_engine_get_report_metadata (FuEngine *self, GError **error)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	g_autoptr(GHashTable) hash = NULL;
+	g_autoptr(GList) compile_keys = g_hash_table_get_keys (self->compile_versions);
+	g_autoptr(GList) runtime_keys = g_hash_table_get_keys (self->runtime_versions);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	/* convert all the runtime and compile-time versions */
+	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	for (GList *l = compile_keys; l != NULL; l = l->next) {
+		const gchar *id = l->data;
+		const gchar *version = g_hash_table_lookup (self->compile_versions, id);
+		g_hash_table_insert (hash,
+				     g_strdup_printf ("CompileVersion(%s)", id),
+				     g_strdup (version));
+	}
+	for (GList *l = runtime_keys; l != NULL; l = l->next) {
+		const gchar *id = l->data;
+		const gchar *version = g_hash_table_lookup (self->runtime_versions, id);
+		g_hash_table_insert (hash,
+				     g_strdup_printf ("RuntimeVersion(%s)", id),
+				     g_strdup (version));
+	}
+
+	/* only read the files in /etc and /proc once */
+	locker = g_mutex_locker_new (&self->report_metadata_mutex);
+	if (self->report_metadata_boot == NULL) {
+		self->report_metadata_boot = fu_engine_get_report_metadata_boot (self, error);
+		if (self->report_metadata_boot == NULL)
+			return NULL;
+	}
+	g_hash_table_iter_init (&iter, self->report_metadata_boot);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		g_hash_table_insert (hash,
+				     g_strdup ((const gchar *) key),
+				     g_strdup ((const gchar *) value));
+	}
+	return g_steal_pointer (&hash);
+}
+
 /**
  * fu_engine_composite_prepare:
  * @self: A #FuEngine
@@ -1725,37 +2790,494 @@ fu_engine_composite_cleanup (FuEngine *self, GPtrArray *devices, GError **error)
 	return TRUE;
 }
 
-/**
- * fu_engine_install_tasks:
- * @self: A #FuEngine
- * @request: A #FuEngineRequest
- * @install_tasks: (element-type FuInstallTask): A #FuDevice
- * @blob_cab: The #GBytes of the .cab file
- * @flags: The #FwupdInstallFlags, e.g. %FWUPD_DEVICE_FLAG_UPDATABLE
- * @error: A #GError, or %NULL
- *
- * Installs a specific firmware file on one or more install tasks.
- *
- * By this point all the requirements and tests should have been done in
- * fu_engine_check_requirements() so this should not fail before running
- * the plugin loader.
- *
- * Returns: %TRUE for success
- **/
-gboolean
-fu_engine_install_tasks (FuEngine *self,
-			 FuEngineRequest *request,
-			 GPtrArray *install_tasks,
-			 GBytes *blob_cab,
-			 FwupdInstallFlags flags,
-			 GError **error)
+typedef struct {
+	FuEngine		*self;
+	GPtrArray		*install_tasks;	/* of FuInstallTask with the same root */
+	GBytes			*blob_cab;
+	FwupdInstallFlags	 flags;
+	GError			*error;
+	gint			*pending;	/* groups not yet finished */
+} FuEngineInstallGroup;
+
+static void
+fu_engine_install_group_free (FuEngineInstallGroup *group)
 {
-	g_autoptr(FuIdleLocker) locker = NULL;
-	g_autoptr(GPtrArray) devices = NULL;
-	g_autoptr(GPtrArray) devices_new = NULL;
+	g_ptr_array_unref (group->install_tasks);
+	if (group->error != NULL)
+		g_error_free (group->error);
+	g_free (group);
+}
 
-	/* do not allow auto-shutdown during this time */
-	locker = fu_idle_locker_new (self->idle, "performing update");
+/* the device can be updated at the same time as devices with a different root */
+static gboolean
+fu_engine_device_is_thread_safe (FuEngine *self, FuDevice *device)
+{
+	FuPlugin *plugin;
+
+	/* waiting for replug needs the main loop */
+	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG))
+		return FALSE;
+	plugin = fu_plugin_list_find_by_name (self->plugin_list,
+					      fu_device_get_plugin (device),
+					      NULL);
+	if (plugin == NULL)
+		return FALSE;
+	return fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_INSTALL_THREAD_SAFE) != NULL;
+}
+
+static gboolean
+fu_engine_install_task_is_thread_safe (FuEngine *self,
+				       FuInstallTask *task,
+				       FwupdInstallFlags flags)
+{
+	/* scheduling offline updates is quick anyway */
+	if (flags & FWUPD_INSTALL_FLAG_OFFLINE)
+		return FALSE;
+	return fu_engine_device_is_thread_safe (self, fu_install_task_get_device (task));
+}
+
+static void
+fu_engine_install_group_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineInstallGroup *group = (FuEngineInstallGroup *) data;
+	for (guint i = 0; i < group->install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (group->install_tasks, i);
+		if (!fu_engine_install (group->self, task, group->blob_cab,
+					group->flags, &group->error))
+			break;
+	}
+
+	/* wake up the main thread if it is waiting in the main loop */
+	if (g_atomic_int_dec_and_test (group->pending))
+		g_main_context_wakeup (NULL);
+}
+
+typedef enum {
+	FU_ENGINE_HOTPLUG_EVENT_KIND_UDEV,
+	FU_ENGINE_HOTPLUG_EVENT_KIND_USB_ADDED,
+	FU_ENGINE_HOTPLUG_EVENT_KIND_USB_REMOVED,
+} FuEngineHotplugEventKind;
+
+typedef struct {
+	FuEngineHotplugEventKind kind;
+	GObject			*object;	/* GUdevDevice or GUsbDevice */
+	gchar			*action;	/* (nullable) */
+} FuEngineHotplugEvent;
+
+static void
+fu_engine_hotplug_event_free (FuEngineHotplugEvent *event)
+{
+	g_object_unref (event->object);
+	g_free (event->action);
+	g_free (event);
+}
+
+/* returns TRUE if the event was queued until the threaded install is done */
+static gboolean
+fu_engine_install_defer_hotplug (FuEngine *self,
+				 FuEngineHotplugEventKind kind,
+				 gpointer object,
+				 const gchar *action)
+{
+	FuEngineHotplugEvent *event;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->install_mutex);
+
+	if (self->install_devices == NULL)
+		return FALSE;
+	event = g_new0 (FuEngineHotplugEvent, 1);
+	event->kind = kind;
+	event->object = g_object_ref (object);
+	event->action = g_strdup (action);
+	g_ptr_array_add (self->install_hotplug_events, event);
+	return TRUE;
+}
+
+static void fu_engine_install_hotplug_replay (FuEngine *self);
+
+/* emit everything that was deferred while the worker threads were running */
+static void
+fu_engine_install_flush_deferred (FuEngine *self)
+{
+	gboolean emit_changed;
+	g_autoptr(GPtrArray) devices_changed = NULL;
+
+	g_mutex_lock (&self->install_mutex);
+	self->install_devices = NULL;
+	devices_changed = g_steal_pointer (&self->install_devices_changed);
+	self->install_devices_changed = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	emit_changed = self->install_emit_changed;
+	self->install_emit_changed = FALSE;
+	g_mutex_unlock (&self->install_mutex);
+
+	for (guint i = 0; i < devices_changed->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices_changed, i);
+		fu_engine_emit_device_changed (self, device);
+	}
+	if (emit_changed)
+		fu_engine_emit_changed (self);
+	fu_engine_install_hotplug_replay (self);
+}
+
+static gboolean
+fu_engine_install_groups_parallel (FuEngine *self, GPtrArray *groups, GError **error)
+{
+	GThreadPool *pool;
+	gint pending = 0;
+	guint threads_max;
+	g_autoptr(GPtrArray) install_devices = NULL;
+
+	/* aggregate the progress of every device being installed */
+	install_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		for (guint j = 0; j < group->install_tasks->len; j++) {
+			FuInstallTask *task = g_ptr_array_index (group->install_tasks, j);
+			g_ptr_array_add (install_devices,
+					 g_object_ref (fu_install_task_get_device (task)));
+		}
+	}
+
+	/* one thread for each independent root device, unless limited */
+	threads_max = groups->len;
+	if (self->install_threads_max > 0)
+		threads_max = MIN (threads_max, self->install_threads_max);
+	pool = g_thread_pool_new (fu_engine_install_group_thread_cb, NULL,
+				  (gint) threads_max, FALSE, error);
+	if (pool == NULL)
+		return FALSE;
+	g_mutex_lock (&self->install_mutex);
+	self->install_devices = install_devices;
+	g_mutex_unlock (&self->install_mutex);
+	g_atomic_int_set (&pending, 0);
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		g_debug ("scheduling threaded install of %u tasks",
+			 group->install_tasks->len);
+		group->pending = &pending;
+		g_atomic_int_inc (&pending);
+		if (!g_thread_pool_push (pool, group, &group->error)) {
+			g_atomic_int_dec_and_test (&pending);
+			break;
+		}
+	}
+
+	/* keep answering read-only requests while the threads run; anything
+	 * that would look at the devices being installed is deferred */
+	if (g_thread_self () == self->main_thread &&
+	    g_main_context_acquire (NULL)) {
+		while (g_atomic_int_get (&pending) > 0)
+			g_main_context_iteration (NULL, TRUE);
+		g_main_context_release (NULL);
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	fu_engine_install_flush_deferred (self);
+
+	/* report the first failure */
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineInstallGroup *group = g_ptr_array_index (groups, i);
+		if (group->error != NULL) {
+			g_propagate_error (error, g_steal_pointer (&group->error));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* tasks that may conflict are run in order on the main thread, and then tasks
+ * on independent root devices or install groups are run at the same time */
+static gboolean
+fu_engine_install_tasks_scheduled (FuEngine *self,
+				   GPtrArray *install_tasks,
+				   GBytes *blob_cab,
+				   FwupdInstallFlags flags,
+				   GError **error)
+{
+	g_autoptr(GHashTable) groups_by_key = NULL;
+	g_autoptr(GPtrArray) groups = NULL;
+
+	groups = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_install_group_free);
+	groups_by_key = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (guint i = 0; i < install_tasks->len; i++) {
+		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
+		FuDevice *device = fu_install_task_get_device (task);
+		FuEngineInstallGroup *group;
+		g_autofree gchar *key = NULL;
+		g_autoptr(FuDevice) root = NULL;
+
+		if (!fu_engine_install_task_is_thread_safe (self, task, flags)) {
+			if (!fu_engine_install (self, task, blob_cab, flags, error))
+				return FALSE;
+			continue;
+		}
+
+		/* devices on the same bus are updated in order */
+		root = fu_device_get_root (device);
+		if (fu_device_get_install_group (device) != NULL) {
+			key = g_strdup_printf ("%s:%s",
+					       fu_device_get_plugin (device),
+					       fu_device_get_install_group (device));
+		} else {
+			key = g_strdup (fu_device_get_id (root));
+		}
+		group = g_hash_table_lookup (groups_by_key, key);
+		if (group == NULL) {
+			group = g_new0 (FuEngineInstallGroup, 1);
+			group->self = self;
+			group->install_tasks = g_ptr_array_new ();
+			group->blob_cab = blob_cab;
+			group->flags = flags;
+			g_hash_table_insert (groups_by_key, g_steal_pointer (&key), group);
+			g_ptr_array_add (groups, group);
+		}
+		g_ptr_array_add (group->install_tasks, task);
+	}
+
+	/* nothing to parallelize */
+	if (groups->len == 0)
+		return TRUE;
+	if (self->install_threads_max == 1) {
+		for (guint j = 0; j < groups->len; j++) {
+			FuEngineInstallGroup *group = g_ptr_array_index (groups, j);
+			for (guint i = 0; i < group->install_tasks->len; i++) {
+				FuInstallTask *task = g_ptr_array_index (group->install_tasks, i);
+				if (!fu_engine_install (self, task, blob_cab, flags, error))
+					return FALSE;
+			}
+		}
+		return TRUE;
+	}
+	return fu_engine_install_groups_parallel (self, groups, error);
+}
+
+typedef struct {
+	FuEngine		*self;
+	GPtrArray		*devices;	/* of FuDevice with the same root */
+	GPtrArray		*errors;	/* of GError, or NULL for success */
+	gint			*pending;	/* groups not yet finished */
+} FuEngineVerifyGroup;
+
+/* the readback of each device may or may not have failed */
+static void
+fu_engine_verify_error_free (GError *error)
+{
+	if (error != NULL)
+		g_error_free (error);
+}
+
+static void
+fu_engine_verify_group_free (FuEngineVerifyGroup *group)
+{
+	g_ptr_array_unref (group->devices);
+	g_ptr_array_unref (group->errors);
+	g_free (group);
+}
+
+static void
+fu_engine_verify_group_readback (FuEngineVerifyGroup *group)
+{
+	for (guint i = 0; i < group->devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (group->devices, i);
+		GError *error_local = NULL;
+		fu_engine_verify_readback (group->self, device, &error_local);
+		g_ptr_array_add (group->errors, error_local);
+	}
+}
+
+static void
+fu_engine_verify_group_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineVerifyGroup *group = (FuEngineVerifyGroup *) data;
+	fu_engine_verify_group_readback (group);
+
+	/* wake up the main thread if it is waiting in the main loop */
+	if (g_atomic_int_dec_and_test (group->pending))
+		g_main_context_wakeup (NULL);
+}
+
+static gboolean
+fu_engine_verify_groups_parallel (FuEngine *self, GPtrArray *groups, GError **error)
+{
+	GThreadPool *pool;
+	gint pending = 0;
+	guint threads_max;
+	g_autoptr(GPtrArray) verify_devices = NULL;
+
+	/* the progress is aggregated just like an install */
+	verify_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineVerifyGroup *group = g_ptr_array_index (groups, i);
+		for (guint j = 0; j < group->devices->len; j++)
+			g_ptr_array_add (verify_devices, g_object_ref (g_ptr_array_index (group->devices, j)));
+	}
+	threads_max = groups->len;
+	if (self->install_threads_max > 0)
+		threads_max = MIN (threads_max, self->install_threads_max);
+	pool = g_thread_pool_new (fu_engine_verify_group_thread_cb, NULL,
+				  (gint) threads_max, FALSE, error);
+	if (pool == NULL)
+		return FALSE;
+	g_mutex_lock (&self->install_mutex);
+	self->install_devices = verify_devices;
+	g_mutex_unlock (&self->install_mutex);
+	g_atomic_int_set (&pending, 0);
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineVerifyGroup *group = g_ptr_array_index (groups, i);
+		g_autoptr(GError) error_local = NULL;
+		group->pending = &pending;
+		g_atomic_int_inc (&pending);
+		if (!g_thread_pool_push (pool, group, &error_local)) {
+			g_warning ("failed to schedule verify: %s", error_local->message);
+			g_atomic_int_dec_and_test (&pending);
+			fu_engine_verify_group_readback (group);
+		}
+	}
+	if (g_thread_self () == self->main_thread &&
+	    g_main_context_acquire (NULL)) {
+		while (g_atomic_int_get (&pending) > 0)
+			g_main_context_iteration (NULL, TRUE);
+		g_main_context_release (NULL);
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	fu_engine_install_flush_deferred (self);
+	return TRUE;
+}
+
+/**
+ * fu_engine_verify_all:
+ * @self: A #FuEngine
+ * @error: A #GError, or %NULL
+ *
+ * Verifies every device that supports it. The firmware of devices on
+ * independent root devices is read back at the same time if the plugin
+ * allows it, and the checksums are then compared with the metadata.
+ *
+ * Returns: %TRUE if all the devices were verified successfully
+ **/
+gboolean
+fu_engine_verify_all (FuEngine *self, GError **error)
+{
+	guint failures = 0;
+	g_autoptr(GHashTable) groups_by_root = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) groups = NULL;
+	g_autoptr(GPtrArray) groups_parallel = g_ptr_array_new ();
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* devices on the same bus are read back in order */
+	groups = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_verify_group_free);
+	groups_by_root = g_hash_table_new (g_str_hash, g_str_equal);
+	devices = fu_device_list_get_active (self->device_list);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		FuEngineVerifyGroup *group;
+		const gchar *key = "";
+		g_autoptr(FuDevice) root = NULL;
+
+		if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_CAN_VERIFY))
+			continue;
+		if (fu_engine_device_is_thread_safe (self, device) &&
+		    self->install_threads_max != 1) {
+			root = fu_device_get_root (device);
+			key = fu_device_get_id (root);
+		}
+		group = g_hash_table_lookup (groups_by_root, key);
+		if (group == NULL) {
+			group = g_new0 (FuEngineVerifyGroup, 1);
+			group->self = self;
+			group->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			group->errors = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_verify_error_free);
+			g_hash_table_insert (groups_by_root, (gpointer) key, group);
+			g_ptr_array_add (groups, group);
+		}
+		g_ptr_array_add (group->devices, g_object_ref (device));
+	}
+	if (groups->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No devices can be verified");
+		return FALSE;
+	}
+
+	/* anything that is not thread safe is read back on the main thread */
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineVerifyGroup *group = g_ptr_array_index (groups, i);
+		if (g_hash_table_lookup (groups_by_root, "") == group)
+			fu_engine_verify_group_readback (group);
+		else
+			g_ptr_array_add (groups_parallel, group);
+	}
+	if (groups_parallel->len > 0 &&
+	    !fu_engine_verify_groups_parallel (self, groups_parallel, error))
+		return FALSE;
+
+	/* compare all the checksums, collecting every failure */
+	for (guint i = 0; i < groups->len; i++) {
+		FuEngineVerifyGroup *group = g_ptr_array_index (groups, i);
+		for (guint j = 0; j < group->devices->len; j++) {
+			FuDevice *device = g_ptr_array_index (group->devices, j);
+			GError *error_readback = g_ptr_array_index (group->errors, j);
+			g_autoptr(GError) error_local = NULL;
+			if (error_readback != NULL) {
+				error_local = g_error_copy (error_readback);
+			} else if (fu_engine_verify_checksums (self, device, &error_local)) {
+				continue;
+			}
+			if (str->len > 0)
+				g_string_append (str, ", ");
+			g_string_append_printf (str, "%s: %s",
+						fu_device_get_name (device),
+						error_local->message);
+			failures++;
+		}
+	}
+	if (failures > 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "failed to verify %u devices: %s",
+			     failures, str->str);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_engine_install_tasks:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ * @install_tasks: (element-type FuInstallTask): A #FuDevice
+ * @blob_cab: (nullable): The #GBytes of the .cab file, or %NULL if set on each task
+ * @flags: The #FwupdInstallFlags, e.g. %FWUPD_DEVICE_FLAG_UPDATABLE
+ * @error: A #GError, or %NULL
+ *
+ * Installs a specific firmware file on one or more install tasks.
+ *
+ * By this point all the requirements and tests should have been done in
+ * fu_engine_check_requirements() so this should not fail before running
+ * the plugin loader.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_install_tasks (FuEngine *self,
+			 FuEngineRequest *request,
+			 GPtrArray *install_tasks,
+			 GBytes *blob_cab,
+			 FwupdInstallFlags flags,
+			 GError **error)
+{
+	gboolean ret;
+	g_autoptr(FuIdleLocker) locker = NULL;
+	g_autoptr(GError) error_builder = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_new = NULL;
+
+	/* do not allow auto-shutdown during this time */
+	locker = fu_idle_locker_new (self->idle, "performing update");
 	g_assert (locker != NULL);
 
 	/* notify the plugins about the composite action */
@@ -1772,16 +3294,18 @@ fu_engine_install_tasks (FuEngine *self,
 	}
 
 	/* all authenticated, so install all the things */
-	for (guint i = 0; i < install_tasks->len; i++) {
-		FuInstallTask *task = g_ptr_array_index (install_tasks, i);
-		if (!fu_engine_install (self, task, blob_cab, flags, error)) {
-			g_autoptr(GError) error_local = NULL;
-			if (!fu_engine_composite_cleanup (self, devices, &error_local)) {
-				g_warning ("failed to cleanup failed composite action: %s",
-					   error_local->message);
-			}
-			return FALSE;
+	ret = fu_engine_install_tasks_scheduled (self, install_tasks, blob_cab, flags, error);
+
+	/* the warm sandboxes are only kept for the transaction */
+	if (!fu_firmware_builder_cleanup (self->firmware_builder, &error_builder))
+		g_warning ("failed to cleanup firmware builder: %s", error_builder->message);
+	if (!ret) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_composite_cleanup (self, devices, &error_local)) {
+			g_warning ("failed to cleanup failed composite action: %s",
+				   error_local->message);
 		}
+		return FALSE;
 	}
 
 	/* set all the device statuses back to unknown */
@@ -2030,6 +3554,30 @@ fu_engine_schedule_update (FuEngine *self,
 	return fu_engine_offline_setup (error);
 }
 
+/* allows the quirk RemoveDelay to be tuned from the uploaded reports */
+static gboolean
+fu_engine_history_add_replug_time (FuEngine *self,
+				   FuDevice *device,
+				   FwupdRelease *release,
+				   GError **error)
+{
+	guint replug_time = fu_device_get_metadata_integer (device, "ReplugTime");
+	g_autofree gchar *remove_delay = NULL;
+	g_autofree gchar *replug_time_str = NULL;
+
+	if (replug_time == G_MAXUINT)
+		return TRUE;
+	replug_time_str = g_strdup_printf ("%u", replug_time);
+	remove_delay = g_strdup_printf ("%u", fu_device_get_remove_delay (device));
+	fwupd_release_add_metadata_item (release, "ReplugTime", replug_time_str);
+	fwupd_release_add_metadata_item (release, "RemoveDelay", remove_delay);
+	fu_device_remove_metadata (device, "ReplugTime");
+	return fu_history_set_device_metadata (self->history,
+					       fu_device_get_id (device),
+					       fwupd_release_get_metadata (release),
+					       error);
+}
+
 static gboolean
 fu_engine_install_release (FuEngine *self,
 			   FuDevice *device_orig,
@@ -2046,6 +3594,7 @@ fu_engine_install_release (FuEngine *self,
 	g_autofree gchar *version_rel = NULL;
 	g_autoptr(FuDevice) device_tmp = NULL;
 	g_autoptr(FuDevice) device = g_object_ref (device_orig);
+	g_autoptr(FwupdRelease) release_tmp = NULL;
 	g_autoptr(GBytes) blob_fw2 = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -2065,7 +3614,8 @@ fu_engine_install_release (FuEngine *self,
 		const gchar *tmp2 = g_object_get_data (G_OBJECT (component), "fwupd::BuilderOutput");
 		if (tmp2 == NULL)
 			tmp2 = "firmware.bin";
-		blob_fw2 = fu_common_firmware_builder (blob_fw, tmp, tmp2, error);
+		blob_fw2 = fu_firmware_builder_build (self->firmware_builder,
+						      blob_fw, tmp, tmp2, error);
 		if (blob_fw2 == NULL)
 			return FALSE;
 	} else {
@@ -2089,7 +3639,6 @@ fu_engine_install_release (FuEngine *self,
 
 	/* add device to database */
 	if ((flags & FWUPD_INSTALL_FLAG_NO_HISTORY) == 0) {
-		g_autoptr(FwupdRelease) release_tmp = NULL;
 		release_tmp = fu_engine_create_release_metadata (self, device, plugin, error);
 		if (release_tmp == NULL)
 			return FALSE;
@@ -2143,6 +3692,11 @@ fu_engine_install_release (FuEngine *self,
 	}
 	g_set_object (&device, device_tmp);
 
+	/* record how long the device really took to replug */
+	if (release_tmp != NULL &&
+	    !fu_engine_history_add_replug_time (self, device, release_tmp, error))
+		return FALSE;
+
 	/* update database */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NEEDS_REBOOT) ||
 	    fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NEEDS_SHUTDOWN)) {
@@ -2154,6 +3708,16 @@ fu_engine_install_release (FuEngine *self,
 		return TRUE;
 	}
 
+	/* the new version is not running until the device has been activated,
+	 * which may be done by the plugin when the composite update finishes */
+	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION)) {
+		if ((flags & FWUPD_INSTALL_FLAG_NO_HISTORY) == 0 &&
+		    !fu_history_modify_device (self->history, device, error))
+			return FALSE;
+		fu_engine_emit_changed (self);
+		return TRUE;
+	}
+
 	/* for online updates, verify the version changed if not a re-install */
 	fmt = fu_device_get_version_format (device);
 	if (version_rel != NULL &&
@@ -2192,57 +3756,67 @@ fu_engine_install_release (FuEngine *self,
 }
 
 typedef struct {
-	gboolean	 ret;
-	GError		**error;
-	FuEngine	*self;
-	FuDevice	*device;
-} FuEngineSortHelper;
+	XbNode			*rel;
+	FuCommonVersion		*version;
+} FuEngineSortItem;
+
+static void
+fu_engine_sort_item_free (FuEngineSortItem *item)
+{
+	g_object_unref (item->rel);
+	fu_common_version_free (item->version);
+	g_free (item);
+}
 
 static gint
 fu_engine_sort_release_versions_cb (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	FuEngineSortHelper *helper = (FuEngineSortHelper *) user_data;
-	XbNode *na = *((XbNode **) a);
-	XbNode *nb = *((XbNode **) b);
-	g_autofree gchar *va = NULL;
-	g_autofree gchar *vb = NULL;
-
-	/* already failed */
-	if (!helper->ret)
-		return 0;
-
-	/* get the semver from the release */
-	va = fu_engine_get_release_version (helper->self, helper->device, na, helper->error);
-	if (va == NULL) {
-		g_prefix_error (helper->error, "failed to get release version: ");
-		return 0;
-	}
-	vb = fu_engine_get_release_version (helper->self, helper->device, nb, helper->error);
-	if (vb == NULL) {
-		g_prefix_error (helper->error, "failed to get release version: ");
-		return 0;
-	}
-	return fu_common_vercmp_full (va, vb, fu_device_get_version_format (helper->device));
+	FuDevice *device = FU_DEVICE (user_data);
+	FuEngineSortItem *ia = *((FuEngineSortItem **) a);
+	FuEngineSortItem *ib = *((FuEngineSortItem **) b);
+	return fu_common_version_compare (ia->version, ib->version,
+					  fu_device_get_version_format (device));
 }
 
+/* each release version is parsed once, rather than twice per comparison */
 static gboolean
 fu_engine_sort_releases (FuEngine *self, FuDevice *device, GPtrArray *rels, GError **error)
 {
-	FuEngineSortHelper helper = {
-		.ret = TRUE,
-		.self = self,
-		.device = device,
-		.error = error,
-	};
-	g_ptr_array_sort_with_data (rels, fu_engine_sort_release_versions_cb, &helper);
-	return helper.ret;
+	g_autoptr(GPtrArray) items = NULL;
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_sort_item_free);
+	for (guint i = 0; i < rels->len; i++) {
+		XbNode *rel = g_ptr_array_index (rels, i);
+		FuEngineSortItem *item;
+		g_autofree gchar *version = NULL;
+
+		/* get the semver from the release */
+		version = fu_engine_get_release_version (self, device, rel, error);
+		if (version == NULL) {
+			g_prefix_error (error, "failed to get release version: ");
+			return FALSE;
+		}
+		item = g_new0 (FuEngineSortItem, 1);
+		item->rel = g_object_ref (rel);
+		item->version = fu_common_version_new (version);
+		g_ptr_array_add (items, item);
+	}
+	g_ptr_array_sort_with_data (items, fu_engine_sort_release_versions_cb, device);
+
+	/* put the releases back in the new order */
+	for (guint i = 0; i < items->len; i++) {
+		FuEngineSortItem *item = g_ptr_array_index (items, i);
+		g_object_unref (g_ptr_array_index (rels, i));
+		rels->pdata[i] = g_object_ref (item->rel);
+	}
+	return TRUE;
 }
 
 /**
  * fu_engine_install:
  * @self: A #FuEngine
  * @task: A #FuInstallTask
- * @blob_cab: The #GBytes of the .cab file
+ * @blob_cab: (nullable): The #GBytes of the .cab file, or %NULL if set on the task
  * @flags: The #FwupdInstallFlags, e.g. %FWUPD_DEVICE_FLAG_UPDATABLE
  * @error: A #GError, or %NULL
  *
@@ -2263,6 +3837,8 @@ fu_engine_install (FuEngine *self,
 {
 	XbNode *component = fu_install_task_get_component (task);
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(FuEngineDeviceLocker) locker = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(XbNode) rel_newest = NULL;
 #if LIBXMLB_CHECK_VERSION(0,2,0)
@@ -2271,11 +3847,17 @@ fu_engine_install (FuEngine *self,
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (XB_IS_NODE (component), FALSE);
-	g_return_val_if_fail (blob_cab != NULL, FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	/* the task may come from a different archive to the others */
+	if (fu_install_task_get_blob_cab (task) != NULL)
+		blob_cab = fu_install_task_get_blob_cab (task);
+	g_return_val_if_fail (blob_cab != NULL, FALSE);
+
 	/* not in bootloader mode */
 	device = g_object_ref (fu_install_task_get_device (task));
+	span = fu_trace_span_new ("engine", "install:%s", fu_device_get_id (device));
+	locker = fu_engine_device_locker_new (self, device);
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NEEDS_BOOTLOADER)) {
 		const gchar *caption = NULL;
 		caption = xb_node_query_text (component,
@@ -2487,8 +4069,10 @@ fu_engine_update_prepare (FuEngine *self,
 	device = fu_engine_get_device_by_id (self, device_id, error);
 	if (device == NULL)
 		return FALSE;
-	str = fu_device_to_string (device);
-	g_debug ("performing prepare on %s", str);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing prepare on %s", str);
+	}
 	if (!fu_engine_device_prepare (self, device, flags, error))
 		return FALSE;
 	for (guint j = 0; j < plugins->len; j++) {
@@ -2521,8 +4105,10 @@ fu_engine_update_cleanup (FuEngine *self,
 	device = fu_engine_get_device_by_id (self, device_id, error);
 	if (device == NULL)
 		return FALSE;
-	str = fu_device_to_string (device);
-	g_debug ("performing cleanup on %s", str);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing cleanup on %s", str);
+	}
 	if (!fu_engine_device_cleanup (self, device, flags, error))
 		return FALSE;
 	for (guint j = 0; j < plugins->len; j++) {
@@ -2552,8 +4138,10 @@ fu_engine_update_detach (FuEngine *self, const gchar *device_id, GError **error)
 	device = fu_engine_get_device_by_id (self, device_id, error);
 	if (device == NULL)
 		return FALSE;
-	str = fu_device_to_string (device);
-	g_debug ("performing detach on %s", str);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing detach on %s", str);
+	}
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
 					      fu_device_get_plugin (device),
 					      error);
@@ -2577,8 +4165,10 @@ fu_engine_update_attach (FuEngine *self, const gchar *device_id, GError **error)
 		g_prefix_error (error, "failed to get device after update: ");
 		return FALSE;
 	}
-	str = fu_device_to_string (device);
-	g_debug ("performing attach on %s", str);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing attach on %s", str);
+	}
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
 					      fu_device_get_plugin (device),
 					      error);
@@ -2596,6 +4186,7 @@ fu_engine_activate (FuEngine *self, const gchar *device_id, GError **error)
 	FuPlugin *plugin;
 	g_autofree gchar *str = NULL;
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(FuEngineDeviceLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -2605,8 +4196,11 @@ fu_engine_activate (FuEngine *self, const gchar *device_id, GError **error)
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
 		return FALSE;
-	str = fu_device_to_string (device);
-	g_debug ("performing activate on %s", str);
+	locker = fu_engine_device_locker_new (self, device);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing activate on %s", str);
+	}
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
 					      fu_device_get_plugin (device),
 					      error);
@@ -2636,8 +4230,10 @@ fu_engine_update_reload (FuEngine *self, const gchar *device_id, GError **error)
 		g_prefix_error (error, "failed to get device after update: ");
 		return FALSE;
 	}
-	str = fu_device_to_string (device);
-	g_debug ("performing reload on %s", str);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing reload on %s", str);
+	}
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
 					      fu_device_get_plugin (device),
 					      error);
@@ -2679,8 +4275,10 @@ fu_engine_update (FuEngine *self,
 		return FALSE;
 	}
 	device_pending = fu_history_get_device_by_id (self->history, device_id, NULL);
-	str = fu_device_to_string (device);
-	g_debug ("performing update on %s", str);
+	if (fu_common_debug_enabled (G_LOG_DOMAIN)) {
+		str = fu_device_to_string (device);
+		g_debug ("performing update on %s", str);
+	}
 	plugin = fu_plugin_list_find_by_name (self->plugin_list,
 					      fu_device_get_plugin (device),
 					      error);
@@ -2765,16 +4363,20 @@ fu_engine_firmware_read (FuEngine *self,
 	return fu_firmware_write (firmware, error);
 }
 
-gboolean
-fu_engine_install_blob (FuEngine *self,
-			FuDevice *device,
-			GBytes *blob_fw,
-			FwupdInstallFlags flags,
-			GError **error)
+static gboolean
+fu_engine_install_blob_phases (FuEngine *self,
+			       FuDevice *device,
+			       GBytes *blob_fw,
+			       FwupdInstallFlags flags,
+			       GError **error)
 {
 	guint retries = 0;
+	FuHistoryDurations durations = { 0 };
 	g_autofree gchar *device_id = NULL;
+	g_autofree gchar *labels = NULL;
+	g_autoptr(GError) error_cache = NULL;
 	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(GTimer) timer_phase = g_timer_new ();
 
 	/* test the firmware is not an empty blob */
 	if (g_bytes_get_size (blob_fw) == 0) {
@@ -2808,23 +4410,44 @@ fu_engine_install_blob (FuEngine *self,
 		if (!fu_engine_update_prepare (self, flags, device_id, error))
 			return FALSE;
 
+		/* parse the firmware now rather than when in bootloader mode; this
+		 * is not fatal as the bootloader device may parse differently */
+		if (!fu_device_cache_firmware (device, blob_fw, flags, &error_cache)) {
+			g_debug ("failed to prepare firmware before detach: %s",
+				 error_cache->message);
+			g_clear_error (&error_cache);
+		}
+
 		/* detach to bootloader mode */
+		g_timer_start (timer_phase);
+		fu_engine_install_phases_set (self, device_id, FU_ENGINE_INSTALL_PHASE_DETACH);
 		if (!fu_engine_update_detach (self, device_id, error))
 			return FALSE;
+		durations.detach += g_timer_elapsed (timer_phase, NULL) * 1000;
 
 		/* install */
+		g_timer_start (timer_phase);
+		fu_engine_install_phases_set (self, device_id, FU_ENGINE_INSTALL_PHASE_WRITE);
 		if (!fu_engine_update (self, device_id, blob_fw, flags, error))
 			return FALSE;
+		durations.write += g_timer_elapsed (timer_phase, NULL) * 1000;
+		durations.bytes += g_bytes_get_size (blob_fw);
 
 		/* attach into runtime mode */
+		g_timer_start (timer_phase);
+		fu_engine_install_phases_set (self, device_id, FU_ENGINE_INSTALL_PHASE_ATTACH);
 		if (!fu_engine_update_attach (self, device_id, error))
 			return FALSE;
+		durations.attach += g_timer_elapsed (timer_phase, NULL) * 1000;
 
 	} while (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_ANOTHER_WRITE_REQUIRED));
 
 	/* get the new version number */
+	g_timer_start (timer_phase);
+	fu_engine_install_phases_set (self, device_id, FU_ENGINE_INSTALL_PHASE_VERIFY);
 	if (!fu_engine_update_reload (self, device_id, error))
 		return FALSE;
+	durations.verify += g_timer_elapsed (timer_phase, NULL) * 1000;
 
 	/* signal to all the plugins the update has happened */
 	if (!fu_engine_update_cleanup (self, flags, device_id, error))
@@ -2834,9 +4457,47 @@ fu_engine_install_blob (FuEngine *self,
 	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
 	g_debug ("Updating %s took %f seconds", fu_device_get_name (device),
 		 g_timer_elapsed (timer, NULL));
+	labels = g_strdup_printf ("plugin=\"%s\"",
+				  fu_device_get_plugin (device) != NULL ?
+				  fu_device_get_plugin (device) : "unknown");
+	fu_metrics_histogram_observe ("fwupd_install_duration_seconds", labels,
+				      g_timer_elapsed (timer, NULL));
+	fu_metrics_counter_add ("fwupd_install_bytes", labels,
+				g_bytes_get_size (blob_fw));
+
+	/* used to schedule and estimate future installs */
+	if ((flags & FWUPD_INSTALL_FLAG_NO_HISTORY) == 0 &&
+	    fu_device_get_plugin (device) != NULL &&
+	    fu_device_get_guid_default (device) != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_history_add_durations (self->history,
+					       fu_device_get_plugin (device),
+					       fu_device_get_guid_default (device),
+					       &durations,
+					       &error_local)) {
+			g_warning ("failed to record install durations: %s",
+				   error_local->message);
+		}
+	}
 	return TRUE;
 }
 
+gboolean
+fu_engine_install_blob (FuEngine *self,
+			FuDevice *device,
+			GBytes *blob_fw,
+			FwupdInstallFlags flags,
+			GError **error)
+{
+	gboolean ret;
+	g_autofree gchar *device_id = g_strdup (fu_device_get_id (device));
+
+	fu_engine_install_phases_start (self, device);
+	ret = fu_engine_install_blob_phases (self, device, blob_fw, flags, error);
+	fu_engine_install_phases_stop (self, device_id);
+	return ret;
+}
+
 static FuDevice *
 fu_engine_get_item_by_id_fallback_history (FuEngine *self, const gchar *id, GError **error)
 {
@@ -2896,9 +4557,13 @@ fu_engine_get_item_by_id_fallback_history (FuEngine *self, const gchar *id, GErr
 void
 fu_engine_set_silo (FuEngine *self, XbSilo *silo)
 {
+	FuEngineShard *shard = fu_engine_shard_new ();
 	g_return_if_fail (FU_IS_ENGINE (self));
 	g_return_if_fail (XB_IS_SILO (silo));
-	g_set_object (&self->silo, silo);
+	shard->silo = g_object_ref (silo);
+	fu_engine_shard_ensure_index (shard);
+	g_ptr_array_set_size (self->shards, 0);
+	g_ptr_array_add (self->shards, shard);
 }
 
 static gboolean
@@ -2912,16 +4577,107 @@ fu_engine_appstream_upgrade_cb (XbBuilderFixup *self,
 	return TRUE;
 }
 
+static gboolean
+fu_engine_component_index_cb (XbBuilderFixup *fixup,
+			      XbBuilderNode *bn,
+			      gpointer user_data,
+			      GError **error)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autofree gchar *idx = NULL;
+
+	if (g_strcmp0 (xb_builder_node_get_element (bn), "component") != 0)
+		return TRUE;
+	idx = g_strdup_printf ("%u", self->component_index++);
+	xb_builder_node_set_attr (bn, "fwupd-index", idx);
+	return TRUE;
+}
+
+static void
+fu_engine_add_component_index_fixup (FuEngine *self, XbBuilderSource *source)
+{
+	g_autoptr(XbBuilderFixup) fixup = NULL;
+	fixup = xb_builder_fixup_new ("ComponentIndex",
+				      fu_engine_component_index_cb,
+				      self, NULL);
+	xb_builder_fixup_set_max_depth (fixup, 2);
+	xb_builder_source_add_fixup (source, fixup);
+}
+
+#ifdef HAVE_ZSTD
+/* libxmlb guesses the content type again for the returned stream, so the
+ * decompressed XML is parsed as it is read */
+static GInputStream *
+fu_engine_builder_source_zstd_cb (XbBuilderSource *source,
+				  XbBuilderSourceCtx *ctx,
+				  gpointer user_data,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	GInputStream *istream = xb_builder_source_ctx_get_stream (ctx);
+	g_autoptr(FuZstdDecompressor) conv = fu_zstd_decompressor_new ();
+	return g_converter_input_stream_new (istream, G_CONVERTER (conv));
+}
+#endif
+
+/* gzip is handled by libxmlb itself */
+static void
+fu_engine_add_metadata_adapters (XbBuilderSource *source)
+{
+#ifdef HAVE_ZSTD
+	xb_builder_source_add_adapter (source,
+				       "application/zstd",
+				       fu_engine_builder_source_zstd_cb,
+				       NULL, NULL);
+#endif
+}
+
+/* the exported XML is cached so that the cabinet archive does not have to be
+ * decompressed and parsed on every daemon startup when nothing has changed */
+static gchar *
+fu_engine_create_metadata_cache_filename (const gchar *fn)
+{
+	GStatBuf st = { 0x0 };
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *cachedirpkg = NULL;
+	g_autofree gchar *csum = NULL;
+	g_autofree gchar *key = NULL;
+
+	if (g_stat (fn, &st) != 0)
+		return NULL;
+	key = g_strdup_printf ("%s:%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT,
+			       fn, (guint64) st.st_size, (gint64) st.st_mtime);
+	csum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+	basename = g_strdup_printf ("%s.xml", csum);
+	cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	return g_build_filename (cachedirpkg, "cabinet", basename, NULL);
+}
+
 static XbBuilderSource *
 fu_engine_create_metadata_builder_source (FuEngine *self,
 					  const gchar *fn,
 					  GError **error)
 {
 	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file_cache = NULL;
 	g_autoptr(XbSilo) silo = NULL;
 	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autofree gchar *fn_cache = fu_engine_create_metadata_cache_filename (fn);
 	g_autofree gchar *xml = NULL;
 
+	/* use the cached XML, which is only parsed if the silo is rebuilt */
+	if (fn_cache != NULL)
+		file_cache = g_file_new_for_path (fn_cache);
+	if (file_cache != NULL && g_file_query_exists (file_cache, NULL)) {
+		g_debug ("using cached metadata %s for %s", fn_cache, fn);
+		if (!xb_builder_source_load_file (source, file_cache,
+						  XB_BUILDER_SOURCE_FLAG_NONE,
+						  NULL, error))
+			return NULL;
+		return g_steal_pointer (&source);
+	}
+
 	g_debug ("building metadata for %s", fn);
 	blob = fu_common_get_contents_bytes (fn, error);
 	if (blob == NULL)
@@ -2934,6 +4690,19 @@ fu_engine_create_metadata_builder_source (FuEngine *self,
 	xml = xb_silo_export (silo, XB_NODE_EXPORT_FLAG_NONE, error);
 	if (xml == NULL)
 		return NULL;
+
+	/* save for next time, but it's not fatal if the cache is read-only */
+	if (fn_cache != NULL &&
+	    fu_common_mkdir_parent (fn_cache, &error_local) &&
+	    g_file_set_contents (fn_cache, xml, -1, &error_local)) {
+		if (!xb_builder_source_load_file (source, file_cache,
+						  XB_BUILDER_SOURCE_FLAG_NONE,
+						  NULL, error))
+			return NULL;
+		return g_steal_pointer (&source);
+	}
+	if (error_local != NULL)
+		g_debug ("failed to cache metadata for %s: %s", fn, error_local->message);
 	if (!xb_builder_source_load_xml (source, xml,
 					 XB_BUILDER_SOURCE_FLAG_NONE,
 					 error))
@@ -2975,6 +4744,8 @@ fu_engine_create_metadata (FuEngine *self, XbBuilder *builder,
 			continue;
 		}
 
+		fu_engine_add_component_index_fixup (self, source);
+
 		/* add metadata */
 		custom = xb_builder_node_new ("custom");
 		xb_builder_node_insert_text (custom,
@@ -3183,19 +4954,307 @@ fu_engine_md_refresh_devices (FuEngine *self)
 	}
 }
 
-static gboolean
-fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+/* delta metadata is a <components delta-base="SHA256"> document stored next
+ * to the full metadata it applies to; components in the delta replace any
+ * with the same ID, and components with delta="remove" are dropped */
+static gchar *
+fu_engine_get_delta_filename (FwupdRemote *remote)
 {
-	GPtrArray *remotes;
-	XbBuilderCompileFlags compile_flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID;
-	g_autofree gchar *cachedirpkg = NULL;
-	g_autofree gchar *xmlbfn = NULL;
-	g_autoptr(GFile) xmlb = NULL;
+	return g_strdup_printf ("%s.delta", fwupd_remote_get_filename_cache (remote));
+}
+
+static gchar *
+fu_engine_get_delta_filename_sig (FwupdRemote *remote)
+{
+	return g_strdup_printf ("%s.delta.jcat", fwupd_remote_get_filename_cache (remote));
+}
+
+/* returns the delta-base attribute from the root element, or NULL if @blob
+ * is full metadata; only the start of the document is decompressed */
+static gchar *
+fu_engine_get_delta_base_from_blob (GBytes *blob)
+{
+	const guint8 *data;
+	const gchar *attr;
+	const gchar *end;
+	const gchar *tmp;
+	const gchar *value_end;
+	gsize bufsz = 0;
+	gsize sz = 0;
+	gchar buf[4096] = { '\0' };
+	g_autoptr(GInputStream) istr = NULL;
+
+	data = g_bytes_get_data (blob, &bufsz);
+	istr = g_memory_input_stream_new_from_bytes (blob);
+	if (bufsz >= 2 && data[0] == 0x1f && data[1] == 0x8b) {
+		g_autoptr(GConverter) conv = NULL;
+		g_autoptr(GInputStream) istr_gz = NULL;
+		conv = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+		istr_gz = g_converter_input_stream_new (istr, conv);
+		g_set_object (&istr, istr_gz);
+	}
+#ifdef HAVE_ZSTD
+	if (bufsz >= 4 && memcmp (data, "\x28\xb5\x2f\xfd", 4) == 0) {
+		g_autoptr(FuZstdDecompressor) conv = fu_zstd_decompressor_new ();
+		g_autoptr(GInputStream) istr_zst = NULL;
+		istr_zst = g_converter_input_stream_new (istr, G_CONVERTER (conv));
+		g_set_object (&istr, istr_zst);
+	}
+#endif
+	if (!g_input_stream_read_all (istr, buf, sizeof(buf) - 1, &sz, NULL, NULL))
+		return NULL;
+	buf[sz] = '\0';
+
+	/* only look inside the root element */
+	tmp = g_strstr_len (buf, sz, "<components");
+	if (tmp == NULL)
+		return NULL;
+	end = strchr (tmp, '>');
+	if (end == NULL)
+		return NULL;
+	attr = g_strstr_len (tmp, end - tmp, "delta-base=\"");
+	if (attr == NULL)
+		return NULL;
+	attr += strlen ("delta-base=\"");
+	value_end = strchr (attr, '"');
+	if (value_end == NULL || value_end > end)
+		return NULL;
+	return g_strndup (attr, value_end - attr);
+}
+
+/* returns a set of the component IDs the delta replaces or removes */
+static GHashTable *
+fu_engine_get_delta_component_ids (GFile *file, GError **error)
+{
+	GHashTable *ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbSilo) silo = NULL;
+
+	fu_engine_add_metadata_adapters (source);
+	if (!xb_builder_source_load_file (source, file,
+					  XB_BUILDER_SOURCE_FLAG_NONE,
+					  NULL, error)) {
+		g_hash_table_unref (ids);
+		return NULL;
+	}
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, error);
+	if (silo == NULL) {
+		g_hash_table_unref (ids);
+		return NULL;
+	}
+	components = xb_silo_query (silo, "components/component/id", 0, NULL);
+	for (guint i = 0; components != NULL && i < components->len; i++) {
+		XbNode *n = g_ptr_array_index (components, i);
+		if (xb_node_get_text (n) != NULL)
+			g_hash_table_add (ids, g_strdup (xb_node_get_text (n)));
+	}
+	return ids;
+}
+
+static gboolean
+fu_engine_delta_base_fixup_cb (XbBuilderFixup *self,
+			       XbBuilderNode *bn,
+			       gpointer user_data,
+			       GError **error)
+{
+	GHashTable *ids = (GHashTable *) user_data;
+	g_autoptr(XbBuilderNode) id = NULL;
+
+	if (g_strcmp0 (xb_builder_node_get_element (bn), "component") != 0)
+		return TRUE;
+	id = xb_builder_node_get_child (bn, "id", NULL);
+	if (id != NULL && g_hash_table_contains (ids, xb_builder_node_get_text (id)))
+		xb_builder_node_add_flag (bn, XB_BUILDER_NODE_FLAG_IGNORE);
+	return TRUE;
+}
+
+static gboolean
+fu_engine_delta_remove_fixup_cb (XbBuilderFixup *self,
+				 XbBuilderNode *bn,
+				 gpointer user_data,
+				 GError **error)
+{
+	if (g_strcmp0 (xb_builder_node_get_element (bn), "component") != 0)
+		return TRUE;
+	if (g_strcmp0 (xb_builder_node_get_attr (bn, "delta"), "remove") == 0)
+		xb_builder_node_add_flag (bn, XB_BUILDER_NODE_FLAG_IGNORE);
+	return TRUE;
+}
+
+static XbBuilderNode *
+fu_engine_metadata_source_info_new (FwupdRemote *remote, const gchar *path)
+{
+	XbBuilderNode *custom = xb_builder_node_new ("custom");
+	xb_builder_node_insert_text (custom,
+				     "value", path,
+				     "key", "fwupd::FilenameCache",
+				     NULL);
+	xb_builder_node_insert_text (custom,
+				     "value", fwupd_remote_get_id (remote),
+				     "key", "fwupd::RemoteId",
+				     NULL);
+	return custom;
+}
+
+/* imports the delta for @remote on top of @source_base, if one exists */
+static gboolean
+fu_engine_load_metadata_delta (FuEngine *self,
+			       XbBuilder *builder,
+			       XbBuilderSource *source_base,
+			       FwupdRemote *remote,
+			       GError **error)
+{
+	const gchar *path = fwupd_remote_get_filename_cache (remote);
+	g_autofree gchar *fn = fu_engine_get_delta_filename (remote);
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GHashTable) ids = NULL;
+	g_autoptr(XbBuilderFixup) fixup_base = NULL;
+	g_autoptr(XbBuilderFixup) fixup_remove = NULL;
+	g_autoptr(XbBuilderFixup) fixup_upgrade = NULL;
+	g_autoptr(XbBuilderNode) custom = NULL;
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+
+	if (!g_file_test (fn, G_FILE_TEST_EXISTS))
+		return TRUE;
+	file = g_file_new_for_path (fn);
+	ids = fu_engine_get_delta_component_ids (file, error);
+	if (ids == NULL)
+		return FALSE;
+	fu_engine_add_metadata_adapters (source);
+	if (!xb_builder_source_load_file (source, file,
+					  XB_BUILDER_SOURCE_FLAG_NONE,
+					  NULL, error))
+		return FALSE;
+
+	/* hide the base components the delta replaces */
+	fixup_base = xb_builder_fixup_new ("MetadataDeltaBase",
+					   fu_engine_delta_base_fixup_cb,
+					   g_hash_table_ref (ids),
+					   (GDestroyNotify) g_hash_table_unref);
+	xb_builder_fixup_set_max_depth (fixup_base, 2);
+	xb_builder_source_add_fixup (source_base, fixup_base);
+
+	/* the delta is otherwise loaded just like the base */
+	fixup_remove = xb_builder_fixup_new ("MetadataDeltaRemove",
+					     fu_engine_delta_remove_fixup_cb,
+					     NULL, NULL);
+	xb_builder_fixup_set_max_depth (fixup_remove, 2);
+	xb_builder_source_add_fixup (source, fixup_remove);
+	fixup_upgrade = xb_builder_fixup_new ("AppStreamUpgrade",
+					      fu_engine_appstream_upgrade_cb,
+					      self, NULL);
+	xb_builder_fixup_set_max_depth (fixup_upgrade, 3);
+	xb_builder_source_add_fixup (source, fixup_upgrade);
+	fu_engine_add_component_index_fixup (self, source);
+	custom = fu_engine_metadata_source_info_new (remote, path);
+	xb_builder_source_set_info (source, custom);
+	xb_builder_import_source (builder, source);
+	g_debug ("applied delta with %u components for remote %s",
+		 g_hash_table_size (ids), fwupd_remote_get_id (remote));
+	return TRUE;
+}
+
+static void
+fu_engine_silo_remotes_key_add_file (GString *str, const gchar *filename)
+{
+	GStatBuf st = { 0x0 };
+	if (g_stat (filename, &st) != 0)
+		return;
+	g_string_append_printf (str, "%s:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT "\n",
+				filename, (gint64) st.st_mtime, (gint64) st.st_size);
+}
+
+/* everything about the remote that affects what gets imported into its
+ * shard, so that changing something like the ReportURI does not rebuild it */
+static void
+fu_engine_build_remote_key (GString *str, FwupdRemote *remote)
+{
+	g_autofree gchar *fn_delta = fu_engine_get_delta_filename (remote);
+	g_string_append_printf (str, "%s:%i\n",
+				fwupd_remote_get_id (remote),
+				fwupd_remote_get_kind (remote));
+	fu_engine_silo_remotes_key_add_file (str, fwupd_remote_get_filename_cache (remote));
+	fu_engine_silo_remotes_key_add_file (str, fn_delta);
+}
+
+static gchar *
+fu_engine_build_silo_remotes_key (FuEngine *self)
+{
+	GPtrArray *remotes = fu_remote_list_get_all (self->remote_list);
+	GString *str = g_string_new (NULL);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		if (!fwupd_remote_get_enabled (remote))
+			continue;
+		fu_engine_build_remote_key (str, remote);
+	}
+	return g_string_free (str, FALSE);
+}
+
+/* adds the metadata for one remote to @builder */
+static gboolean
+fu_engine_load_metadata_remote (FuEngine *self,
+				XbBuilder *builder,
+				FwupdRemote *remote,
+				GError **error)
+{
+	const gchar *path = fwupd_remote_get_filename_cache (remote);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(XbBuilderFixup) fixup = NULL;
+	g_autoptr(XbBuilderNode) custom = NULL;
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
 
-	/* clear existing silo */
-	g_clear_object (&self->silo);
+	/* generate all metadata on demand */
+	if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
+		g_debug ("building metadata for remote '%s'",
+			 fwupd_remote_get_id (remote));
+		return fu_engine_create_metadata (self, builder, remote, error);
+	}
+
+	/* save the remote-id in the custom metadata space */
+	file = g_file_new_for_path (path);
+	fu_engine_add_metadata_adapters (source);
+	if (!xb_builder_source_load_file (source, file,
+					  XB_BUILDER_SOURCE_FLAG_NONE,
+					  NULL, error))
+		return FALSE;
+
+	/* fix up any legacy installed files */
+	fixup = xb_builder_fixup_new ("AppStreamUpgrade",
+				      fu_engine_appstream_upgrade_cb,
+				      self, NULL);
+	xb_builder_fixup_set_max_depth (fixup, 3);
+	xb_builder_source_add_fixup (source, fixup);
+	fu_engine_add_component_index_fixup (self, source);
+
+	/* add metadata */
+	custom = fu_engine_metadata_source_info_new (remote, path);
+	xb_builder_source_set_info (source, custom);
+
+	/* a broken delta must not hide the full metadata */
+	if (!fu_engine_load_metadata_delta (self, builder, source,
+					    remote, &error_local)) {
+		g_warning ("failed to load delta for remote %s: %s",
+			   fwupd_remote_get_id (remote),
+			   error_local->message);
+	}
+
+	/* we need to watch for changes? */
+	xb_builder_import_source (builder, source);
+	return TRUE;
+}
+
+/* compiles or maps the silo for the shard, and indexes it */
+static gboolean
+fu_engine_shard_build (FuEngine *self, FuEngineShard *shard, GError **error)
+{
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "shard_build");
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
 
 	/* verbose profiling */
 	if (g_getenv ("FWUPD_VERBOSE") != NULL) {
@@ -3204,17 +5263,87 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 					      XB_SILO_PROFILE_FLAG_DEBUG);
 	}
 
-	/* load each enabled metadata file */
+	/* the requirements cache uses the index, so it is unique per shard */
+	self->component_index = 0;
+	if (!fu_engine_load_metadata_remote (self, builder, shard->remote, error))
+		return FALSE;
+
+	/* the fixups may change between versions, so do not reuse the silo */
+	xb_builder_append_guid (builder, PACKAGE_VERSION);
+	shard->silo = xb_builder_ensure (builder, shard->xmlb,
+					 shard->compile_flags, NULL, error);
+	if (shard->silo == NULL)
+		return FALSE;
+	fu_metrics_histogram_observe ("fwupd_silo_build_duration_seconds", NULL,
+				      g_timer_elapsed (timer, NULL));
+
+	/* build the index */
+	if (!xb_silo_query_build_index (shard->silo,
+					"components/component/provides/firmware",
+					"type", error))
+		return FALSE;
+	if (!xb_silo_query_build_index (shard->silo,
+					"components/component/provides/firmware",
+					NULL, error))
+		return FALSE;
+	fu_engine_shard_ensure_index (shard);
+	return TRUE;
+}
+
+/* loads the shard the first time it might match something */
+static gboolean
+fu_engine_shard_ensure_silo (FuEngine *self, FuEngineShard *shard)
+{
+	g_autoptr(GError) error_local = NULL;
+
+	if (shard->silo != NULL || shard->failed)
+		return !shard->failed;
+	g_debug ("loading shard for remote %s", fwupd_remote_get_id (shard->remote));
+	if (!fu_engine_shard_build (self, shard, &error_local)) {
+		g_warning ("failed to load remote %s: %s",
+			   fwupd_remote_get_id (shard->remote),
+			   error_local->message);
+		shard->failed = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	GPtrArray *remotes;
+	XbBuilderCompileFlags compile_flags = XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID;
+	guint shards_loaded = 0;
+	g_autofree gchar *cachedirpkg = NULL;
+	g_autofree gchar *xmlbfn_legacy = NULL;
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "load_metadata_store");
+
+	/* clear existing shards and anything computed from them */
+	g_ptr_array_set_size (self->shards, 0);
+	g_clear_pointer (&self->silo_remotes_key, g_free);
+	fu_engine_invalidate_releases_cache (self);
+
+	/* on a read-only filesystem don't care about the cache GUID */
+	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
+		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
+
+	/* all the remotes used to be in one silo */
+	cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	xmlbfn_legacy = g_build_filename (cachedirpkg, "metadata.xmlb", NULL);
+	if (g_file_test (xmlbfn_legacy, G_FILE_TEST_EXISTS))
+		g_unlink (xmlbfn_legacy);
+
+	/* create a shard for each enabled metadata file */
 	remotes = fu_remote_list_get_all (self->remote_list);
 	for (guint i = 0; i < remotes->len; i++) {
-		const gchar *path = NULL;
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GFile) file = NULL;
-		g_autoptr(XbBuilderFixup) fixup = NULL;
-		g_autoptr(XbBuilderNode) custom = NULL;
-		g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
-
 		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		FuEngineShard *shard;
+		const gchar *path;
+		g_autofree gchar *basename = NULL;
+		g_autofree gchar *xmlbfn = NULL;
+		g_autoptr(GString) key = g_string_new (PACKAGE_VERSION "\n");
+
 		if (!fwupd_remote_get_enabled (remote)) {
 			g_debug ("remote %s not enabled, so skipping",
 				 fwupd_remote_get_id (remote));
@@ -3226,78 +5355,32 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 			continue;
 		}
 
-		/* generate all metadata on demand */
-		if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY) {
-			g_debug ("building metadata for remote '%s'",
-				 fwupd_remote_get_id (remote));
-			if (!fu_engine_create_metadata (self, builder, remote, &error_local)) {
-				g_warning ("failed to generate remote %s: %s",
-					   fwupd_remote_get_id (remote),
-					   error_local->message);
-			}
-			continue;
-		}
-
-		/* save the remote-id in the custom metadata space */
-		file = g_file_new_for_path (path);
-		if (!xb_builder_source_load_file (source, file,
-						  XB_BUILDER_SOURCE_FLAG_NONE,
-						  NULL, &error_local)) {
-			g_warning ("failed to load remote %s: %s",
-				   fwupd_remote_get_id (remote),
-				   error_local->message);
-			continue;
+		shard = fu_engine_shard_new ();
+		shard->remote = g_object_ref (remote);
+		shard->compile_flags = compile_flags;
+		basename = g_strdup_printf ("%s.xmlb", fwupd_remote_get_id (remote));
+		xmlbfn = g_build_filename (cachedirpkg, "metadata", basename, NULL);
+		shard->xmlb = g_file_new_for_path (xmlbfn);
+		g_ptr_array_add (self->shards, shard);
+
+		/* the files in a directory remote are not part of the key, so
+		 * the filter cannot be trusted without loading the silo */
+		if (fwupd_remote_get_kind (remote) != FWUPD_REMOTE_KIND_DIRECTORY) {
+			fu_engine_build_remote_key (key, remote);
+			shard->key = g_strdup (key->str);
+			shard->bloom_fn = g_strdup_printf ("%s.bloom", xmlbfn);
+			if (fu_engine_shard_load_bloom (shard))
+				continue;
 		}
-
-		/* fix up any legacy installed files */
-		fixup = xb_builder_fixup_new ("AppStreamUpgrade",
-					      fu_engine_appstream_upgrade_cb,
-					      self, NULL);
-		xb_builder_fixup_set_max_depth (fixup, 3);
-		xb_builder_source_add_fixup (source, fixup);
-
-		/* add metadata */
-		custom = xb_builder_node_new ("custom");
-		xb_builder_node_insert_text (custom,
-					     "value", path,
-					     "key", "fwupd::FilenameCache",
-					     NULL);
-		xb_builder_node_insert_text (custom,
-					     "value", fwupd_remote_get_id (remote),
-					     "key", "fwupd::RemoteId",
-					     NULL);
-		xb_builder_source_set_info (source, custom);
-
-		/* we need to watch for changes? */
-		xb_builder_import_source (builder, source);
+		if (fu_engine_shard_ensure_silo (self, shard))
+			shards_loaded++;
 	}
+	g_debug ("%u remotes, %u shards loaded now",
+		 self->shards->len, shards_loaded);
+	self->silo_remotes_key = fu_engine_build_silo_remotes_key (self);
 
-	/* on a read-only filesystem don't care about the cache GUID */
-	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
-		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
-
-	/* ensure silo is up to date */
-	cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
-	xmlbfn = g_build_filename (cachedirpkg, "metadata.xmlb", NULL);
-	xmlb = g_file_new_for_path (xmlbfn);
-	self->silo = xb_builder_ensure (builder, xmlb, compile_flags, NULL, error);
-	if (self->silo == NULL)
-		return FALSE;
-
-	/* print what we've got */
-	components = xb_silo_query (self->silo, "components/component", 0, NULL);
-	if (components != NULL)
-		g_debug ("%u components now in silo", components->len);
-
-	/* build the index */
-	if (!xb_silo_query_build_index (self->silo,
-					"components/component/provides/firmware",
-					"type", error))
-		return FALSE;
-	if (!xb_silo_query_build_index (self->silo,
-					"components/component/provides/firmware",
-					NULL, error))
-		return FALSE;
+	/* do the expensive work before a client asks for it */
+	fu_engine_schedule_idle_tasks (self);
 
 	/* success */
 	return TRUE;
@@ -3306,17 +5389,28 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 static void
 fu_engine_config_changed_cb (FuConfig *config, FuEngine *self)
 {
+	g_autoptr(GMutexLocker) locker = NULL;
 	fu_idle_set_timeout (self->idle, fu_config_get_idle_timeout (config));
+	locker = g_mutex_locker_new (&self->silo_cache_mutex);
+	fu_engine_silo_cache_trim (self, fu_engine_get_archive_cache_size_max (self));
 }
 
 static void
 fu_engine_remote_list_changed_cb (FuRemoteList *remote_list, FuEngine *self)
 {
 	g_autoptr(GError) error_local = NULL;
-	if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE,
-					    &error_local))
+	g_autofree gchar *key = fu_engine_build_silo_remotes_key (self);
+
+	/* only rebuild the silo if the metadata would be different, but the
+	 * releases still need the new URIs and approval settings */
+	if (self->silo_remotes_key != NULL && g_strcmp0 (key, self->silo_remotes_key) == 0) {
+		g_debug ("remotes changed, but not the metadata");
+		fu_engine_invalidate_releases_cache (self);
+	} else if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE,
+						   &error_local)) {
 		g_warning ("Failed to reload metadata store: %s",
 			   error_local->message);
+	}
 
 	/* set device properties from the metadata */
 	fu_engine_md_refresh_devices (self);
@@ -3370,8 +5464,12 @@ fu_engine_get_newest_signature_jcat_result (GPtrArray *results, GError **error)
 	return NULL;
 }
 
-static JcatResult *
-fu_engine_get_system_jcat_result (FuEngine *self, FwupdRemote *remote, GError **error)
+/* gets the signing timestamp of the metadata that is already installed */
+static gboolean
+fu_engine_get_system_jcat_timestamp (FuEngine *self,
+				     FwupdRemote *remote,
+				     gint64 *timestamp,
+				     GError **error)
 {
 	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GBytes) blob_sig = NULL;
@@ -3379,42 +5477,67 @@ fu_engine_get_system_jcat_result (FuEngine *self, FwupdRemote *remote, GError **
 	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(JcatItem) jcat_item = NULL;
 	g_autoptr(JcatFile) jcat_file = jcat_file_new ();
+	g_autoptr(JcatResult) jcat_result = NULL;
+	g_autofree gchar *fn_delta = fu_engine_get_delta_filename (remote);
 
-	blob = fu_common_get_contents_bytes (fwupd_remote_get_filename_cache (remote), error);
-	if (blob == NULL)
-		return NULL;
-	blob_sig = fu_common_get_contents_bytes (fwupd_remote_get_filename_cache_sig (remote), error);
-	if (blob_sig == NULL)
-		return NULL;
+	/* the delta is always signed later than the metadata it applies to */
+	if (g_file_test (fn_delta, G_FILE_TEST_EXISTS)) {
+		g_autofree gchar *fn_delta_sig = fu_engine_get_delta_filename_sig (remote);
+		blob = fu_common_get_contents_bytes (fn_delta, error);
+		if (blob == NULL)
+			return FALSE;
+		blob_sig = fu_common_get_contents_bytes (fn_delta_sig, error);
+		if (blob_sig == NULL)
+			return FALSE;
+	} else {
+		blob = fu_common_get_contents_bytes (fwupd_remote_get_filename_cache (remote), error);
+		if (blob == NULL)
+			return FALSE;
+		blob_sig = fu_common_get_contents_bytes (fwupd_remote_get_filename_cache_sig (remote), error);
+		if (blob_sig == NULL)
+			return FALSE;
+	}
 	istream = g_memory_input_stream_new_from_bytes (blob_sig);
 	if (!jcat_file_import_stream (jcat_file, istream,
 				      JCAT_IMPORT_FLAG_NONE,
 				      NULL, error))
-		return NULL;
+		return FALSE;
 	jcat_item = jcat_file_get_item_default (jcat_file, error);
 	if (jcat_item == NULL)
-		return NULL;
+		return FALSE;
+
+	/* verified when the metadata was downloaded */
+	if (fu_jcat_cache_lookup (self->jcat_cache, blob, jcat_item,
+				  JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+				  JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+				  timestamp)) {
+		g_debug ("using cached signature for %s", fwupd_remote_get_id (remote));
+		return TRUE;
+	}
 	results = jcat_context_verify_item (self->jcat_context,
 					    blob, jcat_item,
 					    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
 					    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
 					    error);
 	if (results == NULL)
-		return NULL;
+		return FALSE;
 
-	/* return the newest signature */
-	return fu_engine_get_newest_signature_jcat_result (results, error);
+	/* use the newest signature */
+	jcat_result = fu_engine_get_newest_signature_jcat_result (results, error);
+	if (jcat_result == NULL)
+		return FALSE;
+	*timestamp = jcat_result_get_timestamp (jcat_result);
+	return TRUE;
 }
 
 static gboolean
 fu_engine_validate_result_timestamp (JcatResult *jcat_result,
-				     JcatResult *jcat_result_old,
+				     gint64 timestamp_old,
 				     GError **error)
 {
 	gint64 delta = 0;
 
 	g_return_val_if_fail (JCAT_IS_RESULT (jcat_result), FALSE);
-	g_return_val_if_fail (JCAT_IS_RESULT (jcat_result_old), FALSE);
 
 	if (jcat_result_get_timestamp (jcat_result) == 0) {
 		g_set_error (error,
@@ -3423,10 +5546,8 @@ fu_engine_validate_result_timestamp (JcatResult *jcat_result,
 			     "no signing timestamp");
 		return FALSE;
 	}
-	if (jcat_result_get_timestamp (jcat_result_old) > 0) {
-		delta = jcat_result_get_timestamp (jcat_result) -
-			jcat_result_get_timestamp (jcat_result_old);
-	}
+	if (timestamp_old > 0)
+		delta = jcat_result_get_timestamp (jcat_result) - timestamp_old;
 	if (delta < 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -3441,32 +5562,17 @@ fu_engine_validate_result_timestamp (JcatResult *jcat_result,
 	return TRUE;
 }
 
-/**
- * fu_engine_update_metadata_bytes:
- * @self: A #FuEngine
- * @remote_id: A remote ID, e.g. `lvfs`
- * @bytes_raw: Blob of metadata
- * @bytes_sig: Blob of metadata signature, typically Jcat binary format
- * @error: A #GError, or %NULL
- *
- * Updates the metadata for a specific remote.
- *
- * Returns: %TRUE for success
- **/
-gboolean
-fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
-			        GBytes *bytes_raw, GBytes *bytes_sig, GError **error)
+/* verifies and saves the metadata without reloading the silo */
+static gboolean
+fu_engine_update_metadata_bytes_save (FuEngine *self, const gchar *remote_id,
+				      GBytes *bytes_raw, GBytes *bytes_sig,
+				      GError **error)
 {
 	FwupdKeyringKind keyring_kind;
 	FwupdRemote *remote;
-	g_autofree gchar *pki_dir = NULL;
-	g_autofree gchar *sysconfdir = NULL;
-
-	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
-	g_return_val_if_fail (remote_id != NULL, FALSE);
-	g_return_val_if_fail (bytes_raw != NULL, FALSE);
-	g_return_val_if_fail (bytes_sig != NULL, FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	g_autofree gchar *delta_base = NULL;
+	g_autofree gchar *fn_delta = NULL;
+	g_autofree gchar *fn_delta_sig = NULL;
 
 	/* check remote is valid */
 	remote = fu_remote_list_get_by_id (self->remote_list, remote_id);
@@ -3489,12 +5595,13 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 	keyring_kind = fwupd_remote_get_keyring_kind (remote);
 	if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
 		JcatResult *jcat_result;
+		gint64 timestamp_old = 0;
+		g_autoptr(GError) error_cache = NULL;
 		g_autoptr(GError) error_local = NULL;
 		g_autoptr(GInputStream) istream = NULL;
 		g_autoptr(GPtrArray) results = NULL;
 		g_autoptr(JcatFile) jcat_file = jcat_file_new ();
 		g_autoptr(JcatItem) jcat_item = NULL;
-		g_autoptr(JcatResult) jcat_result_old = NULL;
 
 		/* load Jcat file */
 		istream = g_memory_input_stream_new_from_bytes (bytes_sig);
@@ -3522,8 +5629,9 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 
 		/* verify the metadata was signed later than the existing
 		 * metadata for this remote to mitigate a rollback attack */
-		jcat_result_old = fu_engine_get_system_jcat_result (self, remote, &error_local);
-		if (jcat_result_old == NULL) {
+		if (!fu_engine_get_system_jcat_timestamp (self, remote,
+							  &timestamp_old,
+							  &error_local)) {
 			if (g_error_matches (error_local,
 					     G_FILE_ERROR,
 					     G_FILE_ERROR_NOENT)) {
@@ -3535,21 +5643,61 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 			}
 		} else {
 			if (!fu_engine_validate_result_timestamp (jcat_result,
-								  jcat_result_old,
+								  timestamp_old,
 								  error))
 				return FALSE;
 		}
+
+		/* so this does not have to be verified again */
+		if (!fu_jcat_cache_add (self->jcat_cache, bytes_raw, jcat_item,
+					JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+					JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+					results, &error_cache))
+			g_debug ("failed to cache signature: %s", error_cache->message);
 	}
 
-	/* save XML and signature to remotes.d */
-	if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache (remote),
-					   bytes_raw, error))
-		return FALSE;
-	if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
-		if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache_sig (remote),
-						   bytes_sig, error))
+	/* a delta only makes sense against the exact metadata we have */
+	fn_delta = fu_engine_get_delta_filename (remote);
+	fn_delta_sig = fu_engine_get_delta_filename_sig (remote);
+	delta_base = fu_engine_get_delta_base_from_blob (bytes_raw);
+	if (delta_base != NULL) {
+		if (g_strcmp0 (delta_base, fwupd_remote_get_checksum (remote)) != 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "delta metadata base %s does not match %s, "
+				     "full metadata required",
+				     delta_base,
+				     fwupd_remote_get_checksum (remote));
+			return FALSE;
+		}
+		if (!fu_common_set_contents_bytes (fn_delta, bytes_raw, error))
 			return FALSE;
+		if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
+			if (!fu_common_set_contents_bytes (fn_delta_sig, bytes_sig, error))
+				return FALSE;
+		}
+	} else {
+		/* save XML and signature to remotes.d */
+		if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache (remote),
+						   bytes_raw, error))
+			return FALSE;
+		if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
+			if (!fu_common_set_contents_bytes (fwupd_remote_get_filename_cache_sig (remote),
+							   bytes_sig, error))
+				return FALSE;
+		}
+
+		/* any old delta applied to the previous metadata */
+		g_unlink (fn_delta);
+		g_unlink (fn_delta_sig);
 	}
+	return TRUE;
+}
+
+static gboolean
+fu_engine_update_metadata_reload (FuEngine *self, GError **error)
+{
 	if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE, error))
 		return FALSE;
 
@@ -3559,8 +5707,92 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 	/* invalidate host security attributes */
 	g_clear_pointer (&self->host_security_id, g_free);
 
-	/* make the UI update */
-	fu_engine_emit_changed (self);
+	/* make the UI update */
+	fu_engine_emit_changed (self);
+	return TRUE;
+}
+
+/**
+ * fu_engine_update_metadata_bytes:
+ * @self: A #FuEngine
+ * @remote_id: A remote ID, e.g. `lvfs`
+ * @bytes_raw: Blob of metadata
+ * @bytes_sig: Blob of metadata signature, typically Jcat binary format
+ * @error: A #GError, or %NULL
+ *
+ * Updates the metadata for a specific remote.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
+			        GBytes *bytes_raw, GBytes *bytes_sig, GError **error)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (remote_id != NULL, FALSE);
+	g_return_val_if_fail (bytes_raw != NULL, FALSE);
+	g_return_val_if_fail (bytes_sig != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!fu_engine_update_metadata_bytes_save (self, remote_id,
+						   bytes_raw, bytes_sig,
+						   error))
+		return FALSE;
+	return fu_engine_update_metadata_reload (self, error);
+}
+
+/**
+ * fu_engine_update_metadata_batch:
+ * @self: A #FuEngine
+ * @remote_ids: (element-type utf8): remote IDs, e.g. `lvfs`
+ * @blobs_raw: (element-type GBytes): metadata for each remote
+ * @blobs_sig: (element-type GBytes): metadata signature for each remote
+ * @error: A #GError, or %NULL
+ *
+ * Updates the metadata for several remotes, only rebuilding the silo once.
+ * If any remote fails to verify then the others are still updated and the
+ * first error is returned.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_update_metadata_batch (FuEngine *self,
+				 GPtrArray *remote_ids,
+				 GPtrArray *blobs_raw,
+				 GPtrArray *blobs_sig,
+				 GError **error)
+{
+	guint saved = 0;
+	g_autoptr(GError) error_first = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (remote_ids != NULL, FALSE);
+	g_return_val_if_fail (blobs_raw->len == remote_ids->len, FALSE);
+	g_return_val_if_fail (blobs_sig->len == remote_ids->len, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	for (guint i = 0; i < remote_ids->len; i++) {
+		const gchar *remote_id = g_ptr_array_index (remote_ids, i);
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_update_metadata_bytes_save (self, remote_id,
+							   g_ptr_array_index (blobs_raw, i),
+							   g_ptr_array_index (blobs_sig, i),
+							   &error_local)) {
+			g_prefix_error (&error_local,
+					"Failed to update metadata for %s: ",
+					remote_id);
+			if (error_first == NULL)
+				error_first = g_steal_pointer (&error_local);
+			continue;
+		}
+		saved++;
+	}
+	if (saved > 0 && !fu_engine_update_metadata_reload (self, error))
+		return FALSE;
+	if (error_first != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_first));
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -3621,6 +5853,25 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 #endif
 }
 
+static JcatContext *
+fu_engine_jcat_context_new (void)
+{
+	g_autofree gchar *keyring_path = NULL;
+	g_autofree gchar *pkidir_fw = NULL;
+	g_autofree gchar *pkidir_md = NULL;
+	g_autofree gchar *sysconfdir = NULL;
+	JcatContext *jcat_context = jcat_context_new ();
+
+	keyring_path = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	jcat_context_set_keyring_path (jcat_context, keyring_path);
+	sysconfdir = fu_common_get_path (FU_PATH_KIND_SYSCONFDIR);
+	pkidir_fw = g_build_filename (sysconfdir, "pki", "fwupd", NULL);
+	jcat_context_add_public_keys (jcat_context, pkidir_fw);
+	pkidir_md = g_build_filename (sysconfdir, "pki", "fwupd-metadata", NULL);
+	jcat_context_add_public_keys (jcat_context, pkidir_md);
+	return jcat_context;
+}
+
 /**
  * fu_engine_get_silo_from_blob:
  * @self: A #FuEngine
@@ -3634,6 +5885,10 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 XbSilo *
 fu_engine_get_silo_from_blob (FuEngine *self, GBytes *blob_cab, GError **error)
 {
+	FuEngineSiloCacheItem *item;
+	gboolean is_main_thread = g_thread_self () == self->main_thread;
+	guint64 cache_size_max;
+	g_autofree gchar *checksum = NULL;
 	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
 	g_autoptr(XbSilo) silo = NULL;
 
@@ -3641,14 +5896,54 @@ fu_engine_get_silo_from_blob (FuEngine *self, GBytes *blob_cab, GError **error)
 	g_return_val_if_fail (blob_cab != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	/* the same archive is often installed onto many identical devices */
+	cache_size_max = fu_engine_get_archive_cache_size_max (self);
+	if (cache_size_max > 0) {
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->silo_cache_mutex);
+		checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob_cab);
+		for (GList *l = self->silo_cache->head; l != NULL; l = l->next) {
+			item = l->data;
+			if (g_strcmp0 (item->checksum, checksum) != 0)
+				continue;
+			g_debug ("using %s from archive cache", checksum);
+			g_queue_unlink (self->silo_cache, l);
+			g_queue_push_head_link (self->silo_cache, l);
+			return g_object_ref (item->silo);
+		}
+	}
+
 	/* load file */
-	fu_engine_set_status (self, FWUPD_STATUS_DECOMPRESSING);
+	if (is_main_thread)
+		fu_engine_set_status (self, FWUPD_STATUS_DECOMPRESSING);
 	fu_cabinet_set_size_max (cabinet, fu_engine_get_archive_size_max (self));
-	fu_cabinet_set_jcat_context (cabinet, self->jcat_context);
-	if (!fu_cabinet_parse (cabinet, blob_cab, FU_CABINET_PARSE_FLAG_NONE, error))
+	fu_cabinet_set_jcat_cache (cabinet, self->jcat_cache);
+
+	/* the Jcat engines keep state, so each thread needs its own */
+	if (is_main_thread) {
+		fu_cabinet_set_jcat_context (cabinet, self->jcat_context);
+	} else {
+		g_autoptr(JcatContext) jcat_context = fu_engine_jcat_context_new ();
+		fu_cabinet_set_jcat_context (cabinet, jcat_context);
+	}
+	if (!fu_cabinet_parse (cabinet, blob_cab,
+			       FU_CABINET_PARSE_FLAG_EXTRACT_PAYLOADS,
+			       error))
 		return NULL;
 	silo = fu_cabinet_get_silo (cabinet);
-	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
+	if (is_main_thread)
+		fu_engine_set_status (self, FWUPD_STATUS_IDLE);
+
+	/* the archive size is a good enough estimate of the payloads */
+	if (cache_size_max > 0 && g_bytes_get_size (blob_cab) <= cache_size_max) {
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->silo_cache_mutex);
+		item = g_new0 (FuEngineSiloCacheItem, 1);
+		item->checksum = g_steal_pointer (&checksum);
+		item->silo = g_object_ref (silo);
+		item->size = g_bytes_get_size (blob_cab);
+		self->silo_cache_size += item->size;
+		g_queue_push_head (self->silo_cache, item);
+		fu_engine_silo_cache_trim (self, cache_size_max);
+	}
 	return g_steal_pointer (&silo);
 }
 
@@ -3803,12 +6098,7 @@ fu_engine_get_details_sort_cb (gconstpointer a, gconstpointer b)
 GPtrArray *
 fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError **error)
 {
-	const gchar *remote_id;
-	g_autofree gchar *csum = NULL;
 	g_autoptr(GBytes) blob = NULL;
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) components = NULL;
-	g_autoptr(GPtrArray) details = NULL;
 	g_autoptr(XbSilo) silo = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
@@ -3824,6 +6114,41 @@ fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError
 	silo = fu_engine_get_silo_from_blob (self, blob, error);
 	if (silo == NULL)
 		return NULL;
+	return fu_engine_get_details_for_silo (self, request, blob, silo, error);
+}
+
+/**
+ * fu_engine_get_details_for_silo:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ * @blob_cab: The archive data
+ * @silo: A #XbSilo from fu_engine_get_silo_from_blob()
+ * @error: A #GError, or %NULL
+ *
+ * Gets the details about an archive that has already been parsed, which
+ * allows many archives to be decompressed and verified in other threads.
+ *
+ * Returns: (transfer container) (element-type FuDevice): results
+ **/
+GPtrArray *
+fu_engine_get_details_for_silo (FuEngine *self,
+				FuEngineRequest *request,
+				GBytes *blob_cab,
+				XbSilo *silo,
+				GError **error)
+{
+	const gchar *remote_id;
+	g_autofree gchar *csum = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GPtrArray) details = NULL;
+	g_autoptr(XbNode) csum_node = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (blob_cab != NULL, NULL);
+	g_return_val_if_fail (XB_IS_SILO (silo), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
 	components = xb_silo_query (silo, "components/component", 0, &error_local);
 	if (components == NULL) {
 		g_set_error (error,
@@ -3842,8 +6167,15 @@ fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError
 					NULL, error))
 		return NULL;
 
-	/* does this exist in any enabled remote */
-	csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob);
+	/* does this exist in any enabled remote; the cabinet already hashed
+	 * the archive when it was parsed so avoid another pass over the data */
+	csum_node = xb_silo_query_first (silo,
+					 "components/component/releases/release/"
+					 "checksum[@target='container']", NULL);
+	if (csum_node != NULL && xb_node_get_text (csum_node) != NULL)
+		csum = g_strdup (xb_node_get_text (csum_node));
+	else
+		csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob_cab);
 	remote_id = fu_engine_get_remote_id_for_checksum (self, csum);
 
 	/* create results with all the metadata in */
@@ -3924,21 +6256,90 @@ fu_engine_sort_devices_by_priority_name (gconstpointer a, gconstpointer b)
  **/
 GPtrArray *
 fu_engine_get_devices (FuEngine *self, GError **error)
+{
+	GPtrArray *devices;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* sorted again only when a device is added, removed or changed */
+	if (self->devices_sorted == NULL) {
+		g_autoptr(GPtrArray) devices_active = fu_device_list_get_active (self->device_list);
+		self->devices_sorted = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		for (guint i = 0; i < devices_active->len; i++) {
+			FuDevice *device = g_ptr_array_index (devices_active, i);
+			g_ptr_array_add (self->devices_sorted, g_object_ref (device));
+		}
+		g_ptr_array_sort (self->devices_sorted,
+				  fu_engine_sort_devices_by_priority_name);
+	}
+	if (self->devices_sorted->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No detected devices");
+		return NULL;
+	}
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < self->devices_sorted->len; i++) {
+		FuDevice *device = g_ptr_array_index (self->devices_sorted, i);
+		g_ptr_array_add (devices, g_object_ref (device));
+	}
+	return devices;
+}
+
+/**
+ * fu_engine_get_devices_filtered:
+ * @self: A #FuEngine
+ * @include_flags: #FwupdDeviceFlags that must all be set
+ * @exclude_flags: #FwupdDeviceFlags that must all be unset
+ * @plugin: (nullable): a plugin name, e.g. `colorhug`
+ * @guid: (nullable): a device GUID
+ * @error: A #GError, or %NULL
+ *
+ * Gets the list of devices matching all of the criteria, in the same order
+ * as fu_engine_get_devices().
+ *
+ * Returns: (transfer container) (element-type FwupdDevice): results
+ **/
+GPtrArray *
+fu_engine_get_devices_filtered (FuEngine *self,
+				FwupdDeviceFlags include_flags,
+				FwupdDeviceFlags exclude_flags,
+				const gchar *plugin,
+				const gchar *guid,
+				GError **error)
 {
 	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	devices = fu_device_list_get_active (self->device_list);
+	devices_tmp = fu_engine_get_devices (self, error);
+	if (devices_tmp == NULL)
+		return NULL;
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < devices_tmp->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices_tmp, i);
+		guint64 flags = fu_device_get_flags (device);
+		if ((flags & include_flags) != include_flags)
+			continue;
+		if ((flags & exclude_flags) != 0)
+			continue;
+		if (plugin != NULL && g_strcmp0 (fu_device_get_plugin (device), plugin) != 0)
+			continue;
+		if (guid != NULL && !fu_device_has_guid (device, guid))
+			continue;
+		g_ptr_array_add (devices, g_object_ref (device));
+	}
 	if (devices->len == 0) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOTHING_TO_DO,
-				     "No detected devices");
+				     "No matching devices");
 		return NULL;
 	}
-	g_ptr_array_sort (devices, fu_engine_sort_devices_by_priority_name);
 	return g_steal_pointer (&devices);
 }
 
@@ -4033,13 +6434,30 @@ fu_engine_get_history_set_hsi_attrs (FuEngine *self, FuDevice *device)
  **/
 GPtrArray *
 fu_engine_get_history (FuEngine *self, GError **error)
+{
+	return fu_engine_get_history_range (self, 0, 0, error);
+}
+
+/**
+ * fu_engine_get_history_range:
+ * @self: A #FuEngine
+ * @limit: maximum number of results, or 0 for no limit
+ * @offset: number of the most recent results to skip
+ * @error: A #GError, or %NULL
+ *
+ * Gets a page of the history, oldest first.
+ *
+ * Returns: (transfer container) (element-type FwupdDevice): results
+ **/
+GPtrArray *
+fu_engine_get_history_range (FuEngine *self, guint limit, guint offset, GError **error)
 {
 	g_autoptr(GPtrArray) devices = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	devices = fu_history_get_devices (self->history, error);
+	devices = fu_history_get_devices_range (self->history, limit, offset, error);
 	if (devices == NULL)
 		return NULL;
 	if (devices->len == 0) {
@@ -4280,19 +6698,16 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 	return TRUE;
 }
 
-GPtrArray *
-fu_engine_get_releases_for_device (FuEngine *self,
-				   FuEngineRequest *request,
-				   FuDevice *device,
-				   GError **error)
+static GPtrArray *
+fu_engine_get_releases_for_device_uncached (FuEngine *self,
+					    FuEngineRequest *request,
+					    FuDevice *device,
+					    GError **error)
 {
-	GPtrArray *device_guids;
 	GPtrArray *releases;
 	const gchar *version;
 	g_autoptr(GError) error_all = NULL;
-	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
-	g_autoptr(GString) xpath = g_string_new (NULL);
 
 	/* get device version */
 	version = fu_device_get_version (device);
@@ -4314,25 +6729,12 @@ fu_engine_get_releases_for_device (FuEngine *self,
 	}
 
 	/* get all the components that provide any of these GUIDs */
-	device_guids = fu_device_get_guids (device);
-	for (guint i = 0; i < device_guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (device_guids, i);
-		xb_string_append_union (xpath,
-					"components/component/"
-					"provides/firmware[@type=$'flashed'][text()=$'%s']/"
-					"../..", guid);
-	}
-	components = xb_silo_query (self->silo, xpath->str, 0, &error_local);
-	if (components == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
-		    g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_NOTHING_TO_DO,
-					     "No releases found");
-			return NULL;
-		}
-		g_propagate_error (error, g_steal_pointer (&error_local));
+	components = fu_engine_get_components_by_guids (self, device);
+	if (components->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "No releases found");
 		return NULL;
 	}
 
@@ -4373,6 +6775,93 @@ fu_engine_get_releases_for_device (FuEngine *self,
 	return releases;
 }
 
+/**
+ * fu_engine_get_releases_for_device:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ * @device: A #FuDevice
+ * @error: A #GError, or %NULL
+ *
+ * Gets all the releases that pass the requirements for a device. The result
+ * is cached until the metadata, approved firmware or any device changes.
+ *
+ * Returns: (transfer container) (element-type FwupdRelease): results
+ **/
+GPtrArray *
+fu_engine_get_releases_for_device (FuEngine *self,
+				   FuEngineRequest *request,
+				   FuDevice *device,
+				   GError **error)
+{
+	FuEngineReleasesCacheItem *item;
+	GPtrArray *releases;
+	g_autofree gchar *key = NULL;
+
+	/* the result depends on both the device state and the caller */
+	key = g_strdup_printf ("%s:%s:%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT ":%" G_GUINT64_FORMAT,
+			       fu_device_get_id (device),
+			       fu_device_get_version (device),
+			       fu_device_get_flags (device),
+			       (guint64) fu_engine_request_get_feature_flags (request),
+			       (guint64) fu_engine_request_get_device_flags (request));
+	item = g_hash_table_lookup (self->releases_cache, key);
+	fu_metrics_cache_lookup ("releases", item != NULL);
+	if (item == NULL) {
+		item = g_new0 (FuEngineReleasesCacheItem, 1);
+		item->releases = fu_engine_get_releases_for_device_uncached (self,
+									     request,
+									     device,
+									     &item->error);
+		g_hash_table_insert (self->releases_cache, g_steal_pointer (&key), item);
+	} else {
+		g_debug ("using cached releases for %s", fu_device_get_id (device));
+	}
+	if (item->releases == NULL) {
+		g_propagate_error (error, g_error_copy (item->error));
+		return NULL;
+	}
+
+	/* callers sort and filter the container, so give them a copy */
+	releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < item->releases->len; i++) {
+		FwupdRelease *rel = g_ptr_array_index (item->releases, i);
+		g_ptr_array_add (releases, g_object_ref (rel));
+	}
+	return releases;
+}
+
+/**
+ * fu_engine_get_releases_generation:
+ * @self: A #FuEngine
+ *
+ * Gets a counter that is incremented every time the cached releases are
+ * invalidated, which allows clients to skip redundant queries.
+ *
+ * Returns: integer
+ **/
+guint64
+fu_engine_get_releases_generation (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), 0);
+	return self->releases_generation;
+}
+
+/**
+ * fu_engine_get_devices_generation:
+ * @self: A #FuEngine
+ *
+ * Gets a counter that is incremented every time a device is added, removed
+ * or changed, which allows clients to skip redundant queries.
+ *
+ * Returns: integer
+ **/
+guint64
+fu_engine_get_devices_generation (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), 0);
+	return self->devices_generation;
+}
+
 /**
  * fu_engine_get_releases:
  * @self: A #FuEngine
@@ -4535,6 +7024,7 @@ fu_engine_add_approved_firmware (FuEngine *self, const gchar *checksum)
 								 NULL);
 	}
 	g_hash_table_add (self->approved_firmware, g_strdup (checksum));
+	fu_engine_invalidate_releases_cache (self);
 }
 
 gchar *
@@ -4670,6 +7160,207 @@ fu_engine_get_upgrades (FuEngine *self,
 	return g_steal_pointer (&releases);
 }
 
+typedef GPtrArray *(*FuEngineGetReleasesFunc) (FuEngine *self,
+					       FuEngineRequest *request,
+					       const gchar *device_id,
+					       GError **error);
+
+static GHashTable *
+fu_engine_get_releases_for_all (FuEngine *self,
+				FuEngineRequest *request,
+				FuEngineGetReleasesFunc func)
+{
+	GHashTable *results;
+	g_autoptr(GPtrArray) devices = fu_device_list_get_active (self->device_list);
+
+	results = g_hash_table_new_full (g_str_hash, g_str_equal,
+					 g_free, (GDestroyNotify) g_ptr_array_unref);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		GPtrArray *releases;
+		g_autoptr(GError) error_local = NULL;
+
+		/* not going to have results */
+		if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			continue;
+		releases = func (self, request, fu_device_get_id (device), &error_local);
+		if (releases == NULL) {
+			g_debug ("no releases for %s: %s",
+				 fu_device_get_id (device),
+				 error_local->message);
+			continue;
+		}
+		g_hash_table_insert (results,
+				     g_strdup (fu_device_get_id (device)),
+				     releases);
+	}
+	return results;
+}
+
+/**
+ * fu_engine_get_releases_all:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ *
+ * Gets the releases for every updatable device in one pass. Devices without
+ * any releases are not included.
+ *
+ * Returns: (transfer container): device ID to #GPtrArray of #FwupdRelease
+ **/
+GHashTable *
+fu_engine_get_releases_all (FuEngine *self, FuEngineRequest *request)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	return fu_engine_get_releases_for_all (self, request, fu_engine_get_releases);
+}
+
+/* compile the requirements of every component in the metadata silo */
+static void
+fu_engine_idle_compile_requirements_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "idle_compile_requirements");
+	guint cnt = 0;
+
+	/* shards that have not been needed yet are not loaded just for this */
+	for (guint j = 0; j < self->shards->len; j++) {
+		FuEngineShard *shard = g_ptr_array_index (self->shards, j);
+		g_autoptr(GPtrArray) components = NULL;
+		if (shard->silo == NULL)
+			continue;
+		components = xb_silo_query (shard->silo, "components/component", 0, NULL);
+		if (components == NULL)
+			continue;
+		for (guint i = 0; i < components->len; i++) {
+			XbNode *component = g_ptr_array_index (components, i);
+			g_autoptr(GPtrArray) reqs = NULL;
+			g_autoptr(GError) error_local = NULL;
+			reqs = fu_engine_get_requirements (self, component, &error_local);
+			if (reqs == NULL)
+				g_debug ("ignoring requirements: %s", error_local->message);
+		}
+		cnt += components->len;
+	}
+	g_debug ("compiled requirements for %u components", cnt);
+}
+
+/* only archives already on this machine can be pre-parsed, as the daemon
+ * never downloads firmware itself */
+static gchar *
+fu_engine_get_release_local_filename (FuEngine *self, FwupdRelease *rel)
+{
+	FwupdRemote *remote;
+	const gchar *remote_id = fwupd_release_get_remote_id (rel);
+	const gchar *uri = fwupd_release_get_uri (rel);
+
+	if (remote_id == NULL || uri == NULL)
+		return NULL;
+	remote = fu_remote_list_get_by_id (self->remote_list, remote_id);
+	if (remote == NULL)
+		return NULL;
+	if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_LOCAL) {
+		g_autofree gchar *path = g_path_get_dirname (fwupd_remote_get_filename_cache (remote));
+		return g_build_filename (path, uri, NULL);
+	}
+	if (fwupd_remote_get_kind (remote) == FWUPD_REMOTE_KIND_DIRECTORY &&
+	    g_str_has_prefix (uri, "file://"))
+		return g_strdup (uri + 7);
+	return NULL;
+}
+
+/* populate the releases cache, and the archive cache for local upgrades */
+static void
+fu_engine_idle_prefetch_upgrades_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "idle_prefetch_upgrades");
+	g_autoptr(GPtrArray) devices = fu_device_list_get_active (self->device_list);
+
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		FwupdRelease *rel;
+		g_autofree gchar *fn = NULL;
+		g_autoptr(GBytes) blob = NULL;
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) releases = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			continue;
+		releases = fu_engine_get_upgrades (self, request,
+						   fu_device_get_id (device),
+						   NULL);
+		if (releases == NULL || releases->len == 0)
+			continue;
+		if (fu_engine_get_archive_cache_size_max (self) == 0)
+			continue;
+
+		/* the newest upgrade is the one that will be installed */
+		rel = g_ptr_array_index (releases, 0);
+		fn = fu_engine_get_release_local_filename (self, rel);
+		if (fn == NULL)
+			continue;
+		blob = fu_common_get_contents_bytes (fn, &error_local);
+		if (blob == NULL) {
+			g_debug ("failed to prefetch %s: %s", fn, error_local->message);
+			continue;
+		}
+		silo = fu_engine_get_silo_from_blob (self, blob, &error_local);
+		if (silo == NULL) {
+			g_debug ("failed to parse %s: %s", fn, error_local->message);
+			continue;
+		}
+	}
+}
+
+/* apply the retention policy and give the freed pages back to the filesystem */
+static void
+fu_engine_idle_compact_history_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "idle_compact_history");
+	g_autoptr(GError) error_local = NULL;
+
+	if (!fu_history_prune (self->history,
+			       (guint64) fu_config_get_history_max_age (self->config) * 24 * 60 * 60,
+			       fu_config_get_history_max_entries (self->config),
+			       &error_local)) {
+		g_warning ("failed to prune history: %s", error_local->message);
+		return;
+	}
+	if (!fu_history_vacuum (self->history, &error_local))
+		g_warning ("failed to vacuum history: %s", error_local->message);
+}
+
+static void
+fu_engine_schedule_idle_tasks (FuEngine *self)
+{
+	fu_idle_add_task (self->idle, "compact-history",
+			  fu_engine_idle_compact_history_cb, self);
+	fu_idle_add_task (self->idle, "compile-requirements",
+			  fu_engine_idle_compile_requirements_cb, self);
+	fu_idle_add_task (self->idle, "prefetch-upgrades",
+			  fu_engine_idle_prefetch_upgrades_cb, self);
+}
+
+/**
+ * fu_engine_get_upgrades_all:
+ * @self: A #FuEngine
+ * @request: A #FuEngineRequest
+ *
+ * Gets the upgrades for every updatable device in one pass. Devices without
+ * any upgrades are not included.
+ *
+ * Returns: (transfer container): device ID to #GPtrArray of #FwupdRelease
+ **/
+GHashTable *
+fu_engine_get_upgrades_all (FuEngine *self, FuEngineRequest *request)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	return fu_engine_get_releases_for_all (self, request, fu_engine_get_upgrades);
+}
+
 /**
  * fu_engine_clear_results:
  * @self: A #FuEngine
@@ -4757,25 +7448,217 @@ fu_engine_get_results (FuEngine *self, const gchar *device_id, GError **error)
 	return g_object_ref (FWUPD_DEVICE (device));
 }
 
+typedef struct {
+	FuPlugin		*plugin;
+	GError			*error;
+} FuEngineStartupHelper;
+
+static void
+fu_engine_plugin_startup_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineStartupHelper *helper = (FuEngineStartupHelper *) data;
+	fu_plugin_runner_startup (helper->plugin, &helper->error);
+}
+
+/* plugins with the same depsolved order cannot depend on each other, so each
+ * order is started in turn with the thread-safe plugins in a worker pool */
+static void
+fu_engine_plugins_setup_order (FuEngine *self,
+			       FuEngineStartupHelper *helpers,
+			       guint idx_start,
+			       guint idx_end)
+{
+	GThreadPool *pool = NULL;
+
+	for (guint i = idx_start; i < idx_end; i++) {
+		FuPlugin *plugin = helpers[i].plugin;
+		g_autoptr(GError) error = NULL;
+		if (!fu_plugin_get_enabled (plugin))
+			continue;
+		if (fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_STARTUP_THREAD_SAFE) == NULL)
+			continue;
+		if (pool == NULL) {
+			pool = g_thread_pool_new (fu_engine_plugin_startup_thread_cb, NULL,
+						  (gint) g_get_num_processors (),
+						  FALSE, &error);
+			if (pool == NULL) {
+				g_warning ("failed to create startup pool: %s",
+					   error->message);
+				break;
+			}
+		}
+		g_debug ("scheduling threaded startup of %s",
+			 fu_plugin_get_name (plugin));
+		if (!g_thread_pool_push (pool, &helpers[i], &error)) {
+			g_warning ("failed to schedule startup: %s", error->message);
+			fu_plugin_runner_startup (plugin, &helpers[i].error);
+		}
+	}
+
+	/* everything else runs on the main thread at the same time */
+	for (guint i = idx_start; i < idx_end; i++) {
+		FuPlugin *plugin = helpers[i].plugin;
+		if (pool != NULL &&
+		    fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_STARTUP_THREAD_SAFE) != NULL)
+			continue;
+		fu_plugin_runner_startup (plugin, &helpers[i].error);
+	}
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+}
+
 static void
 fu_engine_plugins_setup (FuEngine *self)
 {
 	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	guint idx_start = 0;
+	g_autofree FuEngineStartupHelper *helpers = NULL;
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "startup");
+
+	/* the list is already sorted by order */
+	helpers = g_new0 (FuEngineStartupHelper, plugins->len);
+	for (guint i = 0; i < plugins->len; i++)
+		helpers[i].plugin = g_ptr_array_index (plugins, i);
+	for (guint i = 1; i <= plugins->len; i++) {
+		if (i < plugins->len &&
+		    fu_plugin_get_order (helpers[i].plugin) ==
+		    fu_plugin_get_order (helpers[idx_start].plugin))
+			continue;
+		fu_engine_plugins_setup_order (self, helpers, idx_start, i);
+		idx_start = i;
+	}
+
+	/* only modify the plugin list from the main thread */
 	for (guint i = 0; i < plugins->len; i++) {
-		g_autoptr(GError) error = NULL;
-		FuPlugin *plugin = g_ptr_array_index (plugins, i);
-		if (!fu_plugin_runner_startup (plugin, &error)) {
+		g_autoptr(GError) error = helpers[i].error;
+		if (error == NULL)
+			continue;
+		fu_plugin_set_enabled (helpers[i].plugin, FALSE);
+		g_message ("disabling plugin because: %s", error->message);
+	}
+}
+
+typedef enum {
+	FU_ENGINE_COLDPLUG_ACTION_ADDED,
+	FU_ENGINE_COLDPLUG_ACTION_REMOVED,
+	FU_ENGINE_COLDPLUG_ACTION_REGISTER,
+} FuEngineColdplugAction;
+
+typedef struct {
+	FuEngineColdplugAction	 action;
+	FuPlugin		*plugin;
+	FuDevice		*device;
+} FuEngineColdplugItem;
+
+typedef struct {
+	FuPlugin		*plugin;
+	gdouble			 elapsed;	/* ms */
+} FuEngineColdplugTiming;
+
+static void
+fu_engine_coldplug_item_free (FuEngineColdplugItem *item)
+{
+	g_object_unref (item->plugin);
+	g_object_unref (item->device);
+	g_free (item);
+}
+
+/* devices added from a worker thread are processed later on the main thread */
+static gboolean
+fu_engine_coldplug_queue_push (FuEngine *self,
+			       FuEngineColdplugAction action,
+			       FuPlugin *plugin,
+			       FuDevice *device)
+{
+	FuEngineColdplugItem *item;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&self->coldplug_mutex);
+
+	if (self->coldplug_queue == NULL)
+		return FALSE;
+	if (g_thread_self () == self->main_thread)
+		return FALSE;
+	item = g_new0 (FuEngineColdplugItem, 1);
+	item->action = action;
+	item->plugin = g_object_ref (plugin);
+	item->device = g_object_ref (device);
+	g_ptr_array_add (self->coldplug_queue, item);
+	return TRUE;
+}
+
+static void
+fu_engine_plugin_coldplug (FuPlugin *plugin,
+			   gboolean is_recoldplug,
+			   FuEngineColdplugTiming *timing)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	timing->plugin = plugin;
+	if (is_recoldplug) {
+		if (!fu_plugin_runner_recoldplug (plugin, &error))
+			g_message ("failed recoldplug: %s", error->message);
+	} else {
+		if (!fu_plugin_runner_coldplug (plugin, &error)) {
 			fu_plugin_set_enabled (plugin, FALSE);
-			g_message ("disabling plugin because: %s", error->message);
+			g_message ("disabling plugin because: %s",
+				   error->message);
 		}
 	}
+	timing->elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+}
+
+static void
+fu_engine_plugin_coldplug_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineColdplugTiming *timing = (FuEngineColdplugTiming *) data;
+	gboolean *is_recoldplug = (gboolean *) user_data;
+	fu_engine_plugin_coldplug (timing->plugin, *is_recoldplug, timing);
+}
+
+static gint
+fu_engine_coldplug_timing_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const FuEngineColdplugTiming *timing1 = a;
+	const FuEngineColdplugTiming *timing2 = b;
+	if (timing1->elapsed < timing2->elapsed)
+		return 1;
+	if (timing1->elapsed > timing2->elapsed)
+		return -1;
+	return 0;
+}
+
+static void
+fu_engine_coldplug_queue_drain (FuEngine *self)
+{
+	g_autoptr(GPtrArray) queue = NULL;
+
+	/* no more items can be added */
+	g_mutex_lock (&self->coldplug_mutex);
+	queue = g_steal_pointer (&self->coldplug_queue);
+	g_mutex_unlock (&self->coldplug_mutex);
+
+	for (guint i = 0; i < queue->len; i++) {
+		FuEngineColdplugItem *item = g_ptr_array_index (queue, i);
+		if (item->action == FU_ENGINE_COLDPLUG_ACTION_ADDED)
+			g_signal_emit_by_name (item->plugin, "device-added", item->device);
+		else if (item->action == FU_ENGINE_COLDPLUG_ACTION_REMOVED)
+			g_signal_emit_by_name (item->plugin, "device-removed", item->device);
+		else if (item->action == FU_ENGINE_COLDPLUG_ACTION_REGISTER)
+			g_signal_emit_by_name (item->plugin, "device-register", item->device);
+	}
 }
 
 static void
 fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 {
 	GPtrArray *plugins;
+	GThreadPool *pool = NULL;
+	g_autofree FuEngineColdplugTiming *timings = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
 	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	span = fu_trace_span_new ("engine", is_recoldplug ? "recoldplug" : "coldplug");
 
 	/* don't allow coldplug to be scheduled when in coldplug */
 	self->coldplug_running = TRUE;
@@ -4795,20 +7678,51 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 		g_usleep (self->coldplug_delay * 1000);
 	}
 
-	/* exec */
+	/* run any thread-safe plugins in a bounded worker pool */
+	timings = g_new0 (FuEngineColdplugTiming, plugins->len);
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
-		if (is_recoldplug) {
-			if (!fu_plugin_runner_recoldplug (plugin, &error))
-				g_message ("failed recoldplug: %s", error->message);
-		} else {
-			if (!fu_plugin_runner_coldplug (plugin, &error)) {
-				fu_plugin_set_enabled (plugin, FALSE);
-				g_message ("disabling plugin because: %s",
+		timings[i].plugin = plugin;
+		if (!fu_plugin_get_enabled (plugin))
+			continue;
+		if (fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_COLDPLUG_THREAD_SAFE) == NULL)
+			continue;
+		if (pool == NULL) {
+			self->coldplug_queue = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_coldplug_item_free);
+			pool = g_thread_pool_new (fu_engine_plugin_coldplug_thread_cb,
+						  &is_recoldplug,
+						  (gint) g_get_num_processors (),
+						  FALSE, &error);
+			if (pool == NULL) {
+				g_warning ("failed to create coldplug pool: %s",
 					   error->message);
+				g_clear_pointer (&self->coldplug_queue, g_ptr_array_unref);
+				break;
 			}
 		}
+		g_debug ("scheduling threaded coldplug of %s",
+			 fu_plugin_get_name (plugin));
+		if (!g_thread_pool_push (pool, &timings[i], &error)) {
+			g_warning ("failed to schedule coldplug: %s",
+				   error->message);
+			continue;
+		}
+	}
+
+	/* exec everything else on the main thread at the same time */
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		if (pool != NULL &&
+		    fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_COLDPLUG_THREAD_SAFE) != NULL)
+			continue;
+		fu_engine_plugin_coldplug (plugin, is_recoldplug, &timings[i]);
+	}
+
+	/* wait for the workers, then add what they found */
+	if (pool != NULL) {
+		g_thread_pool_free (pool, FALSE, TRUE);
+		fu_engine_coldplug_queue_drain (self);
 	}
 
 	/* cleanup */
@@ -4819,6 +7733,17 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 			g_warning ("failed to cleanup coldplug: %s", error->message);
 	}
 
+	/* show the slowest plugins first */
+	g_qsort_with_data (timings, plugins->len, sizeof (FuEngineColdplugTiming),
+			   fu_engine_coldplug_timing_sort_cb, NULL);
+	for (guint i = 0; i < plugins->len; i++) {
+		if (timings[i].elapsed < 1.f)
+			break;
+		g_debug ("coldplug of %s took %.1fms",
+			 fu_plugin_get_name (timings[i].plugin),
+			 timings[i].elapsed);
+	}
+
 	/* print what we do have */
 	for (guint i = 0; i < plugins->len; i++) {
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -4833,6 +7758,35 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 
 	/* we can recoldplug from this point on */
 	self->coldplug_running = FALSE;
+	fu_metrics_histogram_observe ("fwupd_coldplug_duration_seconds",
+				      is_recoldplug ? "kind=\"recoldplug\"" : "kind=\"coldplug\"",
+				      g_timer_elapsed (timer, NULL));
+}
+
+/* use the median of the recent installs rather than the estimate */
+static void
+fu_engine_ensure_install_duration (FuEngine *self, FuDevice *device)
+{
+	FuHistoryDurations durations = { 0 };
+	guint64 total;
+	g_autoptr(GError) error_local = NULL;
+
+	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+		return;
+	if (fu_device_get_plugin (device) == NULL ||
+	    fu_device_get_guid_default (device) == NULL)
+		return;
+	if (!fu_history_get_durations (self->history,
+				       fu_device_get_plugin (device),
+				       fu_device_get_guid_default (device),
+				       &durations,
+				       &error_local)) {
+		if (!g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND))
+			g_debug ("no install durations: %s", error_local->message);
+		return;
+	}
+	total = durations.detach + durations.write + durations.attach + durations.verify;
+	fu_device_set_install_duration (device, MAX ((total + 999) / 1000, 1));
 }
 
 static void
@@ -4858,9 +7812,15 @@ fu_engine_plugin_device_register_cb (FuPlugin *plugin,
 				    gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
+	if (fu_engine_coldplug_queue_push (self, FU_ENGINE_COLDPLUG_ACTION_REGISTER,
+					   plugin, device))
+		return;
 	fu_engine_plugin_device_register (self, device);
 }
 
+static void fu_engine_hotplug_batch_push	(FuEngine	*self,
+						 FuDevice	*device);
+
 static void
 fu_engine_plugin_device_added_cb (FuPlugin *plugin,
 				  FuDevice *device,
@@ -4868,6 +7828,11 @@ fu_engine_plugin_device_added_cb (FuPlugin *plugin,
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
+	/* added from a coldplug worker thread */
+	if (fu_engine_coldplug_queue_push (self, FU_ENGINE_COLDPLUG_ACTION_ADDED,
+					   plugin, device))
+		return;
+
 	/* plugin has prio and device not already set from quirk */
 	if (fu_plugin_get_priority (plugin) > 0 &&
 	    fu_device_get_priority (device) == 0) {
@@ -4877,14 +7842,19 @@ fu_engine_plugin_device_added_cb (FuPlugin *plugin,
 		fu_device_set_priority (device, fu_plugin_get_priority (plugin));
 	}
 
+	/* devices arriving together, e.g. from a dock, are processed together */
+	if (self->loaded) {
+		fu_engine_hotplug_batch_push (self, device);
+		return;
+	}
 	fu_engine_add_device (self, device);
 }
 
+/* @devices is the list of active devices, which is only built once per batch */
 static void
-fu_engine_adopt_children (FuEngine *self, FuDevice *device)
+fu_engine_adopt_children (FuEngine *self, FuDevice *device, GPtrArray *devices)
 {
 	GPtrArray *guids;
-	g_autoptr(GPtrArray) devices = fu_device_list_get_active (self->device_list);
 
 	/* find the parent GUID in any existing device */
 	guids = fu_device_get_parent_guids (device);
@@ -4974,15 +7944,22 @@ fu_engine_set_proxy_device (FuEngine *self, FuDevice *device)
 		   fu_device_get_proxy_guid (device));
 }
 
+/* if @history is NULL then the database is queried for just this device */
 static void
-fu_engine_device_inherit_history (FuEngine *self, FuDevice *device)
+fu_engine_device_inherit_history (FuEngine *self, FuDevice *device, GHashTable *history)
 {
 	g_autoptr(FuDevice) device_history = NULL;
 
 	/* any success or failed update? */
-	device_history = fu_history_get_device_by_id (self->history,
-						      fu_device_get_id (device),
-						      NULL);
+	if (history != NULL) {
+		FuDevice *device_tmp = g_hash_table_lookup (history, fu_device_get_id (device));
+		if (device_tmp != NULL)
+			device_history = g_object_ref (device_tmp);
+	} else {
+		device_history = fu_history_get_device_by_id (self->history,
+							      fu_device_get_id (device),
+							      NULL);
+	}
 	if (device_history == NULL)
 		return;
 
@@ -5003,8 +7980,12 @@ fu_engine_device_inherit_history (FuEngine *self, FuDevice *device)
 	}
 }
 
-void
-fu_engine_add_device (FuEngine *self, FuDevice *device)
+/* returns %TRUE if the device was added to the device list */
+static gboolean
+fu_engine_add_device_internal (FuEngine *self,
+			       FuDevice *device,
+			       GPtrArray *devices,
+			       GHashTable *history)
 {
 	GPtrArray *disabled_devices;
 	GPtrArray *device_guids;
@@ -5016,7 +7997,7 @@ fu_engine_add_device (FuEngine *self, FuDevice *device)
 		g_warning ("no GUIDs for device %s [%s]",
 			   fu_device_get_name (device),
 			   fu_device_get_id (device));
-		return;
+		return FALSE;
 	}
 
 	/* is this GUID disabled */
@@ -5031,7 +8012,7 @@ fu_engine_add_device (FuEngine *self, FuDevice *device)
 					 fu_device_get_id (device),
 					 device_guid,
 					 fu_device_get_plugin (device));
-				return;
+				return FALSE;
 			}
 		}
 	}
@@ -5071,7 +8052,7 @@ fu_engine_add_device (FuEngine *self, FuDevice *device)
 	}
 
 	/* adopt any required children, which may or may not already exist */
-	fu_engine_adopt_children (self, device);
+	fu_engine_adopt_children (self, device, devices);
 
 	/* set the proxy device if specified by GUID */
 	fu_engine_set_proxy_device (self, device);
@@ -5103,6 +8084,9 @@ fu_engine_add_device (FuEngine *self, FuDevice *device)
 	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_REGISTERED))
 		fu_engine_plugin_device_register (self, device);
 
+	/* measured on this machine */
+	fu_engine_ensure_install_duration (self, device);
+
 	/* does the device *still* not have a vendor ID? */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE) &&
 	    fu_device_get_vendor_id (device) == NULL) {
@@ -5113,6 +8097,7 @@ fu_engine_add_device (FuEngine *self, FuDevice *device)
 
 	/* create new device */
 	fu_device_list_add (self->device_list, device);
+	g_ptr_array_add (devices, g_object_ref (device));
 
 	/* fixup the name and format as needed from cached metadata */
 	if (component != NULL)
@@ -5122,11 +8107,131 @@ fu_engine_add_device (FuEngine *self, FuDevice *device)
 	fu_engine_ensure_device_supported (self, device);
 
 	/* sometimes inherit flags from recent history */
-	fu_engine_device_inherit_history (self, device);
+	fu_engine_device_inherit_history (self, device, history);
+	return TRUE;
+}
+
+static void
+fu_engine_add_devices_done (FuEngine *self, gboolean any_updatable)
+{
+	/* new upgrades may now be available */
+	if (any_updatable)
+		fu_engine_schedule_idle_tasks (self);
+
+	/* plugins may derive attributes from other devices */
+	fu_engine_invalidate_security_attrs (self, NULL);
 
 	fu_engine_emit_changed (self);
 }
 
+void
+fu_engine_add_device (FuEngine *self, FuDevice *device)
+{
+	g_autoptr(GPtrArray) devices = fu_device_list_get_active (self->device_list);
+	if (!fu_engine_add_device_internal (self, device, devices, NULL))
+		return;
+	fu_engine_add_devices_done (self, fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE));
+}
+
+/* one query rather than one for each device, keeping the newest entry */
+static GHashTable *
+fu_engine_get_history_by_device_id (FuEngine *self)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GHashTable) history = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	devices = fu_history_get_devices (self->history, &error_local);
+	if (devices == NULL) {
+		g_debug ("failed to get history: %s", error_local->message);
+		return NULL;
+	}
+	history = g_hash_table_new_full (g_str_hash, g_str_equal,
+					 NULL, (GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		FuDevice *device_old = g_hash_table_lookup (history, fu_device_get_id (device));
+		if (device_old != NULL &&
+		    fu_device_get_created (device_old) > fu_device_get_created (device))
+			continue;
+		g_hash_table_replace (history,
+				      (gpointer) fu_device_get_id (device),
+				      g_object_ref (device));
+	}
+	return g_steal_pointer (&history);
+}
+
+static void
+fu_engine_hotplug_batch_flush (FuEngine *self)
+{
+	gboolean any_updatable = FALSE;
+	guint added = 0;
+	g_autoptr(GHashTable) history = NULL;
+	g_autoptr(GPtrArray) batch = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	if (self->hotplug_batch_id != 0) {
+		g_source_remove (self->hotplug_batch_id);
+		self->hotplug_batch_id = 0;
+	}
+	if (self->hotplug_batch->len == 0)
+		return;
+	batch = g_steal_pointer (&self->hotplug_batch);
+	self->hotplug_batch = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_debug ("processing %u hotplugged devices", batch->len);
+
+	/* build the lookups once for the whole batch */
+	devices = fu_device_list_get_active (self->device_list);
+	if ((self->load_flags & FU_ENGINE_LOAD_FLAG_NO_HISTORY) == 0)
+		history = fu_engine_get_history_by_device_id (self);
+	for (guint i = 0; i < batch->len; i++) {
+		FuDevice *device = g_ptr_array_index (batch, i);
+		if (!fu_engine_add_device_internal (self, device, devices, history))
+			continue;
+		if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE))
+			any_updatable = TRUE;
+		added++;
+	}
+	if (added > 0)
+		fu_engine_add_devices_done (self, any_updatable);
+}
+
+static gboolean
+fu_engine_hotplug_batch_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	self->hotplug_batch_id = 0;
+	fu_engine_hotplug_batch_flush (self);
+	return G_SOURCE_REMOVE;
+}
+
+/* returns %TRUE if a device with the same ID was waiting to be added */
+static gboolean
+fu_engine_hotplug_batch_remove (FuEngine *self, FuDevice *device)
+{
+	for (guint i = 0; i < self->hotplug_batch->len; i++) {
+		FuDevice *device_tmp = g_ptr_array_index (self->hotplug_batch, i);
+		if (g_strcmp0 (fu_device_get_id (device_tmp), fu_device_get_id (device)) == 0) {
+			g_ptr_array_remove_index (self->hotplug_batch, i);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void
+fu_engine_hotplug_batch_push (FuEngine *self, FuDevice *device)
+{
+	/* the newest object wins if the device was re-added */
+	fu_engine_hotplug_batch_remove (self, device);
+	g_ptr_array_add (self->hotplug_batch, g_object_ref (device));
+	if (self->hotplug_batch_id == 0) {
+		self->hotplug_batch_id = g_timeout_add (FU_ENGINE_HOTPLUG_BATCH_DELAY,
+							fu_engine_hotplug_batch_cb,
+							self);
+	}
+}
+
 static void
 fu_engine_plugin_add_firmware_gtype_cb (FuPlugin *plugin,
 					const gchar *id,
@@ -5155,8 +8260,8 @@ fu_engine_plugin_security_changed_cb (FuPlugin *plugin, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
-	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	/* invalidate host security attributes from only this plugin */
+	fu_engine_invalidate_security_attrs (self, plugin);
 
 	/* make UI refresh */
 	fu_engine_emit_changed (self);
@@ -5172,6 +8277,15 @@ fu_engine_plugin_device_removed_cb (FuPlugin *plugin,
 	g_autoptr(FuDevice) device_tmp = NULL;
 	g_autoptr(GError) error = NULL;
 
+	/* removed from a coldplug worker thread */
+	if (fu_engine_coldplug_queue_push (self, FU_ENGINE_COLDPLUG_ACTION_REMOVED,
+					   plugin, device))
+		return;
+
+	/* never got as far as the device list */
+	if (fu_engine_hotplug_batch_remove (self, device))
+		g_debug ("%s removed before being added", fu_device_get_id (device));
+
 	device_tmp = fu_device_list_get_by_id (self->device_list,
 					       fu_device_get_id (device),
 					       &error);
@@ -5197,6 +8311,9 @@ fu_engine_plugin_device_removed_cb (FuPlugin *plugin,
 		return;
 	}
 
+	/* plugins may derive attributes from other devices */
+	fu_engine_invalidate_security_attrs (self, NULL);
+
 	/* make the UI update */
 	fu_device_list_remove (self->device_list, device);
 	fu_engine_emit_changed (self);
@@ -5244,6 +8361,8 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 
 		plugin = fu_plugin_list_find_by_name (self->plugin_list,
 						      plugin_name, &error);
+		if (plugin == NULL)
+			plugin = fu_engine_load_plugin_on_demand (self, plugin_name);
 		if (plugin == NULL) {
 			g_debug ("failed to find specified plugin %s: %s",
 				 plugin_name, error->message);
@@ -5295,6 +8414,7 @@ typedef struct {
 	FuEngine	*self;
 	GUdevDevice	*udev_device;
 	guint		 idle_id;
+	guint		 events;
 } FuEngineUdevChangedHelper;
 
 static void
@@ -5313,6 +8433,7 @@ fu_engine_udev_changed_helper_new (FuEngine *self, GUdevDevice *udev_device)
 	FuEngineUdevChangedHelper *helper = g_new0 (FuEngineUdevChangedHelper, 1);
 	helper->self = g_object_ref (self);
 	helper->udev_device = g_object_ref (udev_device);
+	helper->events = 1;
 	return helper;
 }
 
@@ -5321,9 +8442,22 @@ fu_engine_udev_changed_cb (gpointer user_data)
 {
 	FuEngineUdevChangedHelper *helper = (FuEngineUdevChangedHelper *) user_data;
 	GPtrArray *plugins = fu_plugin_list_get_all (helper->self->plugin_list);
-	g_autoptr(FuUdevDevice) device = fu_udev_device_new (helper->udev_device);
+	g_autoptr(FuUdevDevice) device = NULL;
 
+	/* try again later if devices are being installed in threads */
+	g_mutex_lock (&helper->self->install_mutex);
+	if (helper->self->install_devices != NULL) {
+		g_mutex_unlock (&helper->self->install_mutex);
+		return G_SOURCE_CONTINUE;
+	}
+	g_mutex_unlock (&helper->self->install_mutex);
+
+	device = fu_udev_device_new (helper->udev_device);
 	/* run all plugins */
+	g_debug ("processing %u change events for %s, %u merged in total",
+		 helper->events,
+		 g_udev_device_get_sysfs_path (helper->udev_device),
+		 helper->self->udev_changed_merged);
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
 		g_autoptr(GError) error = NULL;
@@ -5352,6 +8486,7 @@ static void
 fu_engine_udev_device_changed (FuEngine *self, GUdevDevice *udev_device)
 {
 	const gchar *sysfs_path = g_udev_device_get_sysfs_path (udev_device);
+	guint timeout;
 	g_autoptr(GPtrArray) devices = NULL;
 	FuEngineUdevChangedHelper *helper;
 
@@ -5368,14 +8503,20 @@ fu_engine_udev_device_changed (FuEngine *self, GUdevDevice *udev_device)
 	}
 
 	/* run all plugins, with per-device rate limiting */
-	if (g_hash_table_remove (self->udev_changed_ids, sysfs_path)) {
-		g_debug ("re-adding rate-limited timeout for %s", sysfs_path);
+	timeout = fu_config_get_udev_change_debounce (self->config);
+	helper = g_hash_table_lookup (self->udev_changed_ids, sysfs_path);
+	if (helper != NULL) {
+		g_debug ("merging change event for %s", sysfs_path);
+		g_source_remove (helper->idle_id);
+		g_set_object (&helper->udev_device, udev_device);
+		helper->events++;
+		self->udev_changed_merged++;
 	} else {
 		g_debug ("adding rate-limited timeout for %s", sysfs_path);
+		helper = fu_engine_udev_changed_helper_new (self, udev_device);
+		g_hash_table_insert (self->udev_changed_ids, g_strdup (sysfs_path), helper);
 	}
-	helper = fu_engine_udev_changed_helper_new (self, udev_device);
-	helper->idle_id = g_timeout_add (500, fu_engine_udev_changed_cb, helper);
-	g_hash_table_insert (self->udev_changed_ids, g_strdup (sysfs_path), helper);
+	helper->idle_id = g_timeout_add (timeout, fu_engine_udev_changed_cb, helper);
 }
 
 static void
@@ -5489,17 +8630,14 @@ fu_engine_add_plugin_filter (FuEngine *self, const gchar *plugin_glob)
 static gboolean
 fu_engine_plugin_check_supported_cb (FuPlugin *plugin, const gchar *guid, FuEngine *self)
 {
-	g_autoptr(XbNode) n = NULL;
-	g_autofree gchar *xpath = NULL;
-
 	if (fu_config_get_enumerate_all_devices (self->config))
 		return TRUE;
-
-	xpath = g_strdup_printf ("components/component/"
-				 "provides/firmware[@type='flashed'][text()='%s']",
-				 guid);
-	n = xb_silo_query_first (self->silo, xpath, NULL);
-	return n != NULL;
+	for (guint i = 0; i < self->shards->len; i++) {
+		FuEngineShard *shard = g_ptr_array_index (self->shards, i);
+		if (fu_engine_shard_get_components_by_guid (self, shard, guid) != NULL)
+			return TRUE;
+	}
+	return FALSE;
 }
 
 gboolean
@@ -5637,9 +8775,22 @@ fu_engine_ensure_security_attrs_supported (FuEngine *self)
 static void
 fu_engine_ensure_security_attrs (FuEngine *self)
 {
+	GHashTableIter iter;
 	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	gpointer value;
+	gint64 now = g_get_monotonic_time ();
 	g_autoptr(GPtrArray) items = NULL;
 
+	/* expire any plugin results that are too old */
+	g_hash_table_iter_init (&iter, self->security_attrs_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FuEngineSecurityAttrsCacheItem *item = (FuEngineSecurityAttrsCacheItem *) value;
+		if (now - item->created > FU_ENGINE_SECURITY_ATTRS_TTL * G_USEC_PER_SEC) {
+			g_hash_table_iter_remove (&iter);
+			g_clear_pointer (&self->host_security_id, g_free);
+		}
+	}
+
 	/* already valid */
 	if (self->host_security_id != NULL)
 		return;
@@ -5651,16 +8802,39 @@ fu_engine_ensure_security_attrs (FuEngine *self)
 	fu_engine_ensure_security_attrs_tainted (self);
 	fu_engine_ensure_security_attrs_supported (self);
 
-	/* call into plugins */
+	/* call into plugins, but only if not already cached */
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
-		fu_plugin_runner_add_security_attrs (plugin_tmp, self->host_security_attrs);
+		FuEngineSecurityAttrsCacheItem *item;
+		g_autoptr(GPtrArray) attrs_tmp = NULL;
+
+		item = g_hash_table_lookup (self->security_attrs_cache,
+					    fu_plugin_get_name (plugin_tmp));
+		if (item == NULL) {
+			item = g_new0 (FuEngineSecurityAttrsCacheItem, 1);
+			item->attrs = fu_security_attrs_new ();
+			item->created = now;
+			fu_plugin_runner_add_security_attrs (plugin_tmp, item->attrs);
+			g_hash_table_insert (self->security_attrs_cache,
+					     g_strdup (fu_plugin_get_name (plugin_tmp)),
+					     item);
+		}
+		attrs_tmp = fu_security_attrs_get_all (item->attrs);
+		for (guint i = 0; i < attrs_tmp->len; i++) {
+			FwupdSecurityAttr *attr = g_ptr_array_index (attrs_tmp, i);
+			fu_security_attrs_append (self->host_security_attrs, attr);
+		}
 	}
 
 	/* set the fallback names for clients without native translations */
 	items = fu_security_attrs_get_all (self->host_security_attrs);
 	for (guint i = 0; i < items->len; i++) {
 		FwupdSecurityAttr *attr = g_ptr_array_index (items, i);
+
+		/* the obsoleting attribute may have changed since last time */
+		fwupd_security_attr_set_flags (attr,
+					       fwupd_security_attr_get_flags (attr) &
+					       ~FWUPD_SECURITY_ATTR_FLAG_OBSOLETED);
 		if (fwupd_security_attr_get_name (attr) == NULL) {
 			g_autofree gchar *name_tmp = fu_security_attr_get_name (attr);
 			if (name_tmp == NULL) {
@@ -5697,6 +8871,157 @@ fu_engine_get_host_security_attrs (FuEngine *self)
 	return g_object_ref (self->host_security_attrs);
 }
 
+/* returns FALSE if the plugin should not be loaded on this machine */
+static gboolean
+fu_engine_load_plugin_manifest (FuEngine *self,
+				const gchar *plugin_path,
+				const gchar *name,
+				gboolean *load_on_demand)
+{
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+	g_auto(GStrv) hwids = NULL;
+
+	/* optional */
+	fn = g_strdup_printf ("%s/%s.manifest", plugin_path, name);
+	if (!g_file_test (fn, G_FILE_TEST_EXISTS))
+		return TRUE;
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, &error_local)) {
+		g_warning ("failed to load %s: %s", fn, error_local->message);
+		return TRUE;
+	}
+
+	/* only useful when a specific HWID is present */
+	hwids = g_key_file_get_string_list (kf, "fwupd Plugin", "Hwids", NULL, NULL);
+	if (hwids != NULL) {
+		gboolean matched = FALSE;
+		for (guint i = 0; hwids[i] != NULL; i++) {
+			if (fu_hwids_has_guid (self->hwids, hwids[i])) {
+				matched = TRUE;
+				break;
+			}
+		}
+		if (!matched) {
+			g_debug ("plugin %s has no matching HWID", name);
+			return FALSE;
+		}
+	}
+
+	/* only opened when a device asks for it using a quirk */
+	*load_on_demand = g_key_file_get_boolean (kf, "fwupd Plugin",
+						  "LoadOnDemand", NULL);
+	return TRUE;
+}
+
+/* returns NULL with FWUPD_ERROR_NOT_SUPPORTED if the plugin disabled itself */
+static FuPlugin *
+fu_engine_load_plugin (FuEngine *self,
+		       const gchar *name,
+		       const gchar *filename,
+		       GError **error)
+{
+	g_autoptr(FuPlugin) plugin = NULL;
+
+	plugin = fu_plugin_new ();
+	fu_plugin_set_name (plugin, name);
+	fu_plugin_set_usb_context (plugin, self->usb_ctx);
+	fu_plugin_set_hwids (plugin, self->hwids);
+	fu_plugin_set_smbios (plugin, self->smbios);
+	fu_plugin_set_udev_subsystems (plugin, self->udev_subsystems);
+	fu_plugin_set_quirks (plugin, self->quirks);
+	fu_plugin_set_file_watch (plugin, self->file_watch);
+	fu_plugin_set_esrt (plugin, self->esrt);
+	fu_plugin_set_runtime_versions (plugin, self->runtime_versions);
+	fu_plugin_set_compile_versions (plugin, self->compile_versions);
+	g_signal_connect (plugin, "add-firmware-gtype",
+			  G_CALLBACK (fu_engine_plugin_add_firmware_gtype_cb),
+			  self);
+	g_debug ("adding plugin %s", filename);
+
+	/* if loaded from fu_engine_load() open the plugin */
+	if (self->usb_ctx != NULL) {
+		if (!fu_plugin_open (plugin, filename, error))
+			return NULL;
+	}
+
+	/* self disabled */
+	if (!fu_plugin_get_enabled (plugin)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "%s self disabled",
+			     fu_plugin_get_name (plugin));
+		return NULL;
+	}
+
+	/* watch for changes */
+	g_signal_connect (plugin, "device-added",
+			  G_CALLBACK (fu_engine_plugin_device_added_cb),
+			  self);
+	g_signal_connect (plugin, "device-removed",
+			  G_CALLBACK (fu_engine_plugin_device_removed_cb),
+			  self);
+	g_signal_connect (plugin, "device-register",
+			  G_CALLBACK (fu_engine_plugin_device_register_cb),
+			  self);
+	g_signal_connect (plugin, "recoldplug",
+			  G_CALLBACK (fu_engine_plugin_recoldplug_cb),
+			  self);
+	g_signal_connect (plugin, "set-coldplug-delay",
+			  G_CALLBACK (fu_engine_plugin_set_coldplug_delay_cb),
+			  self);
+	g_signal_connect (plugin, "check-supported",
+			  G_CALLBACK (fu_engine_plugin_check_supported_cb),
+			  self);
+	g_signal_connect (plugin, "rules-changed",
+			  G_CALLBACK (fu_engine_plugin_rules_changed_cb),
+			  self);
+	g_signal_connect (plugin, "security-changed",
+			  G_CALLBACK (fu_engine_plugin_security_changed_cb),
+			  self);
+
+	/* add */
+	fu_engine_add_plugin (self, plugin);
+	return g_steal_pointer (&plugin);
+}
+
+/* called when a device asks for a plugin that was not loaded at startup */
+static FuPlugin *
+fu_engine_load_plugin_on_demand (FuEngine *self, const gchar *name)
+{
+	const gchar *filename;
+	g_autoptr(FuPlugin) plugin = NULL;
+	g_autoptr(FuTraceSpan) span = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	filename = g_hash_table_lookup (self->plugins_deferred, name);
+	if (filename == NULL)
+		return NULL;
+	span = fu_trace_span_new ("engine", "load-on-demand:%s", name);
+	plugin = fu_engine_load_plugin (self, name, filename, &error_local);
+	g_hash_table_remove (self->plugins_deferred, name);
+	if (plugin == NULL) {
+		g_debug ("failed to load plugin %s on demand: %s",
+			 name, error_local->message);
+		return NULL;
+	}
+	if (!fu_plugin_list_depsolve (self->plugin_list, &error_local)) {
+		g_warning ("failed to depsolve: %s", error_local->message);
+		return NULL;
+	}
+	if (!fu_plugin_runner_startup (plugin, &error_local)) {
+		fu_plugin_set_enabled (plugin, FALSE);
+		g_message ("disabling plugin because: %s", error_local->message);
+		return NULL;
+	}
+	if (!fu_plugin_runner_coldplug (plugin, &error_local)) {
+		g_warning ("failed to coldplug %s: %s", name, error_local->message);
+		return NULL;
+	}
+	return g_steal_pointer (&plugin);
+}
+
 gboolean
 fu_engine_load_plugins (FuEngine *self, GError **error)
 {
@@ -5705,12 +9030,20 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 	g_autofree gchar *plugin_path = NULL;
 	g_autofree gchar *suffix = g_strdup_printf (".%s", G_MODULE_SUFFIX);
 
+	/* only the plugins that were asked for */
+	if ((self->load_flags & FU_ENGINE_LOAD_FLAG_NO_PLUGINS) &&
+	    self->plugin_filter->len == 0) {
+		g_debug ("not loading any plugins");
+		return TRUE;
+	}
+
 	/* search */
 	plugin_path = fu_common_get_path (FU_PATH_KIND_PLUGINDIR_PKG);
 	dir = g_dir_open (plugin_path, 0, error);
 	if (dir == NULL)
 		return FALSE;
 	while ((fn = g_dir_read_name (dir)) != NULL) {
+		gboolean load_on_demand = FALSE;
 		g_autofree gchar *filename = NULL;
 		g_autofree gchar *name = NULL;
 		g_autoptr(FuPlugin) plugin = NULL;
@@ -5732,66 +9065,34 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 			g_debug ("plugin %s is not enabled", name);
 			continue;
 		}
-
-		/* open module */
 		filename = g_build_filename (plugin_path, fn, NULL);
-		plugin = fu_plugin_new ();
-		fu_plugin_set_name (plugin, name);
-		fu_plugin_set_usb_context (plugin, self->usb_ctx);
-		fu_plugin_set_hwids (plugin, self->hwids);
-		fu_plugin_set_smbios (plugin, self->smbios);
-		fu_plugin_set_udev_subsystems (plugin, self->udev_subsystems);
-		fu_plugin_set_quirks (plugin, self->quirks);
-		fu_plugin_set_runtime_versions (plugin, self->runtime_versions);
-		fu_plugin_set_compile_versions (plugin, self->compile_versions);
-		g_signal_connect (plugin, "add-firmware-gtype",
-				  G_CALLBACK (fu_engine_plugin_add_firmware_gtype_cb),
-				  self);
-		g_debug ("adding plugin %s", filename);
-
-		/* if loaded from fu_engine_load() open the plugin */
+
+		/* only when loaded from fu_engine_load() */
 		if (self->usb_ctx != NULL) {
-			if (!fu_plugin_open (plugin, filename, &error_local)) {
-				g_warning ("%s", error_local->message);
+			if (!fu_engine_load_plugin_manifest (self, plugin_path,
+							     name, &load_on_demand))
+				continue;
+			if (load_on_demand) {
+				g_debug ("deferring plugin %s until required", name);
+				g_hash_table_insert (self->plugins_deferred,
+						     g_steal_pointer (&name),
+						     g_steal_pointer (&filename));
 				continue;
 			}
 		}
 
-		/* self disabled */
-		if (!fu_plugin_get_enabled (plugin)) {
-			g_debug ("%s self disabled",
-				 fu_plugin_get_name (plugin));
+		/* open module */
+		plugin = fu_engine_load_plugin (self, name, filename, &error_local);
+		if (plugin == NULL) {
+			if (g_error_matches (error_local,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOT_SUPPORTED)) {
+				g_debug ("%s", error_local->message);
+				continue;
+			}
+			g_warning ("%s", error_local->message);
 			continue;
 		}
-
-		/* watch for changes */
-		g_signal_connect (plugin, "device-added",
-				  G_CALLBACK (fu_engine_plugin_device_added_cb),
-				  self);
-		g_signal_connect (plugin, "device-removed",
-				  G_CALLBACK (fu_engine_plugin_device_removed_cb),
-				  self);
-		g_signal_connect (plugin, "device-register",
-				  G_CALLBACK (fu_engine_plugin_device_register_cb),
-				  self);
-		g_signal_connect (plugin, "recoldplug",
-				  G_CALLBACK (fu_engine_plugin_recoldplug_cb),
-				  self);
-		g_signal_connect (plugin, "set-coldplug-delay",
-				  G_CALLBACK (fu_engine_plugin_set_coldplug_delay_cb),
-				  self);
-		g_signal_connect (plugin, "check-supported",
-				  G_CALLBACK (fu_engine_plugin_check_supported_cb),
-				  self);
-		g_signal_connect (plugin, "rules-changed",
-				  G_CALLBACK (fu_engine_plugin_rules_changed_cb),
-				  self);
-		g_signal_connect (plugin, "security-changed",
-				  G_CALLBACK (fu_engine_plugin_security_changed_cb),
-				  self);
-
-		/* add */
-		fu_engine_add_plugin (self, plugin);
 	}
 
 	/* depsolve into the correct order */
@@ -5822,7 +9123,129 @@ fu_engine_cleanup_state (GError **error)
 guint64
 fu_engine_get_archive_size_max (FuEngine *self)
 {
-	return fu_config_get_archive_size_max (self->config);
+	guint64 archive_size_max = fu_config_get_archive_size_max (self->config);
+	guint64 memory_budget = fu_config_get_memory_budget (self->config);
+	if (memory_budget > 0)
+		return MIN (archive_size_max, memory_budget);
+	return archive_size_max;
+}
+
+/**
+ * fu_engine_trim_caches:
+ * @self: A #FuEngine
+ *
+ * Drops everything that can be rebuilt on demand, which is the parsed
+ * archives, the releases for each device and the host security attributes.
+ * The compiled metadata and the devices are kept, as the daemon cannot work
+ * without them.
+ **/
+void
+fu_engine_trim_caches (FuEngine *self)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_ENGINE (self));
+
+	locker = g_mutex_locker_new (&self->silo_cache_mutex);
+	g_debug ("dropping %u archives using %" G_GUINT64_FORMAT " bytes",
+		 g_queue_get_length (self->silo_cache), self->silo_cache_size);
+	fu_engine_silo_cache_trim (self, 0);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+	fu_engine_invalidate_releases_cache (self);
+	fu_engine_invalidate_security_attrs (self, NULL);
+}
+
+static guint64
+fu_engine_get_resident_size (void)
+{
+	g_autofree gchar *buf = NULL;
+	g_auto(GStrv) split = NULL;
+
+	if (!g_file_get_contents ("/proc/self/statm", &buf, NULL, NULL))
+		return 0;
+	split = g_strsplit (buf, " ", -1);
+	if (g_strv_length (split) < 2)
+		return 0;
+	return fu_common_strtoull (split[1]) * sysconf (_SC_PAGESIZE);
+}
+
+/**
+ * fu_engine_get_memory_stats:
+ * @self: A #FuEngine
+ *
+ * Gets how much memory the daemon is using, and what is held in each of the
+ * caches that fu_engine_trim_caches() can drop.
+ *
+ * Returns: a #GVariant of type `a{sv}`
+ **/
+GVariant *
+fu_engine_get_memory_stats (FuEngine *self)
+{
+	GVariantBuilder builder;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "MemoryBudget",
+			       g_variant_new_uint64 (fu_config_get_memory_budget (self->config)));
+	g_variant_builder_add (&builder, "{sv}", "ResidentSize",
+			       g_variant_new_uint64 (fu_engine_get_resident_size ()));
+	g_mutex_lock (&self->silo_cache_mutex);
+	g_variant_builder_add (&builder, "{sv}", "ArchiveCacheSize",
+			       g_variant_new_uint64 (self->silo_cache_size));
+	g_variant_builder_add (&builder, "{sv}", "ArchiveCacheItems",
+			       g_variant_new_uint32 (g_queue_get_length (self->silo_cache)));
+	g_mutex_unlock (&self->silo_cache_mutex);
+	g_variant_builder_add (&builder, "{sv}", "ArchiveCacheSizeMax",
+			       g_variant_new_uint64 (fu_engine_get_archive_cache_size_max (self)));
+	g_variant_builder_add (&builder, "{sv}", "ReleasesCacheItems",
+			       g_variant_new_uint32 (g_hash_table_size (self->releases_cache)));
+	g_variant_builder_add (&builder, "{sv}", "SecurityAttrsCacheItems",
+			       g_variant_new_uint32 (g_hash_table_size (self->security_attrs_cache)));
+	g_variant_builder_add (&builder, "{sv}", "MetadataShards",
+			       g_variant_new_uint32 (self->shards->len));
+	devices = fu_device_list_get_all (self->device_list);
+	g_variant_builder_add (&builder, "{sv}", "Devices",
+			       g_variant_new_uint32 (devices->len));
+	return g_variant_builder_end (&builder);
+}
+
+const gchar *
+fu_engine_get_metrics_socket (FuEngine *self)
+{
+	return fu_config_get_metrics_socket (self->config);
+}
+
+/**
+ * fu_engine_get_metrics:
+ * @self: A #FuEngine
+ *
+ * Gets all the daemon metrics in the OpenMetrics text format, including the
+ * counters that are maintained by other objects, such as the quirk lookups.
+ *
+ * Returns: (transfer full): a string
+ **/
+gchar *
+fu_engine_get_metrics (FuEngine *self)
+{
+	guint efivar_hits = 0;
+	guint efivar_misses = 0;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+
+	fu_metrics_counter_set ("fwupd_quirk_lookups", NULL,
+				fu_quirks_get_lookup_count (self->quirks));
+	fu_metrics_counter_set ("fwupd_cache_lookups", "cache=\"quirks\"",
+				fu_quirks_get_lookup_count (self->quirks));
+	fu_metrics_counter_set ("fwupd_cache_hits", "cache=\"quirks\"",
+				fu_quirks_get_lookup_hits (self->quirks));
+	fu_efivar_get_cache_stats (&efivar_hits, &efivar_misses);
+	fu_metrics_counter_set ("fwupd_cache_lookups", "cache=\"efivar\"",
+				efivar_hits + efivar_misses);
+	fu_metrics_counter_set ("fwupd_cache_hits", "cache=\"efivar\"",
+				efivar_hits);
+	return fu_metrics_to_string ();
 }
 
 static void
@@ -5832,6 +9255,12 @@ fu_engine_usb_device_removed_cb (GUsbContext *ctx,
 {
 	g_autoptr(GPtrArray) devices = NULL;
 
+	/* handle when the threaded install is done */
+	if (fu_engine_install_defer_hotplug (self,
+					     FU_ENGINE_HOTPLUG_EVENT_KIND_USB_REMOVED,
+					     usb_device, NULL))
+		return;
+
 	/* debug */
 	if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 		g_debug ("USB %04x:%04x removed",
@@ -5858,11 +9287,18 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 			       GUsbDevice *usb_device,
 			       FuEngine *self)
 {
-	g_autoptr(FuUsbDevice) device = fu_usb_device_new (usb_device);
+	g_autoptr(FuUsbDevice) device = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) possible_plugins = NULL;
 
+	/* handle when the threaded install is done */
+	if (fu_engine_install_defer_hotplug (self,
+					     FU_ENGINE_HOTPLUG_EVENT_KIND_USB_ADDED,
+					     usb_device, NULL))
+		return;
+
 	/* debug */
+	device = fu_usb_device_new (usb_device);
 	if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 		g_debug ("USB %04x:%04x added",
 			 g_usb_device_get_vid (usb_device),
@@ -5887,6 +9323,8 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 
 		plugin = fu_plugin_list_find_by_name (self->plugin_list,
 						      plugin_name, &error);
+		if (plugin == NULL)
+			plugin = fu_engine_load_plugin_on_demand (self, plugin_name);
 		if (plugin == NULL) {
 			g_debug ("failed to find specified plugin %s: %s",
 				 plugin_name, error->message);
@@ -5910,30 +9348,6 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 	}
 }
 
-static void
-fu_engine_load_quirks (FuEngine *self, FuQuirksLoadFlags quirks_flags)
-{
-	g_autoptr(GError) error = NULL;
-	if (!fu_quirks_load (self->quirks, quirks_flags, &error))
-		g_warning ("Failed to load quirks: %s", error->message);
-}
-
-static void
-fu_engine_load_smbios (FuEngine *self)
-{
-	g_autoptr(GError) error = NULL;
-	if (!fu_smbios_setup (self->smbios, &error))
-		g_warning ("Failed to load SMBIOS: %s", error->message);
-}
-
-static void
-fu_engine_load_hwids (FuEngine *self)
-{
-	g_autoptr(GError) error = NULL;
-	if (!fu_hwids_setup (self->hwids, self->smbios, &error))
-		g_warning ("Failed to load HWIDs: %s", error->message);
-}
-
 static gboolean
 fu_engine_update_history_device (FuEngine *self, FuDevice *dev_history, GError **error)
 {
@@ -6039,6 +9453,10 @@ fu_engine_update_history_database (FuEngine *self, GError **error)
 	devices = fu_history_get_devices (self->history, error);
 	if (devices == NULL)
 		return FALSE;
+
+	/* write all the new update-states at once */
+	if (!fu_history_start_transaction (self->history, error))
+		return FALSE;
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *dev = g_ptr_array_index (devices, i);
 		g_autoptr(GError) error_local = NULL;
@@ -6051,7 +9469,7 @@ fu_engine_update_history_database (FuEngine *self, GError **error)
 		if (!fu_engine_update_history_device (self, dev, &error_local))
 			g_warning ("%s", error_local->message);
 	}
-	return TRUE;
+	return fu_history_commit_transaction (self->history, error);
 }
 
 #ifdef HAVE_GUDEV
@@ -6061,6 +9479,12 @@ fu_engine_udev_uevent_cb (GUdevClient *gudev_client,
 			  GUdevDevice *udev_device,
 			  FuEngine *self)
 {
+	/* handle when the threaded install is done */
+	if (fu_engine_install_defer_hotplug (self,
+					     FU_ENGINE_HOTPLUG_EVENT_KIND_UDEV,
+					     udev_device, action))
+		return;
+
 	if (g_strcmp0 (action, "add") == 0) {
 		fu_engine_udev_device_add (self, udev_device);
 		return;
@@ -6076,6 +9500,39 @@ fu_engine_udev_uevent_cb (GUdevClient *gudev_client,
 }
 #endif
 
+static void
+fu_engine_install_hotplug_replay (FuEngine *self)
+{
+	g_autoptr(GPtrArray) events = NULL;
+
+	g_mutex_lock (&self->install_mutex);
+	events = g_steal_pointer (&self->install_hotplug_events);
+	self->install_hotplug_events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_hotplug_event_free);
+	g_mutex_unlock (&self->install_mutex);
+
+	if (events->len > 0)
+		g_debug ("replaying %u hotplug events", events->len);
+	for (guint i = 0; i < events->len; i++) {
+		FuEngineHotplugEvent *event = g_ptr_array_index (events, i);
+		if (event->kind == FU_ENGINE_HOTPLUG_EVENT_KIND_USB_ADDED) {
+			fu_engine_usb_device_added_cb (self->usb_ctx,
+						       G_USB_DEVICE (event->object),
+						       self);
+		} else if (event->kind == FU_ENGINE_HOTPLUG_EVENT_KIND_USB_REMOVED) {
+			fu_engine_usb_device_removed_cb (self->usb_ctx,
+							 G_USB_DEVICE (event->object),
+							 self);
+#ifdef HAVE_GUDEV
+		} else if (event->kind == FU_ENGINE_HOTPLUG_EVENT_KIND_UDEV) {
+			fu_engine_udev_uevent_cb (self->gudev_client,
+						  event->action,
+						  G_UDEV_DEVICE (event->object),
+						  self);
+#endif
+		}
+	}
+}
+
 static void
 fu_engine_ensure_client_certificate (FuEngine *self)
 {
@@ -6100,6 +9557,157 @@ fu_engine_ensure_client_certificate (FuEngine *self)
 	g_debug ("client certificate exists and working");
 }
 
+static gboolean
+fu_engine_load_quirks (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	FuQuirksLoadFlags quirks_flags = FU_QUIRKS_LOAD_FLAG_NONE;
+	g_autoptr(GError) error_local = NULL;
+
+	/* on a read-only filesystem don't care about the cache GUID */
+	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
+		quirks_flags |= FU_QUIRKS_LOAD_FLAG_READONLY_FS;
+	if (!fu_quirks_load (self->quirks, quirks_flags, &error_local))
+		g_warning ("Failed to load quirks: %s", error_local->message);
+	return TRUE;
+}
+
+static gboolean
+fu_engine_load_hwids (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	g_autoptr(GError) error_smbios = NULL;
+	g_autoptr(GError) error_hwids = NULL;
+
+	/* the HWIDs are built from the SMBIOS data */
+	if (!fu_smbios_setup (self->smbios, &error_smbios))
+		g_warning ("Failed to load SMBIOS: %s", error_smbios->message);
+	if (!fu_hwids_setup (self->hwids, self->smbios, &error_hwids))
+		g_warning ("Failed to load HWIDs: %s", error_hwids->message);
+	return TRUE;
+}
+
+static gboolean
+fu_engine_load_remotes (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	FuRemoteListLoadFlags remote_list_flags = FU_REMOTE_LIST_LOAD_FLAG_NONE;
+
+	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
+		remote_list_flags |= FU_REMOTE_LIST_LOAD_FLAG_READONLY_FS;
+	if (!fu_remote_list_load (self->remote_list, remote_list_flags, error)) {
+		g_prefix_error (error, "Failed to load remotes: ");
+		return FALSE;
+	}
+
+	/* create client certificate */
+	fu_engine_ensure_client_certificate (self);
+	return TRUE;
+}
+
+static gboolean
+fu_engine_load_approved_firmware (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	GPtrArray *checksums_config;
+	g_autoptr(GPtrArray) checksums = NULL;
+
+	/* get hardcoded approved firmware */
+	checksums_config = fu_config_get_approved_firmware (self->config);
+	for (guint i = 0; i < checksums_config->len; i++) {
+		const gchar *csum = g_ptr_array_index (checksums_config, i);
+		fu_engine_add_approved_firmware (self, csum);
+	}
+
+	/* get extra firmware saved to the database */
+	if (flags & FU_ENGINE_LOAD_FLAG_NO_HISTORY)
+		return TRUE;
+	checksums = fu_history_get_approved_firmware (self->history, error);
+	if (checksums == NULL)
+		return FALSE;
+	for (guint i = 0; i < checksums->len; i++) {
+		const gchar *csum = g_ptr_array_index (checksums, i);
+		fu_engine_add_approved_firmware (self, csum);
+	}
+	return TRUE;
+}
+
+typedef gboolean (*FuEngineLoadPhaseFunc)	(FuEngine		*self,
+						 FuEngineLoadFlags	 flags,
+						 GError			**error);
+
+typedef struct {
+	const gchar		*name;
+	FuEngineLoadPhaseFunc	 func;
+	gboolean		 thread_safe;
+	FuEngine		*self;
+	FuEngineLoadFlags	 flags;
+	gdouble			 elapsed;	/* ms */
+	GError			*error;
+} FuEngineLoadPhase;
+
+static void
+fu_engine_load_phase_run (FuEngineLoadPhase *phase)
+{
+	g_autoptr(FuTraceSpan) span = fu_trace_span_new ("engine", "load:%s", phase->name);
+	g_autoptr(GTimer) timer = g_timer_new ();
+	phase->func (phase->self, phase->flags, &phase->error);
+	phase->elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+}
+
+static void
+fu_engine_load_phase_thread_cb (gpointer data, gpointer user_data)
+{
+	fu_engine_load_phase_run ((FuEngineLoadPhase *) data);
+}
+
+/* the SMBIOS, HWIDs and quirks are independent of the remotes and history,
+ * and are mostly waiting on I/O, so load them at the same time */
+static gboolean
+fu_engine_load_phases (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	GThreadPool *pool;
+	FuEngineLoadPhase phases[] = {
+		{ "hwids",		fu_engine_load_hwids,			TRUE },
+		{ "quirks",		fu_engine_load_quirks,			TRUE },
+		{ "remotes",		fu_engine_load_remotes,			FALSE },
+		{ "approved-firmware",	fu_engine_load_approved_firmware,	FALSE },
+		{ NULL }
+	};
+	g_autoptr(GError) error_pool = NULL;
+
+	/* fall back to loading in series */
+	pool = g_thread_pool_new (fu_engine_load_phase_thread_cb, NULL,
+				  -1, FALSE, &error_pool);
+	if (pool == NULL)
+		g_warning ("failed to create load pool: %s", error_pool->message);
+	for (guint i = 0; phases[i].name != NULL; i++) {
+		phases[i].self = self;
+		phases[i].flags = flags;
+		if (pool == NULL || !phases[i].thread_safe)
+			continue;
+		if (!g_thread_pool_push (pool, &phases[i], &phases[i].error))
+			phases[i].thread_safe = FALSE;
+	}
+	for (guint i = 0; phases[i].name != NULL; i++) {
+		if (pool != NULL && phases[i].thread_safe)
+			continue;
+		fu_engine_load_phase_run (&phases[i]);
+	}
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	for (guint i = 0; phases[i].name != NULL; i++)
+		g_debug ("loading %s took %.1fms", phases[i].name, phases[i].elapsed);
+
+	/* report the first failure */
+	for (guint i = 0; phases[i].name != NULL; i++) {
+		if (phases[i].error != NULL) {
+			g_propagate_error (error, phases[i].error);
+			for (guint j = i + 1; phases[j].name != NULL; j++)
+				g_clear_error (&phases[j].error);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /**
  * fu_engine_load:
  * @self: A #FuEngine
@@ -6110,12 +9718,39 @@ fu_engine_ensure_client_certificate (FuEngine *self)
  *
  * Returns: %TRUE for success
  **/
+static gchar *
+fu_engine_get_device_snapshot_filename (void)
+{
+	g_autofree gchar *localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	return g_build_filename (localstatedir, "devices-setup.snapshot", NULL);
+}
+
+/**
+ * fu_engine_save_device_snapshot:
+ * @self: A #FuEngine
+ * @error: A #GError, or %NULL
+ *
+ * Saves the devices that opted in using fu_device_set_skip_setup_unchanged()
+ * so that they can be set up without querying the hardware on the next start.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_save_device_snapshot (FuEngine *self, GError **error)
+{
+	g_autofree gchar *filename = fu_engine_get_device_snapshot_filename ();
+	g_autoptr(GPtrArray) devices = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	devices = fu_device_list_get_all (self->device_list);
+	return fu_device_snapshot_save (filename, devices, error);
+}
+
 gboolean
 fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 {
-	FuRemoteListLoadFlags remote_list_flags = FU_REMOTE_LIST_LOAD_FLAG_NONE;
-	FuQuirksLoadFlags quirks_flags = FU_QUIRKS_LOAD_FLAG_NONE;
-	g_autoptr(GPtrArray) checksums = NULL;
 #ifndef _WIN32
 	g_autoptr(GError) error_local = NULL;
 #endif
@@ -6126,6 +9761,7 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	/* avoid re-loading a second time if fu-tool or fu-util request to */
 	if (self->loaded)
 		return TRUE;
+	self->load_flags = flags;
 
 /* TODO: Read registry key [HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Cryptography] "MachineGuid" */
 #ifndef _WIN32
@@ -6140,47 +9776,17 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		return FALSE;
 	}
 
-	/* read remotes */
-	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
-		remote_list_flags |= FU_REMOTE_LIST_LOAD_FLAG_READONLY_FS;
-	if (!fu_remote_list_load (self->remote_list, remote_list_flags, error)) {
-		g_prefix_error (error, "Failed to load remotes: ");
-		return FALSE;
-	}
-
-	/* create client certificate */
-	fu_engine_ensure_client_certificate (self);
-
-	/* get hardcoded approved firmware */
-	checksums = fu_config_get_approved_firmware (self->config);
-	for (guint i = 0; i < checksums->len; i++) {
-		const gchar *csum = g_ptr_array_index (checksums, i);
-		fu_engine_add_approved_firmware (self, csum);
-	}
-
-	/* get extra firmware saved to the database */
-	checksums = fu_history_get_approved_firmware (self->history, error);
-	if (checksums == NULL)
+	/* load remotes, approved firmware, quirks, SMBIOS and the hwids */
+	if (!fu_engine_load_phases (self, flags, error))
 		return FALSE;
-	for (guint i = 0; i < checksums->len; i++) {
-		const gchar *csum = g_ptr_array_index (checksums, i);
-		fu_engine_add_approved_firmware (self, csum);
-	}
 
 	/* set up idle exit */
 	if ((self->app_flags & FU_APP_FLAGS_NO_IDLE_SOURCES) == 0)
 		fu_idle_set_timeout (self->idle, fu_config_get_idle_timeout (self->config));
 
-	/* load quirks, SMBIOS and the hwids */
-	fu_engine_load_smbios (self);
-	fu_engine_load_hwids (self);
-	/* on a read-only filesystem don't care about the cache GUID */
-	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
-		quirks_flags |= FU_QUIRKS_LOAD_FLAG_READONLY_FS;
-	fu_engine_load_quirks (self, quirks_flags);
-
 	/* load AppStream metadata */
-	if (!fu_engine_load_metadata_store (self, flags, error)) {
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_METADATA) == 0 &&
+	    !fu_engine_load_metadata_store (self, flags, error)) {
 		g_prefix_error (error, "Failed to load AppStream data: ");
 		return FALSE;
 	}
@@ -6238,6 +9844,15 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 
 	fu_engine_set_status (self, FWUPD_STATUS_LOADING);
 
+	/* devices unchanged since the last run can skip setup */
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		g_autofree gchar *snapshot_fn = fu_engine_get_device_snapshot_filename ();
+		g_autoptr(GError) error_snapshot = NULL;
+		if (g_file_test (snapshot_fn, G_FILE_TEST_EXISTS) &&
+		    !fu_device_snapshot_load (snapshot_fn, &error_snapshot))
+			g_debug ("ignoring device snapshot: %s", error_snapshot->message);
+	}
+
 	/* add devices */
 	fu_engine_plugins_setup (self);
 	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
@@ -6263,7 +9878,8 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	fu_engine_md_refresh_devices (self);
 
 	/* update the db for devices that were updated during the reboot */
-	if (!fu_engine_update_history_database (self, error))
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_HISTORY) == 0 &&
+	    !fu_engine_update_history_database (self, error))
 		return FALSE;
 
 	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
@@ -6331,6 +9947,21 @@ fu_engine_add_app_flag (FuEngine *self, FuAppFlags app_flags)
 	self->app_flags |= app_flags;
 }
 
+/**
+ * fu_engine_set_install_threads_max:
+ * @self: A #FuEngine
+ * @install_threads_max: maximum number of devices, or 0 for no limit
+ *
+ * Sets the maximum number of independent devices that can be updated at the
+ * same time. Setting 1 installs every task in order on the main thread.
+ **/
+void
+fu_engine_set_install_threads_max (FuEngine *self, guint install_threads_max)
+{
+	g_return_if_fail (FU_IS_ENGINE (self));
+	self->install_threads_max = install_threads_max;
+}
+
 static void
 fu_engine_idle_status_notify_cb (FuIdle *idle, GParamSpec *pspec, FuEngine *self)
 {
@@ -6339,20 +9970,68 @@ fu_engine_idle_status_notify_cb (FuIdle *idle, GParamSpec *pspec, FuEngine *self
 		fu_engine_set_status (self, status);
 }
 
+/* changes when any trusted public key is added, removed or modified */
+static gchar *
+fu_engine_get_keyring_id (const gchar *pkidir_fw, const gchar *pkidir_md)
+{
+	const gchar *dirs[] = { pkidir_fw, pkidir_md, NULL };
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	for (guint i = 0; dirs[i] != NULL; i++) {
+		const gchar *fn;
+		g_autoptr(GDir) dir = g_dir_open (dirs[i], 0, NULL);
+		g_autoptr(GPtrArray) filenames = g_ptr_array_new_with_free_func (g_free);
+		if (dir == NULL)
+			continue;
+		while ((fn = g_dir_read_name (dir)) != NULL)
+			g_ptr_array_add (filenames, g_build_filename (dirs[i], fn, NULL));
+		g_ptr_array_sort (filenames, fu_engine_gtypes_sort_cb);
+		for (guint j = 0; j < filenames->len; j++) {
+			const gchar *filename = g_ptr_array_index (filenames, j);
+			gsize bufsz = 0;
+			g_autofree gchar *buf = NULL;
+			if (!g_file_get_contents (filename, &buf, &bufsz, NULL))
+				continue;
+			g_checksum_update (csum, (const guchar *) filename, -1);
+			g_checksum_update (csum, (const guchar *) buf, bufsz);
+		}
+	}
+	return g_strdup (g_checksum_get_string (csum));
+}
+
 static void
 fu_engine_init (FuEngine *self)
 {
 #ifdef HAVE_UTSNAME_H
 	struct utsname uname_tmp;
 #endif
+	g_autofree gchar *jcat_cache_fn = NULL;
+	g_autofree gchar *keyring_id = NULL;
 	g_autofree gchar *keyring_path = NULL;
 	g_autofree gchar *pkidir_fw = NULL;
 	g_autofree gchar *pkidir_md = NULL;
 	g_autofree gchar *sysconfdir = NULL;
+	g_autoptr(GError) error_jcat = NULL;
 	self->percentage = 0;
+
+	/* describe the metrics recorded by the daemon */
+	fu_metrics_set_help ("fwupd_cache_hits", "Lookups found in each cache");
+	fu_metrics_set_help ("fwupd_cache_lookups", "Lookups made in each cache");
+	fu_metrics_set_help ("fwupd_coldplug_duration_seconds", "Time to coldplug all the plugins");
+	fu_metrics_set_help ("fwupd_device_retries", "Device operations that were retried");
+	fu_metrics_set_help ("fwupd_install_bytes", "Firmware bytes installed by each plugin");
+	fu_metrics_set_help ("fwupd_install_duration_seconds", "Time to install firmware by each plugin");
+	fu_metrics_set_help ("fwupd_quirk_lookups", "Quirk lookups made by plugins and devices");
+	fu_metrics_set_help ("fwupd_silo_build_duration_seconds", "Time to load or build the metadata silo");
+
 	self->status = FWUPD_STATUS_IDLE;
+	self->main_thread = g_thread_self ();
+	self->file_watch = fu_file_watch_new ();
+	self->esrt = fu_esrt_new ();
 	self->config = fu_config_new ();
+	fu_config_set_file_watch (self->config, self->file_watch);
 	self->remote_list = fu_remote_list_new ();
+	fu_remote_list_set_file_watch (self->remote_list, self->file_watch);
 	self->device_list = fu_device_list_new ();
 	self->smbios = fu_smbios_new ();
 	self->hwids = fu_hwids_new ();
@@ -6361,8 +10040,20 @@ fu_engine_init (FuEngine *self)
 	self->history = fu_history_new ();
 	self->plugin_list = fu_plugin_list_new ();
 	self->plugin_filter = g_ptr_array_new_with_free_func (g_free);
+	self->plugins_deferred = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->host_security_attrs = fu_security_attrs_new ();
+	self->security_attrs_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+							    g_free,
+							    (GDestroyNotify) fu_engine_security_attrs_cache_item_free);
 	self->udev_subsystems = g_ptr_array_new_with_free_func (g_free);
+	self->releases_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      g_free,
+						      (GDestroyNotify) fu_engine_releases_cache_item_free);
+	self->silo_cache = g_queue_new ();
+	self->progress_notify_pending = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							       (GDestroyNotify) g_object_unref,
+							       NULL);
+	self->shards = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_shard_free);
 #ifdef HAVE_GUDEV
 	self->udev_changed_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
 							g_free, (GDestroyNotify) fu_engine_udev_changed_helper_free);
@@ -6370,6 +10061,11 @@ fu_engine_init (FuEngine *self)
 	self->runtime_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->compile_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->firmware_gtypes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->install_devices_changed = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->install_hotplug_events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_hotplug_event_free);
+	self->hotplug_batch = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->device_locks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	self->install_phases = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
 	g_signal_connect (self->config, "changed",
 			  G_CALLBACK (fu_engine_config_changed_cb),
@@ -6382,14 +10078,20 @@ fu_engine_init (FuEngine *self)
 			  G_CALLBACK (fu_engine_idle_status_notify_cb), self);
 
 	/* setup Jcat context */
-	self->jcat_context = jcat_context_new ();
+	self->jcat_context = fu_engine_jcat_context_new ();
 	keyring_path = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
-	jcat_context_set_keyring_path (self->jcat_context, keyring_path);
 	sysconfdir = fu_common_get_path (FU_PATH_KIND_SYSCONFDIR);
 	pkidir_fw = g_build_filename (sysconfdir, "pki", "fwupd", NULL);
-	jcat_context_add_public_keys (self->jcat_context, pkidir_fw);
 	pkidir_md = g_build_filename (sysconfdir, "pki", "fwupd-metadata", NULL);
-	jcat_context_add_public_keys (self->jcat_context, pkidir_md);
+
+	/* previously verified signatures, only valid for the same keys */
+	self->jcat_cache = fu_jcat_cache_new ();
+	self->firmware_builder = fu_firmware_builder_new ();
+	fu_firmware_builder_set_keep_sandbox (self->firmware_builder, TRUE);
+	keyring_id = fu_engine_get_keyring_id (pkidir_fw, pkidir_md);
+	jcat_cache_fn = g_build_filename (keyring_path, "jcat-cache.ini", NULL);
+	if (!fu_jcat_cache_load (self->jcat_cache, jcat_cache_fn, keyring_id, &error_jcat))
+		g_debug ("failed to load signature cache: %s", error_jcat->message);
 
 	/* add some runtime versions of things the daemon depends on */
 	fu_engine_add_runtime_version (self, "org.freedesktop.fwupd", VERSION);
@@ -6428,36 +10130,67 @@ fu_engine_finalize (GObject *obj)
 
 	if (self->usb_ctx != NULL)
 		g_object_unref (self->usb_ctx);
-	if (self->silo != NULL)
-		g_object_unref (self->silo);
+	g_ptr_array_unref (self->shards);
 #ifdef HAVE_GUDEV
 	if (self->gudev_client != NULL)
 		g_object_unref (self->gudev_client);
 #endif
 	if (self->coldplug_id != 0)
 		g_source_remove (self->coldplug_id);
+	if (self->progress_notify_id != 0)
+		g_source_remove (self->progress_notify_id);
+	g_hash_table_unref (self->progress_notify_pending);
+	if (self->coldplug_queue != NULL)
+		g_ptr_array_unref (self->coldplug_queue);
+	if (self->hotplug_batch_id != 0)
+		g_source_remove (self->hotplug_batch_id);
+	g_ptr_array_unref (self->hotplug_batch);
+	g_mutex_clear (&self->coldplug_mutex);
+	g_mutex_clear (&self->status_mutex);
+	g_mutex_clear (&self->install_mutex);
+	g_ptr_array_unref (self->install_devices_changed);
+	g_ptr_array_unref (self->install_hotplug_events);
+	g_hash_table_unref (self->device_locks);
+	g_hash_table_unref (self->install_phases);
+	g_mutex_clear (&self->device_locks_mutex);
+	g_cond_clear (&self->device_locks_cond);
 	if (self->approved_firmware != NULL)
 		g_hash_table_unref (self->approved_firmware);
 
 	g_free (self->host_machine_id);
 	g_free (self->host_security_id);
+	g_free (self->silo_remotes_key);
 	g_object_unref (self->host_security_attrs);
+	g_hash_table_unref (self->security_attrs_cache);
 	g_object_unref (self->idle);
 	g_object_unref (self->config);
 	g_object_unref (self->remote_list);
+	g_object_unref (self->file_watch);
+	g_object_unref (self->esrt);
 	g_object_unref (self->smbios);
 	g_object_unref (self->quirks);
 	g_object_unref (self->hwids);
 	g_object_unref (self->history);
 	g_object_unref (self->device_list);
 	g_object_unref (self->jcat_context);
+	g_object_unref (self->jcat_cache);
+	g_object_unref (self->firmware_builder);
 	g_ptr_array_unref (self->plugin_filter);
+	g_hash_table_unref (self->plugins_deferred);
 	g_ptr_array_unref (self->udev_subsystems);
 #ifdef HAVE_GUDEV
 	g_hash_table_unref (self->udev_changed_ids);
 #endif
+	g_hash_table_unref (self->releases_cache);
+	if (self->devices_sorted != NULL)
+		g_ptr_array_unref (self->devices_sorted);
+	g_queue_free_full (self->silo_cache, (GDestroyNotify) fu_engine_silo_cache_item_free);
+	g_mutex_clear (&self->silo_cache_mutex);
 	g_hash_table_unref (self->runtime_versions);
 	g_hash_table_unref (self->compile_versions);
+	if (self->report_metadata_boot != NULL)
+		g_hash_table_unref (self->report_metadata_boot);
+	g_mutex_clear (&self->report_metadata_mutex);
 	g_hash_table_unref (self->firmware_gtypes);
 	g_object_unref (self->plugin_list);
 
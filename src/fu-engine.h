@@ -26,6 +26,10 @@ G_DECLARE_FINAL_TYPE (FuEngine, fu_engine, FU, ENGINE, GObject)
  * FuEngineLoadFlags:
  * @FU_ENGINE_LOAD_FLAG_NONE:		No flags set
  * @FU_ENGINE_LOAD_FLAG_READONLY_FS:	Ignore readonly filesystem errors
+ * @FU_ENGINE_LOAD_FLAG_NO_ENUMERATE:	Do not coldplug or enumerate devices
+ * @FU_ENGINE_LOAD_FLAG_NO_METADATA:	Do not load the metadata from the remotes
+ * @FU_ENGINE_LOAD_FLAG_NO_HISTORY:	Do not read or update the history database
+ * @FU_ENGINE_LOAD_FLAG_NO_PLUGINS:	Only load plugins added with fu_engine_add_plugin_filter()
  *
  * The flags to use when loading the engine.
  **/
@@ -33,6 +37,9 @@ typedef enum {
 	FU_ENGINE_LOAD_FLAG_NONE		= 0,
 	FU_ENGINE_LOAD_FLAG_READONLY_FS		= 1 << 0,
 	FU_ENGINE_LOAD_FLAG_NO_ENUMERATE	= 1 << 1,
+	FU_ENGINE_LOAD_FLAG_NO_METADATA		= 1 << 2,
+	FU_ENGINE_LOAD_FLAG_NO_HISTORY		= 1 << 3,
+	FU_ENGINE_LOAD_FLAG_NO_PLUGINS		= 1 << 4,
 	/*< private >*/
 	FU_ENGINE_LOAD_FLAG_LAST
 } FuEngineLoadFlags;
@@ -43,6 +50,8 @@ void		 fu_engine_add_app_flag			(FuEngine	*self,
 void		 fu_engine_add_plugin_filter		(FuEngine	*self,
 							 const gchar	*plugin_glob);
 void		 fu_engine_idle_reset			(FuEngine	*self);
+void		 fu_engine_set_install_threads_max	(FuEngine	*self,
+							 guint		 install_threads_max);
 gboolean	 fu_engine_load				(FuEngine	*self,
 							 FuEngineLoadFlags flags,
 							 GError		**error);
@@ -52,14 +61,26 @@ gboolean	 fu_engine_get_tainted			(FuEngine	*self);
 const gchar	*fu_engine_get_host_product		(FuEngine *self);
 const gchar	*fu_engine_get_host_machine_id		(FuEngine *self);
 const gchar	*fu_engine_get_host_security_id		(FuEngine	*self);
+guint64		 fu_engine_get_releases_generation	(FuEngine	*self);
+guint64		 fu_engine_get_devices_generation	(FuEngine	*self);
 FwupdStatus	 fu_engine_get_status			(FuEngine	*self);
 XbSilo		*fu_engine_get_silo_from_blob		(FuEngine	*self,
 							 GBytes		*blob_cab,
 							 GError		**error);
 guint64		 fu_engine_get_archive_size_max		(FuEngine	*self);
+void		 fu_engine_trim_caches			(FuEngine	*self);
+GVariant	*fu_engine_get_memory_stats		(FuEngine	*self);
+const gchar	*fu_engine_get_metrics_socket		(FuEngine	*self);
+gchar		*fu_engine_get_metrics			(FuEngine	*self);
 GPtrArray	*fu_engine_get_plugins			(FuEngine	*self);
 GPtrArray	*fu_engine_get_devices			(FuEngine	*self,
 							 GError		**error);
+GPtrArray	*fu_engine_get_devices_filtered		(FuEngine	*self,
+							 FwupdDeviceFlags include_flags,
+							 FwupdDeviceFlags exclude_flags,
+							 const gchar	*plugin,
+							 const gchar	*guid,
+							 GError		**error);
 FuDevice	*fu_engine_get_device			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
@@ -68,6 +89,10 @@ GPtrArray	*fu_engine_get_devices_by_guid		(FuEngine	*self,
 							 GError		**error);
 GPtrArray	*fu_engine_get_history			(FuEngine	*self,
 							 GError		**error);
+GPtrArray	*fu_engine_get_history_range		(FuEngine	*self,
+							 guint		 limit,
+							 guint		 offset,
+							 GError		**error);
 FwupdRemote 	*fu_engine_get_remote_by_id		(FuEngine	*self,
 							 const gchar	*remote_id,
 							 GError		**error);
@@ -85,12 +110,18 @@ GPtrArray	*fu_engine_get_upgrades			(FuEngine	*self,
 							 FuEngineRequest *request,
 							 const gchar	*device_id,
 							 GError		**error);
+GHashTable	*fu_engine_get_releases_all		(FuEngine	*self,
+							 FuEngineRequest *request);
+GHashTable	*fu_engine_get_upgrades_all		(FuEngine	*self,
+							 FuEngineRequest *request);
 FwupdDevice	*fu_engine_get_results			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
 FuSecurityAttrs	*fu_engine_get_host_security_attrs	(FuEngine	*self);
 GHashTable	*fu_engine_get_report_metadata		(FuEngine	*self,
 							 GError		**error);
+gboolean	 fu_engine_save_device_snapshot		(FuEngine	*self,
+							 GError		**error);
 gboolean	 fu_engine_clear_results		(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
@@ -104,12 +135,19 @@ gboolean	 fu_engine_update_metadata_bytes	(FuEngine	*self,
 							 GBytes		*bytes_raw,
 							 GBytes		*bytes_sig,
 							 GError		**error);
+gboolean	 fu_engine_update_metadata_batch	(FuEngine	*self,
+							 GPtrArray	*remote_ids,
+							 GPtrArray	*blobs_raw,
+							 GPtrArray	*blobs_sig,
+							 GError		**error);
 gboolean	 fu_engine_unlock			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
 gboolean	 fu_engine_verify			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
+gboolean	 fu_engine_verify_all			(FuEngine	*self,
+							 GError		**error);
 gboolean	 fu_engine_verify_update		(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
@@ -153,6 +191,11 @@ GPtrArray	*fu_engine_get_details			(FuEngine	*self,
 							 FuEngineRequest *request,
 							 gint		 fd,
 							 GError		**error);
+GPtrArray	*fu_engine_get_details_for_silo		(FuEngine	*self,
+							 FuEngineRequest *request,
+							 GBytes		*blob_cab,
+							 XbSilo		*silo,
+							 GError		**error);
 gboolean	 fu_engine_activate			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
@@ -10,46 +10,185 @@
 #include "fu-srec-firmware.h"
 #include "fu-ihex-firmware.h"
 
-int
-main (int argc, char **argv)
+/* the fuzzers call the parser many thousands of times a second, so the
+ * objects are created once and reused for each input */
+typedef struct {
+	FuFirmware		*srec;
+	FuFirmware		*ihex;
+	gboolean		 verbose;
+} FuFirmwareDumpHelper;
+
+static FuFirmwareDumpHelper *
+fu_firmware_dump_helper_new (gboolean verbose)
 {
-	g_autofree gchar *str = NULL;
-	g_autoptr(FuFirmware) firmware = NULL;
-	g_autoptr(GBytes) blob = NULL;
-	g_autoptr(GError) error = NULL;
-	gsize sz = 0;
-	const guint8 *buf;
+	FuFirmwareDumpHelper *helper = g_new0 (FuFirmwareDumpHelper, 1);
+	helper->srec = fu_srec_firmware_new ();
+	helper->ihex = fu_ihex_firmware_new ();
+	helper->verbose = verbose;
+	return helper;
+}
 
-	/* no args */
-	if (argc != 2) {
-		g_printerr ("firmware filename required\n");
-		return 2;
-	}
+static void
+fu_firmware_dump_helper_free (FuFirmwareDumpHelper *helper)
+{
+	g_object_unref (helper->srec);
+	g_object_unref (helper->ihex);
+	g_free (helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuFirmwareDumpHelper, fu_firmware_dump_helper_free)
+
+static int
+fu_firmware_dump_parse (FuFirmwareDumpHelper *helper, GBytes *blob)
+{
+	FuFirmware *firmware;
+	gsize sz = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &sz);
+	g_autoptr(GError) error = NULL;
 
-	/* load firmware */
-	blob = fu_common_get_contents_bytes (argv[1], &error);
-	if (blob == NULL) {
-		g_printerr ("failed to load file: %s\n", error->message);
-		return 1;
-	}
-	buf = g_bytes_get_data (blob, &sz);
 	if (sz < 2) {
-		g_printerr ("firmware invalid\n");
+		if (helper->verbose)
+			g_printerr ("firmware invalid\n");
 		return 2;
 	}
 	if (buf[0] == 'S' && buf[1] == '0') {
-		firmware = fu_srec_firmware_new ();
+		firmware = helper->srec;
 	} else if (buf[0] == ':') {
-		firmware = fu_ihex_firmware_new ();
+		firmware = helper->ihex;
 	} else {
-		g_printerr ("firmware invalid type, expected .srec or .hex\n");
+		if (helper->verbose)
+			g_printerr ("firmware invalid type, expected .srec or .hex\n");
 		return 2;
 	}
+	fu_firmware_remove_images (firmware);
 	if (!fu_firmware_parse (firmware, blob, FWUPD_INSTALL_FLAG_FORCE, &error)) {
-		g_printerr ("failed to parse file: %s\n", error->message);
+		if (helper->verbose)
+			g_printerr ("failed to parse file: %s\n", error->message);
 		return 3;
 	}
-	str = fu_firmware_to_string (firmware);
-	g_print ("%s", str);
+	if (helper->verbose) {
+		g_autofree gchar *str = fu_firmware_to_string (firmware);
+		g_print ("%s", str);
+	}
+	return 0;
+}
+
+#ifdef FU_FIRMWARE_DUMP_LIBFUZZER
+
+int LLVMFuzzerTestOneInput (const guint8 *data, gsize size);
+
+int
+LLVMFuzzerTestOneInput (const guint8 *data, gsize size)
+{
+	static FuFirmwareDumpHelper *helper = NULL;
+	g_autoptr(GBytes) blob = g_bytes_new_static (data, size);
+	if (helper == NULL)
+		helper = fu_firmware_dump_helper_new (FALSE);
+	fu_firmware_dump_parse (helper, blob);
+	return 0;
+}
+
+#else
+
+static int
+fu_firmware_dump_file (FuFirmwareDumpHelper *helper, const gchar *filename)
+{
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+
+	blob = fu_common_get_contents_bytes (filename, &error);
+	if (blob == NULL) {
+		if (helper->verbose)
+			g_printerr ("failed to load file: %s\n", error->message);
+		return 1;
+	}
+	return fu_firmware_dump_parse (helper, blob);
+}
+
+/* parse every file in @path in turn until @seconds have elapsed */
+static int
+fu_firmware_dump_benchmark (const gchar *seconds, const gchar *path)
+{
+	const gchar *fn;
+	gdouble elapsed;
+	guint64 duration = 0;
+	guint64 execs = 0;
+	g_autoptr(FuFirmwareDumpHelper) helper = fu_firmware_dump_helper_new (FALSE);
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	g_autoptr(GTimer) timer = NULL;
+
+	duration = g_ascii_strtoull (seconds, NULL, 10);
+	if (duration == 0 || duration > 3600) {
+		g_printerr ("invalid duration %s\n", seconds);
+		return 2;
+	}
+
+	/* load the corpus up front so only the parser is measured */
+	dir = g_dir_open (path, 0, &error);
+	if (dir == NULL) {
+		g_printerr ("failed to open corpus: %s\n", error->message);
+		return 1;
+	}
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *filename = g_build_filename (path, fn, NULL);
+		GBytes *blob = fu_common_get_contents_bytes (filename, &error);
+		if (blob == NULL) {
+			g_printerr ("failed to load file: %s\n", error->message);
+			return 1;
+		}
+		g_ptr_array_add (blobs, blob);
+	}
+	if (blobs->len == 0) {
+		g_printerr ("no files in %s\n", path);
+		return 2;
+	}
+
+	timer = g_timer_new ();
+	do {
+		GBytes *blob = g_ptr_array_index (blobs, execs % blobs->len);
+		fu_firmware_dump_parse (helper, blob);
+		execs++;
+		elapsed = g_timer_elapsed (timer, NULL);
+	} while (elapsed < (gdouble) duration);
+	g_print ("%" G_GUINT64_FORMAT " execs in %.1fs: %.0f execs/sec\n",
+		 execs, elapsed, (gdouble) execs / elapsed);
 	return 0;
 }
+
+int
+main (int argc, char **argv)
+{
+	int rc;
+	g_autoptr(FuFirmwareDumpHelper) helper = NULL;
+
+	/* measure parser throughput */
+	if (argc == 4 && g_strcmp0 (argv[1], "--benchmark") == 0)
+		return fu_firmware_dump_benchmark (argv[2], argv[3]);
+
+	/* no args */
+	if (argc != 2) {
+		g_printerr ("firmware filename required\n");
+		return 2;
+	}
+
+	/* register the types before the AFL fork server starts */
+	helper = fu_firmware_dump_helper_new (TRUE);
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+	__AFL_INIT ();
+#endif
+
+	/* re-read the same file for each input when using afl-clang-fast */
+#ifdef __AFL_LOOP
+	helper->verbose = FALSE;
+	rc = 0;
+	while (__AFL_LOOP (1000))
+		rc = fu_firmware_dump_file (helper, argv[1]);
+#else
+	rc = fu_firmware_dump_file (helper, argv[1]);
+#endif
+	return rc;
+}
+
+#endif
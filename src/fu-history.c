@@ -20,7 +20,8 @@
 #include "fu-history.h"
 #include "fu-mutex.h"
 
-#define FU_HISTORY_CURRENT_SCHEMA_VERSION	5
+#define FU_HISTORY_CURRENT_SCHEMA_VERSION	7
+#define FU_HISTORY_DURATIONS_MAX		20	/* per plugin and GUID */
 
 static void fu_history_finalize			 (GObject *object);
 
@@ -29,6 +30,8 @@ struct _FuHistory
 	GObject			 parent_instance;
 	sqlite3			*db;
 	GRWLock			 db_mutex;
+	GHashTable		*stmts;		/* SQL : sqlite3_stmt */
+	guint			 transaction_depth;
 };
 
 G_DEFINE_TYPE (FuHistory, fu_history, G_TYPE_OBJECT)
@@ -147,16 +150,43 @@ fu_history_stmt_exec (FuHistory *self, sqlite3_stmt *stmt,
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
 			     sqlite3_errmsg (self->db));
+		sqlite3_reset (stmt);
+		sqlite3_clear_bindings (stmt);
 		return FALSE;
 	}
+
+	/* the statement may be cached, so do not keep the read lock or
+	 * pointers to the bound values */
+	sqlite3_reset (stmt);
+	sqlite3_clear_bindings (stmt);
 	return TRUE;
 }
 
+/* the returned statement is owned by the cache and must only be used with
+ * the writer lock held, as it cannot be shared between threads */
+static gint
+fu_history_prepare_cached (FuHistory *self, const gchar *sql, sqlite3_stmt **stmt)
+{
+	gint rc;
+	sqlite3_stmt *stmt_tmp = g_hash_table_lookup (self->stmts, sql);
+	if (stmt_tmp != NULL) {
+		*stmt = stmt_tmp;
+		return SQLITE_OK;
+	}
+	rc = sqlite3_prepare_v2 (self->db, sql, -1, &stmt_tmp, NULL);
+	if (rc != SQLITE_OK)
+		return rc;
+	g_hash_table_insert (self->stmts, (gpointer) sql, stmt_tmp);
+	*stmt = stmt_tmp;
+	return SQLITE_OK;
+}
+
 static gboolean
 fu_history_create_database (FuHistory *self, GError **error)
 {
 	gint rc;
 	rc = sqlite3_exec (self->db,
+			 "PRAGMA auto_vacuum=INCREMENTAL;"
 			 "BEGIN TRANSACTION;"
 			 "CREATE TABLE IF NOT EXISTS schema ("
 			 "created timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
@@ -181,6 +211,20 @@ fu_history_create_database (FuHistory *self, GError **error)
 			 "protocol TEXT DEFAULT NULL);"
 			 "CREATE TABLE IF NOT EXISTS approved_firmware ("
 			 "checksum TEXT);"
+			 "CREATE TABLE IF NOT EXISTS durations ("
+			 "plugin TEXT,"
+			 "guid TEXT,"
+			 "detach INTEGER DEFAULT 0,"
+			 "write INTEGER DEFAULT 0,"
+			 "attach INTEGER DEFAULT 0,"
+			 "verify INTEGER DEFAULT 0,"
+			 "bytes INTEGER DEFAULT 0);"
+			 "CREATE INDEX IF NOT EXISTS durations_plugin_guid "
+			 "ON durations (plugin, guid);"
+			 "CREATE INDEX IF NOT EXISTS history_device_id "
+			 "ON history (device_id);"
+			 "CREATE INDEX IF NOT EXISTS history_checksum "
+			 "ON history (checksum);"
 			 "COMMIT;", NULL, NULL, NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
@@ -269,6 +313,50 @@ fu_history_migrate_database_v4 (FuHistory *self, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_history_migrate_database_v5 (FuHistory *self, GError **error)
+{
+	gint rc;
+	rc = sqlite3_exec (self->db,
+			   "CREATE INDEX IF NOT EXISTS history_device_id "
+			   "ON history (device_id);"
+			   "CREATE INDEX IF NOT EXISTS history_checksum "
+			   "ON history (checksum);",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to create index: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_history_migrate_database_v6 (FuHistory *self, GError **error)
+{
+	gint rc;
+	rc = sqlite3_exec (self->db,
+			   "CREATE TABLE IF NOT EXISTS durations ("
+			   "plugin TEXT,"
+			   "guid TEXT,"
+			   "detach INTEGER DEFAULT 0,"
+			   "write INTEGER DEFAULT 0,"
+			   "attach INTEGER DEFAULT 0,"
+			   "verify INTEGER DEFAULT 0,"
+			   "bytes INTEGER DEFAULT 0);"
+			   "CREATE INDEX IF NOT EXISTS durations_plugin_guid "
+			   "ON durations (plugin, guid);",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to create table: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /* returns 0 if database is not initialised */
 static guint
 fu_history_get_schema_version (FuHistory *self)
@@ -315,16 +403,38 @@ fu_history_create_or_migrate (FuHistory *self, guint schema_ver, GError **error)
 			return FALSE;
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 	} else if (schema_ver == 3) {
 		g_debug ("migrating v%u database by altering", schema_ver);
 		if (!fu_history_migrate_database_v3 (self, error))
 			return FALSE;
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 	} else if (schema_ver == 4) {
 		g_debug ("migrating v%u database by altering", schema_ver);
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
+	} else if (schema_ver == 5) {
+		g_debug ("migrating v%u database by indexing", schema_ver);
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
+	} else if (schema_ver == 6) {
+		g_debug ("migrating v%u database by adding durations", schema_ver);
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 	} else {
 		/* this is probably okay, but return an error if we ever delete
 		 * or rename columns */
@@ -363,6 +473,15 @@ fu_history_open (FuHistory *self, const gchar *filename, GError **error)
 
 	/* turn off the lookaside cache */
 	sqlite3_db_config (self->db, SQLITE_DBCONFIG_LOOKASIDE, NULL, 0, 0);
+
+	/* a write-ahead log does not need a fsync for every transaction, and a
+	 * power loss can only lose the last commit rather than corrupt the db */
+	rc = sqlite3_exec (self->db,
+			   "PRAGMA journal_mode=WAL;"
+			   "PRAGMA synchronous=NORMAL;",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK)
+		g_debug ("cannot use WAL: %s", sqlite3_errmsg (self->db));
 	return TRUE;
 }
 
@@ -417,6 +536,7 @@ fu_history_load (FuHistory *self, GError **error)
 			 * and try again with something empty */
 			g_warning ("failed to migrate %s database: %s",
 				   filename, error_migrate->message);
+			g_hash_table_remove_all (self->stmts);
 			sqlite3_close (self->db);
 			if (g_unlink (filename) != 0) {
 				g_set_error (error,
@@ -435,6 +555,111 @@ fu_history_load (FuHistory *self, GError **error)
 	return TRUE;
 }
 
+/* the writer lock must be held */
+static gboolean
+fu_history_exec_literal (FuHistory *self, const gchar *sql, GError **error)
+{
+	gint rc = sqlite3_exec (self->db, sql, NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
+			     "failed to execute %s: %s",
+			     sql, sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_history_start_transaction:
+ * @self: A #FuHistory
+ * @error: A #GError or NULL
+ *
+ * Starts a transaction so that several modifications can be written to disk
+ * at the same time. Transactions can be nested, and the changes are only
+ * written when the outermost transaction is committed.
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_history_start_transaction (FuHistory *self, GError **error)
+{
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	if (self->transaction_depth == 0 &&
+	    !fu_history_exec_literal (self, "BEGIN TRANSACTION;", error))
+		return FALSE;
+	self->transaction_depth++;
+	return TRUE;
+}
+
+/**
+ * fu_history_commit_transaction:
+ * @self: A #FuHistory
+ * @error: A #GError or NULL
+ *
+ * Commits a transaction started with fu_history_start_transaction().
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_history_commit_transaction (FuHistory *self, GError **error)
+{
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	if (self->transaction_depth == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "no transaction in progress");
+		return FALSE;
+	}
+	if (--self->transaction_depth > 0)
+		return TRUE;
+	return fu_history_exec_literal (self, "COMMIT;", error);
+}
+
+/**
+ * fu_history_rollback_transaction:
+ * @self: A #FuHistory
+ *
+ * Discards all the changes made since the outermost transaction was started.
+ * This does nothing if there is no transaction in progress.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_history_rollback_transaction (FuHistory *self)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_if_fail (FU_IS_HISTORY (self));
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_if_fail (locker != NULL);
+	if (self->transaction_depth == 0)
+		return;
+	self->transaction_depth = 0;
+	if (!fu_history_exec_literal (self, "ROLLBACK;", &error_local))
+		g_warning ("%s", error_local->message);
+}
+
 static gchar *
 _convert_hash_to_string (GHashTable *hash)
 {
@@ -476,7 +701,7 @@ gboolean
 fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -492,15 +717,14 @@ fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 	g_debug ("modifying device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "UPDATE history SET "
-				 "update_state = ?1, "
-				 "update_error = ?2, "
-				 "checksum_device = ?6, "
-				 "device_modified = ?7, "
-				 "flags = ?3 "
-				 "WHERE device_id = ?4;",
-				 -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"UPDATE history SET "
+					"update_state = ?1, "
+					"update_error = ?2, "
+					"checksum_device = ?6, "
+					"device_modified = ?7, "
+					"flags = ?3 "
+					"WHERE device_id = ?4;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to update history: %s",
@@ -542,7 +766,7 @@ fu_history_set_device_metadata (FuHistory *self,
 	gint rc;
 	g_autofree gchar *metadata_str = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -555,11 +779,10 @@ fu_history_set_device_metadata (FuHistory *self,
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("modifying %s", device_id);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "UPDATE history SET "
-				 "metadata = ?1 "
-				 "WHERE device_id = ?2;",
-				 -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"UPDATE history SET "
+					"metadata = ?1 "
+					"WHERE device_id = ?2;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "failed to prepare SQL to update history: %s",
@@ -576,6 +799,65 @@ fu_history_set_device_metadata (FuHistory *self,
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
+static gboolean
+fu_history_add_device_internal (FuHistory *self,
+				FuDevice *device,
+				FwupdRelease *release,
+				const gchar *checksum,
+				const gchar *checksum_device,
+				const gchar *metadata,
+				GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	rc = fu_history_prepare_cached (self,
+					"INSERT INTO history (device_id,"
+							      "update_state,"
+							      "update_error,"
+							      "flags,"
+							      "filename,"
+							      "checksum,"
+							      "display_name,"
+							      "plugin,"
+							      "guid_default,"
+							      "metadata,"
+							      "device_created,"
+							      "device_modified,"
+							      "version_old,"
+							      "version_new,"
+							      "checksum_device,"
+							      "protocol) "
+					"VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
+						 "?11,?12,?13,?14,?15,?16)", &stmt);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL to insert history: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	sqlite3_bind_text (stmt, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
+	sqlite3_bind_int (stmt, 2, fu_device_get_update_state (device));
+	sqlite3_bind_text (stmt, 3, fu_device_get_update_error (device), -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (stmt, 4, fu_history_get_device_flags_filtered (device));
+	sqlite3_bind_text (stmt, 5, fwupd_release_get_filename (release), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 6, checksum, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 7, fu_device_get_name (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 8, fu_device_get_plugin (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 9, fu_device_get_guid_default (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 10, metadata, -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (stmt, 11, fu_device_get_created (device));
+	sqlite3_bind_int64 (stmt, 12, fu_device_get_modified (device));
+	sqlite3_bind_text (stmt, 13, fu_device_get_version (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 14, fwupd_release_get_version (release), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 15, checksum_device, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 16, fwupd_release_get_protocol (release), -1, SQLITE_STATIC);
+	return fu_history_stmt_exec (self, stmt, NULL, error);
+}
+
 /**
  * fu_history_add_device:
  * @self: A #FuHistory
@@ -594,10 +876,7 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 {
 	const gchar *checksum_device;
 	const gchar *checksum = NULL;
-	gint rc;
 	g_autofree gchar *metadata = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
 	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
@@ -608,8 +887,12 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 		return FALSE;
 
 	/* ensure all old device(s) with this ID are removed */
-	if (!fu_history_remove_device (self, device, error))
+	if (!fu_history_start_transaction (self, error))
+		return FALSE;
+	if (!fu_history_remove_device (self, device, error)) {
+		fu_history_rollback_transaction (self);
 		return FALSE;
+	}
 	g_debug ("add device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
@@ -624,50 +907,12 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	metadata = _convert_hash_to_string (fwupd_release_get_metadata (release));
 
 	/* add */
-	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
-	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "INSERT INTO history (device_id,"
-						      "update_state,"
-						      "update_error,"
-						      "flags,"
-						      "filename,"
-						      "checksum,"
-						      "display_name,"
-						      "plugin,"
-						      "guid_default,"
-						      "metadata,"
-						      "device_created,"
-						      "device_modified,"
-						      "version_old,"
-						      "version_new,"
-						      "checksum_device,"
-						      "protocol) "
-				 "VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
-					 "?11,?12,?13,?14,?15,?16)", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to insert history: %s",
-			     sqlite3_errmsg (self->db));
+	if (!fu_history_add_device_internal (self, device, release, checksum,
+					     checksum_device, metadata, error)) {
+		fu_history_rollback_transaction (self);
 		return FALSE;
 	}
-	sqlite3_bind_text (stmt, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
-	sqlite3_bind_int (stmt, 2, fu_device_get_update_state (device));
-	sqlite3_bind_text (stmt, 3, fu_device_get_update_error (device), -1, SQLITE_STATIC);
-	sqlite3_bind_int64 (stmt, 4, fu_history_get_device_flags_filtered (device));
-	sqlite3_bind_text (stmt, 5, fwupd_release_get_filename (release), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 6, checksum, -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 7, fu_device_get_name (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 8, fu_device_get_plugin (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 9, fu_device_get_guid_default (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 10, metadata, -1, SQLITE_STATIC);
-	sqlite3_bind_int64 (stmt, 11, fu_device_get_created (device));
-	sqlite3_bind_int64 (stmt, 12, fu_device_get_modified (device));
-	sqlite3_bind_text (stmt, 13, fu_device_get_version (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 14, fwupd_release_get_version (release), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 15, checksum_device, -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 16, fwupd_release_get_protocol (release), -1, SQLITE_STATIC);
-	return fu_history_stmt_exec (self, stmt, NULL, error);
+	return fu_history_commit_transaction (self, error);
 }
 
 /**
@@ -689,7 +934,7 @@ fu_history_remove_all_with_state (FuHistory *self,
 				  GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -703,9 +948,8 @@ fu_history_remove_all_with_state (FuHistory *self,
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices with update_state %s",
 		 fwupd_update_state_to_string (update_state));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM history WHERE update_state = ?1",
-				 -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"DELETE FROM history WHERE update_state = ?1", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete history: %s",
@@ -731,7 +975,7 @@ gboolean
 fu_history_remove_all (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -744,7 +988,7 @@ fu_history_remove_all (FuHistory *self, GError **error)
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices");
-	rc = sqlite3_prepare_v2 (self->db, "DELETE FROM history;", -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self, "DELETE FROM history;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete history: %s",
@@ -770,7 +1014,7 @@ gboolean
 fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -785,9 +1029,8 @@ fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 	g_debug ("remove device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM history WHERE device_id = ?1;",
-				 -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"DELETE FROM history WHERE device_id = ?1;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete history: %s",
@@ -816,8 +1059,8 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 {
 	gint rc;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 	g_return_val_if_fail (device_id != NULL, NULL);
@@ -827,28 +1070,28 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 		return NULL;
 
 	/* get all the devices */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
 	g_debug ("get device");
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT device_id, "
-					"checksum, "
-					"plugin, "
-					"device_created, "
-					"device_modified, "
-					"display_name, "
-					"filename, "
-					"flags, "
-					"metadata, "
-					"guid_default, "
-					"update_state, "
-					"update_error, "
-					"version_new, "
-					"version_old, "
-					"checksum_device, "
-					"protocol FROM history WHERE "
-				 "device_id = ?1 ORDER BY device_created DESC "
-				 "LIMIT 1", -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"SELECT device_id, "
+						"checksum, "
+						"plugin, "
+						"device_created, "
+						"device_modified, "
+						"display_name, "
+						"filename, "
+						"flags, "
+						"metadata, "
+						"guid_default, "
+						"update_state, "
+						"update_error, "
+						"version_new, "
+						"version_old, "
+						"checksum_device, "
+						"protocol FROM history WHERE "
+					"device_id = ?1 ORDER BY device_created DESC "
+					"LIMIT 1", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get history: %s",
@@ -881,12 +1124,33 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
  **/
 GPtrArray *
 fu_history_get_devices (FuHistory *self, GError **error)
+{
+	return fu_history_get_devices_range (self, 0, 0, error);
+}
+
+/**
+ * fu_history_get_devices_range:
+ * @self: A #FuHistory
+ * @limit: maximum number of devices to return, or 0 for no limit
+ * @offset: number of the most recently modified devices to skip
+ * @error: A #GError or NULL
+ *
+ * Returns a page of the devices in the history database, so that clients
+ * do not need to load every entry. The devices in the page are sorted by
+ * the time they were last modified, oldest first.
+ *
+ * Returns: (element-type #FuDevice) (transfer container): devices
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fu_history_get_devices_range (FuHistory *self, guint limit, guint offset, GError **error)
 {
 	GPtrArray *array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	gint rc;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
@@ -896,34 +1160,38 @@ fu_history_get_devices (FuHistory *self, GError **error)
 			return NULL;
 	}
 
-	/* get all the devices */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	/* get the newest devices, but return them oldest first */
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT device_id, "
-					"checksum, "
-					"plugin, "
-					"device_created, "
-					"device_modified, "
-					"display_name, "
-					"filename, "
-					"flags, "
-					"metadata, "
-					"guid_default, "
-					"update_state, "
-					"update_error, "
-					"version_new, "
-					"version_old, "
-					"checksum_device, "
-					"protocol FROM history "
-					"ORDER BY device_modified ASC;",
-					-1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"SELECT device_id, "
+						"checksum, "
+						"plugin, "
+						"device_created, "
+						"device_modified, "
+						"display_name, "
+						"filename, "
+						"flags, "
+						"metadata, "
+						"guid_default, "
+						"update_state, "
+						"update_error, "
+						"version_new, "
+						"version_old, "
+						"checksum_device, "
+						"protocol FROM ("
+					"SELECT * FROM history "
+					"ORDER BY device_modified DESC "
+					"LIMIT ?1 OFFSET ?2) "
+					"ORDER BY device_modified ASC;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get history: %s",
 			     sqlite3_errmsg (self->db));
 		return NULL;
 	}
+	sqlite3_bind_int64 (stmt, 1, limit > 0 ? (gint64) limit : -1);
+	sqlite3_bind_int64 (stmt, 2, offset);
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	if (!fu_history_stmt_exec (self, stmt, array_tmp, error))
 		return NULL;
@@ -931,6 +1199,139 @@ fu_history_get_devices (FuHistory *self, GError **error)
 	return array;
 }
 
+/**
+ * fu_history_prune:
+ * @self: A #FuHistory
+ * @max_age: age in seconds of the oldest entry to keep, or 0 for no limit
+ * @max_entries: maximum number of entries to keep, or 0 for no limit
+ * @error: A #GError or NULL
+ *
+ * Removes old entries from the history database. Entries for updates that
+ * are pending or waiting for a reboot are never removed.
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_history_prune (FuHistory *self, guint64 max_age, guint max_entries, GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	if (max_age > 0) {
+		gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+		rc = fu_history_prepare_cached (self,
+						"DELETE FROM history "
+						"WHERE update_state NOT IN (?1, ?2) "
+						"AND device_modified < ?3;", &stmt);
+		if (rc != SQLITE_OK) {
+			g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+				     "Failed to prepare SQL to prune history: %s",
+				     sqlite3_errmsg (self->db));
+			return FALSE;
+		}
+		sqlite3_bind_int (stmt, 1, FWUPD_UPDATE_STATE_PENDING);
+		sqlite3_bind_int (stmt, 2, FWUPD_UPDATE_STATE_NEEDS_REBOOT);
+		sqlite3_bind_int64 (stmt, 3, now - (gint64) max_age);
+		if (!fu_history_stmt_exec (self, stmt, NULL, error))
+			return FALSE;
+		if (sqlite3_changes (self->db) > 0)
+			g_debug ("pruned %i old history entries", sqlite3_changes (self->db));
+	}
+	if (max_entries > 0) {
+		rc = fu_history_prepare_cached (self,
+						"DELETE FROM history "
+						"WHERE update_state NOT IN (?1, ?2) "
+						"AND rowid NOT IN (SELECT rowid FROM history "
+						"ORDER BY device_modified DESC LIMIT ?3);", &stmt);
+		if (rc != SQLITE_OK) {
+			g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+				     "Failed to prepare SQL to prune history: %s",
+				     sqlite3_errmsg (self->db));
+			return FALSE;
+		}
+		sqlite3_bind_int (stmt, 1, FWUPD_UPDATE_STATE_PENDING);
+		sqlite3_bind_int (stmt, 2, FWUPD_UPDATE_STATE_NEEDS_REBOOT);
+		sqlite3_bind_int64 (stmt, 3, max_entries);
+		if (!fu_history_stmt_exec (self, stmt, NULL, error))
+			return FALSE;
+		if (sqlite3_changes (self->db) > 0)
+			g_debug ("pruned %i excess history entries", sqlite3_changes (self->db));
+	}
+	return TRUE;
+}
+
+/**
+ * fu_history_vacuum:
+ * @self: A #FuHistory
+ * @error: A #GError or NULL
+ *
+ * Returns the pages freed by deleted entries to the filesystem, and
+ * truncates the write-ahead log. Databases created before incremental
+ * auto-vacuum was enabled are converted using a full `VACUUM` the first
+ * time this is called.
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_history_vacuum (FuHistory *self, GError **error)
+{
+	gint rc;
+	gint auto_vacuum = 0;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	g_autoptr(sqlite3_stmt) stmt = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	if (self->transaction_depth > 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "cannot vacuum during a transaction");
+		return FALSE;
+	}
+	rc = sqlite3_prepare_v2 (self->db, "PRAGMA auto_vacuum;", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL to get auto_vacuum: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	if (sqlite3_step (stmt) == SQLITE_ROW)
+		auto_vacuum = sqlite3_column_int (stmt, 0);
+
+	/* 2 is INCREMENTAL */
+	if (auto_vacuum != 2) {
+		g_debug ("converting history database to incremental auto-vacuum");
+		if (!fu_history_exec_literal (self,
+					      "PRAGMA auto_vacuum=INCREMENTAL;"
+					      "VACUUM;", error))
+			return FALSE;
+	} else {
+		if (!fu_history_exec_literal (self, "PRAGMA incremental_vacuum;", error))
+			return FALSE;
+	}
+	return fu_history_exec_literal (self, "PRAGMA wal_checkpoint(TRUNCATE);", error);
+}
+
 /**
  * fu_history_get_approved_firmware:
  * @self: A #FuHistory
@@ -946,9 +1347,9 @@ GPtrArray *
 fu_history_get_approved_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
@@ -959,11 +1360,10 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 	}
 
 	/* get all the approved firmware */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT checksum FROM approved_firmware;",
-				 -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"SELECT checksum FROM approved_firmware;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to get checksum: %s",
@@ -975,6 +1375,7 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 		const gchar *tmp = (const gchar *) sqlite3_column_text (stmt, 0);
 		g_ptr_array_add (array, g_strdup (tmp));
 	}
+	sqlite3_reset (stmt);
 	if (rc != SQLITE_DONE) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
@@ -999,7 +1400,7 @@ gboolean
 fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -1011,9 +1412,8 @@ fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 	/* remove entries */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM approved_firmware;",
-				 -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"DELETE FROM approved_firmware;", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to delete approved firmware: %s",
@@ -1041,7 +1441,7 @@ fu_history_add_approved_firmware (FuHistory *self,
 				  GError **error)
 {
 	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -1054,9 +1454,9 @@ fu_history_add_approved_firmware (FuHistory *self,
 	/* add */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "INSERT INTO approved_firmware (checksum) "
-				 "VALUES (?1)", -1, &stmt, NULL);
+	rc = fu_history_prepare_cached (self,
+					"INSERT INTO approved_firmware (checksum) "
+					"VALUES (?1)", &stmt);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 			     "Failed to prepare SQL to insert checksum: %s",
@@ -1067,6 +1467,195 @@ fu_history_add_approved_firmware (FuHistory *self,
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
+/**
+ * fu_history_add_durations:
+ * @self: A #FuHistory
+ * @plugin: a plugin name
+ * @guid: the default device GUID
+ * @durations: the phase durations of a successful install
+ * @error: A #GError or NULL
+ *
+ * Records how long each phase of an install took, keeping only the most
+ * recent installs for each plugin and GUID.
+ *
+ * Returns: #TRUE for success, #FALSE for failure
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_history_add_durations (FuHistory *self,
+			  const gchar *plugin,
+			  const gchar *guid,
+			  const FuHistoryDurations *durations,
+			  GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+	g_return_val_if_fail (plugin != NULL, FALSE);
+	g_return_val_if_fail (guid != NULL, FALSE);
+	g_return_val_if_fail (durations != NULL, FALSE);
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	/* add */
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	rc = fu_history_prepare_cached (self,
+					"INSERT INTO durations (plugin,"
+								"guid,"
+								"detach,"
+								"write,"
+								"attach,"
+								"verify,"
+								"bytes) "
+					"VALUES (?1,?2,?3,?4,?5,?6,?7)", &stmt);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL to insert durations: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	sqlite3_bind_text (stmt, 1, plugin, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 2, guid, -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (stmt, 3, durations->detach);
+	sqlite3_bind_int64 (stmt, 4, durations->write);
+	sqlite3_bind_int64 (stmt, 5, durations->attach);
+	sqlite3_bind_int64 (stmt, 6, durations->verify);
+	sqlite3_bind_int64 (stmt, 7, durations->bytes);
+	if (!fu_history_stmt_exec (self, stmt, NULL, error))
+		return FALSE;
+
+	/* prune the oldest */
+	rc = fu_history_prepare_cached (self,
+					"DELETE FROM durations WHERE plugin = ?1 AND guid = ?2 "
+					"AND rowid NOT IN (SELECT rowid FROM durations "
+					"WHERE plugin = ?1 AND guid = ?2 "
+					"ORDER BY rowid DESC LIMIT ?3)", &stmt);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL to prune durations: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	sqlite3_bind_text (stmt, 1, plugin, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 2, guid, -1, SQLITE_STATIC);
+	sqlite3_bind_int (stmt, 3, FU_HISTORY_DURATIONS_MAX);
+	return fu_history_stmt_exec (self, stmt, NULL, error);
+}
+
+static gint
+fu_history_durations_sort_cb (gconstpointer a, gconstpointer b)
+{
+	guint64 val_a = *((const guint64 *) a);
+	guint64 val_b = *((const guint64 *) b);
+	if (val_a < val_b)
+		return -1;
+	if (val_a > val_b)
+		return 1;
+	return 0;
+}
+
+static guint64
+fu_history_durations_median (GArray *array)
+{
+	g_array_sort (array, fu_history_durations_sort_cb);
+	return g_array_index (array, guint64, array->len / 2);
+}
+
+/**
+ * fu_history_get_durations:
+ * @self: A #FuHistory
+ * @plugin: a plugin name
+ * @guid: the default device GUID
+ * @durations: (out): the median duration of each phase
+ * @error: A #GError or NULL
+ *
+ * Gets the median duration of each install phase from the recent successful
+ * installs for the plugin and GUID.
+ *
+ * Returns: #TRUE for success, #FALSE if there is no data
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_history_get_durations (FuHistory *self,
+			  const gchar *plugin,
+			  const gchar *guid,
+			  FuHistoryDurations *durations,
+			  GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+	g_autoptr(GArray) detach = g_array_new (FALSE, FALSE, sizeof(guint64));
+	g_autoptr(GArray) write = g_array_new (FALSE, FALSE, sizeof(guint64));
+	g_autoptr(GArray) attach = g_array_new (FALSE, FALSE, sizeof(guint64));
+	g_autoptr(GArray) verify = g_array_new (FALSE, FALSE, sizeof(guint64));
+	g_autoptr(GArray) bytes = g_array_new (FALSE, FALSE, sizeof(guint64));
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+	g_return_val_if_fail (plugin != NULL, FALSE);
+	g_return_val_if_fail (guid != NULL, FALSE);
+	g_return_val_if_fail (durations != NULL, FALSE);
+
+	/* lazy load */
+	if (self->db == NULL) {
+		if (!fu_history_load (self, error))
+			return FALSE;
+	}
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	rc = fu_history_prepare_cached (self,
+					"SELECT detach, write, attach, verify, bytes "
+					"FROM durations WHERE plugin = ?1 AND guid = ?2", &stmt);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to prepare SQL to get durations: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	sqlite3_bind_text (stmt, 1, plugin, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 2, guid, -1, SQLITE_STATIC);
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		guint64 tmp;
+		tmp = sqlite3_column_int64 (stmt, 0);
+		g_array_append_val (detach, tmp);
+		tmp = sqlite3_column_int64 (stmt, 1);
+		g_array_append_val (write, tmp);
+		tmp = sqlite3_column_int64 (stmt, 2);
+		g_array_append_val (attach, tmp);
+		tmp = sqlite3_column_int64 (stmt, 3);
+		g_array_append_val (verify, tmp);
+		tmp = sqlite3_column_int64 (stmt, 4);
+		g_array_append_val (bytes, tmp);
+	}
+	sqlite3_reset (stmt);
+	sqlite3_clear_bindings (stmt);
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
+			     "failed to execute prepared statement: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	if (detach->len == 0) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND,
+			     "no durations for %s:%s", plugin, guid);
+		return FALSE;
+	}
+	durations->detach = fu_history_durations_median (detach);
+	durations->write = fu_history_durations_median (write);
+	durations->attach = fu_history_durations_median (attach);
+	durations->verify = fu_history_durations_median (verify);
+	durations->bytes = fu_history_durations_median (bytes);
+	return TRUE;
+}
+
 static void
 fu_history_class_init (FuHistoryClass *klass)
 {
@@ -1078,6 +1667,8 @@ static void
 fu_history_init (FuHistory *self)
 {
 	g_rw_lock_init (&self->db_mutex);
+	self->stmts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+					     (GDestroyNotify) sqlite3_finalize);
 }
 
 static void
@@ -1087,6 +1678,7 @@ fu_history_finalize (GObject *object)
 
 	g_rw_lock_clear (&self->db_mutex);
 
+	g_hash_table_unref (self->stmts);
 	if (self->db != NULL)
 		sqlite3_close (self->db);
 
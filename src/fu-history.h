@@ -13,8 +13,23 @@
 #define FU_TYPE_PENDING (fu_history_get_type ())
 G_DECLARE_FINAL_TYPE (FuHistory, fu_history, FU, HISTORY, GObject)
 
+/* all durations are in milliseconds */
+typedef struct {
+	guint64		 detach;
+	guint64		 write;
+	guint64		 attach;
+	guint64		 verify;
+	guint64		 bytes;
+} FuHistoryDurations;
+
 FuHistory	*fu_history_new				(void);
 
+gboolean	 fu_history_start_transaction		(FuHistory	*self,
+							 GError		**error);
+gboolean	 fu_history_commit_transaction		(FuHistory	*self,
+							 GError		**error);
+void		 fu_history_rollback_transaction	(FuHistory	*self);
+
 gboolean	 fu_history_add_device			(FuHistory	*self,
 							 FuDevice	*device,
 							 FwupdRelease	*release,
@@ -39,6 +54,16 @@ FuDevice	*fu_history_get_device_by_id		(FuHistory	*self,
 							 GError		**error);
 GPtrArray	*fu_history_get_devices			(FuHistory	*self,
 							 GError		**error);
+GPtrArray	*fu_history_get_devices_range		(FuHistory	*self,
+							 guint		 limit,
+							 guint		 offset,
+							 GError		**error);
+gboolean	 fu_history_prune			(FuHistory	*self,
+							 guint64	 max_age,
+							 guint		 max_entries,
+							 GError		**error);
+gboolean	 fu_history_vacuum			(FuHistory	*self,
+							 GError		**error);
 
 gboolean	 fu_history_clear_approved_firmware	(FuHistory	*self,
 							 GError		**error);
@@ -47,3 +72,14 @@ gboolean	 fu_history_add_approved_firmware	(FuHistory	*self,
 							 GError		**error);
 GPtrArray	*fu_history_get_approved_firmware	(FuHistory	*self,
 							 GError		**error);
+
+gboolean	 fu_history_add_durations		(FuHistory	*self,
+							 const gchar	*plugin,
+							 const gchar	*guid,
+							 const FuHistoryDurations *durations,
+							 GError		**error);
+gboolean	 fu_history_get_durations		(FuHistory	*self,
+							 const gchar	*plugin,
+							 const gchar	*guid,
+							 FuHistoryDurations *durations,
+							 GError		**error);
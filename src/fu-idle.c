@@ -20,7 +20,9 @@ struct _FuIdle
 	GObject			 parent_instance;
 	GPtrArray		*items;	/* of FuIdleItem */
 	GRWLock			 items_mutex;
+	GPtrArray		*tasks;	/* of FuIdleTask */
 	guint			 idle_id;
+	guint			 task_id;
 	guint			 timeout;
 	FwupdStatus		 status;
 };
@@ -60,6 +62,15 @@ typedef struct {
 	guint32			 token;
 } FuIdleItem;
 
+typedef struct {
+	gchar			*id;
+	FuIdleTaskFunc		 func;
+	gpointer		 user_data;
+} FuIdleTask;
+
+/* how long the daemon has to be quiet before background work starts */
+#define FU_IDLE_TASK_DELAY			5 /* s */
+
 G_DEFINE_TYPE (FuIdle, fu_idle, G_TYPE_OBJECT)
 
 FwupdStatus
@@ -106,13 +117,83 @@ fu_idle_stop (FuIdle *self)
 	self->idle_id = 0;
 }
 
+static void fu_idle_task_start (FuIdle *self);
+
+static gboolean
+fu_idle_task_cb (gpointer user_data)
+{
+	FuIdle *self = FU_IDLE (user_data);
+	FuIdleTask *task;
+	FuIdleTaskFunc func;
+	gpointer task_data;
+
+	/* run one task per quiet period so a method call can get in between */
+	self->task_id = 0;
+	if (self->items->len > 0 || self->tasks->len == 0)
+		return G_SOURCE_REMOVE;
+	task = g_ptr_array_index (self->tasks, 0);
+	g_debug ("running idle task %s", task->id);
+	func = task->func;
+	task_data = task->user_data;
+	g_ptr_array_remove_index (self->tasks, 0);
+	func (task_data);
+	fu_idle_task_start (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_idle_task_start (FuIdle *self)
+{
+	if (self->task_id != 0)
+		return;
+	if (self->tasks->len == 0)
+		return;
+	self->task_id = g_timeout_add_seconds (FU_IDLE_TASK_DELAY, fu_idle_task_cb, self);
+}
+
+static void
+fu_idle_task_stop (FuIdle *self)
+{
+	if (self->task_id == 0)
+		return;
+	g_source_remove (self->task_id);
+	self->task_id = 0;
+}
+
 void
 fu_idle_reset (FuIdle *self)
 {
 	g_return_if_fail (FU_IS_IDLE (self));
 	fu_idle_stop (self);
-	if (self->items->len == 0)
+	fu_idle_task_stop (self);
+	if (self->items->len == 0) {
 		fu_idle_start (self);
+		fu_idle_task_start (self);
+	}
+}
+
+/* run @func once the daemon has been quiet for a few seconds; a task with
+ * the same @id as one already pending is not added again */
+void
+fu_idle_add_task (FuIdle *self, const gchar *id, FuIdleTaskFunc func, gpointer user_data)
+{
+	FuIdleTask *task;
+
+	g_return_if_fail (FU_IS_IDLE (self));
+	g_return_if_fail (id != NULL);
+	g_return_if_fail (func != NULL);
+
+	for (guint i = 0; i < self->tasks->len; i++) {
+		FuIdleTask *task_tmp = g_ptr_array_index (self->tasks, i);
+		if (g_strcmp0 (task_tmp->id, id) == 0)
+			return;
+	}
+	task = g_new0 (FuIdleTask, 1);
+	task->id = g_strdup (id);
+	task->func = func;
+	task->user_data = user_data;
+	g_ptr_array_add (self->tasks, task);
+	fu_idle_reset (self);
 }
 
 void
@@ -170,6 +251,13 @@ fu_idle_item_free (FuIdleItem *item)
 	g_free (item);
 }
 
+static void
+fu_idle_task_free (FuIdleTask *task)
+{
+	g_free (task->id);
+	g_free (task);
+}
+
 FuIdleLocker *
 fu_idle_locker_new (FuIdle *self, const gchar *reason)
 {
@@ -213,6 +301,7 @@ fu_idle_init (FuIdle *self)
 {
 	self->status = FWUPD_STATUS_IDLE;
 	self->items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_idle_item_free);
+	self->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_idle_task_free);
 	g_rw_lock_init (&self->items_mutex);
 }
 
@@ -222,8 +311,10 @@ fu_idle_finalize (GObject *obj)
 	FuIdle *self = FU_IDLE (obj);
 
 	fu_idle_stop (self);
+	fu_idle_task_stop (self);
 	g_rw_lock_clear (&self->items_mutex);
 	g_ptr_array_unref (self->items);
+	g_ptr_array_unref (self->tasks);
 
 	G_OBJECT_CLASS (fu_idle_parent_class)->finalize (obj);
 }
@@ -14,6 +14,8 @@
 #define FU_TYPE_IDLE (fu_idle_get_type ())
 G_DECLARE_FINAL_TYPE (FuIdle, fu_idle, FU, IDLE, GObject)
 
+typedef void	(*FuIdleTaskFunc)		(gpointer	 user_data);
+
 FuIdle		*fu_idle_new			(void);
 guint32		 fu_idle_inhibit		(FuIdle		*self,
 						 const gchar	*reason);
@@ -22,6 +24,10 @@ void		 fu_idle_uninhibit		(FuIdle		*self,
 void		 fu_idle_set_timeout		(FuIdle		*self,
 						 guint		 timeout);
 void		 fu_idle_reset			(FuIdle		*self);
+void		 fu_idle_add_task		(FuIdle		*self,
+						 const gchar	*id,
+						 FuIdleTaskFunc	 func,
+						 gpointer	 user_data);
 FwupdStatus	 fu_idle_get_status		(FuIdle		*self);
 
 /**
@@ -20,6 +20,7 @@ struct _FuInstallTask
 	GObject			 parent_instance;
 	FuDevice		*device;
 	XbNode			*component;
+	GBytes			*blob_cab;	/* (nullable) */
 	FwupdReleaseFlags		 trust_flags;
 	gboolean		 is_downgrade;
 };
@@ -56,6 +57,39 @@ fu_install_task_get_component (FuInstallTask *self)
 	return self->component;
 }
 
+/**
+ * fu_install_task_get_blob_cab:
+ * @self: A #FuInstallTask
+ *
+ * Gets the cabinet archive the component was loaded from, if it differs from
+ * the one passed to fu_engine_install_tasks().
+ *
+ * Returns: (transfer none): the archive data, or %NULL if unset
+ **/
+GBytes *
+fu_install_task_get_blob_cab (FuInstallTask *self)
+{
+	g_return_val_if_fail (FU_IS_INSTALL_TASK (self), NULL);
+	return self->blob_cab;
+}
+
+/**
+ * fu_install_task_set_blob_cab:
+ * @self: A #FuInstallTask
+ * @blob_cab: (nullable): the archive data
+ *
+ * Sets the cabinet archive the component was loaded from, which allows tasks
+ * from different archives to be installed in the same transaction.
+ **/
+void
+fu_install_task_set_blob_cab (FuInstallTask *self, GBytes *blob_cab)
+{
+	g_return_if_fail (FU_IS_INSTALL_TASK (self));
+	if (self->blob_cab != NULL)
+		g_bytes_unref (self->blob_cab);
+	self->blob_cab = blob_cab != NULL ? g_bytes_ref (blob_cab) : NULL;
+}
+
 /**
  * fu_install_task_get_trust_flags:
  * @self: A #FuInstallTask
@@ -441,6 +475,8 @@ fu_install_task_finalize (GObject *object)
 
 	if (self->component != NULL)
 		g_object_unref (self->component);
+	if (self->blob_cab != NULL)
+		g_bytes_unref (self->blob_cab);
 	if (self->device != NULL)
 		g_object_unref (self->device);
 
@@ -459,7 +495,8 @@ fu_install_task_class_init (FuInstallTaskClass *klass)
  * @task1: first #FuInstallTask to compare.
  * @task2: second #FuInstallTask to compare.
  *
- * Compares two install tasks.
+ * Compares two install tasks by the device order, and then so that the
+ * device with the longest expected install duration comes first.
  *
  * Returns: 1, 0 or -1 if @task1 is greater, equal, or less than @task2, respectively.
  **/
@@ -472,6 +509,12 @@ fu_install_task_compare (FuInstallTask *task1, FuInstallTask *task2)
 		return -1;
 	if (fu_device_get_order (device1) > fu_device_get_order (device2))
 		return 1;
+
+	/* start the longest install first */
+	if (fu_device_get_install_duration (device1) > fu_device_get_install_duration (device2))
+		return -1;
+	if (fu_device_get_install_duration (device1) < fu_device_get_install_duration (device2))
+		return 1;
 	return 0;
 }
 
@@ -18,6 +18,9 @@ FuInstallTask	*fu_install_task_new			(FuDevice	*device,
 							 XbNode		*component);
 FuDevice	*fu_install_task_get_device		(FuInstallTask	*self);
 XbNode		*fu_install_task_get_component		(FuInstallTask	*self);
+GBytes		*fu_install_task_get_blob_cab		(FuInstallTask	*self);
+void		 fu_install_task_set_blob_cab		(FuInstallTask	*self,
+							 GBytes		*blob_cab);
 FwupdReleaseFlags fu_install_task_get_trust_flags	(FuInstallTask	*self);
 gboolean	 fu_install_task_get_is_downgrade	(FuInstallTask	*self);
 gboolean	 fu_install_task_check_requirements	(FuInstallTask	*self,
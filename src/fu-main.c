@@ -10,13 +10,20 @@
 
 #include <xmlb.h>
 #include <fwupd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <gio/gunixfdlist.h>
+#include <gio/gunixsocketaddress.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <glib-unix.h>
 #include <locale.h>
 #include <polkit/polkit.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <jcat.h>
 
 #include "fwupd-device-private.h"
@@ -30,7 +37,10 @@
 #include "fu-device-private.h"
 #include "fu-engine.h"
 #include "fu-install-task.h"
+#include "fu-metrics.h"
+#include "fu-plugin-private.h"
 #include "fu-security-attrs-private.h"
+#include "fu-trace.h"
 
 #ifndef HAVE_POLKIT_0_114
 #pragma clang diagnostic push
@@ -40,6 +50,12 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(PolkitSubject, g_object_unref)
 #pragma clang diagnostic pop
 #endif
 
+typedef struct {
+	guint64			 generation;
+	FwupdDeviceFlags	 device_flags;
+	GVariant		*val;		/* (nullable) */
+} FuMainDevicesCache;
+
 typedef struct {
 	GDBusConnection		*connection;
 	GDBusNodeInfo		*introspection_daemon;
@@ -47,6 +63,10 @@ typedef struct {
 	GMainLoop		*loop;
 	GFileMonitor		*argv0_monitor;
 	GHashTable		*sender_features;	/* sender:FwupdFeatureFlags */
+	GHashTable		*sender_interests;	/* sender:FuMainInterest */
+	GHashTable		*device_variants;	/* device-id:GVariant last emitted */
+	GHashTable		*auth_cache;		/* sender\taction-id:expiry */
+	guint			 name_owner_changed_id;
 #if GLIB_CHECK_VERSION(2,63,3)
 	GMemoryMonitor		*memory_monitor;
 #endif
@@ -55,8 +75,143 @@ typedef struct {
 	FuEngine		*engine;
 	gboolean		 update_in_progress;
 	gboolean		 pending_sigterm;
+	guint64			 releases_generation;
+	guint64			 devices_generation;
+	FuMainDevicesCache	 devices_cache;
+	FuMainDevicesCache	 devices_cache_compact;
+	GPtrArray		*pending_calls;		/* of FuMainPendingCall */
+	GMutex			 loading_mutex;		/* for loading */
+	gboolean		 loading;
+	GVariant		*snapshot;		/* (nullable): a{sv} from the last run */
+	guint			 loading_filter_id;
+	GSocketService		*metrics_service;	/* (nullable) */
 } FuMainPrivate;
 
+typedef struct {
+	GDBusConnection		*connection;
+	gchar			*sender;
+	gchar			*object_path;
+	gchar			*interface_name;
+	gchar			*method_name;
+	GVariant		*parameters;
+	GDBusMethodInvocation	*invocation;
+} FuMainPendingCall;
+
+static void
+fu_main_pending_call_free (FuMainPendingCall *call)
+{
+	g_object_unref (call->connection);
+	g_free (call->sender);
+	g_free (call->object_path);
+	g_free (call->interface_name);
+	g_free (call->method_name);
+	g_variant_unref (call->parameters);
+	g_object_unref (call->invocation);
+	g_free (call);
+}
+
+/* what a client registered with SetDeviceInterest(), where a device
+ * matches if any of the criteria match */
+typedef struct {
+	gchar			**device_ids;	/* (nullable): prefixes */
+	gchar			**plugins;	/* (nullable) */
+	guint64			 flags;		/* FwupdDeviceFlags, any of */
+} FuMainInterest;
+
+static void
+fu_main_interest_free (FuMainInterest *interest)
+{
+	g_strfreev (interest->device_ids);
+	g_strfreev (interest->plugins);
+	g_free (interest);
+}
+
+static FuMainInterest *
+fu_main_interest_new (GVariant *dict)
+{
+	FuMainInterest *interest = g_new0 (FuMainInterest, 1);
+	g_variant_lookup (dict, "DeviceIds", "^as", &interest->device_ids);
+	g_variant_lookup (dict, "Plugins", "^as", &interest->plugins);
+	g_variant_lookup (dict, "Flags", "t", &interest->flags);
+	if ((interest->device_ids == NULL || interest->device_ids[0] == NULL) &&
+	    (interest->plugins == NULL || interest->plugins[0] == NULL) &&
+	    interest->flags == 0) {
+		fu_main_interest_free (interest);
+		return NULL;
+	}
+	return interest;
+}
+
+static gboolean
+fu_main_interest_matches (FuMainInterest *interest, FuDevice *device)
+{
+	if (interest->device_ids != NULL) {
+		for (guint i = 0; interest->device_ids[i] != NULL; i++) {
+			if (g_str_has_prefix (fu_device_get_id (device),
+					      interest->device_ids[i]))
+				return TRUE;
+		}
+	}
+	if (interest->plugins != NULL &&
+	    g_strv_contains ((const gchar * const *) interest->plugins,
+			     fu_device_get_plugin (device)))
+		return TRUE;
+	return (fu_device_get_flags (device) & interest->flags) > 0;
+}
+
+static void
+fu_main_set_interest (FuMainPrivate *priv, const gchar *sender, GVariant *dict)
+{
+	FuMainInterest *interest = fu_main_interest_new (dict);
+
+	/* an empty dictionary goes back to broadcast only */
+	if (interest == NULL) {
+		g_hash_table_remove (priv->sender_interests, sender);
+		return;
+	}
+	g_hash_table_insert (priv->sender_interests, g_strdup (sender), interest);
+}
+
+/* a unicast copy of the signal for each client interested in @device, so
+ * that clients filtering with a destination match rule are only woken up
+ * for the devices they care about */
+static void
+fu_main_emit_device_interest (FuMainPrivate *priv,
+			      FuDevice *device,
+			      const gchar *signal_name,
+			      GVariant *val,
+			      gboolean skip_partial)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, priv->sender_interests);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *sender = (const gchar *) key;
+		FuMainInterest *interest = (FuMainInterest *) value;
+		if (!fu_main_interest_matches (interest, device))
+			continue;
+
+		/* already sent DeviceChangedPartial */
+		if (skip_partial) {
+			guint64 *feature_flags = g_hash_table_lookup (priv->sender_features, sender);
+			if (feature_flags != NULL &&
+			    (*feature_flags & FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL) > 0)
+				continue;
+		}
+		g_dbus_connection_emit_signal (priv->connection,
+					       sender,
+					       FWUPD_DBUS_PATH,
+					       FWUPD_DBUS_INTERFACE,
+					       signal_name,
+					       g_variant_new_tuple (&val, 1), NULL);
+	}
+}
+
+static void fu_main_emit_releases_generation (FuMainPrivate *priv);
+static void fu_main_emit_devices_generation (FuMainPrivate *priv);
+
 static gboolean
 fu_main_sigterm_cb (gpointer user_data)
 {
@@ -73,8 +228,8 @@ fu_main_sigterm_cb (gpointer user_data)
 static void
 fu_main_engine_changed_cb (FuEngine *engine, FuMainPrivate *priv)
 {
-	/* not yet connected */
-	if (priv->connection == NULL)
+	/* not yet connected, or answering from the snapshot */
+	if (priv->connection == NULL || priv->loading)
 		return;
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
@@ -82,6 +237,7 @@ fu_main_engine_changed_cb (FuEngine *engine, FuMainPrivate *priv)
 				       FWUPD_DBUS_INTERFACE,
 				       "Changed",
 				       NULL, NULL);
+	fu_main_emit_releases_generation (priv);
 }
 
 static void
@@ -91,16 +247,23 @@ fu_main_engine_device_added_cb (FuEngine *engine,
 {
 	GVariant *val;
 
-	/* not yet connected */
-	if (priv->connection == NULL)
+	/* not yet connected, or answering from the snapshot */
+	if (priv->connection == NULL || priv->loading)
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
+	val = g_variant_ref_sink (fwupd_device_to_variant (FWUPD_DEVICE (device)));
+	g_hash_table_insert (priv->device_variants,
+			     g_strdup (fu_device_get_id (device)),
+			     g_variant_ref (val));
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
 				       FWUPD_DBUS_INTERFACE,
 				       "DeviceAdded",
 				       g_variant_new_tuple (&val, 1), NULL);
+	fu_main_emit_device_interest (priv, device, "DeviceAdded", val, FALSE);
+	g_variant_unref (val);
+	fu_main_emit_releases_generation (priv);
+	fu_main_emit_devices_generation (priv);
 }
 
 static void
@@ -108,18 +271,62 @@ fu_main_engine_device_removed_cb (FuEngine *engine,
 				  FuDevice *device,
 				  FuMainPrivate *priv)
 {
-	GVariant *val;
+	g_autoptr(GVariant) val = NULL;
 
-	/* not yet connected */
-	if (priv->connection == NULL)
+	/* not yet connected, or answering from the snapshot */
+	if (priv->connection == NULL || priv->loading)
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
+	g_hash_table_remove (priv->device_variants, fu_device_get_id (device));
+	val = g_variant_ref_sink (fwupd_device_to_variant (FWUPD_DEVICE (device)));
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
 				       FWUPD_DBUS_INTERFACE,
 				       "DeviceRemoved",
 				       g_variant_new_tuple (&val, 1), NULL);
+	fu_main_emit_device_interest (priv, device, "DeviceRemoved", val, FALSE);
+	fu_main_emit_releases_generation (priv);
+	fu_main_emit_devices_generation (priv);
+}
+
+/* only the keys that differ from what was last emitted, and the device ID */
+static GVariant *
+fu_main_device_variant_diff (GVariant *val_old, GVariant *val, const gchar *device_id)
+{
+	GVariantBuilder builder;
+	GVariantBuilder removed;
+	GVariantIter iter;
+	GVariant *value_tmp;
+	const gchar *key;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}",
+			       FWUPD_RESULT_KEY_DEVICE_ID,
+			       g_variant_new_string (device_id));
+	g_variant_iter_init (&iter, val);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value_tmp)) {
+		g_autoptr(GVariant) value = value_tmp;
+		g_autoptr(GVariant) value_old = NULL;
+		if (g_strcmp0 (key, FWUPD_RESULT_KEY_DEVICE_ID) == 0)
+			continue;
+		if (val_old != NULL)
+			value_old = g_variant_lookup_value (val_old, key, NULL);
+		if (value_old != NULL && g_variant_equal (value_old, value))
+			continue;
+		g_variant_builder_add (&builder, "{sv}", key, value);
+	}
+
+	g_variant_builder_init (&removed, G_VARIANT_TYPE_STRING_ARRAY);
+	if (val_old != NULL) {
+		g_variant_iter_init (&iter, val_old);
+		while (g_variant_iter_next (&iter, "{&sv}", &key, &value_tmp)) {
+			g_autoptr(GVariant) value_old = value_tmp;
+			g_autoptr(GVariant) value = g_variant_lookup_value (val, key, NULL);
+			if (value == NULL)
+				g_variant_builder_add (&removed, "s", key);
+		}
+	}
+	return g_variant_new ("(a{sv}as)", &builder, &removed);
 }
 
 static void
@@ -127,18 +334,61 @@ fu_main_engine_device_changed_cb (FuEngine *engine,
 				  FuDevice *device,
 				  FuMainPrivate *priv)
 {
-	GVariant *val;
+	GHashTableIter iter;
+	GVariant *val_old;
+	gpointer key;
+	gpointer value;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_partial = NULL;
+
+	/* not yet connected, or answering from the snapshot */
+	if (priv->connection == NULL || priv->loading)
+		return;
 
-	/* not yet connected */
-	if (priv->connection == NULL)
+	/* nothing that clients can see has changed */
+	val = g_variant_ref_sink (fwupd_device_to_variant (FWUPD_DEVICE (device)));
+	val_old = g_hash_table_lookup (priv->device_variants, fu_device_get_id (device));
+	if (val_old != NULL && g_variant_equal (val_old, val)) {
+		fu_main_emit_releases_generation (priv);
+		fu_main_emit_devices_generation (priv);
 		return;
-	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
+	}
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
 				       FWUPD_DBUS_INTERFACE,
 				       "DeviceChanged",
 				       g_variant_new_tuple (&val, 1), NULL);
+	fu_main_emit_device_interest (priv, device, "DeviceChanged", val, TRUE);
+
+	/* only to the clients that opted in */
+	g_hash_table_iter_init (&iter, priv->sender_features);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *sender = (const gchar *) key;
+		guint64 *feature_flags = (guint64 *) value;
+		FuMainInterest *interest;
+		if ((*feature_flags & FWUPD_FEATURE_FLAG_DEVICE_CHANGED_PARTIAL) == 0)
+			continue;
+		interest = g_hash_table_lookup (priv->sender_interests, sender);
+		if (interest != NULL && !fu_main_interest_matches (interest, device))
+			continue;
+		if (val_partial == NULL) {
+			val_partial = fu_main_device_variant_diff (val_old, val,
+								   fu_device_get_id (device));
+			g_variant_ref_sink (val_partial);
+		}
+		g_dbus_connection_emit_signal (priv->connection,
+					       sender,
+					       FWUPD_DBUS_PATH,
+					       FWUPD_DBUS_INTERFACE,
+					       "DeviceChangedPartial",
+					       val_partial, NULL);
+	}
+	g_hash_table_insert (priv->device_variants,
+			     g_strdup (fu_device_get_id (device)),
+			     g_steal_pointer (&val));
+	fu_main_emit_releases_generation (priv);
+	fu_main_emit_devices_generation (priv);
 }
 
 static void
@@ -149,8 +399,8 @@ fu_main_emit_property_changed (FuMainPrivate *priv,
 	GVariantBuilder builder;
 	GVariantBuilder invalidated_builder;
 
-	/* not yet connected */
-	if (priv->connection == NULL) {
+	/* not yet connected, or answering from the snapshot */
+	if (priv->connection == NULL || priv->loading) {
 		g_variant_unref (g_variant_ref_sink (property_value));
 		return;
 	}
@@ -176,6 +426,36 @@ fu_main_emit_property_changed (FuMainPrivate *priv,
 	g_variant_builder_clear (&invalidated_builder);
 }
 
+static void
+fu_main_emit_releases_generation (FuMainPrivate *priv)
+{
+	guint64 releases_generation = fu_engine_get_releases_generation (priv->engine);
+
+	/* only emit when the cached releases were invalidated */
+	if (priv->releases_generation == releases_generation)
+		return;
+	priv->releases_generation = releases_generation;
+	g_debug ("Emitting PropertyChanged('ReleasesGeneration'='%" G_GUINT64_FORMAT "')",
+		 releases_generation);
+	fu_main_emit_property_changed (priv, "ReleasesGeneration",
+				       g_variant_new_uint64 (releases_generation));
+}
+
+static void
+fu_main_emit_devices_generation (FuMainPrivate *priv)
+{
+	guint64 devices_generation = fu_engine_get_devices_generation (priv->engine);
+
+	/* only emit when the devices were added, removed or changed */
+	if (priv->devices_generation == devices_generation)
+		return;
+	priv->devices_generation = devices_generation;
+	g_debug ("Emitting PropertyChanged('DevicesGeneration'='%" G_GUINT64_FORMAT "')",
+		 devices_generation);
+	fu_main_emit_property_changed (priv, "DevicesGeneration",
+				       g_variant_new_uint64 (devices_generation));
+}
+
 static void
 fu_main_set_status (FuMainPrivate *priv, FwupdStatus status)
 {
@@ -262,6 +542,79 @@ fu_main_device_array_to_variant (FuMainPrivate *priv, FuEngineRequest *request,
 	return g_variant_new ("(aa{sv})", &builder);
 }
 
+static GVariant *
+fu_main_device_array_to_variant_compact (FuEngineRequest *request, GPtrArray *devices)
+{
+	GVariantBuilder builder;
+
+	g_return_val_if_fail (devices->len > 0, NULL);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{qv}"));
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		GVariant *tmp = fwupd_device_to_variant_compact (FWUPD_DEVICE (device),
+								 fu_engine_request_get_device_flags (request));
+		g_variant_builder_add_value (&builder, tmp);
+	}
+	return g_variant_new ("(aa{qv})", &builder);
+}
+
+/* returns the serialized reply if nothing has changed since it was built */
+static GVariant *
+fu_main_devices_cache_lookup (FuMainDevicesCache *cache,
+			      guint64 generation,
+			      FwupdDeviceFlags device_flags)
+{
+	if (cache->val == NULL)
+		return NULL;
+	if (cache->generation != generation || cache->device_flags != device_flags)
+		return NULL;
+	return g_variant_ref (cache->val);
+}
+
+static void
+fu_main_devices_cache_set (FuMainDevicesCache *cache,
+			   guint64 generation,
+			   FwupdDeviceFlags device_flags,
+			   GVariant *val)
+{
+	if (cache->val != NULL)
+		g_variant_unref (cache->val);
+	cache->generation = generation;
+	cache->device_flags = device_flags;
+	cache->val = g_variant_ref_sink (val);
+}
+
+/* returns the cached reply for GetDevices or GetDevicesCompact, building it if required */
+static GVariant *
+fu_main_devices_cache_ensure (FuMainPrivate *priv,
+			      FuEngineRequest *request,
+			      gboolean compact,
+			      GError **error)
+{
+	FuMainDevicesCache *cache = compact ? &priv->devices_cache_compact : &priv->devices_cache;
+	FwupdDeviceFlags device_flags = fu_engine_request_get_device_flags (request);
+	guint64 generation = fu_engine_get_devices_generation (priv->engine);
+	GVariant *val;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	val = fu_main_devices_cache_lookup (cache, generation, device_flags);
+	fu_metrics_cache_lookup ("devices", val != NULL);
+	if (val != NULL)
+		return val;
+	devices = fu_engine_get_devices (priv->engine, error);
+	if (devices == NULL)
+		return NULL;
+	if (compact) {
+		val = fu_main_device_array_to_variant_compact (request, devices);
+	} else {
+		val = fu_main_device_array_to_variant (priv, request, devices, error);
+		if (val == NULL)
+			return NULL;
+	}
+	fu_main_devices_cache_set (cache, generation, device_flags, val);
+	return g_variant_ref (val);
+}
+
 static GVariant *
 fu_main_release_array_to_variant (GPtrArray *results)
 {
@@ -276,6 +629,59 @@ fu_main_release_array_to_variant (GPtrArray *results)
 	return g_variant_new ("(aa{sv})", &builder);
 }
 
+/* only the requested keys are serialized, so that a client showing a short
+ * list of versions does not have to parse every description and checksum */
+static GVariant *
+fu_main_release_array_to_variant_filtered (GPtrArray *results, gchar **keys)
+{
+	GVariantBuilder builder;
+	g_return_val_if_fail (results->len > 0, NULL);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+	for (guint i = 0; i < results->len; i++) {
+		FwupdRelease *rel = g_ptr_array_index (results, i);
+		GVariantBuilder builder_rel;
+		GVariantIter iter;
+		GVariant *value;
+		const gchar *key;
+		g_autoptr(GVariant) tmp = g_variant_ref_sink (fwupd_release_to_variant (rel));
+
+		g_variant_builder_init (&builder_rel, G_VARIANT_TYPE_VARDICT);
+		g_variant_iter_init (&iter, tmp);
+		while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+			if (g_strv_contains ((const gchar * const *) keys, key))
+				g_variant_builder_add (&builder_rel, "{sv}", key, value);
+			g_variant_unref (value);
+		}
+		g_variant_builder_add_value (&builder, g_variant_builder_end (&builder_rel));
+	}
+	return g_variant_new ("(aa{sv})", &builder);
+}
+
+static GVariant *
+fu_main_release_map_to_variant (GHashTable *results)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder;
+	gpointer key;
+	gpointer value;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{saa{sv}}"));
+	g_hash_table_iter_init (&iter, results);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GPtrArray *releases = (GPtrArray *) value;
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("{saa{sv}}"));
+		g_variant_builder_add (&builder, "s", (const gchar *) key);
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("aa{sv}"));
+		for (guint i = 0; i < releases->len; i++) {
+			FwupdRelease *rel = g_ptr_array_index (releases, i);
+			g_variant_builder_add_value (&builder, fwupd_release_to_variant (rel));
+		}
+		g_variant_builder_close (&builder);
+		g_variant_builder_close (&builder);
+	}
+	return g_variant_new ("(a{saa{sv}})", &builder);
+}
+
 static GVariant *
 fu_main_remote_array_to_variant (GPtrArray *remotes)
 {
@@ -318,6 +724,7 @@ typedef struct {
 	gchar			*remote_id;
 	gchar			*key;
 	gchar			*value;
+	gchar			*action_id;	/* being authorized */
 	XbSilo			*silo;
 } FuMainAuthHelper;
 
@@ -342,6 +749,7 @@ fu_main_auth_helper_free (FuMainAuthHelper *helper)
 	g_free (helper->remote_id);
 	g_free (helper->key);
 	g_free (helper->value);
+	g_free (helper->action_id);
 	g_object_unref (helper->invocation);
 	g_free (helper);
 }
@@ -564,6 +972,55 @@ fu_main_authorize_modify_remote_cb (GObject *source, GAsyncResult *res, gpointer
 	g_dbus_method_invocation_return_value (helper->invocation, NULL);
 }
 
+/* an install of several devices, or several installs from an agent in quick
+ * succession, only need one polkit round trip for each action ID */
+#define FU_MAIN_AUTH_CACHE_TIMEOUT		10 /* s */
+
+static gchar *
+fu_main_auth_cache_key (const gchar *sender, const gchar *action_id)
+{
+	return g_strdup_printf ("%s\t%s", sender, action_id);
+}
+
+static gboolean
+fu_main_auth_cache_lookup (FuMainPrivate *priv, const gchar *sender, const gchar *action_id)
+{
+	gint64 *expiry;
+	g_autofree gchar *key = fu_main_auth_cache_key (sender, action_id);
+
+	expiry = g_hash_table_lookup (priv->auth_cache, key);
+	if (expiry == NULL)
+		return FALSE;
+	if (g_get_monotonic_time () > *expiry) {
+		g_hash_table_remove (priv->auth_cache, key);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+fu_main_auth_cache_add (FuMainPrivate *priv, const gchar *sender, const gchar *action_id)
+{
+	gint64 expiry = g_get_monotonic_time () + FU_MAIN_AUTH_CACHE_TIMEOUT * G_USEC_PER_SEC;
+	g_hash_table_insert (priv->auth_cache,
+			     fu_main_auth_cache_key (sender, action_id),
+			     g_memdup (&expiry, sizeof(expiry)));
+}
+
+static void
+fu_main_auth_cache_remove_sender (FuMainPrivate *priv, const gchar *sender)
+{
+	GHashTableIter iter;
+	gpointer key;
+	g_autofree gchar *prefix = g_strdup_printf ("%s\t", sender);
+
+	g_hash_table_iter_init (&iter, priv->auth_cache);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		if (g_str_has_prefix ((const gchar *) key, prefix))
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
 static void fu_main_authorize_install_queue (FuMainAuthHelper *helper);
 
 static void
@@ -581,6 +1038,9 @@ fu_main_authorize_install_cb (GObject *source, GAsyncResult *res, gpointer user_
 		g_dbus_method_invocation_return_gerror (helper->invocation, error);
 		return;
 	}
+	fu_main_auth_cache_add (helper->priv,
+				g_dbus_method_invocation_get_sender (helper->invocation),
+				helper->action_id);
 
 	/* do the next authentication action ID */
 	fu_main_authorize_install_queue (g_steal_pointer (&helper));
@@ -595,12 +1055,21 @@ fu_main_authorize_install_queue (FuMainAuthHelper *helper_ref)
 	gboolean ret;
 
 	/* still more things to to authenticate */
-	if (helper->action_ids->len > 0) {
-		g_autofree gchar *action_id = g_strdup (g_ptr_array_index (helper->action_ids, 0));
-		g_autoptr(PolkitSubject) subject = g_object_ref (helper->subject);
+	while (helper->action_ids->len > 0) {
+		const gchar *sender = g_dbus_method_invocation_get_sender (helper->invocation);
+		g_autoptr(PolkitSubject) subject = NULL;
+
+		/* recently authorized for the same sender */
+		g_free (helper->action_id);
+		helper->action_id = g_strdup (g_ptr_array_index (helper->action_ids, 0));
 		g_ptr_array_remove_index (helper->action_ids, 0);
+		if (fu_main_auth_cache_lookup (priv, sender, helper->action_id)) {
+			g_debug ("using cached authorization for %s", helper->action_id);
+			continue;
+		}
+		subject = g_object_ref (helper->subject);
 		polkit_authority_check_authorization (priv->authority, subject,
-						      action_id, NULL,
+						      helper->action_id, NULL,
 						      POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
 						      NULL,
 						      fu_main_authorize_install_cb,
@@ -608,6 +1077,15 @@ fu_main_authorize_install_queue (FuMainAuthHelper *helper_ref)
 		return;
 	}
 
+	/* build the device list now so it can be returned during the update */
+	for (guint i = 0; i < 2; i++) {
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GVariant) val = NULL;
+		val = fu_main_devices_cache_ensure (priv, helper->request, i == 1, &error_local);
+		if (val == NULL)
+			g_debug ("failed to prime devices cache: %s", error_local->message);
+	}
+
 	/* all authenticated, so install all the things */
 	priv->update_in_progress = TRUE;
 	ret = fu_engine_install_tasks (helper->priv->engine,
@@ -619,13 +1097,13 @@ fu_main_authorize_install_queue (FuMainAuthHelper *helper_ref)
 	priv->update_in_progress = FALSE;
 	if (priv->pending_sigterm)
 		g_main_loop_quit (priv->loop);
-	if (!ret) {
+	if (!ret)
 		g_dbus_method_invocation_return_gerror (helper->invocation, error);
-		return;
-	}
+	else
+		g_dbus_method_invocation_return_value (helper->invocation, NULL);
 
-	/* success */
-	g_dbus_method_invocation_return_value (helper->invocation, NULL);
+	/* anything that arrived during the update */
+	fu_main_replay_pending_calls (priv);
 }
 
 #if !GLIB_CHECK_VERSION(2,54,0)
@@ -810,6 +1288,163 @@ fu_main_device_id_valid (const gchar *device_id, GError **error)
 	return FALSE;
 }
 
+/* large replies can optionally be returned in a sealed memfd rather than
+ * inline, which saves the bus copying them and avoids the message size limit;
+ * the caller uses the base method name with an "Fd" suffix */
+static const gchar *
+fu_main_method_name_strip_fd (const gchar *method_name, gboolean *as_fd)
+{
+	const gchar *methods[] = {
+		"GetDetails",
+		"GetDevices",
+		"GetDevicesCompact",
+		"GetHistory",
+		"GetReportMetadata",
+		NULL };
+	for (guint i = 0; methods[i] != NULL; i++) {
+		gsize len = strlen (methods[i]);
+		if (strncmp (method_name, methods[i], len) == 0 &&
+		    g_strcmp0 (method_name + len, "Fd") == 0) {
+			*as_fd = TRUE;
+			return methods[i];
+		}
+	}
+	return method_name;
+}
+
+static gint
+fu_main_memfd_new_for_variant (GVariant *val, GError **error)
+{
+	gsize bufsz = g_variant_get_size (val);
+	gpointer buf;
+	gint fd;
+
+	fd = memfd_create ("fwupd-reply", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "failed to create memfd: %s",
+			     g_strerror (errno));
+		return -1;
+	}
+
+	/* serialize directly into the file, then unmap so it can be sealed */
+	if (bufsz > 0) {
+		if (ftruncate (fd, bufsz) < 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "failed to resize memfd: %s",
+				     g_strerror (errno));
+			close (fd);
+			return -1;
+		}
+		buf = mmap (NULL, bufsz, PROT_WRITE, MAP_SHARED, fd, 0);
+		if (buf == MAP_FAILED) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "failed to map memfd: %s",
+				     g_strerror (errno));
+			close (fd);
+			return -1;
+		}
+		g_variant_store (val, buf);
+		munmap (buf, bufsz);
+	}
+	if (fcntl (fd, F_ADD_SEALS,
+		   F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "failed to seal memfd: %s",
+			     g_strerror (errno));
+		close (fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* takes ownership of @val if floating */
+static void
+fu_main_invocation_return_value (GDBusMethodInvocation *invocation,
+				 GVariant *val,
+				 gboolean as_fd)
+{
+	gint fd;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+	g_autoptr(GVariant) val_sunk = g_variant_ref_sink (val);
+
+	if (!as_fd) {
+		g_dbus_method_invocation_return_value (invocation, val_sunk);
+		return;
+	}
+	fd = fu_main_memfd_new_for_variant (val_sunk, &error);
+	if (fd < 0) {
+		g_dbus_method_invocation_return_gerror (invocation, error);
+		return;
+	}
+	fd_list = g_unix_fd_list_new_from_array (&fd, 1);
+	g_dbus_method_invocation_return_value_with_unix_fd_list (invocation,
+								 g_variant_new ("(h)", 0),
+								 fd_list);
+}
+
+static gboolean
+fu_main_method_call_is_safe (FuMainPrivate *priv,
+			     FuEngineRequest *request,
+			     const gchar *method_name)
+{
+	if (g_strcmp0 (method_name, "GetDevices") == 0 ||
+	    g_strcmp0 (method_name, "GetDevicesCompact") == 0) {
+		gboolean compact = g_strcmp0 (method_name, "GetDevicesCompact") == 0;
+		FuMainDevicesCache *cache = compact ? &priv->devices_cache_compact : &priv->devices_cache;
+		g_autoptr(GVariant) val = NULL;
+		val = fu_main_devices_cache_lookup (cache,
+						    fu_engine_get_devices_generation (priv->engine),
+						    fu_engine_request_get_device_flags (request));
+		return val != NULL;
+	}
+	return g_strcmp0 (method_name, "GetHistory") == 0 ||
+	       g_strcmp0 (method_name, "GetHistoryRange") == 0 ||
+	       g_strcmp0 (method_name, "GetRemotes") == 0 ||
+	       g_strcmp0 (method_name, "GetTraces") == 0 ||
+	       g_strcmp0 (method_name, "GetPluginStats") == 0 ||
+	       g_strcmp0 (method_name, "GetMetrics") == 0 ||
+	       g_strcmp0 (method_name, "GetMemoryStats") == 0 ||
+	       g_strcmp0 (method_name, "SetFeatureFlags") == 0 ||
+	       g_strcmp0 (method_name, "SetDeviceInterest") == 0;
+}
+
+static void fu_main_daemon_method_call (GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *method_name,
+					GVariant *parameters,
+					GDBusMethodInvocation *invocation,
+					gpointer user_data);
+
+static void
+fu_main_replay_pending_calls (FuMainPrivate *priv)
+{
+	g_autoptr(GPtrArray) calls = g_steal_pointer (&priv->pending_calls);
+	priv->pending_calls = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_main_pending_call_free);
+	for (guint i = 0; i < calls->len; i++) {
+		FuMainPendingCall *call = g_ptr_array_index (calls, i);
+		fu_main_daemon_method_call (call->connection,
+					    call->sender,
+					    call->object_path,
+					    call->interface_name,
+					    call->method_name,
+					    call->parameters,
+					    call->invocation,
+					    priv);
+	}
+}
+
 static void
 fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			    const gchar *object_path, const gchar *interface_name,
@@ -818,6 +1453,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 {
 	FuMainPrivate *priv = (FuMainPrivate *) user_data;
 	GVariant *val = NULL;
+	gboolean as_fd = FALSE;
 	g_autoptr(FuEngineRequest) request = NULL;
 	g_autoptr(GError) error = NULL;
 
@@ -831,10 +1467,54 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	/* activity */
 	fu_engine_idle_reset (priv->engine);
 
-	if (g_strcmp0 (method_name, "GetDevices") == 0) {
-		g_autoptr(GPtrArray) devices = NULL;
+	/* the main loop runs during threaded installs; only answer requests
+	 * that cannot touch the devices being updated */
+	if (priv->update_in_progress &&
+	    !fu_main_method_call_is_safe (priv, request,
+					  fu_main_method_name_strip_fd (method_name, &as_fd))) {
+		FuMainPendingCall *call = g_new0 (FuMainPendingCall, 1);
+		g_debug ("deferring %s() until the update is complete", method_name);
+		call->connection = g_object_ref (connection);
+		call->sender = g_strdup (sender);
+		call->object_path = g_strdup (object_path);
+		call->interface_name = g_strdup (interface_name);
+		call->method_name = g_strdup (method_name);
+		call->parameters = g_variant_ref (parameters);
+		call->invocation = g_object_ref (invocation);
+		g_ptr_array_add (priv->pending_calls, call);
+		return;
+	}
+	method_name = fu_main_method_name_strip_fd (method_name, &as_fd);
+
+	if (g_strcmp0 (method_name, "GetDevices") == 0 ||
+	    g_strcmp0 (method_name, "GetDevicesCompact") == 0) {
+		gboolean compact = g_strcmp0 (method_name, "GetDevicesCompact") == 0;
 		g_debug ("Called %s()", method_name);
-		devices = fu_engine_get_devices (priv->engine, &error);
+		val = fu_main_devices_cache_ensure (priv, request, compact, &error);
+		if (val == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		fu_main_invocation_return_value (invocation, val, as_fd);
+		g_variant_unref (val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetDevicesFiltered") == 0) {
+		const gchar *plugin;
+		const gchar *guid;
+		guint64 include_flags = 0;
+		guint64 exclude_flags = 0;
+		g_autoptr(GPtrArray) devices = NULL;
+		g_variant_get (parameters, "(tt&s&s)",
+			       &include_flags, &exclude_flags, &plugin, &guid);
+		g_debug ("Called %s(0x%" G_GINT64_MODIFIER "x,0x%" G_GINT64_MODIFIER "x,%s,%s)",
+			 method_name, include_flags, exclude_flags, plugin, guid);
+		devices = fu_engine_get_devices_filtered (priv->engine,
+							  include_flags,
+							  exclude_flags,
+							  plugin[0] != '\0' ? plugin : NULL,
+							  guid[0] != '\0' ? guid : NULL,
+							  &error);
 		if (devices == NULL) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
@@ -847,6 +1527,25 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetReleasesFiltered") == 0) {
+		const gchar *device_id;
+		g_autofree gchar **keys = NULL;
+		g_autoptr(GPtrArray) releases = NULL;
+		g_variant_get (parameters, "(&s^a&s)", &device_id, &keys);
+		g_debug ("Called %s(%s)", method_name, device_id);
+		if (!fu_main_device_id_valid (device_id, &error)) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		releases = fu_engine_get_releases (priv->engine, request, device_id, &error);
+		if (releases == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = fu_main_release_array_to_variant_filtered (releases, keys);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "GetReleases") == 0) {
 		const gchar *device_id;
 		g_autoptr(GPtrArray) releases = NULL;
@@ -874,8 +1573,9 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_variant_builder_add_value (&builder, g_variant_new_string (checksum));
 		}
 		val = g_variant_builder_end (&builder);
-		g_dbus_method_invocation_return_value (invocation,
-						       g_variant_new_tuple (&val, 1));
+		fu_main_invocation_return_value (invocation,
+						 g_variant_new_tuple (&val, 1),
+						 as_fd);
 		return;
 	}
 	if (g_strcmp0 (method_name, "GetReportMetadata") == 0) {
@@ -1008,6 +1708,22 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetUpgradesAll") == 0) {
+		g_autoptr(GHashTable) results = NULL;
+		g_debug ("Called %s()", method_name);
+		results = fu_engine_get_upgrades_all (priv->engine, request);
+		val = fu_main_release_map_to_variant (results);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetReleasesAll") == 0) {
+		g_autoptr(GHashTable) results = NULL;
+		g_debug ("Called %s()", method_name);
+		results = fu_engine_get_releases_all (priv->engine, request);
+		val = fu_main_release_map_to_variant (results);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "GetRemotes") == 0) {
 		g_autoptr(GPtrArray) remotes = NULL;
 		g_debug ("Called %s()", method_name);
@@ -1033,6 +1749,25 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
+		fu_main_invocation_return_value (invocation, val, as_fd);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetHistoryRange") == 0) {
+		guint32 limit = 0;
+		guint32 offset = 0;
+		g_autoptr(GPtrArray) devices = NULL;
+		g_variant_get (parameters, "(uu)", &limit, &offset);
+		g_debug ("Called %s(%u,%u)", method_name, limit, offset);
+		devices = fu_engine_get_history_range (priv->engine, limit, offset, &error);
+		if (devices == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = fu_main_device_array_to_variant (priv, request, devices, &error);
+		if (val == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
@@ -1044,6 +1779,39 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetTraces") == 0) {
+		g_debug ("Called %s()", method_name);
+		val = fu_trace_to_variant ();
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetMetrics") == 0) {
+		g_autofree gchar *metrics = NULL;
+		g_debug ("Called %s()", method_name);
+		metrics = fu_engine_get_metrics (priv->engine);
+		val = g_variant_new ("(s)", metrics);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetMemoryStats") == 0) {
+		g_debug ("Called %s()", method_name);
+		val = g_variant_new ("(@a{sv})", fu_engine_get_memory_stats (priv->engine));
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetPluginStats") == 0) {
+		GPtrArray *plugins = fu_engine_get_plugins (priv->engine);
+		GVariantBuilder builder;
+		g_debug ("Called %s()", method_name);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+		for (guint i = 0; i < plugins->len; i++) {
+			FuPlugin *plugin = g_ptr_array_index (plugins, i);
+			g_variant_builder_add_value (&builder, fu_plugin_stats_to_variant (plugin));
+		}
+		val = g_variant_new ("(aa{sv})", &builder);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "ClearResults") == 0) {
 		const gchar *device_id;
 		g_variant_get (parameters, "(&s)", &device_id);
@@ -1131,6 +1899,74 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, NULL);
 		return;
 	}
+	if (g_strcmp0 (method_name, "UpdateMetadataBatch") == 0) {
+		GDBusMessage *message;
+		GUnixFDList *fd_list;
+		const gchar *remote_id = NULL;
+		gint32 fd_data_idx = 0;
+		gint32 fd_sig_idx = 0;
+		g_autoptr(GPtrArray) remote_ids = g_ptr_array_new_with_free_func (g_free);
+		g_autoptr(GPtrArray) blobs_raw = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+		g_autoptr(GPtrArray) blobs_sig = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+		g_autoptr(GVariantIter) iter = NULL;
+
+		g_variant_get (parameters, "(a(shh))", &iter);
+		g_debug ("Called %s(%" G_GSIZE_FORMAT ")", method_name,
+			 g_variant_iter_n_children (iter));
+		message = g_dbus_method_invocation_get_message (invocation);
+		fd_list = g_dbus_message_get_unix_fd_list (message);
+		if (fd_list == NULL ||
+		    (gsize) g_unix_fd_list_get_length (fd_list) != g_variant_iter_n_children (iter) * 2) {
+			g_set_error (&error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "invalid handle");
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+
+		/* read everything first so the silo is only rebuilt once */
+		while (g_variant_iter_next (iter, "(&shh)", &remote_id, &fd_data_idx, &fd_sig_idx)) {
+			GBytes *blob_raw;
+			GBytes *blob_sig;
+			gint fd_data;
+			gint fd_sig;
+
+			fd_data = g_unix_fd_list_get (fd_list, fd_data_idx, &error);
+			if (fd_data < 0) {
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+			blob_raw = fu_common_get_contents_fd (fd_data, 0x100000, &error);
+			if (blob_raw == NULL) {
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+			g_ptr_array_add (blobs_raw, blob_raw);
+			fd_sig = g_unix_fd_list_get (fd_list, fd_sig_idx, &error);
+			if (fd_sig < 0) {
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+			blob_sig = fu_common_get_contents_fd (fd_sig, 0x100000, &error);
+			if (blob_sig == NULL) {
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+			g_ptr_array_add (blobs_sig, blob_sig);
+			g_ptr_array_add (remote_ids, g_strdup (remote_id));
+		}
+		if (!fu_engine_update_metadata_batch (priv->engine,
+						      remote_ids,
+						      blobs_raw,
+						      blobs_sig,
+						      &error)) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		g_dbus_method_invocation_return_value (invocation, NULL);
+		return;
+	}
 	if (g_strcmp0 (method_name, "Unlock") == 0) {
 		const gchar *device_id = NULL;
 		g_autoptr(FuMainAuthHelper) helper = NULL;
@@ -1287,7 +2123,12 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
-		if (!fu_engine_verify (priv->engine, device_id, &error)) {
+		if (g_strcmp0 (device_id, FWUPD_DEVICE_ID_ANY) == 0) {
+			if (!fu_engine_verify_all (priv->engine, &error)) {
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+		} else if (!fu_engine_verify (priv->engine, device_id, &error)) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
@@ -1306,6 +2147,16 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, NULL);
 		return;
 	}
+	if (g_strcmp0 (method_name, "SetDeviceInterest") == 0) {
+		g_autoptr(GVariant) dict = NULL;
+		g_variant_get (parameters, "(@a{sv})", &dict);
+		g_debug ("Called %s()", method_name);
+
+		/* old interest for the same sender will be automatically destroyed */
+		fu_main_set_interest (priv, sender, dict);
+		g_dbus_method_invocation_return_value (invocation, NULL);
+		return;
+	}
 	if (g_strcmp0 (method_name, "Install") == 0) {
 		GVariant *prop_value;
 		const gchar *device_id = NULL;
@@ -1427,7 +2278,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			return;
 		}
 		val = fu_main_result_array_to_variant (results);
-		g_dbus_method_invocation_return_value (invocation, val);
+		fu_main_invocation_return_value (invocation, val, as_fd);
 		return;
 	}
 	g_set_error (&error,
@@ -1469,6 +2320,12 @@ fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 	if (g_strcmp0 (property_name, "Interactive") == 0)
 		return g_variant_new_boolean (isatty (fileno (stdout)) != 0);
 
+	if (g_strcmp0 (property_name, "ReleasesGeneration") == 0)
+		return g_variant_new_uint64 (fu_engine_get_releases_generation (priv->engine));
+
+	if (g_strcmp0 (property_name, "DevicesGeneration") == 0)
+		return g_variant_new_uint64 (fu_engine_get_devices_generation (priv->engine));
+
 	/* return an error */
 	g_set_error (error,
 		     G_DBUS_ERROR,
@@ -1478,6 +2335,295 @@ fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 	return NULL;
 }
 
+static void
+fu_main_name_owner_changed_cb (GDBusConnection *connection,
+			       const gchar *sender_name,
+			       const gchar *object_path,
+			       const gchar *interface_name,
+			       const gchar *signal_name,
+			       GVariant *parameters,
+			       gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	const gchar *name = NULL;
+	const gchar *old_owner = NULL;
+	const gchar *new_owner = NULL;
+
+	/* only interested in clients going away */
+	g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+	if (name[0] != ':' || new_owner[0] != '\0')
+		return;
+	fu_main_auth_cache_remove_sender (priv, name);
+	g_hash_table_remove (priv->sender_features, name);
+	g_hash_table_remove (priv->sender_interests, name);
+}
+
+static gchar *
+fu_main_snapshot_get_filename (void)
+{
+	g_autofree gchar *localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	return g_build_filename (localstatedir, "devices.snapshot", NULL);
+}
+
+static void
+fu_main_snapshot_load (FuMainPrivate *priv)
+{
+	const gchar *version = NULL;
+	gchar *buf = NULL;
+	gsize bufsz = 0;
+	g_autofree gchar *filename = fu_main_snapshot_get_filename ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	if (!g_file_get_contents (filename, &buf, &bufsz, &error_local)) {
+		g_debug ("no snapshot: %s", error_local->message);
+		return;
+	}
+	blob = g_bytes_new_take (buf, bufsz);
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT, blob, FALSE));
+	if (!g_variant_is_normal_form (val)) {
+		g_debug ("ignoring invalid snapshot %s", filename);
+		return;
+	}
+
+	/* the device serialization may have changed */
+	if (!g_variant_lookup (val, "DaemonVersion", "&s", &version) ||
+	    g_strcmp0 (version, SOURCE_VERSION) != 0) {
+		g_debug ("ignoring snapshot from version %s", version);
+		return;
+	}
+	priv->snapshot = g_steal_pointer (&val);
+}
+
+/* the untrusted device list is saved so that serial numbers are never
+ * shown to unprivileged clients while the engine is loading */
+static void
+fu_main_snapshot_save (FuMainPrivate *priv)
+{
+	const gchar *tmp;
+	GVariantBuilder builder;
+	g_autofree gchar *filename = fu_main_snapshot_get_filename ();
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "DaemonVersion",
+			       g_variant_new_string (SOURCE_VERSION));
+	tmp = fu_engine_get_host_product (priv->engine);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "HostProduct",
+				       g_variant_new_string (tmp));
+	}
+	tmp = fu_engine_get_host_machine_id (priv->engine);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "HostMachineId",
+				       g_variant_new_string (tmp));
+	}
+	tmp = fu_engine_get_host_security_id (priv->engine);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder, "{sv}", "HostSecurityId",
+				       g_variant_new_string (tmp));
+	}
+	for (guint i = 0; i < 2; i++) {
+		g_autoptr(GError) error_devices = NULL;
+		g_autoptr(GVariant) devices = NULL;
+		devices = fu_main_devices_cache_ensure (priv, request, i == 1, &error_devices);
+		if (devices == NULL) {
+			g_debug ("not saving devices: %s", error_devices->message);
+			break;
+		}
+		g_variant_builder_add (&builder, "{sv}",
+				       i == 1 ? "GetDevicesCompact" : "GetDevices",
+				       devices);
+	}
+	val = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+	if (!fu_common_mkdir_parent (filename, &error_local) ||
+	    !g_file_set_contents (filename,
+				  g_variant_get_data (val),
+				  (gssize) g_variant_get_size (val),
+				  &error_local)) {
+		g_debug ("failed to save snapshot: %s", error_local->message);
+	}
+}
+
+/* called from the GDBus worker thread while the engine is loading */
+static GVariant *
+fu_main_loading_get_properties (FuMainPrivate *priv)
+{
+	GVariantBuilder builder;
+	const gchar *keys[] = { "HostProduct", "HostMachineId", "HostSecurityId", NULL };
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "DaemonVersion",
+			       g_variant_new_string (SOURCE_VERSION));
+	g_variant_builder_add (&builder, "{sv}", "Tainted",
+			       g_variant_new_boolean (FALSE));
+	g_variant_builder_add (&builder, "{sv}", "Interactive",
+			       g_variant_new_boolean (isatty (fileno (stdout)) != 0));
+	g_variant_builder_add (&builder, "{sv}", "DevicesGeneration",
+			       g_variant_new_uint64 (0));
+	g_variant_builder_add (&builder, "{sv}", "ReleasesGeneration",
+			       g_variant_new_uint64 (0));
+	g_variant_builder_add (&builder, "{sv}", "Status",
+			       g_variant_new_uint32 (FWUPD_STATUS_LOADING));
+	g_variant_builder_add (&builder, "{sv}", "Percentage",
+			       g_variant_new_uint32 (0));
+	for (guint i = 0; keys[i] != NULL; i++) {
+		const gchar *tmp = NULL;
+		if (priv->snapshot != NULL)
+			g_variant_lookup (priv->snapshot, keys[i], "&s", &tmp);
+		g_variant_builder_add (&builder, "{sv}", keys[i],
+				       g_variant_new_string (tmp != NULL ? tmp : ""));
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/* called from the GDBus worker thread while the engine is loading */
+static GVariant *	/* (transfer full) (nullable) */
+fu_main_loading_method_call (FuMainPrivate *priv, GDBusMessage *message)
+{
+	const gchar *interface_name = g_dbus_message_get_interface (message);
+	const gchar *method_name = g_dbus_message_get_member (message);
+	GVariant *parameters = g_dbus_message_get_body (message);
+
+	if (g_strcmp0 (interface_name, "org.freedesktop.DBus.Properties") == 0) {
+		const gchar *property_interface = NULL;
+		const gchar *property_name = NULL;
+		g_autoptr(GVariant) props = NULL;
+		g_autoptr(GVariant) prop = NULL;
+
+		if (parameters == NULL)
+			return NULL;
+		props = g_variant_ref_sink (fu_main_loading_get_properties (priv));
+		if (g_strcmp0 (method_name, "GetAll") == 0 &&
+		    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(s)"))) {
+			g_variant_get (parameters, "(&s)", &property_interface);
+			if (g_strcmp0 (property_interface, FWUPD_DBUS_INTERFACE) != 0)
+				return NULL;
+			return g_variant_ref_sink (g_variant_new_tuple (&props, 1));
+		}
+		if (g_strcmp0 (method_name, "Get") == 0 &&
+		    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(ss)"))) {
+			g_variant_get (parameters, "(&s&s)", &property_interface, &property_name);
+			if (g_strcmp0 (property_interface, FWUPD_DBUS_INTERFACE) != 0)
+				return NULL;
+			prop = g_variant_lookup_value (props, property_name, NULL);
+			if (prop == NULL)
+				return NULL;
+			return g_variant_ref_sink (g_variant_new ("(v)", prop));
+		}
+		return NULL;
+	}
+	if (g_strcmp0 (interface_name, FWUPD_DBUS_INTERFACE) != 0)
+		return NULL;
+
+	/* only answered if the devices were saved with the last version */
+	if (g_strcmp0 (method_name, "GetDevices") == 0 ||
+	    g_strcmp0 (method_name, "GetDevicesCompact") == 0) {
+		gboolean compact = g_strcmp0 (method_name, "GetDevicesCompact") == 0;
+		if (priv->snapshot == NULL)
+			return NULL;
+		g_debug ("Called %s() while loading, using snapshot", method_name);
+		return g_variant_lookup_value (priv->snapshot, method_name,
+					       compact ? G_VARIANT_TYPE ("(aa{qv})") :
+							 G_VARIANT_TYPE ("(aa{sv})"));
+	}
+
+	/* the main loop is not running, so nothing else uses this */
+	if (g_strcmp0 (method_name, "SetFeatureFlags") == 0 &&
+	    parameters != NULL &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(t)"))) {
+		guint64 feature_flags = 0;
+		g_variant_get (parameters, "(t)", &feature_flags);
+		g_hash_table_insert (priv->sender_features,
+				     g_strdup (g_dbus_message_get_sender (message)),
+				     g_memdup (&feature_flags, sizeof(feature_flags)));
+		return g_variant_ref_sink (g_variant_new ("()"));
+	}
+	if (g_strcmp0 (method_name, "SetDeviceInterest") == 0 &&
+	    parameters != NULL &&
+	    g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(a{sv})"))) {
+		g_autoptr(GVariant) dict = NULL;
+		g_variant_get (parameters, "(@a{sv})", &dict);
+		fu_main_set_interest (priv, g_dbus_message_get_sender (message), dict);
+		return g_variant_ref_sink (g_variant_new ("()"));
+	}
+	return NULL;
+}
+
+/* anything not answered here is dispatched to the main loop once the
+ * engine has loaded, just as if the daemon had only then started */
+static GDBusMessage *
+fu_main_loading_filter_cb (GDBusConnection *connection,
+			   GDBusMessage *message,
+			   gboolean incoming,
+			   gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	g_autoptr(GDBusMessage) reply = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	if (!incoming ||
+	    g_dbus_message_get_message_type (message) != G_DBUS_MESSAGE_TYPE_METHOD_CALL ||
+	    g_dbus_message_get_sender (message) == NULL ||
+	    g_strcmp0 (g_dbus_message_get_path (message), FWUPD_DBUS_PATH) != 0)
+		return message;
+	locker = g_mutex_locker_new (&priv->loading_mutex);
+	if (!priv->loading)
+		return message;
+	val = fu_main_loading_method_call (priv, message);
+	if (val == NULL)
+		return message;
+
+	reply = g_dbus_message_new_method_reply (message);
+	g_dbus_message_set_body (reply, val);
+	g_dbus_connection_send_message (connection, reply,
+					G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+					NULL, NULL);
+	g_object_unref (message);
+	return NULL;
+}
+
+static void
+fu_main_loading_finish (FuMainPrivate *priv)
+{
+	g_mutex_lock (&priv->loading_mutex);
+	priv->loading = FALSE;
+	g_mutex_unlock (&priv->loading_mutex);
+	g_dbus_connection_remove_filter (priv->connection, priv->loading_filter_id);
+	priv->loading_filter_id = 0;
+
+	/* clients given the snapshot will notice the new generations */
+	fu_main_set_status (priv, fu_engine_get_status (priv->engine));
+	fu_main_emit_devices_generation (priv);
+	fu_main_emit_releases_generation (priv);
+}
+
+/* the time spent on the main thread, which does not include waiting for
+ * authentication or a threaded install */
+static void
+fu_main_daemon_method_call_timed (GDBusConnection *connection,
+				  const gchar *sender,
+				  const gchar *object_path,
+				  const gchar *interface_name,
+				  const gchar *method_name,
+				  GVariant *parameters,
+				  GDBusMethodInvocation *invocation,
+				  gpointer user_data)
+{
+	g_autofree gchar *labels = g_strdup_printf ("method=\"%s\"", method_name);
+	g_autoptr(GTimer) timer = g_timer_new ();
+	fu_main_daemon_method_call (connection, sender, object_path,
+				    interface_name, method_name, parameters,
+				    invocation, user_data);
+	fu_metrics_histogram_observe ("fwupd_dbus_method_duration_seconds", labels,
+				      g_timer_elapsed (timer, NULL));
+}
+
 static void
 fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 			    const gchar *name,
@@ -1487,7 +2633,7 @@ fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 	guint registration_id;
 	g_autoptr(GError) error = NULL;
 	static const GDBusInterfaceVTable interface_vtable = {
-		fu_main_daemon_method_call,
+		fu_main_daemon_method_call_timed,
 		fu_main_daemon_get_property,
 		NULL
 	};
@@ -1502,6 +2648,18 @@ fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 							     NULL); /* GError** */
 	g_assert (registration_id > 0);
 
+	/* drop any state kept for clients that disconnect */
+	priv->name_owner_changed_id =
+		g_dbus_connection_signal_subscribe (connection,
+						    "org.freedesktop.DBus",
+						    "org.freedesktop.DBus",
+						    "NameOwnerChanged",
+						    "/org/freedesktop/DBus",
+						    NULL,
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    fu_main_name_owner_changed_cb,
+						    priv, NULL);
+
 	/* connect to D-Bus directly */
 	priv->proxy_uid =
 		g_dbus_proxy_new_sync (priv->connection,
@@ -1566,6 +2724,13 @@ fu_main_memory_monitor_warning_cb (GMemoryMonitor *memory_monitor,
 				   GMemoryMonitorWarningLevel level,
 				   FuMainPrivate *priv)
 {
+	/* the caches can all be rebuilt, so drop them first */
+	fu_engine_trim_caches (priv->engine);
+	if (level < G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL) {
+		g_debug ("low memory event %u, dropped caches", (guint) level);
+		return;
+	}
+
 	/* can do straight away? */
 	if (priv->update_in_progress) {
 		g_warning ("OOM during a firmware update, ignoring");
@@ -1596,10 +2761,68 @@ fu_main_load_introspection (const gchar *filename, GError **error)
 	return g_dbus_node_info_new_for_xml (g_bytes_get_data (data, NULL), error);
 }
 
+static gboolean
+fu_main_metrics_incoming_cb (GSocketService *service,
+			     GSocketConnection *connection,
+			     GObject *source_object,
+			     gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	GOutputStream *ostream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+	g_autofree gchar *metrics = fu_engine_get_metrics (priv->engine);
+	g_autoptr(GError) error = NULL;
+
+	/* the whole reply is small, and the connection is closed when unreffed */
+	if (!g_output_stream_write_all (ostream, metrics, strlen (metrics),
+					NULL, NULL, &error))
+		g_debug ("failed to write metrics: %s", error->message);
+	return TRUE;
+}
+
+static gboolean
+fu_main_metrics_service_start (FuMainPrivate *priv, const gchar *path, GError **error)
+{
+	g_autoptr(GSocketAddress) address = NULL;
+
+	/* remove any stale socket from a previous instance */
+	if (g_unlink (path) != 0 && errno != ENOENT) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errno),
+			     "failed to remove %s: %s",
+			     path, g_strerror (errno));
+		return FALSE;
+	}
+	address = g_unix_socket_address_new (path);
+	priv->metrics_service = g_socket_service_new ();
+	if (!g_socket_listener_add_address (G_SOCKET_LISTENER (priv->metrics_service),
+					    address,
+					    G_SOCKET_TYPE_STREAM,
+					    G_SOCKET_PROTOCOL_DEFAULT,
+					    NULL, NULL, error))
+		return FALSE;
+	g_signal_connect (priv->metrics_service, "incoming",
+			  G_CALLBACK (fu_main_metrics_incoming_cb), priv);
+	g_socket_service_start (priv->metrics_service);
+	g_debug ("serving metrics on %s", path);
+	return TRUE;
+}
+
 static void
 fu_main_private_free (FuMainPrivate *priv)
 {
 	g_hash_table_unref (priv->sender_features);
+	g_hash_table_unref (priv->sender_interests);
+	g_hash_table_unref (priv->device_variants);
+	g_hash_table_unref (priv->auth_cache);
+	g_ptr_array_unref (priv->pending_calls);
+	if (priv->name_owner_changed_id > 0)
+		g_dbus_connection_signal_unsubscribe (priv->connection,
+						      priv->name_owner_changed_id);
+	if (priv->devices_cache.val != NULL)
+		g_variant_unref (priv->devices_cache.val);
+	if (priv->devices_cache_compact.val != NULL)
+		g_variant_unref (priv->devices_cache_compact.val);
 	if (priv->loop != NULL)
 		g_main_loop_unref (priv->loop);
 	if (priv->owner_id > 0)
@@ -1620,6 +2843,14 @@ fu_main_private_free (FuMainPrivate *priv)
 	if (priv->memory_monitor != NULL)
 		g_object_unref (priv->memory_monitor);
 #endif
+	if (priv->snapshot != NULL)
+		g_variant_unref (priv->snapshot);
+	if (priv->metrics_service != NULL) {
+		g_socket_service_stop (priv->metrics_service);
+		g_socket_listener_close (G_SOCKET_LISTENER (priv->metrics_service));
+		g_object_unref (priv->metrics_service);
+	}
+	g_mutex_clear (&priv->loading_mutex);
 	g_free (priv);
 }
 
@@ -1643,7 +2874,9 @@ main (int argc, char *argv[])
 		{ NULL}
 	};
 	g_autoptr(FuMainPrivate) priv = NULL;
+	g_autoptr(GDBusConnection) connection = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_snapshot = NULL;
 	g_autoptr(GFile) argv0_file = g_file_new_for_path (argv[0]);
 	g_autoptr(GOptionContext) context = NULL;
 
@@ -1668,6 +2901,12 @@ main (int argc, char *argv[])
 	/* create new objects */
 	priv = g_new0 (FuMainPrivate, 1);
 	priv->sender_features = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->sender_interests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							(GDestroyNotify) fu_main_interest_free);
+	priv->device_variants = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_variant_unref);
+	priv->auth_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->pending_calls = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_main_pending_call_free);
 	priv->loop = g_main_loop_new (NULL, FALSE);
 
 	/* load engine */
@@ -1690,10 +2929,60 @@ main (int argc, char *argv[])
 	g_signal_connect (priv->engine, "percentage-changed",
 			  G_CALLBACK (fu_main_engine_percentage_changed_cb),
 			  priv);
+
+	/* load introspection from file */
+	priv->introspection_daemon = fu_main_load_introspection (FWUPD_DBUS_INTERFACE ".xml",
+								 &error);
+	if (priv->introspection_daemon == NULL) {
+		g_printerr ("Failed to load introspection: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	/* get authority */
+	priv->authority = polkit_authority_get_sync (NULL, &error);
+	if (priv->authority == NULL) {
+		g_printerr ("Failed to load authority: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	/* own the object before loading the engine so that bus-activated
+	 * clients can be answered from the snapshot of the last run */
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+	if (connection == NULL) {
+		g_printerr ("Failed to connect to the system bus: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	fu_main_snapshot_load (priv);
+	priv->loading = TRUE;
+	priv->loading_filter_id = g_dbus_connection_add_filter (connection,
+								fu_main_loading_filter_cb,
+								priv, NULL);
+	fu_main_on_bus_acquired_cb (connection, FWUPD_DBUS_SERVICE, priv);
+	priv->owner_id = g_bus_own_name_on_connection (connection,
+						       FWUPD_DBUS_SERVICE,
+						       G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+						       G_BUS_NAME_OWNER_FLAGS_REPLACE,
+						       fu_main_on_name_acquired_cb,
+						       fu_main_on_name_lost_cb,
+						       priv, NULL);
 	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NONE, &error)) {
 		g_printerr ("Failed to load engine: %s\n", error->message);
 		return EXIT_FAILURE;
 	}
+	fu_main_loading_finish (priv);
+	fu_metrics_set_help ("fwupd_dbus_method_duration_seconds",
+			     "Time spent handling each D-Bus method on the main thread");
+
+	/* optionally export the metrics for monitoring */
+	if (fu_engine_get_metrics_socket (priv->engine) != NULL) {
+		g_autoptr(GError) error_metrics = NULL;
+		if (!fu_main_metrics_service_start (priv,
+						    fu_engine_get_metrics_socket (priv->engine),
+						    &error_metrics)) {
+			g_warning ("failed to serve metrics: %s",
+				   error_metrics->message);
+		}
+	}
 
 	g_unix_signal_add_full (G_PRIORITY_DEFAULT,
 				SIGTERM, fu_main_sigterm_cb,
@@ -1706,36 +2995,13 @@ main (int argc, char *argv[])
 			  G_CALLBACK (fu_main_argv_changed_cb), priv);
 
 #if GLIB_CHECK_VERSION(2,63,3)
-	/* shut down on low memory event as we can just rescan hardware */
+	/* drop the caches on low memory, and shut down if that was not
+	 * enough as we can just rescan hardware */
 	priv->memory_monitor = g_memory_monitor_dup_default ();
 	g_signal_connect (G_OBJECT (priv->memory_monitor), "low-memory-warning",
 			  G_CALLBACK (fu_main_memory_monitor_warning_cb), priv);
 #endif
 
-	/* load introspection from file */
-	priv->introspection_daemon = fu_main_load_introspection (FWUPD_DBUS_INTERFACE ".xml",
-								 &error);
-	if (priv->introspection_daemon == NULL) {
-		g_printerr ("Failed to load introspection: %s\n", error->message);
-		return EXIT_FAILURE;
-	}
-
-	/* get authority */
-	priv->authority = polkit_authority_get_sync (NULL, &error);
-	if (priv->authority == NULL) {
-		g_printerr ("Failed to load authority: %s\n", error->message);
-		return EXIT_FAILURE;
-	}
-
-	/* own the object */
-	priv->owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
-					 FWUPD_DBUS_SERVICE,
-					 G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
-					 G_BUS_NAME_OWNER_FLAGS_REPLACE,
-					 fu_main_on_bus_acquired_cb,
-					 fu_main_on_name_acquired_cb,
-					 fu_main_on_name_lost_cb,
-					 priv, NULL);
 
 	/* Only timeout and close the mainloop if we have specified it
 	 * on the command line */
@@ -1750,6 +3016,11 @@ main (int argc, char *argv[])
 	g_message ("Daemon ready for requests");
 	g_main_loop_run (priv->loop);
 
+	/* used to answer clients and set up devices when next started */
+	fu_main_snapshot_save (priv);
+	if (!fu_engine_save_device_snapshot (priv->engine, &error_snapshot))
+		g_debug ("failed to save device snapshot: %s", error_snapshot->message);
+
 	/* success */
 	return EXIT_SUCCESS;
 }
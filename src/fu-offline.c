@@ -12,7 +12,10 @@
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 
+#include "fu-engine.h"
+#include "fu-engine-request.h"
 #include "fu-history.h"
+#include "fu-install-task.h"
 #include "fu-plugin-private.h"
 #include "fu-util-common.h"
 
@@ -107,19 +110,115 @@ fu_offline_set_splash_reboot (FuUtilPrivate *priv, GError **error)
 }
 
 static void
-fu_offline_client_notify_cb (GObject *object, GParamSpec *pspec, gpointer user_data)
+fu_offline_engine_percentage_changed_cb (FuEngine *engine,
+					 guint percentage,
+					 gpointer user_data)
 {
 	FuUtilPrivate *priv = (FuUtilPrivate *) user_data;
-	FwupdClient *client = FWUPD_CLIENT (object);
 
 	/* rate limit to 1 second */
-	if (g_timer_elapsed (priv->splash_timer, NULL) < 1.f ||
-	    fwupd_client_get_percentage (client) < 5)
+	if (g_timer_elapsed (priv->splash_timer, NULL) < 1.f || percentage < 5)
 		return;
-	fu_offline_set_splash_progress (priv, fwupd_client_get_percentage (client), NULL);
+	fu_offline_set_splash_progress (priv, percentage, NULL);
 	g_timer_reset (priv->splash_timer);
 }
 
+static void
+fu_offline_print_action (FwupdDevice *dev)
+{
+	FwupdRelease *rel = fwupd_device_get_release_default (dev);
+	gint vercmp;
+
+	/* tell the user what's going to happen */
+	vercmp = fu_common_vercmp_full (fwupd_device_get_version (dev),
+					fwupd_release_get_version (rel),
+					fwupd_device_get_version_format (dev));
+	if (vercmp == 0) {
+		/* TRANSLATORS: the first replacement is a display name
+		 * e.g. "ColorHugALS" and the second is a version number
+		 * e.g. "1.2.3" */
+		g_print (_("Reinstalling %s with %s... "),
+			 fwupd_device_get_name (dev),
+			 fwupd_release_get_version (rel));
+	} else if (vercmp > 0) {
+		/* TRANSLATORS: the first replacement is a display name
+		 * e.g. "ColorHugALS" and the second and third are
+		 * version numbers e.g. "1.2.3" */
+		g_print (_("Downgrading %s from %s to %s... "),
+			 fwupd_device_get_name (dev),
+			 fwupd_device_get_version (dev),
+			 fwupd_release_get_version (rel));
+	} else if (vercmp < 0) {
+		/* TRANSLATORS: the first replacement is a display name
+		 * e.g. "ColorHugALS" and the second and third are
+		 * version numbers e.g. "1.2.3" */
+		g_print (_("Updating %s from %s to %s... "),
+			 fwupd_device_get_name (dev),
+			 fwupd_device_get_version (dev),
+			 fwupd_release_get_version (rel));
+	}
+	g_print ("\n");
+}
+
+static gint
+fu_offline_install_task_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuInstallTask *task1 = *((FuInstallTask **) a);
+	FuInstallTask *task2 = *((FuInstallTask **) b);
+	return fu_install_task_compare (task1, task2);
+}
+
+/* the archive is the copy made when the update was scheduled */
+static FuInstallTask *
+fu_offline_get_install_task (FuEngine *engine,
+			     FuEngineRequest *request,
+			     FwupdDevice *dev,
+			     FwupdInstallFlags flags,
+			     GError **error)
+{
+	FwupdRelease *rel = fwupd_device_get_release_default (dev);
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GBytes) blob_cab = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GPtrArray) errors = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	device = fu_engine_get_device (engine, fwupd_device_get_id (dev), error);
+	if (device == NULL)
+		return NULL;
+	blob_cab = fu_common_get_contents_bytes (fwupd_release_get_filename (rel), error);
+	if (blob_cab == NULL)
+		return NULL;
+	silo = fu_engine_get_silo_from_blob (engine, blob_cab, error);
+	if (silo == NULL)
+		return NULL;
+	components = xb_silo_query (silo, "components/component", 0, error);
+	if (components == NULL)
+		return NULL;
+
+	/* find the component that matches the device */
+	errors = g_ptr_array_new_with_free_func ((GDestroyNotify) g_error_free);
+	for (guint i = 0; i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+		g_autoptr(FuInstallTask) task = fu_install_task_new (device, component);
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_check_requirements (engine, request, task,
+						   flags, &error_local)) {
+			g_debug ("requirement on %s:%s failed: %s",
+				 fu_device_get_id (device),
+				 xb_node_query_text (component, "id", NULL),
+				 error_local->message);
+			g_ptr_array_add (errors, g_steal_pointer (&error_local));
+			continue;
+		}
+		fu_device_incorporate_from_component (device, component);
+		fu_install_task_set_blob_cab (task, blob_cab);
+		return g_steal_pointer (&task);
+	}
+	g_propagate_error (error, fu_common_error_array_get_best (errors));
+	return NULL;
+}
+
 static void
 fu_util_private_free (FuUtilPrivate *priv)
 {
@@ -137,14 +236,18 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUtilPrivate, fu_util_private_free)
 int
 main (int argc, char *argv[])
 {
-	gint vercmp;
-	guint cnt = 0;
+	FwupdInstallFlags flags = FWUPD_INSTALL_FLAG_ALLOW_REINSTALL |
+				  FWUPD_INSTALL_FLAG_ALLOW_OLDER |
+				  FWUPD_INSTALL_FLAG_OFFLINE;
 	g_autofree gchar *link = NULL;
 	g_autofree gchar *target = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
 	g_autofree gchar *trigger = fu_common_get_path (FU_PATH_KIND_OFFLINE_TRIGGER);
+	g_autoptr(FuEngine) engine = NULL;
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
 	g_autoptr(FuHistory) history = NULL;
-	g_autoptr(FwupdClient) client = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) install_tasks = NULL;
+	g_autoptr(GPtrArray) pending = NULL;
 	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(FuUtilPrivate) priv = g_new0 (FuUtilPrivate, 1);
 
@@ -189,14 +292,34 @@ main (int argc, char *argv[])
 			    error->message);
 		return EXIT_FAILURE;
 	}
+	pending = g_ptr_array_new ();
+	for (guint i = 0; i < results->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (results, i);
+		if (fwupd_device_get_update_state (dev) == FWUPD_UPDATE_STATE_PENDING)
+			g_ptr_array_add (pending, dev);
+	}
+
+	/* nothing to do */
+	if (pending->len == 0) {
+		/* TRANSLATORS: nothing was updated offline */
+		g_printerr ("%s\n", _("No updates were applied"));
+		return EXIT_FAILURE;
+	}
 
-	/* connect to the daemon */
-	client = fwupd_client_new ();
-	g_signal_connect (client, "notify::percentage",
-			  G_CALLBACK (fu_offline_client_notify_cb), priv);
-	if (!fwupd_client_connect (client, NULL, &error)) {
-		/* TRANSLATORS: we could not talk to the fwupd daemon */
-		g_printerr ("%s: %s\n", _("Failed to connect to daemon"),
+	/* only load the plugins that own the pending devices, and do not
+	 * wait for the daemon to load the metadata and every plugin */
+	engine = fu_engine_new (FU_APP_FLAGS_NO_IDLE_SOURCES);
+	g_signal_connect (engine, "percentage-changed",
+			  G_CALLBACK (fu_offline_engine_percentage_changed_cb), priv);
+	for (guint i = 0; i < pending->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (pending, i);
+		if (fwupd_device_get_plugin (dev) != NULL)
+			fu_engine_add_plugin_filter (engine, fwupd_device_get_plugin (dev));
+	}
+	fu_engine_add_plugin_filter (engine, "upower");
+	if (!fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_METADATA, &error)) {
+		/* TRANSLATORS: we could not load the plugins */
+		g_printerr ("%s: %s\n", _("Failed to load engine"),
 			    error->message);
 		return EXIT_FAILURE;
 	}
@@ -209,63 +332,28 @@ main (int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	/* apply each update */
-	for (guint i = 0; i < results->len; i++) {
-		FwupdDevice *dev = g_ptr_array_index (results, i);
-		FwupdRelease *rel = fwupd_device_get_release_default (dev);
-
-		/* check not already done */
-		if (fwupd_device_get_update_state (dev) != FWUPD_UPDATE_STATE_PENDING)
-			continue;
-
-		/* tell the user what's going to happen */
-		vercmp = fu_common_vercmp_full (fwupd_device_get_version (dev),
-						fwupd_release_get_version (rel),
-						fwupd_device_get_version_format (dev));
-		if (vercmp == 0) {
-			/* TRANSLATORS: the first replacement is a display name
-			 * e.g. "ColorHugALS" and the second is a version number
-			 * e.g. "1.2.3" */
-			g_print (_("Reinstalling %s with %s... "),
-				 fwupd_device_get_name (dev),
-				 fwupd_release_get_version (rel));
-		} else if (vercmp > 0) {
-			/* TRANSLATORS: the first replacement is a display name
-			 * e.g. "ColorHugALS" and the second and third are
-			 * version numbers e.g. "1.2.3" */
-			g_print (_("Downgrading %s from %s to %s... "),
-				 fwupd_device_get_name (dev),
-				 fwupd_device_get_version (dev),
-				 fwupd_release_get_version (rel));
-		} else if (vercmp < 0) {
-			/* TRANSLATORS: the first replacement is a display name
-			 * e.g. "ColorHugALS" and the second and third are
-			 * version numbers e.g. "1.2.3" */
-			g_print (_("Updating %s from %s to %s... "),
-				 fwupd_device_get_name (dev),
-				 fwupd_device_get_version (dev),
-				 fwupd_release_get_version (rel));
-		}
-		if (!fwupd_client_install (client,
-					   fwupd_device_get_id (dev),
-					   fwupd_release_get_filename (rel),
-					   FWUPD_INSTALL_FLAG_ALLOW_REINSTALL |
-					   FWUPD_INSTALL_FLAG_ALLOW_OLDER |
-					   FWUPD_INSTALL_FLAG_OFFLINE,
-					   NULL,
-					   &error)) {
+	/* apply all the updates in one transaction so that plugins can stage
+	 * everything before a single reboot */
+	install_tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < pending->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (pending, i);
+		FuInstallTask *task;
+		fu_offline_print_action (dev);
+		task = fu_offline_get_install_task (engine, request, dev, flags, &error);
+		if (task == NULL) {
 			/* TRANSLATORS: we could not install for some reason */
 			g_printerr ("%s: %s\n", _("Failed to install firmware update"),
 				    error->message);
 			return EXIT_FAILURE;
 		}
-		cnt++;
+		g_ptr_array_add (install_tasks, task);
 	}
-
-	/* nothing to do */
-	if (cnt == 0) {
-		/* TRANSLATORS: nothing was updated offline */
-		g_printerr ("%s\n", _("No updates were applied"));
+	g_ptr_array_sort (install_tasks, fu_offline_install_task_sort_cb);
+	if (!fu_engine_install_tasks (engine, request, install_tasks,
+				      NULL, flags, &error)) {
+		/* TRANSLATORS: we could not install for some reason */
+		g_printerr ("%s: %s\n", _("Failed to install firmware update"),
+			    error->message);
 		return EXIT_FAILURE;
 	}
 
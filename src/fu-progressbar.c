@@ -16,6 +16,9 @@
 
 static void fu_progressbar_finalize	 (GObject *obj);
 
+#define FU_PROGRESSBAR_REFRESH_INTERVAL		100	/* ms */
+#define FU_PROGRESSBAR_MILESTONE		25	/* percent */
+
 struct _FuProgressbar
 {
 	GObject			 parent_instance;
@@ -27,7 +30,10 @@ struct _FuProgressbar
 	guint			 percentage;
 	guint			 to_erase;		/* chars */
 	guint			 timer_id;
+	guint			 refresh_id;
 	gint64			 last_animated;		/* monotonic */
+	gint64			 last_refresh;		/* monotonic */
+	guint			 last_milestone;	/* percent */
 	GTimer			*time_elapsed;
 	gdouble			 last_estimate;
 	gboolean		 interactive;
@@ -195,6 +201,7 @@ fu_progressbar_refresh (FuProgressbar *self, FwupdStatus status, guint percentag
 	/* dump to screen */
 	g_print ("%s", str->str);
 	self->to_erase = str->len;
+	self->last_refresh = g_get_monotonic_time ();
 
 	/* done */
 	if (is_idle_newline) {
@@ -279,6 +286,34 @@ fu_progressbar_spin_start (FuProgressbar *self)
 	self->timer_id = g_timeout_add (40, fu_progressbar_spin_cb, self);
 }
 
+static gboolean
+fu_progressbar_refresh_cb (gpointer user_data)
+{
+	FuProgressbar *self = FU_PROGRESSBAR (user_data);
+	self->refresh_id = 0;
+	fu_progressbar_refresh (self, self->status, self->percentage);
+	return G_SOURCE_REMOVE;
+}
+
+/* logs are read later, so only show each status and every few percent */
+static void
+fu_progressbar_update_milestone (FuProgressbar *self, FwupdStatus status, guint percentage)
+{
+	guint milestone = percentage / FU_PROGRESSBAR_MILESTONE * FU_PROGRESSBAR_MILESTONE;
+
+	if (self->status != status) {
+		self->status = status;
+		self->last_milestone = 0;
+		if (status == FWUPD_STATUS_IDLE || status == FWUPD_STATUS_UNKNOWN)
+			return;
+		g_print ("%s\n", fu_progressbar_status_to_string (status));
+	}
+	if (status == FWUPD_STATUS_IDLE || milestone <= self->last_milestone)
+		return;
+	g_print ("%s %u%%\n", fu_progressbar_status_to_string (status), milestone);
+	self->last_milestone = milestone;
+}
+
 /**
  * fu_progressbar_update:
  * @self: A #FuProgressbar
@@ -299,10 +334,7 @@ fu_progressbar_update (FuProgressbar *self, FwupdStatus status, guint percentage
 		status = self->status;
 
 	if (!self->interactive) {
-		if (self->status != status) {
-			g_debug ("%s\n", fu_progressbar_status_to_string (status));
-			self->status = status;
-		}
+		fu_progressbar_update_milestone (self, status, percentage);
 		return;
 	}
 
@@ -329,6 +361,25 @@ fu_progressbar_update (FuProgressbar *self, FwupdStatus status, guint percentage
 		fu_progressbar_spin_start (self);
 	}
 
+	/* redraw a changing percentage at most every interval, but make sure
+	 * the last value received is always shown */
+	if (self->status == status &&
+	    status != FWUPD_STATUS_IDLE &&
+	    percentage != 100 &&
+	    (g_get_monotonic_time () - self->last_refresh) / 1000 < FU_PROGRESSBAR_REFRESH_INTERVAL) {
+		self->percentage = percentage;
+		if (self->refresh_id == 0) {
+			self->refresh_id = g_timeout_add (FU_PROGRESSBAR_REFRESH_INTERVAL,
+							  fu_progressbar_refresh_cb,
+							  self);
+		}
+		return;
+	}
+	if (self->refresh_id != 0) {
+		g_source_remove (self->refresh_id);
+		self->refresh_id = 0;
+	}
+
 	/* update the terminal */
 	fu_progressbar_refresh (self, status, percentage);
 
@@ -342,7 +393,8 @@ fu_progressbar_update (FuProgressbar *self, FwupdStatus status, guint percentage
  * @self: A #FuProgressbar
  * @interactive: #gboolean
  *
- * Marks the progressbar as interactive or not
+ * Marks the progressbar as interactive or not. When not interactive only the
+ * status changes and progress every 25% are printed, one per line.
  *
  * Since: 0.9.7
  **/
@@ -411,6 +463,8 @@ fu_progressbar_finalize (GObject *obj)
 
 	if (self->timer_id != 0)
 		g_source_remove (self->timer_id);
+	if (self->refresh_id != 0)
+		g_source_remove (self->refresh_id);
 	g_timer_destroy (self->time_elapsed);
 
 	G_OBJECT_CLASS (fu_progressbar_parent_class)->finalize (obj);
@@ -33,7 +33,9 @@ struct _FuRemoteList
 {
 	GObject			 parent_instance;
 	GPtrArray		*array;			/* (element-type FwupdRemote) */
-	GPtrArray		*monitors;		/* (element-type GFileMonitor) */
+	FuFileWatch		*file_watch;
+	GArray			*watch_ids;		/* (element-type guint) */
+	GHashTable		*hash_checksums;	/* filename:checksum */
 	XbSilo			*silo;
 };
 
@@ -46,22 +48,6 @@ fu_remote_list_emit_changed (FuRemoteList *self)
 	g_signal_emit (self, signals[SIGNAL_CHANGED], 0);
 }
 
-static void
-fu_remote_list_monitor_changed_cb (GFileMonitor *monitor,
-				   GFile *file,
-				   GFile *other_file,
-				   GFileMonitorEvent event_type,
-				   gpointer user_data)
-{
-	FuRemoteList *self = FU_REMOTE_LIST (user_data);
-	g_autoptr(GError) error = NULL;
-	g_autofree gchar *filename = g_file_get_path (file);
-	g_debug ("%s changed, reloading all remotes", filename);
-	if (!fu_remote_list_reload (self, &error))
-		g_warning ("failed to rescan remotes: %s", error->message);
-	fu_remote_list_emit_changed (self);
-}
-
 static guint64
 _fwupd_remote_get_mtime (FwupdRemote *remote)
 {
@@ -80,22 +66,56 @@ _fwupd_remote_get_mtime (FwupdRemote *remote)
 	return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
 }
 
+static gchar *
+fu_remote_list_get_checksum (const gchar *filename)
+{
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	if (!g_file_get_contents (filename, &buf, &bufsz, NULL))
+		return NULL;
+	return g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) buf, bufsz);
+}
+
+static void fu_remote_list_file_watch_changed_cb (FuFileWatch *file_watch,
+						  const gchar *filename,
+						  gpointer user_data);
+
 static gboolean
 fu_remote_list_add_inotify (FuRemoteList *self, const gchar *filename, GError **error)
 {
-	GFileMonitor *monitor;
-	g_autoptr(GFile) file = g_file_new_for_path (filename);
+	guint watch_id;
 
 	/* set up a notify watch */
-	monitor = g_file_monitor (file, G_FILE_MONITOR_NONE, NULL, error);
-	if (monitor == NULL)
+	if (self->file_watch == NULL)
+		self->file_watch = fu_file_watch_new ();
+	watch_id = fu_file_watch_add (self->file_watch, filename,
+				      fu_remote_list_file_watch_changed_cb,
+				      self, error);
+	if (watch_id == 0)
 		return FALSE;
-	g_signal_connect (monitor, "changed",
-			  G_CALLBACK (fu_remote_list_monitor_changed_cb), self);
-	g_ptr_array_add (self->monitors, monitor);
+	g_array_append_val (self->watch_ids, watch_id);
 	return TRUE;
 }
 
+static void
+fu_remote_list_remove_inotify (FuRemoteList *self)
+{
+	for (guint i = 0; i < self->watch_ids->len; i++) {
+		guint watch_id = g_array_index (self->watch_ids, guint, i);
+		fu_file_watch_remove (self->file_watch, watch_id);
+	}
+	g_array_set_size (self->watch_ids, 0);
+}
+
+/* must be called before fu_remote_list_load() */
+void
+fu_remote_list_set_file_watch (FuRemoteList *self, FuFileWatch *file_watch)
+{
+	g_return_if_fail (FU_IS_REMOTE_LIST (self));
+	g_return_if_fail (self->watch_ids->len == 0);
+	g_set_object (&self->file_watch, file_watch);
+}
+
 static GString *
 _fwupd_remote_get_agreement_default (FwupdRemote *self, GError **error)
 {
@@ -189,6 +209,9 @@ fu_remote_list_add_for_path (FuRemoteList *self, const gchar *path, GError **err
 			g_prefix_error (error, "failed to load %s: ", filename);
 			return FALSE;
 		}
+		g_hash_table_insert (self->hash_checksums,
+				     g_strdup (filename),
+				     fu_remote_list_get_checksum (filename));
 
 		/* watch the remote_list file and the XML file itself */
 		if (!fu_remote_list_add_inotify (self, filename, error))
@@ -232,6 +255,11 @@ fu_remote_list_add_for_path (FuRemoteList *self, const gchar *path, GError **err
 	return TRUE;
 }
 
+static gboolean fu_remote_list_reload_remote (FuRemoteList *self,
+					      FwupdRemote *remote,
+					      gboolean *changed,
+					      GError **error);
+
 gboolean
 fu_remote_list_set_key_value (FuRemoteList *self,
 			      const gchar *remote_id,
@@ -265,12 +293,9 @@ fu_remote_list_set_key_value (FuRemoteList *self,
 	if (!g_key_file_save_to_file (keyfile, filename, error))
 		return FALSE;
 
-	/* reload values */
-	if (!fwupd_remote_load_from_filename (remote, filename,
-					      NULL, error)) {
-		g_prefix_error (error, "failed to load %s: ", filename);
+	/* reload values, which also stops the file monitor doing it again */
+	if (!fu_remote_list_reload_remote (self, remote, NULL, error))
 		return FALSE;
-	}
 	fu_remote_list_emit_changed (self);
 	return TRUE;
 }
@@ -328,15 +353,43 @@ fu_remote_list_depsolve_with_direction (FuRemoteList *self, gint inc)
 	return cnt;
 }
 
+static gboolean
+fu_remote_list_depsolve (FuRemoteList *self, GError **error)
+{
+	guint depsolve_check;
+
+	/* depsolve */
+	for (depsolve_check = 0; depsolve_check < 100; depsolve_check++) {
+		guint cnt = 0;
+		cnt += fu_remote_list_depsolve_with_direction (self, 1);
+		cnt += fu_remote_list_depsolve_with_direction (self, -1);
+		if (cnt == 0)
+			break;
+	}
+	if (depsolve_check == 100) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "Cannot depsolve remotes ordering");
+		return FALSE;
+	}
+
+	/* order these by priority, then name */
+	g_ptr_array_sort (self->array, fu_remote_list_sort_cb);
+
+	/* success */
+	return TRUE;
+}
+
 gboolean
 fu_remote_list_reload (FuRemoteList *self, GError **error)
 {
-	guint depsolve_check;
 	g_autofree gchar *remotesdir = NULL;
 
 	/* clear */
 	g_ptr_array_set_size (self->array, 0);
-	g_ptr_array_set_size (self->monitors, 0);
+	fu_remote_list_remove_inotify (self);
+	g_hash_table_remove_all (self->hash_checksums);
 
 	/* use sysremotes, and then fall back to /etc */
 	remotesdir = fu_common_get_path (FU_PATH_KIND_SYSCONFDIR_PKG);
@@ -348,30 +401,95 @@ fu_remote_list_reload (FuRemoteList *self, GError **error)
 	/* look for all remote_list */
 	if (!fu_remote_list_add_for_path (self, remotesdir, error))
 		return FALSE;
+	return fu_remote_list_depsolve (self, error);
+}
 
-	/* depsolve */
-	for (depsolve_check = 0; depsolve_check < 100; depsolve_check++) {
-		guint cnt = 0;
-		cnt += fu_remote_list_depsolve_with_direction (self, 1);
-		cnt += fu_remote_list_depsolve_with_direction (self, -1);
-		if (cnt == 0)
-			break;
+/* reloads just the one keyfile, keeping the agreement and the file monitors,
+ * and sets @changed to %FALSE if the contents are the same as last time */
+static gboolean
+fu_remote_list_reload_remote (FuRemoteList *self,
+			      FwupdRemote *remote,
+			      gboolean *changed,
+			      GError **error)
+{
+	const gchar *filename = fwupd_remote_get_filename_source (remote);
+	g_autofree gchar *checksum = fu_remote_list_get_checksum (filename);
+
+	if (checksum != NULL &&
+	    g_strcmp0 (checksum, g_hash_table_lookup (self->hash_checksums, filename)) == 0) {
+		g_debug ("%s unchanged", filename);
+		if (changed != NULL)
+			*changed = FALSE;
+		return TRUE;
 	}
-	if (depsolve_check == 100) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INTERNAL,
-				     "Cannot depsolve remotes ordering");
+	g_debug ("reloading remote from %s", filename);
+	if (!fwupd_remote_load_from_filename (remote, filename, NULL, error)) {
+		g_prefix_error (error, "failed to load %s: ", filename);
 		return FALSE;
 	}
+	fwupd_remote_set_mtime (remote, _fwupd_remote_get_mtime (remote));
+	g_hash_table_insert (self->hash_checksums,
+			     g_strdup (filename),
+			     g_steal_pointer (&checksum));
+	if (changed != NULL)
+		*changed = TRUE;
+
+	/* the other remotes are already loaded, so only the order changes */
+	return fu_remote_list_depsolve (self, error);
+}
 
-	/* order these by priority, then name */
-	g_ptr_array_sort (self->array, fu_remote_list_sort_cb);
+static gboolean
+fu_remote_list_handle_changed_file (FuRemoteList *self,
+				    const gchar *filename,
+				    GError **error)
+{
+	for (guint i = 0; i < self->array->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (self->array, i);
 
-	/* success */
+		/* the keyfile was edited */
+		if (g_strcmp0 (filename, fwupd_remote_get_filename_source (remote)) == 0) {
+			gboolean changed = FALSE;
+			if (!g_file_test (filename, G_FILE_TEST_EXISTS))
+				break;
+			if (!fu_remote_list_reload_remote (self, remote, &changed, error))
+				return FALSE;
+			if (changed)
+				fu_remote_list_emit_changed (self);
+			return TRUE;
+		}
+
+		/* the metadata was downloaded */
+		if (g_strcmp0 (filename, fwupd_remote_get_filename_cache (remote)) == 0) {
+			fwupd_remote_set_mtime (remote, _fwupd_remote_get_mtime (remote));
+			fu_remote_list_emit_changed (self);
+			return TRUE;
+		}
+	}
+
+	/* ignore editor backup files and the like */
+	if (!g_str_has_suffix (filename, ".conf") &&
+	    !g_str_has_suffix (filename, "remotes.d"))
+		return TRUE;
+
+	/* a remote was added or removed */
+	g_debug ("%s changed, reloading all remotes", filename);
+	if (!fu_remote_list_reload (self, error))
+		return FALSE;
+	fu_remote_list_emit_changed (self);
 	return TRUE;
 }
 
+static void
+fu_remote_list_file_watch_changed_cb (FuFileWatch *file_watch,
+				      const gchar *filename,
+				      gpointer user_data)
+{
+	FuRemoteList *self = FU_REMOTE_LIST (user_data);
+	g_autoptr(GError) error = NULL;
+	if (!fu_remote_list_handle_changed_file (self, filename, &error))
+		g_warning ("failed to rescan remotes: %s", error->message);
+}
+
 static gboolean
 fu_remote_list_load_metainfos (XbBuilder *builder, GError **error)
 {
@@ -479,7 +597,8 @@ static void
 fu_remote_list_init (FuRemoteList *self)
 {
 	self->array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	self->monitors = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->watch_ids = g_array_new (FALSE, FALSE, sizeof(guint));
+	self->hash_checksums = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 }
 
 static void
@@ -489,7 +608,11 @@ fu_remote_list_finalize (GObject *obj)
 	if (self->silo != NULL)
 		g_object_unref (self->silo);
 	g_ptr_array_unref (self->array);
-	g_ptr_array_unref (self->monitors);
+	fu_remote_list_remove_inotify (self);
+	g_array_unref (self->watch_ids);
+	if (self->file_watch != NULL)
+		g_object_unref (self->file_watch);
+	g_hash_table_unref (self->hash_checksums);
 	G_OBJECT_CLASS (fu_remote_list_parent_class)->finalize (obj);
 }
 
@@ -10,6 +10,8 @@
 
 #include "fwupd-remote.h"
 
+#include "fu-file-watch.h"
+
 #define FU_TYPE_REMOTE_LIST (fu_remote_list_get_type ())
 G_DECLARE_FINAL_TYPE (FuRemoteList, fu_remote_list, FU, REMOTE_LIST, GObject)
 
@@ -28,6 +30,8 @@ typedef enum {
 } FuRemoteListLoadFlags;
 
 FuRemoteList	*fu_remote_list_new			(void);
+void		 fu_remote_list_set_file_watch		(FuRemoteList	*self,
+							 FuFileWatch	*file_watch);
 gboolean	 fu_remote_list_load			(FuRemoteList	*self,
 							 FuRemoteListLoadFlags flags,
 							 GError		**error);
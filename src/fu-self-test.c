@@ -29,6 +29,11 @@
 #include "fu-security-attrs.h"
 #include "fu-smbios-private.h"
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include "fu-zstd-decompressor.h"
+#endif
+
 typedef struct {
 	FuPlugin	*plugin;
 } FuTest;
@@ -36,6 +41,21 @@ typedef struct {
 static GMainLoop *_test_loop = NULL;
 static guint _test_loop_timeout_id = 0;
 
+/* each shard gets its own state so they can be run in parallel */
+static gchar *_test_root = NULL;
+static gchar *_test_confdir = NULL;
+static guint _test_shard = 0;
+static guint _test_shards = 1;
+static guint _test_idx = 0;
+
+/* returns a path inside the test root, valid for the life of the process */
+static const gchar *
+fu_test_path (const gchar *fn)
+{
+	g_autofree gchar *tmp = g_build_filename (_test_root, fn, NULL);
+	return g_intern_string (tmp);
+}
+
 static gboolean
 fu_test_hang_check_cb (gpointer user_data)
 {
@@ -71,12 +91,60 @@ fu_test_loop_quit (void)
 static void
 fu_self_test_mkroot (void)
 {
-	if (g_file_test ("/tmp/fwupd-self-test", G_FILE_TEST_EXISTS)) {
+	if (g_file_test (_test_root, G_FILE_TEST_EXISTS)) {
 		g_autoptr(GError) error = NULL;
-		if (!fu_common_rmtree ("/tmp/fwupd-self-test", &error))
+		if (!fu_common_rmtree (_test_root, &error))
 			g_warning ("failed to mkroot: %s", error->message);
 	}
-	g_assert_cmpint (g_mkdir_with_parents ("/tmp/fwupd-self-test/var/lib/fwupd", 0755), ==, 0);
+	g_assert_cmpint (g_mkdir_with_parents (fu_test_path ("var/lib/fwupd"), 0755), ==, 0);
+}
+
+/* the test remotes refer to files in the test root, so rewrite them */
+static void
+fu_self_test_mkconfdir (void)
+{
+	const gchar *dirs[] = { "", "remotes.d", NULL };
+
+	if (g_file_test (_test_confdir, G_FILE_TEST_EXISTS)) {
+		g_autoptr(GError) error = NULL;
+		if (!fu_common_rmtree (_test_confdir, &error))
+			g_warning ("failed to mkconfdir: %s", error->message);
+	}
+	for (guint i = 0; dirs[i] != NULL; i++) {
+		const gchar *fn;
+		g_autofree gchar *path_src = g_build_filename (TESTDATADIR_SRC, dirs[i], NULL);
+		g_autofree gchar *path_dst = g_build_filename (_test_confdir, dirs[i], NULL);
+		g_autoptr(GDir) dir = NULL;
+		g_autoptr(GError) error = NULL;
+
+		g_assert_cmpint (g_mkdir_with_parents (path_dst, 0755), ==, 0);
+		dir = g_dir_open (path_src, 0, &error);
+		g_assert_no_error (error);
+		while ((fn = g_dir_read_name (dir)) != NULL) {
+			g_autofree gchar *data = NULL;
+			g_autofree gchar *fn_src = g_build_filename (path_src, fn, NULL);
+			g_autofree gchar *fn_dst = g_build_filename (path_dst, fn, NULL);
+			g_auto(GStrv) split = NULL;
+			g_autofree gchar *data_new = NULL;
+			if (!g_str_has_suffix (fn, ".conf"))
+				continue;
+			g_assert_true (g_file_get_contents (fn_src, &data, NULL, &error));
+			g_assert_no_error (error);
+			split = g_strsplit (data, "/tmp/fwupd-self-test", -1);
+			data_new = g_strjoinv (_test_root, split);
+			g_assert_true (g_file_set_contents (fn_dst, data_new, -1, &error));
+			g_assert_no_error (error);
+		}
+	}
+}
+
+/* only add the test if it belongs to this shard */
+static void
+fu_test_add (FuTest *self, const gchar *testpath, GTestDataFunc test_func)
+{
+	if (_test_idx++ % _test_shards != _test_shard)
+		return;
+	g_test_add_data_func (testpath, self, test_func);
 }
 
 static gboolean
@@ -87,12 +155,13 @@ fu_test_compare_lines (const gchar *txt1, const gchar *txt2, GError **error)
 		return TRUE;
 	if (fu_common_fnmatch (txt2, txt1))
 		return TRUE;
-	if (!g_file_set_contents ("/tmp/a", txt1, -1, error))
+	g_autofree gchar *cmd = NULL;
+	if (!g_file_set_contents (fu_test_path ("a"), txt1, -1, error))
 		return FALSE;
-	if (!g_file_set_contents ("/tmp/b", txt2, -1, error))
+	if (!g_file_set_contents (fu_test_path ("b"), txt2, -1, error))
 		return FALSE;
-	if (!g_spawn_command_line_sync ("diff -urNp /tmp/b /tmp/a",
-					&output, NULL, NULL, error))
+	cmd = g_strdup_printf ("diff -urNp %s %s", fu_test_path ("b"), fu_test_path ("a"));
+	if (!g_spawn_command_line_sync (cmd, &output, NULL, NULL, error))
 		return FALSE;
 	g_set_error_literal (error, 1, 0, output);
 	return FALSE;
@@ -127,7 +196,7 @@ fu_engine_generate_md_func (gconstpointer user_data)
 	data = fu_common_get_contents_bytes (filename, &error);
 	g_assert_no_error (error);
 	g_assert_nonnull (data);
-	ret = fu_common_set_contents_bytes ("/tmp/fwupd-self-test/var/cache/fwupd/foo.cab",
+	ret = fu_common_set_contents_bytes (fu_test_path ("var/cache/fwupd/foo.cab"),
 					    data, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -946,8 +1015,11 @@ fu_engine_device_priority_func (gconstpointer user_data)
 	g_autoptr(FuDevice) device2 = fu_device_new ();
 	g_autoptr(FuDevice) device3 = fu_device_new ();
 	g_autoptr(FuDevice) device4 = fu_device_new ();
+	guint64 generation;
 	g_autoptr(FuDevice) device5 = fu_device_new ();
+	g_autoptr(FuDevice) device6 = fu_device_new ();
 	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
 	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
 	g_autoptr(GError) error = NULL;
 	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
@@ -1033,6 +1105,31 @@ fu_engine_device_priority_func (gconstpointer user_data)
 	g_assert_cmpstr (fu_device_get_name (device), ==, "ABC");
 	device = g_ptr_array_index (devices, 2);
 	g_assert_cmpstr (fu_device_get_name (device), ==, "BCD");
+
+	/* the cached sort is reused until a device is added */
+	generation = fu_engine_get_devices_generation (engine);
+	devices_tmp = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices_tmp);
+	g_assert_cmpint (devices_tmp->len, ==, 3);
+	g_assert (g_ptr_array_index (devices_tmp, 0) == g_ptr_array_index (devices, 0));
+	g_assert_cmpint (fu_engine_get_devices_generation (engine), ==, generation);
+	fu_device_set_id (device6, "id6");
+	fu_device_set_vendor_id (device6, "USB:FFFF");
+	fu_device_set_protocol (device6, "com.acme");
+	fu_device_set_plugin (device6, "uefi");
+	fu_device_add_instance_id (device6, "GUID6");
+	fu_device_set_name (device6, "AAA");
+	fu_device_convert_instance_ids (device6);
+	fu_engine_add_device (engine, device6);
+	g_assert_cmpint (fu_engine_get_devices_generation (engine), >, generation);
+	g_clear_pointer (&devices_tmp, g_ptr_array_unref);
+	devices_tmp = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices_tmp);
+	g_assert_cmpint (devices_tmp->len, ==, 4);
+	device = g_ptr_array_index (devices_tmp, 1);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "AAA");
 }
 
 static void
@@ -1198,6 +1295,55 @@ fu_engine_device_unlock_func (gconstpointer user_data)
 	g_assert_nonnull (fwupd_device_get_release_default (FWUPD_DEVICE (device)));
 }
 
+static void
+fu_engine_archive_cache_func (gconstpointer user_data)
+{
+	gboolean ret;
+	guint32 cache_items = 0;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GBytes) blob_cab = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) stats = NULL;
+	g_autoptr(XbSilo) silo1 = NULL;
+	g_autoptr(XbSilo) silo2 = NULL;
+	g_autoptr(XbSilo) silo3 = NULL;
+
+#if defined(__s390x__)
+	/* See https://github.com/fwupd/fwupd/issues/318 for more information */
+	g_test_skip ("Skipping archive cache test on s390x due to known problem with gcab");
+	return;
+#endif
+
+	/* load engine to get FuConfig set up */
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* the second parse of the same archive is served from the cache */
+	filename = g_build_filename (TESTDATADIR_DST, "missing-hwid", "noreqs-1.2.3.cab", NULL);
+	blob_cab = fu_common_get_contents_bytes	(filename, &error);
+	g_assert_no_error (error);
+	g_assert (blob_cab != NULL);
+	silo1 = fu_engine_get_silo_from_blob (engine, blob_cab, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo1);
+	silo2 = fu_engine_get_silo_from_blob (engine, blob_cab, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo2);
+	g_assert (silo1 == silo2);
+
+	/* trimming drops the archive, so it is parsed again */
+	stats = g_variant_ref_sink (fu_engine_get_memory_stats (engine));
+	g_assert_true (g_variant_lookup (stats, "ArchiveCacheItems", "u", &cache_items));
+	g_assert_cmpint (cache_items, ==, 1);
+	fu_engine_trim_caches (engine);
+	silo3 = fu_engine_get_silo_from_blob (engine, blob_cab, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo3);
+	g_assert (silo3 != silo1);
+}
+
 static void
 fu_engine_require_hwid_func (gconstpointer user_data)
 {
@@ -1268,6 +1414,7 @@ fu_engine_downgrade_func (gconstpointer user_data)
 {
 	FwupdRelease *rel;
 	gboolean ret;
+	guint64 generation;
 	g_autoptr(FuDevice) device = fu_device_new ();
 	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
 	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
@@ -1276,6 +1423,7 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_autoptr(GPtrArray) devices_pre = NULL;
 	g_autoptr(GPtrArray) releases_dg = NULL;
 	g_autoptr(GPtrArray) releases = NULL;
+	g_autoptr(GPtrArray) releases_tmp = NULL;
 	g_autoptr(GPtrArray) releases_up = NULL;
 	g_autoptr(GPtrArray) remotes = NULL;
 	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
@@ -1287,13 +1435,13 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	fu_engine_set_silo (engine, silo_empty);
 
 	/* write a broken file */
-	ret = g_file_set_contents ("/tmp/fwupd-self-test/broken.xml.gz",
+	ret = g_file_set_contents (fu_test_path ("broken.xml.gz"),
 				   "this is not a valid", -1, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
 
 	/* write the main file */
-	ret = g_file_set_contents ("/tmp/fwupd-self-test/stable.xml",
+	ret = g_file_set_contents (fu_test_path ("stable.xml"),
 				   "<components>"
 				   "  <component type=\"firmware\">"
 				   "    <id>test</id>"
@@ -1323,7 +1471,7 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_assert (ret);
 
 	/* write the extra file */
-	ret = g_file_set_contents ("/tmp/fwupd-self-test/testing.xml",
+	ret = g_file_set_contents (fu_test_path ("testing.xml"),
 				   "<components>"
 				   "  <component type=\"firmware\">"
 				   "    <id>test</id>"
@@ -1352,7 +1500,7 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_assert_no_error (error);
 	g_assert (ret);
 
-	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", _test_confdir, TRUE);
 	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -1397,6 +1545,18 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_assert (releases != NULL);
 	g_assert_cmpint (releases->len, ==, 4);
 
+	/* the cached result is the same */
+	generation = fu_engine_get_releases_generation (engine);
+	releases_tmp = fu_engine_get_releases (engine,
+					       request,
+					       fu_device_get_id (device),
+					       &error);
+	g_assert_no_error (error);
+	g_assert (releases_tmp != NULL);
+	g_assert_cmpint (releases_tmp->len, ==, 4);
+	g_assert (g_ptr_array_index (releases_tmp, 0) == g_ptr_array_index (releases, 0));
+	g_assert_cmpint (fu_engine_get_releases_generation (engine), ==, generation);
+
 	/* no upgrades, as no firmware is approved */
 	releases_up = fu_engine_get_upgrades (engine,
 					      request,
@@ -1406,9 +1566,10 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_assert_null (releases_up);
 	g_clear_error (&error);
 
-	/* retry with approved firmware set */
+	/* retry with approved firmware set, which invalidates the cache */
 	fu_engine_add_approved_firmware (engine, "deadbeefdeadbeefdeadbeefdeadbeef");
 	fu_engine_add_approved_firmware (engine, "XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX");
+	g_assert_cmpint (fu_engine_get_releases_generation (engine), >, generation);
 
 	/* upgrades */
 	releases_up = fu_engine_get_upgrades (engine,
@@ -1457,7 +1618,7 @@ fu_engine_install_duration_func (gconstpointer user_data)
 	fu_engine_set_silo (engine, silo_empty);
 
 	/* write the main file */
-	ret = g_file_set_contents ("/tmp/fwupd-self-test/stable.xml",
+	ret = g_file_set_contents (fu_test_path ("stable.xml"),
 				   "<components>"
 				   "  <component type=\"firmware\">"
 				   "    <id>test</id>"
@@ -1476,7 +1637,7 @@ fu_engine_install_duration_func (gconstpointer user_data)
 	g_assert_no_error (error);
 	g_assert (ret);
 
-	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", _test_confdir, TRUE);
 	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -1541,7 +1702,7 @@ fu_engine_history_func (gconstpointer user_data)
 	/* set up dummy plugin */
 	fu_engine_add_plugin (engine, self->plugin);
 
-	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", _test_confdir, TRUE);
 	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -1668,7 +1829,7 @@ fu_engine_multiple_rels_func (gconstpointer user_data)
 	/* set up dummy plugin */
 	fu_engine_add_plugin (engine, self->plugin);
 
-	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", _test_confdir, TRUE);
 	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -1739,7 +1900,7 @@ fu_engine_history_inherit (gconstpointer user_data)
 	/* set up dummy plugin */
 	g_setenv ("FWUPD_PLUGIN_TEST", "fail", TRUE);
 	fu_engine_add_plugin (engine, self->plugin);
-	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", _test_confdir, TRUE);
 	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -1850,7 +2011,7 @@ fu_engine_history_error_func (gconstpointer user_data)
 	g_setenv ("FWUPD_PLUGIN_TEST", "fail", TRUE);
 	fu_engine_add_plugin (engine, self->plugin);
 
-	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", _test_confdir, TRUE);
 	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
@@ -2064,6 +2225,11 @@ fu_device_list_replug_auto_func (gconstpointer user_data)
 	g_assert (ret);
 	g_assert_false (fu_device_has_flag (device1, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG));
 
+	/* the real replug time was recorded on the new device */
+	g_assert_cmpint (fu_device_get_metadata_integer (device2, "ReplugTime"), >=, 100);
+	g_assert_cmpint (fu_device_get_metadata_integer (device2, "ReplugTime"), <,
+			 FU_DEVICE_REMOVE_DELAY_RE_ENUMERATE);
+
 	/* check device2 now has parent too */
 	g_assert (fu_device_get_parent (device2) == parent);
 
@@ -2251,6 +2417,51 @@ fu_device_list_remove_chain_func (gconstpointer user_data)
 	g_assert_cmpint (changed_cnt, ==, 0);
 }
 
+static void
+fu_device_list_index_func (gconstpointer user_data)
+{
+	g_autoptr(FuDeviceList) device_list = fu_device_list_new ();
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* add both */
+	fu_device_set_id (device1, "device1");
+	fu_device_set_physical_id (device1, "usb:01:00");
+	fu_device_add_instance_id (device1, "foobar");
+	fu_device_convert_instance_ids (device1);
+	fu_device_list_add (device_list, device1);
+	fu_device_set_id (device2, "device2");
+	fu_device_set_physical_id (device2, "usb:02:00");
+	fu_device_add_instance_id (device2, "baz");
+	fu_device_convert_instance_ids (device2);
+	fu_device_list_add (device_list, device2);
+
+	/* GUID added after the device was indexed */
+	fu_device_add_guid (device2, "bc41956a-e9c5-4b77-89b0-bb922e7eb80b");
+	device = fu_device_list_get_by_guid (device_list,
+					     "bc41956a-e9c5-4b77-89b0-bb922e7eb80b",
+					     &error);
+	g_assert_no_error (error);
+	g_assert (device == device2);
+	g_clear_object (&device);
+
+	/* abbreviated hash */
+	device = fu_device_list_get_by_id (device_list, "99249eb", &error);
+	g_assert_no_error (error);
+	g_assert (device == device1);
+	g_clear_object (&device);
+
+	/* removed devices are no longer found */
+	fu_device_list_remove (device_list, device1);
+	device = fu_device_list_get_by_id (device_list,
+					   "99249eb1bd9ef0b6e192b271a8cb6a3090cfec7a",
+					   &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (device == NULL);
+}
+
 static void
 fu_device_list_func (gconstpointer user_data)
 {
@@ -2259,6 +2470,7 @@ fu_device_list_func (gconstpointer user_data)
 	g_autoptr(FuDevice) device2 = fu_device_new ();
 	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GPtrArray) devices2 = NULL;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
 	g_autoptr(GError) error = NULL;
 	FuDevice *device;
 	guint added_cnt = 0;
@@ -2295,6 +2507,10 @@ fu_device_list_func (gconstpointer user_data)
 	g_assert_cmpstr (fu_device_get_id (device), ==,
 			 "99249eb1bd9ef0b6e192b271a8cb6a3090cfec7a");
 
+	/* the snapshot is shared until the list changes */
+	devices_tmp = fu_device_list_get_all (device_list);
+	g_assert (devices_tmp == devices);
+
 	/* find by ID */
 	device = fu_device_list_get_by_id (device_list,
 					   "99249eb1bd9ef0b6e192b271a8cb6a3090cfec7a",
@@ -2327,7 +2543,9 @@ fu_device_list_func (gconstpointer user_data)
 	g_assert_cmpint (removed_cnt, ==, 1);
 	g_assert_cmpint (changed_cnt, ==, 0);
 	devices2 = fu_device_list_get_all (device_list);
+	g_assert (devices2 != devices);
 	g_assert_cmpint (devices2->len, ==, 1);
+	g_assert_cmpint (devices->len, ==, 2);
 	device = g_ptr_array_index (devices2, 0);
 	g_assert_cmpstr (fu_device_get_id (device), ==,
 			 "1a8d0d9a96ad3e67ba76cf3033623625dc6d6882");
@@ -2421,7 +2639,7 @@ fu_history_migrate_func (gconstpointer user_data)
 	/* load old version */
 	filename = g_build_filename (TESTDATADIR_SRC, "history_v1.db", NULL);
 	file_src = g_file_new_for_path (filename);
-	file_dst = g_file_new_for_path ("/tmp/fwupd-self-test/var/lib/fwupd/pending.db");
+	file_dst = g_file_new_for_path (fu_test_path ("var/lib/fwupd/pending.db"));
 	ret = g_file_copy (file_src, file_dst, G_FILE_COPY_OVERWRITE, NULL,
 			   NULL, NULL, &error);
 	g_assert_no_error (error);
@@ -2608,9 +2826,11 @@ fu_history_func (gconstpointer user_data)
 	gboolean ret;
 	FuDevice *device;
 	FwupdRelease *release;
+	FuHistoryDurations durations = { 0 };
 	g_autoptr(FuDevice) device_found = NULL;
 	g_autoptr(FuHistory) history = NULL;
 	g_autoptr(GPtrArray) approved_firmware = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
 	g_autofree gchar *dirname = NULL;
 	g_autofree gchar *filename = NULL;
 
@@ -2718,6 +2938,87 @@ fu_history_func (gconstpointer user_data)
 	g_assert_cmpint (approved_firmware->len, ==, 2);
 	g_assert_cmpstr (g_ptr_array_index (approved_firmware, 0), ==, "foo");
 	g_assert_cmpstr (g_ptr_array_index (approved_firmware, 1), ==, "bar");
+	g_clear_pointer (&approved_firmware, g_ptr_array_unref);
+
+	/* discard changes made in a transaction */
+	ret = fu_history_start_transaction (history, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_history_clear_approved_firmware (history, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_history_rollback_transaction (history);
+	approved_firmware = fu_history_get_approved_firmware (history, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (approved_firmware);
+	g_assert_cmpint (approved_firmware->len, ==, 2);
+
+	/* no install durations */
+	ret = fu_history_get_durations (history, "dfu", "guid", &durations, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	/* the median is used */
+	for (guint i = 0; i < 3; i++) {
+		FuHistoryDurations durations_tmp = {
+			.detach = 10 * (i + 1),
+			.write = i == 2 ? 9000 : 1000,
+			.bytes = 4096,
+		};
+		ret = fu_history_add_durations (history, "dfu", "guid", &durations_tmp, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	ret = fu_history_get_durations (history, "dfu", "guid", &durations, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (durations.detach, ==, 20);
+	g_assert_cmpint (durations.write, ==, 1000);
+	g_assert_cmpint (durations.bytes, ==, 4096);
+
+	/* add several devices, the last one pending */
+	for (guint i = 0; i < 4; i++) {
+		g_autofree gchar *device_id = g_strdup_printf ("self-test-%u", i);
+		g_autoptr(FuDevice) device_tmp = fu_device_new ();
+		g_autoptr(FwupdRelease) release_tmp = fwupd_release_new ();
+		fu_device_set_id (device_tmp, device_id);
+		fu_device_set_modified (device_tmp, 1000 + i);
+		fu_device_set_update_state (device_tmp,
+					    i == 0 ? FWUPD_UPDATE_STATE_PENDING :
+						     FWUPD_UPDATE_STATE_SUCCESS);
+		ret = fu_history_add_device (history, device_tmp, release_tmp, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+
+	/* get a page of the newest, oldest first */
+	devices = fu_history_get_devices_range (history, 2, 1, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 2);
+	device = g_ptr_array_index (devices, 0);
+	g_assert_cmpint (fu_device_get_modified (device), ==, 1001);
+	device = g_ptr_array_index (devices, 1);
+	g_assert_cmpint (fu_device_get_modified (device), ==, 1002);
+	g_clear_pointer (&devices, g_ptr_array_unref);
+
+	/* keep the newest entry and the pending update */
+	ret = fu_history_prune (history, 0, 1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	devices = fu_history_get_devices (history, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 2);
+	device = g_ptr_array_index (devices, 0);
+	g_assert_cmpint (fu_device_get_modified (device), ==, 1000);
+	device = g_ptr_array_index (devices, 1);
+	g_assert_cmpint (fu_device_get_modified (device), ==, 1003);
+	g_clear_pointer (&devices, g_ptr_array_unref);
+	ret = fu_history_vacuum (history, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
 }
 
 static GBytes *
@@ -2946,6 +3247,57 @@ fu_plugin_composite_func (gconstpointer user_data)
 	}
 }
 
+#ifdef HAVE_ZSTD
+static void
+fu_zstd_decompressor_func (gconstpointer user_data)
+{
+	gboolean ret;
+	gsize bufsz;
+	gsize sz = 0;
+	g_autofree guint8 *buf = NULL;
+	g_autoptr(FuZstdDecompressor) conv = fu_zstd_decompressor_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) istr = NULL;
+	g_autoptr(GInputStream) istr_zst = NULL;
+	g_autoptr(GString) xml = g_string_new ("<components>");
+	g_autoptr(GString) xml_new = g_string_new (NULL);
+
+	/* larger than the converter stream buffer */
+	for (guint i = 0; i < 10000; i++)
+		g_string_append_printf (xml, "<component><id>%u</id></component>", i);
+	g_string_append (xml, "</components>");
+	bufsz = ZSTD_compressBound (xml->len);
+	buf = g_malloc0 (bufsz);
+	bufsz = ZSTD_compress (buf, bufsz, xml->str, xml->len, 3);
+	g_assert_false (ZSTD_isError (bufsz));
+
+	/* decompress in small chunks */
+	istr = g_memory_input_stream_new_from_data (buf, bufsz, NULL);
+	istr_zst = g_converter_input_stream_new (istr, G_CONVERTER (conv));
+	do {
+		gchar tmp[1024];
+		ret = g_input_stream_read_all (istr_zst, tmp, sizeof(tmp), &sz, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		g_string_append_len (xml_new, tmp, sz);
+	} while (sz > 0);
+	g_assert_cmpstr (xml_new->str, ==, xml->str);
+
+	/* truncated */
+	g_object_unref (istr);
+	g_object_unref (istr_zst);
+	g_converter_reset (G_CONVERTER (conv));
+	istr = g_memory_input_stream_new_from_data (buf, bufsz / 2, NULL);
+	istr_zst = g_converter_input_stream_new (istr, G_CONVERTER (conv));
+	do {
+		gchar tmp[1024];
+		ret = g_input_stream_read_all (istr_zst, tmp, sizeof(tmp), &sz, NULL, &error);
+	} while (ret && sz > 0);
+	g_assert_false (ret);
+	g_assert_nonnull (error);
+}
+#endif
+
 static void
 fu_security_attr_func (gconstpointer user_data)
 {
@@ -3054,6 +3406,12 @@ fu_progressbar_func (gconstpointer user_data)
 		g_usleep (1000);
 	}
 	fu_progressbar_update (progressbar, FWUPD_STATUS_IDLE, 0);
+
+	/* only milestones are shown */
+	fu_progressbar_set_interactive (progressbar, FALSE);
+	for (guint i = 0; i <= 100; i++)
+		fu_progressbar_update (progressbar, FWUPD_STATUS_DEVICE_WRITE, i);
+	fu_progressbar_update (progressbar, FWUPD_STATUS_IDLE, 0);
 }
 
 static gint
@@ -3096,6 +3454,7 @@ fu_install_task_compare_func (gconstpointer user_data)
 int
 main (int argc, char **argv)
 {
+	const gchar *tmp;
 	gboolean ret;
 	g_autofree gchar *pluginfn = NULL;
 	g_autoptr(GError) error = NULL;
@@ -3103,6 +3462,20 @@ main (int argc, char **argv)
 
 	g_test_init (&argc, &argv, NULL);
 
+	/* run a subset of the tests in a private root, e.g. "2/4" */
+	tmp = g_getenv ("FWUPD_SELF_TEST_SHARD");
+	if (tmp != NULL) {
+		g_auto(GStrv) split = g_strsplit (tmp, "/", 2);
+		_test_shard = g_ascii_strtoull (split[0], NULL, 10);
+		_test_shards = split[1] != NULL ? g_ascii_strtoull (split[1], NULL, 10) : 1;
+		g_assert_cmpint (_test_shards, >, 0);
+		g_assert_cmpint (_test_shard, <, _test_shards);
+		_test_root = g_strdup_printf ("/tmp/fwupd-self-test-%u", _test_shard);
+	} else {
+		_test_root = g_strdup ("/tmp/fwupd-self-test");
+	}
+	_test_confdir = g_strdup_printf ("%s-etc", _test_root);
+
 	/* only critical and error are fatal */
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
@@ -3110,11 +3483,12 @@ main (int argc, char **argv)
 	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
 	g_setenv ("FWUPD_SYSCONFDIR", TESTDATADIR_SRC, TRUE);
 	g_setenv ("FWUPD_SYSFSFWDIR", TESTDATADIR_SRC, TRUE);
-	g_setenv ("FWUPD_OFFLINE_TRIGGER", "/tmp/fwupd-self-test/system-update", TRUE);
-	g_setenv ("FWUPD_LOCALSTATEDIR", "/tmp/fwupd-self-test/var", TRUE);
+	g_setenv ("FWUPD_OFFLINE_TRIGGER", fu_test_path ("system-update"), TRUE);
+	g_setenv ("FWUPD_LOCALSTATEDIR", fu_test_path ("var"), TRUE);
 
 	/* ensure empty tree */
 	fu_self_test_mkroot ();
+	fu_self_test_mkconfdir ();
 
 	/* load the test plugin */
 	self->plugin = fu_plugin_new ();
@@ -3127,96 +3501,104 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	if (g_test_slow ()) {
-		g_test_add_data_func ("/fwupd/progressbar", self,
-				      fu_progressbar_func);
+		fu_test_add (self, "/fwupd/progressbar",
+				     fu_progressbar_func);
 	}
-	g_test_add_data_func ("/fwupd/plugin{build-hash}", self,
-			      fu_plugin_hash_func);
-	g_test_add_data_func ("/fwupd/plugin{module}", self,
-			      fu_plugin_module_func);
-	g_test_add_data_func ("/fwupd/memcpy", self,
-			      fu_memcpy_func);
-	g_test_add_data_func ("/fwupd/security-attr", self,
-			      fu_security_attr_func);
-	g_test_add_data_func ("/fwupd/device-list", self,
-			      fu_device_list_func);
-	g_test_add_data_func ("/fwupd/device-list{delay}", self,
-			      fu_device_list_delay_func);
-	g_test_add_data_func ("/fwupd/device-list{compatible}", self,
-			      fu_device_list_compatible_func);
-	g_test_add_data_func ("/fwupd/device-list{remove-chain}", self,
-			      fu_device_list_remove_chain_func);
-	g_test_add_data_func ("/fwupd/install-task{compare}", self,
-			      fu_install_task_compare_func);
-	g_test_add_data_func ("/fwupd/engine{device-unlock}", self,
-			      fu_engine_device_unlock_func);
-	g_test_add_data_func ("/fwupd/engine{multiple-releases}", self,
-			      fu_engine_multiple_rels_func);
-	g_test_add_data_func ("/fwupd/engine{history-success}", self,
-			      fu_engine_history_func);
-	g_test_add_data_func ("/fwupd/engine{history-error}", self,
-			      fu_engine_history_error_func);
+	fu_test_add (self, "/fwupd/plugin{build-hash}",
+			     fu_plugin_hash_func);
+	fu_test_add (self, "/fwupd/plugin{module}",
+			     fu_plugin_module_func);
+	fu_test_add (self, "/fwupd/memcpy",
+			     fu_memcpy_func);
+	fu_test_add (self, "/fwupd/security-attr",
+			     fu_security_attr_func);
+#ifdef HAVE_ZSTD
+	fu_test_add (self, "/fwupd/zstd-decompressor",
+			     fu_zstd_decompressor_func);
+#endif
+	fu_test_add (self, "/fwupd/device-list",
+			     fu_device_list_func);
+	fu_test_add (self, "/fwupd/device-list{index}",
+			     fu_device_list_index_func);
+	fu_test_add (self, "/fwupd/device-list{delay}",
+			     fu_device_list_delay_func);
+	fu_test_add (self, "/fwupd/device-list{compatible}",
+			     fu_device_list_compatible_func);
+	fu_test_add (self, "/fwupd/device-list{remove-chain}",
+			     fu_device_list_remove_chain_func);
+	fu_test_add (self, "/fwupd/install-task{compare}",
+			     fu_install_task_compare_func);
+	fu_test_add (self, "/fwupd/engine{device-unlock}",
+			     fu_engine_device_unlock_func);
+	fu_test_add (self, "/fwupd/engine{multiple-releases}",
+			     fu_engine_multiple_rels_func);
+	fu_test_add (self, "/fwupd/engine{history-success}",
+			     fu_engine_history_func);
+	fu_test_add (self, "/fwupd/engine{history-error}",
+			     fu_engine_history_error_func);
 	if (g_test_slow ()) {
-		g_test_add_data_func ("/fwupd/device-list{replug-auto}", self,
-				      fu_device_list_replug_auto_func);
+		fu_test_add (self, "/fwupd/device-list{replug-auto}",
+				     fu_device_list_replug_auto_func);
 	}
-	g_test_add_data_func ("/fwupd/device-list{replug-user}", self,
-			      fu_device_list_replug_user_func);
-	g_test_add_data_func ("/fwupd/engine{require-hwid}", self,
-			      fu_engine_require_hwid_func);
-	g_test_add_data_func ("/fwupd/engine{history-inherit}", self,
-			      fu_engine_history_inherit);
-	g_test_add_data_func ("/fwupd/engine{partial-hash}", self,
-			      fu_engine_partial_hash_func);
-	g_test_add_data_func ("/fwupd/engine{downgrade}", self,
-			      fu_engine_downgrade_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-success}", self,
-			      fu_engine_requirements_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-missing}", self,
-			      fu_engine_requirements_missing_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-client-fail}", self,
-			      fu_engine_requirements_client_fail_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-client-invalid}", self,
-			      fu_engine_requirements_client_invalid_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-client-pass}", self,
-			      fu_engine_requirements_client_pass_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-version-require}", self,
-			      fu_engine_requirements_version_require_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-parent-device}", self,
-			      fu_engine_requirements_parent_device_func);
-	g_test_add_data_func ("/fwupd/engine{requirements_protocol_check_func}", self,
-			      fu_engine_requirements_protocol_check_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-not-child}", self,
-			      fu_engine_requirements_child_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-not-child-fail}", self,
-			      fu_engine_requirements_child_fail_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-unsupported}", self,
-			      fu_engine_requirements_unsupported_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-device}", self,
-			      fu_engine_requirements_device_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-device-plain}", self,
-			      fu_engine_requirements_device_plain_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-version-format}", self,
-			      fu_engine_requirements_version_format_func);
-	g_test_add_data_func ("/fwupd/engine{device-auto-parent}", self,
-			      fu_engine_device_parent_func);
-	g_test_add_data_func ("/fwupd/engine{device-priority}", self,
-			      fu_engine_device_priority_func);
-	g_test_add_data_func ("/fwupd/engine{install-duration}", self,
-			      fu_engine_install_duration_func);
-	g_test_add_data_func ("/fwupd/engine{generate-md}", self,
-			      fu_engine_generate_md_func);
-	g_test_add_data_func ("/fwupd/engine{requirements-other-device}", self,
-			      fu_engine_requirements_other_device_func);
-	g_test_add_data_func ("/fwupd/plugin{composite}", self,
-			      fu_plugin_composite_func);
-	g_test_add_data_func ("/fwupd/history", self,
-			      fu_history_func);
-	g_test_add_data_func ("/fwupd/history{migrate}", self,
-			      fu_history_migrate_func);
-	g_test_add_data_func ("/fwupd/plugin-list", self,
-			      fu_plugin_list_func);
-	g_test_add_data_func ("/fwupd/plugin-list{depsolve}", self,
-			      fu_plugin_list_depsolve_func);
+	fu_test_add (self, "/fwupd/device-list{replug-user}",
+			     fu_device_list_replug_user_func);
+	fu_test_add (self, "/fwupd/engine{require-hwid}",
+			     fu_engine_require_hwid_func);
+	fu_test_add (self, "/fwupd/engine{archive-cache}",
+			     fu_engine_archive_cache_func);
+	fu_test_add (self, "/fwupd/engine{history-inherit}",
+			     fu_engine_history_inherit);
+	fu_test_add (self, "/fwupd/engine{partial-hash}",
+			     fu_engine_partial_hash_func);
+	fu_test_add (self, "/fwupd/engine{downgrade}",
+			     fu_engine_downgrade_func);
+	fu_test_add (self, "/fwupd/engine{requirements-success}",
+			     fu_engine_requirements_func);
+	fu_test_add (self, "/fwupd/engine{requirements-missing}",
+			     fu_engine_requirements_missing_func);
+	fu_test_add (self, "/fwupd/engine{requirements-client-fail}",
+			     fu_engine_requirements_client_fail_func);
+	fu_test_add (self, "/fwupd/engine{requirements-client-invalid}",
+			     fu_engine_requirements_client_invalid_func);
+	fu_test_add (self, "/fwupd/engine{requirements-client-pass}",
+			     fu_engine_requirements_client_pass_func);
+	fu_test_add (self, "/fwupd/engine{requirements-version-require}",
+			     fu_engine_requirements_version_require_func);
+	fu_test_add (self, "/fwupd/engine{requirements-parent-device}",
+			     fu_engine_requirements_parent_device_func);
+	fu_test_add (self, "/fwupd/engine{requirements_protocol_check_func}",
+			     fu_engine_requirements_protocol_check_func);
+	fu_test_add (self, "/fwupd/engine{requirements-not-child}",
+			     fu_engine_requirements_child_func);
+	fu_test_add (self, "/fwupd/engine{requirements-not-child-fail}",
+			     fu_engine_requirements_child_fail_func);
+	fu_test_add (self, "/fwupd/engine{requirements-unsupported}",
+			     fu_engine_requirements_unsupported_func);
+	fu_test_add (self, "/fwupd/engine{requirements-device}",
+			     fu_engine_requirements_device_func);
+	fu_test_add (self, "/fwupd/engine{requirements-device-plain}",
+			     fu_engine_requirements_device_plain_func);
+	fu_test_add (self, "/fwupd/engine{requirements-version-format}",
+			     fu_engine_requirements_version_format_func);
+	fu_test_add (self, "/fwupd/engine{device-auto-parent}",
+			     fu_engine_device_parent_func);
+	fu_test_add (self, "/fwupd/engine{device-priority}",
+			     fu_engine_device_priority_func);
+	fu_test_add (self, "/fwupd/engine{install-duration}",
+			     fu_engine_install_duration_func);
+	fu_test_add (self, "/fwupd/engine{generate-md}",
+			     fu_engine_generate_md_func);
+	fu_test_add (self, "/fwupd/engine{requirements-other-device}",
+			     fu_engine_requirements_other_device_func);
+	fu_test_add (self, "/fwupd/plugin{composite}",
+			     fu_plugin_composite_func);
+	fu_test_add (self, "/fwupd/history",
+			     fu_history_func);
+	fu_test_add (self, "/fwupd/history{migrate}",
+			     fu_history_migrate_func);
+	fu_test_add (self, "/fwupd/plugin-list",
+			     fu_plugin_list_func);
+	fu_test_add (self, "/fwupd/plugin-list{depsolve}",
+			     fu_plugin_list_depsolve_func);
 	return g_test_run ();
 }
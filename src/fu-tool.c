@@ -60,12 +60,15 @@ struct FuUtilPrivate {
 	gboolean		 prepare_blob;
 	gboolean		 cleanup_blob;
 	gboolean		 enable_json_state;
+	gboolean		 as_json;
 	FwupdInstallFlags	 flags;
 	gboolean		 show_all_devices;
 	gboolean		 disable_ssl_strict;
+	gint			 parallel;
 	/* only valid in update and downgrade */
 	FuUtilOperation		 current_operation;
 	FwupdDevice		*current_device;
+	guint			 current_devices_n;
 	gchar			*current_message;
 	FwupdDeviceFlags	 completion_flags;
 	FwupdDeviceFlags	 filter_include;
@@ -75,11 +78,11 @@ struct FuUtilPrivate {
 static gboolean
 fu_util_save_current_state (FuUtilPrivate *priv, GError **error)
 {
-	g_autoptr(JsonBuilder) builder = NULL;
-	g_autoptr(JsonGenerator) json_generator = NULL;
-	g_autoptr(JsonNode) json_root = NULL;
+	g_autoptr(FuUtilJsonStream) json = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileOutputStream) stream = NULL;
+	g_autoptr(GOutputStream) stream_buf = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
-	g_autofree gchar *state = NULL;
 	g_autofree gchar *dirname = NULL;
 	g_autofree gchar *filename = NULL;
 
@@ -91,35 +94,36 @@ fu_util_save_current_state (FuUtilPrivate *priv, GError **error)
 		return FALSE;
 	fwupd_device_array_ensure_parents (devices);
 
-	/* create header */
-	builder = json_builder_new ();
-	json_builder_begin_object (builder);
-
-	/* add each device */
-	json_builder_set_member_name (builder, "Devices");
-	json_builder_begin_array (builder);
+	/* write each device as it is serialized, replacing atomically */
+	dirname = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	filename = g_build_filename (dirname, "state.json", NULL);
+	file = g_file_new_for_path (filename);
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+	stream_buf = g_buffered_output_stream_new (G_OUTPUT_STREAM (stream));
+	json = fu_util_json_stream_new (stream_buf, "Devices", error);
+	if (json == NULL)
+		return FALSE;
 	for (guint i = 0; i < devices->len; i++) {
 		FwupdDevice *dev = g_ptr_array_index (devices, i);
-		json_builder_begin_object (builder);
-		fwupd_device_to_json (dev, builder);
-		json_builder_end_object (builder);
+		if (!fu_util_json_stream_add_device (json, dev, error))
+			return FALSE;
 	}
-	json_builder_end_array (builder);
-	json_builder_end_object (builder);
-
-	/* export as a string */
-	json_root = json_builder_get_root (builder);
-	json_generator = json_generator_new ();
-	json_generator_set_pretty (json_generator, TRUE);
-	json_generator_set_root (json_generator, json_root);
-	state = json_generator_to_data (json_generator, NULL);
-	if (state == NULL)
+	if (!fu_util_json_stream_close (json, error))
 		return FALSE;
-	dirname = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
-	filename = g_build_filename (dirname, "state.json", NULL);
-	return g_file_set_contents (filename, state, -1, error);
+	return g_output_stream_close (stream_buf, NULL, error);
 }
 
+/* only the plugins are needed to find the firmware types */
+#define FU_UTIL_LOAD_FLAGS_FIRMWARE	(FU_ENGINE_LOAD_FLAG_NO_ENUMERATE | \
+					 FU_ENGINE_LOAD_FLAG_NO_METADATA | \
+					 FU_ENGINE_LOAD_FLAG_NO_HISTORY)
+
+/* just the config, remotes and keyrings */
+#define FU_UTIL_LOAD_FLAGS_MINIMAL	(FU_UTIL_LOAD_FLAGS_FIRMWARE | \
+					 FU_ENGINE_LOAD_FLAG_NO_PLUGINS)
+
 static gboolean
 fu_util_start_engine (FuUtilPrivate *priv, FuEngineLoadFlags flags, GError **error)
 {
@@ -388,6 +392,144 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	FuUtilPrivate		*priv;
+	gchar			*filename;
+	GBytes			*blob;		/* (nullable) */
+	XbSilo			*silo;		/* (nullable) */
+	GError			*error;		/* (nullable) */
+	GAsyncQueue		*done;		/* of FuUtilDetailsItem */
+} FuUtilDetailsItem;
+
+static void
+fu_util_details_item_free (FuUtilDetailsItem *item)
+{
+	g_free (item->filename);
+	if (item->blob != NULL)
+		g_bytes_unref (item->blob);
+	if (item->silo != NULL)
+		g_object_unref (item->silo);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUtilDetailsItem, fu_util_details_item_free)
+
+/* decompress and verify the archive, which is the slow part */
+static void
+fu_util_get_details_thread_cb (gpointer data, gpointer user_data)
+{
+	FuUtilDetailsItem *item = (FuUtilDetailsItem *) data;
+	FuEngine *engine = item->priv->engine;
+
+	item->blob = fu_common_get_contents_bytes (item->filename, &item->error);
+	if (item->blob != NULL &&
+	    g_bytes_get_size (item->blob) > fu_engine_get_archive_size_max (engine)) {
+		g_set_error (&item->error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "%s is too large",
+			     item->filename);
+	}
+	if (item->error == NULL)
+		item->silo = fu_engine_get_silo_from_blob (engine, item->blob, &item->error);
+	g_async_queue_push (item->done, item);
+}
+
+static gchar *
+fu_util_get_details_item_to_json (FuUtilPrivate *priv, FuUtilDetailsItem *item)
+{
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+	g_autoptr(JsonNode) json_root = NULL;
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "Filename");
+	json_builder_add_string_value (builder, item->filename);
+	if (item->silo != NULL) {
+		array = fu_engine_get_details_for_silo (priv->engine,
+							priv->request,
+							item->blob,
+							item->silo,
+							&item->error);
+	}
+	if (array == NULL) {
+		json_builder_set_member_name (builder, "Error");
+		json_builder_add_string_value (builder, item->error->message);
+	} else {
+		json_builder_set_member_name (builder, "Devices");
+		json_builder_begin_array (builder);
+		for (guint i = 0; i < array->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (array, i);
+			if (!fu_util_filter_device (priv, dev))
+				continue;
+			json_builder_begin_object (builder);
+			fwupd_device_to_json (dev, builder);
+			json_builder_end_object (builder);
+		}
+		json_builder_end_array (builder);
+	}
+	json_builder_end_object (builder);
+
+	/* one line per file, in the order they were completed */
+	json_root = json_builder_get_root (builder);
+	json_generator_set_root (json_generator, json_root);
+	return json_generator_to_data (json_generator, NULL);
+}
+
+static gboolean
+fu_util_get_details_batch (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	guint failed = 0;
+	guint n_values = g_strv_length (values);
+	guint threads_max = priv->parallel > 0 ? (guint) priv->parallel : g_get_num_processors ();
+	GThreadPool *pool;
+	g_autoptr(GAsyncQueue) done = g_async_queue_new ();
+
+	pool = g_thread_pool_new (fu_util_get_details_thread_cb, NULL,
+				  (gint) MIN (threads_max, n_values), TRUE, error);
+	if (pool == NULL)
+		return FALSE;
+
+	/* status is emitted from the main thread only */
+	g_signal_handlers_block_by_func (priv->engine,
+					 fu_main_engine_status_changed_cb,
+					 priv);
+	for (guint i = 0; i < n_values; i++) {
+		FuUtilDetailsItem *item = g_new0 (FuUtilDetailsItem, 1);
+		item->priv = priv;
+		item->filename = g_strdup (values[i]);
+		item->done = done;
+		if (!g_thread_pool_push (pool, item, &item->error))
+			g_async_queue_push (done, item);
+	}
+
+	/* the requirements use the engine, so are checked here */
+	for (guint i = 0; i < n_values; i++) {
+		g_autofree gchar *json = NULL;
+		g_autoptr(FuUtilDetailsItem) item = g_async_queue_pop (done);
+		json = fu_util_get_details_item_to_json (priv, item);
+		if (item->error != NULL)
+			failed++;
+		g_print ("%s\n", json);
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_signal_handlers_unblock_by_func (priv->engine,
+					   fu_main_engine_status_changed_cb,
+					   priv);
+	if (failed > 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "%u of %u files failed",
+			     failed, n_values);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_util_get_details (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -402,7 +544,7 @@ fu_util_get_details (FuUtilPrivate *priv, gchar **values, GError **error)
 	title = fu_util_get_tree_title (priv);
 
 	/* check args */
-	if (g_strv_length (values) != 1) {
+	if (g_strv_length (values) < 1) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_ARGS,
@@ -413,6 +555,10 @@ fu_util_get_details (FuUtilPrivate *priv, gchar **values, GError **error)
 	/* implied, important for get-details on a device not in your system */
 	priv->show_all_devices = TRUE;
 
+	/* many archives are processed at the same time */
+	if (g_strv_length (values) > 1)
+		return fu_util_get_details_batch (priv, values, error);
+
 	/* open file */
 	fd = open (values[0], O_RDONLY);
 	if (fd < 0) {
@@ -499,6 +645,23 @@ fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 	devs = fu_engine_get_devices (priv->engine, error);
 	if (devs == NULL)
 		return FALSE;
+	fwupd_device_array_ensure_parents (devs);
+	if (priv->as_json) {
+		g_autoptr(FuUtilJsonStream) json = NULL;
+		json = fu_util_json_stream_new_for_stdout ("Devices", error);
+		if (json == NULL)
+			return FALSE;
+		for (guint i = 0; i < devs->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (devs, i);
+			if (!fu_util_filter_device (priv, dev))
+				continue;
+			if (!fu_util_json_stream_add_device (json, dev, error))
+				return FALSE;
+		}
+		if (!fu_util_json_stream_close (json, error))
+			return FALSE;
+		return fu_util_save_current_state (priv, error);
+	}
 
 	/* print */
 	if (devs->len == 0) {
@@ -506,7 +669,6 @@ fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 		g_print ("%s\n", _("No hardware detected with firmware update capability"));
 		return TRUE;
 	}
-	fwupd_device_array_ensure_parents (devs);
 	fu_util_build_device_tree (priv, root, devs, NULL);
 	fu_util_print_tree (root, title);
 
@@ -609,7 +771,17 @@ fu_util_update_device_changed_cb (FwupdClient *client,
 	}
 
 	/* show message in progressbar */
-	if (priv->current_operation == FU_UTIL_OPERATION_UPDATE) {
+	if (priv->current_devices_n > 1) {
+		/* the percentage is the mean of all the devices */
+		if (priv->current_device == NULL) {
+			/* TRANSLATORS: %1 is the number of devices being updated at the same time */
+			str = g_strdup_printf (ngettext ("Installing on %u device…",
+							 "Installing on %u devices…",
+							 priv->current_devices_n),
+					       priv->current_devices_n);
+			fu_progressbar_set_title (priv->progressbar, str);
+		}
+	} else if (priv->current_operation == FU_UTIL_OPERATION_UPDATE) {
 		/* TRANSLATORS: %1 is a device name */
 		str = g_strdup_printf (_("Updating %s…"),
 				       fwupd_device_get_name (device));
@@ -782,7 +954,10 @@ fu_util_firmware_read (FuUtilPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv,
+				   FU_ENGINE_LOAD_FLAG_NO_METADATA |
+				   FU_ENGINE_LOAD_FLAG_NO_HISTORY,
+				   error))
 		return FALSE;
 
 	/* get device */
@@ -971,6 +1146,8 @@ fu_util_install (FuUtilPrivate *priv, gchar **values, GError **error)
 	}
 
 	priv->current_operation = FU_UTIL_OPERATION_INSTALL;
+	if (priv->parallel != 1)
+		priv->current_devices_n = install_tasks->len;
 	g_signal_connect (priv->engine, "device-changed",
 			  G_CALLBACK (fu_util_update_device_changed_cb), priv);
 
@@ -1276,7 +1453,10 @@ fu_util_detach (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv,
+				   FU_ENGINE_LOAD_FLAG_NO_METADATA |
+				   FU_ENGINE_LOAD_FLAG_NO_HISTORY,
+				   error))
 		return FALSE;
 
 	/* get device */
@@ -1304,7 +1484,10 @@ fu_util_attach (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv,
+				   FU_ENGINE_LOAD_FLAG_NO_METADATA |
+				   FU_ENGINE_LOAD_FLAG_NO_HISTORY,
+				   error))
 		return FALSE;
 
 	/* get device */
@@ -1510,7 +1693,7 @@ fu_util_self_sign (FuUtilPrivate *priv, gchar **values, GError **error)
 	}
 
 	/* start engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv, FU_UTIL_LOAD_FLAGS_MINIMAL, error))
 		return FALSE;
 	sig = fu_engine_self_sign (priv->engine, values[0],
 				   JCAT_SIGN_FLAG_ADD_TIMESTAMP |
@@ -1588,7 +1771,7 @@ fu_util_get_firmware_types (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(GPtrArray) firmware_types = NULL;
 
 	/* load engine */
-	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, error))
+	if (!fu_engine_load (priv->engine, FU_UTIL_LOAD_FLAGS_FIRMWARE, error))
 		return FALSE;
 
 	firmware_types = fu_engine_get_firmware_gtype_ids (priv->engine);
@@ -1659,7 +1842,7 @@ fu_util_firmware_parse (FuUtilPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 
 	/* load engine */
-	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, error))
+	if (!fu_engine_load (priv->engine, FU_UTIL_LOAD_FLAGS_FIRMWARE, error))
 		return FALSE;
 
 	/* find the GType to use */
@@ -1683,6 +1866,255 @@ fu_util_firmware_parse (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	const gchar		*name;
+	gsize			 size;		/* bytes processed each iteration */
+	GArray			*samples;	/* of gint64, µs */
+} FuUtilBenchPhase;
+
+static void
+fu_util_bench_phase_free (FuUtilBenchPhase *phase)
+{
+	g_array_unref (phase->samples);
+	g_free (phase);
+}
+
+static FuUtilBenchPhase *
+fu_util_bench_phase_new (GPtrArray *phases, const gchar *name, gsize size)
+{
+	FuUtilBenchPhase *phase = g_new0 (FuUtilBenchPhase, 1);
+	phase->name = name;
+	phase->size = size;
+	phase->samples = g_array_new (FALSE, FALSE, sizeof(gint64));
+	g_ptr_array_add (phases, phase);
+	return phase;
+}
+
+static gint
+fu_util_bench_sample_sort_cb (gconstpointer a, gconstpointer b)
+{
+	gint64 tmp_a = *((const gint64 *) a);
+	gint64 tmp_b = *((const gint64 *) b);
+	if (tmp_a < tmp_b)
+		return -1;
+	if (tmp_a > tmp_b)
+		return 1;
+	return 0;
+}
+
+/* nearest-rank percentile, where the samples are already sorted */
+static gint64
+fu_util_bench_phase_get_percentile (FuUtilBenchPhase *phase, guint pct)
+{
+	guint idx = (phase->samples->len * pct + 99) / 100;
+	if (phase->samples->len == 0)
+		return 0;
+	if (idx > 0)
+		idx--;
+	return g_array_index (phase->samples, gint64, idx);
+}
+
+static void
+fu_util_bench_print_json (GPtrArray *phases)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+	g_autoptr(JsonNode) json_root = NULL;
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "Phases");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < phases->len; i++) {
+		FuUtilBenchPhase *phase = g_ptr_array_index (phases, i);
+		gint64 median = fu_util_bench_phase_get_percentile (phase, 50);
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "Name");
+		json_builder_add_string_value (builder, phase->name);
+		json_builder_set_member_name (builder, "Iterations");
+		json_builder_add_int_value (builder, phase->samples->len);
+		json_builder_set_member_name (builder, "Size");
+		json_builder_add_int_value (builder, phase->size);
+		json_builder_set_member_name (builder, "MedianUsec");
+		json_builder_add_int_value (builder, median);
+		json_builder_set_member_name (builder, "P95Usec");
+		json_builder_add_int_value (builder, fu_util_bench_phase_get_percentile (phase, 95));
+		if (phase->size > 0 && median > 0) {
+			json_builder_set_member_name (builder, "BytesPerSec");
+			json_builder_add_int_value (builder, phase->size * G_USEC_PER_SEC / median);
+		}
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	json_root = json_builder_get_root (builder);
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	g_print ("%s\n", data);
+}
+
+static void
+fu_util_bench_print (GPtrArray *phases)
+{
+	g_print ("%-18s %10s %10s %12s\n", "Phase", "Median/ms", "P95/ms", "Bytes/s");
+	for (guint i = 0; i < phases->len; i++) {
+		FuUtilBenchPhase *phase = g_ptr_array_index (phases, i);
+		gint64 median = fu_util_bench_phase_get_percentile (phase, 50);
+		gint64 p95 = fu_util_bench_phase_get_percentile (phase, 95);
+		g_print ("%-18s %10.2f %10.2f ", phase->name,
+			 (gdouble) median / 1000.0, (gdouble) p95 / 1000.0);
+		if (phase->size > 0 && median > 0)
+			g_print ("%12" G_GUINT64_FORMAT "\n", (guint64) phase->size * G_USEC_PER_SEC / median);
+		else
+			g_print ("%12s\n", "-");
+	}
+}
+
+static gboolean
+fu_util_benchmark (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	guint64 iterations = 10;
+	GBytes *blob_fw;
+	gboolean do_write;
+	FuUtilBenchPhase *phase_load;
+	FuUtilBenchPhase *phase_parse;
+	FuUtilBenchPhase *phase_prepare;
+	FuUtilBenchPhase *phase_write = NULL;
+	g_autofree gchar *device_id = NULL;
+	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(GBytes) blob_cab = NULL;
+	g_autoptr(GPtrArray) phases = NULL;
+	g_autoptr(XbNode) rel = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* invalid args */
+	if (g_strv_length (values) < 2 || g_strv_length (values) > 3) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments, expected FILE DEVICE-ID [COUNT]");
+		return FALSE;
+	}
+	if (g_strv_length (values) == 3) {
+		iterations = fu_common_strtoull (values[2]);
+		if (iterations == 0 || iterations > 10000) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_ARGS,
+					     "Invalid iteration count");
+			return FALSE;
+		}
+	}
+
+	/* parse once to find the payload */
+	blob_cab = fu_common_get_contents_bytes (values[0], error);
+	if (blob_cab == NULL) {
+		fu_util_maybe_prefix_sandbox_error (values[0], error);
+		return FALSE;
+	}
+	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+		return FALSE;
+	device = fu_util_get_device (priv, values[1], error);
+	if (device == NULL)
+		return FALSE;
+	device_id = g_strdup (fu_device_get_id (device));
+	silo = fu_engine_get_silo_from_blob (priv->engine, blob_cab, error);
+	if (silo == NULL)
+		return FALSE;
+	rel = xb_silo_query_first (silo, "components/component/releases/release", error);
+	if (rel == NULL)
+		return FALSE;
+	blob_fw = xb_node_get_data (rel, "fwupd::FirmwareBlob");
+	if (blob_fw == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "Failed to get firmware blob from release");
+		return FALSE;
+	}
+
+	/* only write real hardware repeatedly when asked */
+	do_write = g_strcmp0 (fu_device_get_plugin (device), "test") == 0 ||
+		   (priv->flags & FWUPD_INSTALL_FLAG_FORCE) > 0;
+	if (!do_write) {
+		/* TRANSLATORS: the write phase of the benchmark is not run */
+		g_printerr ("%s\n", _("Not writing to hardware, use --force to override"));
+	}
+
+	phases = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_util_bench_phase_free);
+	phase_load = fu_util_bench_phase_new (phases, "engine-load", 0);
+	phase_parse = fu_util_bench_phase_new (phases, "cab-parse", g_bytes_get_size (blob_cab));
+	phase_prepare = fu_util_bench_phase_new (phases, "prepare-firmware", g_bytes_get_size (blob_fw));
+	if (do_write)
+		phase_write = fu_util_bench_phase_new (phases, "write", g_bytes_get_size (blob_fw));
+	for (guint64 i = 0; i < iterations; i++) {
+		gint64 start;
+		gint64 elapsed;
+
+		/* metadata load and silo build */
+		start = g_get_monotonic_time ();
+		{
+			g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NO_IDLE_SOURCES);
+			if (!fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, error))
+				return FALSE;
+		}
+		elapsed = g_get_monotonic_time () - start;
+		g_array_append_val (phase_load->samples, elapsed);
+
+		/* cabinet parse and silo build */
+		start = g_get_monotonic_time ();
+		{
+			g_autoptr(XbSilo) silo_tmp = NULL;
+			silo_tmp = fu_engine_get_silo_from_blob (priv->engine, blob_cab, error);
+			if (silo_tmp == NULL)
+				return FALSE;
+		}
+		elapsed = g_get_monotonic_time () - start;
+		g_array_append_val (phase_parse->samples, elapsed);
+
+		/* the device may have been replaced by the previous write */
+		g_object_unref (device);
+		device = fu_engine_get_device (priv->engine, device_id, error);
+		if (device == NULL)
+			return FALSE;
+
+		/* plugin firmware parsing */
+		start = g_get_monotonic_time ();
+		{
+			g_autoptr(FuFirmware) firmware = NULL;
+			firmware = fu_device_prepare_firmware (device, blob_fw, priv->flags, error);
+			if (firmware == NULL)
+				return FALSE;
+		}
+		elapsed = g_get_monotonic_time () - start;
+		g_array_append_val (phase_prepare->samples, elapsed);
+
+		/* detach, write and attach */
+		if (phase_write != NULL) {
+			start = g_get_monotonic_time ();
+			if (!fu_engine_install_blob (priv->engine, device, blob_fw,
+						     priv->flags | FWUPD_INSTALL_FLAG_NO_HISTORY,
+						     error))
+				return FALSE;
+			elapsed = g_get_monotonic_time () - start;
+			g_array_append_val (phase_write->samples, elapsed);
+		}
+	}
+	for (guint i = 0; i < phases->len; i++) {
+		FuUtilBenchPhase *phase = g_ptr_array_index (phases, i);
+		g_array_sort (phase->samples, fu_util_bench_sample_sort_cb);
+	}
+
+	/* print results */
+	if (priv->as_json)
+		fu_util_bench_print_json (phases);
+	else
+		fu_util_bench_print (phases);
+	return TRUE;
+}
+
 static gboolean
 fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -1694,7 +2126,7 @@ fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autofree gchar *str_src = NULL;
 	g_autoptr(FuFirmware) firmware_dst = NULL;
 	g_autoptr(FuFirmware) firmware_src = NULL;
-	g_autoptr(GBytes) blob_dst = NULL;
+	g_autoptr(GFile) file_dst = NULL;
 	g_autoptr(GBytes) blob_src = NULL;
 	g_autoptr(GPtrArray) images = NULL;
 
@@ -1718,7 +2150,7 @@ fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 
 	/* load engine */
-	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, error))
+	if (!fu_engine_load (priv->engine, FU_UTIL_LOAD_FLAGS_FIRMWARE, error))
 		return FALSE;
 
 	/* find the GType to use */
@@ -1760,11 +2192,9 @@ fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 		fu_firmware_add_image (firmware_dst, img);
 	}
 
-	/* write new file */
-	blob_dst = fu_firmware_write (firmware_dst, error);
-	if (blob_dst == NULL)
-		return FALSE;
-	if (!fu_common_set_contents_bytes (values[1], blob_dst, error))
+	/* write new file directly, rather than building the blob in memory */
+	file_dst = g_file_new_for_path (values[1]);
+	if (!fu_firmware_write_file (firmware_dst, file_dst, error))
 		return FALSE;
 	str_dst = fu_firmware_to_string (firmware_dst);
 	g_print ("%s", str_dst);
@@ -1812,7 +2242,11 @@ fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autofree gchar *title = NULL;
 
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv,
+				   FU_ENGINE_LOAD_FLAG_NO_METADATA |
+				   FU_ENGINE_LOAD_FLAG_NO_PLUGINS |
+				   FU_ENGINE_LOAD_FLAG_NO_ENUMERATE,
+				   error))
 		return FALSE;
 	title = fu_util_get_tree_title (priv);
 
@@ -1937,7 +2371,7 @@ fu_util_refresh (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(GPtrArray) remotes = NULL;
 
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv, FU_UTIL_LOAD_FLAGS_MINIMAL, error))
 		return FALSE;
 
 	/* download new metadata */
@@ -1964,7 +2398,7 @@ fu_util_get_remotes (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autofree gchar *title = NULL;
 
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+	if (!fu_util_start_engine (priv, FU_UTIL_LOAD_FLAGS_MINIMAL, error))
 		return FALSE;
 	title = fu_util_get_tree_title (priv);
 
@@ -2069,9 +2503,15 @@ main (int argc, char *argv[])
 		{ "enable-json-state", '\0', 0, G_OPTION_ARG_NONE, &priv->enable_json_state,
 			/* TRANSLATORS: command line option */
 			_("Save device state into a JSON file between executions"), NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &priv->as_json,
+			/* TRANSLATORS: command line option */
+			_("Output devices and benchmark results in JSON format"), NULL },
 		{ "disable-ssl-strict", '\0', 0, G_OPTION_ARG_NONE, &priv->disable_ssl_strict,
 			/* TRANSLATORS: command line option */
 			_("Ignore SSL strict checks when downloading files"), NULL },
+		{ "parallel", '\0', 0, G_OPTION_ARG_INT, &priv->parallel,
+			/* TRANSLATORS: command line option */
+			_("Maximum number of independent devices to update at the same time"), NULL },
 		{ "filter", '\0', 0, G_OPTION_ARG_STRING, &filter,
 			/* TRANSLATORS: command line option */
 			_("Filter with a set of device flags using a ~ prefix to "
@@ -2123,7 +2563,7 @@ main (int argc, char *argv[])
 		     fu_util_get_plugins);
 	fu_util_cmd_array_add (cmd_array,
 		     "get-details",
-		     NULL,
+		     "FILENAME [FILENAME...]",
 		     /* TRANSLATORS: command description */
 		     _("Gets details about a firmware file"),
 		     fu_util_get_details);
@@ -2163,6 +2603,12 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Install a firmware blob on a device"),
 		     fu_util_install_blob);
+	fu_util_cmd_array_add (cmd_array,
+		     "benchmark",
+		     "FILE DEVICE-ID|GUID [COUNT]",
+		     /* TRANSLATORS: command description */
+		     _("Measure how long each part of an update takes"),
+		     fu_util_benchmark);
 	fu_util_cmd_array_add (cmd_array,
 		     "install",
 		     "FILE [DEVICE-ID|GUID]",
@@ -2335,6 +2781,13 @@ main (int argc, char *argv[])
 	}
 
 
+	/* a negative number of threads makes no sense */
+	if (priv->parallel < 0) {
+		/* TRANSLATORS: the user didn't read the man page */
+		g_print ("%s: %i\n", _("Invalid value for --parallel"), priv->parallel);
+		return EXIT_FAILURE;
+	}
+
 	/* set flags */
 	if (allow_reinstall)
 		priv->flags |= FWUPD_INSTALL_FLAG_ALLOW_REINSTALL;
@@ -2357,6 +2810,7 @@ main (int argc, char *argv[])
 	g_signal_connect (priv->engine, "percentage-changed",
 			  G_CALLBACK (fu_main_engine_percentage_changed_cb),
 			  priv);
+	fu_engine_set_install_threads_max (priv->engine, (guint) priv->parallel);
 
 	/* just show versions and exit */
 	if (version) {
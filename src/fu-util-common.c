@@ -9,7 +9,10 @@
 #include <config.h>
 
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include <glib/gi18n.h>
+#include <gio/gunixoutputstream.h>
 #include <gusb.h>
 #include <xmlb.h>
 
@@ -18,6 +21,8 @@
 #include "fu-device.h"
 #include "fu-security-attr.h"
 #include "fu-security-attrs.h"
+#include "fwupd-device-private.h"
+#include "fwupd-release-private.h"
 
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
@@ -1724,3 +1729,96 @@ fu_util_sort_devices_by_flags_cb (gconstpointer a, gconstpointer b)
 
 	return 0;
 }
+
+struct FuUtilJsonStream {
+	GOutputStream	*stream;
+	guint		 cnt;
+};
+
+/* writes the header, so the consumer sees output before the first object
+ * is ready; each object is serialized and written as soon as it is added */
+FuUtilJsonStream *
+fu_util_json_stream_new (GOutputStream *stream,
+			 const gchar *member_name,
+			 GError **error)
+{
+	g_autofree gchar *header = NULL;
+	g_autoptr(FuUtilJsonStream) self = g_new0 (FuUtilJsonStream, 1);
+
+	self->stream = g_object_ref (stream);
+	header = g_strdup_printf ("{\n  \"%s\" : [\n", member_name);
+	if (!g_output_stream_write_all (self->stream, header, strlen (header),
+					NULL, NULL, error))
+		return NULL;
+	return g_steal_pointer (&self);
+}
+
+FuUtilJsonStream *
+fu_util_json_stream_new_for_stdout (const gchar *member_name, GError **error)
+{
+	g_autoptr(GOutputStream) stream_fd = g_unix_output_stream_new (STDOUT_FILENO, FALSE);
+	g_autoptr(GOutputStream) stream = g_buffered_output_stream_new (stream_fd);
+	return fu_util_json_stream_new (stream, member_name, error);
+}
+
+gboolean
+fu_util_json_stream_add (FuUtilJsonStream *self, JsonBuilder *builder, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+	g_autoptr(JsonNode) json_root = json_builder_get_root (builder);
+	g_auto(GStrv) lines = NULL;
+
+	/* indent to match the position in the array */
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	lines = g_strsplit (data, "\n", -1);
+	if (self->cnt++ > 0)
+		g_string_append (str, ",\n");
+	for (guint i = 0; lines[i] != NULL; i++) {
+		if (i > 0)
+			g_string_append_c (str, '\n');
+		g_string_append_printf (str, "    %s", lines[i]);
+	}
+	return g_output_stream_write_all (self->stream, str->str, str->len,
+					  NULL, NULL, error);
+}
+
+gboolean
+fu_util_json_stream_add_device (FuUtilJsonStream *self, FwupdDevice *dev, GError **error)
+{
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	fwupd_device_to_json (dev, builder);
+	json_builder_end_object (builder);
+	return fu_util_json_stream_add (self, builder, error);
+}
+
+gboolean
+fu_util_json_stream_add_release (FuUtilJsonStream *self, FwupdRelease *rel, GError **error)
+{
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	fwupd_release_to_json (rel, builder);
+	json_builder_end_object (builder);
+	return fu_util_json_stream_add (self, builder, error);
+}
+
+gboolean
+fu_util_json_stream_close (FuUtilJsonStream *self, GError **error)
+{
+	const gchar *footer = self->cnt > 0 ? "\n  ]\n}\n" : "  ]\n}\n";
+	if (!g_output_stream_write_all (self->stream, footer, strlen (footer),
+					NULL, NULL, error))
+		return FALSE;
+	return g_output_stream_flush (self->stream, NULL, error);
+}
+
+void
+fu_util_json_stream_free (FuUtilJsonStream *self)
+{
+	g_object_unref (self->stream);
+	g_free (self);
+}
@@ -8,6 +8,7 @@
 
 #include <glib.h>
 #include <fwupd.h>
+#include <json-glib/json-glib.h>
 #include <libsoup/soup.h>
 
 /* this is only valid for tools */
@@ -85,3 +86,24 @@ gboolean	 fu_util_send_report		(FwupdClient	*client,
 						 GError		**error);
 gint		 fu_util_sort_devices_by_flags_cb	(gconstpointer	 a,
 						 gconstpointer	 b);
+
+typedef struct FuUtilJsonStream FuUtilJsonStream;
+FuUtilJsonStream *fu_util_json_stream_new	(GOutputStream	*stream,
+						 const gchar	*member_name,
+						 GError		**error);
+FuUtilJsonStream *fu_util_json_stream_new_for_stdout (const gchar *member_name,
+						 GError		**error);
+gboolean	 fu_util_json_stream_add	(FuUtilJsonStream *self,
+						 JsonBuilder	*builder,
+						 GError		**error);
+gboolean	 fu_util_json_stream_add_device	(FuUtilJsonStream *self,
+						 FwupdDevice	*dev,
+						 GError		**error);
+gboolean	 fu_util_json_stream_add_release (FuUtilJsonStream *self,
+						 FwupdRelease	*rel,
+						 GError		**error);
+gboolean	 fu_util_json_stream_close	(FuUtilJsonStream *self,
+						 GError		**error);
+void		 fu_util_json_stream_free	(FuUtilJsonStream *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUtilJsonStream, fu_util_json_stream_free)
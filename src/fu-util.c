@@ -37,6 +37,9 @@
 /* custom return code */
 #define EXIT_NOTHING_TO_DO		2
 
+/* number of history entries requested from the daemon at a time */
+#define FU_UTIL_HISTORY_PAGE_SIZE	100
+
 typedef enum {
 	FU_UTIL_HISTORY_DO_NOTHING,
 	FU_UTIL_HISTORY_NEVER,
@@ -68,6 +71,8 @@ struct FuUtilPrivate {
 	gboolean		 sign;
 	gboolean		 show_all_devices;
 	gboolean		 disable_ssl_strict;
+	gboolean		 show_stats;
+	gboolean		 as_json;
 	/* only valid in update and downgrade */
 	FuUtilOperation		 current_operation;
 	FwupdDevice		*current_device;
@@ -525,6 +530,24 @@ fu_util_get_tree_title (FuUtilPrivate *priv)
 	return g_strdup (fwupd_client_get_host_product (priv->client));
 }
 
+static gboolean
+fu_util_get_devices_as_json (FuUtilPrivate *priv, GPtrArray *devs, GError **error)
+{
+	g_autoptr(FuUtilJsonStream) json = NULL;
+
+	json = fu_util_json_stream_new_for_stdout ("Devices", error);
+	if (json == NULL)
+		return FALSE;
+	for (guint i = 0; i < devs->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devs, i);
+		if (!fu_util_filter_device (priv, dev))
+			continue;
+		if (!fu_util_json_stream_add_device (json, dev, error))
+			return FALSE;
+	}
+	return fu_util_json_stream_close (json, error);
+}
+
 static gboolean
 fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -532,6 +555,18 @@ fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(GPtrArray) devs = NULL;
 	g_autofree gchar *title = fu_util_get_tree_title (priv);
 
+	/* the tree needs the parents, but the JSON output can be filtered by the daemon */
+	if (priv->as_json) {
+		devs = fwupd_client_get_devices_filtered (priv->client,
+							  priv->filter_include,
+							  priv->filter_exclude,
+							  NULL, NULL,
+							  NULL, error);
+		if (devs == NULL)
+			return FALSE;
+		return fu_util_get_devices_as_json (priv, devs, error);
+	}
+
 	/* get results from daemon */
 	devs = fwupd_client_get_devices (priv->client, NULL, error);
 	if (devs == NULL)
@@ -843,6 +878,46 @@ fu_util_report_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+/* the history can be very long, so fetch it a page at a time and write
+ * each entry out newest-first as soon as it arrives */
+static gboolean
+fu_util_get_history_as_json (FuUtilPrivate *priv, GError **error)
+{
+	g_autoptr(FuUtilJsonStream) json = NULL;
+
+	json = fu_util_json_stream_new_for_stdout ("Devices", error);
+	if (json == NULL)
+		return FALSE;
+	for (guint offset = 0;; offset += FU_UTIL_HISTORY_PAGE_SIZE) {
+		g_autoptr(GPtrArray) devices = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		devices = fwupd_client_get_history_range (priv->client,
+							  FU_UTIL_HISTORY_PAGE_SIZE,
+							  offset,
+							  priv->cancellable,
+							  &error_local);
+		if (devices == NULL) {
+			if (g_error_matches (error_local,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOTHING_TO_DO))
+				break;
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return FALSE;
+		}
+		for (guint i = devices->len; i > 0; i--) {
+			FwupdDevice *dev = g_ptr_array_index (devices, i - 1);
+			if (!fu_util_filter_device (priv, dev))
+				continue;
+			if (!fu_util_json_stream_add_device (json, dev, error))
+				return FALSE;
+		}
+		if (devices->len < FU_UTIL_HISTORY_PAGE_SIZE)
+			break;
+	}
+	return fu_util_json_stream_close (json, error);
+}
+
 static gboolean
 fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -850,6 +925,9 @@ fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autoptr(GNode) root = g_node_new (NULL);
 	g_autofree gchar *title = fu_util_get_tree_title (priv);
 
+	if (priv->as_json)
+		return fu_util_get_history_as_json (priv, error);
+
 	/* get all devices from the history database */
 	devices = fwupd_client_get_history (priv->client, NULL, error);
 	if (devices == NULL)
@@ -991,6 +1069,16 @@ fu_util_verify_update (FuUtilPrivate *priv, gchar **values, GError **error)
 {
 	g_autoptr(FwupdDevice) dev = NULL;
 
+	/* verify every device at the same time */
+	if (g_strv_length (values) == 1 &&
+	    g_strcmp0 (values[0], FWUPD_DEVICE_ID_ANY) == 0) {
+		if (!fwupd_client_verify (priv->client, FWUPD_DEVICE_ID_ANY, NULL, error))
+			return FALSE;
+		/* TRANSLATORS: success message when user verified device checksums */
+		g_print ("%s\n", _("Successfully verified device checksums"));
+		return TRUE;
+	}
+
 	priv->filter_include |= FWUPD_DEVICE_FLAG_CAN_VERIFY;
 	dev = fu_util_get_device_or_prompt (priv, values, error);
 	if (dev == NULL)
@@ -1068,8 +1156,10 @@ fu_util_download_metadata (FuUtilPrivate *priv, GError **error)
 {
 	gboolean download_remote_enabled = FALSE;
 	guint devices_supported_cnt = 0;
+	FwupdClientDownloadFlags download_flags = FWUPD_CLIENT_DOWNLOAD_FLAG_NONE;
 	g_autoptr(GPtrArray) devs = NULL;
 	g_autoptr(GPtrArray) remotes = NULL;
+	g_autoptr(GPtrArray) remotes_download = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	g_autoptr(GString) str = g_string_new (NULL);
 
 	/* metadata refreshed recently */
@@ -1103,11 +1193,18 @@ fu_util_download_metadata (FuUtilPrivate *priv, GError **error)
 			continue;
 		download_remote_enabled = TRUE;
 		g_print ("%s %s\n", _("Updating"), fwupd_remote_get_id (remote));
-		if (!fwupd_client_refresh_remote (priv->client, remote,
-						  priv->cancellable, error))
-			return FALSE;
+		g_ptr_array_add (remotes_download, g_object_ref (remote));
 	}
 
+	/* download in parallel, skipping metadata the daemon already has */
+	if ((priv->flags & FWUPD_INSTALL_FLAG_FORCE) == 0)
+		download_flags |= FWUPD_CLIENT_DOWNLOAD_FLAG_ONLY_IF_CHANGED;
+	if (remotes_download->len > 0 &&
+	    !fwupd_client_refresh_remotes (priv->client, remotes_download,
+					   download_flags,
+					   priv->cancellable, error))
+		return FALSE;
+
 	/* no web remote is declared; try to enable LVFS */
 	if (!download_remote_enabled) {
 		/* we don't want to ask anything */
@@ -1208,6 +1305,18 @@ fu_util_get_releases (FuUtilPrivate *priv, gchar **values, GError **error)
 	rels = fwupd_client_get_releases (priv->client, fwupd_device_get_id (dev), NULL, error);
 	if (rels == NULL)
 		return FALSE;
+	if (priv->as_json) {
+		g_autoptr(FuUtilJsonStream) json = NULL;
+		json = fu_util_json_stream_new_for_stdout ("Releases", error);
+		if (json == NULL)
+			return FALSE;
+		for (guint i = 0; i < rels->len; i++) {
+			FwupdRelease *rel = g_ptr_array_index (rels, i);
+			if (!fu_util_json_stream_add_release (json, rel, error))
+				return FALSE;
+		}
+		return fu_util_json_stream_close (json, error);
+	}
 
 	if (rels->len == 0) {
 		/* TRANSLATORS: no repositories to download from */
@@ -1362,6 +1471,38 @@ fu_util_perhaps_refresh_remotes (FuUtilPrivate *priv, GError **error)
 	return fu_util_download_metadata (priv, error);
 }
 
+typedef struct {
+	GMainLoop		*loop;
+	guint			 pending;
+} FuUtilPendingHelper;
+
+typedef struct {
+	FwupdDevice		*dev;
+	GPtrArray		*rels;		/* (nullable) */
+	GError			*error;		/* (nullable) */
+	FuUtilPendingHelper	*helper;	/* noref */
+} FuUtilUpgradesRequest;
+
+static void
+fu_util_upgrades_request_free (FuUtilUpgradesRequest *req)
+{
+	g_object_unref (req->dev);
+	if (req->rels != NULL)
+		g_ptr_array_unref (req->rels);
+	if (req->error != NULL)
+		g_error_free (req->error);
+	g_free (req);
+}
+
+static void
+fu_util_get_upgrades_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuUtilUpgradesRequest *req = (FuUtilUpgradesRequest *) user_data;
+	req->rels = fwupd_client_get_upgrades_finish (FWUPD_CLIENT (source), res, &req->error);
+	if (--req->helper->pending == 0)
+		g_main_loop_quit (req->helper->loop);
+}
+
 static gboolean
 fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -1371,6 +1512,11 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 	g_autofree gchar *title = fu_util_get_tree_title (priv);
 	gboolean no_updates_header = FALSE;
 	gboolean latest_header = FALSE;
+	g_autoptr(GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+	g_autoptr(GPtrArray) reqs = NULL;
+	g_autoptr(GHashTable) upgrades = NULL;
+	g_autoptr(GError) error_all = NULL;
+	FuUtilPendingHelper helper = { .loop = loop, .pending = 0 };
 
 	/* are the remotes very old */
 	if (!fu_util_perhaps_refresh_remotes (priv, error))
@@ -1381,11 +1527,10 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (devices == NULL)
 		return FALSE;
 	g_ptr_array_sort (devices, fu_util_sort_devices_by_flags_cb);
+	reqs = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_util_upgrades_request_free);
 	for (guint i = 0; i < devices->len; i++) {
 		FwupdDevice *dev = g_ptr_array_index (devices, i);
-		g_autoptr(GPtrArray) rels = NULL;
-		g_autoptr(GError) error_local = NULL;
-		GNode *child;
+		FuUtilUpgradesRequest *req;
 
 		/* not going to have results, so save a D-Bus round-trip */
 		if (!fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_UPDATABLE))
@@ -1403,26 +1548,66 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 			continue;
 		supported = TRUE;
 
-		/* get the releases for this device and filter for validity */
-		rels = fwupd_client_get_upgrades (priv->client,
-						  fwupd_device_get_id (dev),
-						  NULL, &error_local);
-		if (rels == NULL) {
+		req = g_new0 (FuUtilUpgradesRequest, 1);
+		req->dev = g_object_ref (dev);
+		req->helper = &helper;
+		g_ptr_array_add (reqs, req);
+	}
+
+	/* get the releases for all devices in one request */
+	if (reqs->len > 0)
+		upgrades = fwupd_client_get_upgrades_all (priv->client, NULL, &error_all);
+	if (upgrades != NULL) {
+		for (guint i = 0; i < reqs->len; i++) {
+			FuUtilUpgradesRequest *req = g_ptr_array_index (reqs, i);
+			GPtrArray *rels = g_hash_table_lookup (upgrades,
+							       fwupd_device_get_id (req->dev));
+			if (rels == NULL) {
+				g_set_error_literal (&req->error,
+						     FWUPD_ERROR,
+						     FWUPD_ERROR_NOTHING_TO_DO,
+						     "No upgrades for device");
+				continue;
+			}
+			req->rels = g_ptr_array_ref (rels);
+		}
+	} else if (reqs->len > 0) {
+		/* older daemon, so get the releases for all devices at the same time */
+		g_debug ("falling back to GetUpgrades: %s", error_all->message);
+		for (guint i = 0; i < reqs->len; i++) {
+			FuUtilUpgradesRequest *req = g_ptr_array_index (reqs, i);
+			helper.pending++;
+			fwupd_client_get_upgrades_async (priv->client,
+							 fwupd_device_get_id (req->dev),
+							 NULL,
+							 fu_util_get_upgrades_cb,
+							 req);
+		}
+		g_main_loop_run (loop);
+	}
+
+	/* use the results in the original device order */
+	for (guint i = 0; i < reqs->len; i++) {
+		FuUtilUpgradesRequest *req = g_ptr_array_index (reqs, i);
+		GNode *child;
+
+		/* filter for validity */
+		if (req->rels == NULL) {
 			if (!latest_header) {
 				/* TRANSLATORS: message letting the user know no device upgrade available */
 				g_printerr ("%s\n", _("Devices with the latest available firmware version:"));
 				latest_header = TRUE;
 			}
-			g_printerr (" • %s\n", fwupd_device_get_name (dev));
+			g_printerr (" • %s\n", fwupd_device_get_name (req->dev));
 			/* discard the actual reason from user, but leave for debugging */
-			g_debug ("%s", error_local->message);
+			g_debug ("%s", req->error->message);
 			continue;
 		}
-		child = g_node_append_data (root, dev);
+		child = g_node_append_data (root, req->dev);
 
 		/* add all releases */
-		for (guint j = 0; j < rels->len; j++) {
-			FwupdRelease *rel = g_ptr_array_index (rels, j);
+		for (guint j = 0; j < req->rels->len; j++) {
+			FwupdRelease *rel = g_ptr_array_index (req->rels, j);
 			g_node_append_data (child, g_object_ref (rel));
 		}
 	}
@@ -1943,6 +2128,105 @@ fu_util_set_approved_firmware (FuUtilPrivate *priv, gchar **values, GError **err
 						   error);
 }
 
+static gboolean
+fu_util_get_traces (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	g_autofree gchar *data = NULL;
+
+	/* check args */
+	if (g_strv_length (values) > 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: expected [FILENAME]");
+		return FALSE;
+	}
+
+	/* call into daemon */
+	data = fwupd_client_get_traces (priv->client, priv->cancellable, error);
+	if (data == NULL)
+		return FALSE;
+	if (g_strv_length (values) == 1)
+		return g_file_set_contents (values[0], data, -1, error);
+	g_print ("%s\n", data);
+	return TRUE;
+}
+
+static gboolean
+fu_util_get_metrics (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	g_autofree gchar *data = NULL;
+
+	/* check args */
+	if (g_strv_length (values) > 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: expected [FILENAME]");
+		return FALSE;
+	}
+
+	/* call into daemon */
+	data = fwupd_client_get_metrics (priv->client, priv->cancellable, error);
+	if (data == NULL)
+		return FALSE;
+	if (g_strv_length (values) == 1)
+		return g_file_set_contents (values[0], data, -1, error);
+	g_print ("%s", data);
+	return TRUE;
+}
+
+static gboolean
+fu_util_get_plugins (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	g_autoptr(GPtrArray) plugins = NULL;
+
+	/* check args */
+	if (g_strv_length (values) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: none expected");
+		return FALSE;
+	}
+
+	/* call into daemon */
+	plugins = fwupd_client_get_plugin_stats (priv->client, priv->cancellable, error);
+	if (plugins == NULL)
+		return FALSE;
+	for (guint i = 0; i < plugins->len; i++) {
+		GVariant *stats = g_ptr_array_index (plugins, i);
+		const gchar *name = NULL;
+		gboolean enabled = FALSE;
+		guint64 calls = 0;
+		guint64 wall_time = 0;
+		guint64 cpu_time = 0;
+		guint64 devices = 0;
+		guint64 events = 0;
+
+		g_variant_lookup (stats, "Name", "&s", &name);
+		g_variant_lookup (stats, "Enabled", "b", &enabled);
+		if (!priv->show_stats) {
+			g_print ("%s\n", name);
+			continue;
+		}
+		g_variant_lookup (stats, "Calls", "t", &calls);
+		g_variant_lookup (stats, "WallTime", "t", &wall_time);
+		g_variant_lookup (stats, "CpuTime", "t", &cpu_time);
+		g_variant_lookup (stats, "Devices", "t", &devices);
+		g_variant_lookup (stats, "Events", "t", &events);
+		g_print ("%s%s: calls=%" G_GUINT64_FORMAT " "
+			 "wall=%.1fms cpu=%.1fms "
+			 "devices=%" G_GUINT64_FORMAT " "
+			 "events=%" G_GUINT64_FORMAT "\n",
+			 name, enabled ? "" : " (disabled)", calls,
+			 (gdouble) wall_time / 1000.f,
+			 (gdouble) cpu_time / 1000.f,
+			 devices, events);
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_util_get_approved_firmware (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -2374,6 +2658,12 @@ main (int argc, char *argv[])
 		{ "disable-ssl-strict", '\0', 0, G_OPTION_ARG_NONE, &priv->disable_ssl_strict,
 			/* TRANSLATORS: command line option */
 			_("Ignore SSL strict checks when downloading files"), NULL },
+		{ "stats", '\0', 0, G_OPTION_ARG_NONE, &priv->show_stats,
+			/* TRANSLATORS: command line option */
+			_("Show the resources used by each plugin"), NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &priv->as_json,
+			/* TRANSLATORS: command line option */
+			_("Output devices, releases and history in JSON format"), NULL },
 		{ "filter", '\0', 0, G_OPTION_ARG_STRING, &filter,
 			/* TRANSLATORS: command line option */
 			_("Filter with a set of device flags using a ~ prefix to "
@@ -2445,7 +2735,7 @@ main (int argc, char *argv[])
 		     fu_util_update);
 	fu_util_cmd_array_add (cmd_array,
 		     "verify",
-		     "[DEVICE-ID|GUID]",
+		     "[DEVICE-ID|GUID|*]",
 		     /* TRANSLATORS: command description */
 		     _("Checks cryptographic hash matches firmware"),
 		     fu_util_verify);
@@ -2527,6 +2817,24 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Activate devices"),
 		     fu_util_activate);
+	fu_util_cmd_array_add (cmd_array,
+		     "get-traces",
+		     "[FILENAME]",
+		     /* TRANSLATORS: timing information for debugging */
+		     _("Gets the recent daemon timing spans in Chrome trace format."),
+		     fu_util_get_traces);
+	fu_util_cmd_array_add (cmd_array,
+		     "get-metrics",
+		     "[FILENAME]",
+		     /* TRANSLATORS: counters and latencies for monitoring */
+		     _("Gets the daemon metrics in OpenMetrics format."),
+		     fu_util_get_metrics);
+	fu_util_cmd_array_add (cmd_array,
+		     "get-plugins",
+		     NULL,
+		     /* TRANSLATORS: command description */
+		     _("Get all enabled plugins registered with the system"),
+		     fu_util_get_plugins);
 	fu_util_cmd_array_add (cmd_array,
 		     "get-approved-firmware",
 		     NULL,
@@ -2705,7 +3013,9 @@ main (int argc, char *argv[])
 		if (!fwupd_client_set_feature_flags (priv->client,
 						     FWUPD_FEATURE_FLAG_CAN_REPORT |
 						     FWUPD_FEATURE_FLAG_UPDATE_ACTION |
-						     FWUPD_FEATURE_FLAG_DETACH_ACTION,
+						     FWUPD_FEATURE_FLAG_DETACH_ACTION |
+						     FWUPD_FEATURE_FLAG_COMPACT_VARIANT |
+						     FWUPD_FEATURE_FLAG_FD_REPLY,
 						     priv->cancellable, &error)) {
 			g_printerr ("Failed to set front-end features: %s\n",
 				    error->message);
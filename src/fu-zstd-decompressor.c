@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuZstdDecompressor"
+
+#include "config.h"
+
+#include <zstd.h>
+
+#include "fu-zstd-decompressor.h"
+
+struct _FuZstdDecompressor
+{
+	GObject			 parent_instance;
+	ZSTD_DStream		*zstdstream;
+};
+
+static void fu_zstd_decompressor_iface_init (GConverterIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (FuZstdDecompressor, fu_zstd_decompressor, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER,
+						fu_zstd_decompressor_iface_init))
+
+static void
+fu_zstd_decompressor_reset (GConverter *converter)
+{
+	FuZstdDecompressor *self = FU_ZSTD_DECOMPRESSOR (converter);
+	ZSTD_initDStream (self->zstdstream);
+}
+
+/* decompresses as much as fits in @outbuf, so the caller never needs to
+ * know the size of the decompressed data */
+static GConverterResult
+fu_zstd_decompressor_convert (GConverter *converter,
+			      const void *inbuf,
+			      gsize inbuf_size,
+			      void *outbuf,
+			      gsize outbuf_size,
+			      GConverterFlags flags,
+			      gsize *bytes_read,
+			      gsize *bytes_written,
+			      GError **error)
+{
+	FuZstdDecompressor *self = FU_ZSTD_DECOMPRESSOR (converter);
+	ZSTD_inBuffer input = { inbuf, inbuf_size, 0 };
+	ZSTD_outBuffer output = { outbuf, outbuf_size, 0 };
+	gsize rc;
+
+	rc = ZSTD_decompressStream (self->zstdstream, &output, &input);
+	if (ZSTD_isError (rc)) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "failed to decompress: %s",
+			     ZSTD_getErrorName (rc));
+		return G_CONVERTER_ERROR;
+	}
+	*bytes_read = input.pos;
+	*bytes_written = output.pos;
+
+	/* end of the last frame */
+	if (rc == 0 && input.pos == inbuf_size)
+		return G_CONVERTER_FINISHED;
+
+	/* no progress, so either the output is full or the input ran out */
+	if (input.pos == 0 && output.pos == 0) {
+		if (output.size == 0) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_NO_SPACE,
+					     "no space in output buffer");
+			return G_CONVERTER_ERROR;
+		}
+		if (flags & G_CONVERTER_INPUT_AT_END) {
+			g_set_error_literal (error,
+					     G_IO_ERROR,
+					     G_IO_ERROR_INVALID_DATA,
+					     "zstd data truncated");
+			return G_CONVERTER_ERROR;
+		}
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_PARTIAL_INPUT,
+				     "need more input");
+		return G_CONVERTER_ERROR;
+	}
+	return G_CONVERTER_CONVERTED;
+}
+
+static void
+fu_zstd_decompressor_iface_init (GConverterIface *iface)
+{
+	iface->convert = fu_zstd_decompressor_convert;
+	iface->reset = fu_zstd_decompressor_reset;
+}
+
+static void
+fu_zstd_decompressor_init (FuZstdDecompressor *self)
+{
+	self->zstdstream = ZSTD_createDStream ();
+	ZSTD_initDStream (self->zstdstream);
+}
+
+static void
+fu_zstd_decompressor_finalize (GObject *object)
+{
+	FuZstdDecompressor *self = FU_ZSTD_DECOMPRESSOR (object);
+	ZSTD_freeDStream (self->zstdstream);
+	G_OBJECT_CLASS (fu_zstd_decompressor_parent_class)->finalize (object);
+}
+
+static void
+fu_zstd_decompressor_class_init (FuZstdDecompressorClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_zstd_decompressor_finalize;
+}
+
+/**
+ * fu_zstd_decompressor_new:
+ *
+ * Creates a #GConverter that decompresses zstd data, typically used with
+ * g_converter_input_stream_new() so that the data is never fully inflated
+ * into memory.
+ *
+ * Returns: (transfer full): a #FuZstdDecompressor
+ **/
+FuZstdDecompressor *
+fu_zstd_decompressor_new (void)
+{
+	return g_object_new (FU_TYPE_ZSTD_DECOMPRESSOR, NULL);
+}
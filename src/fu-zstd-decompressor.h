@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#define FU_TYPE_ZSTD_DECOMPRESSOR (fu_zstd_decompressor_get_type ())
+G_DECLARE_FINAL_TYPE (FuZstdDecompressor, fu_zstd_decompressor, FU, ZSTD_DECOMPRESSOR, GObject)
+
+FuZstdDecompressor	*fu_zstd_decompressor_new	(void);